@@ -18,13 +18,27 @@
 
 #include "Falcor.h"
 #include "../SharedUtils/RenderingPipeline.h"
+#include "../SharedUtils/PassRegistry.h"
 #include "../CommonPasses/LightProbeGBufferPass.h"
 #include "Passes/SimpleDiffuseGIPass.h"
+#include "Passes/CpuDiffuseGIPass.h"
 #include "Passes/DenoisePass.h"
 #include "../CommonPasses/SimpleAccumulationPass.h"
 
 int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nShowCmd)
 {
+	// Make our passes available to pipeline description files (pass "-pipeline <file.json>" on the command line,
+	//     e.g., Data/bmfrPipeline.json, to replace the pass list below without recompiling.  Data/cpuReferencePipeline.json
+	//     renders the G-buffer and GI on the CPU instead, for generating training and reference data headless)
+	PassRegistry& registry = PassRegistry::instance();
+	registry.registerPass("LightProbeGBufferPass", [](const PassRegistry::Args&) { return LightProbeGBufferPass::create(); });
+	registry.registerPass("SimpleDiffuseGIPass", [](const PassRegistry::Args&) { return SimpleDiffuseGIPass::create(); });
+	registry.registerPass("CpuDiffuseGIPass", [](const PassRegistry::Args&) { return CpuDiffuseGIPass::create(); });
+	registry.registerPass("SimpleAccumulationPass", [](const PassRegistry::Args& args) {
+		return SimpleAccumulationPass::create(PassRegistry::getArg(args, "channel", ResourceManager::kOutputChannel)); });
+	registry.registerPass("BlockwiseMultiOrderFeatureRegression", [](const PassRegistry::Args& args) {
+		return BlockwiseMultiOrderFeatureRegression::create(PassRegistry::getArg(args, "channel", ResourceManager::kOutputChannel)); });
+
 	// Create our rendering pipeline
 	RenderingPipeline* pipeline = new RenderingPipeline();
 
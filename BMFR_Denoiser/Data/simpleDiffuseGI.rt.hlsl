@@ -40,6 +40,8 @@ cbuffer RayGenCB
 	bool  gDoIndirectGI;   // A boolean determining if we should shoot indirect GI rays
 	bool  gCosSampling;    // Use cosine sampling (true) or uniform sampling (false)
 	bool  gDirectShadow;   // Should we shoot shadow rays from our first hit point?
+	float gEnvSampleProb;  // Probability of sampling the indirect ray from the environment map rather than the cosine/uniform lobe
+	uint2 gEnvTableSize;   // Size of the environment map sampling table in gEnvMapTable
 }
 
 // Input and out textures that need to be set by the C++ code (for the ray gen shader)
@@ -90,8 +92,9 @@ void IndirectClosestHit(inout IndirectRayPayload rayData, BuiltInTriangleInterse
 	// Run a helper functions to extract Falcor scene data for shading
 	ShadingData shadeData = getHitShadingData( attribs );
 
-	// Pick a random light from our scene to shoot a shadow ray towards	
-	int lightToSample = min(int(nextRand(rayData.rndSeed) * gLightsCount), gLightsCount - 1);
+	// Pick a random light from our scene to shoot a shadow ray towards, in proportion to its power
+	float lightPdf;
+	int lightToSample = sampleLightIndex(rayData.rndSeed, lightPdf);
 
 	// Query the scene to find info about the randomly selected light
 	float distToLight;
@@ -103,7 +106,7 @@ void IndirectClosestHit(inout IndirectRayPayload rayData, BuiltInTriangleInterse
 	float LdotN = saturate(dot(shadeData.N, toLight));
 
 	// Shoot our shadow ray to our randomly selected light
-	float shadowMult = float(gLightsCount) * shadowRayVisibility(shadeData.posW, toLight, RayTMin(), distToLight);
+	float shadowMult = (lightPdf > 0.0f ? 1.0f / lightPdf : 0.0f) * shadowRayVisibility(shadeData.posW, toLight, RayTMin(), distToLight);
 
 	// Return the Lambertian shading color using the physically based Lambertian term (albedo / pi)
 	rayData.color = shadowMult * LdotN * lightIntensity * shadeData.diffuse / M_PI;
@@ -154,8 +157,9 @@ void SimpleDiffuseGIRayGen()
 	// Our camera sees the background if worldPos.w is 0, only do diffuse shading & GI elsewhere
 	if (worldPos.w != 0.0f)
 	{
-		// Pick a random light from our scene to sample for direct lighting
-		int lightToSample = min(int(nextRand(randSeed) * gLightsCount), gLightsCount - 1);
+		// Pick a random light from our scene to sample for direct lighting, in proportion to its power
+		float lightPdf;
+		int lightToSample = sampleLightIndex(randSeed, lightPdf);
 
 		// We need to query our scene to find info about the current light
 		float distToLight;
@@ -167,7 +171,7 @@ void SimpleDiffuseGIRayGen()
 		float LdotN = saturate(dot(worldNorm.xyz, toLight));
 
 		// Shoot our ray for our direct lighting
-		float shadowMult = float(gLightsCount);
+		float shadowMult = lightPdf > 0.0f ? 1.0f / lightPdf : 0.0f;
         //if we choose this, the shadow ray will automatically considered as lighted
 		if (gDirectShadow)
 			shadowMult *= shadowRayVisibility(worldPos.xyz, toLight, gMinT, distToLight);
@@ -178,9 +182,12 @@ void SimpleDiffuseGIRayGen()
 		// Now do our indirect illumination
 		if (gDoIndirectGI)
 		{
-			// Select a random direction for our diffuse interreflection ray.
+			// Select a random direction for our diffuse interreflection ray.  With environment map sampling, the direction
+			//     comes from the map's luminance with probability gEnvSampleProb, and from the usual lobe otherwise.
 			float3 bounceDir;
-			if (gCosSampling)
+			if (gEnvSampleProb > 0.0f && nextRand(randSeed) < gEnvSampleProb)
+				bounceDir = sampleEnvMapDirection(randSeed, gEnvTableSize);
+			else if (gCosSampling)
 				bounceDir = getCosHemisphereSample(randSeed, worldNorm.xyz);      // Use cosine sampling
 			else
 				bounceDir = getUniformHemisphereSample(randSeed, worldNorm.xyz);  // Use uniform random samples
@@ -188,19 +195,19 @@ void SimpleDiffuseGIRayGen()
 			// Get NdotL for our selected ray direction
 			float NdotL = saturate(dot(worldNorm.xyz, bounceDir));
 
-			// Shoot our indirect global illumination ray
-            // wrapped traceRay()
-			float3 bounceColor = shootIndirectRay(worldPos.xyz, bounceDir, gMinT, randSeed);
-
-			//bounceColor = (NdotL > 0.50f) ? float3(0, 0, 0) : bounceColor;
-
-			// Probability of selecting this ray ( cos/pi for cosine sampling, 1/2pi for uniform sampling )
+			// Probability of selecting this ray ( cos/pi for cosine sampling, 1/2pi for uniform sampling ).  When mixing in
+			//     environment map samples, the pdf of the mixture is the one to divide by (one-sample MIS, balance heuristic).
 			float sampleProb = gCosSampling ? (NdotL / M_PI) : (1.0f / (2.0f * M_PI));
+			if (gEnvSampleProb > 0.0f)
+				sampleProb = lerp(sampleProb, getEnvMapPdf(bounceDir, gEnvTableSize), gEnvSampleProb);
 
-			// Accumulate the color.  For performance, terms could (and should) be cancelled here.
-			//shadeColor += (NdotL * bounceColor * difMatlColor.rgb / M_PI) / sampleProb;
+			// Shoot our indirect global illumination ray, unless the environment map picked a direction below the surface
+			float3 bounceColor = float3(0, 0, 0);
+			if (NdotL > 0.0f && sampleProb > 0.0f)
+				bounceColor = shootIndirectRay(worldPos.xyz, bounceDir, gMinT, randSeed) / sampleProb;
 
-			shadeColor += (NdotL * bounceColor * difMatlColor.rgb / M_PI) / sampleProb;
+			// Accumulate the color.  bounceColor is already divided by the sample's probability.
+			shadeColor += NdotL * bounceColor * difMatlColor.rgb / M_PI;
 		}
 	}
 	
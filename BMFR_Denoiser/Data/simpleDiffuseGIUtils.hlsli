@@ -111,6 +111,25 @@ float nextRand(inout uint s)
 	return float(s & 0x00FFFFFF) / float(0x01000000);
 }
 
+// The light selection table built by Falcor's LightSampler:  one 16-byte AliasTable::Entry (threshold, alias, pdf, unused) per light.
+//     Lights are picked in proportion to their power, so the shading code divides by the returned pdf instead of multiplying by gLightsCount.
+shared ByteAddressBuffer gLightAliasTable;
+
+// Picks a light with a single random number, like nextRand(randSeed) * gLightsCount did, so the random sequence stays the same
+int sampleLightIndex(inout uint randSeed, out float lightPdf)
+{
+	float u = nextRand(randSeed) * gLightsCount;
+	uint index = min(uint(u), uint(gLightsCount - 1));
+	uint4 entry = gLightAliasTable.Load4(index * 16);
+	if (u - float(index) >= asfloat(entry.x))
+	{
+		index = entry.y;
+		entry = gLightAliasTable.Load4(index * 16);
+	}
+	lightPdf = asfloat(entry.z);
+	return int(index);
+}
+
 // Get a cosine-weighted random vector centered around a specified normal direction.
 float3 getCosHemisphereSample(inout uint randSeed, float3 hitNorm)
 {
@@ -143,6 +162,54 @@ float3 getUniformHemisphereSample(inout uint randSeed, float3 hitNorm)
 	return tangent * (r * cos(phi).x) + bitangent * (r * sin(phi)) + hitNorm.xyz * randVal.x;
 }
 
+// The environment map sampling tables built by Falcor's EnvMapSampler:  for a table of tableSize.x by tableSize.y texels, one
+//     conditional AliasTable per row (tableSize.x 16-byte entries each), followed by the marginal AliasTable over the rows.
+shared ByteAddressBuffer gEnvMapTable;
+
+// Samples an alias table stored at the given entry offset of gEnvMapTable, returning the index and its pdf
+uint sampleEnvMapTable(uint offset, uint count, float u, out float pdf)
+{
+	float scaled = u * count;
+	uint index = min(uint(scaled), count - 1);
+	uint4 entry = gEnvMapTable.Load4((offset + index) * 16);
+	if (scaled - float(index) >= asfloat(entry.x))
+	{
+		index = entry.y;
+		entry = gEnvMapTable.Load4((offset + index) * 16);
+	}
+	pdf = asfloat(entry.z);
+	return index;
+}
+
+// The solid angle pdf of sampling a direction with sampleEnvMapDirection()
+float getEnvMapPdf(float3 dir, uint2 tableSize)
+{
+	float3 p = normalize(dir);
+	float2 uv = wsVectorToLatLong(p);
+	float sinTheta = sqrt(max(0.0f, 1.0f - p.y * p.y));
+	if (sinTheta <= 0.0f) return 0.0f;
+
+	uint2 texel = min(uint2(uv * tableSize), tableSize - 1);
+	float rowPdf = asfloat(gEnvMapTable.Load((tableSize.x * tableSize.y + texel.y) * 16 + 8));
+	float colPdf = asfloat(gEnvMapTable.Load((tableSize.x * texel.y + texel.x) * 16 + 8));
+	return rowPdf * colPdf * float(tableSize.x * tableSize.y) / (2.0f * M_PI * M_PI * sinTheta);
+}
+
+// Picks a direction in proportion to the environment map's luminance, with four random numbers (row, column, and the
+//     position inside the table texel).  The inverse of wsVectorToLatLong().
+float3 sampleEnvMapDirection(inout uint randSeed, uint2 tableSize)
+{
+	float rowPdf, colPdf;
+	uint row = sampleEnvMapTable(tableSize.x * tableSize.y, tableSize.y, nextRand(randSeed), rowPdf);
+	uint col = sampleEnvMapTable(tableSize.x * row, tableSize.x, nextRand(randSeed), colPdf);
+	float2 jitter = float2(nextRand(randSeed), nextRand(randSeed));
+
+	float2 uv = (float2(col, row) + jitter) / float2(tableSize);
+	float phi = (2.0f * uv.x - 1.0f) * M_PI;
+	float theta = uv.y * M_PI;
+	return float3(sin(theta) * sin(phi), cos(theta), -sin(theta) * cos(phi));
+}
+
 // This function tests if the alpha test fails, given the attributes of the current hit. 
 //   -> Can legally be called in a DXR any-hit shader or a DXR closest-hit shader, and 
 //      accesses Falcor helpers and data structures to extract and perform the alpha test.
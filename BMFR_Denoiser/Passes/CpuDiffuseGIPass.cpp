@@ -0,0 +1,612 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "CpuDiffuseGIPass.h"
+#include "Utils/ParallelFor.h"
+#include "Data/VertexAttrib.h"
+#include "Graphics/Model/Loaders/VertexQuantizer.h"
+#include "glm/gtc/packing.hpp"
+#include <cfloat>
+
+namespace {
+    const uint32_t kTileSize = 16;
+    const uint32_t kMaxTextureSize = 1024;     // Textures are read back at their largest mip up to this size
+    const float kPi = 3.14159265f;
+
+    // The random number generator and sampling functions of simpleDiffuseGIUtils.hlsli, so that both passes draw the same numbers
+    uint32_t initRand(uint32_t val0, uint32_t val1, uint32_t backoff = 16)
+    {
+        uint32_t v0 = val0, v1 = val1, s0 = 0;
+        for (uint32_t n = 0; n < backoff; n++)
+        {
+            s0 += 0x9e3779b9;
+            v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+            v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+        }
+        return v0;
+    }
+
+    float nextRand(uint32_t& s)
+    {
+        s = (1664525u * s + 1013904223u);
+        return float(s & 0x00FFFFFF) / float(0x01000000);
+    }
+
+    vec3 getPerpendicularVector(const vec3& u)
+    {
+        vec3 a = abs(u);
+        uint32_t xm = ((a.x - a.y) < 0 && (a.x - a.z) < 0) ? 1 : 0;
+        uint32_t ym = (a.y - a.z) < 0 ? (1 ^ xm) : 0;
+        uint32_t zm = 1 ^ (xm | ym);
+        return cross(u, vec3(float(xm), float(ym), float(zm)));
+    }
+
+    vec3 getCosHemisphereSample(uint32_t& randSeed, const vec3& hitNorm)
+    {
+        vec2 randVal;
+        randVal.x = nextRand(randSeed);
+        randVal.y = nextRand(randSeed);
+        vec3 bitangent = getPerpendicularVector(hitNorm);
+        vec3 tangent = cross(bitangent, hitNorm);
+        float r = sqrt(randVal.x);
+        float phi = 2.0f * 3.14159265f * randVal.y;
+        return tangent * (r * cos(phi)) + bitangent * (r * sin(phi)) + hitNorm * sqrt(std::max(0.0f, 1.0f - randVal.x));
+    }
+
+    vec3 getUniformHemisphereSample(uint32_t& randSeed, const vec3& hitNorm)
+    {
+        vec2 randVal;
+        randVal.x = nextRand(randSeed);
+        randVal.y = nextRand(randSeed);
+        vec3 bitangent = getPerpendicularVector(hitNorm);
+        vec3 tangent = cross(bitangent, hitNorm);
+        float r = sqrt(std::max(0.0f, 1.0f - randVal.x * randVal.x));
+        float phi = 2.0f * 3.14159265f * randVal.y;
+        return tangent * (r * cos(phi)) + bitangent * (r * sin(phi)) + hitNorm * randVal.x;
+    }
+
+    vec2 wsVectorToLatLong(const vec3& dir)
+    {
+        vec3 p = normalize(dir);
+        float u = (1.f + atan2(p.x, -p.z) / kPi) * 0.5f;
+        float v = acos(clamp(p.y, -1.0f, 1.0f)) / kPi;
+        return vec2(u, v);
+    }
+
+    float saturate(float v) { return clamp(v, 0.0f, 1.0f); }
+
+    // Read one attribute of all the vertices of a mesh.  decode() converts one vertex and returns false for unsupported formats,
+    //     in which case the values are left empty.
+    template<typename T, typename DecodeFunc>
+    void readVertexAttribute(const Mesh* pMesh, uint32_t location, DecodeFunc decode, std::vector<T>& values)
+    {
+        const Vao* pVao = pMesh->getVao().get();
+        const auto& elemDesc = pVao->getElementIndexByLocation(location);
+        if (elemDesc.vbIndex == Vao::ElementDesc::kInvalidIndex) return;
+        const auto& pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex);
+        const ResourceFormat format = pVbLayout->getElementFormat(elemDesc.elementIndex);
+
+        Buffer* pVB = pVao->getVertexBuffer(elemDesc.vbIndex).get();
+        const uint32_t stride = pVbLayout->getStride();
+        const uint8_t* pVertices = (const uint8_t*)pVB->map(Buffer::MapType::Read) + pVbLayout->getElementOffset(elemDesc.elementIndex);
+        values.resize(pMesh->getVertexCount());
+        for (uint32_t i = 0; i < pMesh->getVertexCount(); i++)
+        {
+            if (decode(pVertices + i * stride, format, values[i]) == false)
+            {
+                logWarning("CpuDiffuseGIPass: Unsupported vertex attribute format " + to_string(format) + ". The attribute is ignored.");
+                values.clear();
+                break;
+            }
+        }
+        pVB->unmap();
+    }
+
+    bool decodeNormal(const uint8_t* pVertex, ResourceFormat format, vec3& normal)
+    {
+        if (format == ResourceFormat::RG16Snorm)
+        {
+            normal = VertexQuantizer::decodeOct((const uint16_t*)pVertex);
+            return true;
+        }
+        if (format != ResourceFormat::RGB32Float && format != ResourceFormat::RGBA32Float) return false;
+        const float* pN = (const float*)pVertex;
+        normal = vec3(pN[0], pN[1], pN[2]);
+        return true;
+    }
+
+    bool decodeTexCrd(const uint8_t* pVertex, ResourceFormat format, vec2& texCrd)
+    {
+        if (format == ResourceFormat::RG16Float)
+        {
+            texCrd = VertexQuantizer::decodeTexCoord((const uint16_t*)pVertex);
+            return true;
+        }
+        if (format != ResourceFormat::RG32Float && format != ResourceFormat::RGB32Float && format != ResourceFormat::RGBA32Float) return false;
+        const float* pT = (const float*)pVertex;
+        texCrd = vec2(pT[0], pT[1]);
+        return true;
+    }
+
+    // Bilinear filtering with wrap addressing, like the materials' default sampler
+    vec4 sampleBilinear(const std::vector<vec4>& texels, const uvec2& size, const vec2& texCrd)
+    {
+        const vec2 coord = texCrd * vec2(size) - vec2(0.5f);
+        const vec2 base = floor(coord);
+        const vec2 f = coord - base;
+        const ivec2 isize = ivec2(size);
+        const int x0 = ((int(base.x) % isize.x) + isize.x) % isize.x;
+        const int y0 = ((int(base.y) % isize.y) + isize.y) % isize.y;
+        const int x1 = (x0 + 1) % isize.x;
+        const int y1 = (y0 + 1) % isize.y;
+        const vec4 top = glm::mix(texels[x0 + y0 * isize.x], texels[x1 + y0 * isize.x], f.x);
+        const vec4 bottom = glm::mix(texels[x0 + y1 * isize.x], texels[x1 + y1 * isize.x], f.x);
+        return glm::mix(top, bottom, f.y);
+    }
+};
+
+bool CpuDiffuseGIPass::initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager)
+{
+    // Request the same channels, with the same formats, as LightProbeGBufferPass and SimpleDiffuseGIPass, so this pass can replace both
+    mpResManager = pResManager;
+    mpResManager->requestTextureResource("WorldPosition");
+    mpResManager->requestTextureResource("WorldNormal", ResourceFormat::RGBA16Float);
+    mpResManager->requestTextureResource("MaterialDiffuse", ResourceFormat::RGBA16Float);
+    mpResManager->requestTextureResource(ResourceManager::kOutputChannel);
+    mpResManager->requestTextureResource(ResourceManager::kEnvironmentMap);
+
+    // Set the default scene to load
+    mpResManager->setDefaultSceneName("Data/pink_room/pink_room.fscene");
+    return true;
+}
+
+bool CpuDiffuseGIPass::initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager, uint width, uint height)
+{
+    return initialize(pRenderContext, pResManager);
+}
+
+void CpuDiffuseGIPass::initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene)
+{
+    mpScene = pScene;
+    mpBvh = mpScene ? SceneBvh::create(mpScene) : nullptr;
+    mpLightSampler = mpScene ? LightSampler::create(mpScene, mDoPowerLightSampling) : nullptr;
+    mTextures.clear();
+    mMeshAttributes.clear();
+}
+
+void CpuDiffuseGIPass::renderGui(Gui* pGui)
+{
+    int dirty = 0;
+    dirty |= (int)pGui->addCheckBox(mDoDirectShadows ? "Shooting direct shadow rays" : "No direct shadow rays", mDoDirectShadows);
+    dirty |= (int)pGui->addCheckBox(mDoIndirectGI ? "Shooting global illumination rays" : "Skipping global illumination", mDoIndirectGI);
+    dirty |= (int)pGui->addCheckBox(mDoCosSampling ? "Use cosine sampling" : "Use uniform sampling", mDoCosSampling);
+    dirty |= (int)pGui->addCheckBox(mDoPowerLightSampling ? "Sample lights by power" : "Sample lights uniformly", mDoPowerLightSampling);
+    dirty |= (int)pGui->addFloatVar("Env. map sample fraction", mEnvSampleProb, 0.0f, 1.0f, 0.01f);
+
+    int32_t samplesPerPixel = int32_t(mSamplesPerPixel);
+    if (pGui->addIntVar("Samples per pixel", samplesPerPixel, 1, 65536))
+    {
+        mSamplesPerPixel = uint32_t(samplesPerPixel);
+        dirty = 1;
+    }
+    if (dirty) setRefreshFlag();
+
+    pGui->addText((std::string("Last frame: ") + std::to_string(mLastFrameTime) + " ms").c_str());
+}
+
+bool CpuDiffuseGIPass::setOption(const std::string& name, const std::string& value)
+{
+    if (name == "directShadows")   return parseOption(value, mDoDirectShadows);
+    if (name == "indirectGI")      return parseOption(value, mDoIndirectGI);
+    if (name == "cosineSampling")  return parseOption(value, mDoCosSampling);
+    if (name == "powerLightSampling") return parseOption(value, mDoPowerLightSampling);
+    if (name == "envMapSampleProb") return parseOption(value, mEnvSampleProb);
+    if (name == "samplesPerPixel") return parseOption(value, mSamplesPerPixel) && mSamplesPerPixel > 0;
+    if (name == "maxThreads")      return parseOption(value, mMaxThreads);
+    if (name == "seed")            return parseOption(value, mFrameCount);
+    return false;
+}
+
+const CpuDiffuseGIPass::CpuTexture* CpuDiffuseGIPass::getCpuTexture(RenderContext* pRenderContext, const Texture::SharedPtr& pTexture)
+{
+    if (!pTexture) return nullptr;
+    auto it = mTextures.find(pTexture.get());
+    if (it != mTextures.end()) return &it->second;
+
+    // Read the largest mip which isn't larger than kMaxTextureSize
+    CpuTexture& texture = mTextures[pTexture.get()];
+    uint32_t mip = 0;
+    while (mip + 1 < pTexture->getMipCount() && std::max(pTexture->getWidth(mip), pTexture->getHeight(mip)) > kMaxTextureSize) mip++;
+    const uvec2 size = uvec2(pTexture->getWidth(mip), pTexture->getHeight(mip));
+    if (decodeTexels(pTexture->getFormat(), pRenderContext->readTextureSubresource(pTexture.get(), pTexture->getSubresourceIndex(0, mip)), size.x * size.y, texture.texels) == false)
+    {
+        logWarning("CpuDiffuseGIPass: Can't read textures of format " + to_string(pTexture->getFormat()) + " on the CPU. Using white instead.");
+        texture.texels.clear();
+        return &texture;
+    }
+    texture.size = size;
+    return &texture;
+}
+
+const CpuDiffuseGIPass::MeshAttributes& CpuDiffuseGIPass::getMeshAttributes(const Mesh* pMesh)
+{
+    auto it = mMeshAttributes.find(pMesh);
+    if (it != mMeshAttributes.end()) return it->second;
+
+    MeshAttributes& attributes = mMeshAttributes[pMesh];
+    readVertexAttribute(pMesh, VERTEX_NORMAL_LOC, decodeNormal, attributes.normals);
+    readVertexAttribute(pMesh, VERTEX_TEXCOORD_LOC, decodeTexCrd, attributes.texCrds);
+    return attributes;
+}
+
+vec4 CpuDiffuseGIPass::sampleTexture(const CpuTexture* pTexture, const vec2& texCrd, const vec4& constant)
+{
+    if (!pTexture) return constant;
+    return pTexture->texels.empty() ? vec4(1.0f) : sampleBilinear(pTexture->texels, pTexture->size, texCrd);
+}
+
+void CpuDiffuseGIPass::updateSceneData(RenderContext* pRenderContext)
+{
+    mpBvh->update();
+
+    // Gather what getSurface() needs for each instance, like prepareShadingData() reads it from the material and the vertices
+    bool anyAlphaTested = false;
+    mInstances.resize(mpBvh->getInstanceCount());
+    for (uint32_t i = 0; i < mpBvh->getInstanceCount(); i++)
+    {
+        const SceneBvh::Instance& instance = mpBvh->getInstance(i);
+        const Model* pModel = mpScene->getModel(instance.modelId).get();
+        const Mesh* pMesh = pModel->getMesh(instance.meshId).get();
+        const Material* pMaterial = pMesh->getMaterial().get();
+        InstanceData& data = mInstances[i];
+        data.baseColor = pMaterial->getBaseColor();
+        data.specular = pMaterial->getSpecularParams();
+        data.pBaseColorTexture = getCpuTexture(pRenderContext, pMaterial->getBaseColorTexture());
+        data.pSpecularTexture = getCpuTexture(pRenderContext, pMaterial->getSpecularTexture());
+        data.isMetalRough = (pMaterial->getShadingModel() == ShadingModelMetalRough);
+        data.isAlphaTested = (pMaterial->getAlphaMode() == AlphaModeMask);
+        data.alphaThreshold = pMaterial->getAlphaThreshold();
+        data.pAttributes = &getMeshAttributes(pMesh);
+
+        const mat4 transform = mpScene->getModelInstance(instance.modelId, instance.modelInstanceId)->getTransformMatrix() * pModel->getMeshInstance(instance.meshId, instance.meshInstanceId)->getTransformMatrix();
+        data.normalMatrix = transpose(inverse(mat3(transform)));
+        anyAlphaTested |= data.isAlphaTested;
+    }
+
+    // Skip the filter calls entirely when nothing is alpha tested
+    mAlphaTest = nullptr;
+    if (anyAlphaTested) mAlphaTest = [this](const SceneBvh::Hit& hit) { return alphaTestFails(hit) == false; };
+
+    mLights.clear();
+    for (const auto& pLight : mpScene->getLights()) mLights.push_back(pLight->getData());
+    mpLightSampler->setPowerSampling(mDoPowerLightSampling);
+    mpLightSampler->update();
+
+    mpEnvMapSampler = mpResManager->getEnvironmentMapSampler();
+
+    // Read the environment map back whenever it changes
+    Texture::SharedPtr pEnvMap = mpResManager->getTexture(ResourceManager::kEnvironmentMap);
+    if (pEnvMap.get() != mpEnvMapSource)
+    {
+        mpEnvMapSource = pEnvMap.get();
+        mEnvMap.clear();
+        mEnvMapSize = uvec2(0);
+        if (pEnvMap)
+        {
+            std::vector<vec4> texels;
+            const uint32_t texelCount = pEnvMap->getWidth() * pEnvMap->getHeight();
+            if (decodeTexels(pEnvMap->getFormat(), pRenderContext->readTextureSubresource(pEnvMap.get(), 0), texelCount, texels))
+            {
+                mEnvMapSize = uvec2(pEnvMap->getWidth(), pEnvMap->getHeight());
+                mEnvMap.resize(texelCount);
+                for (uint32_t i = 0; i < texelCount; i++) mEnvMap[i] = vec3(texels[i]);
+            }
+            else
+            {
+                logWarning("CpuDiffuseGIPass: Can't read an environment map of format " + to_string(pEnvMap->getFormat()) + " on the CPU. Using black instead.");
+            }
+        }
+    }
+}
+
+vec3 CpuDiffuseGIPass::lookupEnvironment(const vec3& direction) const
+{
+    if (mEnvMap.empty()) return vec3(0.0f);
+    vec2 uv = wsVectorToLatLong(direction);
+    uvec2 texel = min(uvec2(uv * vec2(mEnvMapSize)), mEnvMapSize - uvec2(1));
+    return mEnvMap[texel.x + texel.y * mEnvMapSize.x];
+}
+
+vec2 CpuDiffuseGIPass::getTexCrd(const SceneBvh::Hit& hit) const
+{
+    const std::vector<vec2>& texCrds = mInstances[hit.instance].pAttributes->texCrds;
+    if (texCrds.empty()) return vec2(0.0f);
+    const glm::uvec3& indices = mpBvh->getTriangleIndices(hit);
+    return texCrds[indices.x] * (1.0f - hit.barycentrics.x - hit.barycentrics.y) + texCrds[indices.y] * hit.barycentrics.x + texCrds[indices.z] * hit.barycentrics.y;
+}
+
+bool CpuDiffuseGIPass::alphaTestFails(const SceneBvh::Hit& hit) const
+{
+    // alphaTestFails() of simpleDiffuseGIUtils.hlsli
+    const InstanceData& data = mInstances[hit.instance];
+    if (data.isAlphaTested == false) return false;
+    return sampleTexture(data.pBaseColorTexture, getTexCrd(hit), data.baseColor).a < data.alphaThreshold;
+}
+
+void CpuDiffuseGIPass::getSurface(const SceneBvh::Hit& hit, SurfaceHit& surface) const
+{
+    const InstanceData& data = mInstances[hit.instance];
+    const std::vector<vec3>& normals = data.pAttributes->normals;
+    const glm::uvec3& indices = mpBvh->getTriangleIndices(hit);
+
+    // The interpolated vertex normal, as in prepareShadingData().  Meshes without normals use the geometric normal.
+    vec3 normal;
+    if (normals.empty() == false)
+    {
+        const float w = 1.0f - hit.barycentrics.x - hit.barycentrics.y;
+        normal = data.normalMatrix * (normals[indices.x] * w + normals[indices.y] * hit.barycentrics.x + normals[indices.z] * hit.barycentrics.y);
+    }
+    else
+    {
+        const TriangleBvh::Triangle& triangle = mpBvh->getTriangle(hit);
+        normal = cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0);
+    }
+    const float length = glm::length(normal);
+    normal = (length > 0) ? normal / length : vec3(0.0f, 1.0f, 0.0f);
+
+    const vec2 texCrd = getTexCrd(hit);
+    const vec3 baseColor = vec3(sampleTexture(data.pBaseColorTexture, texCrd, data.baseColor));
+    const vec4 specular = sampleTexture(data.pSpecularTexture, texCrd, data.specular);
+
+    surface.position = hit.position;
+    surface.normal = normal;
+    surface.diffuse = data.isMetalRough ? baseColor * (1.0f - specular.b) : baseColor;
+}
+
+bool CpuDiffuseGIPass::traceSurface(const vec3& origin, const vec3& direction, float minT, SurfaceHit& hit) const
+{
+    SceneBvh::Hit bvhHit;
+    if (mpBvh->raycast(origin + direction * minT, direction, FLT_MAX, bvhHit, mAlphaTest) == false) return false;
+    getSurface(bvhHit, hit);
+    return true;
+}
+
+float CpuDiffuseGIPass::sampleLight(const vec3& position, uint32_t& randSeed, vec3& toLight, vec3& intensity, float& lightPdf) const
+{
+    // Always draw the random number, so the sequence stays in step with the GPU pass.  sampleLightIndex() picks from the same table.
+    const float rand = nextRand(randSeed);
+    toLight = vec3(0.0f);
+    intensity = vec3(0.0f);
+    lightPdf = 0.0f;
+    if (mLights.empty() || mpLightSampler->getTable().getSize() != mLights.size()) return 0.0f;
+    const LightData& light = mLights[mpLightSampler->getTable().sample(rand, lightPdf)];
+
+    // evalDirectionalLight() and evalPointLight() of Lights.slang.  Other light types are evaluated as point lights, as in getLightData().
+    if (light.type == LightDirectional)
+    {
+        toLight = -normalize(light.dirW);
+        intensity = light.intensity;
+        return glm::length(light.dirW) * glm::length(position - light.posW);
+    }
+
+    vec3 L = light.posW - position;
+    const float distSquared = dot(L, L);
+    if (distSquared <= 1e-5f) return 0.0f;
+    const float distance = sqrt(distSquared);
+    L /= distance;
+
+    float falloff = 1.0f / ((0.01f * 0.01f) + distSquared);
+    const float cosTheta = -dot(L, light.dirW);
+    if (cosTheta < light.cosOpeningAngle)
+    {
+        falloff = 0;
+    }
+    else if (light.penumbraAngle > 0)
+    {
+        const float deltaAngle = light.openingAngle - acos(clamp(cosTheta, -1.0f, 1.0f));
+        falloff *= saturate((deltaAngle - light.penumbraAngle) / light.penumbraAngle);
+    }
+    toLight = L;
+    intensity = light.intensity * falloff;
+    return distance;
+}
+
+bool CpuDiffuseGIPass::isLightVisible(const vec3& position, const vec3& toLight, float minT, float distToLight) const
+{
+    if (distToLight <= minT) return true;
+    return mpBvh->isOccluded(position + toLight * minT, position + toLight * distToLight, mAlphaTest) == false;
+}
+
+void CpuDiffuseGIPass::renderTile(uint32_t tile, uint32_t width, uint32_t height, const CameraData& camera)
+{
+    const uint32_t tilesX = (width + kTileSize - 1) / kTileSize;
+    const uint32_t x0 = (tile % tilesX) * kTileSize;
+    const uint32_t y0 = (tile / tilesX) * kTileSize;
+    const uint32_t x1 = std::min(x0 + kTileSize, width);
+    const uint32_t y1 = std::min(y0 + kTileSize, height);
+
+    // Trace the primary rays of each 2x2 quad as one packet
+    for (uint32_t y = y0; y < y1; y += 2)
+    {
+        for (uint32_t x = x0; x < x1; x += 2)
+        {
+            vec3 origins[TriangleBvh::kPacketSize];
+            vec3 rayDirs[TriangleBvh::kPacketSize];
+            uint32_t pixels[TriangleBvh::kPacketSize];
+            uint32_t count = 0;
+            for (uint32_t q = 0; q < 4; q++)
+            {
+                const uint32_t px = x + (q & 1);
+                const uint32_t py = y + (q >> 1);
+                if (px >= x1 || py >= y1) continue;
+
+                // Primary ray through the pixel center, as in LightProbeGBufferPass without jitter or thin lens
+                vec2 pixelCenter = (vec2(float(px), float(py)) + vec2(0.5f)) / vec2(float(width), float(height));
+                vec2 ndc = vec2(2, -2) * pixelCenter + vec2(-1, 1);
+                origins[count] = camera.posW;
+                rayDirs[count] = normalize(ndc.x * camera.cameraU + ndc.y * camera.cameraV + camera.cameraW);
+                pixels[count] = px + py * width;
+                count++;
+            }
+
+            SceneBvh::Hit hits[TriangleBvh::kPacketSize];
+            const uint32_t hitMask = mpBvh->raycastPacket(origins, rayDirs, count, FLT_MAX, hits, mAlphaTest);
+            for (uint32_t r = 0; r < count; r++)
+            {
+                shadePixel(pixels[r], rayDirs[r], (hitMask & (1u << r)) ? &hits[r] : nullptr, camera);
+            }
+        }
+    }
+}
+
+void CpuDiffuseGIPass::shadePixel(uint32_t pixel, const vec3& rayDir, const SceneBvh::Hit* pHit, const CameraData& camera)
+{
+    if (pHit == nullptr)
+    {
+        // The background is stored as the diffuse color and output as is
+        vec3 background = lookupEnvironment(rayDir);
+        mPosition[pixel] = vec4(0.0f);
+        mNormal[pixel] = vec4(0.0f);
+        mDiffuse[pixel] = vec4(background, 1.0f);
+        mOutput[pixel] = vec4(background, 1.0f);
+        return;
+    }
+
+    SurfaceHit hit;
+    getSurface(*pHit, hit);
+
+    mPosition[pixel] = vec4(hit.position, 1.0f);
+    mNormal[pixel] = vec4(hit.normal, glm::length(hit.position - camera.posW));
+    mDiffuse[pixel] = vec4(hit.diffuse, 1.0f);
+
+    // SimpleDiffuseGIRayGen(), once per sample
+    const float envSampleProb = mpEnvMapSampler ? clamp(mEnvSampleProb, 0.0f, 1.0f) : 0.0f;
+    vec3 color = vec3(0.0f);
+    for (uint32_t s = 0; s < mSamplesPerPixel; s++)
+    {
+        uint32_t randSeed = initRand(pixel, mFrameCount + s, 16);
+
+        vec3 toLight, lightIntensity;
+        float lightPdf;
+        float distToLight = sampleLight(hit.position, randSeed, toLight, lightIntensity, lightPdf);
+        float LdotN = saturate(dot(hit.normal, toLight));
+        float shadowMult = lightPdf > 0.0f ? 1.0f / lightPdf : 0.0f;
+        if (mDoDirectShadows && LdotN > 0) shadowMult *= isLightVisible(hit.position, toLight, mMinT, distToLight) ? 1.0f : 0.0f;
+        vec3 shadeColor = shadowMult * LdotN * lightIntensity * hit.diffuse / kPi;
+
+        if (mDoIndirectGI)
+        {
+            vec3 bounceDir;
+            if (envSampleProb > 0 && nextRand(randSeed) < envSampleProb)
+            {
+                // Drawn in the order of sampleEnvMapDirection(): row, column, then the position in the texel
+                vec4 u;
+                u.x = nextRand(randSeed);
+                u.y = nextRand(randSeed);
+                u.z = nextRand(randSeed);
+                u.w = nextRand(randSeed);
+                float envPdf;
+                bounceDir = mpEnvMapSampler->sample(u, envPdf);
+            }
+            else
+            {
+                bounceDir = mDoCosSampling ? getCosHemisphereSample(randSeed, hit.normal) : getUniformHemisphereSample(randSeed, hit.normal);
+            }
+            float NdotL = saturate(dot(hit.normal, bounceDir));
+            float sampleProb = mDoCosSampling ? (NdotL / kPi) : (1.0f / (2.0f * kPi));
+            if (envSampleProb > 0) sampleProb = glm::mix(sampleProb, mpEnvMapSampler->evalPdf(bounceDir), envSampleProb);
+
+            // IndirectClosestHit() and IndirectMiss().  The payload gets a copy of the seed.
+            vec3 bounceColor;
+            SurfaceHit bounceHit;
+            if (NdotL <= 0 || sampleProb <= 0)
+            {
+                bounceColor = vec3(0.0f);
+            }
+            else if (traceSurface(hit.position, bounceDir, mMinT, bounceHit))
+            {
+                uint32_t bounceSeed = randSeed;
+                float bounceDistToLight = sampleLight(bounceHit.position, bounceSeed, toLight, lightIntensity, lightPdf);
+                float bounceLdotN = saturate(dot(bounceHit.normal, toLight));
+                float bounceShadowMult = (lightPdf > 0.0f && bounceLdotN > 0 && isLightVisible(bounceHit.position, toLight, mMinT, bounceDistToLight)) ? 1.0f / lightPdf : 0.0f;
+                bounceColor = bounceShadowMult * bounceLdotN * lightIntensity * bounceHit.diffuse / kPi;
+            }
+            else
+            {
+                bounceColor = lookupEnvironment(bounceDir);
+            }
+
+            if (sampleProb > 0) shadeColor += (NdotL * bounceColor * hit.diffuse / kPi) / sampleProb;
+        }
+        color += shadeColor;
+    }
+    mOutput[pixel] = vec4(color / float(mSamplesPerPixel), 1.0f);
+}
+
+void CpuDiffuseGIPass::upload(RenderContext* pRenderContext, const std::string& channel, const std::vector<vec4>& data)
+{
+    Texture::SharedPtr pTexture = mpResManager->getTexture(channel);
+    if (!pTexture) return;
+
+    if (pTexture->getFormat() == ResourceFormat::RGBA32Float)
+    {
+        pRenderContext->updateTextureData(pTexture.get(), data.data());
+    }
+    else if (pTexture->getFormat() == ResourceFormat::RGBA16Float)
+    {
+        std::vector<uint16_t> halfs(data.size() * 4);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            for (uint32_t c = 0; c < 4; c++) halfs[i * 4 + c] = glm::packHalf1x16(data[i][c]);
+        }
+        pRenderContext->updateTextureData(pTexture.get(), halfs.data());
+    }
+    else
+    {
+        logWarning("CpuDiffuseGIPass: Can't write channel '" + channel + "' of format " + to_string(pTexture->getFormat()) + ".");
+    }
+}
+
+void CpuDiffuseGIPass::execute(RenderContext* pRenderContext)
+{
+    if (!mpBvh || !mpScene->getActiveCamera()) return;
+
+    // The channels must all have the screen's size, since they are uploaded as a whole
+    const uint32_t width = mpResManager->getWidth();
+    const uint32_t height = mpResManager->getHeight();
+    const uint32_t pixelCount = width * height;
+    mPosition.resize(pixelCount);
+    mNormal.resize(pixelCount);
+    mDiffuse.resize(pixelCount);
+    mOutput.resize(pixelCount);
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    updateSceneData(pRenderContext);
+    mMinT = mpResManager->getMinTDist();
+    const CameraData& camera = mpScene->getActiveCamera()->getData();
+
+    const uint32_t tileCount = ((width + kTileSize - 1) / kTileSize) * ((height + kTileSize - 1) / kTileSize);
+    parallelFor(tileCount, [&](uint32_t tile) { renderTile(tile, width, height, camera); }, mMaxThreads);
+    mFrameCount += mSamplesPerPixel;
+    mLastFrameTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    upload(pRenderContext, "WorldPosition", mPosition);
+    upload(pRenderContext, "WorldNormal", mNormal);
+    upload(pRenderContext, "MaterialDiffuse", mDiffuse);
+    upload(pRenderContext, ResourceManager::kOutputChannel, mOutput);
+}
@@ -0,0 +1,149 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// A CPU version of the G-buffer and SimpleDiffuseGIPass, for generating denoiser training and regression data on machines
+//     without a ray tracing GPU.  It traces the same rays as LightProbeGBufferPass + SimpleDiffuseGIPass (primary hits through
+//     pixel centers, one shadow ray to a random light, one diffuse bounce with an environment lookup on a miss) with the same
+//     random number generator, and writes the WorldPosition, WorldNormal, MaterialDiffuse and output channels BMFR consumes.
+//     Like the GPU pass, part of the bounces are drawn from the environment map's luminance (see EnvMapSampler).
+//
+//     Rays are traced against a SceneBvh in 16x16 tiles, spread over all cores.  The primary rays of each 2x2 quad are traced
+//     together as a packet; the shadow rays and bounces are too incoherent for packets and are traced one by one.  Each pixel's
+//     random sequence depends only on the pixel and the frame, so a frame renders the same regardless of the thread count.
+//     Set "samplesPerPixel" to average more samples in one frame, e.g. 1 for the noisy inputs and 4096 for references.
+//
+//     Hits are shaded from the interpolated vertex normals and texture coordinates, and alpha-masked materials are alpha
+//     tested on every ray, as in the GPU passes.  Differences from the GPU passes, due to what the CPU can read back:
+//         - Textures are read back once, at their largest mip up to 1024x1024, and sampled bilinearly without mip selection
+//         - Textures in formats decodeTexels() doesn't support, e.g. block-compressed ones, are treated as white
+//         - There are no normal maps and no back-face culling of the primary rays
+
+#pragma once
+#include "../SharedUtils/RenderPass.h"
+#include "Graphics/Scene/SceneBvh.h"
+#include "Graphics/LightSampler.h"
+
+class CpuDiffuseGIPass : public ::RenderPass, inherit_shared_from_this<::RenderPass, CpuDiffuseGIPass>
+{
+public:
+    using SharedPtr = std::shared_ptr<CpuDiffuseGIPass>;
+    using SharedConstPtr = std::shared_ptr<const CpuDiffuseGIPass>;
+
+    static SharedPtr create() { return SharedPtr(new CpuDiffuseGIPass()); }
+    virtual ~CpuDiffuseGIPass() = default;
+
+protected:
+    CpuDiffuseGIPass() : ::RenderPass("CPU Diffuse GI", "CPU Diffuse GI Options") {}
+
+    // Implementation of RenderPass interface
+    bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+    bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager, uint width, uint height) override;
+    void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
+    void execute(RenderContext* pRenderContext) override;
+    void renderGui(Gui* pGui) override;
+    bool setOption(const std::string& name, const std::string& value) override;
+
+    // Override some functions that provide information to the RenderPipeline class
+    bool requiresScene() override { return true; }
+    bool usesEnvironmentMap() override { return true; }
+
+private:
+    // The shading data at a ray hit
+    struct SurfaceHit
+    {
+        vec3 position;
+        vec3 normal;
+        vec3 diffuse;
+    };
+
+    // A texture read back to the CPU
+    struct CpuTexture
+    {
+        uvec2 size = uvec2(0);
+        std::vector<vec4> texels;       ///< Empty if the texture couldn't be decoded
+    };
+
+    // The vertex attributes of a mesh, indexed like its vertices.  Empty if the mesh has none.
+    struct MeshAttributes
+    {
+        std::vector<vec3> normals;
+        std::vector<vec2> texCrds;
+    };
+
+    // The material and transform of a SceneBvh instance
+    struct InstanceData
+    {
+        vec4 baseColor;
+        vec4 specular;
+        const CpuTexture* pBaseColorTexture = nullptr;
+        const CpuTexture* pSpecularTexture = nullptr;
+        bool isMetalRough = false;
+        bool isAlphaTested = false;
+        float alphaThreshold = 0.0f;
+        const MeshAttributes* pAttributes = nullptr;
+        mat3 normalMatrix;              ///< Transforms mesh-space normals to world space
+    };
+
+    void updateSceneData(RenderContext* pRenderContext);
+    const CpuTexture* getCpuTexture(RenderContext* pRenderContext, const Texture::SharedPtr& pTexture);
+    const MeshAttributes& getMeshAttributes(const Mesh* pMesh);
+    static vec4 sampleTexture(const CpuTexture* pTexture, const vec2& texCrd, const vec4& constant);
+    vec2 getTexCrd(const SceneBvh::Hit& hit) const;
+    bool alphaTestFails(const SceneBvh::Hit& hit) const;
+    void getSurface(const SceneBvh::Hit& hit, SurfaceHit& surface) const;
+    void renderTile(uint32_t tile, uint32_t width, uint32_t height, const CameraData& camera);
+    void shadePixel(uint32_t pixel, const vec3& rayDir, const SceneBvh::Hit* pHit, const CameraData& camera);
+    bool traceSurface(const vec3& origin, const vec3& direction, float minT, SurfaceHit& hit) const;
+    float sampleLight(const vec3& position, uint32_t& randSeed, vec3& toLight, vec3& intensity, float& lightPdf) const;
+    bool isLightVisible(const vec3& position, const vec3& toLight, float minT, float distToLight) const;
+    vec3 lookupEnvironment(const vec3& direction) const;
+    void upload(RenderContext* pRenderContext, const std::string& channel, const std::vector<vec4>& data);
+
+    Scene::SharedPtr                        mpScene;
+    SceneBvh::SharedPtr                     mpBvh;
+    LightSampler::SharedPtr                 mpLightSampler;
+    EnvMapSampler::SharedPtr                mpEnvMapSampler;        ///< The resource manager's, for the current environment map
+
+    // Scene data copied to the CPU
+    std::vector<InstanceData>               mInstances;             ///< Indexed like the SceneBvh instances
+    std::vector<LightData>                  mLights;
+    std::unordered_map<const Texture*, CpuTexture> mTextures;
+    std::unordered_map<const Mesh*, MeshAttributes> mMeshAttributes;
+    SceneBvh::HitFilter                     mAlphaTest;             ///< Ignores the hits which fail alphaTestFails()
+    const Texture*                          mpEnvMapSource = nullptr;
+    std::vector<vec3>                       mEnvMap;
+    uvec2                                   mEnvMapSize = uvec2(0);
+
+    // The frame being rendered
+    std::vector<vec4>                       mPosition;
+    std::vector<vec4>                       mNormal;
+    std::vector<vec4>                       mDiffuse;
+    std::vector<vec4>                       mOutput;
+    float                                   mMinT = 0.0f;
+
+    // Options, named after the ones of SimpleDiffuseGIPass
+    bool                                    mDoIndirectGI = true;
+    bool                                    mDoCosSampling = true;
+    bool                                    mDoDirectShadows = true;
+    bool                                    mDoPowerLightSampling = true;
+    float                                   mEnvSampleProb = 0.5f;  ///< Fraction of indirect rays sampled from the environment map's luminance
+    uint32_t                                mSamplesPerPixel = 1;
+    uint32_t                                mMaxThreads = 0;        ///< 0 uses all cores
+    uint32_t                                mFrameCount = 0x1337u;  ///< Seeds the random numbers.  Advances by the sample count every frame.
+    double                                  mLastFrameTime = 0.0;   ///< In ms
+};
@@ -144,6 +144,15 @@ void BlockwiseMultiOrderFeatureRegression::renderGui(Gui* pGui)
 	if (dirty) setRefreshFlag();
 }
 
+bool BlockwiseMultiOrderFeatureRegression::setOption(const std::string& name, const std::string& value)
+{
+	if (name == "denoise")        return parseOption(value, mDoDenoise);
+	if (name == "preprocess")     return parseOption(value, mBMFR_preprocess);
+	if (name == "regression")     return parseOption(value, mBMFR_regression);
+	if (name == "postprocess")    return parseOption(value, mBMFR_postprocess);
+	if (name == "removeFeatures") return parseOption(value, mBMFR_removeFeatures);
+	return false;
+}
 
 void BlockwiseMultiOrderFeatureRegression::execute(RenderContext* pRenderContext)
 {
@@ -174,6 +183,7 @@ void BlockwiseMultiOrderFeatureRegression::execute(RenderContext* pRenderContext
 
 	// Peform pre process
 	if (mBMFR_preprocess) {
+		PROFILE(BMFR_Preprocess);
 		accumulate_noisy_data(pRenderContext);
 	}
 	
@@ -184,10 +194,12 @@ void BlockwiseMultiOrderFeatureRegression::execute(RenderContext* pRenderContext
 	// The core of the algorithm
 	// BMFR happens here!
 	if (mBMFR_regression) {
+		PROFILE(BMFR_Regression);
 		fit_noisy_color(pRenderContext);
 	}
 	// Peform post process
 	if (mBMFR_postprocess) {
+		PROFILE(BMFR_Postprocess);
 		accumulate_filtered_data(pRenderContext);
 
 		pRenderContext->blit(mInputTex.accumulated_frame->getSRV(), mInputTex.curNoisy->getRTV()); // only curNoisy will be diaplayed
@@ -23,6 +23,7 @@ protected:
     void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
     void execute(RenderContext* pRenderContext) override;
     void renderGui(Gui* pGui) override;
+    bool setOption(const std::string& name, const std::string& value) override;
     void resize(uint32_t width, uint32_t height) override;
 
     // Override some functions that provide information to the RenderPipeline class
@@ -77,6 +77,7 @@ void SimpleDiffuseGIPass::initScene(RenderContext* pRenderContext, Scene::Shared
 	// Stash a copy of the scene and pass it to our ray tracer (if initialized)
     mpScene = std::dynamic_pointer_cast<RtScene>(pScene);
 	if (mpRays) mpRays->setScene(mpScene);
+	mpLightSampler = mpScene ? LightSampler::create(mpScene, mDoPowerLightSampling) : nullptr;
 }
 
 void SimpleDiffuseGIPass::renderGui(Gui* pGui)
@@ -87,11 +88,22 @@ void SimpleDiffuseGIPass::renderGui(Gui* pGui)
 	dirty |= (int)pGui->addCheckBox(mDoIndirectGI ? "Shooting global illumination rays" : "Skipping global illumination", 
 		                            mDoIndirectGI);
 	dirty |= (int)pGui->addCheckBox(mDoCosSampling ? "Use cosine sampling" : "Use uniform sampling", mDoCosSampling);
+	dirty |= (int)pGui->addCheckBox(mDoPowerLightSampling ? "Sample lights by power" : "Sample lights uniformly", mDoPowerLightSampling);
+	dirty |= (int)pGui->addFloatVar("Env. map sample fraction", mEnvSampleProb, 0.0f, 1.0f, 0.01f);
 	if (dirty) setRefreshFlag();
 
     pGui->addDropdown("Displayed", mDisplayableBuffers, mSelectedBuffer);
 }
 
+bool SimpleDiffuseGIPass::setOption(const std::string& name, const std::string& value)
+{
+	if (name == "directShadows")  return parseOption(value, mDoDirectShadows);
+	if (name == "indirectGI")     return parseOption(value, mDoIndirectGI);
+	if (name == "cosineSampling") return parseOption(value, mDoCosSampling);
+	if (name == "powerLightSampling") return parseOption(value, mDoPowerLightSampling);
+	if (name == "envMapSampleProb") return parseOption(value, mEnvSampleProb);
+	return false;
+}
 
 void SimpleDiffuseGIPass::execute(RenderContext* pRenderContext)
 {
@@ -119,6 +131,28 @@ void SimpleDiffuseGIPass::execute(RenderContext* pRenderContext)
         rayGenVars["gDiffuseMatl"] = mpResManager->getTexture("MaterialDiffuse");
         rayGenVars["gOutput"] = pDstTex;
 
+        // Pass the light selection table down to the shaders, rebuilt if the lights' power changed
+        if (mpLightSampler)
+        {
+            mpLightSampler->setPowerSampling(mDoPowerLightSampling);
+            mpLightSampler->update();
+            Buffer::SharedPtr pLightTable = mpLightSampler->getBuffer();
+            auto globalVars = mpRays->getGlobalVars();
+            globalVars["gLightAliasTable"] = pLightTable;
+        }
+
+        // Pass the environment map's sampling table down, for indirect rays drawn from its luminance.  Without a table
+        //     (e.g., a map the CPU can't read), all indirect rays come from the cosine/uniform lobe.
+        EnvMapSampler::SharedPtr pEnvSampler = mpResManager->getEnvironmentMapSampler();
+        Buffer::SharedPtr pEnvTable = pEnvSampler ? pEnvSampler->getBuffer() : nullptr;
+        rayGenVars["RayGenCB"]["gEnvSampleProb"] = pEnvTable ? glm::clamp(mEnvSampleProb, 0.0f, 1.0f) : 0.0f;
+        rayGenVars["RayGenCB"]["gEnvTableSize"] = pEnvSampler ? pEnvSampler->getTableSize() : uvec2(0);
+        if (pEnvTable)
+        {
+            auto globalVars = mpRays->getGlobalVars();
+            globalVars["gEnvMapTable"] = pEnvTable;
+        }
+
         // Set our environment map texture for indirect rays that miss geometry 
         auto missVars = mpRays->getMissVars(1);       // Remember, indirect rays are ray type #1
         missVars["gEnvMap"] = mpResManager->getTexture(ResourceManager::kEnvironmentMap);
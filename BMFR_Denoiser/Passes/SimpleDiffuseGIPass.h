@@ -23,6 +23,7 @@
 #pragma once
 #include "../SharedUtils/RenderPass.h"
 #include "../SharedUtils/RayLaunch.h"
+#include "Graphics/LightSampler.h"
 
 #define PATH_TRACE_INDEX 1029
 
@@ -44,6 +45,7 @@ protected:
     void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
     void execute(RenderContext* pRenderContext) override;
 	void renderGui(Gui* pGui) override;
+	bool setOption(const std::string& name, const std::string& value) override;
     //when we switch buffer to be used
     void pipelineUpdated(ResourceManager::SharedPtr pResManager) override;
 
@@ -55,11 +57,14 @@ protected:
     // Rendering state
 	RayLaunch::SharedPtr                    mpRays;                 ///< Our wrapper around a DX Raytracing pass
     RtScene::SharedPtr                      mpScene;                ///< Our scene file (passed in from app)  
+    LightSampler::SharedPtr                 mpLightSampler;         ///< Picks the light each shading point samples
 
 	// Recursive ray tracing can be slow.  Add a toggle to disable, to allow you to manipulate the scene
 	bool                                    mDoIndirectGI = true;
 	bool                                    mDoCosSampling = true;
 	bool                                    mDoDirectShadows = true;
+	bool                                    mDoPowerLightSampling = true;   ///< Pick lights in proportion to their power rather than uniformly
+	float                                   mEnvSampleProb = 0.5f;          ///< Fraction of indirect rays sampled from the environment map's luminance
     
 	// Various internal parameters
 	uint32_t                                mFrameCount = 0x1337u;  ///< A frame counter to vary random numbers over time
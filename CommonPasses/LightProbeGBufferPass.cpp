@@ -103,6 +103,17 @@ void LightProbeGBufferPass::renderGui(Gui* pGui)
 	if (dirty) setRefreshFlag();
 }
 
+bool LightProbeGBufferPass::setOption(const std::string& name, const std::string& value)
+{
+	if (name == "thinLens")     return parseOption(value, mUseThinLens);
+	if (name == "fStop")        return parseOption(value, mFStop);
+	if (name == "focalLength")  return parseOption(value, mFocalLength);
+	if (name == "jitter")       return parseOption(value, mUseJitter);
+	if (name == "randomJitter") return parseOption(value, mUseRandomJitter);
+	if (name == "lightProbe")   return parseOption(value, mUseLightProbe);
+	return false;
+}
+
 void LightProbeGBufferPass::execute(RenderContext* pRenderContext)
 {
 	// Check that we're ready to render
@@ -39,6 +39,7 @@ protected:
     bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager, uint width, uint height) override;
     void execute(RenderContext* pRenderContext) override;
 	void renderGui(Gui* pGui) override;
+	bool setOption(const std::string& name, const std::string& value) override;
 	void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
 
 	// Override some functions that provide information to the RenderPipeline class
@@ -180,7 +180,9 @@ namespace Falcor
 
         //Get buffer data
         std::vector<uint8> result;
-        uint32_t actualRowSize = footprint.Footprint.Width * getFormatBytesPerBlock(mTextureFormat);
+        // Rows of block-compressed formats are rows of blocks
+        uint32_t widthRatio = getFormatWidthCompressionRatio(mTextureFormat);
+        uint32_t actualRowSize = ((footprint.Footprint.Width + widthRatio - 1) / widthRatio) * getFormatBytesPerBlock(mTextureFormat);
         result.resize(mRowCount * actualRowSize);
         uint8* pData = reinterpret_cast<uint8*>(mpBuffer->map(Buffer::MapType::Read));
 
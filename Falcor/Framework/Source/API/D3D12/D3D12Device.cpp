@@ -337,4 +337,20 @@ namespace Falcor
     {
         return _ENABLE_NVAPI;
     }
+
+    bool Device::getGpuClockCalibration(uint64_t& gpuTimestamp, CpuTimer::TimePoint& cpuTime) const
+    {
+        uint64_t cpuTicks;
+        LARGE_INTEGER freq;
+        if (FAILED(mpRenderContext->getLowLevelData()->getCommandQueue()->GetClockCalibration(&gpuTimestamp, &cpuTicks)) || !QueryPerformanceFrequency(&freq))
+        {
+            return false;
+        }
+
+        // The CPU value is a QPC tick. MSVC's high_resolution_clock is QPC based, convert the same way it does to avoid overflow.
+        const uint64_t qpcFreq = (uint64_t)freq.QuadPart;
+        const uint64_t ns = (cpuTicks / qpcFreq) * 1000000000ull + (cpuTicks % qpcFreq) * 1000000000ull / qpcFreq;
+        cpuTime = CpuTimer::TimePoint(std::chrono::duration_cast<CpuTimer::TimePoint::duration>(std::chrono::nanoseconds(ns)));
+        return true;
+    }
 }
\ No newline at end of file
@@ -33,6 +33,7 @@
 #include "API/LowLevel/DescriptorPool.h"
 #include "API/LowLevel/ResourceAllocator.h"
 #include "API/QueryHeap.h"
+#include "Utils/CpuTimer.h"
 
 namespace Falcor
 {
@@ -152,6 +153,11 @@ namespace Falcor
         void releaseResource(ApiObjectHandle pResource);
         double getGpuTimestampFrequency() const { return mGpuTimestampFrequency; } // ms/tick
 
+        /** Sample the GPU timestamp counter of the direct queue and the CPU clock at the same moment, to place GPU timestamps on the CPU timeline.
+            \return false if the API doesn't support clock calibration.
+        */
+        bool getGpuClockCalibration(uint64_t& gpuTimestamp, CpuTimer::TimePoint& cpuTime) const;
+
         // This was originally a workaround for an issue found with AMD GPUs/Drivers so it is not a part of isFeatureSupported
         bool isRgb32FloatSupported() const { return mRgb32FloatSupported; }
 
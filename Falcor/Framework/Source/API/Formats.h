@@ -57,6 +57,7 @@ namespace Falcor
         RGB10A2Unorm,
         RGB10A2Uint,
         RGBA16Unorm,
+        RGBA16Snorm,
         RGBA8UnormSrgb,
         R16Float,
         RG16Float,
@@ -96,6 +96,8 @@ namespace Falcor
             uint64_t result[2];
             apiResolve(result);
 
+            mStartTick = result[0];
+            mEndTick = result[1];
             double start = (double)result[0];
             double end = (double)result[1];
             double range = end - start;
@@ -105,4 +107,17 @@ namespace Falcor
         assert(mStatus == Status::Idle);
         return mElapsedTime;
     }
+
+    bool GpuTimer::getTimestamps(uint64_t& startTick, uint64_t& endTick)
+    {
+        if (mStatus == Status::Begin)
+        {
+            logWarning("GpuTimer::getTimestamps() was called but the GpuTimer::end() wasn't called. No data to fetch.");
+            return false;
+        }
+        getElapsedTime();
+        startTick = mStartTick;
+        endTick = mEndTick;
+        return true;
+    }
 }
@@ -65,6 +65,11 @@ namespace Falcor
         */
         double getElapsedTime();
 
+        /** Get the raw GPU timestamps of the last Begin()/End() pair, in ticks. Use Device::getGpuTimestampFrequency() to convert ticks to miliseconds. \n
+            Like getElapsedTime(), this resolves the query if needed. Returns false and logs a warning if End() wasn't called.
+        */
+        bool getTimestamps(uint64_t& startTick, uint64_t& endTick);
+
     private:
         GpuTimer();
         enum Status
@@ -79,6 +84,8 @@ namespace Falcor
         uint32_t mStart;
         uint32_t mEnd;
         double mElapsedTime;
+        uint64_t mStartTick = 0;
+        uint64_t mEndTick = 0;
         void apiBegin();
         void apiEnd();
         void apiResolve(uint64_t result[2]);
@@ -713,6 +713,12 @@ namespace Falcor
         return Falcor::isExtensionSupported(name, mpApiData->deviceExtensions);
     }
 
+    bool Device::getGpuClockCalibration(uint64_t& gpuTimestamp, CpuTimer::TimePoint& cpuTime) const
+    {
+        // Requires VK_EXT_calibrated_timestamps, which we don't enable
+        return false;
+    }
+
     ApiCommandQueueType Device::getApiCommandQueueType(LowLevelContextData::CommandQueueType type) const
     {
         return mpApiData->falcorToVulkanQueueType[(uint32_t)type];
@@ -49,6 +49,7 @@ namespace Falcor
         { ResourceFormat::RGB10A2Unorm,                  VK_FORMAT_A2R10G10B10_UNORM_PACK32 }, // VK different component order?
         { ResourceFormat::RGB10A2Uint,                   VK_FORMAT_A2R10G10B10_UINT_PACK32 }, // VK different component order?
         { ResourceFormat::RGBA16Unorm,                   VK_FORMAT_R16G16B16A16_UNORM },
+        { ResourceFormat::RGBA16Snorm,                   VK_FORMAT_R16G16B16A16_SNORM },
         { ResourceFormat::RGBA8UnormSrgb,                VK_FORMAT_R8G8B8A8_SRGB },
         { ResourceFormat::R16Float,                      VK_FORMAT_R16_SFLOAT },
         { ResourceFormat::RG16Float,                     VK_FORMAT_R16G16_SFLOAT },
@@ -392,6 +392,7 @@ namespace Falcor
 
         // Create the window
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_VISIBLE, desc.visible ? GLFW_TRUE : GLFW_FALSE);
         GLFWmonitor* mon = desc.fullScreen ? glfwGetPrimaryMonitor() : nullptr;
         GLFWwindow* pGLFWWindow = glfwCreateWindow(desc.width, desc.height, desc.title.c_str(), mon, nullptr);
 
@@ -50,6 +50,7 @@ namespace Falcor
             std::string title = "Falcor Sample";    ///< Window title
             bool resizableWindow = true;            ///< Allow the user to resize the window.
             bool acceptDropFiles = false;           ///< Allow the user to drag-and-drop files into the window
+            bool visible = true;                    ///< Set to false to keep the window hidden. The window is shown when the message loop starts
         };
 
         /** Callbacks interface to be used when creating a new object
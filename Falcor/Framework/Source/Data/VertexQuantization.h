@@ -0,0 +1,89 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#ifndef _FALCOR_VERTEX_QUANTIZATION_H_
+#define _FALCOR_VERTEX_QUANTIZATION_H_
+
+#include "HostDeviceSharedMacros.h"
+
+/*******************************************************************
+    Quantized vertex attributes. The flags of a mesh are in Mesh::getVertexQuantization() and gVertexQuantization.
+    The CPU encoders are in Graphics/Model/Loaders/VertexQuantizer.h
+*******************************************************************/
+
+#define VERTEX_QUANTIZE_POSITION    0x1     ///< Positions are RGBA16Snorm, relative to the mesh AABB. Decode with decodePosition().
+#define VERTEX_QUANTIZE_NORMAL      0x2     ///< Normals and bitangents are octahedral-encoded RG16Snorm. Decode with octDecode().
+#define VERTEX_QUANTIZE_TEXCOORD    0x4     ///< Texture coordinates are RG16Float
+
+#ifdef HOST_CODE
+#include "glm/gtx/compatibility.hpp"
+
+namespace Falcor
+{
+    using glm::float2;
+    using glm::float3;
+#endif
+
+/** Decode a unit vector from its octahedral encoding in [-1, 1]^2
+*/
+inline float3 octDecode(float2 e)
+{
+    float2 a = abs(e);
+    float3 n = float3(e.x, e.y, 1.0f - a.x - a.y);
+    float t = n.z < 0.0f ? -n.z : 0.0f;
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+/** Decode a position from its SNORM coordinates in the mesh AABB
+*/
+inline float3 decodePosition(float3 q, float3 scale, float3 offset)
+{
+    return q * scale + offset;
+}
+
+#ifdef HOST_CODE
+}
+#else
+/** Unpack two 16-bit SNORM values, low half first, the same way the input assembler fetches an RG16Snorm element
+*/
+float2 decodeSnorm2x16(uint v)
+{
+    int2 s = int2(v << 16, v) >> 16;
+    return max(float2(s) / 32767.0f, -1.0f);
+}
+
+/** Unpack two 16-bit floats, low half first
+*/
+float2 decodeHalf2x16(uint v)
+{
+    return f16tof32(uint2(v, v >> 16));
+}
+#endif
+
+#endif // _FALCOR_VERTEX_QUANTIZATION_H_
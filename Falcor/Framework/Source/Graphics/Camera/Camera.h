@@ -195,6 +195,10 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Get one of the 6 world-space frustum planes, for culling many objects at once. A point p is on the inner side of a plane when dot(vec3(plane), p) + plane.w > 0.
+        */
+        glm::vec4 getFrustumPlane(uint32_t index) const;
+
         /** Set camera data into a program's constant buffer.
             \param[in] pBuffer The constant buffer to set the parameters into.
             \param[in] varName The name of the light variable in the program.
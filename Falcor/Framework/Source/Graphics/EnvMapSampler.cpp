@@ -0,0 +1,326 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "EnvMapSampler.h"
+#include "TextureHelper.h"
+#include "API/RenderContext.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/Hasher.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Platform/OS.h"
+#include <chrono>
+#include <cstring>
+#include <emmintrin.h>
+#include <experimental/filesystem>
+
+namespace fs = std::experimental::filesystem;
+
+namespace Falcor
+{
+    bool EnvMapSampler::sCacheEnabled = true;
+    std::string EnvMapSampler::sCacheDirectory;
+    uint64_t EnvMapSampler::sCacheSizeLimit = 512ull * 1024 * 1024;
+
+    namespace
+    {
+        const uint32_t kEntryMagic = 0x4D564E45;   // 'ENVM'
+        const uint32_t kEntryVersion = 1;          // Bump whenever the table or the entry layout changes. It is part of the key.
+        const char* kEntryExtension = ".envcache";
+
+        // Infinite texels, e.g. the core of a sun, are clamped so that the sums stay finite and the texels stay the most likely ones
+        const float kMaxLuminance = 1e30f;
+
+        struct EntryHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t width;
+            uint32_t height;
+        };
+
+        /** Write the luminance of a row of RGBA texels, four texels at a time. Negative and NaN luminances become 0.
+        */
+        void computeRowLuminance(const glm::vec4* pTexels, uint32_t count, float* pLuminance)
+        {
+            const __m128 wr = _mm_set1_ps(0.2126f);
+            const __m128 wg = _mm_set1_ps(0.7152f);
+            const __m128 wb = _mm_set1_ps(0.0722f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 maxLum = _mm_set1_ps(kMaxLuminance);
+
+            uint32_t i = 0;
+            for(; i + 4 <= count; i += 4)
+            {
+                __m128 r = _mm_loadu_ps(&pTexels[i + 0].x);
+                __m128 g = _mm_loadu_ps(&pTexels[i + 1].x);
+                __m128 b = _mm_loadu_ps(&pTexels[i + 2].x);
+                __m128 a = _mm_loadu_ps(&pTexels[i + 3].x);
+                _MM_TRANSPOSE4_PS(r, g, b, a);
+                __m128 lum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, wr), _mm_mul_ps(g, wg)), _mm_mul_ps(b, wb));
+                // max() returns its second operand when the first is NaN
+                lum = _mm_min_ps(_mm_max_ps(lum, zero), maxLum);
+                _mm_storeu_ps(pLuminance + i, lum);
+            }
+            for(; i < count; i++)
+            {
+                const glm::vec4& t = pTexels[i];
+                float lum = t.r * 0.2126f + t.g * 0.7152f + t.b * 0.0722f;
+                pLuminance[i] = (lum > 0.0f) ? std::min(lum, kMaxLuminance) : 0.0f;
+            }
+        }
+
+        void removeEntry(const std::string& filename)
+        {
+            std::error_code ec;
+            fs::remove(filename, ec);
+        }
+    }
+
+    EnvMapSampler::SharedPtr EnvMapSampler::create(const std::vector<glm::vec4>& texels, uint32_t width, uint32_t height, uint32_t maxThreads)
+    {
+        if(width == 0 || height == 0 || texels.size() != (size_t)width * height) return nullptr;
+        SharedPtr pSampler = SharedPtr(new EnvMapSampler());
+        pSampler->build(texels, width, height, maxThreads);
+        return pSampler;
+    }
+
+    EnvMapSampler::SharedPtr EnvMapSampler::create(RenderContext* pContext, const Texture::SharedPtr& pEnvMap, const std::string& filename)
+    {
+        if(pEnvMap == nullptr) return nullptr;
+
+        std::string entryFilename;
+        std::string fullpath;
+        if(sCacheEnabled && filename.size() && findFileInDataDirectories(filename, fullpath))
+        {
+            entryFilename = getCacheEntryFilename(fullpath);
+        }
+        if(entryFilename.size())
+        {
+            SharedPtr pSampler = SharedPtr(new EnvMapSampler());
+            if(pSampler->load(entryFilename)) return pSampler;
+        }
+
+        const uint32_t width = pEnvMap->getWidth();
+        const uint32_t height = pEnvMap->getHeight();
+        std::vector<glm::vec4> texels;
+        if(decodeTexels(pEnvMap->getFormat(), pContext->readTextureSubresource(pEnvMap.get(), 0), width * height, texels) == false)
+        {
+            logWarning("EnvMapSampler: Can't read environment maps of format " + to_string(pEnvMap->getFormat()) + " on the CPU");
+            return nullptr;
+        }
+
+        SharedPtr pSampler = create(texels, width, height);
+        if(pSampler && entryFilename.size()) pSampler->store(entryFilename);
+        return pSampler;
+    }
+
+    void EnvMapSampler::build(const std::vector<glm::vec4>& texels, uint32_t width, uint32_t height, uint32_t maxThreads)
+    {
+        // Each table texel averages a block of map texels, keeping the aspect ratio
+        const uint32_t tableWidth = std::min(width, (uint32_t)kMaxTableWidth);
+        const uint32_t tableHeight = std::max(1u, (uint32_t)((uint64_t)height * tableWidth / width));
+        mTableSize = glm::uvec2(tableWidth, tableHeight);
+        mEntries.resize((size_t)tableWidth * tableHeight + tableHeight);
+        std::vector<float> rowWeights(tableHeight);
+
+        parallelFor(tableHeight, [&](uint32_t row)
+        {
+            const uint32_t y0 = (uint32_t)((uint64_t)row * height / tableHeight);
+            const uint32_t y1 = std::max(y0 + 1, (uint32_t)((uint64_t)(row + 1) * height / tableHeight));
+
+            // Sum the luminance of the map rows covered by this table row, then reduce the columns
+            std::vector<float> luminance(width);
+            std::vector<float> columnSums(width, 0.0f);
+            for(uint32_t y = y0; y < y1; y++)
+            {
+                computeRowLuminance(texels.data() + (size_t)y * width, width, luminance.data());
+                uint32_t x = 0;
+                for(; x + 4 <= width; x += 4)
+                {
+                    _mm_storeu_ps(&columnSums[x], _mm_add_ps(_mm_loadu_ps(&columnSums[x]), _mm_loadu_ps(&luminance[x])));
+                }
+                for(; x < width; x++) columnSums[x] += luminance[x];
+            }
+
+            // Weigh the texels by the solid angle of the row, proportional to sin(theta) at its center
+            const float sinTheta = std::sin(((float)row + 0.5f) / (float)tableHeight * (float)M_PI);
+            std::vector<float> weights(tableWidth);
+            for(uint32_t col = 0; col < tableWidth; col++)
+            {
+                const uint32_t x0 = (uint32_t)((uint64_t)col * width / tableWidth);
+                const uint32_t x1 = std::max(x0 + 1, (uint32_t)((uint64_t)(col + 1) * width / tableWidth));
+                float sum = 0.0f;
+                for(uint32_t x = x0; x < x1; x++) sum += columnSums[x];
+                weights[col] = sum / (float)((x1 - x0) * (y1 - y0)) * sinTheta;
+            }
+
+            AliasTable conditional;
+            conditional.build(weights);
+            std::memcpy(&mEntries[(size_t)row * tableWidth], conditional.getEntries().data(), tableWidth * sizeof(AliasTable::Entry));
+            rowWeights[row] = (float)conditional.getWeightSum();
+        }, maxThreads);
+
+        AliasTable marginal;
+        marginal.build(rowWeights);
+        std::memcpy(&mEntries[(size_t)tableWidth * tableHeight], marginal.getEntries().data(), tableHeight * sizeof(AliasTable::Entry));
+        mpBuffer = nullptr;
+    }
+
+    glm::vec3 EnvMapSampler::sample(const glm::vec4& u, float& pdf) const
+    {
+        const AliasTable::Entry* pMarginal = &mEntries[(size_t)mTableSize.x * mTableSize.y];
+        const uint32_t row = AliasTable::sample(pMarginal, mTableSize.y, u.x);
+        const AliasTable::Entry* pConditional = &mEntries[(size_t)row * mTableSize.x];
+        const uint32_t col = AliasTable::sample(pConditional, mTableSize.x, u.y);
+
+        // The inverse of wsVectorToLatLong()
+        const glm::vec2 uv = (glm::vec2((float)col, (float)row) + glm::vec2(u.z, u.w)) / glm::vec2(mTableSize);
+        const float phi = (2.0f * uv.x - 1.0f) * (float)M_PI;
+        const float theta = uv.y * (float)M_PI;
+        const float sinTheta = std::sin(theta);
+        const glm::vec3 dir = glm::vec3(sinTheta * std::sin(phi), std::cos(theta), -sinTheta * std::cos(phi));
+
+        pdf = (sinTheta > 0.0f) ? pMarginal[row].pdf * pConditional[col].pdf * (float)(mTableSize.x * mTableSize.y) / (2.0f * (float)(M_PI * M_PI) * sinTheta) : 0.0f;
+        return dir;
+    }
+
+    float EnvMapSampler::evalPdf(const glm::vec3& dir) const
+    {
+        const glm::vec3 p = glm::normalize(dir);
+        const float u = (1.0f + std::atan2(p.x, -p.z) / (float)M_PI) * 0.5f;
+        const float cosTheta = glm::clamp(p.y, -1.0f, 1.0f);
+        const float v = std::acos(cosTheta) / (float)M_PI;
+        const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        if(sinTheta <= 0.0f) return 0.0f;
+
+        const uint32_t col = std::min((uint32_t)(u * (float)mTableSize.x), mTableSize.x - 1);
+        const uint32_t row = std::min((uint32_t)(v * (float)mTableSize.y), mTableSize.y - 1);
+        const float pdfUV = mEntries[(size_t)mTableSize.x * mTableSize.y + row].pdf * mEntries[(size_t)row * mTableSize.x + col].pdf * (float)(mTableSize.x * mTableSize.y);
+        return pdfUV / (2.0f * (float)(M_PI * M_PI) * sinTheta);
+    }
+
+    const Buffer::SharedPtr& EnvMapSampler::getBuffer()
+    {
+        if(mpBuffer == nullptr && mEntries.size())
+        {
+            mpBuffer = Buffer::create(mEntries.size() * sizeof(AliasTable::Entry), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mEntries.data());
+        }
+        return mpBuffer;
+    }
+
+    std::string EnvMapSampler::getCacheDirectory()
+    {
+        return sCacheDirectory.empty() ? getExecutableDirectory() + "/EnvMapCache" : sCacheDirectory;
+    }
+
+    std::string EnvMapSampler::getCacheEntryFilename(const std::string& filename)
+    {
+        size_t size = 0;
+        const void* pData = mapFileForReading(filename, size);
+        if(pData == nullptr) return "";
+
+        Hasher hasher;
+        hasher.add(kEntryVersion);
+        hasher.add((uint32_t)kMaxTableWidth);
+        hasher.add(pData, size);
+        unmapFile(pData, size);
+
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hasher.get());
+        return getCacheDirectory() + '/' + key + kEntryExtension;
+    }
+
+    bool EnvMapSampler::load(const std::string& entryFilename)
+    {
+        if(doesFileExist(entryFilename) == false) return false;
+
+        bool valid = false;
+        {
+            size_t size = 0;
+            const uint8_t* pData = (const uint8_t*)mapFileForReading(entryFilename, size);
+            EntryHeader header = {};
+            if(pData && size >= sizeof(EntryHeader)) std::memcpy(&header, pData, sizeof(EntryHeader));
+
+            const uint64_t entryCount = (uint64_t)header.width * header.height + header.height;
+            if(header.magic == kEntryMagic && header.version == kEntryVersion && header.width > 0 && header.width <= kMaxTableWidth && header.height > 0
+                && size == sizeof(EntryHeader) + entryCount * sizeof(AliasTable::Entry))
+            {
+                mTableSize = glm::uvec2(header.width, header.height);
+                mEntries.resize((size_t)entryCount);
+                std::memcpy(mEntries.data(), pData + sizeof(EntryHeader), mEntries.size() * sizeof(AliasTable::Entry));
+                valid = true;
+            }
+            unmapFile(pData, size);
+        }
+
+        if(valid == false)
+        {
+            logWarning("EnvMapSampler: Removing invalid cache entry '" + entryFilename + "'");
+            removeEntry(entryFilename);
+            return false;
+        }
+
+        // Mark the entry as recently used, for eviction
+        std::error_code ec;
+        fs::last_write_time(entryFilename, fs::file_time_type::clock::now(), ec);
+        mFromCache = true;
+        return true;
+    }
+
+    bool EnvMapSampler::store(const std::string& entryFilename) const
+    {
+        std::error_code ec;
+        fs::create_directories(getDirectoryFromFile(entryFilename), ec);
+
+        // Write to a temporary file first, so that concurrent loads never see a partially written entry
+        std::string tempFilename = entryFilename + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+        {
+            BinaryFileStream stream(tempFilename, BinaryFileStream::Mode::Write);
+            EntryHeader header = { kEntryMagic, kEntryVersion, mTableSize.x, mTableSize.y };
+            stream << header;
+            stream.write(mEntries.data(), mEntries.size() * sizeof(AliasTable::Entry));
+            if(stream.isFail())
+            {
+                stream.remove();
+                logWarning("EnvMapSampler: Can't write cache entry '" + entryFilename + "'");
+                return false;
+            }
+        }
+
+        fs::rename(tempFilename, entryFilename, ec);
+        if(ec)
+        {
+            removeEntry(tempFilename);
+            logWarning("EnvMapSampler: Can't write cache entry '" + entryFilename + "'");
+            return false;
+        }
+
+        evictLeastRecentlyUsedFiles(getDirectoryFromFile(entryFilename), kEntryExtension, sCacheSizeLimit, entryFilename);
+        return true;
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "API/Texture.h"
+#include "API/Buffer.h"
+#include "Utils/Math/AliasTable.h"
+
+namespace Falcor
+{
+    class RenderContext;
+
+    /** Importance samples a lat-long environment map in proportion to its luminance.
+        The map is reduced to a table of at most kMaxTableWidth columns. Each table texel is weighted by its average luminance times sin(theta),
+        the solid angle it covers. The rows are sampled with a marginal alias table, and the column within the row with a conditional alias table,
+        so that a direction costs two table lookups and four uniform numbers. The table is built on all cores, with SSE for the luminance.
+        Tables of environment maps loaded from a file are cached on disk, keyed by a hash of the file's content. The least recently used tables are evicted beyond getCacheSizeLimit().
+        Directions use the mapping of wsVectorToLatLong() in the shaders: u = (1 + atan2(x, -z) / pi) / 2 and v = acos(y) / pi, with v = 0 on the first row.
+    */
+    class EnvMapSampler
+    {
+    public:
+        using SharedPtr = std::shared_ptr<EnvMapSampler>;
+
+        /** The maximum width of the table. Larger maps are downsampled, the height keeps the map's aspect ratio.
+        */
+        static const uint32_t kMaxTableWidth = 1024;
+
+        /** Build the table from texels in memory
+            \param[in] texels Linear RGB texels of the map, row by row. The alpha channel is ignored.
+            \param[in] width Width of the map
+            \param[in] height Height of the map
+            \param[in] maxThreads Maximum number of threads building the table. 0 uses all cores.
+            \return A new object, or nullptr if the texel count doesn't match the size
+        */
+        static SharedPtr create(const std::vector<glm::vec4>& texels, uint32_t width, uint32_t height, uint32_t maxThreads = 0);
+
+        /** Build the table of an environment map texture, or load it from the cache
+            \param[in] pContext Used to read the texture back
+            \param[in] pEnvMap The environment map. Its first mip is used.
+            \param[in] filename The file the map was loaded from, to look the table up in the cache. Leave empty for maps that weren't loaded from a file.
+            \return A new object, or nullptr if the texture's format can't be read on the CPU
+        */
+        static SharedPtr create(RenderContext* pContext, const Texture::SharedPtr& pEnvMap, const std::string& filename = "");
+
+        /** Sample a direction
+            \param[in] u Four uniform numbers in [0, 1). x picks the row, y the column, and zw the position inside the table texel.
+            \param[out] pdf The solid angle pdf of the direction
+            \return A normalized direction
+        */
+        glm::vec3 sample(const glm::vec4& u, float& pdf) const;
+
+        /** Get the solid angle pdf of sampling a direction
+        */
+        float evalPdf(const glm::vec3& dir) const;
+
+        /** Size of the table, in texels
+        */
+        glm::uvec2 getTableSize() const { return mTableSize; }
+
+        /** The conditional tables, tableSize.x entries per row, followed by the marginal table of tableSize.y entries
+        */
+        const std::vector<AliasTable::Entry>& getEntries() const { return mEntries; }
+
+        /** Get the table on the GPU, as a raw buffer of AliasTable::Entry elements in the order of getEntries()
+        */
+        const Buffer::SharedPtr& getBuffer();
+
+        /** Whether the table was loaded from the cache
+        */
+        bool isFromCache() const { return mFromCache; }
+
+        /** Enable or disable the disk cache. Enabled by default.
+        */
+        static void setCacheEnabled(bool enabled) { sCacheEnabled = enabled; }
+        static bool isCacheEnabled() { return sCacheEnabled; }
+
+        /** Set the directory holding the cached tables. Defaults to 'EnvMapCache' next to the executable.
+        */
+        static void setCacheDirectory(const std::string& directory) { sCacheDirectory = directory; }
+        static std::string getCacheDirectory();
+
+        /** Set the maximum size of the disk cache in bytes. Defaults to 512MB. When a new table is stored, the least recently used ones are removed until the cache fits.
+        */
+        static void setCacheSizeLimit(uint64_t bytes) { sCacheSizeLimit = bytes; }
+        static uint64_t getCacheSizeLimit() { return sCacheSizeLimit; }
+
+        /** Get the cache entry filename for an environment map file
+            \return The entry's full path, or an empty string if the file can't be read
+        */
+        static std::string getCacheEntryFilename(const std::string& filename);
+
+    private:
+        EnvMapSampler() = default;
+        void build(const std::vector<glm::vec4>& texels, uint32_t width, uint32_t height, uint32_t maxThreads);
+        bool load(const std::string& entryFilename);
+        bool store(const std::string& entryFilename) const;
+
+        glm::uvec2 mTableSize = glm::uvec2(0);
+        std::vector<AliasTable::Entry> mEntries;
+        Buffer::SharedPtr mpBuffer;
+        bool mFromCache = false;
+
+        static bool sCacheEnabled;
+        static std::string sCacheDirectory;
+        static uint64_t sCacheSizeLimit;
+    };
+}
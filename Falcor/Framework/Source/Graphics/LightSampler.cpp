@@ -0,0 +1,104 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LightSampler.h"
+
+namespace Falcor
+{
+    LightSampler::SharedPtr LightSampler::create(const Scene::SharedPtr& pScene, bool powerSampling)
+    {
+        SharedPtr pSampler = SharedPtr(new LightSampler(pScene, powerSampling));
+        pSampler->update();
+        return pSampler;
+    }
+
+    float LightSampler::estimatePower(const LightData& light, float sceneRadius)
+    {
+        const float intensity = luminance(light.intensity);
+        switch (light.type)
+        {
+        case LightDirectional:
+            return intensity * (float)M_PI * sceneRadius * sceneRadius;
+        case LightPoint:
+            // Radiant intensity over the solid angle of the spot's cone
+            return intensity * 2.0f * (float)M_PI * (1.0f - glm::clamp(light.cosOpeningAngle, -1.0f, 1.0f));
+        default:
+            // Area lights are Lambertian emitters
+            return intensity * (float)M_PI * light.surfaceArea;
+        }
+    }
+
+    void LightSampler::setPowerSampling(bool enabled)
+    {
+        if (mPowerSampling == enabled) return;
+        mPowerSampling = enabled;
+        mWeights.clear();
+        update();
+    }
+
+    bool LightSampler::update()
+    {
+        const auto& lights = mpScene->getLights();
+        const float sceneRadius = mpScene->getRadius();
+        std::vector<float> weights(lights.size(), 1.0f);
+        if (mPowerSampling)
+        {
+            for (size_t i = 0; i < lights.size(); i++) weights[i] = estimatePower(lights[i]->getData(), sceneRadius);
+        }
+
+        if (weights == mWeights && mTable.getSize() == weights.size()) return false;
+        mWeights = std::move(weights);
+        mTable.build(mWeights);
+        mBufferDirty = true;
+        mBuildCount++;
+        return true;
+    }
+
+    const Buffer::SharedPtr& LightSampler::getBuffer()
+    {
+        if (mBufferDirty)
+        {
+            mBufferDirty = false;
+            const auto& entries = mTable.getEntries();
+            const size_t size = entries.size() * sizeof(AliasTable::Entry);
+            if (size == 0)
+            {
+                mpBuffer = nullptr;
+            }
+            else if (mpBuffer && mpBuffer->getSize() == size)
+            {
+                mpBuffer->updateData(entries.data(), 0, size);
+            }
+            else
+            {
+                mpBuffer = Buffer::create(size, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, entries.data());
+            }
+        }
+        return mpBuffer;
+    }
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Graphics/Scene/Scene.h"
+#include "Utils/Math/AliasTable.h"
+
+namespace Falcor
+{
+    /** Picks the light a shading point samples, in proportion to the power the lights emit, so that shadow rays go where most of the light comes from.
+        update() estimates the power of the scene's lights and rebuilds the alias table only when it changed. Moving lights doesn't change their power,
+        so animated lights don't cause rebuilds. The table is uploaded to a raw buffer of AliasTable::Entry elements, which the shaders sample with a
+        single random number. The sampled light's contribution must be divided by the pdf stored with it, instead of multiplied by the light count.
+    */
+    class LightSampler
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightSampler>;
+
+        /** Create a sampler for a scene's lights
+            \param[in] pScene The scene
+            \param[in] powerSampling Whether to sample in proportion to power. If false, all lights have the same probability.
+        */
+        static SharedPtr create(const Scene::SharedPtr& pScene, bool powerSampling = true);
+
+        /** Follow the changes of the scene's lights. Call after Scene::update().
+            \return Whether the table was rebuilt
+        */
+        bool update();
+
+        void setPowerSampling(bool enabled);
+        bool isPowerSampling() const { return mPowerSampling; }
+
+        /** Estimate the power a light emits, as the luminance of its intensity over the solid angle or area it emits from.
+            Directional lights have no position, they are given the power they deliver to a disk of the scene's radius.
+        */
+        static float estimatePower(const LightData& light, float sceneRadius);
+
+        const AliasTable& getTable() const { return mTable; }
+
+        /** Get the table on the GPU, uploaded if it changed since the last call. nullptr when the scene has no lights.
+        */
+        const Buffer::SharedPtr& getBuffer();
+
+        /** Number of table rebuilds since the sampler was created
+        */
+        uint32_t getBuildCount() const { return mBuildCount; }
+
+    private:
+        LightSampler(const Scene::SharedPtr& pScene, bool powerSampling) : mpScene(pScene), mPowerSampling(powerSampling) {}
+
+        Scene::SharedPtr mpScene;
+        bool mPowerSampling;
+        std::vector<float> mWeights;        ///< The weights the table was built from
+        AliasTable mTable;
+        Buffer::SharedPtr mpBuffer;
+        bool mBufferDirty = true;
+        uint32_t mBuildCount = 0;
+    };
+}
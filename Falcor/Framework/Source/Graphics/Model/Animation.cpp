@@ -28,8 +28,9 @@
 #include "Framework.h"
 #include "Animation.h"
 #include "AnimationController.h"
-#include "glm/gtc/matrix_transform.hpp"
-#include "glm/gtx/transform.hpp"
+#include "Utils/ParallelFor.h"
+#include <algorithm>
+#include <emmintrin.h>
 
 namespace Falcor
 {
@@ -45,7 +46,12 @@ namespace Falcor
 
     Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mAnimationSets(animationSets), mDuration(duration), mTicksPerSecond(ticksPerSecond)
     {
-
+        for (const auto& set : mAnimationSets)
+        {
+            assert(std::is_sorted(set.translation.times.begin(), set.translation.times.end()) && set.translation.times.size() == set.translation.values.size());
+            assert(std::is_sorted(set.scaling.times.begin(), set.scaling.times.end()) && set.scaling.times.size() == set.scaling.values.size());
+            assert(std::is_sorted(set.rotation.times.begin(), set.rotation.times.end()) && set.rotation.times.size() == set.rotation.values.size());
+        }
     }
 
     Animation::Animation(const Animation& other) : mName(other.mName), mDuration(other.mDuration), mTicksPerSecond(other.mTicksPerSecond)
@@ -55,95 +61,256 @@ namespace Falcor
 
     Animation::~Animation() = default;
 
-    template<typename T>
-    uint32_t findCurrentFrame(T channel, float ticks)
+    namespace
     {
-        uint32_t curKeyID = channel.lastKeyUsed;
-        while(curKeyID < channel.keys.size() - 1)
+        // Number of channels interpolated at once
+        const uint32_t kLanes = 4;
+
+        // The last key at or before ticks, or the first key if ticks is before all keys. The hint is tried first, then the key after it.
+        uint32_t findKey(const std::vector<float>& times, float ticks, uint32_t hint)
         {
-            if(channel.keys[curKeyID + 1].time > ticks)
+            const uint32_t count = (uint32_t)times.size();
+            for (uint32_t key = hint; key < std::min(hint + 2, count); key++)
             {
-                break;
+                if (times[key] <= ticks && (key + 1 == count || times[key + 1] > ticks)) return key;
             }
-            curKeyID++;
+            const auto it = std::upper_bound(times.begin(), times.end(), ticks);
+            return (it == times.begin()) ? 0 : (uint32_t)(it - times.begin()) - 1;
         }
-        return curKeyID;
-    }
 
-    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, float ratio)
-    {
-        return start + ((end - start) * ratio);
-    }
+        // The keys to interpolate between and the interpolation ratio. The last key interpolates towards the first one across the loop.
+        struct Segment
+        {
+            uint32_t key0;
+            uint32_t key1;
+            float ratio;
+        };
 
-    glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio)
-    {
-        return glm::slerp(start, end, ratio);
-    }
+        Segment findSegment(const std::vector<float>& times, float ticks, float duration, uint32_t& hint)
+        {
+            Segment segment;
+            segment.key0 = findKey(times, ticks, hint);
+            segment.key1 = (segment.key0 + 1) % (uint32_t)times.size();
+            segment.ratio = 0;
+            hint = segment.key0;
 
-    template<typename KeyType>
-    KeyType Animation::calcCurrentKey(AnimationChannel<KeyType>& channel, float ticks, float lastUpdateTime)
-    {
-        KeyType curValue;
-        if(channel.keys.size() > 0)
+            float diff = times[segment.key1] - times[segment.key0];
+            if (diff == 0)
+            {
+                segment.key1 = segment.key0;
+            }
+            else
+            {
+                if (diff < 0) diff += duration;
+                segment.ratio = (ticks - times[segment.key0]) / diff;
+            }
+            return segment;
+        }
+
+        // The key hints of the sets evaluated together, kChannelsPerSet per set
+        const uint32_t kChannelsPerSet = 3;
+
+        // Lerp a vec3 channel of up to four sets. Lanes without keys get defaultValue.
+        void lerpChannels(const Animation::AnimationSet* pSets, uint32_t laneCount, Animation::AnimationChannel<glm::vec3> Animation::AnimationSet::* pChannel, uint32_t* pHints,
+            float ticks, float duration, const glm::vec3& defaultValue, glm::vec3* pResult)
         {
-            if(ticks < lastUpdateTime)
+            alignas(16) float start[3][kLanes];
+            alignas(16) float end[3][kLanes];
+            alignas(16) float ratio[kLanes];
+            for (uint32_t lane = 0; lane < kLanes; lane++)
             {
-                channel.lastKeyUsed = 0;
+                glm::vec3 a = defaultValue, b = defaultValue;
+                ratio[lane] = 0;
+                const Animation::AnimationChannel<glm::vec3>* pLaneChannel = (lane < laneCount) ? &(pSets[lane].*pChannel) : nullptr;
+                if (pLaneChannel && pLaneChannel->times.size() > 0)
+                {
+                    const Segment segment = findSegment(pLaneChannel->times, ticks, duration, pHints[lane * kChannelsPerSet]);
+                    a = pLaneChannel->values[segment.key0];
+                    b = pLaneChannel->values[segment.key1];
+                    ratio[lane] = segment.ratio;
+                }
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    start[c][lane] = a[c];
+                    end[c][lane] = b[c];
+                }
             }
 
-            // search for the next keyframe
-            uint32_t curKeyIndex = findCurrentFrame(channel, ticks);
-            uint32_t nextKeyIndex = (curKeyIndex + 1) % channel.keys.size();
-            const AnimationKey<KeyType>& curKey = channel.keys[curKeyIndex];
-            const AnimationKey<KeyType>& nextKey = channel.keys[nextKeyIndex];
+            // start + (end - start) * ratio
+            alignas(16) float result[3][kLanes];
+            const __m128 r = _mm_load_ps(ratio);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                const __m128 s = _mm_load_ps(start[c]);
+                _mm_store_ps(result[c], _mm_add_ps(s, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(end[c]), s), r)));
+            }
+            for (uint32_t lane = 0; lane < laneCount; lane++) pResult[lane] = glm::vec3(result[0][lane], result[1][lane], result[2][lane]);
+        }
+
+        __m128 select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
 
-            assert(ticks >= curKey.time);
-            // Interpolate between them
-            float diff = nextKey.time - curKey.time;
+        // sin(x) for x in [0, pi/2]. The Taylor polynomial is accurate to float precision on that range.
+        __m128 sinQuarterTurn(__m128 x)
+        {
+            const __m128 x2 = _mm_mul_ps(x, x);
+            __m128 p = _mm_set1_ps(-1.0f / 39916800.0f);
+            p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 362880.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 5040.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 120.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 6.0f));
+            return _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), p));
+        }
 
-            if (diff == 0)
+        // acos(x) for x in [0, 1]. Uses the asin() polynomial of the Cephes library, with acos(x) = 2 * asin(sqrt((1 - x) / 2)) above 0.5 and pi/2 - asin(x) below.
+        __m128 acosPositive(__m128 x)
+        {
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 large = _mm_cmpgt_ps(x, half);
+            const __m128 z = select(large, _mm_sqrt_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), x), half)), x);
+            const __m128 z2 = _mm_mul_ps(z, z);
+            __m128 p = _mm_set1_ps(4.2163199048e-2f);
+            p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(2.4181311049e-2f));
+            p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(4.5470025998e-2f));
+            p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(7.4953002686e-2f));
+            p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(1.6666752422e-1f));
+            const __m128 asinZ = _mm_add_ps(z, _mm_mul_ps(_mm_mul_ps(z, z2), p));
+            return select(large, _mm_add_ps(asinZ, asinZ), _mm_sub_ps(_mm_set1_ps(1.57079632679f), asinZ));
+        }
+
+        // Slerp the rotation channel of up to four sets, with the math of glm::slerp(). Lanes without keys get the identity.
+        void slerpChannels(const Animation::AnimationSet* pSets, uint32_t laneCount, uint32_t* pHints, float ticks, float duration, glm::quat* pResult)
+        {
+            alignas(16) float start[4][kLanes];
+            alignas(16) float end[4][kLanes];
+            alignas(16) float cosTheta[kLanes];
+            alignas(16) float ratio[kLanes];
+            bool ratiosInRange = true;
+            for (uint32_t lane = 0; lane < kLanes; lane++)
             {
-                curValue = curKey.value;
+                glm::quat a, b;
+                ratio[lane] = 0;
+                if (lane < laneCount && pSets[lane].rotation.times.size() > 0)
+                {
+                    const Animation::AnimationChannel<glm::quat>& channel = pSets[lane].rotation;
+                    const Segment segment = findSegment(channel.times, ticks, duration, pHints[lane * kChannelsPerSet]);
+                    a = channel.values[segment.key0];
+                    b = channel.values[segment.key1];
+                    ratio[lane] = segment.ratio;
+                    ratiosInRange = ratiosInRange && segment.ratio >= 0 && segment.ratio <= 1;
+                }
+
+                // Take the short way around the sphere
+                cosTheta[lane] = glm::dot(a, b);
+                if (cosTheta[lane] < 0)
+                {
+                    b = -b;
+                    cosTheta[lane] = -cosTheta[lane];
+                }
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    start[c][lane] = a[c];
+                    end[c][lane] = b[c];
+                }
             }
-            else
+
+            // The weights are sin((1 - ratio) * angle) / sin(angle) and sin(ratio * angle) / sin(angle). Rotations too close for sin(angle) to be accurate are lerped.
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 r = _mm_load_ps(ratio);
+            const __m128 c = _mm_min_ps(_mm_load_ps(cosTheta), one);
+            const __m128 lerp = _mm_cmpgt_ps(c, _mm_set1_ps(1 - glm::epsilon<float>()));
+            __m128 w0 = _mm_sub_ps(one, r);
+            __m128 w1 = r;
+            if (_mm_movemask_ps(lerp) != 0xf)
             {
-                if (diff < 0)
+                const __m128 angle = acosPositive(c);
+                const __m128 invSin = _mm_div_ps(one, sinQuarterTurn(angle));
+                alignas(16) float slerp0[kLanes];
+                alignas(16) float slerp1[kLanes];
+                if (ratiosInRange)
                 {
-                    diff += mDuration;
+                    _mm_store_ps(slerp0, _mm_mul_ps(sinQuarterTurn(_mm_mul_ps(w0, angle)), invSin));
+                    _mm_store_ps(slerp1, _mm_mul_ps(sinQuarterTurn(_mm_mul_ps(w1, angle)), invSin));
                 }
+                else
+                {
+                    // Extrapolating before the first key, the polynomial doesn't cover the angles
+                    for (uint32_t lane = 0; lane < kLanes; lane++)
+                    {
+                        const float laneAngle = std::acos(std::min(cosTheta[lane], 1.0f));
+                        slerp0[lane] = std::sin((1 - ratio[lane]) * laneAngle) / std::sin(laneAngle);
+                        slerp1[lane] = std::sin(ratio[lane] * laneAngle) / std::sin(laneAngle);
+                    }
+                }
+                w0 = select(lerp, w0, _mm_load_ps(slerp0));
+                w1 = select(lerp, w1, _mm_load_ps(slerp1));
+            }
+
+            alignas(16) float result[4][kLanes];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                _mm_store_ps(result[c], _mm_add_ps(_mm_mul_ps(_mm_load_ps(start[c]), w0), _mm_mul_ps(_mm_load_ps(end[c]), w1)));
+            }
+            for (uint32_t lane = 0; lane < laneCount; lane++)
+            {
+                for (uint32_t c = 0; c < 4; c++) pResult[lane][c] = result[c][lane];
+            }
+        }
 
-                float ratio = (ticks - curKey.time) / diff;
-                curValue = interpolate(curKey.value, nextKey.value, ratio);
+        // Evaluate up to four sets. pHints holds kChannelsPerSet hints per set.
+        void evaluateSets(const Animation::AnimationSet* pSets, uint32_t laneCount, uint32_t* pHints, float ticks, float duration, glm::mat4* pResult)
+        {
+            glm::vec3 translation[kLanes];
+            glm::vec3 scaling[kLanes];
+            glm::quat rotation[kLanes];
+            lerpChannels(pSets, laneCount, &Animation::AnimationSet::translation, pHints + 0, ticks, duration, glm::vec3(0), translation);
+            lerpChannels(pSets, laneCount, &Animation::AnimationSet::scaling, pHints + 1, ticks, duration, glm::vec3(1), scaling);
+            slerpChannels(pSets, laneCount, pHints + 2, ticks, duration, rotation);
+
+            // translation * rotation * scaling
+            for (uint32_t lane = 0; lane < laneCount; lane++)
+            {
+                glm::mat4 T = glm::mat4_cast(rotation[lane]);
+                T[0] *= scaling[lane].x;
+                T[1] *= scaling[lane].y;
+                T[2] *= scaling[lane].z;
+                T[3] = glm::vec4(translation[lane], 1);
+                pResult[lane] = T;
             }
-            
-            channel.lastKeyUsed = curKeyIndex;
         }
-        return curValue;
     }
 
-    void Animation::animate(double totalTime, AnimationController* pAnimationController)
+    void Animation::evaluate(double totalTime, std::vector<glm::mat4>& localTransforms, Cursor* pCursor, uint32_t maxThreads) const
     {
         // Calculate the relative time
-        float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
+        const float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
 
-        for(auto& Key : mAnimationSets)
-        {
-            glm::mat4 translation;
-            translation[3] = glm::vec4(calcCurrentKey(Key.translation, ticks, Key.lastUpdateTime), 1);
+        const uint32_t setCount = (uint32_t)mAnimationSets.size();
+        localTransforms.resize(setCount);
+        if (pCursor) pCursor->keys.resize(setCount * kChannelsPerSet, 0);
 
-            glm::mat4 scaling;
-            if (Key.scaling.keys.size() > 0)
+        // Each set animates its own bone, so the sets of very large rigs are evaluated in parallel
+        const uint32_t batchCount = (setCount + AnimationController::kBonesPerBatch - 1) / AnimationController::kBonesPerBatch;
+        parallelFor(batchCount, [&](uint32_t batch)
+        {
+            const uint32_t end = std::min(setCount, (batch + 1) * AnimationController::kBonesPerBatch);
+            for (uint32_t first = batch * AnimationController::kBonesPerBatch; first < end; first += kLanes)
             {
-                scaling = glm::scale(calcCurrentKey(Key.scaling, ticks, Key.lastUpdateTime));
+                uint32_t hints[kLanes * kChannelsPerSet] = {};
+                uint32_t* pHints = pCursor ? &pCursor->keys[first * kChannelsPerSet] : hints;
+                evaluateSets(&mAnimationSets[first], std::min(kLanes, end - first), pHints, ticks, mDuration, &localTransforms[first]);
             }
+        }, (setCount < AnimationController::kMinParallelBones) ? 1 : maxThreads);
+    }
 
-            glm::quat q = calcCurrentKey(Key.rotation, ticks, Key.lastUpdateTime);
-            glm::mat4 rotation = glm::mat4_cast(q);
-
-            Key.lastUpdateTime = ticks;
-
-            glm::mat4 T = translation * rotation * scaling;
-            pAnimationController->setBoneLocalTransform(Key.boneID, T);
+    void Animation::animate(double totalTime, AnimationController* pAnimationController)
+    {
+        evaluate(totalTime, mLocalTransforms, &mCursor);
+        for (uint32_t i = 0; i < (uint32_t)mAnimationSets.size(); i++)
+        {
+            pAnimationController->setBoneLocalTransform(mAnimationSets[i].boneID, mLocalTransforms[i]);
         }
     }
 }
@@ -40,18 +40,15 @@ namespace Falcor
         using UniquePtr = std::unique_ptr<Animation>;
         using UniqueConstPtr = std::unique_ptr<const Animation>;
 
-        template<typename T>
-        struct AnimationKey
-        {
-            T value;
-            float time;
-        };
-
+        /** The keys of one channel. The times and values are stored separately, so that the key lookup only touches the times.
+        */
         template<typename T>
         struct AnimationChannel
         {
-            std::vector<AnimationKey<T>> keys;
-            uint32_t lastKeyUsed = 0;
+            std::vector<float> times;       ///< Key times in ticks, in ascending order
+            std::vector<T> values;          ///< One value per key time
+
+            void addKey(float time, const T& value) { times.push_back(time); values.push_back(value); }
         };
 
         struct AnimationSet
@@ -60,7 +57,14 @@ namespace Falcor
             AnimationChannel<glm::vec3> translation;
             AnimationChannel<glm::vec3> scaling;
             AnimationChannel<glm::quat> rotation;
-            float lastUpdateTime = 0;
+        };
+
+        /** The keys used by the last evaluation, one per channel. Evaluating a time at or shortly after the previous one then costs O(1) per channel.
+            Without a cursor, or when the time jumps, the keys are binary searched.
+        */
+        struct Cursor
+        {
+            std::vector<uint32_t> keys;
         };
 
         static UniquePtr create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
@@ -69,6 +73,18 @@ namespace Falcor
         void animate(double totalTime, AnimationController* pAnimationController);
         const std::string& getName() const { return mName; }
 
+        /** Evaluate the local bone transforms at a time. The animation isn't modified, so any time can be evaluated from any thread, e.g. to render frames out of order.
+            The channels are evaluated four at a time with SSE. Animations of at least AnimationController::kMinParallelBones sets are evaluated in batches spread over the cores.
+            \param[in] totalTime Time in seconds. The animation loops.
+            \param[out] localTransforms The local transform of each animation set's bone, see getSetBoneID(). Resized to the number of sets.
+            \param[in,out] pCursor Optional key hints for time coherent evaluation. Updated to the keys used. A cursor must not be shared between threads.
+            \param[in] maxThreads Maximum number of threads to use. 0 uses all cores.
+        */
+        void evaluate(double totalTime, std::vector<glm::mat4>& localTransforms, Cursor* pCursor = nullptr, uint32_t maxThreads = 0) const;
+
+        uint32_t getSetCount() const { return (uint32_t)mAnimationSets.size(); }
+        uint32_t getSetBoneID(uint32_t setID) const { return mAnimationSets[setID].boneID; }
+
     private:
         Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
         Animation(const Animation& other);
@@ -79,7 +95,8 @@ namespace Falcor
 
         std::vector<AnimationSet> mAnimationSets;
 
-        template<typename _KeyType>
-        _KeyType calcCurrentKey(AnimationChannel<_KeyType>& channel, float ticks, float lastUpdateTime);
+        // State of animate()
+        Cursor mCursor;
+        std::vector<glm::mat4> mLocalTransforms;
     };
 }
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include "Model.h"
 #include <fstream>
 #include "Animation.h"
+#include "Utils/ParallelFor.h"
 #include <algorithm>
 
 namespace Falcor
@@ -111,6 +112,12 @@ namespace Falcor
             mAnimations[mActiveAnimation]->animate(currentTime, this);
         }
 
+        calculateBoneTransforms();
+    }
+
+    void AnimationController::calculateBoneTransforms()
+    {
+        // Parents come before their children, so the hierarchy is resolved in one pass
         for(uint32_t i = 0; i < mBones.size(); i++)
         {
             mBones[i].globalTransform = mBones[i].localTransform;
@@ -118,9 +125,20 @@ namespace Falcor
             {
                 mBones[i].globalTransform = mBones[mBones[i].parentID].globalTransform * mBones[i].localTransform;
             }
-            mBoneTransforms[i] = mBones[i].globalTransform * mBones[i].offset;
-            mBoneInvTransposeTransforms[i] = transpose(inverse(mBoneTransforms[i]));
         }
+
+        // The skinning matrices and their inverses are independent, which is where most of the time goes.
+        // Only very large rigs are worth spreading over the cores.
+        const uint32_t boneCount = (uint32_t)mBones.size();
+        const uint32_t batchCount = (boneCount + kBonesPerBatch - 1) / kBonesPerBatch;
+        parallelFor(batchCount, [this, boneCount](uint32_t batch)
+        {
+            for(uint32_t i = batch * kBonesPerBatch; i < std::min(boneCount, (batch + 1) * kBonesPerBatch); i++)
+            {
+                mBoneTransforms[i] = mBones[i].globalTransform * mBones[i].offset;
+                mBoneInvTransposeTransforms[i] = transpose(inverse(mBoneTransforms[i]));
+            }
+        }, (boneCount < kMinParallelBones) ? 1 : 0);
     }
 
     void AnimationController::setActiveAnimation(uint32_t id)
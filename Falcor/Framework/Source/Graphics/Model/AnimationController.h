@@ -55,6 +55,14 @@ namespace Falcor
         static const uint32_t kInvalidBoneID = -1;
         static const uint32_t kBindPoseAnimationId = -1;
 
+        /** Bones are animated in batches of this size, spread over the cores.
+        */
+        static const uint32_t kBonesPerBatch = 64;
+
+        /** Rigs with fewer bones are animated on the calling thread. Starting and joining the threads takes tens of microseconds, more than animating a few hundred bones serially.
+        */
+        static const uint32_t kMinParallelBones = 2048;
+
         static UniquePtr create(const std::vector<Bone>& bones);
         static UniquePtr create(const AnimationController& other);
         ~AnimationController();
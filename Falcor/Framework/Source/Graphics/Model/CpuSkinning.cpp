@@ -0,0 +1,112 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "CpuSkinning.h"
+#include "Utils/ParallelFor.h"
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        // The columns of a blended matrix
+        struct BlendedColumns
+        {
+            __m128 c[4];
+        };
+
+        // Sum the columns of the vertex' bones, weighted by the bone weights. Only the first columnCount columns are blended.
+        template<uint32_t columnCount>
+        BlendedColumns blendColumns(const glm::mat4* pMats, uint32_t boneCount, const glm::vec4& weights, uint32_t ids)
+        {
+            BlendedColumns result;
+            for (uint32_t c = 0; c < columnCount; c++) result.c[c] = _mm_setzero_ps();
+
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                const uint32_t id = (ids >> (8 * k)) & 0xff;
+                if (id >= boneCount) continue;
+
+                const __m128 w = _mm_set1_ps(weights[k]);
+                const float* pMat = &pMats[id][0][0];
+                for (uint32_t c = 0; c < columnCount; c++)
+                {
+                    result.c[c] = _mm_add_ps(result.c[c], _mm_mul_ps(_mm_loadu_ps(pMat + 4 * c), w));
+                }
+            }
+            return result;
+        }
+
+        // Transform a vector by the first three blended columns, adding the fourth for points
+        template<bool isPoint>
+        glm::vec3 transform(const BlendedColumns& m, const glm::vec3& v)
+        {
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.c[0], _mm_set1_ps(v.x)), _mm_mul_ps(m.c[1], _mm_set1_ps(v.y))), _mm_mul_ps(m.c[2], _mm_set1_ps(v.z)));
+            if (isPoint) r = _mm_add_ps(r, m.c[3]);
+
+            float out[4];
+            _mm_storeu_ps(out, r);
+            return glm::vec3(out[0], out[1], out[2]);
+        }
+    }
+
+    void CpuSkinning::skin(const SourceVertices& source, const glm::mat4* pBoneMats, const glm::mat4* pBoneInvTransposeMats, uint32_t boneCount, SkinnedVertices& result, uint32_t maxThreads)
+    {
+        const uint32_t vertexCount = (uint32_t)source.positions.size();
+        const bool hasNormals = !source.normals.empty();
+        const bool hasBitangents = !source.bitangents.empty();
+        assert(source.boneWeights.size() == vertexCount && source.boneIds.size() == vertexCount);
+        assert(!hasNormals || source.normals.size() == vertexCount);
+        assert(!hasBitangents || source.bitangents.size() == vertexCount);
+
+        result.positions.resize(vertexCount);
+        result.normals.resize(hasNormals ? vertexCount : 0);
+        result.bitangents.resize(hasBitangents ? vertexCount : 0);
+
+        const uint32_t batchCount = (vertexCount + kVerticesPerBatch - 1) / kVerticesPerBatch;
+        parallelFor(batchCount, [&](uint32_t batch)
+        {
+            const uint32_t end = std::min(vertexCount, (batch + 1) * kVerticesPerBatch);
+            for (uint32_t v = batch * kVerticesPerBatch; v < end; v++)
+            {
+                const glm::vec4& weights = source.boneWeights[v];
+                const uint32_t ids = source.boneIds[v];
+
+                const BlendedColumns boneMat = blendColumns<4>(pBoneMats, boneCount, weights, ids);
+                result.positions[v] = transform<true>(boneMat, source.positions[v]);
+                if (hasBitangents) result.bitangents[v] = transform<false>(boneMat, source.bitangents[v]);
+
+                if (hasNormals)
+                {
+                    const BlendedColumns invTransposeMat = blendColumns<3>(pBoneInvTransposeMats, boneCount, weights, ids);
+                    result.normals[v] = transform<false>(invTransposeMat, source.normals[v]);
+                }
+            }
+        }, maxThreads);
+    }
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /** Skins vertices on the CPU with the math of the compute skinning shader used by SkinningCache.
+        Each vertex blends the matrices of its four bones by their raw weights, then transforms its position by the blended matrix,
+        its bitangent by the blended matrix' upper 3x3 and its normal by the blended inverse transpose. The results aren't normalized, as on the GPU.
+        Vertices are processed in batches of kVerticesPerBatch spread over the cores, and each vertex blends the matrix columns with SSE.
+    */
+    class CpuSkinning
+    {
+    public:
+        /** Vertices are skinned in batches of this size. Meshes of up to one batch are skinned on the calling thread.
+        */
+        static const uint32_t kVerticesPerBatch = 1024;
+
+        /** The bind pose of a mesh, in the layout of its vertex streams
+        */
+        struct SourceVertices
+        {
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec3> normals;         ///< Empty if the mesh has no normals
+            std::vector<glm::vec3> bitangents;      ///< Empty if the mesh has no bitangents
+            std::vector<glm::vec4> boneWeights;
+            std::vector<uint32_t> boneIds;          ///< Four 8-bit bone IDs per vertex with x in the lowest byte, as in the RGBA8Uint vertex stream
+        };
+
+        /** The skinned streams, tightly packed like the RGB32Float vertex buffers they are uploaded to
+        */
+        struct SkinnedVertices
+        {
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec3> normals;         ///< Empty if the source has no normals
+            std::vector<glm::vec3> bitangents;      ///< Empty if the source has no bitangents
+        };
+
+        /** Skin a mesh
+            \param[in] source The bind pose. All non-empty streams must have the same number of vertices as the positions.
+            \param[in] pBoneMats The bone matrices, as returned by Model::getBoneMatrices()
+            \param[in] pBoneInvTransposeMats The inverse transposed bone matrices, as returned by Model::getBoneInvTransposeMatrices()
+            \param[in] boneCount Number of bones. Vertices referencing bones past the end don't get a contribution from them.
+            \param[out] result The skinned vertices. The vectors are resized to the vertex count, so their storage is reused across calls.
+            \param[in] maxThreads Maximum number of threads to use. 0 uses all cores.
+        */
+        static void skin(const SourceVertices& source, const glm::mat4* pBoneMats, const glm::mat4* pBoneInvTransposeMats, uint32_t boneCount, SkinnedVertices& result, uint32_t maxThreads = 0);
+    };
+}
@@ -43,6 +43,14 @@
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
 #include "API/Device.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/CpuTimer.h"
+#include "ModelCache.h"
+#include "VertexCacheOptimizer.h"
+#include "VertexQuantizer.h"
+#include "MeshletBuilder.h"
+#include "ModelPreload.h"
+#include "Graphics/TextureStreamer.h"
 
 namespace Falcor
 {
@@ -147,27 +155,26 @@ namespace Falcor
         return indices;
     }
 
-    void genTangentSpace(const aiMesh* pAiMesh)
+    void genTangentSpace(const aiMesh* pAiMesh, std::vector<glm::vec3>& bitangents)
     {
         if (pAiMesh->mFaces[0].mNumIndices == 3)
         {
-            aiMesh* pMesh = const_cast<aiMesh*>(pAiMesh);
-            pMesh->mBitangents = new aiVector3D[pMesh->mNumVertices];
+            bitangents.resize(pAiMesh->mNumVertices);
 
-            const glm::vec3* pPos = (glm::vec3*)pMesh->mVertices;
-            glm::vec3* pBi = (glm::vec3*)pMesh->mBitangents;
-            glm::vec3* pNormals = (glm::vec3*)pMesh->mNormals;
+            const glm::vec3* pPos = (glm::vec3*)pAiMesh->mVertices;
+            glm::vec3* pBi = bitangents.data();
+            glm::vec3* pNormals = (glm::vec3*)pAiMesh->mNormals;
             std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
 
             uint32_t texCrdCount = 0;
             std::vector<glm::vec2> texCrd;
-            if (pMesh->mTextureCoords[0] != nullptr)
+            if (pAiMesh->mTextureCoords[0] != nullptr)
             {
                 texCrdCount = 1;
-                texCrd.resize(pMesh->mNumVertices);
-                for (size_t i = 0; i < pMesh->mNumVertices; ++i)
+                texCrd.resize(pAiMesh->mNumVertices);
+                for (size_t i = 0; i < pAiMesh->mNumVertices; ++i)
                 {
-                    texCrd[i] = glm::vec2(pMesh->mTextureCoords[0][i].x, pMesh->mTextureCoords[0][i].y);
+                    texCrd[i] = glm::vec2(pAiMesh->mTextureCoords[0][i].x, pAiMesh->mTextureCoords[0][i].y);
                 }
             }
 
@@ -175,6 +182,65 @@ namespace Falcor
         }
     }
 
+    void generateMeshlets(aiMesh* pAiMesh, MeshletData& meshlets)
+    {
+        // Only triangle lists get meshlets. The bounds of skinned meshes would only hold in the bind pose.
+        if ((pAiMesh->mNumFaces == 0) || pAiMesh->HasBones()) return;
+        for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+        {
+            if (pAiMesh->mFaces[i].mNumIndices != 3) return;
+        }
+
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        meshlets = MeshletBuilder::build(indices.data(), (uint32_t)indices.size(), pAiMesh->mVertices, sizeof(aiVector3D), pAiMesh->mNumVertices);
+        for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+        {
+            std::memcpy(pAiMesh->mFaces[i].mIndices, &indices[i * 3], sizeof(uint32_t) * 3);
+        }
+    }
+
+    void optimizeVertexCache(aiMesh* pAiMesh, VertexCacheOptimizer::Stats& before, VertexCacheOptimizer::Stats& after)
+    {
+        // Only triangle lists are reordered. Morph targets would need to be remapped as well, so they are left alone.
+        if ((pAiMesh->mNumFaces == 0) || (pAiMesh->mNumAnimMeshes > 0)) return;
+        for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+        {
+            if (pAiMesh->mFaces[i].mNumIndices != 3) return;
+        }
+
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        const uint32_t indexCount = (uint32_t)indices.size();
+        before = VertexCacheOptimizer::analyze(indices.data(), indexCount, pAiMesh->mNumVertices);
+        VertexCacheOptimizer::optimizeTriangleOrder(indices.data(), indexCount, pAiMesh->mNumVertices);
+        std::vector<uint32_t> remap = VertexCacheOptimizer::optimizeVertexFetch(indices.data(), indexCount, pAiMesh->mNumVertices);
+        after = VertexCacheOptimizer::analyze(indices.data(), indexCount, pAiMesh->mNumVertices);
+
+        for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+        {
+            std::memcpy(pAiMesh->mFaces[i].mIndices, &indices[i * 3], sizeof(uint32_t) * 3);
+        }
+
+        auto remapStream = [&remap](void* pStream, uint32_t stride)
+        {
+            if (pStream) VertexCacheOptimizer::remapVertexBuffer(pStream, stride, remap);
+        };
+        remapStream(pAiMesh->mVertices, sizeof(aiVector3D));
+        remapStream(pAiMesh->mNormals, sizeof(aiVector3D));
+        remapStream(pAiMesh->mTangents, sizeof(aiVector3D));
+        remapStream(pAiMesh->mBitangents, sizeof(aiVector3D));
+        for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++) remapStream(pAiMesh->mColors[i], sizeof(aiColor4D));
+        for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++) remapStream(pAiMesh->mTextureCoords[i], sizeof(aiVector3D));
+
+        for (uint32_t boneID = 0; boneID < pAiMesh->mNumBones; boneID++)
+        {
+            aiBone* pAiBone = pAiMesh->mBones[boneID];
+            for (uint32_t i = 0; i < pAiBone->mNumWeights; i++)
+            {
+                pAiBone->mWeights[i].mVertexId = remap[pAiBone->mWeights[i].mVertexId];
+            }
+        }
+    }
+
     struct layoutsData
     {
         uint32_t pos;
@@ -268,6 +334,31 @@ namespace Falcor
         }
     }
 
+    /** The color a streamed texture shows until its mip tail is decoded. Chosen so that the material looks neutral.
+    */
+    static glm::vec4 getPlaceholderColor(aiTextureType type, bool isObjFile)
+    {
+        switch (type)
+        {
+        case aiTextureType_SPECULAR:
+        case aiTextureType_EMISSIVE:
+            return glm::vec4(0, 0, 0, 1);
+        case aiTextureType_HEIGHT:
+        case aiTextureType_DISPLACEMENT:
+            return isObjFile ? glm::vec4(0.5f, 0.5f, 1, 1) : glm::vec4(0, 0, 0, 1);
+        case aiTextureType_NORMALS:
+            return glm::vec4(0.5f, 0.5f, 1, 1);
+        default:
+            return glm::vec4(1);
+        }
+    }
+
+    static std::string getTexturePath(const std::string& folder, const std::string& texture)
+    {
+        std::string fullpath = folder + '/' + texture;
+        return replaceSubstring(fullpath, "\\", "/");
+    }
+
     void AssimpModelImporter::loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb)
     {
         for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
@@ -304,10 +395,26 @@ namespace Falcor
                 }
                 else
                 {
-                    // create a new texture
-                    std::string fullpath = folder + '/' + s;
-                    fullpath = replaceSubstring(fullpath, "\\", "/");
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb, pMaterial->getShadingModel()));
+                    // create a new texture, from the image decoded by the preload if there is one
+                    std::string fullpath = getTexturePath(folder, s);
+                    bool loadAsSrgb = isSrgbRequired(aiType, useSrgb, pMaterial->getShadingModel());
+                    if (is_set(mFlags, Model::LoadFlags::StreamTextures))
+                    {
+                        pTex = TextureStreamer::createTexture(fullpath, loadAsSrgb, getPlaceholderColor(aiType, isObjFile));
+                    }
+
+                    if (pTex == nullptr)
+                    {
+                        const auto& bitmap = mpPreload->bitmaps.find(fullpath);
+                        if (bitmap != mpPreload->bitmaps.end())
+                        {
+                            pTex = createTextureFromBitmap(*bitmap->second, fullpath, true, loadAsSrgb);
+                        }
+                        else
+                        {
+                            pTex = createTextureFromFile(fullpath, true, loadAsSrgb);
+                        }
+                    }
                     if (pTex)
                     {
                         mTextureCache[s] = pTex;
@@ -316,6 +423,19 @@ namespace Falcor
 
                 assert(pTex != nullptr);
                 setTexture(aiType, isObjFile, pMaterial, pTex);
+
+                if (pTex && is_set(mFlags, Model::LoadFlags::StreamTextures))
+                {
+                    // The streamer replaces the texture as higher resolution mips become available
+                    std::weak_ptr<Material> pWeakMaterial = pMaterial->shared_from_this();
+                    TextureStreamer::addUser(pTex.get(), [pWeakMaterial, aiType, isObjFile](const Texture::SharedPtr& pNewTex)
+                    {
+                        auto pMat = pWeakMaterial.lock();
+                        if (pMat == nullptr) return false;
+                        setTexture(aiType, isObjFile, pMat.get(), pNewTex);
+                        return true;
+                    });
+                }
             }
         }
 
@@ -431,6 +551,9 @@ namespace Falcor
 
     AssimpModelImporter::AssimpModelImporter(Model& model, Model::LoadFlags flags) : mFlags(flags), mModel(model)
     {
+        if (is_set(flags, Model::LoadFlags::QuantizePositions)) mQuantizationFlags |= VERTEX_QUANTIZE_POSITION;
+        if (is_set(flags, Model::LoadFlags::QuantizeNormals))   mQuantizationFlags |= VERTEX_QUANTIZE_NORMAL;
+        if (is_set(flags, Model::LoadFlags::QuantizeTexCoords)) mQuantizationFlags |= VERTEX_QUANTIZE_TEXCOORD;
     }
 
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
@@ -478,7 +601,12 @@ namespace Falcor
                 if (aiToFalcorMesh.find(aiId) == aiToFalcorMesh.end())
                 {
                     // Cache mesh
-                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId]);
+                    Mesh::SharedPtr pMesh = createMesh(pScene->mMeshes[aiId]);
+                    if (pMesh && aiId < mMeshlets.size() && mMeshlets[aiId].meshlets.size())
+                    {
+                        pMesh->mpMeshlets = std::make_shared<MeshletData>(std::move(mMeshlets[aiId]));
+                    }
+                    aiToFalcorMesh[aiId] = pMesh;
                 }
 
                 mModel.addMeshInstance(aiToFalcorMesh[aiId], aiMatToGLM(transform));
@@ -494,46 +622,144 @@ namespace Falcor
         return b;
     }
 
+    bool AssimpModelImporter::needsTangentSpace(const aiMesh* pAiMesh, Model::LoadFlags flags)
+    {
+        return (pAiMesh->HasTangentsAndBitangents() == false) && (is_set(flags, Model::LoadFlags::DontGenerateTangentSpace) == false);
+    }
+
+    const glm::vec3* AssimpModelImporter::getBitangents(const aiMesh* pAiMesh) const
+    {
+        if (pAiMesh->mBitangents) return (const glm::vec3*)pAiMesh->mBitangents;
+        auto it = mGeneratedBitangents.find(pAiMesh);
+        return (it == mGeneratedBitangents.end()) ? nullptr : it->second;
+    }
+
     bool AssimpModelImporter::createDrawList(const aiScene* pScene)
     {
         createAnimationController(pScene);
+
+        // The bitangents of meshes which have none were generated by the preload
+        mGeneratedBitangents.clear();
+        for (uint32_t meshID = 0; meshID < (uint32_t)mpPreload->bitangents.size(); meshID++)
+        {
+            const std::vector<glm::vec3>& bitangents = mpPreload->bitangents[meshID];
+            if (bitangents.size()) mGeneratedBitangents[pScene->mMeshes[meshID]] = bitangents.data();
+        }
+
         IdToMesh aiToFalcorMeshId;
         aiNode* pRoot = pScene->mRootNode;
         return parseAiSceneNode(pRoot, pScene, aiToFalcorMeshId);
     }
 
-    bool AssimpModelImporter::initModel(const std::string& filename)
+    bool AssimpModelImporter::preload(const std::string& filename, Model::LoadFlags flags, ModelPreload& preload)
     {
-        std::string fullpath;
-        if (findFileInDataDirectories(filename, fullpath) == false)
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        preload.flags = flags;
+        if (findFileInDataDirectories(filename, preload.fullpath) == false)
         {
             logError(std::string("Can't find model file ") + filename, true);
             return false;
         }
 
-        uint32_t assimpFlags = aiProcessPreset_TargetRealtime_MaxQuality |
-            aiProcess_OptimizeGraph |
-            aiProcess_FlipUVs |
-            0;
+        // Running ASSIMP's post-processing is the bulk of the load time of large scenes, so the processed scene is cached on disk
+        const uint32_t assimpFlags = getPostProcessFlags(flags);
+        std::string cacheEntry;
+        if (ModelCache::isEnabled() && is_set(flags, Model::LoadFlags::DontUseModelCache) == false)
+        {
+            cacheEntry = ModelCache::getEntryFilename(preload.fullpath, assimpFlags, getSceneProcessingFlags(flags));
+            if (cacheEntry.size()) preload.pCachedScene.reset(ModelCache::load(cacheEntry, &preload.meshlets));
+        }
 
-        if(is_set(mFlags, Model::LoadFlags::FindDegeneratePrimitives) == false) assimpFlags &= ~aiProcess_FindDegenerates;
-        if(is_set(mFlags, Model::LoadFlags::DontMergeMeshes))                   assimpFlags &= ~aiProcess_OptimizeMeshes; // Avoid merging original meshes
-        if(is_set(mFlags, Model::LoadFlags::RemoveInstancing))                  assimpFlags |= aiProcess_PreTransformVertices;
+        preload.pScene = preload.pCachedScene.get();
+        if (preload.pScene == nullptr)
+        {
+            preload.pImporter = std::make_unique<Assimp::Importer>();
+            preload.pScene = preload.pImporter->ReadFile(preload.fullpath, assimpFlags);
 
-        // Never use Assimp's tangent gen code
-        assimpFlags &= ~(aiProcess_CalcTangentSpace);
+            if((preload.pScene == nullptr) || (verifyScene(preload.pScene) == false))
+            {
+                std::string str("Can't open model file '");
+                str = str + std::string(filename) + "'\n" + preload.pImporter->GetErrorString();
+                logError(str, true);
+                preload.pScene = nullptr;
+                return false;
+            }
 
-        Assimp::Importer importer;
-        const aiScene* pScene = importer.ReadFile(fullpath, assimpFlags);
+            // Store the scene before the importer modifies it
+            processScene(const_cast<aiScene*>(preload.pScene), flags, filename, preload.meshlets);
+            if (cacheEntry.size()) ModelCache::store(preload.pScene, cacheEntry, &preload.meshlets);
+        }
 
-        if((pScene == nullptr) || (verifyScene(pScene) == false))
+        // Decode the textures. Which textures are used, and how they are loaded, is decided by loadTextures(); this only collects the candidates.
+        auto last = preload.fullpath.find_last_of("/\\");
+        std::string modelFolder = preload.fullpath.substr(0, last);
+        // Streamed textures are decoded by the TextureStreamer workers instead
+        std::vector<std::string> texturePaths;
+        uint32_t materialCount = (is_set(flags, Model::LoadFlags::StreamTextures) && TextureStreamer::isEnabled()) ? 0 : preload.pScene->mNumMaterials;
+        for (uint32_t i = 0; i < materialCount; i++)
         {
-            std::string str("Can't open model file '");
-            str = str + std::string(filename) + "'\n" + importer.GetErrorString();
-            logError(str, true);
-            return false;
+            const aiMaterial* pAiMaterial = preload.pScene->mMaterials[i];
+            for (int t = 0; t < AI_TEXTURE_TYPE_MAX; ++t)
+            {
+                aiString path;
+                if (pAiMaterial->GetTextureCount((aiTextureType)t) != 1 || pAiMaterial->GetTexture((aiTextureType)t, 0, &path) != AI_SUCCESS || path.length == 0) continue;
+
+                std::string fullpath = getTexturePath(modelFolder, path.data);
+                if (hasSuffix(fullpath, ".dds", false) == false && preload.bitmaps.count(fullpath) == 0 && doesFileExist(fullpath))
+                {
+                    preload.bitmaps[fullpath] = nullptr;
+                    texturePaths.push_back(fullpath);
+                }
+            }
+        }
+
+        // Generating the tangent space is the most expensive CPU work of mesh creation and the meshes are independent, so do it for all of them in parallel.
+        // The bitangents are kept in the preload, since the scene may be shared by several models.
+        preload.bitangents.assign(preload.pScene->mNumMeshes, std::vector<glm::vec3>());
+        parallelFor(preload.pScene->mNumMeshes, [&](uint32_t meshID)
+        {
+            const aiMesh* pAiMesh = preload.pScene->mMeshes[meshID];
+            if (needsTangentSpace(pAiMesh, flags))
+            {
+                genTangentSpace(pAiMesh, preload.bitangents[meshID]);
+            }
+        });
+
+        std::vector<Bitmap::UniqueConstPtr> bitmaps(texturePaths.size());
+        parallelFor((uint32_t)texturePaths.size(), [&](uint32_t i)
+        {
+            bitmaps[i] = Bitmap::createFromFile(texturePaths[i], true);
+        });
+        for (size_t i = 0; i < texturePaths.size(); i++)
+        {
+            // Textures which failed to decode are left to loadTextures(), which reports the error
+            if (bitmaps[i]) preload.bitmaps[texturePaths[i]] = std::move(bitmaps[i]);
+            else preload.bitmaps.erase(texturePaths[i]);
         }
 
+        preload.preloadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return true;
+    }
+
+    bool AssimpModelImporter::initModel(const std::string& filename, const ModelPreload* pPreload)
+    {
+        // Without a preload from the caller, run it here
+        ModelPreload localPreload;
+        if (pPreload == nullptr || pPreload->pScene == nullptr || pPreload->flags != mFlags)
+        {
+            if (preload(filename, mFlags, localPreload) == false)
+            {
+                return false;
+            }
+            pPreload = &localPreload;
+        }
+        mpPreload = pPreload;
+
+        // The preload may be shared by several models, so it isn't modified
+        const aiScene* pScene = pPreload->pScene;
+        const std::string& fullpath = pPreload->fullpath;
+        mMeshlets = pPreload->meshlets;
+
         // Extract the folder name
         auto last = fullpath.find_last_of("/\\");
         std::string modelFolder = fullpath.substr(0, last);
@@ -553,13 +779,74 @@ namespace Falcor
             return false;
         }
 
+        if (mQuantizationFlags)
+        {
+            logInfo(mQuantizationReport.getString(filename));
+        }
+
         return true;
     }
 
-    bool AssimpModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags)
+    uint32_t AssimpModelImporter::getPostProcessFlags(Model::LoadFlags flags)
+    {
+        uint32_t assimpFlags = aiProcessPreset_TargetRealtime_MaxQuality |
+            aiProcess_OptimizeGraph |
+            aiProcess_FlipUVs |
+            0;
+
+        if(is_set(flags, Model::LoadFlags::FindDegeneratePrimitives) == false) assimpFlags &= ~aiProcess_FindDegenerates;
+        if(is_set(flags, Model::LoadFlags::DontMergeMeshes))                   assimpFlags &= ~aiProcess_OptimizeMeshes; // Avoid merging original meshes
+        if(is_set(flags, Model::LoadFlags::RemoveInstancing))                  assimpFlags |= aiProcess_PreTransformVertices;
+
+        // Never use Assimp's tangent gen code
+        assimpFlags &= ~(aiProcess_CalcTangentSpace);
+        return assimpFlags;
+    }
+
+    Model::LoadFlags AssimpModelImporter::getSceneProcessingFlags(Model::LoadFlags flags)
+    {
+        return flags & (Model::LoadFlags::OptimizeVertexCache | Model::LoadFlags::GenerateMeshlets);
+    }
+
+    void AssimpModelImporter::processScene(aiScene* pScene, Model::LoadFlags flags, const std::string& filename, std::vector<MeshletData>& meshlets)
+    {
+        if (is_set(flags, Model::LoadFlags::OptimizeVertexCache))
+        {
+            std::vector<VertexCacheOptimizer::Stats> meshBefore(pScene->mNumMeshes), meshAfter(pScene->mNumMeshes);
+            parallelFor(pScene->mNumMeshes, [&](uint32_t meshID)
+            {
+                optimizeVertexCache(pScene->mMeshes[meshID], meshBefore[meshID], meshAfter[meshID]);
+            });
+
+            VertexCacheOptimizer::Stats before, after;
+            for (uint32_t meshID = 0; meshID < pScene->mNumMeshes; meshID++)
+            {
+                before += meshBefore[meshID];
+                after += meshAfter[meshID];
+            }
+            logInfo(VertexCacheOptimizer::getReport(filename, before, after));
+        }
+
+        // Meshlets are built last, so that their triangle order is the one which ends up in the index buffers
+        meshlets.clear();
+        if (is_set(flags, Model::LoadFlags::GenerateMeshlets))
+        {
+            meshlets.resize(pScene->mNumMeshes);
+            parallelFor(pScene->mNumMeshes, [&](uint32_t meshID)
+            {
+                generateMeshlets(pScene->mMeshes[meshID], meshlets[meshID]);
+            });
+
+            MeshletBuilder::Stats stats;
+            for (const MeshletData& meshData : meshlets) stats += MeshletBuilder::getStats(meshData);
+            logInfo(MeshletBuilder::getReport(filename, stats));
+        }
+    }
+
+    bool AssimpModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags, const ModelPreload* pPreload)
     {
         AssimpModelImporter loader(model, flags);
-        return loader.initModel(filename);
+        return loader.initModel(filename, pPreload);
     }
 
     bool AssimpModelImporter::isUsedNode(const aiNode* pNode) const
@@ -712,28 +999,19 @@ namespace Falcor
             for (uint32_t j = 0; j < pAiNode->mNumPositionKeys; j++)
             {
                 const aiVectorKey& key = pAiNode->mPositionKeys[j];
-                Animation::AnimationKey<glm::vec3> position;
-                position.value = glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z);
-                position.time = float(key.mTime);
-                animationSets[i].translation.keys.push_back(position);
+                animationSets[i].translation.addKey(float(key.mTime), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
             }
 
             for (uint32_t j = 0; j < pAiNode->mNumScalingKeys; j++)
             {
                 const aiVectorKey& key = pAiNode->mScalingKeys[j];
-                Animation::AnimationKey<glm::vec3> scale;
-                scale.value = glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z);
-                scale.time = float(key.mTime);
-                animationSets[i].scaling.keys.push_back(scale);
+                animationSets[i].scaling.addKey(float(key.mTime), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
             }
 
             for (uint32_t j = 0; j < pAiNode->mNumRotationKeys; j++)
             {
                 const aiQuatKey& key = pAiNode->mRotationKeys[j];
-                Animation::AnimationKey<glm::quat> rotation;
-                rotation.value = glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z);
-                rotation.time = float(key.mTime);
-                animationSets[i].rotation.keys.push_back(rotation);
+                animationSets[i].rotation.addKey(float(key.mTime), glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
             }
         }
 
@@ -770,13 +1048,14 @@ namespace Falcor
         auto pIB = createIndexBuffer(pAiMesh);
         BoundingBox boundingBox = createMeshBbox(pAiMesh);
 
-        const bool generateTangentSpace = (pAiMesh->HasTangentsAndBitangents() == false) && (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false);
-        if (generateTangentSpace)
-        {
-            genTangentSpace(pAiMesh);
-        }
+        auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
+        assert(pMaterial);
 
-        VertexLayout::SharedPtr pLayout = createVertexLayout(pAiMesh);
+        // The layout depends on which attributes could be quantized
+        QuantizedStreams quantizedStreams;
+        Mesh::VertexQuantization quantization = quantizeVertices(pAiMesh, pMaterial.get(), boundingBox, quantizedStreams);
+
+        VertexLayout::SharedPtr pLayout = createVertexLayout(pAiMesh, quantization.flags);
         if (pLayout == nullptr)
         {
             assert(0);
@@ -797,7 +1076,27 @@ namespace Falcor
         for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
         {
             const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
-            pVBs[i] = createVertexBuffer(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            const uint32_t location = pVbLayout->getElementShaderLocation(0);
+            const std::vector<uint16_t>& quantized = quantizedStreams[location];
+            if (quantized.size())
+            {
+                Buffer::BindFlags bindFlags = Buffer::BindFlags::Vertex;
+                if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
+                {
+                    bindFlags |= Buffer::BindFlags::ShaderResource;
+                }
+                pVBs[i] = Buffer::create(quantized.size() * sizeof(uint16_t), bindFlags, Buffer::CpuAccess::None, quantized.data());
+            }
+            else
+            {
+                pVBs[i] = createVertexBuffer(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            }
+
+            if (mQuantizationFlags)
+            {
+                mQuantizationReport.bytesBefore += (uint64_t)getFormatBytesPerBlock(kLayoutData[location].format) * vertexCount;
+                mQuantizationReport.bytesAfter += (uint64_t)pVbLayout->getStride() * vertexCount;
+            }
         }
 
         Vao::Topology topology = Vao::Topology::TriangleList;
@@ -817,18 +1116,71 @@ namespace Falcor
             assert(0);
         }
 
-        auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
-        assert(pMaterial);
-
         Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+        pMesh->mVertexQuantization = quantization;
+
+        return pMesh;
+    }
+
+    Mesh::VertexQuantization AssimpModelImporter::quantizeVertices(const aiMesh* pAiMesh, const Material* pMaterial, const BoundingBox& boundingBox, QuantizedStreams& streams)
+    {
+        Mesh::VertexQuantization quantization;
+        if (mQuantizationFlags == 0) return quantization;
+        mQuantizationReport.meshCount++;
 
-        if (generateTangentSpace)
+        // Skinning and area lights read the vertex buffers as floats
+        if (pAiMesh->HasBones() || EXTRACT_EMISSIVE_TYPE(pMaterial->getFlags()) != ChannelTypeUnused) return quantization;
+
+        const uint32_t vertexCount = pAiMesh->mNumVertices;
+        VertexQuantizer::Report& report = mQuantizationReport;
+
+        if (mQuantizationFlags & VERTEX_QUANTIZE_POSITION)
         {
-            aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
-            safe_delete_array(pM->mBitangents);
+            VertexQuantizer::getPositionDecode(boundingBox.getMinPos(), boundingBox.getMaxPos(), quantization.positionScale, quantization.positionOffset);
+            std::vector<uint16_t>& positions = streams[VERTEX_POSITION_LOC];
+            positions.resize(4 * vertexCount);
+            float error = VertexQuantizer::quantizePositions(pAiMesh->mVertices, sizeof(aiVector3D), vertexCount, quantization.positionScale, quantization.positionOffset, positions.data());
+            report.maxPositionError = max(report.maxPositionError, error);
+            quantization.flags |= VERTEX_QUANTIZE_POSITION;
         }
 
-        return pMesh;
+        const glm::vec3* pBitangents = getBitangents(pAiMesh);
+        if ((mQuantizationFlags & VERTEX_QUANTIZE_NORMAL) && (pAiMesh->HasNormals() || pBitangents))
+        {
+            if (pAiMesh->HasNormals())
+            {
+                streams[VERTEX_NORMAL_LOC].resize(2 * vertexCount);
+                float error = VertexQuantizer::quantizeUnitVectors(pAiMesh->mNormals, sizeof(aiVector3D), vertexCount, streams[VERTEX_NORMAL_LOC].data());
+                report.maxNormalError = max(report.maxNormalError, error);
+            }
+            if (pBitangents)
+            {
+                streams[VERTEX_BITANGENT_LOC].resize(2 * vertexCount);
+                float error = VertexQuantizer::quantizeUnitVectors(pBitangents, sizeof(glm::vec3), vertexCount, streams[VERTEX_BITANGENT_LOC].data());
+                report.maxNormalError = max(report.maxNormalError, error);
+            }
+            quantization.flags |= VERTEX_QUANTIZE_NORMAL;
+        }
+
+        if ((mQuantizationFlags & VERTEX_QUANTIZE_TEXCOORD) && pAiMesh->HasTextureCoords(0))
+        {
+            // Tiled UVs can be out of the range where half floats are precise enough. Those meshes keep them at full precision.
+            std::vector<uint16_t>& texCrds = streams[VERTEX_TEXCOORD_LOC];
+            texCrds.resize(2 * vertexCount);
+            float error = VertexQuantizer::quantizeTexCoords(pAiMesh->mTextureCoords[0], sizeof(aiVector3D), vertexCount, texCrds.data());
+            if (error <= VertexQuantizer::kMaxTexCoordError)
+            {
+                report.maxTexCoordError = max(report.maxTexCoordError, error);
+                quantization.flags |= VERTEX_QUANTIZE_TEXCOORD;
+            }
+            else
+            {
+                texCrds.clear();
+            }
+        }
+
+        if (quantization.flags) report.quantizedMeshCount++;
+        return quantization;
     }
 
     Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh)
@@ -844,7 +1196,7 @@ namespace Falcor
     }
 
 
-    bool isElementUsed(const aiMesh* pAiMesh, uint32_t location)
+    bool isElementUsed(const aiMesh* pAiMesh, const glm::vec3* pBitangents, uint32_t location)
     {
         switch (location)
         {
@@ -853,7 +1205,7 @@ namespace Falcor
         case VERTEX_NORMAL_LOC:
             return pAiMesh->HasNormals();
         case VERTEX_BITANGENT_LOC:
-            return (pAiMesh->mBitangents != nullptr); // ASSIMP doesn't have a function that checks only for bitangents
+            return (pBitangents != nullptr); // ASSIMP doesn't have a function that checks only for bitangents
         case VERTEX_BONE_WEIGHT_LOC:
         case VERTEX_BONE_ID_LOC:
             return pAiMesh->HasBones();
@@ -871,7 +1223,23 @@ namespace Falcor
         }
     }
 
-    VertexLayout::SharedPtr AssimpModelImporter::createVertexLayout(const aiMesh* pAiMesh)
+    static ResourceFormat getQuantizedFormat(uint32_t location, uint32_t quantizationFlags)
+    {
+        switch (location)
+        {
+        case VERTEX_POSITION_LOC:
+            return (quantizationFlags & VERTEX_QUANTIZE_POSITION) ? ResourceFormat::RGBA16Snorm : ResourceFormat::Unknown;
+        case VERTEX_NORMAL_LOC:
+        case VERTEX_BITANGENT_LOC:
+            return (quantizationFlags & VERTEX_QUANTIZE_NORMAL) ? ResourceFormat::RG16Snorm : ResourceFormat::Unknown;
+        case VERTEX_TEXCOORD_LOC:
+            return (quantizationFlags & VERTEX_QUANTIZE_TEXCOORD) ? ResourceFormat::RG16Float : ResourceFormat::Unknown;
+        default:
+            return ResourceFormat::Unknown;
+        }
+    }
+
+    VertexLayout::SharedPtr AssimpModelImporter::createVertexLayout(const aiMesh* pAiMesh, uint32_t quantizationFlags)
     {
         static const uint32_t kMaxSupportedUVs = 2;
         // Must have position!!!
@@ -900,10 +1268,12 @@ namespace Falcor
         uint32_t bufferCount = 0;
         for (uint32_t location = 0; location < VERTEX_LOCATION_COUNT; ++location)
         {
-            if (isElementUsed(pAiMesh, location))
+            if (isElementUsed(pAiMesh, getBitangents(pAiMesh), location))
             {
                 VertexBufferLayout::SharedPtr pVbLayout = VertexBufferLayout::create();
-                pVbLayout->addElement(kLayoutData[location].name, 0, kLayoutData[location].format, 1, location);
+                ResourceFormat format = getQuantizedFormat(location, quantizationFlags);
+                if (format == ResourceFormat::Unknown) format = kLayoutData[location].format;
+                pVbLayout->addElement(kLayoutData[location].name, 0, format, 1, location);
                 pLayout->addBufferLayout(bufferCount, pVbLayout);
                 bufferCount++;
             }
@@ -916,6 +1286,7 @@ namespace Falcor
     {
         const uint32_t vertexStride = pLayout->getStride();
         std::vector<uint8_t> initData(vertexStride * pAiMesh->mNumVertices, 0);
+        const glm::vec3* pBitangents = getBitangents(pAiMesh);
 
         for (uint32_t vertexID = 0; vertexID < pAiMesh->mNumVertices; vertexID++)
         {
@@ -940,8 +1311,8 @@ namespace Falcor
                     size = sizeof(pAiMesh->mNormals[0]);
                     break;
                 case VERTEX_BITANGENT_LOC:
-                    pSrc = (uint8_t*)(&pAiMesh->mBitangents[vertexID]);
-                    size = sizeof(pAiMesh->mBitangents[0]);
+                    pSrc = (uint8_t*)(&pBitangents[vertexID]);
+                    size = sizeof(pBitangents[0]);
                     break;
                 case VERTEX_DIFFUSE_COLOR_LOC:
                     pSrc = (uint8_t*)(&pAiMesh->mColors[0][vertexID]);
@@ -26,10 +26,12 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <array>
 #include <map>
 #include <unordered_set>
 #include <vector>
 #include "Graphics/Model/Loaders/ModelImporter.h"
+#include "Graphics/Model/Loaders/VertexQuantizer.h"
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
@@ -50,6 +52,7 @@ namespace Falcor
     class Buffer;
     class VertexBufferLayout;
     class Texture;
+    struct ModelPreload;
 
     /** Implements model import functionality through ASSIMP.
         Typically, the user should use Model::createFromFile() to load a model instead of this class.
@@ -61,20 +64,51 @@ namespace Falcor
             \param[out] model Model object to load into
             \param[in] filename Model's filename. Can include a full path or a relative path from a data directory
             \param[in] flags Flags controlling model creation
+            \param[in] pPreload Optional. The result of preload() for the same file and flags.
             \return Whether import succeeded
         */
-        static bool import(Model& model, const std::string& filename, Model::LoadFlags flags);
+        static bool import(Model& model, const std::string& filename, Model::LoadFlags flags, const ModelPreload* pPreload = nullptr);
+
+        /** Run the CPU part of an import: read and process the scene (or load it from the ModelCache), generate missing tangent spaces and decode its textures.
+            Doesn't create any GPU resources, so it can run on a worker thread.
+            \param[in] filename Model's filename. Can include a full path or a relative path from a data directory
+            \param[in] flags Flags controlling model creation
+            \param[out] preload Receives the processed scene, the generated bitangents and the decoded textures
+            \return Whether the scene was read
+        */
+        static bool preload(const std::string& filename, Model::LoadFlags flags, ModelPreload& preload);
+
+        /** Get the ASSIMP post-processing flags used to import a model
+            \param[in] flags Flags controlling model creation
+        */
+        static uint32_t getPostProcessFlags(Model::LoadFlags flags);
+
+        /** Get the flags of the processing the importer applies to the post-processed ASSIMP scene (see processScene()).
+            Together with the post-processing flags, these identify the scene stored in the ModelCache.
+        */
+        static Model::LoadFlags getSceneProcessingFlags(Model::LoadFlags flags);
+
+        /** Apply the importer's own processing to a post-processed ASSIMP scene, before it is cached.
+            \param[in] pScene The scene to process in place
+            \param[in] flags Flags controlling model creation
+            \param[in] filename Model's filename, for logging
+            \param[out] meshlets The meshlets of the scene's meshes, if flags include Model::LoadFlags::GenerateMeshlets. Meshes without meshlets get an empty entry.
+        */
+        static void processScene(aiScene* pScene, Model::LoadFlags flags, const std::string& filename, std::vector<MeshletData>& meshlets);
 
     private:
 
         using IdToMesh = std::unordered_map<uint32_t, Mesh::SharedPtr>;
+        using QuantizedStreams = std::array<std::vector<uint16_t>, VERTEX_LOCATION_COUNT>;
 
         AssimpModelImporter(Model& model, Model::LoadFlags flags);
         AssimpModelImporter(const AssimpModelImporter&) = delete;
         void operator=(const AssimpModelImporter&) = delete;
 
-        bool initModel(const std::string& filename);
+        bool initModel(const std::string& filename, const ModelPreload* pPreload);
         bool createDrawList(const aiScene* pScene);
+        static bool needsTangentSpace(const aiMesh* pAiMesh, Model::LoadFlags flags);
+        const glm::vec3* getBitangents(const aiMesh* pAiMesh) const;
         bool parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh);
         bool createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb);
 
@@ -86,7 +120,8 @@ namespace Falcor
         Animation::UniquePtr createAnimation(const aiAnimation* pAiAnim);
 
         Mesh::SharedPtr createMesh(const aiMesh* pAiMesh);
-        VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
+        Mesh::VertexQuantization quantizeVertices(const aiMesh* pAiMesh, const Material* pMaterial, const BoundingBox& boundingBox, QuantizedStreams& streams);
+        VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh, uint32_t quantizationFlags);
         Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
         Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb);
@@ -105,6 +140,11 @@ namespace Falcor
 
         std::vector<Bone> mBones;
         Model::LoadFlags mFlags;
+        uint32_t mQuantizationFlags = 0;    // The VERTEX_QUANTIZE_* flags requested by the load flags
+        VertexQuantizer::Report mQuantizationReport;
         std::map<const std::string, Texture::SharedPtr> mTextureCache;
+        std::vector<MeshletData> mMeshlets;     // Indexed by ASSIMP mesh ID
+        const ModelPreload* mpPreload = nullptr;
+        std::unordered_map<const aiMesh*, const glm::vec3*> mGeneratedBitangents;    // Bitangents generated by the preload, for meshes which have none
     };
 }
@@ -254,6 +254,12 @@ namespace Falcor
 
     bool BinaryModelExporter::writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount)
     {
+        if(pMesh->getVertexQuantization().flags != 0)
+        {
+            error("Meshes with quantized vertex attributes can't be exported. Load the model without the Quantize* load flags.");
+            return false;
+        }
+
         auto pVao = pMesh->getVao();
         const uint32_t vertexBufferCount = pMesh->getVao()->getVertexBuffersCount();
         mStream << (int32_t)vertexBufferCount << (int32_t)pMesh->getVertexCount() << (int32_t)submeshCount;
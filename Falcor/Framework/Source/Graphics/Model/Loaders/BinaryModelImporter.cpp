@@ -39,6 +39,14 @@
 #include "API/Texture.h"
 #include "Graphics/Material/Material.h"
 #include "API/Device.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/CpuTimer.h"
+#include "VertexCacheOptimizer.h"
+#include "VertexQuantizer.h"
+#include "MeshletBuilder.h"
+#include "Graphics/TextureRegistry.h"
+#include "ModelPreload.h"
+#include <algorithm>
 #include <numeric>
 #include <cstring>
 
@@ -80,9 +88,13 @@ namespace Falcor
         return isSpecialFloat(v.x) || isSpecialFloat(v.y) || isSpecialFloat(v.z);
     }
 
+    /** Generate the bitangents of 'vertexCount' vertices.
+        If 'vertexIds' isn't null, 'indices' index into it and it holds the mesh vertex of every output bitangent. Otherwise the indices are mesh vertices.
+    */
     template<typename posType>
-    void generateSubmeshTangentData(
+    static void generateTangentData(
         const std::vector<uint32_t>& indices,
+        const uint32_t* vertexIds,
         uint32_t vertexCount,
         const posType* vertexPosData,
         const glm::vec3* vertexNormalData,
@@ -107,7 +119,7 @@ namespace Falcor
             // Get the data
             for(uint32_t i = 0; i < 3; i++)
             {
-                uint32_t index = indices[primID * 3 + i];
+                uint32_t index = vertexIds ? vertexIds[indices[primID * 3 + i]] : indices[primID * 3 + i];
                 V[i].position = vertexPosData[index];
                 V[i].normal = vertexNormalData[index];
                 V[i].uv = texCrdData ? texCrdData[index * texCrdCount] : vec2(0);
@@ -167,11 +179,27 @@ namespace Falcor
             bitangentData[v] = normalize(bitangentData[v]);
             if (isInvalidVec(bitangentData[v]))
             {
-                bitangentData[v] = projectNormalToBitangent(vertexNormalData[v]);
+                bitangentData[v] = projectNormalToBitangent(vertexNormalData[vertexIds ? vertexIds[v] : v]);
             }
         }
     }
 
+    template<typename posType>
+    void generateSubmeshTangentData(
+        const std::vector<uint32_t>& indices,
+        uint32_t vertexCount,
+        const posType* vertexPosData,
+        const glm::vec3* vertexNormalData,
+        const glm::vec2* texCrdData,
+        uint32_t texCrdCount,
+        glm::vec3* bitangentData)
+    {
+        generateTangentData<posType>(indices, nullptr, vertexCount, vertexPosData, vertexNormalData, texCrdData, texCrdCount, bitangentData);
+    }
+
+    // AssimpModelImporter declares and uses the vec3 version
+    template void generateSubmeshTangentData<glm::vec3>(const std::vector<uint32_t>&, uint32_t, const glm::vec3*, const glm::vec3*, const glm::vec2*, uint32_t, glm::vec3*);
+
     static void setTexture(Material* pMaterial, Texture::SharedPtr pTexture, TextureType texType, const std::string& modelName)
     {
         switch(texType)
@@ -490,6 +518,72 @@ namespace Falcor
         return success;
     }
 
+    namespace
+    {
+        /** Read-only view of a memory-mapped file, released when the view goes out of scope
+        */
+        struct MappedFileView
+        {
+            MappedFileView(const std::string& filename)
+            {
+                if(filename.size()) pData = (const uint8_t*)mapFileForReading(filename, size);
+            }
+            ~MappedFileView() { unmapFile(pData, size); }
+
+            const uint8_t* pData = nullptr;
+            size_t size = 0;
+        };
+    }
+
+    template<uint32_t kSize>
+    static void copyAttrib(const uint8_t* pSrc, size_t srcStride, uint8_t* pDst, uint32_t count)
+    {
+        // A constant-size memcpy compiles to plain (unaligned) register moves, one or two per element
+        for(uint32_t i = 0; i < count; i++)
+        {
+            std::memcpy(pDst, pSrc, kSize);
+            pSrc += srcStride;
+            pDst += kSize;
+        }
+    }
+
+    void BinaryModelImporter::deinterleaveVertices(const uint8_t* pSrc, uint32_t firstVertex, uint32_t vertexCount, const std::vector<VertexAttribCopy>& attribs)
+    {
+        size_t vertexSize = 0;
+        for(const auto& attrib : attribs)
+        {
+            vertexSize += attrib.size;
+        }
+
+        // Copy one attribute at a time over the whole range. Each pass streams through a single destination array.
+        const uint8_t* pVertex = pSrc + vertexSize * firstVertex;
+        for(const auto& attrib : attribs)
+        {
+            if(attrib.pDst)
+            {
+                uint8_t* pDst = attrib.pDst + (size_t)attrib.size * firstVertex;
+                switch(attrib.size)
+                {
+                case 1:  copyAttrib<1>(pVertex, vertexSize, pDst, vertexCount); break;
+                case 2:  copyAttrib<2>(pVertex, vertexSize, pDst, vertexCount); break;
+                case 4:  copyAttrib<4>(pVertex, vertexSize, pDst, vertexCount); break;
+                case 8:  copyAttrib<8>(pVertex, vertexSize, pDst, vertexCount); break;
+                case 12: copyAttrib<12>(pVertex, vertexSize, pDst, vertexCount); break;
+                case 16: copyAttrib<16>(pVertex, vertexSize, pDst, vertexCount); break;
+                default:
+                    for(uint32_t i = 0; i < vertexCount; i++)
+                    {
+                        std::memcpy(pDst + (size_t)attrib.size * i, pVertex + vertexSize * i, attrib.size);
+                    }
+                    break;
+                }
+            }
+            pVertex += attrib.size;
+        }
+    }
+
+    bool BinaryModelImporter::sBulkImportEnabled = true;
+
     BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
     {
     }
@@ -507,6 +601,28 @@ namespace Falcor
         return loader.importModel(model, flags);
     }
 
+    bool BinaryModelImporter::preload(const std::string& filename, ModelPreload& preload)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        if(findFileInDataDirectories(filename, preload.fullpath) == false)
+        {
+            logError(std::string("Can't find model file ") + filename);
+            return false;
+        }
+
+        // Touch every page of the file, so import() reads it from memory
+        MappedFileView mappedFile(preload.fullpath);
+        const size_t kPageSize = 4096;
+        volatile uint8_t sum = 0;
+        for(size_t offset = 0; offset < mappedFile.size; offset += kPageSize)
+        {
+            sum += mappedFile.pData[offset];
+        }
+
+        preload.preloadTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return true;
+    }
+
     static bool checkVersion(const std::string& formatID, uint32_t version, const std::string& modelName)
     {
         if(std::string(formatID) == "BinScene")
@@ -646,14 +762,56 @@ namespace Falcor
                 if(pData == other.pData) return format < other.format;
                 return false;
             }
-            bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
+            bool operator==(const TexSignature& other) const { return pData == other.pData && format == other.format; }
         };
         std::map<TexSignature, Texture::SharedPtr> textures;
         bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
 
-        // Load the meshes
+        // Vertex data is de-interleaved straight from the mapped file. If the file can't be mapped, it's read from the stream, one attribute at a time.
+        MappedFileView mappedFile(sBulkImportEnabled ? mModelName : std::string());
+
+        static const uint32_t kInvalidBufferIndex = (uint32_t)-1;
+
+        struct BufferData
+        {
+            std::vector<uint8_t> vec;
+            bool shouldSkip = false;
+            uint32_t elementSize = 0;
+        };
+
+        struct SubmeshData
+        {
+            Material::SharedPtr pMaterial;
+            std::vector<uint32_t> indices;
+            std::vector<glm::vec3> bitangents;      // Only if the mesh needs a generated tangent space
+            std::vector<uint16_t> packedBitangents; // The generated bitangents, if normals are quantized
+            std::vector<uint32_t> bitangentVertices;// The vertices referenced by the submesh, sorted. The generated bitangents only cover these
+            MeshletData meshlets;                   // Only if Model::LoadFlags::GenerateMeshlets is set
+            BoundingBox box;
+        };
+
+        struct MeshData
+        {
+            VertexLayout::SharedPtr pLayout;
+            std::vector<BufferData> buffers;
+            int32_t numAttribs = 0;
+            int32_t numVertices = 0;
+            uint32_t positionBufferIndex = kInvalidBufferIndex;
+            uint32_t normalBufferIndex = kInvalidBufferIndex;
+            uint32_t bitangentBufferIndex = kInvalidBufferIndex;
+            uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+            bool genTangentForMesh = false;
+            const uint8_t* pVertexData = nullptr;   // Interleaved vertices in the mapped file, if they still need to be de-interleaved
+            std::vector<SubmeshData> submeshes;
+            Mesh::VertexQuantization quantization;
+        };
+        std::vector<MeshData> meshes(numMeshes);
+
+        // Parse the meshes. This creates the layouts, materials and textures and reads the indices, but leaves the vertex data in the mapped file.
         for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
         {
+            MeshData& mesh = meshes[meshIdx];
+
             // Mesh header
             int32_t numAttribs = 0;
             int32_t numVertices = 0;
@@ -677,26 +835,13 @@ namespace Falcor
                 return false;
             }
 
-            Vao::BufferVec pVBs;
-            VertexLayout::SharedPtr pLayout = VertexLayout::create();
-            
-            struct BufferData
-            {
-                std::vector<uint8_t> vec;
-                bool shouldSkip = false;
-                uint32_t elementSize = 0;
-            };
-
-            std::vector<BufferData> buffers;
-            pVBs.resize(numAttribs);
+            mesh.numAttribs = numAttribs;
+            mesh.numVertices = numVertices;
+            mesh.pLayout = VertexLayout::create();
+            VertexLayout::SharedPtr& pLayout = mesh.pLayout;
+            std::vector<BufferData>& buffers = mesh.buffers;
             buffers.resize(numAttribs);
 
-            const uint32_t kInvalidBufferIndex = (uint32_t)-1;
-            uint32_t positionBufferIndex = kInvalidBufferIndex;
-            uint32_t normalBufferIndex = kInvalidBufferIndex;
-            uint32_t bitangentBufferIndex = kInvalidBufferIndex;
-            uint32_t texCoordBufferIndex = kInvalidBufferIndex;
-
             for(int i = 0; i < numAttribs; i++)
             {
                 VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
@@ -719,19 +864,19 @@ namespace Falcor
                     switch (shaderLocation)
                     {
                     case VERTEX_POSITION_LOC:
-                        positionBufferIndex = i;
+                        mesh.positionBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float || falcorFormat == ResourceFormat::RGBA32Float);
                         break;
                     case VERTEX_NORMAL_LOC:
-                        normalBufferIndex = i;
+                        mesh.normalBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float);
                         break;
                     case VERTEX_BITANGENT_LOC:
-                        bitangentBufferIndex = i;
+                        mesh.bitangentBufferIndex = i;
                         assert(falcorFormat == ResourceFormat::RGB32Float);
                         break;
                     case VERTEX_TEXCOORD_LOC:
-                        texCoordBufferIndex = i;
+                        mesh.texCoordBufferIndex = i;
                         break;
                     }
 
@@ -739,7 +884,11 @@ namespace Falcor
                     if(shaderLocation != kUnusedShaderElement)
                     {
                         pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
-                        buffers[i].vec.resize(buffers[i].elementSize * numVertices);
+                        // Vertices de-interleaved from the mapped file are only allocated when their batch is processed
+                        if(mappedFile.pData == nullptr)
+                        {
+                            buffers[i].vec.resize(buffers[i].elementSize * numVertices);
+                        }
                     }
                     else
                     {
@@ -750,59 +899,64 @@ namespace Falcor
 
             
             // Check if we need to generate tangents  
-            bool genTangentForMesh = false;
-            if(shouldGenerateTangents && (bitangentBufferIndex == kInvalidBufferIndex))
+            if(shouldGenerateTangents && (mesh.bitangentBufferIndex == kInvalidBufferIndex))
             {
-                if(normalBufferIndex == kInvalidBufferIndex)
+                if(mesh.normalBufferIndex == kInvalidBufferIndex)
                 {
                     logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain normals coordinates\n");
-                    genTangentForMesh = false;
+                    mesh.genTangentForMesh = false;
                 }
                 else
                 {
                     // Set the offsets
-                    genTangentForMesh = true;
-                    bitangentBufferIndex = (uint32_t)pVBs.size();
-                    pVBs.resize(bitangentBufferIndex + 1);
-                    buffers.resize(bitangentBufferIndex + 1);
+                    mesh.genTangentForMesh = true;
+                    mesh.bitangentBufferIndex = (uint32_t)buffers.size();
+                    buffers.resize(mesh.bitangentBufferIndex + 1);
                    
                     auto pBitangentLayout = VertexBufferLayout::create();
-                    pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
+                    pLayout->addBufferLayout(mesh.bitangentBufferIndex, pBitangentLayout);
                     pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
-                    buffers[bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
                 }
             }
             
-
-            // Read the data, one vertex at a time
-            for(int32_t i = 0; i < numVertices; i++)
+            uint64_t vertexSize = 0;
+            for(int32_t i = 0; i < numAttribs; i++)
             {
-                for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
-                {
-                    if (buffers[attributes].shouldSkip)
-                    {
-                        mStream.skip(buffers[attributes].elementSize);
-                    }
-                    else
-                    {
-                        uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
-                        uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
-                        mStream.read(pDest, stride);
-                    }
-                }
+                vertexSize += buffers[i].elementSize;
             }
 
-            Buffer::BindFlags vbBindFlags = Buffer::BindFlags::Vertex;
-            if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+            if(mappedFile.pData)
             {
-                vbBindFlags |= Buffer::BindFlags::ShaderResource;
+                // Validate the vertex block against the file size, then skip it. It is de-interleaved below.
+                uint64_t vertexOffset = mStream.getReadPosition();
+                uint64_t vertexBytes = vertexSize * (uint64_t)numVertices;
+                if(vertexOffset > mappedFile.size || vertexBytes > mappedFile.size - vertexOffset)
+                {
+                    std::string msg = "Error when loading model " + mModelName + ".\nVertex data exceeds the file size!";
+                    logError(msg);
+                    return false;
+                }
+                mesh.pVertexData = mappedFile.pData + vertexOffset;
+                mStream.setReadPosition(vertexOffset + vertexBytes);
             }
-
-            for (int32_t i = 0; i < numAttribs; ++i)
+            else
             {
-                if(buffers[i].shouldSkip == false)
+                // Read the data, one vertex at a time
+                for(int32_t i = 0; i < numVertices; i++)
                 {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), vbBindFlags, Buffer::CpuAccess::None, buffers[i].vec.data());
+                    for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
+                    {
+                        if (buffers[attributes].shouldSkip)
+                        {
+                            mStream.skip(buffers[attributes].elementSize);
+                        }
+                        else
+                        {
+                            uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
+                            uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
+                            mStream.read(pDest, stride);
+                        }
+                    }
                 }
             }
 
@@ -814,6 +968,7 @@ namespace Falcor
 
             // Array of Submesh.
             // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
+            mesh.submeshes.resize(numSubmeshes);
             for(int submesh = 0; submesh < numSubmeshes; submesh++)
             {
                 // create the material
@@ -861,8 +1016,12 @@ namespace Falcor
                         }
                         else
                         {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
-                            pTexture->setSourceFilename(texData[texID].name);
+                            // Textures with the same content in other files or models are shared through the registry
+                            auto pTexture = TextureRegistry::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData, texData[texID].data.size());
+                            if(pTexture->getSourceFilename().empty())
+                            {
+                                pTexture->setSourceFilename(texData[texID].name);
+                            }
                             textures[texSig] = pTexture;
                             setTexture(pMaterial.get(), pTexture, TextureType(i), mModelName);
                         }
@@ -870,7 +1029,7 @@ namespace Falcor
                 }
 
                 // Create material and check if it already exists
-                pMaterial = checkForExistingMaterial(pMaterial);
+                mesh.submeshes[submesh].pMaterial = checkForExistingMaterial(pMaterial);
 
                 int32_t numTriangles;
                 mStream >> numTriangles;
@@ -881,75 +1040,442 @@ namespace Falcor
                     return false;
                 }
 
-                // create the index buffer
                 uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
+                std::vector<uint32_t>& indices = mesh.submeshes[submesh].indices;
+                indices.resize(numIndices);
                 uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
+                mStream.read(indices.data(), ibSize);
+            }
+        }
+
+        Buffer::BindFlags vbBindFlags = Buffer::BindFlags::Vertex;
+        Buffer::BindFlags ibBindFlags = Buffer::BindFlags::Index;
+        if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+        {
+            vbBindFlags |= Buffer::BindFlags::ShaderResource;
+            ibBindFlags |= Buffer::BindFlags::ShaderResource;
+        }
 
+        const bool shouldGenerateMeshlets = is_set(flags, Model::LoadFlags::GenerateMeshlets);
 
-                Buffer::BindFlags ibBindFlags = Buffer::BindFlags::Index;
-                if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+        // The CPU-side work of a submesh. Submeshes only read the shared vertex data, so they can be processed concurrently.
+        auto processSubmesh = [shouldGenerateMeshlets](const MeshData& mesh, SubmeshData& submesh)
+        {
+            const VertexLayout::SharedPtr& pLayout = mesh.pLayout;
+            const std::vector<BufferData>& buffers = mesh.buffers;
+            std::vector<uint32_t>& indices = submesh.indices;
+            const uint32_t numVertices = (uint32_t)mesh.numVertices;
+
+            if(shouldGenerateMeshlets)
+            {
+                const BufferData& positions = buffers[mesh.positionBufferIndex];
+                submesh.meshlets = MeshletBuilder::build(indices.data(), (uint32_t)indices.size(), positions.vec.data(), positions.elementSize, numVertices);
+            }
+
+            // Generate tangent space data if needed
+            if(mesh.genTangentForMesh)
+            {
+                uint32_t texCrdCount = 0;
+                const glm::vec2* texCrd = nullptr;
+                if(mesh.texCoordBufferIndex != kInvalidBufferIndex)
                 {
-                    ibBindFlags |= Buffer::BindFlags::ShaderResource;
+                    texCrdCount = pLayout->getBufferLayout(mesh.texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
+                    texCrd = (const glm::vec2*)buffers[mesh.texCoordBufferIndex].vec.data();
                 }
-                auto pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, indices.data());
 
-                // Generate tangent space data if needed
-                if(genTangentForMesh)
+                // Work on the range of vertices the submesh references, so a mesh with many submeshes doesn't need a mesh-sized buffer for each of them
+                std::vector<uint32_t>& vertexIds = submesh.bitangentVertices;
+                vertexIds = indices;
+                std::sort(vertexIds.begin(), vertexIds.end());
+                vertexIds.erase(std::unique(vertexIds.begin(), vertexIds.end()), vertexIds.end());
+                std::vector<uint32_t> localIndices(indices.size());
+                for(size_t i = 0; i < indices.size(); i++)
                 {
-                    uint32_t texCrdCount = 0;
-                    glm::vec2* texCrd = nullptr;
-                    if(texCoordBufferIndex != kInvalidBufferIndex)
+                    localIndices[i] = (uint32_t)(std::lower_bound(vertexIds.begin(), vertexIds.end(), indices[i]) - vertexIds.begin());
+                }
+
+                ResourceFormat posFormat = pLayout->getBufferLayout(mesh.positionBufferIndex)->getElementFormat(0);
+                submesh.bitangents.resize(vertexIds.size());
+
+                if (posFormat == ResourceFormat::RGB32Float)
+                {
+                    generateTangentData<glm::vec3>(localIndices, vertexIds.data(), (uint32_t)vertexIds.size(), (const glm::vec3*)buffers[mesh.positionBufferIndex].vec.data(), (const glm::vec3*)buffers[mesh.normalBufferIndex].vec.data(), texCrd, texCrdCount, submesh.bitangents.data());
+                }
+                else if (posFormat == ResourceFormat::RGBA32Float)
+                {
+                    generateTangentData<glm::vec4>(localIndices, vertexIds.data(), (uint32_t)vertexIds.size(), (const glm::vec4*)buffers[mesh.positionBufferIndex].vec.data(), (const glm::vec3*)buffers[mesh.normalBufferIndex].vec.data(), texCrd, texCrdCount, submesh.bitangents.data());
+                }
+            }
+
+            // Calculate the bounding-box
+            glm::vec3 max, min;
+            const uint32_t posStride = pLayout->getBufferLayout(mesh.positionBufferIndex)->getStride();
+            const uint8_t* pPositions = buffers[mesh.positionBufferIndex].vec.data();
+            for(uint32_t vertexID : indices)
+            {
+                const float* pPosition = (const float*)(pPositions + posStride * vertexID);
+                glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
+                min = glm::min(min, xyz);
+                max = glm::max(max, xyz);
+            }
+            submesh.box = BoundingBox::fromMinMax(min, max);
+        };
+
+        // Reorder the triangles of each submesh for the post-transform cache, then lay out the mesh's vertices in the order they are first used
+        auto optimizeVertexCache = [](MeshData& mesh, VertexCacheOptimizer::Stats& before, VertexCacheOptimizer::Stats& after)
+        {
+            const uint32_t numVertices = (uint32_t)mesh.numVertices;
+            std::vector<uint32_t> meshIndices;
+            for(SubmeshData& submesh : mesh.submeshes)
+            {
+                std::vector<uint32_t>& indices = submesh.indices;
+                before += VertexCacheOptimizer::analyze(indices.data(), (uint32_t)indices.size(), numVertices);
+                VertexCacheOptimizer::optimizeTriangleOrder(indices.data(), (uint32_t)indices.size(), numVertices);
+                after += VertexCacheOptimizer::analyze(indices.data(), (uint32_t)indices.size(), numVertices);
+                meshIndices.insert(meshIndices.end(), indices.begin(), indices.end());
+            }
+
+            // The submeshes share the vertex buffers, so the vertex order is computed over all of their indices
+            std::vector<uint32_t> remap = VertexCacheOptimizer::optimizeVertexFetch(meshIndices.data(), (uint32_t)meshIndices.size(), numVertices);
+            auto it = meshIndices.begin();
+            for(SubmeshData& submesh : mesh.submeshes)
+            {
+                std::copy(it, it + submesh.indices.size(), submesh.indices.begin());
+                it += submesh.indices.size();
+            }
+            for(int32_t i = 0; i < mesh.numAttribs; i++)
+            {
+                if(mesh.buffers[i].shouldSkip == false)
+                {
+                    VertexCacheOptimizer::remapVertexBuffer(mesh.buffers[i].vec.data(), mesh.buffers[i].elementSize, remap);
+                }
+            }
+        };
+
+        // Re-encode the vertex buffers of a mesh in the quantized formats. Runs after the tangent space and the bounding boxes are generated, since those need the full precision data.
+        auto quantizeMesh = [](MeshData& mesh, uint32_t quantizationFlags, VertexQuantizer::Report& report)
+        {
+            const uint32_t numVertices = (uint32_t)mesh.numVertices;
+            std::vector<BufferData>& buffers = mesh.buffers;
+            VertexLayout::SharedPtr& pLayout = mesh.pLayout;
+
+            auto getBytes = [&]()
+            {
+                uint64_t bytes = 0;
+                for(const BufferData& buffer : buffers) bytes += buffer.shouldSkip ? 0 : buffer.vec.size();
+                // The submesh bitangents are uploaded as mesh-sized buffers
+                if(mesh.genTangentForMesh)
+                {
+                    for(const SubmeshData& submesh : mesh.submeshes) bytes += numVertices * (submesh.packedBitangents.size() ? 2 * sizeof(uint16_t) : sizeof(glm::vec3));
+                }
+                return bytes;
+            };
+
+            // Replace a vertex buffer with its encoded data
+            auto setBuffer = [&](uint32_t index, const std::vector<uint16_t>& encoded, ResourceFormat format, uint32_t location)
+            {
+                buffers[index].vec.assign((const uint8_t*)encoded.data(), (const uint8_t*)(encoded.data() + encoded.size()));
+                buffers[index].elementSize = getFormatBytesPerBlock(format);
+                VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+                pBufferLayout->addElement(pLayout->getBufferLayout(index)->getElementName(0), 0, format, 1, location);
+                pLayout->addBufferLayout(index, pBufferLayout);
+            };
+
+            report.meshCount += (uint32_t)mesh.submeshes.size();
+            report.bytesBefore += getBytes();
+
+            // Area lights read the vertex data of emissive meshes on the CPU
+            bool isEmissive = false;
+            for(const SubmeshData& submesh : mesh.submeshes)
+            {
+                isEmissive |= EXTRACT_EMISSIVE_TYPE(submesh.pMaterial->getFlags()) != ChannelTypeUnused;
+            }
+
+            if(isEmissive == false)
+            {
+                if((quantizationFlags & VERTEX_QUANTIZE_POSITION) && (mesh.positionBufferIndex != kInvalidBufferIndex))
+                {
+                    const BufferData& positions = buffers[mesh.positionBufferIndex];
+                    glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+                    for(uint32_t v = 0; v < numVertices; v++)
                     {
-                        texCrdCount = pLayout->getBufferLayout(texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
-                        texCrd = (glm::vec2*)buffers[texCoordBufferIndex].vec.data();
+                        const float* pPosition = (const float*)(positions.vec.data() + positions.elementSize * v);
+                        glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
+                        boxMin = glm::min(boxMin, xyz);
+                        boxMax = glm::max(boxMax, xyz);
                     }
 
-                    ResourceFormat posFormat = pLayout->getBufferLayout(positionBufferIndex)->getElementFormat(0);
+                    Mesh::VertexQuantization& quantization = mesh.quantization;
+                    VertexQuantizer::getPositionDecode(boxMin, boxMax, quantization.positionScale, quantization.positionOffset);
+                    std::vector<uint16_t> encoded(4 * numVertices);
+                    float error = VertexQuantizer::quantizePositions(positions.vec.data(), positions.elementSize, numVertices, quantization.positionScale, quantization.positionOffset, encoded.data());
+                    report.maxPositionError = std::max(report.maxPositionError, error);
+                    setBuffer(mesh.positionBufferIndex, encoded, ResourceFormat::RGBA16Snorm, VERTEX_POSITION_LOC);
+                    quantization.flags |= VERTEX_QUANTIZE_POSITION;
+                }
+
+                if((quantizationFlags & VERTEX_QUANTIZE_NORMAL) && (mesh.normalBufferIndex != kInvalidBufferIndex))
+                {
+                    std::vector<uint16_t> encoded(2 * numVertices);
+                    float error = VertexQuantizer::quantizeUnitVectors(buffers[mesh.normalBufferIndex].vec.data(), sizeof(glm::vec3), numVertices, encoded.data());
+                    report.maxNormalError = std::max(report.maxNormalError, error);
+                    setBuffer(mesh.normalBufferIndex, encoded, ResourceFormat::RG16Snorm, VERTEX_NORMAL_LOC);
 
-                    if (posFormat == ResourceFormat::RGB32Float)
+                    if(mesh.genTangentForMesh)
                     {
-                        generateSubmeshTangentData<glm::vec3>(indices, numVertices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                        for(SubmeshData& submesh : mesh.submeshes)
+                        {
+                            submesh.packedBitangents.resize(2 * submesh.bitangents.size());
+                            error = VertexQuantizer::quantizeUnitVectors(submesh.bitangents.data(), sizeof(glm::vec3), (uint32_t)submesh.bitangents.size(), submesh.packedBitangents.data());
+                            report.maxNormalError = std::max(report.maxNormalError, error);
+                            submesh.bitangents = std::vector<glm::vec3>();
+                        }
+                        VertexBufferLayout::SharedPtr pBitangentLayout = VertexBufferLayout::create();
+                        pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RG16Snorm, 1, VERTEX_BITANGENT_LOC);
+                        pLayout->addBufferLayout(mesh.bitangentBufferIndex, pBitangentLayout);
                     }
-                    else if (posFormat == ResourceFormat::RGBA32Float)
+                    else if(mesh.bitangentBufferIndex != kInvalidBufferIndex)
                     {
-                        generateSubmeshTangentData<glm::vec4>(indices, numVertices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                        error = VertexQuantizer::quantizeUnitVectors(buffers[mesh.bitangentBufferIndex].vec.data(), sizeof(glm::vec3), numVertices, encoded.data());
+                        report.maxNormalError = std::max(report.maxNormalError, error);
+                        setBuffer(mesh.bitangentBufferIndex, encoded, ResourceFormat::RG16Snorm, VERTEX_BITANGENT_LOC);
                     }
-
-                    pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
+                    mesh.quantization.flags |= VERTEX_QUANTIZE_NORMAL;
                 }
-                
 
-                // Calculate the bounding-box
-                glm::vec3 max, min;
-                for(uint32_t i = 0; i < numIndices; i++)
+                if((quantizationFlags & VERTEX_QUANTIZE_TEXCOORD) && (mesh.texCoordBufferIndex != kInvalidBufferIndex))
                 {
-                    uint32_t vertexID = indices[i];
-                    uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].vec.data();
+                    // Only float coordinates are converted. Tiled coordinates which half floats can't represent precisely enough are kept as they are.
+                    const BufferData& texCrds = buffers[mesh.texCoordBufferIndex];
+                    ResourceFormat format = pLayout->getBufferLayout(mesh.texCoordBufferIndex)->getElementFormat(0);
+                    if(format == ResourceFormat::RG32Float || format == ResourceFormat::RGB32Float)
+                    {
+                        std::vector<uint16_t> encoded(2 * numVertices);
+                        float error = VertexQuantizer::quantizeTexCoords(texCrds.vec.data(), texCrds.elementSize, numVertices, encoded.data());
+                        if(error <= VertexQuantizer::kMaxTexCoordError)
+                        {
+                            report.maxTexCoordError = std::max(report.maxTexCoordError, error);
+                            setBuffer(mesh.texCoordBufferIndex, encoded, ResourceFormat::RG16Float, VERTEX_TEXCOORD_LOC);
+                            mesh.quantization.flags |= VERTEX_QUANTIZE_TEXCOORD;
+                        }
+                    }
+                }
+            }
+
+            if(mesh.quantization.flags) report.quantizedMeshCount += (uint32_t)mesh.submeshes.size();
+            report.bytesAfter += getBytes();
+        };
 
-                    float* pPosition = (float*)pVertex;
+        uint32_t quantizationFlags = 0;
+        if(is_set(flags, Model::LoadFlags::QuantizePositions)) quantizationFlags |= VERTEX_QUANTIZE_POSITION;
+        if(is_set(flags, Model::LoadFlags::QuantizeNormals))   quantizationFlags |= VERTEX_QUANTIZE_NORMAL;
+        if(is_set(flags, Model::LoadFlags::QuantizeTexCoords)) quantizationFlags |= VERTEX_QUANTIZE_TEXCOORD;
+        std::vector<VertexQuantizer::Report> quantizationReports(quantizationFlags ? numMeshes : 0);
 
-                    glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
-                    min = glm::min(min, xyz);
-                    max = glm::max(max, xyz);
+        const bool shouldOptimizeVertexCache = is_set(flags, Model::LoadFlags::OptimizeVertexCache);
+        std::vector<VertexCacheOptimizer::Stats> cacheStatsBefore(numMeshes), cacheStatsAfter(numMeshes);
+        MeshletBuilder::Stats meshletStats;
+
+        // Each submesh gets its own bitangents for the vertices it references. Meshes are processed in batches, so the de-interleaved vertices and the bitangents held in memory at once stay bounded.
+        const uint64_t kBatchScratchBytes = 512ull * 1024 * 1024;
+        const uint32_t kVerticesPerJob = 4096;
+
+        struct DeinterleaveJob
+        {
+            uint32_t meshIdx;
+            uint32_t firstVertex;
+            uint32_t vertexCount;
+        };
+
+        struct SubmeshJob
+        {
+            uint32_t meshIdx;
+            uint32_t submeshIdx;
+        };
+
+        std::vector<std::vector<VertexAttribCopy>> meshAttribs(numMeshes);
+        std::vector<DeinterleaveJob> deinterleaveJobs;
+        std::vector<SubmeshJob> submeshJobs;
+
+        for(int batchStart = 0; batchStart < numMeshes; )
+        {
+            // Collect the batch
+            int batchEnd = batchStart;
+            uint64_t batchScratch = 0;
+            deinterleaveJobs.clear();
+            submeshJobs.clear();
+            while(batchEnd < numMeshes && (batchEnd == batchStart || batchScratch < kBatchScratchBytes))
+            {
+                MeshData& mesh = meshes[batchEnd];
+                if(mesh.pVertexData)
+                {
+                    meshAttribs[batchEnd].resize(mesh.numAttribs);
+                    for(int32_t i = 0; i < mesh.numAttribs; i++)
+                    {
+                        if(mesh.buffers[i].shouldSkip == false)
+                        {
+                            mesh.buffers[i].vec.resize(mesh.buffers[i].elementSize * (size_t)mesh.numVertices);
+                            batchScratch += mesh.buffers[i].vec.size();
+                        }
+                        meshAttribs[batchEnd][i].size = mesh.buffers[i].elementSize;
+                        meshAttribs[batchEnd][i].pDst = mesh.buffers[i].shouldSkip ? nullptr : mesh.buffers[i].vec.data();
+                    }
+                    for(uint32_t first = 0; first < (uint32_t)mesh.numVertices; first += kVerticesPerJob)
+                    {
+                        deinterleaveJobs.push_back({ (uint32_t)batchEnd, first, std::min(kVerticesPerJob, (uint32_t)mesh.numVertices - first) });
+                    }
+                }
+                for(uint32_t submesh = 0; submesh < (uint32_t)mesh.submeshes.size(); submesh++)
+                {
+                    submeshJobs.push_back({ (uint32_t)batchEnd, submesh });
+                    if(mesh.genTangentForMesh)
+                    {
+                        // A submesh references at most as many vertices as it has indices
+                        uint64_t vertexCount = std::min((uint64_t)mesh.numVertices, (uint64_t)mesh.submeshes[submesh].indices.size());
+                        batchScratch += (sizeof(glm::vec3) + sizeof(uint32_t)) * vertexCount;
+                    }
                 }
+                batchEnd++;
+            }
 
-                BoundingBox box = BoundingBox::fromMinMax(min, max);
+            // De-interleave the vertex data. Large meshes are split into chunks that fit in the cache, so the attribute passes over a chunk hit L2.
+            parallelFor((uint32_t)deinterleaveJobs.size(), [&](uint32_t jobIdx)
+            {
+                const DeinterleaveJob& job = deinterleaveJobs[jobIdx];
+                deinterleaveVertices(meshes[job.meshIdx].pVertexData, job.firstVertex, job.vertexCount, meshAttribs[job.meshIdx]);
+            });
 
-                // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+            if(shouldOptimizeVertexCache)
+            {
+                parallelFor(uint32_t(batchEnd - batchStart), [&](uint32_t i)
+                {
+                    uint32_t meshIdx = batchStart + i;
+                    optimizeVertexCache(meshes[meshIdx], cacheStatsBefore[meshIdx], cacheStatsAfter[meshIdx]);
+                });
+            }
 
-                if (version >= 6)
+            // Generate the tangent space and the bounding box of every submesh
+            parallelFor((uint32_t)submeshJobs.size(), [&](uint32_t jobIdx)
+            {
+                MeshData& mesh = meshes[submeshJobs[jobIdx].meshIdx];
+                SubmeshData& submesh = mesh.submeshes[submeshJobs[jobIdx].submeshIdx];
+                processSubmesh(mesh, submesh);
+            });
+
+            if(quantizationFlags)
+            {
+                parallelFor(uint32_t(batchEnd - batchStart), [&](uint32_t i)
+                {
+                    uint32_t meshIdx = batchStart + i;
+                    quantizeMesh(meshes[meshIdx], quantizationFlags, quantizationReports[meshIdx]);
+                });
+            }
+
+            // Create the GPU resources and the meshes. Falcor's render context isn't thread-safe, so this stays on the loading thread.
+            // The bitangent buffers cover all the mesh's vertices. They are expanded from the submesh's own vertices one at a time, vertices the submesh doesn't reference are left zero.
+            std::vector<glm::vec3> bitangentStaging;
+            std::vector<uint16_t> packedBitangentStaging;
+            for(int meshIdx = batchStart; meshIdx < batchEnd; meshIdx++)
+            {
+                MeshData& mesh = meshes[meshIdx];
+                std::vector<BufferData>& buffers = mesh.buffers;
+
+                Vao::BufferVec pVBs(buffers.size());
+                for (int32_t i = 0; i < mesh.numAttribs; ++i)
                 {
-                    falcorMeshCache.push_back(pMesh);
-                    meshToSubmeshesID[meshIdx].push_back((uint32_t)(falcorMeshCache.size() - 1));
+                    if(buffers[i].shouldSkip == false)
+                    {
+                        pVBs[i] = Buffer::create(buffers[i].vec.size(), vbBindFlags, Buffer::CpuAccess::None, buffers[i].vec.data());
+                        buffers[i].vec = std::vector<uint8_t>();
+                    }
                 }
-                else
+
+                for(SubmeshData& submesh : mesh.submeshes)
                 {
-                    model.addMeshInstance(pMesh, glm::mat4());
+                    uint32_t numIndices = (uint32_t)submesh.indices.size();
+                    uint32_t ibSize = numIndices * sizeof(uint32_t);
+
+                    // create the index buffer
+                    auto pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, submesh.indices.data());
+
+                    if(mesh.genTangentForMesh)
+                    {
+                        const std::vector<uint32_t>& vertexIds = submesh.bitangentVertices;
+                        if(submesh.packedBitangents.size())
+                        {
+                            packedBitangentStaging.assign(2 * (size_t)mesh.numVertices, 0);
+                            for(size_t v = 0; v < vertexIds.size(); v++)
+                            {
+                                packedBitangentStaging[2 * vertexIds[v]] = submesh.packedBitangents[2 * v];
+                                packedBitangentStaging[2 * vertexIds[v] + 1] = submesh.packedBitangents[2 * v + 1];
+                            }
+                            pVBs[mesh.bitangentBufferIndex] = Buffer::create(packedBitangentStaging.size() * sizeof(uint16_t), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, packedBitangentStaging.data());
+                        }
+                        else
+                        {
+                            bitangentStaging.assign(mesh.numVertices, glm::vec3(0));
+                            for(size_t v = 0; v < vertexIds.size(); v++)
+                            {
+                                bitangentStaging[vertexIds[v]] = submesh.bitangents[v];
+                            }
+                            pVBs[mesh.bitangentBufferIndex] = Buffer::create(bitangentStaging.size() * sizeof(glm::vec3), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, bitangentStaging.data());
+                        }
+
+                        // Only the GPU copy is needed from here on
+                        submesh.bitangents = std::vector<glm::vec3>();
+                        submesh.packedBitangents = std::vector<uint16_t>();
+                    }
+
+                    // create the mesh
+                    auto pMesh = Mesh::create(pVBs, (uint32_t)mesh.numVertices, pIB, numIndices, mesh.pLayout, Vao::Topology::TriangleList, submesh.pMaterial, submesh.box, false);
+                    pMesh->mVertexQuantization = mesh.quantization;
+                    if(submesh.meshlets.meshlets.size())
+                    {
+                        meshletStats += MeshletBuilder::getStats(submesh.meshlets);
+                        pMesh->mpMeshlets = std::make_shared<MeshletData>(std::move(submesh.meshlets));
+                    }
+
+                    if (version >= 6)
+                    {
+                        falcorMeshCache.push_back(pMesh);
+                        meshToSubmeshesID[meshIdx].push_back((uint32_t)(falcorMeshCache.size() - 1));
+                    }
+                    else
+                    {
+                        model.addMeshInstance(pMesh, glm::mat4());
+                    }
                 }
+
+                // Release the CPU copy of the mesh as soon as it is on the GPU
+                mesh = MeshData();
+            }
+            batchStart = batchEnd;
+        }
+
+        if(shouldOptimizeVertexCache)
+        {
+            VertexCacheOptimizer::Stats before, after;
+            for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
+            {
+                before += cacheStatsBefore[meshIdx];
+                after += cacheStatsAfter[meshIdx];
             }
+            logInfo(VertexCacheOptimizer::getReport(mModelName, before, after));
+        }
+
+        if(quantizationFlags)
+        {
+            VertexQuantizer::Report report;
+            for(const VertexQuantizer::Report& meshReport : quantizationReports)
+            {
+                report += meshReport;
+            }
+            logInfo(report.getString(mModelName));
+        }
+
+        if(shouldGenerateMeshlets)
+        {
+            logInfo(MeshletBuilder::getReport(mModelName, meshletStats));
         }
 
         if(version >= 6)
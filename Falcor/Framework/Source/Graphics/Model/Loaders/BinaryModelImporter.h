@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "Utils/BinaryFileStream.h"
 #include "glm/vec3.hpp"
 #include "../Model.h"
@@ -35,6 +36,7 @@
 namespace Falcor
 {
     class Texture;
+    struct ModelPreload;
 
     class BinaryModelImporter : public ModelImporter
     {
@@ -46,6 +48,37 @@ namespace Falcor
         */
         static bool import(Model& model, const std::string& filename, Model::LoadFlags flags);
 
+        /** Run the CPU part of an import ahead of import(), on any thread.
+            The binary format interleaves the data of the GPU resources with their description, so the file is only read into the OS file cache here. Most of the CPU work of import() is already spread over multiple threads.
+            \param[in] filename Model's filename. Loader will look for it in the data directories.
+            \param[out] preload Receives the full path of the file
+            \return Whether the file was found
+        */
+        static bool preload(const std::string& filename, ModelPreload& preload);
+
+        /** One attribute of interleaved vertex data, see deinterleaveVertices()
+        */
+        struct VertexAttribCopy
+        {
+            uint32_t size = 0;          ///< Size of the attribute in bytes
+            uint8_t* pDst = nullptr;    ///< Start of the destination array, one element per vertex. nullptr to skip the attribute.
+        };
+
+        /** Copy interleaved vertices into one tightly packed array per attribute.
+            The attributes of a vertex are stored back to back in the order of attribs. Only vertices [firstVertex, firstVertex + vertexCount) are copied, so ranges can be processed in parallel.
+            \param[in] pSrc Start of the interleaved vertex data
+            \param[in] firstVertex First vertex to copy
+            \param[in] vertexCount Number of vertices to copy
+            \param[in] attribs Attribute descriptions
+        */
+        static void deinterleaveVertices(const uint8_t* pSrc, uint32_t firstVertex, uint32_t vertexCount, const std::vector<VertexAttribCopy>& attribs);
+
+        /** Enable or disable the bulk import path.
+            When enabled (the default), the file is memory-mapped and vertex data is de-interleaved in bulk, on multiple threads. When disabled, or if the file can't be mapped, vertices are read one attribute at a time from the file stream.
+            Both paths produce identical models. Used for testing and benchmarking.
+        */
+        static void setBulkImportEnabled(bool enabled) { sBulkImportEnabled = enabled; }
+
     private:
         BinaryModelImporter(const std::string& fullpath);
         bool importModel(Model& model, Model::LoadFlags flags);
@@ -60,5 +93,6 @@ namespace Falcor
         };
 
         static const uint32_t kInvalidOffset = uint32_t(-1);
+        static bool sBulkImportEnabled;
     };
 }
@@ -0,0 +1,322 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidTriangle = uint32_t(-1);
+        const uint16_t kNotInMeshlet = 0xFFFF;
+
+        // Meshlets with normals spread wider than this are rarely entirely back-facing, so they don't get a normal cone
+        const float kMinConeDot = 0.1f;
+        const float kNoConeCutoff = 2.0f;
+
+        struct PositionReader
+        {
+            const uint8_t* pData;
+            uint32_t stride;
+
+            vec3 operator[](uint32_t index) const
+            {
+                const float* pPosition = (const float*)(pData + (size_t)stride * index);
+                return vec3(pPosition[0], pPosition[1], pPosition[2]);
+            }
+        };
+    }
+
+    MeshletData MeshletBuilder::build(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        assert(indexCount % 3 == 0);
+        assert(maxVertices >= 3 && maxVertices <= 256 && maxTriangles > 0);
+        const uint32_t triangleCount = indexCount / 3;
+        const PositionReader positions = { (const uint8_t*)pPositions, positionStride };
+
+        // Build the vertex to triangle adjacency
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            assert(pIndices[i] < vertexCount);
+            adjacencyOffsets[pIndices[i] + 1]++;
+        }
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        std::vector<uint32_t> adjacency(indexCount);
+        std::vector<uint32_t> liveTriangles(vertexCount);  // Number of adjacent triangles which aren't in a meshlet yet
+        {
+            std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t i = 0; i < indexCount; i++)
+            {
+                adjacency[fillOffsets[pIndices[i]]++] = i / 3;
+                liveTriangles[pIndices[i]]++;
+            }
+        }
+
+        std::vector<vec3> centroids(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            centroids[t] = (positions[pIndices[t * 3]] + positions[pIndices[t * 3 + 1]] + positions[pIndices[t * 3 + 2]]) / 3.0f;
+        }
+
+        MeshletData data;
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        std::vector<uint16_t> localIndex(vertexCount, kNotInMeshlet);
+        std::vector<uint32_t> sortedIndices;
+        sortedIndices.reserve(indexCount);
+        data.primitiveIndices.reserve(indexCount);
+
+        Meshlet meshlet;
+        vec3 centroidSum(0);
+
+        auto countNewVertices = [&](uint32_t t)
+        {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; k++) count += (localIndex[pIndices[t * 3 + k]] == kNotInMeshlet) ? 1 : 0;
+            return count;
+        };
+
+        // Find the unused triangle sharing a vertex with the meshlet which adds the fewest vertices, and of those the one closest to the center
+        auto findCandidate = [&](bool mustFit, const vec3& center)
+        {
+            uint32_t best = kInvalidTriangle;
+            uint32_t bestNewVertices = 4;
+            float bestDistance = FLT_MAX;
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            {
+                uint32_t v = data.vertices[meshlet.vertexOffset + i];
+                if (liveTriangles[v] == 0) continue;
+
+                for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+                {
+                    uint32_t t = adjacency[a];
+                    if (emitted[t]) continue;
+
+                    uint32_t newVertices = countNewVertices(t);
+                    if (mustFit && (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount >= maxTriangles)) continue;
+
+                    vec3 d = centroids[t] - center;
+                    float distance = dot(d, d);
+                    if (newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance))
+                    {
+                        best = t;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+            return best;
+        };
+
+        auto addTriangle = [&](uint32_t t)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t v = pIndices[t * 3 + k];
+                if (localIndex[v] == kNotInMeshlet)
+                {
+                    localIndex[v] = (uint16_t)meshlet.vertexCount++;
+                    data.vertices.push_back(v);
+                }
+                data.primitiveIndices.push_back((uint8_t)localIndex[v]);
+                sortedIndices.push_back(v);
+                liveTriangles[v]--;
+            }
+            emitted[t] = 1;
+            meshlet.triangleCount++;
+            centroidSum += centroids[t];
+        };
+
+        // Close the current meshlet. Returns the triangle to start the next one with, the unused neighbor closest to the meshlet, if there is one.
+        auto flush = [&]()
+        {
+            uint32_t seed = findCandidate(false, centroidSum / float(meshlet.triangleCount));
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            {
+                localIndex[data.vertices[meshlet.vertexOffset + i]] = kNotInMeshlet;
+            }
+            data.meshlets.push_back(meshlet);
+
+            meshlet = Meshlet();
+            meshlet.vertexOffset = (uint32_t)data.vertices.size();
+            meshlet.triangleOffset = (uint32_t)sortedIndices.size() / 3;
+            centroidSum = vec3(0);
+            return seed;
+        };
+
+        uint32_t seed = kInvalidTriangle;
+        uint32_t firstUnused = 0;
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            uint32_t t = kInvalidTriangle;
+            if (meshlet.triangleCount)
+            {
+                t = findCandidate(true, centroidSum / float(meshlet.triangleCount));
+                if (t == kInvalidTriangle) seed = flush();
+            }
+
+            if (t == kInvalidTriangle)
+            {
+                // Start a new meshlet. If the last one has no unused neighbors, continue with the first unused triangle.
+                t = seed;
+                seed = kInvalidTriangle;
+                if (t == kInvalidTriangle)
+                {
+                    while (emitted[firstUnused]) firstUnused++;
+                    t = firstUnused;
+                }
+            }
+            addTriangle(t);
+        }
+        if (meshlet.triangleCount) flush();
+
+        std::copy(sortedIndices.begin(), sortedIndices.end(), pIndices);
+        for (Meshlet& m : data.meshlets)
+        {
+            computeBounds(m, data, pPositions, positionStride);
+        }
+        return data;
+    }
+
+    void MeshletBuilder::computeBounds(Meshlet& meshlet, const MeshletData& meshletData, const void* pPositions, uint32_t positionStride)
+    {
+        const PositionReader positions = { (const uint8_t*)pPositions, positionStride };
+        const uint32_t* pVertices = meshletData.vertices.data() + meshlet.vertexOffset;
+        const uint8_t* pLocalIndices = meshletData.primitiveIndices.data() + meshlet.triangleOffset * 3;
+
+        // Bounding sphere, using Ritter's algorithm. Start with the sphere through two far apart points, then grow it to contain every vertex.
+        auto findFarthest = [&](const vec3& from)
+        {
+            vec3 farthest = from;
+            float farthestDistance = 0;
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            {
+                vec3 p = positions[pVertices[i]];
+                float d = dot(p - from, p - from);
+                if (d > farthestDistance)
+                {
+                    farthest = p;
+                    farthestDistance = d;
+                }
+            }
+            return farthest;
+        };
+
+        vec3 a = findFarthest(positions[pVertices[0]]);
+        vec3 b = findFarthest(a);
+        vec3 center = (a + b) * 0.5f;
+        float radius = length(b - a) * 0.5f;
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+        {
+            vec3 p = positions[pVertices[i]];
+            float d = length(p - center);
+            if (d > radius)
+            {
+                float newRadius = (radius + d) * 0.5f;
+                center += (p - center) * ((newRadius - radius) / d);
+                radius = newRadius;
+            }
+        }
+        meshlet.center = center;
+        meshlet.radius = radius;
+
+        // Normal cone, from "Optimizing the Graphics Pipeline with Compute" (Wihlidal) as implemented in meshoptimizer.
+        // The cutoff adds 90 degrees to the normals' spread, and the apex is moved back along the axis so that the cone contains every triangle's plane.
+        auto getTriangle = [&](uint32_t t, vec3& p0, vec3& normal)
+        {
+            p0 = positions[pVertices[pLocalIndices[t * 3]]];
+            vec3 p1 = positions[pVertices[pLocalIndices[t * 3 + 1]]];
+            vec3 p2 = positions[pVertices[pLocalIndices[t * 3 + 2]]];
+            normal = cross(p1 - p0, p2 - p0);
+            float area = length(normal);
+            if (area == 0) return false;
+            normal /= area;
+            return true;
+        };
+
+        meshlet.coneApex = center;
+        meshlet.coneAxis = vec3(0, 0, 1);
+        meshlet.coneCutoff = kNoConeCutoff;
+
+        vec3 p0, normal;
+        vec3 axis(0);
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+        {
+            if (getTriangle(t, p0, normal)) axis += normal;
+        }
+        float axisLength = length(axis);
+        if (axisLength == 0) return;
+        axis /= axisLength;
+
+        float minDot = 1;
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+        {
+            if (getTriangle(t, p0, normal)) minDot = min(minDot, dot(axis, normal));
+        }
+        if (minDot <= kMinConeDot) return;
+
+        float maxT = 0;
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+        {
+            if (getTriangle(t, p0, normal)) maxT = max(maxT, dot(center - p0, normal) / dot(axis, normal));
+        }
+
+        meshlet.coneApex = center - axis * maxT;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = sqrt(1 - minDot * minDot);
+    }
+
+    MeshletBuilder::Stats MeshletBuilder::getStats(const MeshletData& meshletData)
+    {
+        Stats stats;
+        stats.meshCount = meshletData.meshlets.empty() ? 0 : 1;
+        stats.meshletCount = (uint32_t)meshletData.meshlets.size();
+        stats.triangleCount = meshletData.primitiveIndices.size() / 3;
+        stats.meshletVertexCount = meshletData.vertices.size();
+        for (const Meshlet& meshlet : meshletData.meshlets)
+        {
+            if (meshlet.coneCutoff <= 1) stats.coneCullableCount++;
+        }
+        return stats;
+    }
+
+    std::string MeshletBuilder::getReport(const std::string& modelName, const Stats& stats)
+    {
+        float meshletCount = float(max(stats.meshletCount, 1u));
+        char report[256];
+        snprintf(report, sizeof(report), "%u meshlets in %u meshes, %.1f triangles and %.1f vertices per meshlet, %.3f vertices per triangle, %.1f%% back-face cullable",
+            stats.meshletCount, stats.meshCount, float(stats.triangleCount) / meshletCount, float(stats.meshletVertexCount) / meshletCount, stats.getVerticesPerTriangle(), 100.0f * float(stats.coneCullableCount) / meshletCount);
+        return "Meshlets of '" + modelName + "': " + report;
+    }
+}
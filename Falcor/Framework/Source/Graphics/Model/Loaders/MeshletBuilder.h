@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "Graphics/Model/Meshlet.h"
+
+namespace Falcor
+{
+    /** Splits indexed triangle lists into meshlets. Used by the model importers when Model::LoadFlags::GenerateMeshlets is set.
+        Meshlets are grown greedily over shared vertices, preferring triangles that add the fewest new vertices and are closest to the meshlet's center, which keeps them compact for culling.
+    */
+    class MeshletBuilder
+    {
+    public:
+        /** Default meshlet size limits. 124 triangles keep the local indices of a meshlet a multiple of 4 bytes.
+        */
+        static const uint32_t kDefaultMaxVertices = 64;
+        static const uint32_t kDefaultMaxTriangles = 124;
+
+        /** Meshlet statistics of one or more meshes
+        */
+        struct Stats
+        {
+            uint32_t meshCount = 0;             ///< Number of meshes with meshlets
+            uint32_t meshletCount = 0;          ///< Number of meshlets
+            uint64_t triangleCount = 0;         ///< Number of triangles
+            uint64_t meshletVertexCount = 0;    ///< Number of entries in the meshlets' vertex lists
+            uint32_t coneCullableCount = 0;     ///< Number of meshlets with a normal cone narrow enough for back-face culling
+
+            /** Average number of vertices transformed per triangle when drawing meshlets
+            */
+            float getVerticesPerTriangle() const { return triangleCount ? float(meshletVertexCount) / float(triangleCount) : 0.0f; }
+
+            Stats& operator+=(const Stats& other)
+            {
+                meshCount += other.meshCount;
+                meshletCount += other.meshletCount;
+                triangleCount += other.triangleCount;
+                meshletVertexCount += other.meshletVertexCount;
+                coneCullableCount += other.coneCullableCount;
+                return *this;
+            }
+        };
+
+        /** Build the meshlets of a mesh.
+            \param[in, out] pIndices Triangle list indices. The triangles are reordered in place so that the triangles of each meshlet are contiguous.
+            \param[in] indexCount Number of indices
+            \param[in] pPositions First vertex position, as 3 floats
+            \param[in] positionStride Distance between positions in bytes
+            \param[in] vertexCount Number of vertices in the vertex buffers
+            \param[in] maxVertices Maximum number of vertices in a meshlet. At most 256, so that local indices fit in a byte.
+            \param[in] maxTriangles Maximum number of triangles in a meshlet
+        */
+        static MeshletData build(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t maxVertices = kDefaultMaxVertices, uint32_t maxTriangles = kDefaultMaxTriangles);
+
+        /** Compute the bounding sphere and the normal cone of a meshlet.
+            \param[in, out] meshlet The meshlet. The triangle and vertex ranges must be set.
+            \param[in] meshletData The data the meshlet is part of
+            \param[in] pPositions First vertex position, as 3 floats
+            \param[in] positionStride Distance between positions in bytes
+        */
+        static void computeBounds(Meshlet& meshlet, const MeshletData& meshletData, const void* pPositions, uint32_t positionStride);
+
+        /** Get the statistics of a mesh's meshlets
+        */
+        static Stats getStats(const MeshletData& meshletData);
+
+        /** Format the statistics of a model, for logging
+        */
+        static std::string getReport(const std::string& modelName, const Stats& stats);
+    };
+}
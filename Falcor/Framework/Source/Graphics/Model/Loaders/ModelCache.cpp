@@ -0,0 +1,717 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+
+#include "Framework.h"
+#include "ModelCache.h"
+#include "AssimpModelImporter.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/Hasher.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <experimental/filesystem>
+
+namespace fs = std::experimental::filesystem;
+
+namespace Falcor
+{
+    bool ModelCache::sEnabled = true;
+    std::string ModelCache::sDirectory;
+    uint64_t ModelCache::sSizeLimit = 4ull * 1024 * 1024 * 1024;
+
+    namespace
+    {
+        const uint32_t kEntryMagic = 0x4341464D;   // 'MFAC'
+        const uint32_t kEntryVersion = 2;          // Bump whenever the entry layout changes. It is part of the key, so old entries simply stop being used.
+        const char* kEntryExtension = ".aicache";
+
+        // Arrays start on an 8-byte boundary, so the payload of a mapped entry can be read in place
+        const size_t kArrayAlignment = 8;
+
+        struct EntryHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t payloadSize;
+        };
+
+        struct MappedFile
+        {
+            MappedFile(const std::string& filename) { pData = (const uint8_t*)mapFileForReading(filename, size); }
+            ~MappedFile() { unmapFile(pData, size); }
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const uint8_t* pData = nullptr;
+            size_t size = 0;
+        };
+
+        /** OBJ files pull their materials from separate files, which need to be part of the key as well
+        */
+        void hashObjMaterialLibraries(const MappedFile& obj, const std::string& folder, Hasher& hasher)
+        {
+            const char* pCur = (const char*)obj.pData;
+            const char* pEnd = pCur + obj.size;
+            while(pCur < pEnd)
+            {
+                const char* pLineEnd = (const char*)std::memchr(pCur, '\n', pEnd - pCur);
+                if(pLineEnd == nullptr) pLineEnd = pEnd;
+
+                std::string line(pCur, pLineEnd);
+                if(line.compare(0, 7, "mtllib ") == 0)
+                {
+                    std::string libName = line.substr(7);
+                    libName.erase(libName.find_last_not_of(" \t\r") + 1);
+                    hasher.add(libName.data(), libName.size());
+
+                    MappedFile lib(folder + '/' + libName);
+                    if(lib.pData)
+                    {
+                        hasher.add(lib.pData, lib.size);
+                    }
+                }
+                pCur = pLineEnd + 1;
+            }
+        }
+
+        /** Writes the entry. Every array is aligned to kArrayAlignment relative to the start of the payload.
+        */
+        class EntryWriter
+        {
+        public:
+            EntryWriter(BinaryFileStream& stream) : mStream(stream) {}
+
+            template<typename T>
+            void write(const T& val) { mStream.write(&val, sizeof(T)); mOffset += sizeof(T); }
+
+            template<typename T>
+            void writeArray(const T* pData, uint32_t count)
+            {
+                write(count);
+                if(count == 0) return;
+                static const uint8_t kZeros[kArrayAlignment] = {};
+                size_t padding = (kArrayAlignment - mOffset % kArrayAlignment) % kArrayAlignment;
+                mStream.write(kZeros, padding);
+                mStream.write(pData, sizeof(T) * count);
+                mOffset += padding + sizeof(T) * count;
+            }
+
+            void writeString(const aiString& str) { writeArray(str.data, (uint32_t)str.length); }
+
+            uint64_t getOffset() const { return mOffset; }
+
+        private:
+            BinaryFileStream& mStream;
+            uint64_t mOffset = 0;
+        };
+
+        /** Reads the entry from mapped memory. Any read past the end of the payload marks the reader as invalid.
+        */
+        class EntryReader
+        {
+        public:
+            EntryReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            template<typename T>
+            T read()
+            {
+                T val = T();
+                if(sizeof(T) > mSize - mOffset) { mValid = false; return val; }
+                std::memcpy(&val, mpData + mOffset, sizeof(T));
+                mOffset += sizeof(T);
+                return val;
+            }
+
+            /** Reads a counted array into a new[] allocation, which the scene takes ownership of.
+            */
+            template<typename T>
+            T* readArray(uint32_t& count)
+            {
+                const uint8_t* pSrc = readArrayData(count, sizeof(T));
+                if(pSrc == nullptr) return nullptr;
+                T* pArray = new T[count];
+                std::memcpy(pArray, pSrc, sizeof(T) * count);
+                return pArray;
+            }
+
+            void readString(aiString& str)
+            {
+                uint32_t length;
+                const char* pSrc = (const char*)readArrayData(length, 1);
+                if(length >= MAXLEN) { mValid = false; return; }
+                str.length = length;
+                if(length) std::memcpy(str.data, pSrc, length);
+                str.data[length] = 0;
+            }
+
+            /** Reads a counted array into a vector
+            */
+            template<typename T>
+            void readVector(std::vector<T>& vec)
+            {
+                uint32_t count;
+                const uint8_t* pSrc = readArrayData(count, sizeof(T));
+                vec.resize(count);
+                if(count) std::memcpy(vec.data(), pSrc, sizeof(T) * count);
+            }
+
+            /** Reads an element count, making sure it isn't larger than what's left of the payload
+            */
+            uint32_t readCount()
+            {
+                uint32_t count = read<uint32_t>();
+                if(count > mSize - mOffset) { mValid = false; return 0; }
+                return count;
+            }
+
+            void invalidate() { mValid = false; }
+            bool isValid() const { return mValid; }
+            bool isAtEnd() const { return mOffset == mSize; }
+
+        private:
+            const uint8_t* readArrayData(uint32_t& count, size_t elementSize)
+            {
+                count = read<uint32_t>();
+                if(count == 0 || mValid == false)
+                {
+                    count = 0;
+                    return nullptr;
+                }
+                size_t padding = (kArrayAlignment - mOffset % kArrayAlignment) % kArrayAlignment;
+                if(padding > mSize - mOffset || (uint64_t)count * elementSize > mSize - mOffset - padding)
+                {
+                    mValid = false;
+                    count = 0;
+                    return nullptr;
+                }
+                const uint8_t* pSrc = mpData + mOffset + padding;
+                mOffset += padding + count * elementSize;
+                return pSrc;
+            }
+
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+            bool mValid = true;
+        };
+
+        // Which of a mesh's vertex streams are stored
+        const uint32_t kPositions  = 0x1;
+        const uint32_t kNormals    = 0x2;
+        const uint32_t kTangents   = 0x4;
+        const uint32_t kBitangents = 0x8;
+
+        void writeNode(EntryWriter& writer, const aiNode* pNode)
+        {
+            writer.writeString(pNode->mName);
+            writer.write(pNode->mTransformation);
+            writer.writeArray(pNode->mMeshes, pNode->mNumMeshes);
+            writer.write(pNode->mNumChildren);
+            for(uint32_t i = 0; i < pNode->mNumChildren; i++)
+            {
+                writeNode(writer, pNode->mChildren[i]);
+            }
+        }
+
+        aiNode* readNode(EntryReader& reader, aiNode* pParent)
+        {
+            aiNode* pNode = new aiNode();
+            pNode->mParent = pParent;
+            reader.readString(pNode->mName);
+            pNode->mTransformation = reader.read<aiMatrix4x4>();
+            pNode->mMeshes = reader.readArray<unsigned int>(pNode->mNumMeshes);
+
+            uint32_t childCount = reader.readCount();
+            if(childCount)
+            {
+                pNode->mChildren = new aiNode*[childCount]();
+                pNode->mNumChildren = childCount;
+                for(uint32_t i = 0; i < childCount && reader.isValid(); i++)
+                {
+                    pNode->mChildren[i] = readNode(reader, pNode);
+                }
+            }
+            return pNode;
+        }
+
+        void writeMeshlets(EntryWriter& writer, const MeshletData& meshlets)
+        {
+            writer.writeArray(meshlets.meshlets.data(), (uint32_t)meshlets.meshlets.size());
+            writer.writeArray(meshlets.vertices.data(), (uint32_t)meshlets.vertices.size());
+            writer.writeArray(meshlets.primitiveIndices.data(), (uint32_t)meshlets.primitiveIndices.size());
+        }
+
+        void readMeshlets(EntryReader& reader, MeshletData& meshlets)
+        {
+            reader.readVector(meshlets.meshlets);
+            reader.readVector(meshlets.vertices);
+            reader.readVector(meshlets.primitiveIndices);
+        }
+
+        void writeMesh(EntryWriter& writer, const aiMesh* pMesh)
+        {
+            writer.writeString(pMesh->mName);
+            writer.write(pMesh->mPrimitiveTypes);
+            writer.write(pMesh->mMaterialIndex);
+            writer.write(pMesh->mNumVertices);
+
+            uint32_t streams = (pMesh->mVertices ? kPositions : 0) | (pMesh->mNormals ? kNormals : 0) | (pMesh->mTangents ? kTangents : 0) | (pMesh->mBitangents ? kBitangents : 0);
+            writer.write(streams);
+            if(pMesh->mVertices)   writer.writeArray(pMesh->mVertices, pMesh->mNumVertices);
+            if(pMesh->mNormals)    writer.writeArray(pMesh->mNormals, pMesh->mNumVertices);
+            if(pMesh->mTangents)   writer.writeArray(pMesh->mTangents, pMesh->mNumVertices);
+            if(pMesh->mBitangents) writer.writeArray(pMesh->mBitangents, pMesh->mNumVertices);
+
+            uint32_t colorSets = 0;
+            for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++) colorSets |= pMesh->mColors[i] ? (1 << i) : 0;
+            writer.write(colorSets);
+            for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+            {
+                if(pMesh->mColors[i]) writer.writeArray(pMesh->mColors[i], pMesh->mNumVertices);
+            }
+
+            uint32_t uvSets = 0;
+            for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++) uvSets |= pMesh->mTextureCoords[i] ? (1 << i) : 0;
+            writer.write(uvSets);
+            for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+            {
+                if(pMesh->mTextureCoords[i])
+                {
+                    writer.write(pMesh->mNumUVComponents[i]);
+                    writer.writeArray(pMesh->mTextureCoords[i], pMesh->mNumVertices);
+                }
+            }
+
+            // Faces are stored as a flat index list. Post-processed meshes usually have a single primitive type, in which case the per-face sizes are omitted.
+            std::vector<uint32_t> faceSizes(pMesh->mNumFaces);
+            std::vector<uint32_t> indices;
+            uint32_t uniformFaceSize = pMesh->mNumFaces ? pMesh->mFaces[0].mNumIndices : 0;
+            for(uint32_t i = 0; i < pMesh->mNumFaces; i++)
+            {
+                const aiFace& face = pMesh->mFaces[i];
+                faceSizes[i] = face.mNumIndices;
+                if(face.mNumIndices != uniformFaceSize) uniformFaceSize = 0;
+                indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+            }
+            writer.write(pMesh->mNumFaces);
+            writer.write(uniformFaceSize);
+            if(uniformFaceSize == 0) writer.writeArray(faceSizes.data(), (uint32_t)faceSizes.size());
+            writer.writeArray(indices.data(), (uint32_t)indices.size());
+
+            writer.write(pMesh->mNumBones);
+            for(uint32_t i = 0; i < pMesh->mNumBones; i++)
+            {
+                const aiBone* pBone = pMesh->mBones[i];
+                writer.writeString(pBone->mName);
+                writer.write(pBone->mOffsetMatrix);
+                writer.writeArray(pBone->mWeights, pBone->mNumWeights);
+            }
+        }
+
+        template<typename T>
+        void readVertexStream(EntryReader& reader, uint32_t vertexCount, T*& pStream)
+        {
+            uint32_t count;
+            pStream = reader.readArray<T>(count);
+            if(count != vertexCount) reader.invalidate();
+        }
+
+        aiMesh* readMesh(EntryReader& reader)
+        {
+            aiMesh* pMesh = new aiMesh();
+            reader.readString(pMesh->mName);
+            pMesh->mPrimitiveTypes = reader.read<unsigned int>();
+            pMesh->mMaterialIndex = reader.read<unsigned int>();
+            pMesh->mNumVertices = reader.read<uint32_t>();
+
+            uint32_t streams = reader.read<uint32_t>();
+            if(streams & kPositions)  readVertexStream(reader, pMesh->mNumVertices, pMesh->mVertices);
+            if(streams & kNormals)    readVertexStream(reader, pMesh->mNumVertices, pMesh->mNormals);
+            if(streams & kTangents)   readVertexStream(reader, pMesh->mNumVertices, pMesh->mTangents);
+            if(streams & kBitangents) readVertexStream(reader, pMesh->mNumVertices, pMesh->mBitangents);
+
+            uint32_t colorSets = reader.read<uint32_t>();
+            for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+            {
+                if(colorSets & (1 << i)) readVertexStream(reader, pMesh->mNumVertices, pMesh->mColors[i]);
+            }
+
+            uint32_t uvSets = reader.read<uint32_t>();
+            for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+            {
+                if(uvSets & (1 << i))
+                {
+                    pMesh->mNumUVComponents[i] = reader.read<unsigned int>();
+                    readVertexStream(reader, pMesh->mNumVertices, pMesh->mTextureCoords[i]);
+                }
+            }
+
+            uint32_t faceCount = reader.readCount();
+            uint32_t uniformFaceSize = reader.read<uint32_t>();
+            uint32_t sizeCount = 0;
+            std::unique_ptr<uint32_t[]> pFaceSizes;
+            if(uniformFaceSize == 0)
+            {
+                pFaceSizes.reset(reader.readArray<uint32_t>(sizeCount));
+                if(sizeCount != faceCount) reader.invalidate();
+            }
+            uint32_t indexCount;
+            std::unique_ptr<unsigned int[]> pIndices(reader.readArray<unsigned int>(indexCount));
+
+            if(reader.isValid() && faceCount)
+            {
+                pMesh->mFaces = new aiFace[faceCount];
+                pMesh->mNumFaces = faceCount;
+                uint32_t firstIndex = 0;
+                for(uint32_t i = 0; i < faceCount; i++)
+                {
+                    uint32_t faceSize = uniformFaceSize ? uniformFaceSize : pFaceSizes[i];
+                    if(faceSize > indexCount - firstIndex)
+                    {
+                        reader.invalidate();
+                        break;
+                    }
+                    aiFace& face = pMesh->mFaces[i];
+                    face.mNumIndices = faceSize;
+                    face.mIndices = new unsigned int[faceSize];
+                    std::memcpy(face.mIndices, pIndices.get() + firstIndex, faceSize * sizeof(unsigned int));
+                    firstIndex += faceSize;
+                }
+            }
+
+            uint32_t boneCount = reader.readCount();
+            if(boneCount)
+            {
+                pMesh->mBones = new aiBone*[boneCount]();
+                pMesh->mNumBones = boneCount;
+                for(uint32_t i = 0; i < boneCount && reader.isValid(); i++)
+                {
+                    aiBone* pBone = new aiBone();
+                    pMesh->mBones[i] = pBone;
+                    reader.readString(pBone->mName);
+                    pBone->mOffsetMatrix = reader.read<aiMatrix4x4>();
+                    pBone->mWeights = reader.readArray<aiVertexWeight>(pBone->mNumWeights);
+                }
+            }
+            return pMesh;
+        }
+
+        void writeMaterial(EntryWriter& writer, const aiMaterial* pMaterial)
+        {
+            writer.write(pMaterial->mNumProperties);
+            for(uint32_t i = 0; i < pMaterial->mNumProperties; i++)
+            {
+                const aiMaterialProperty* pProp = pMaterial->mProperties[i];
+                writer.writeString(pProp->mKey);
+                writer.write(pProp->mSemantic);
+                writer.write(pProp->mIndex);
+                writer.write((uint32_t)pProp->mType);
+                writer.writeArray(pProp->mData, pProp->mDataLength);
+            }
+        }
+
+        aiMaterial* readMaterial(EntryReader& reader)
+        {
+            aiMaterial* pMaterial = new aiMaterial();
+            uint32_t propertyCount = reader.readCount();
+            for(uint32_t i = 0; i < propertyCount && reader.isValid(); i++)
+            {
+                aiString key;
+                reader.readString(key);
+                uint32_t semantic = reader.read<uint32_t>();
+                uint32_t index = reader.read<uint32_t>();
+                aiPropertyTypeInfo type = (aiPropertyTypeInfo)reader.read<uint32_t>();
+                uint32_t dataLength;
+                std::unique_ptr<char[]> pData(reader.readArray<char>(dataLength));
+                if(reader.isValid())
+                {
+                    pMaterial->AddBinaryProperty(pData.get(), dataLength, key.C_Str(), semantic, index, type);
+                }
+            }
+            return pMaterial;
+        }
+
+        void writeAnimation(EntryWriter& writer, const aiAnimation* pAnim)
+        {
+            // Mesh and morph channels aren't supported by AssimpModelImporter, so they aren't stored
+            writer.writeString(pAnim->mName);
+            writer.write(pAnim->mDuration);
+            writer.write(pAnim->mTicksPerSecond);
+            writer.write(pAnim->mNumChannels);
+            for(uint32_t i = 0; i < pAnim->mNumChannels; i++)
+            {
+                const aiNodeAnim* pChannel = pAnim->mChannels[i];
+                writer.writeString(pChannel->mNodeName);
+                writer.write((uint32_t)pChannel->mPreState);
+                writer.write((uint32_t)pChannel->mPostState);
+                writer.writeArray(pChannel->mPositionKeys, pChannel->mNumPositionKeys);
+                writer.writeArray(pChannel->mRotationKeys, pChannel->mNumRotationKeys);
+                writer.writeArray(pChannel->mScalingKeys, pChannel->mNumScalingKeys);
+            }
+        }
+
+        aiAnimation* readAnimation(EntryReader& reader)
+        {
+            aiAnimation* pAnim = new aiAnimation();
+            reader.readString(pAnim->mName);
+            pAnim->mDuration = reader.read<double>();
+            pAnim->mTicksPerSecond = reader.read<double>();
+
+            uint32_t channelCount = reader.readCount();
+            if(channelCount)
+            {
+                pAnim->mChannels = new aiNodeAnim*[channelCount]();
+                pAnim->mNumChannels = channelCount;
+                for(uint32_t i = 0; i < channelCount && reader.isValid(); i++)
+                {
+                    aiNodeAnim* pChannel = new aiNodeAnim();
+                    pAnim->mChannels[i] = pChannel;
+                    reader.readString(pChannel->mNodeName);
+                    pChannel->mPreState = (aiAnimBehaviour)reader.read<uint32_t>();
+                    pChannel->mPostState = (aiAnimBehaviour)reader.read<uint32_t>();
+                    pChannel->mPositionKeys = reader.readArray<aiVectorKey>(pChannel->mNumPositionKeys);
+                    pChannel->mRotationKeys = reader.readArray<aiQuatKey>(pChannel->mNumRotationKeys);
+                    pChannel->mScalingKeys = reader.readArray<aiVectorKey>(pChannel->mNumScalingKeys);
+                }
+            }
+            return pAnim;
+        }
+
+        /** Reads a counted list of scene objects into a new[] array of pointers
+        */
+        template<typename T, typename ReadFunc>
+        void readObjectList(EntryReader& reader, T**& pList, unsigned int& count, ReadFunc readFunc)
+        {
+            uint32_t listCount = reader.readCount();
+            if(listCount == 0) return;
+            pList = new T*[listCount]();
+            count = listCount;
+            for(uint32_t i = 0; i < listCount && reader.isValid(); i++)
+            {
+                pList[i] = readFunc(reader);
+            }
+        }
+
+        void removeEntry(const std::string& filename)
+        {
+            std::error_code ec;
+            fs::remove(filename, ec);
+        }
+    }
+
+    std::string ModelCache::getDirectory()
+    {
+        return sDirectory.empty() ? getExecutableDirectory() + "/ModelCache" : sDirectory;
+    }
+
+    std::string ModelCache::getEntryFilename(const std::string& fullpath, uint32_t postProcessFlags, Model::LoadFlags processingFlags)
+    {
+        MappedFile source(fullpath);
+        if(source.pData == nullptr) return "";
+
+        Hasher hasher;
+        hasher.add(kEntryVersion);
+        hasher.add(postProcessFlags);
+        hasher.add(processingFlags);
+        hasher.add(source.pData, source.size);
+        if(hasSuffix(fullpath, ".obj", false))
+        {
+            hashObjMaterialLibraries(source, getDirectoryFromFile(fullpath), hasher);
+        }
+
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hasher.get());
+        return getDirectory() + '/' + key + kEntryExtension;
+    }
+
+    aiScene* ModelCache::load(const std::string& entryFilename, std::vector<MeshletData>* pMeshlets)
+    {
+        if(doesFileExist(entryFilename) == false) return nullptr;
+
+        aiScene* pScene = nullptr;
+        {
+            MappedFile entry(entryFilename);
+            EntryHeader header = {};
+            if(entry.pData && entry.size >= sizeof(EntryHeader))
+            {
+                std::memcpy(&header, entry.pData, sizeof(EntryHeader));
+            }
+
+            if(header.magic == kEntryMagic && header.version == kEntryVersion && header.payloadSize == entry.size - sizeof(EntryHeader))
+            {
+                EntryReader reader(entry.pData + sizeof(EntryHeader), (size_t)header.payloadSize);
+                pScene = new aiScene();
+                pScene->mFlags = reader.read<unsigned int>();
+                readObjectList(reader, pScene->mMeshes, pScene->mNumMeshes, readMesh);
+                readObjectList(reader, pScene->mMaterials, pScene->mNumMaterials, readMaterial);
+                readObjectList(reader, pScene->mAnimations, pScene->mNumAnimations, readAnimation);
+                if(reader.isValid())
+                {
+                    pScene->mRootNode = readNode(reader, nullptr);
+                }
+
+                // Meshlets, if the scene was processed with Model::LoadFlags::GenerateMeshlets
+                std::vector<MeshletData> meshlets(reader.readCount());
+                for(size_t i = 0; i < meshlets.size() && reader.isValid(); i++)
+                {
+                    readMeshlets(reader, meshlets[i]);
+                }
+                if(meshlets.size() && meshlets.size() != pScene->mNumMeshes) reader.invalidate();
+
+                if(reader.isValid() == false || reader.isAtEnd() == false)
+                {
+                    delete pScene;
+                    pScene = nullptr;
+                }
+                else if(pMeshlets)
+                {
+                    *pMeshlets = std::move(meshlets);
+                }
+            }
+        }
+
+        if(pScene == nullptr)
+        {
+            logWarning("ModelCache: Removing invalid cache entry '" + entryFilename + "'");
+            removeEntry(entryFilename);
+            return nullptr;
+        }
+
+        // Mark the entry as recently used, for eviction
+        std::error_code ec;
+        fs::last_write_time(entryFilename, fs::file_time_type::clock::now(), ec);
+        return pScene;
+    }
+
+    bool ModelCache::store(const aiScene* pScene, const std::string& entryFilename, const std::vector<MeshletData>* pMeshlets)
+    {
+        // Embedded textures aren't stored. AssimpModelImporter rejects such scenes anyway.
+        if(pScene->mNumTextures || pScene->mRootNode == nullptr) return false;
+
+        std::error_code ec;
+        fs::create_directories(getDirectoryFromFile(entryFilename), ec);
+
+        // Write to a temporary file first, so that concurrent loads never see a partially written entry
+        std::string tempFilename = entryFilename + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+        {
+            BinaryFileStream stream(tempFilename, BinaryFileStream::Mode::Write);
+            EntryHeader header = { kEntryMagic, kEntryVersion, 0 };
+            stream << header;
+
+            EntryWriter writer(stream);
+            writer.write(pScene->mFlags);
+            writer.write(pScene->mNumMeshes);
+            for(uint32_t i = 0; i < pScene->mNumMeshes; i++) writeMesh(writer, pScene->mMeshes[i]);
+            writer.write(pScene->mNumMaterials);
+            for(uint32_t i = 0; i < pScene->mNumMaterials; i++) writeMaterial(writer, pScene->mMaterials[i]);
+            writer.write(pScene->mNumAnimations);
+            for(uint32_t i = 0; i < pScene->mNumAnimations; i++) writeAnimation(writer, pScene->mAnimations[i]);
+            writeNode(writer, pScene->mRootNode);
+            writer.write(pMeshlets ? (uint32_t)pMeshlets->size() : 0u);
+            if(pMeshlets)
+            {
+                for(const MeshletData& meshlets : *pMeshlets) writeMeshlets(writer, meshlets);
+            }
+
+            // Patch the payload size now that it is known
+            header.payloadSize = writer.getOffset();
+            stream.setWritePosition(0);
+            stream << header;
+
+            if(stream.isFail())
+            {
+                stream.remove();
+                logWarning("ModelCache: Can't write cache entry '" + entryFilename + "'");
+                return false;
+            }
+        }
+
+        fs::rename(tempFilename, entryFilename, ec);
+        if(ec)
+        {
+            removeEntry(tempFilename);
+            logWarning("ModelCache: Can't write cache entry '" + entryFilename + "'");
+            return false;
+        }
+
+        evictLeastRecentlyUsedFiles(getDirectoryFromFile(entryFilename), kEntryExtension, sSizeLimit, entryFilename);
+        return true;
+    }
+
+    void ModelCache::clear()
+    {
+        std::error_code ec;
+        std::vector<fs::path> entries;
+        for(fs::directory_iterator it(getDirectory(), ec), end; !ec && it != end; it.increment(ec))
+        {
+            if(it->path().extension() == kEntryExtension) entries.push_back(it->path());
+        }
+        for(const auto& path : entries) fs::remove(path, ec);
+    }
+
+    bool ModelCache::warm(const std::string& filename, Model::LoadFlags flags)
+    {
+        // Binary models are loaded by BinaryModelImporter and never go through ASSIMP, so there is nothing to cache
+        if(hasSuffix(filename, ".bin", false))
+        {
+            logError("ModelCache: Can't warm the cache with " + filename + ". Binary models are loaded directly and aren't cached, only models imported with ASSIMP are");
+            return false;
+        }
+
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError("ModelCache: Can't find model file " + filename);
+            return false;
+        }
+
+        uint32_t postProcessFlags = AssimpModelImporter::getPostProcessFlags(flags);
+        std::string entryFilename = getEntryFilename(fullpath, postProcessFlags, AssimpModelImporter::getSceneProcessingFlags(flags));
+        if(entryFilename.empty())
+        {
+            logError("ModelCache: Can't read model file " + fullpath);
+            return false;
+        }
+        if(doesFileExist(entryFilename)) return true;
+
+        Assimp::Importer importer;
+        const aiScene* pScene = importer.ReadFile(fullpath, postProcessFlags);
+        if(pScene == nullptr)
+        {
+            logError("ModelCache: Can't open model file '" + fullpath + "'\n" + importer.GetErrorString());
+            return false;
+        }
+        std::vector<MeshletData> meshlets;
+        AssimpModelImporter::processScene(const_cast<aiScene*>(pScene), flags, filename, meshlets);
+        return store(pScene, entryFilename, &meshlets);
+    }
+}
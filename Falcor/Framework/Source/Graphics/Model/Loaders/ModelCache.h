@@ -0,0 +1,102 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "../Model.h"
+#include "../Meshlet.h"
+
+struct aiScene;
+
+namespace Falcor
+{
+    /** On-disk cache of post-processed ASSIMP scenes.
+        Running ASSIMP's post-processing on a large scene can take tens of seconds. AssimpModelImporter stores the processed aiScene here
+        and, on the next load of the same file, rebuilds it from the cache instead of running ASSIMP's importer.
+        Entries are keyed by a hash of the source file's content (and of the material libraries it references) together with the
+        post-processing flags derived from Model::LoadFlags and the importer's own processing (such as vertex cache optimization), so a modified file never hits a stale entry. When the cache grows beyond
+        its size limit, the least recently used entries are evicted.
+    */
+    class ModelCache
+    {
+    public:
+        /** Enable or disable the cache. Enabled by default. Model::LoadFlags::DontUseModelCache disables it for a single load.
+        */
+        static void setEnabled(bool enabled) { sEnabled = enabled; }
+        static bool isEnabled() { return sEnabled; }
+
+        /** Set the directory holding the cache entries. Defaults to 'ModelCache' next to the executable.
+        */
+        static void setDirectory(const std::string& directory) { sDirectory = directory; }
+        static std::string getDirectory();
+
+        /** Set the maximum size of the cache in bytes. Defaults to 4GB.
+        */
+        static void setSizeLimit(uint64_t bytes) { sSizeLimit = bytes; }
+        static uint64_t getSizeLimit() { return sSizeLimit; }
+
+        /** Get the entry filename for a source file.
+            \param[in] fullpath Full path of the source model
+            \param[in] postProcessFlags The ASSIMP post-processing flags used when importing the model
+            \param[in] processingFlags The processing AssimpModelImporter applied to the scene, see AssimpModelImporter::getSceneProcessingFlags()
+            \return The entry's full path, or an empty string if the source file can't be read
+        */
+        static std::string getEntryFilename(const std::string& fullpath, uint32_t postProcessFlags, Model::LoadFlags processingFlags);
+
+        /** Load a scene from the cache.
+            \param[in] entryFilename The entry's full path, as returned by getEntryFilename()
+            \param[out] pMeshlets Optional. Receives the meshlets stored with the scene, one entry per mesh, or nothing if the entry has none.
+            \return A new scene owned by the caller, or nullptr if the entry doesn't exist or is invalid. Invalid entries are removed.
+        */
+        static aiScene* load(const std::string& entryFilename, std::vector<MeshletData>* pMeshlets = nullptr);
+
+        /** Store a scene in the cache and evict old entries if the cache is over its size limit.
+            \param[in] pScene The post-processed scene
+            \param[in] entryFilename The entry's full path, as returned by getEntryFilename()
+            \param[in] pMeshlets Optional meshlets of the scene's meshes, see AssimpModelImporter::processScene()
+            \return Whether the entry was written
+        */
+        static bool store(const aiScene* pScene, const std::string& entryFilename, const std::vector<MeshletData>* pMeshlets = nullptr);
+
+        /** Remove all entries from the cache.
+        */
+        static void clear();
+
+        /** Import a model with ASSIMP and store it in the cache, without creating any GPU resources. Used to pre-warm the cache on build machines.
+            Binary models (.bin) aren't imported with ASSIMP, so they are rejected.
+            \param[in] filename Model's filename. Can include a full path or a relative path from a data directory
+            \param[in] flags The flags the model will be loaded with
+            \return Whether the model is in the cache
+        */
+        static bool warm(const std::string& filename, Model::LoadFlags flags = Model::LoadFlags::None);
+
+    private:
+        static bool sEnabled;
+        static std::string sDirectory;
+        static uint64_t sSizeLimit;
+    };
+}
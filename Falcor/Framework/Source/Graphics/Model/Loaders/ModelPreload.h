@@ -0,0 +1,66 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Utils/Bitmap.h"
+#include "../Model.h"
+#include "../Meshlet.h"
+
+struct aiScene;
+namespace Assimp
+{
+    class Importer;
+}
+
+namespace Falcor
+{
+    /** The CPU part of a model load, produced by Model::preloadFromFile() and consumed by Model::createFromFile().
+        It holds everything the importers can do without touching the GPU: reading and parsing the file, processing the meshes and decoding the textures.
+        Preloads of different models are independent, so they can run concurrently on worker threads.
+    */
+    struct ModelPreload
+    {
+        ModelPreload();
+        ~ModelPreload();
+
+        std::string fullpath;                           ///< Full path of the model file
+        Model::LoadFlags flags = Model::LoadFlags::None;///< The flags the model was preloaded with. The preload is ignored if the model is created with different flags.
+        float preloadTime = 0;                          ///< Time the preload took, in milliseconds
+
+        // ASSIMP models, see AssimpModelImporter::preload()
+        std::unique_ptr<Assimp::Importer> pImporter;    ///< Owns pScene if it was imported
+        std::unique_ptr<aiScene> pCachedScene;          ///< Owns pScene if it was loaded from the ModelCache
+        const aiScene* pScene = nullptr;                ///< The processed scene
+        std::vector<MeshletData> meshlets;              ///< The meshlets of the scene's meshes, see AssimpModelImporter::processScene()
+        std::vector<std::vector<glm::vec3>> bitangents; ///< Generated bitangents, indexed by mesh. Empty for meshes which have their own or don't need them.
+        std::map<std::string, Bitmap::UniqueConstPtr> bitmaps;  ///< The decoded textures, by full path. DDS files and missing files are left to the importer.
+    };
+}
@@ -0,0 +1,251 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VertexCacheOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Parameters from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+        const uint32_t kCacheSize = 32;
+        const float kCacheDecayPower = 1.5f;
+        const float kLastTriScore = 0.75f;
+        const float kValenceBoostScale = 2.0f;
+        const float kValenceBoostPower = 0.5f;
+        const uint32_t kMaxValenceScore = 32;
+        const uint32_t kNotInCache = uint32_t(-1);
+
+        struct ScoreTables
+        {
+            float cachePosition[kCacheSize];
+            float valence[kMaxValenceScore];
+
+            ScoreTables()
+            {
+                for(uint32_t i = 0; i < kCacheSize; i++)
+                {
+                    // The vertices of the last triangle get a fixed score, so that the next triangle doesn't simply reuse the same edge
+                    cachePosition[i] = (i < 3) ? kLastTriScore : std::pow(1.0f - float(i - 3) / float(kCacheSize - 3), kCacheDecayPower);
+                }
+                valence[0] = 0;
+                for(uint32_t i = 1; i < kMaxValenceScore; i++)
+                {
+                    // Boost vertices with few triangles left, to get rid of lone triangles early
+                    valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+                }
+            }
+        };
+
+        const ScoreTables& getScoreTables()
+        {
+            static const ScoreTables tables;
+            return tables;
+        }
+
+        float vertexScore(const ScoreTables& tables, uint32_t activeTriangles, uint32_t cachePosition)
+        {
+            if(activeTriangles == 0) return -1.0f;
+            float score = (cachePosition == kNotInCache) ? 0.0f : tables.cachePosition[cachePosition];
+            score += (activeTriangles < kMaxValenceScore) ? tables.valence[activeTriangles] : kValenceBoostScale * std::pow(float(activeTriangles), -kValenceBoostPower);
+            return score;
+        }
+    }
+
+    VertexCacheOptimizer::Stats VertexCacheOptimizer::analyze(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount)
+    {
+        Stats stats;
+        stats.triangleCount = indexCount / 3;
+
+        // Timestamp of the vertex's last transform. The vertex is in the cache if it was transformed during the last kAnalysisCacheSize misses.
+        std::vector<uint32_t> transformedAt(vertexCount, 0);
+        for(uint32_t i = 0; i < stats.triangleCount * 3; i++)
+        {
+            uint32_t index = pIndices[i];
+            if(transformedAt[index] == 0) stats.vertexCount++;
+            if(transformedAt[index] == 0 || stats.cacheMisses - transformedAt[index] + 1 > kAnalysisCacheSize)
+            {
+                stats.cacheMisses++;
+                transformedAt[index] = stats.cacheMisses;
+            }
+        }
+        return stats;
+    }
+
+    void VertexCacheOptimizer::optimizeTriangleOrder(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount)
+    {
+        const uint32_t triangleCount = indexCount / 3;
+        if(triangleCount < 2) return;
+        const ScoreTables& tables = getScoreTables();
+
+        // Vertex to triangle adjacency, in CSR form
+        std::vector<uint32_t> activeTriangles(vertexCount, 0);
+        for(uint32_t i = 0; i < triangleCount * 3; i++) activeTriangles[pIndices[i]]++;
+
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for(uint32_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] = adjacencyOffset[v] + activeTriangles[v];
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for(uint32_t i = 0; i < triangleCount * 3; i++) adjacency[fill[pIndices[i]]++] = i / 3;
+        }
+
+        std::vector<uint32_t> cachePosition(vertexCount, kNotInCache);
+        std::vector<float> vertexScores(vertexCount);
+        for(uint32_t v = 0; v < vertexCount; v++) vertexScores[v] = vertexScore(tables, activeTriangles[v], kNotInCache);
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for(uint32_t t = 0; t < triangleCount; t++)
+        {
+            triangleScores[t] = vertexScores[pIndices[t * 3]] + vertexScores[pIndices[t * 3 + 1]] + vertexScores[pIndices[t * 3 + 2]];
+        }
+
+        // The cache holds up to kCacheSize vertices, plus the 3 of the triangle being added
+        uint32_t cache[kCacheSize + 3];
+        uint32_t cacheCount = 0;
+
+        std::vector<uint32_t> output(triangleCount * 3);
+        uint32_t bestTriangle = 0;
+        for(uint32_t t = 1; t < triangleCount; t++)
+        {
+            if(triangleScores[t] > triangleScores[bestTriangle]) bestTriangle = t;
+        }
+
+        uint32_t nextUnemitted = 0;
+        for(uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            // Nothing in the cache is connected to a remaining triangle. Continue with the next triangle in the original order.
+            if(bestTriangle == kNotInCache)
+            {
+                while(emitted[nextUnemitted]) nextUnemitted++;
+                bestTriangle = nextUnemitted;
+            }
+
+            // Emit the triangle
+            const uint32_t* pTri = pIndices + bestTriangle * 3;
+            std::memcpy(&output[emittedCount * 3], pTri, sizeof(uint32_t) * 3);
+            emitted[bestTriangle] = true;
+
+            // Remove it from its vertices' lists of remaining triangles
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t v = pTri[i];
+                uint32_t* pBegin = &adjacency[adjacencyOffset[v]];
+                uint32_t* pEnd = pBegin + activeTriangles[v];
+                uint32_t* pTriEntry = std::find(pBegin, pEnd, bestTriangle);
+                if(pTriEntry != pEnd)
+                {
+                    *pTriEntry = *(pEnd - 1);
+                    activeTriangles[v]--;
+                }
+            }
+
+            // Move the triangle's vertices to the front of the LRU cache
+            uint32_t newCache[kCacheSize + 3];
+            uint32_t newCount = 0;
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                if(std::find(newCache, newCache + newCount, pTri[i]) == newCache + newCount) newCache[newCount++] = pTri[i];
+            }
+            for(uint32_t i = 0; i < cacheCount; i++)
+            {
+                uint32_t v = cache[i];
+                if(v != pTri[0] && v != pTri[1] && v != pTri[2]) newCache[newCount++] = v;
+            }
+
+            // Update the scores of the cached vertices and of the vertices which dropped out, and pick the best triangle among theirs
+            bestTriangle = kNotInCache;
+            float bestScore = -1.0f;
+            for(uint32_t i = 0; i < newCount; i++)
+            {
+                uint32_t v = newCache[i];
+                cachePosition[v] = (i < kCacheSize) ? i : kNotInCache;
+                float score = vertexScore(tables, activeTriangles[v], cachePosition[v]);
+                float delta = score - vertexScores[v];
+                vertexScores[v] = score;
+
+                for(uint32_t j = 0; j < activeTriangles[v]; j++)
+                {
+                    uint32_t t = adjacency[adjacencyOffset[v] + j];
+                    triangleScores[t] += delta;
+                    if(i < kCacheSize && triangleScores[t] > bestScore)
+                    {
+                        bestScore = triangleScores[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCount, kCacheSize);
+            std::memcpy(cache, newCache, sizeof(uint32_t) * cacheCount);
+        }
+
+        std::memcpy(pIndices, output.data(), sizeof(uint32_t) * triangleCount * 3);
+    }
+
+    std::vector<uint32_t> VertexCacheOptimizer::optimizeVertexFetch(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, kNotInCache);
+        uint32_t nextVertex = 0;
+        for(uint32_t i = 0; i < indexCount; i++)
+        {
+            uint32_t& newIndex = remap[pIndices[i]];
+            if(newIndex == kNotInCache) newIndex = nextVertex++;
+            pIndices[i] = newIndex;
+        }
+
+        for(uint32_t& newIndex : remap)
+        {
+            if(newIndex == kNotInCache) newIndex = nextVertex++;
+        }
+        return remap;
+    }
+
+    void VertexCacheOptimizer::remapVertexBuffer(void* pVertices, uint32_t stride, const std::vector<uint32_t>& remap)
+    {
+        const uint8_t* pSrc = (const uint8_t*)pVertices;
+        std::vector<uint8_t> remapped(remap.size() * stride);
+        for(size_t i = 0; i < remap.size(); i++)
+        {
+            std::memcpy(&remapped[remap[i] * stride], pSrc + i * stride, stride);
+        }
+        std::memcpy(pVertices, remapped.data(), remapped.size());
+    }
+
+    std::string VertexCacheOptimizer::getReport(const std::string& modelName, const Stats& before, const Stats& after)
+    {
+        char report[256];
+        snprintf(report, sizeof(report), "ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u triangles, %u-entry FIFO)", before.getAcmr(), after.getAcmr(), before.getAtvr(), after.getAtvr(), after.triangleCount, kAnalysisCacheSize);
+        return "Vertex cache optimization of '" + modelName + "': " + report;
+    }
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** CPU mesh optimizations for the post-transform vertex cache and for vertex fetch.
+        Used by the model importers when Model::LoadFlags::OptimizeVertexCache is set. All functions work on indexed triangle lists.
+    */
+    class VertexCacheOptimizer
+    {
+    public:
+        /** Size of the FIFO cache used by analyze()
+        */
+        static const uint32_t kAnalysisCacheSize = 32;
+
+        /** Post-transform cache statistics of an index buffer
+        */
+        struct Stats
+        {
+            uint32_t triangleCount = 0;     ///< Number of triangles
+            uint32_t vertexCount = 0;       ///< Number of unique vertices referenced by the triangles
+            uint32_t cacheMisses = 0;       ///< Number of vertex shader invocations with a kAnalysisCacheSize-entry FIFO cache
+
+            /** Average cache miss ratio, the number of transformed vertices per triangle. 0.5 is the best possible value for a regular grid.
+            */
+            float getAcmr() const { return triangleCount ? float(cacheMisses) / float(triangleCount) : 0.0f; }
+
+            /** Average transform to vertex ratio. 1 is the best possible value.
+            */
+            float getAtvr() const { return vertexCount ? float(cacheMisses) / float(vertexCount) : 0.0f; }
+
+            Stats& operator+=(const Stats& other)
+            {
+                triangleCount += other.triangleCount;
+                vertexCount += other.vertexCount;
+                cacheMisses += other.cacheMisses;
+                return *this;
+            }
+        };
+
+        /** Simulate a FIFO post-transform cache on an index buffer.
+            \param[in] pIndices Triangle list indices
+            \param[in] indexCount Number of indices
+            \param[in] vertexCount Number of vertices in the vertex buffers
+        */
+        static Stats analyze(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+        /** Reorder triangles to improve post-transform cache hits, using Tom Forsyth's linear-speed vertex cache optimization.
+            \param[in, out] pIndices Triangle list indices, reordered in place
+            \param[in] indexCount Number of indices
+            \param[in] vertexCount Number of vertices in the vertex buffers
+        */
+        static void optimizeTriangleOrder(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+        /** Compute a vertex order in which vertices are laid out by first use in the index buffer, so that vertex fetch walks memory linearly.
+            The indices are rewritten to the new order. Unreferenced vertices are moved to the end.
+            \param[in, out] pIndices Triangle list indices, remapped in place
+            \param[in] indexCount Number of indices
+            \param[in] vertexCount Number of vertices in the vertex buffers
+            \return Remap table. Vertex i moves to position remap[i].
+        */
+        static std::vector<uint32_t> optimizeVertexFetch(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+        /** Apply a remap table returned by optimizeVertexFetch() to a vertex buffer.
+            \param[in, out] pVertices Vertex data, permuted in place
+            \param[in] stride Size of a vertex in bytes
+            \param[in] remap Remap table
+        */
+        static void remapVertexBuffer(void* pVertices, uint32_t stride, const std::vector<uint32_t>& remap);
+
+        /** Format the ACMR/ATVR of a model before and after optimization, for logging
+        */
+        static std::string getReport(const std::string& modelName, const Stats& before, const Stats& after);
+    };
+}
@@ -0,0 +1,214 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VertexQuantizer.h"
+#include "Data/VertexQuantization.h"
+#include "glm/geometric.hpp"
+#include "glm/gtc/packing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    const float VertexQuantizer::kMaxTexCoordError = 1.0f / 2048.0f;
+
+    namespace
+    {
+        const int32_t kSnorm16Max = 32767;
+
+        glm::vec3 readVec3(const void* pSrc, uint32_t srcStride, uint32_t index)
+        {
+            glm::vec3 v;
+            std::memcpy(&v, (const uint8_t*)pSrc + (size_t)srcStride * index, sizeof(v));
+            return v;
+        }
+
+        glm::vec2 readVec2(const void* pSrc, uint32_t srcStride, uint32_t index)
+        {
+            glm::vec2 v;
+            std::memcpy(&v, (const uint8_t*)pSrc + (size_t)srcStride * index, sizeof(v));
+            return v;
+        }
+
+        uint16_t toSnorm16(int32_t v)
+        {
+            return (uint16_t)(int16_t)std::min(std::max(v, -kSnorm16Max), kSnorm16Max);
+        }
+
+        // Angle between two directions in degrees. atan2() keeps the precision for small angles, where acos() doesn't.
+        float getAngle(const glm::vec3& a, const glm::vec3& b)
+        {
+            return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+        }
+    }
+
+    VertexQuantizer::Report& VertexQuantizer::Report::operator+=(const Report& other)
+    {
+        meshCount += other.meshCount;
+        quantizedMeshCount += other.quantizedMeshCount;
+        bytesBefore += other.bytesBefore;
+        bytesAfter += other.bytesAfter;
+        maxPositionError = std::max(maxPositionError, other.maxPositionError);
+        maxNormalError = std::max(maxNormalError, other.maxNormalError);
+        maxTexCoordError = std::max(maxTexCoordError, other.maxTexCoordError);
+        return *this;
+    }
+
+    std::string VertexQuantizer::Report::getString(const std::string& modelName) const
+    {
+        const double kMB = 1024.0 * 1024.0;
+        char report[256];
+        snprintf(report, sizeof(report), "%u of %u meshes, vertex buffers %.2f MB -> %.2f MB (%.2f MB saved). Max error: position %g, normal %.4f degrees, texcoord %g",
+            quantizedMeshCount, meshCount, bytesBefore / kMB, bytesAfter / kMB, (double(bytesBefore) - double(bytesAfter)) / kMB, maxPositionError, maxNormalError, maxTexCoordError);
+        return "Vertex quantization of '" + modelName + "': " + report;
+    }
+
+    void VertexQuantizer::encodeOct(const glm::vec3& n, uint16_t encoded[2])
+    {
+        encoded[0] = encoded[1] = 0;
+        float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if((l1 > 0) == false || std::isfinite(l1) == false) return;
+
+        // Project on the octahedron, then fold the lower hemisphere over the diagonals
+        glm::vec2 p(n.x / l1, n.y / l1);
+        if(n.z < 0)
+        {
+            glm::vec2 folded((1 - std::abs(p.y)) * (p.x >= 0 ? 1 : -1), (1 - std::abs(p.x)) * (p.y >= 0 ? 1 : -1));
+            p = folded;
+        }
+
+        // Rounding each coordinate to the nearest value isn't the closest direction on the sphere, so try all neighbors
+        const glm::vec3 dir = n / glm::length(n);
+        const int32_t baseX = (int32_t)std::floor(p.x * kSnorm16Max);
+        const int32_t baseY = (int32_t)std::floor(p.y * kSnorm16Max);
+        float bestDot = -2;
+        for(int32_t dy = 0; dy <= 1; dy++)
+        {
+            for(int32_t dx = 0; dx <= 1; dx++)
+            {
+                uint16_t candidate[2] = { toSnorm16(baseX + dx), toSnorm16(baseY + dy) };
+                float d = glm::dot(decodeOct(candidate), dir);
+                if(d > bestDot)
+                {
+                    bestDot = d;
+                    encoded[0] = candidate[0];
+                    encoded[1] = candidate[1];
+                }
+            }
+        }
+    }
+
+    glm::vec3 VertexQuantizer::decodeOct(const uint16_t encoded[2])
+    {
+        return octDecode(glm::vec2(glm::unpackSnorm1x16(encoded[0]), glm::unpackSnorm1x16(encoded[1])));
+    }
+
+    void VertexQuantizer::getPositionDecode(const glm::vec3& minPoint, const glm::vec3& maxPoint, glm::vec3& scale, glm::vec3& offset)
+    {
+        offset = (minPoint + maxPoint) * 0.5f;
+        scale = (maxPoint - minPoint) * 0.5f;
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            if((scale[i] > 0) == false) scale[i] = 1;
+        }
+    }
+
+    void VertexQuantizer::encodePosition(const glm::vec3& p, const glm::vec3& scale, const glm::vec3& offset, uint16_t encoded[4])
+    {
+        glm::vec3 q = (p - offset) / scale;
+        encoded[0] = glm::packSnorm1x16(q.x);
+        encoded[1] = glm::packSnorm1x16(q.y);
+        encoded[2] = glm::packSnorm1x16(q.z);
+        encoded[3] = glm::packSnorm1x16(1.0f);
+    }
+
+    glm::vec3 VertexQuantizer::decodePosition(const uint16_t encoded[4], const glm::vec3& scale, const glm::vec3& offset)
+    {
+        glm::vec3 q(glm::unpackSnorm1x16(encoded[0]), glm::unpackSnorm1x16(encoded[1]), glm::unpackSnorm1x16(encoded[2]));
+        return Falcor::decodePosition(q, scale, offset);
+    }
+
+    void VertexQuantizer::encodeTexCoord(const glm::vec2& texC, uint16_t encoded[2])
+    {
+        encoded[0] = glm::packHalf1x16(texC.x);
+        encoded[1] = glm::packHalf1x16(texC.y);
+    }
+
+    glm::vec2 VertexQuantizer::decodeTexCoord(const uint16_t encoded[2])
+    {
+        return glm::vec2(glm::unpackHalf1x16(encoded[0]), glm::unpackHalf1x16(encoded[1]));
+    }
+
+    float VertexQuantizer::quantizePositions(const void* pSrc, uint32_t srcStride, uint32_t count, const glm::vec3& scale, const glm::vec3& offset, uint16_t* pDst)
+    {
+        float maxError = 0;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            glm::vec3 p = readVec3(pSrc, srcStride, i);
+            encodePosition(p, scale, offset, pDst + 4 * i);
+            maxError = std::max(maxError, glm::length(decodePosition(pDst + 4 * i, scale, offset) - p));
+        }
+        return maxError;
+    }
+
+    float VertexQuantizer::quantizeUnitVectors(const void* pSrc, uint32_t srcStride, uint32_t count, uint16_t* pDst)
+    {
+        float maxError = 0;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            glm::vec3 n = readVec3(pSrc, srcStride, i);
+            encodeOct(n, pDst + 2 * i);
+
+            // Only the direction is stored. Degenerate vectors have none, so they don't count.
+            float length = glm::length(n);
+            if(length > 0 && std::isfinite(length))
+            {
+                maxError = std::max(maxError, getAngle(n / length, decodeOct(pDst + 2 * i)));
+            }
+        }
+        return maxError;
+    }
+
+    float VertexQuantizer::quantizeTexCoords(const void* pSrc, uint32_t srcStride, uint32_t count, uint16_t* pDst)
+    {
+        float maxError = 0;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            glm::vec2 texC = readVec2(pSrc, srcStride, i);
+            encodeTexCoord(texC, pDst + 2 * i);
+            glm::vec2 error = glm::abs(decodeTexCoord(pDst + 2 * i) - texC);
+
+            // Values out of the half range overflow to infinity, report them as an infinite error
+            float e = std::max(error.x, error.y);
+            if(std::isnan(error.x) || std::isnan(error.y)) e = INFINITY;
+            maxError = std::max(maxError, e);
+        }
+        return maxError;
+    }
+}
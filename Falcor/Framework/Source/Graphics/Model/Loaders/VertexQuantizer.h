@@ -0,0 +1,100 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+
+namespace Falcor
+{
+    /** CPU encoders for the quantized vertex formats of Model::LoadFlags::QuantizePositions, QuantizeNormals and QuantizeTexCoords.
+        The matching decoders shared with the shaders are in Data/VertexQuantization.h. Encoded values are raw 16-bit words in the order the input assembler reads them.
+    */
+    class VertexQuantizer
+    {
+    public:
+        /** Texture coordinates of a mesh are only stored as half floats if none of them moves by more than this.
+            Half floats have this precision up to an absolute value of 2.
+        */
+        static const float kMaxTexCoordError;
+
+        /** Memory and precision of the quantized vertex buffers of a model
+        */
+        struct Report
+        {
+            uint32_t meshCount = 0;             ///< Number of meshes
+            uint32_t quantizedMeshCount = 0;    ///< Number of meshes with at least one quantized attribute
+            uint64_t bytesBefore = 0;           ///< Size of the vertex buffers at full precision
+            uint64_t bytesAfter = 0;            ///< Size of the vertex buffers as created
+            float maxPositionError = 0;         ///< Largest distance between a position and its decoded value, in object space
+            float maxNormalError = 0;           ///< Largest angle between a normal or bitangent and its decoded value, in degrees
+            float maxTexCoordError = 0;         ///< Largest difference between a texture coordinate component and its decoded value
+
+            Report& operator+=(const Report& other);
+
+            /** Format the report for logging
+            */
+            std::string getString(const std::string& modelName) const;
+        };
+
+        /** Encode a unit vector to octahedral coordinates in 2x16-bit SNORM. Of the four nearest encodings, the one with the smallest angular error is picked.
+            Zero vectors encode to (0, 0), which decodes to +Z.
+        */
+        static void encodeOct(const glm::vec3& n, uint16_t encoded[2]);
+        static glm::vec3 decodeOct(const uint16_t encoded[2]);
+
+        /** Get the decoding of positions quantized relative to an AABB, for decodePosition() in Data/VertexQuantization.h
+            \param[in] minPoint Minimum corner of the AABB
+            \param[in] maxPoint Maximum corner of the AABB
+            \param[out] scale Half the AABB extent. Flat dimensions get a scale of 1.
+            \param[out] offset The AABB center
+        */
+        static void getPositionDecode(const glm::vec3& minPoint, const glm::vec3& maxPoint, glm::vec3& scale, glm::vec3& offset);
+
+        /** Encode a position to 4x16-bit SNORM coordinates in the AABB described by the decode parameters. W is set to 1.
+        */
+        static void encodePosition(const glm::vec3& p, const glm::vec3& scale, const glm::vec3& offset, uint16_t encoded[4]);
+        static glm::vec3 decodePosition(const uint16_t encoded[4], const glm::vec3& scale, const glm::vec3& offset);
+
+        /** Encode a texture coordinate to 2 half floats
+        */
+        static void encodeTexCoord(const glm::vec2& texC, uint16_t encoded[2]);
+        static glm::vec2 decodeTexCoord(const uint16_t encoded[2]);
+
+        /** Quantize a stream of vertex attributes.
+            \param[in] pSrc First source element. Positions and unit vectors are read as 3 floats, texture coordinates as 2 floats.
+            \param[in] srcStride Distance between source elements in bytes
+            \param[in] count Number of elements
+            \param[out] pDst Encoded elements, tightly packed. 4 words per position, 2 per unit vector or texture coordinate.
+            \return The largest reconstruction error, measured like the matching Report field
+        */
+        static float quantizePositions(const void* pSrc, uint32_t srcStride, uint32_t count, const glm::vec3& scale, const glm::vec3& offset, uint16_t* pDst);
+        static float quantizeUnitVectors(const void* pSrc, uint32_t srcStride, uint32_t count, uint16_t* pDst);
+        static float quantizeTexCoords(const void* pSrc, uint32_t srcStride, uint32_t count, uint16_t* pDst);
+    };
+}
@@ -35,6 +35,8 @@
 #include "Utils/AABB.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Paths/MovableObject.h"
+#include "Data/VertexQuantization.h"
+#include "Graphics/Model/Meshlet.h"
 
 namespace Falcor
 {
@@ -56,6 +58,15 @@ namespace Falcor
         using SharedPtr = std::shared_ptr<Mesh>;
         using SharedConstPtr = std::shared_ptr<const Mesh>;
 
+        /** How the vertex attributes of the mesh are quantized. Set by the importers, see Model::LoadFlags::QuantizePositions and friends.
+        */
+        struct VertexQuantization
+        {
+            uint32_t flags = 0;                         ///< Combination of the VERTEX_QUANTIZE_* flags in Data/VertexQuantization.h
+            glm::vec3 positionScale = glm::vec3(1);     ///< Quantized positions are decoded as q * positionScale + positionOffset
+            glm::vec3 positionOffset = glm::vec3(0);
+        };
+
         /** create a new mesh
             \param[in] VertexBuffers Vector of vertex buffer descriptors
             \param[in] VertexCount Number of vertices in the vertex buffer
@@ -112,6 +123,14 @@ namespace Falcor
         */
         const Vao::SharedPtr& getVao() const { return mpVao; }
 
+        /** Get the quantization of the mesh's vertex attributes
+        */
+        const VertexQuantization& getVertexQuantization() const { return mVertexQuantization; }
+
+        /** Get the mesh's meshlets, or nullptr if the model wasn't loaded with Model::LoadFlags::GenerateMeshlets
+        */
+        const MeshletData* getMeshlets() const { return mpMeshlets.get(); }
+
         /** Get global mesh ID
         */
         const uint32_t getId() const { return mId; }
@@ -129,6 +148,7 @@ namespace Falcor
         friend AssimpModelImporter;
         friend BinaryModelImporter;
         friend SimpleModelImporter;
+        friend class SceneSnapshot;
 
     private:
         Mesh(const Vao::BufferVec& vertexBuffers,
@@ -152,5 +172,7 @@ namespace Falcor
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
         Vao::SharedPtr mpVao;
+        VertexQuantization mVertexQuantization;
+        std::shared_ptr<const MeshletData> mpMeshlets;
     };
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Meshlet.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    uint32_t cullMeshlets(const MeshletData& meshletData, const glm::mat4& worldMat, const Camera* pCamera, bool cullBackfaces, std::vector<glm::uvec2>& ranges, MeshletCullingStats* pStats)
+    {
+        ranges.clear();
+
+        // The spheres are tested as world-space boxes. The radius scales with the largest axis of the world matrix.
+        const vec3 axes[3] = { vec3(worldMat[0]), vec3(worldMat[1]), vec3(worldMat[2]) };
+        const float radiusScale = sqrt(max(max(dot(axes[0], axes[0]), dot(axes[1], axes[1])), dot(axes[2], axes[2])));
+
+        // The cone test is done in object space. It is invariant to affine transforms, except that a mirroring transform swaps front and back faces.
+        cullBackfaces = cullBackfaces && (determinant(mat3(worldMat)) > 0);
+        const vec3 eye = cullBackfaces ? vec3(inverse(worldMat) * vec4(pCamera->getPosition(), 1)) : vec3(0);
+
+        MeshletCullingStats stats;
+        uint32_t visibleTriangles = 0;
+        for (const Meshlet& meshlet : meshletData.meshlets)
+        {
+            stats.meshletCount++;
+            stats.triangleCount += meshlet.triangleCount;
+
+            if (cullBackfaces && meshlet.coneCutoff <= 1 && dot(normalize(meshlet.coneApex - eye), meshlet.coneAxis) >= meshlet.coneCutoff)
+            {
+                stats.backfaceCulledCount++;
+                continue;
+            }
+
+            BoundingBox box;
+            box.center = vec3(worldMat * vec4(meshlet.center, 1));
+            box.extent = vec3(meshlet.radius * radiusScale);
+            if (pCamera->isObjectCulled(box))
+            {
+                stats.frustumCulledCount++;
+                continue;
+            }
+
+            const uint32_t firstIndex = meshlet.triangleOffset * 3;
+            const uint32_t indexCount = meshlet.triangleCount * 3;
+            if (ranges.size() && ranges.back().x + ranges.back().y == firstIndex)
+            {
+                ranges.back().y += indexCount;
+            }
+            else
+            {
+                ranges.push_back(uvec2(firstIndex, indexCount));
+            }
+            visibleTriangles += meshlet.triangleCount;
+        }
+
+        if (pStats)
+        {
+            stats.visibleTriangleCount = visibleTriangles;
+            stats.rangeCount = ranges.size();
+            *pStats += stats;
+        }
+        return visibleTriangles;
+    }
+}
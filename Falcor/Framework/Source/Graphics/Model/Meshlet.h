@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** A cluster of a mesh's triangles with bounds for culling. Meshlets are built by MeshletBuilder when a model is loaded with Model::LoadFlags::GenerateMeshlets.
+        The triangles of a meshlet are contiguous in the mesh's index buffer, so the visible meshlets can be drawn as index ranges. Each meshlet also has its own vertex list
+        and local indices into it, which is the layout mesh shaders consume.
+    */
+    struct Meshlet
+    {
+        uint32_t vertexOffset = 0;      ///< First entry in MeshletData::vertices
+        uint32_t vertexCount = 0;       ///< Number of vertices
+        uint32_t triangleOffset = 0;    ///< First triangle in the mesh's index buffer, which is also the first triangle in MeshletData::primitiveIndices
+        uint32_t triangleCount = 0;     ///< Number of triangles
+        glm::vec3 center;               ///< Bounding sphere center, in object space
+        float radius = 0;               ///< Bounding sphere radius
+        glm::vec3 coneApex;             ///< Normal cone apex, in object space. All triangles are back-facing when dot(normalize(coneApex - eye), coneAxis) >= coneCutoff.
+        glm::vec3 coneAxis;             ///< Normal cone axis
+        float coneCutoff = 2;           ///< Sine of the normal cone's half-angle. Larger than 1 if the meshlet's normals are too spread out for back-face culling.
+    };
+
+    /** The meshlets of a mesh
+    */
+    struct MeshletData
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> vertices;         ///< Vertex lists of the meshlets. Entries are indices into the mesh's vertex buffers.
+        std::vector<uint8_t> primitiveIndices;  ///< 3 indices per triangle into the meshlet's vertex list
+    };
+
+    /** Meshlet culling statistics
+    */
+    struct MeshletCullingStats
+    {
+        uint64_t meshletCount = 0;          ///< Number of meshlets tested
+        uint64_t frustumCulledCount = 0;    ///< Number of meshlets outside the frustum
+        uint64_t backfaceCulledCount = 0;   ///< Number of meshlets culled by their normal cone
+        uint64_t triangleCount = 0;         ///< Number of triangles tested
+        uint64_t visibleTriangleCount = 0;  ///< Number of triangles in visible meshlets
+        uint64_t rangeCount = 0;            ///< Number of index ranges the visible meshlets were merged into
+
+        MeshletCullingStats& operator+=(const MeshletCullingStats& other)
+        {
+            meshletCount += other.meshletCount;
+            frustumCulledCount += other.frustumCulledCount;
+            backfaceCulledCount += other.backfaceCulledCount;
+            triangleCount += other.triangleCount;
+            visibleTriangleCount += other.visibleTriangleCount;
+            rangeCount += other.rangeCount;
+            return *this;
+        }
+    };
+
+    /** Cull the meshlets of a mesh instance on the CPU.
+        \param[in] meshletData The mesh's meshlets
+        \param[in] worldMat The instance's world matrix
+        \param[in] pCamera The camera to cull against
+        \param[in] cullBackfaces Whether meshlets can be culled by their normal cone. Only valid if the rasterizer culls counter-clockwise back faces. Ignored for mirroring world matrices.
+        \param[out] ranges The visible index ranges, as (first index, index count). Consecutive visible meshlets are merged into a single range.
+        \param[in, out] pStats Optional statistics, which are accumulated
+        \return The number of visible triangles
+    */
+    uint32_t cullMeshlets(const MeshletData& meshletData, const glm::mat4& worldMat, const Camera* pCamera, bool cullBackfaces, std::vector<glm::uvec2>& ranges, MeshletCullingStats* pStats = nullptr);
+}
@@ -30,6 +30,7 @@
 #include "Loaders/AssimpModelImporter.h"
 #include "Loaders/BinaryModelImporter.h"
 #include "Loaders/BinaryModelExporter.h"
+#include "Loaders/ModelPreload.h"
 #include "Utils/Platform/OS.h"
 #include "Mesh.h"
 #include "AnimationController.h"
@@ -37,6 +38,7 @@
 #include "API/Buffer.h"
 #include "API/Texture.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureRegistry.h"
 #include "Utils/StringUtils.h"
 #include "Graphics/Camera/Camera.h"
 #include "API/VAO.h"
@@ -86,9 +88,25 @@ namespace Falcor
 
     Model::~Model() = default;
 
-    Model::SharedPtr Model::createFromFile(const char* filename, LoadFlags flags)
+    std::shared_ptr<ModelPreload> Model::preloadFromFile(const char* filename, LoadFlags flags)
+    {
+        auto pPreload = std::make_shared<ModelPreload>();
+        bool res;
+        if(hasSuffix(filename, ".bin", false))
+        {
+            res = BinaryModelImporter::preload(filename, *pPreload);
+        }
+        else
+        {
+            res = AssimpModelImporter::preload(filename, flags, *pPreload);
+        }
+        return res ? pPreload : nullptr;
+    }
+
+    Model::SharedPtr Model::createFromFile(const char* filename, LoadFlags flags, const ModelPreload* pPreload)
     {
         SharedPtr pModel = SharedPtr(new Model());
+        TextureRegistry::Stats texStats = TextureRegistry::getStats();
         bool res;
         if(hasSuffix(filename, ".bin", false))
         {
@@ -96,11 +114,17 @@ namespace Falcor
         }
         else
         {
-            res = AssimpModelImporter::import(*pModel, filename, flags);
+            res = AssimpModelImporter::import(*pModel, filename, flags, pPreload);
         }
 
         if(res)
         {
+            texStats = TextureRegistry::getStats() - texStats;
+            if(texStats.lookupCount)
+            {
+                logInfo(TextureRegistry::getReport(filename, texStats));
+            }
+
             pModel->calculateModelProperties();
             pModel->setFilename(filename);
 
@@ -42,6 +42,7 @@ namespace Falcor
     class BinaryModelImporter;
     class SimpleModelImporter;
     class BinaryModelExporter;
+    struct ModelPreload;
     class Buffer;
     class Camera;
 
@@ -67,11 +68,27 @@ namespace Falcor
             BuffersAsShaderResource     = 0x10,   ///< Generate the VBs and IB with the shader-resource-view bind flag
             RemoveInstancing            = 0x20,   ///< Flatten mesh instances
             UseSpecGlossMaterials       = 0x40,   ///< Set materials to use Spec-Gloss shading model. Otherwise default is Metal-Rough.
+            DontUseModelCache           = 0x80,   ///< Always run the importer, bypassing the processed-model cache (see ModelCache)
+            OptimizeVertexCache         = 0x100,  ///< Reorder triangles and vertices for post-transform cache hits and vertex fetch locality. Logs the ACMR/ATVR before and after.
+            QuantizePositions           = 0x200,  ///< Store positions as 16-bit SNORM relative to the mesh AABB. The Quantize* flags skip skinned and emissive meshes, and log the memory saved and the reconstruction error.
+            QuantizeNormals             = 0x400,  ///< Store normals and bitangents octahedral-encoded in 2x16-bit SNORM
+            QuantizeTexCoords           = 0x800,  ///< Store texture coordinates as half floats, unless that loses too much precision for the mesh's UV range (see VertexQuantizer::kMaxTexCoordError)
+            GenerateMeshlets            = 0x1000, ///< Split triangle meshes into meshlets with bounds, which SceneRenderer culls individually. Reorders the triangles. Skinned meshes are skipped.
+            StreamTextures              = 0x2000, ///< Load the textures in the background with TextureStreamer. Materials get a placeholder, then the mip tail, then the full texture. DDS files are loaded normally.
         };
 
         /** Create a new model from file
+            \param[in] filename Model's filename. Can include a full path or a relative path from a data directory
+            \param[in] flags Flags controlling model creation
+            \param[in] pPreload Optional. The result of preloadFromFile() for the same file and flags, which skips the CPU part of the load.
         */
-        static SharedPtr createFromFile(const char* filename, LoadFlags flags = LoadFlags::None);
+        static SharedPtr createFromFile(const char* filename, LoadFlags flags = LoadFlags::None, const ModelPreload* pPreload = nullptr);
+
+        /** Run the CPU part of loading a model: reading and parsing the file, processing the meshes and decoding the textures.
+            No GPU resources are created, so this can be called on worker threads, for several models concurrently. Pass the result to createFromFile() on the render thread.
+            \return The preloaded data, or nullptr if the file can't be read
+        */
+        static std::shared_ptr<ModelPreload> preloadFromFile(const char* filename, LoadFlags flags = LoadFlags::None);
 
         static SharedPtr create();
 
@@ -255,6 +272,7 @@ namespace Falcor
 
     protected:
         friend class SimpleModelImporter;
+        friend class SceneSnapshot;
 
         Model();
         Model(const Model& other);
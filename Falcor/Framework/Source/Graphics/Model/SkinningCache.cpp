@@ -39,14 +39,17 @@ namespace Falcor
 
     static const uint32_t kGroupSize = 256;     // threads per group
 
-    SkinningCache::SharedPtr SkinningCache::create()
+    SkinningCache::SharedPtr SkinningCache::create(Mode mode)
     {
         SharedPtr ptr = SharedPtr(new SkinningCache());
+        ptr->mMode = mode;
         return ptr->init() ? ptr : nullptr;
     }
 
     bool SkinningCache::update(const Model* pModel)
     {
+        if (mMode == Mode::Cpu) return updateCpu(pModel);
+
         bool changed = false;
         if (pModel->hasBones())
         {
@@ -82,6 +85,15 @@ namespace Falcor
         return changed;
     }
 
+    void SkinningCache::setMode(Mode mode)
+    {
+        if (mode == mMode) return;
+
+        // The GPU path doesn't update the positions kept on the CPU, so the CPU path starts over from the current frame
+        for (auto& buffers : mSkinnedBuffers) buffers.second.cpuVertices.positions.clear();
+        mMode = mode;
+    }
+
     Vao::SharedPtr SkinningCache::getVao(const Mesh* pMesh) const
     {
         auto it = mSkinnedBuffers.find(pMesh);
@@ -303,4 +315,95 @@ namespace Falcor
 
         it->second.valid = true;
     }
-}
\ No newline at end of file
+
+    // Read a vertex element back into a tightly packed array. Returns false if the mesh doesn't have the element.
+    template<typename T>
+    static bool readVertexElement(uint32_t vertexLoc, const Vao* pVao, uint32_t vertexCount, ResourceFormat expectedFormat, std::vector<T>& data)
+    {
+        data.clear();
+        const auto& elemDesc = pVao->getElementIndexByLocation(vertexLoc);
+        if (elemDesc.elementIndex == Vao::ElementDesc::kInvalidIndex) return false;
+
+        assert(elemDesc.vbIndex != Vao::ElementDesc::kInvalidIndex);
+        const auto& pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex);
+        assert(pVbLayout->getElementFormat(elemDesc.elementIndex) == expectedFormat);
+        assert(getFormatBytesPerBlock(expectedFormat) == sizeof(T));
+
+        Buffer* pVB = pVao->getVertexBuffer(elemDesc.vbIndex).get();
+        const uint32_t stride = pVbLayout->getStride();
+        const uint8_t* pVertices = (const uint8_t*)pVB->map(Buffer::MapType::Read) + pVbLayout->getElementOffset(elemDesc.elementIndex);
+        data.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            std::memcpy(&data[i], pVertices + i * stride, sizeof(T));
+        }
+        pVB->unmap();
+        return true;
+    }
+
+    static void uploadVertexElement(uint32_t vertexLoc, const Vao* pVao, const std::vector<glm::vec3>& data)
+    {
+        const auto& elemDesc = pVao->getElementIndexByLocation(vertexLoc);
+        if (data.empty() || elemDesc.vbIndex == Vao::ElementDesc::kInvalidIndex) return;
+
+        assert(elemDesc.elementIndex == 0);
+        pVao->getVertexBuffer(elemDesc.vbIndex)->updateData(data.data(), 0, data.size() * sizeof(glm::vec3));
+    }
+
+    bool SkinningCache::updateCpu(const Model* pModel)
+    {
+        bool changed = false;
+        if (pModel->hasBones())
+        {
+            assert(pModel->getBoneCount() <= MAX_BONES);
+            for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+            {
+                const Mesh* pMesh = pModel->getMesh(meshId).get();
+                if (pMesh->hasBones())
+                {
+                    createVertexBuffers(pMesh);
+                    skinMeshCpu(pModel, pMesh);
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+
+    void SkinningCache::skinMeshCpu(const Model* pModel, const Mesh* pMesh)
+    {
+        const auto& it = mSkinnedBuffers.find(pMesh);
+        assert(it != mSkinnedBuffers.end());
+        VertexBuffers& buffers = it->second;
+
+        // Read back the bind pose the first time the mesh is skinned
+        if (buffers.pCpuSource == nullptr)
+        {
+            buffers.pCpuSource = std::make_shared<CpuSkinning::SourceVertices>();
+            CpuSkinning::SourceVertices& source = *buffers.pCpuSource;
+            const Vao* pVao = pMesh->getVao().get();
+            const uint32_t vertexCount = pMesh->getVertexCount();
+            bool hasPos = readVertexElement(VERTEX_POSITION_LOC, pVao, vertexCount, ResourceFormat::RGB32Float, source.positions);
+            readVertexElement(VERTEX_NORMAL_LOC, pVao, vertexCount, ResourceFormat::RGB32Float, source.normals);
+            readVertexElement(VERTEX_BITANGENT_LOC, pVao, vertexCount, ResourceFormat::RGB32Float, source.bitangents);
+            bool hasBoneWeight = readVertexElement(VERTEX_BONE_WEIGHT_LOC, pVao, vertexCount, ResourceFormat::RGBA32Float, source.boneWeights);
+            bool hasBoneId = readVertexElement(VERTEX_BONE_ID_LOC, pVao, vertexCount, ResourceFormat::RGBA8Uint, source.boneIds);
+            assert(hasPos && hasBoneWeight && hasBoneId);
+        }
+
+        // Last frame's positions become the previous positions. On the first frame they are the current positions, as in the shader.
+        const bool firstFrame = !buffers.valid || buffers.cpuVertices.positions.empty();
+        if (!firstFrame) std::swap(buffers.cpuPrevPositions, buffers.cpuVertices.positions);
+
+        CpuSkinning::skin(*buffers.pCpuSource, pModel->getBoneMatrices(), pModel->getBoneInvTransposeMatrices(), pModel->getBoneCount(), buffers.cpuVertices);
+        if (firstFrame) buffers.cpuPrevPositions = buffers.cpuVertices.positions;
+
+        const Vao* pVaoOut = buffers.pVao.get();
+        uploadVertexElement(VERTEX_POSITION_LOC, pVaoOut, buffers.cpuVertices.positions);
+        uploadVertexElement(VERTEX_PREV_POSITION_LOC, pVaoOut, buffers.cpuPrevPositions);
+        uploadVertexElement(VERTEX_NORMAL_LOC, pVaoOut, buffers.cpuVertices.normals);
+        uploadVertexElement(VERTEX_BITANGENT_LOC, pVaoOut, buffers.cpuVertices.bitangents);
+
+        buffers.valid = true;
+    }
+}
@@ -28,6 +28,7 @@
 #pragma once
 #include <map>
 #include "API/RenderContext.h"
+#include "Graphics/Model/CpuSkinning.h"
 
 namespace Falcor
 {
@@ -55,6 +56,8 @@ namespace Falcor
 
         4)  Provide metric on amount of change to guide choice of BVH rebuild/refit for ray tracing purposes.
 
+        The vertices can also be skinned on the CPU, see Mode::Cpu. That path produces the same vertex buffers.
+
     */
     class SkinningCache : public std::enable_shared_from_this<SkinningCache>
     {
@@ -63,7 +66,23 @@ namespace Falcor
         using SharedConstPtr = std::shared_ptr<const SkinningCache>;
         virtual ~SkinningCache() = default;
 
-        static SharedPtr create();
+        /** Where the vertices are skinned
+        */
+        enum class Mode
+        {
+            Gpu,    ///< With a compute shader
+            Cpu,    ///< With CpuSkinning on all cores. The results are uploaded to the same vertex buffers the GPU path writes. The bind pose of each mesh is read back once.
+        };
+
+        static SharedPtr create(Mode mode = Mode::Gpu);
+
+        /** Set where the vertices are skinned. Takes effect on the next update().
+        */
+        void setMode(Mode mode);
+
+        /** Get where the vertices are skinned
+        */
+        Mode getMode() const { return mMode; }
 
         /** Create/update skinned vertex buffers for model.
         */
@@ -80,6 +99,8 @@ namespace Falcor
         void initVariableOffsets(const ParameterBlockReflection* pBlock);
         void initMeshBufferLocations(const ParameterBlockReflection* pBlock);
         void createVertexBuffers(const Mesh* pMesh);
+        bool updateCpu(const Model* pModel);
+        void skinMeshCpu(const Model* pModel, const Mesh* pMesh);
         void setPerModelData(const Model* pModel);
         void setPerMeshData(const Mesh* pMesh);
 
@@ -87,6 +108,11 @@ namespace Falcor
         {
             Vao::SharedPtr pVao;
             bool valid = false;
+
+            // CPU skinning state. The previous positions are kept to fill the previous position buffer.
+            std::shared_ptr<CpuSkinning::SourceVertices> pCpuSource;
+            CpuSkinning::SkinnedVertices cpuVertices;
+            std::vector<glm::vec3> cpuPrevPositions;
         };
 
         struct VariableOffsets
@@ -110,6 +136,7 @@ namespace Falcor
             ParameterBlockReflection::BindLocation bitangentOut;
         };
 
+        Mode mMode = Mode::Gpu;
         VariableOffsets mVariableOffsets;
         MeshBufferLocations mMeshBufferLocations;
 
@@ -29,10 +29,14 @@
 #include "Framework.h"
 #include "ObjectPath.h"
 #include "MovableObject.h"
+#include "Utils/ParallelFor.h"
 #include <algorithm>
 
 namespace Falcor
 {
+    // Number of times ObjectPath::evaluate() hands to a thread at once
+    static const uint32_t kFramesPerBatch = 256;
+
     ObjectPath::SharedPtr ObjectPath::create()
     {
         return SharedPtr(new ObjectPath);
@@ -91,6 +95,45 @@ namespace Falcor
             return false;
         }
 
+        updateInterpolation();
+        mCurrentFrame = evaluateFrame(getAnimationTime(currentTime));
+
+        for(auto& pObj : mpObjects)
+        {
+            pObj->move(mCurrentFrame.position, mCurrentFrame.target, mCurrentFrame.up);
+        }
+
+        return true;
+    }
+
+    void ObjectPath::evaluate(const std::vector<double>& times, std::vector<Frame>& frames, uint32_t maxThreads)
+    {
+        frames.resize(times.size());
+        if(mKeyFrames.size() == 0)
+        {
+            return;
+        }
+
+        updateInterpolation();
+        const uint32_t count = (uint32_t)times.size();
+        const uint32_t batchCount = (count + kFramesPerBatch - 1) / kFramesPerBatch;
+        parallelFor(batchCount, [&](uint32_t batch)
+        {
+            for(uint32_t i = batch * kFramesPerBatch; i < std::min(count, (batch + 1) * kFramesPerBatch); i++)
+            {
+                frames[i] = evaluateFrame(getAnimationTime(times[i]));
+            }
+        }, maxThreads);
+    }
+
+    float ObjectPath::getPathLength()
+    {
+        updateInterpolation();
+        return mArcLengths.empty() ? 0.0f : mArcLengths.back();
+    }
+
+    double ObjectPath::getAnimationTime(double currentTime) const
+    {
         double animTime = currentTime;
         const auto& firstFrame = mKeyFrames[0];
         const auto& lastFrame = mKeyFrames[mKeyFrames.size() - 1];
@@ -105,65 +148,116 @@ namespace Falcor
             else
                 animTime = lastFrame.time;
         }
+        return animTime;
+    }
 
+    ObjectPath::Frame ObjectPath::evaluateFrame(double animTime) const
+    {
+        const auto& firstFrame = mKeyFrames[0];
+        const auto& lastFrame = mKeyFrames[mKeyFrames.size() - 1];
         if(animTime >= lastFrame.time)
         {
-            mCurrentFrame = lastFrame;
+            return lastFrame;
         }
         else if(animTime <= firstFrame.time)
         {
-            mCurrentFrame = firstFrame;
+            return firstFrame;
         }
-        else
-        {
-            // Find out where we are
-            bool foundFrame = false;
-            for(uint32_t i = 0 ; i < (uint32_t)mKeyFrames.size() - 1; i++)
-            {
-                const auto& curKey = mKeyFrames[i];
-                const auto& nextKey = mKeyFrames[i + 1];
 
-                if(animTime >= curKey.time && animTime < nextKey.time)
-                {
-                    // Found the animation keys. Interpolate
-                    float t = getInterpolationFactor(i, animTime);
-                    getFrameAt(i, t, mCurrentFrame);
-                    foundFrame = true;
-                    break;
-                }
-            }
-            assert(foundFrame);
-        }
-
-        for(auto& pObj : mpObjects)
+        if(mPlayback == Playback::ConstantSpeed && mArcLengths.size() > 1 && mArcLengths.back() > 0)
         {
-            pObj->move(mCurrentFrame.position, mCurrentFrame.target, mCurrentFrame.up);
+            // The time maps linearly to a distance along the path. The arc length table maps the distance to a segment and an interpolation factor.
+            const float distance = float((animTime - firstFrame.time) / (lastFrame.time - firstFrame.time)) * mArcLengths.back();
+            const auto it = std::upper_bound(mArcLengths.begin(), mArcLengths.end(), distance);
+            const uint32_t sample = std::min((uint32_t)(it - mArcLengths.begin()), (uint32_t)mArcLengths.size() - 1) - 1;
+            const float sampleLength = mArcLengths[sample + 1] - mArcLengths[sample];
+            const float fraction = (sampleLength > 0) ? (distance - mArcLengths[sample]) / sampleLength : 0.0f;
+
+            Frame frame = interpolateFrame(sample / kArcLengthSamplesPerSegment, (float(sample % kArcLengthSamplesPerSegment) + fraction) / float(kArcLengthSamplesPerSegment));
+            frame.time = float(animTime);
+            return frame;
         }
 
-        return true;
+        // Find out where we are
+        const auto it = std::upper_bound(mKeyFrames.begin(), mKeyFrames.end(), animTime, [](double time, const Frame& frame) { return time < frame.time; });
+        const uint32_t frameID = uint32_t(it - mKeyFrames.begin()) - 1;
+        return interpolateFrame(frameID, getInterpolationFactor(frameID, animTime));
     }
 
     void ObjectPath::getFrameAt(uint32_t frameID, float t, Frame& frameOut)
+    {
+        updateInterpolation();
+        frameOut = interpolateFrame(frameID, t);
+    }
+
+    ObjectPath::Frame ObjectPath::interpolateFrame(uint32_t frameID, float t) const
     {
         if (getKeyFrameCount() == 1)
         {
-            frameOut = mKeyFrames[0];
-            return;
+            return mKeyFrames[0];
         }
 
         if (mMode == Interpolation::Linear || getKeyFrameCount() < 3)
         {
-            frameOut = linearInterpolation(frameID, t);
-            return;
+            return linearInterpolation(frameID, t);
         }
         else if(mMode == Interpolation::CubicSpline)
         {
-            frameOut = cubicSplineInterpolation(frameID, t);
-            return;
+            return cubicSplineInterpolation(frameID, t);
         }
 
         should_not_get_here();
-        return;
+        return Frame();
+    }
+
+    void ObjectPath::updateInterpolation()
+    {
+        if (mDirty == false)
+        {
+            return;
+        }
+        mDirty = false;
+
+        if (mKeyFrames.size() >= 3)
+        {
+            std::vector<glm::vec3> positions, targets, ups;
+            for (auto& a : mKeyFrames)
+            {
+                positions.push_back(a.position);
+                targets.push_back(a.target);
+                ups.push_back(a.up);
+            }
+
+            mpPositionSpline = std::make_unique<Vec3CubicSpline>(positions.data(), uint32_t(mKeyFrames.size()));
+            mpTargetSpline = std::make_unique<Vec3CubicSpline>(targets.data(), uint32_t(mKeyFrames.size()));
+            mpUpSpline = std::make_unique<Vec3CubicSpline>(ups.data(), uint32_t(mKeyFrames.size()));
+        }
+
+        updateArcLengths();
+    }
+
+    void ObjectPath::updateArcLengths()
+    {
+        // Sum the distances between closely spaced positions along each segment
+        mArcLengths.clear();
+        if (mKeyFrames.size() < 2)
+        {
+            return;
+        }
+
+        const uint32_t segmentCount = (uint32_t)mKeyFrames.size() - 1;
+        mArcLengths.reserve(segmentCount * kArcLengthSamplesPerSegment + 1);
+        mArcLengths.push_back(0);
+        glm::vec3 prevPosition = mKeyFrames[0].position;
+        for (uint32_t frameID = 0; frameID < segmentCount; frameID++)
+        {
+            for (uint32_t i = 1; i <= kArcLengthSamplesPerSegment; i++)
+            {
+                const glm::vec3 position = interpolateFrame(frameID, float(i) / float(kArcLengthSamplesPerSegment)).position;
+                mArcLengths.push_back(mArcLengths.back() + glm::length(position - prevPosition));
+                prevPosition = position;
+            }
+        }
     }
 
     float ObjectPath::getInterpolationFactor(uint32_t frameID, double currentTime) const
@@ -191,24 +285,8 @@ namespace Falcor
         return result;
     }
 
-    ObjectPath::Frame ObjectPath::cubicSplineInterpolation(uint32_t currentFrame, float t)
+    ObjectPath::Frame ObjectPath::cubicSplineInterpolation(uint32_t currentFrame, float t) const
     {
-        if (mDirty)
-        {
-            mDirty = false;
-            std::vector<glm::vec3> positions, targets, ups;
-            for (auto& a : mKeyFrames)
-            {
-                positions.push_back(a.position);
-                targets.push_back(a.target);
-                ups.push_back(a.up);
-            }
-
-            mpPositionSpline = std::make_unique<Vec3CubicSpline>(positions.data(), uint32_t(mKeyFrames.size()));
-            mpTargetSpline = std::make_unique<Vec3CubicSpline>(targets.data(), uint32_t(mKeyFrames.size()));
-            mpUpSpline = std::make_unique<Vec3CubicSpline>(ups.data(), uint32_t(mKeyFrames.size()));
-        }
-
         const Frame& current = mKeyFrames[currentFrame];
         const Frame& next = mKeyFrames[currentFrame + 1];
 
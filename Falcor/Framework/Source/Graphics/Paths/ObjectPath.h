@@ -45,6 +45,16 @@ namespace Falcor
         using SharedPtr = std::shared_ptr<ObjectPath>;
         using SharedConstPtr = std::shared_ptr<const ObjectPath>;
 
+        /** Frame data
+        */
+        struct Frame
+        {
+            glm::vec3 position;
+            glm::vec3 target;
+            glm::vec3 up;
+            float time = 0;
+        };
+
         /** Create a path.
         */
         static ObjectPath::SharedPtr create();
@@ -60,7 +70,27 @@ namespace Falcor
 
         /**  Set the interpolation mode.
         */
-        void setInterpolationMode(Interpolation mode) { mMode = mode; }
+        void setInterpolationMode(Interpolation mode) { mDirty = true; mMode = mode; }
+
+        /** How time maps to a position on the path
+        */
+        enum class Playback
+        {
+            KeyFrameTimes,  ///< The key frames are reached at their times. The speed changes between key frames with their distance and time.
+            ConstantSpeed   ///< The path is traversed at constant speed, from the first key frame at the first key frame's time to the last key frame at the last key frame's time. The key frames' other times are ignored.
+        };
+
+        /** Set the playback mode
+        */
+        void setPlaybackMode(Playback playback) { mPlayback = playback; }
+
+        /** Get the playback mode
+        */
+        Playback getPlaybackMode() const { return mPlayback; }
+
+        /** Get the length of the path the positions travel along.
+        */
+        float getPathLength();
 
         /** Insert a key frame. Key frame will be inserted/sorted into the path based on time.
             \param[in] time Time in seconds
@@ -80,6 +110,14 @@ namespace Falcor
         */
         bool animate(double currentTime);
 
+        /** Evaluate the path at many times at once, e.g. to dispatch frames for offline rendering. Attached objects aren't moved and the current frame isn't changed.
+            The times are evaluated like in animate(), and in parallel.
+            \param[in] times Elapsed times in seconds
+            \param[out] frames The frame at each time. Resized to the number of times.
+            \param[in] maxThreads Maximum number of threads to use. 0 uses all cores.
+        */
+        void evaluate(const std::vector<double>& times, std::vector<Frame>& frames, uint32_t maxThreads = 0);
+
         /** Attach a movable object to the path, such as models, cameras, and lights.
         */
         void attachObject(const IMovableObject::SharedPtr& pObject);
@@ -128,16 +166,6 @@ namespace Falcor
         */
         void setName(const std::string& name) { mName = name; }
 
-        /** Frame data
-        */
-        struct Frame
-        {
-            glm::vec3 position;
-            glm::vec3 target;
-            glm::vec3 up;
-            float time = 0;
-        };
-
         /** Get the number of key frames in the path.
         */
         uint32_t getKeyFrameCount() const {return (uint32_t)mKeyFrames.size();}
@@ -180,10 +208,19 @@ namespace Falcor
     private:
         ObjectPath() = default;
 
+        /** The positions are sampled this many times per key frame segment to build the arc length table
+        */
+        static const uint32_t kArcLengthSamplesPerSegment = 64;
+
         float getInterpolationFactor(uint32_t frameID, double currentTime) const;
+        double getAnimationTime(double currentTime) const;
+        void updateInterpolation();
+        void updateArcLengths();
+        Frame evaluateFrame(double animTime) const;
+        Frame interpolateFrame(uint32_t frameID, float t) const;
 
         Frame linearInterpolation(uint32_t currentFrame, float t) const;
-        Frame cubicSplineInterpolation(uint32_t currentFrame, float t);
+        Frame cubicSplineInterpolation(uint32_t currentFrame, float t) const;
 
         std::vector<Frame> mKeyFrames;
         std::vector<IMovableObject::SharedPtr> mpObjects;
@@ -192,8 +229,12 @@ namespace Falcor
 
         Frame mCurrentFrame;
         Interpolation mMode = Interpolation::CubicSpline;
+        Playback mPlayback = Playback::KeyFrameTimes;
         bool mDirty = false;
 
+        // Path length at kArcLengthSamplesPerSegment uniformly spaced parameters per segment, starting with 0 at the first key frame
+        std::vector<float> mArcLengths;
+
         std::unique_ptr<Vec3CubicSpline> mpPositionSpline;
         std::unique_ptr<Vec3CubicSpline> mpTargetSpline;
         std::unique_ptr<Vec3CubicSpline> mpUpSpline;
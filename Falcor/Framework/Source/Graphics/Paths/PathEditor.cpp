@@ -112,6 +112,16 @@ namespace Falcor
         }
     }
 
+    void PathEditor::editPathPlayback(Gui* pGui)
+    {
+        bool constantSpeed = mpPath->getPlaybackMode() == ObjectPath::Playback::ConstantSpeed;
+        if (pGui->addCheckBox("Constant Speed", constantSpeed))
+        {
+            mpPath->setPlaybackMode(constantSpeed ? ObjectPath::Playback::ConstantSpeed : ObjectPath::Playback::KeyFrameTimes);
+        }
+        pGui->addTooltip("Move along the path at constant speed, ignoring the times of all key frames but the first and the last");
+    }
+
     void PathEditor::editPathName(Gui* pGui)
     {
         char buffer[1024];
@@ -152,6 +162,7 @@ namespace Falcor
         pGui->addSeparator();
         editPathName(pGui);
         editPathLoop(pGui);
+        editPathPlayback(pGui);
         editActiveFrameID(pGui);
 
         addFrame(pGui);
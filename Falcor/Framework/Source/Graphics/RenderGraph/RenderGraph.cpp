@@ -529,13 +529,6 @@ namespace Falcor
 
     bool RenderGraph::resolveResourceTypes()
     {
-        // Build list to look up execution order index from the pass
-        std::unordered_map<RenderPass*, uint32_t> passToIndex;
-        for (size_t i = 0; i < mExecutionList.size(); i++)
-        {
-            passToIndex.emplace(mNodeData[mExecutionList[i]].pPass.get(), uint32_t(i));
-        }
-
         for (size_t i = 0; i < mExecutionList.size(); i++)
         {
             uint32_t nodeIndex = mExecutionList[i];
@@ -587,8 +580,8 @@ namespace Falcor
                 auto srcReflection = pSrcPass->reflect();
                 const RenderPassReflection::Field& srcField = srcReflection.getField(edgeData.srcField);
 
-                assert(passToIndex.count(pSrcPass.get()) > 0);
-                mpResourcesCache->registerField(dstFieldName, srcField, passToIndex[pSrcPass.get()], srcFieldName);
+                // The resource must stay alive until this pass reads it, so the alias is registered at the consumer's time point
+                mpResourcesCache->registerField(dstFieldName, srcField, uint32_t(i), srcFieldName);
             }
         }
 
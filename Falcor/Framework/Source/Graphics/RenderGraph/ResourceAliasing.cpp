@@ -0,0 +1,152 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ResourceAliasing.h"
+#include <algorithm>
+#include <queue>
+
+namespace Falcor
+{
+    const uint32_t ResourceAliasing::kInvalidSlot;
+
+    static bool overlaps(const ResourceAliasing::Interval& a, const ResourceAliasing::Interval& b)
+    {
+        return (a.firstUsed <= b.lastUsed) && (b.firstUsed <= a.lastUsed);
+    }
+
+    ResourceAliasing::Placement ResourceAliasing::place(const std::vector<Interval>& intervals, uint32_t bucketCount)
+    {
+        Placement placement;
+        placement.slot.assign(intervals.size(), kInvalidSlot);
+        placement.slotCount.assign(bucketCount, 0);
+
+        // Group the intervals by bucket, sorted by first use. Ties are broken by the original index so the result is deterministic
+        std::vector<uint32_t> order(intervals.size());
+        for (uint32_t i = 0; i < (uint32_t)order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            const Interval& ia = intervals[a];
+            const Interval& ib = intervals[b];
+            if (ia.bucket != ib.bucket) return ia.bucket < ib.bucket;
+            if (ia.firstUsed != ib.firstUsed) return ia.firstUsed < ib.firstUsed;
+            return a < b;
+        });
+
+        // Min-heap of (lastUsed, slot) for the slots that are currently alive in the bucket
+        using SlotEnd = std::pair<uint32_t, uint32_t>;
+        std::priority_queue<SlotEnd, std::vector<SlotEnd>, std::greater<SlotEnd>> active;
+        uint32_t currentBucket = uint32_t(-1);
+
+        for (uint32_t index : order)
+        {
+            const Interval& interval = intervals[index];
+            if (interval.bucket >= bucketCount)
+            {
+                logWarning("ResourceAliasing::place() - interval bucket is out of range. Ignoring interval.");
+                continue;
+            }
+
+            if (interval.bucket != currentBucket)
+            {
+                active = decltype(active)();
+                currentBucket = interval.bucket;
+            }
+
+            uint32_t& slotCount = placement.slotCount[interval.bucket];
+            if (interval.exclusive)
+            {
+                // Never goes into the heap, so it is never reused
+                placement.slot[index] = slotCount++;
+                continue;
+            }
+
+            uint32_t slot;
+            if (active.empty() == false && active.top().first < interval.firstUsed)
+            {
+                slot = active.top().second;
+                active.pop();
+            }
+            else
+            {
+                slot = slotCount++;
+            }
+
+            placement.slot[index] = slot;
+            active.push({ interval.lastUsed, slot });
+        }
+
+        return placement;
+    }
+
+    bool ResourceAliasing::validate(const std::vector<Interval>& intervals, const Placement& placement)
+    {
+        if (placement.slot.size() != intervals.size()) return false;
+
+        for (size_t i = 0; i < intervals.size(); i++)
+        {
+            if (placement.slot[i] == kInvalidSlot) return false;
+            if (placement.slot[i] >= placement.slotCount[intervals[i].bucket]) return false;
+
+            for (size_t j = i + 1; j < intervals.size(); j++)
+            {
+                if (intervals[i].bucket != intervals[j].bucket || placement.slot[i] != placement.slot[j]) continue;
+                if (intervals[i].exclusive || intervals[j].exclusive) return false;
+                if (overlaps(intervals[i], intervals[j])) return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t ResourceAliasing::getMaxOverlap(const std::vector<Interval>& intervals, uint32_t bucket)
+    {
+        // Sweep over the interval end points. Starts sort before ends at the same time point since both ends are inclusive
+        std::vector<std::pair<uint64_t, int32_t>> events;
+        uint32_t exclusiveCount = 0;
+        for (const auto& i : intervals)
+        {
+            if (i.bucket != bucket) continue;
+            if (i.exclusive)
+            {
+                exclusiveCount++;
+                continue;
+            }
+            events.push_back({ (uint64_t)i.firstUsed * 2, 1 });
+            events.push_back({ (uint64_t)i.lastUsed * 2 + 1, -1 });
+        }
+        std::sort(events.begin(), events.end());
+
+        int32_t alive = 0;
+        int32_t maxAlive = 0;
+        for (const auto& e : events)
+        {
+            alive += e.second;
+            maxAlive = std::max(maxAlive, alive);
+        }
+        return (uint32_t)maxAlive + exclusiveCount;
+    }
+}
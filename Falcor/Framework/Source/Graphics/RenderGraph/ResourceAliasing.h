@@ -0,0 +1,76 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <cstdint>
+
+namespace Falcor
+{
+    /** Assigns resource lifetimes to a minimal set of physical allocations.
+        This class is pure CPU code and has no dependency on the device, so it can be tested with synthetic graphs.
+
+        Every interval belongs to a compatibility bucket. Only intervals in the same bucket can share an allocation.
+        Inside a bucket, intervals are placed using greedy interval partitioning ordered by first use, which produces
+        the minimal number of allocations (equal to the maximum number of overlapping intervals).
+    */
+    class ResourceAliasing
+    {
+    public:
+        static const uint32_t kInvalidSlot = uint32_t(-1);
+
+        /** A resource lifetime, in execution order time points. Both ends are inclusive.
+        */
+        struct Interval
+        {
+            uint32_t bucket = 0;        ///< Compatibility bucket. Intervals in different buckets never share a slot
+            uint32_t firstUsed = 0;     ///< First time point the resource is used
+            uint32_t lastUsed = 0;      ///< Last time point the resource is used
+            bool exclusive = false;     ///< If true, the interval gets a slot of its own. Use it for resources which must persist between frames
+        };
+
+        struct Placement
+        {
+            std::vector<uint32_t> slot;         ///< For each interval, the slot index inside its bucket
+            std::vector<uint32_t> slotCount;    ///< For each bucket, the number of slots required
+        };
+
+        /** Place the intervals.
+            \param[in] intervals The intervals to place
+            \param[in] bucketCount The number of buckets. Every Interval::bucket must be smaller than this
+        */
+        static Placement place(const std::vector<Interval>& intervals, uint32_t bucketCount);
+
+        /** Check that no two overlapping intervals share a slot. Used for validation and testing.
+        */
+        static bool validate(const std::vector<Interval>& intervals, const Placement& placement);
+
+        /** Compute the lower bound on the number of slots in a bucket, which is the maximum number of intervals alive at the same time point.
+        */
+        static uint32_t getMaxOverlap(const std::vector<Interval>& intervals, uint32_t bucket);
+    };
+}
@@ -41,6 +41,19 @@ namespace Falcor
         mResourceData.clear();
     }
 
+    void ResourceCache::releasePool()
+    {
+        mPool.clear();
+        mPinnedTextures.clear();
+        for (auto& data : mResourceData) data.pResource = nullptr;
+    }
+
+    bool ResourceCache::TextureDesc::operator==(const TextureDesc& other) const
+    {
+        return width == other.width && height == other.height && depth == other.depth &&
+            sampleCount == other.sampleCount && format == other.format && bindFlags == other.bindFlags;
+    }
+
     const std::shared_ptr<Resource>& ResourceCache::getResource(const std::string& name) const
     {
         static const std::shared_ptr<Resource> pNull;
@@ -210,34 +223,28 @@ namespace Falcor
         }
     }
 
-    Texture::SharedPtr createTextureForPass(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field)
+    Texture::SharedPtr createTexture(uint32_t width, uint32_t height, uint32_t depth, uint32_t sampleCount, ResourceFormat format, Resource::BindFlags bindFlags)
     {
-        uint32_t width = field.getWidth() ? field.getWidth() : params.width;
-        uint32_t height = field.getHeight() ? field.getHeight() : params.height;
-        uint32_t depth = field.getDepth() ? field.getDepth() : 1;
-        uint32_t sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
-        ResourceFormat format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
-
         Texture::SharedPtr pTexture;
         if (depth > 1)
         {
             assert(sampleCount == 1);
-            pTexture = Texture::create3D(width, height, depth, format, 1, nullptr, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+            pTexture = Texture::create3D(width, height, depth, format, 1, nullptr, bindFlags);
         }
         else if (height > 1 || sampleCount > 1)
         {
             if (sampleCount > 1)
             {
-                pTexture = Texture::create2DMS(width, height, format, sampleCount, 1, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+                pTexture = Texture::create2DMS(width, height, format, sampleCount, 1, bindFlags);
             }
             else
             {
-                pTexture = Texture::create2D(width, height, format, 1, 1, nullptr, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+                pTexture = Texture::create2D(width, height, format, 1, 1, nullptr, bindFlags);
             }
         }
         else
         {
-            pTexture = Texture::create1D(width, format, 1, 1, nullptr, field.getBindFlags() | Resource::BindFlags::ShaderResource);
+            pTexture = Texture::create1D(width, format, 1, 1, nullptr, bindFlags);
         }
 
         return pTexture;
@@ -245,13 +252,128 @@ namespace Falcor
 
     void ResourceCache::allocateResources(const DefaultProperties& params)
     {
-        for (auto& data : mResourceData)
+        // Resolve the properties of every field and group them into compatibility buckets
+        std::vector<TextureDesc> bucketDescs;
+        std::vector<ResourceAliasing::Interval> intervals;
+        std::vector<uint32_t> intervalToData;
+
+        // Internal fields are allocated by name after the placement
+        std::vector<std::pair<uint32_t, TextureDesc>> internalFields;
+        std::vector<const std::string*> dataNames(mResourceData.size(), nullptr);
+        for (const auto& it : mNameToIndex)
+        {
+            const std::string*& pName = dataNames[it.second];
+            if (pName == nullptr || it.first < *pName) pName = &it.first;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)mResourceData.size(); i++)
         {
-            if ((data.pResource == nullptr || data.dirty) && data.field.isValid())
+            auto& data = mResourceData[i];
+            data.pResource = nullptr;
+            data.dirty = false;
+            if (data.field.isValid() == false) continue;
+
+            const auto& field = data.field;
+            TextureDesc desc;
+            desc.width = field.getWidth() ? field.getWidth() : params.width;
+            desc.height = field.getHeight() ? field.getHeight() : params.height;
+            desc.depth = field.getDepth() ? field.getDepth() : 1;
+            desc.sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
+            desc.format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+            desc.bindFlags = field.getBindFlags() | Resource::BindFlags::ShaderResource;
+
+            // Internal resources may carry data between frames (history buffers, etc.), so they are never shared
+            if (is_set(field.getType(), RenderPassReflection::Field::Type::Internal))
             {
-                data.pResource = createTextureForPass(params, data.field);
-                data.dirty = false;
+                internalFields.push_back({ i, desc });
+                continue;
             }
+
+            auto it = std::find(bucketDescs.begin(), bucketDescs.end(), desc);
+            uint32_t bucket = (uint32_t)(it - bucketDescs.begin());
+            if (it == bucketDescs.end()) bucketDescs.push_back(desc);
+
+            ResourceAliasing::Interval interval;
+            interval.bucket = bucket;
+            interval.firstUsed = data.firstUsed;
+            interval.lastUsed = data.lastUsed;
+            interval.exclusive = (mAliasingEnabled == false);
+            intervals.push_back(interval);
+            intervalToData.push_back(i);
         }
+
+        ResourceAliasing::Placement placement = ResourceAliasing::place(intervals, (uint32_t)bucketDescs.size());
+        assert(ResourceAliasing::validate(intervals, placement));
+
+        mStats = AllocationStats();
+
+        // Internal fields keep their previous texture if it is still compatible. Otherwise they take one from the old pool or create a new one
+        std::unordered_map<std::string, PinnedTexture> pinnedTextures;
+        for (const auto& internalField : internalFields)
+        {
+            const std::string& name = *dataNames[internalField.first];
+            const TextureDesc& d = internalField.second;
+            Texture::SharedPtr pTexture;
+
+            auto pinnedIt = mPinnedTextures.find(name);
+            if (pinnedIt != mPinnedTextures.end() && pinnedIt->second.desc == d)
+            {
+                pTexture = pinnedIt->second.pTexture;
+            }
+            else
+            {
+                for (auto& oldBucket : mPool)
+                {
+                    if ((oldBucket.desc == d) == false || oldBucket.textures.empty()) continue;
+                    pTexture = oldBucket.textures.back();
+                    oldBucket.textures.pop_back();
+                    break;
+                }
+            }
+
+            if (pTexture) mStats.reusedTextureCount++;
+            else pTexture = createTexture(d.width, d.height, d.depth, d.sampleCount, d.format, d.bindFlags);
+
+            mResourceData[internalField.first].pResource = pTexture;
+            pinnedTextures[name] = { d, pTexture };
+            mStats.textureCount++;
+        }
+
+        // Build the new pool, taking textures from the old pool where the properties match
+        std::vector<PoolBucket> newPool(bucketDescs.size());
+        for (uint32_t b = 0; b < (uint32_t)bucketDescs.size(); b++)
+        {
+            PoolBucket& bucket = newPool[b];
+            bucket.desc = bucketDescs[b];
+            uint32_t slotCount = placement.slotCount[b];
+
+            for (auto& oldBucket : mPool)
+            {
+                if ((oldBucket.desc == bucket.desc) == false) continue;
+                while (bucket.textures.size() < slotCount && oldBucket.textures.empty() == false)
+                {
+                    bucket.textures.push_back(oldBucket.textures.back());
+                    oldBucket.textures.pop_back();
+                    mStats.reusedTextureCount++;
+                }
+            }
+
+            const TextureDesc& d = bucket.desc;
+            while (bucket.textures.size() < slotCount)
+            {
+                bucket.textures.push_back(createTexture(d.width, d.height, d.depth, d.sampleCount, d.format, d.bindFlags));
+            }
+            mStats.textureCount += slotCount;
+        }
+
+        for (size_t i = 0; i < intervals.size(); i++)
+        {
+            mResourceData[intervalToData[i]].pResource = newPool[intervals[i].bucket].textures[placement.slot[i]];
+        }
+        mStats.fieldCount = (uint32_t)(intervals.size() + internalFields.size());
+
+        // Textures left in the old pool, and those of internal fields which were removed, are no longer needed and are released here
+        mPool = std::move(newPool);
+        mPinnedTextures = std::move(pinnedTextures);
     }
 }
@@ -28,6 +28,7 @@
 #pragma once
 #include "Graphics/RenderGraph/RenderPassReflection.h"
 #include "API/Texture.h"
+#include "ResourceAliasing.h"
 
 namespace Falcor
 {
@@ -66,15 +67,36 @@ namespace Falcor
         */
         const std::shared_ptr<Resource>& getResource(const std::string& name) const;
 
-        /** Allocate all resources that need to be created/updated. 
-            This includes new resources, resources whose properties have been updated since last allocation call.
+        /** Allocate resources for all registered fields.
+            Fields with compatible properties and non-overlapping lifetimes share the same texture. Textures allocated by previous calls are reused when the properties match.
+            Internal fields keep the texture they had in the previous allocation as long as their properties don't change, so history stored in them survives recompilation.
         */
         void allocateResources(const DefaultProperties& params);
 
-        /** Clears all registered field/resource properties and allocated resources.
+        /** Clears all registered field/resource properties. The texture pool is kept, so the next allocation can reuse it.
         */
         void reset();
 
+        /** Release all textures in the pool, including the ones held by internal fields. They will be re-created on the next allocation.
+        */
+        void releasePool();
+
+        /** Enable/disable sharing textures between fields with non-overlapping lifetimes.
+        */
+        void setAliasingEnabled(bool enabled) { mAliasingEnabled = enabled; }
+        bool isAliasingEnabled() const { return mAliasingEnabled; }
+
+        struct AllocationStats
+        {
+            uint32_t fieldCount = 0;        ///< Number of fields which required a resource
+            uint32_t textureCount = 0;      ///< Number of textures used by the fields
+            uint32_t reusedTextureCount = 0;///< Number of textures reused from the previous allocation
+        };
+
+        /** Get the statistics of the last allocateResources() call
+        */
+        const AllocationStats& getAllocationStats() const { return mStats; }
+
     private:
         ResourceCache() = default;
 
@@ -96,6 +118,38 @@ namespace Falcor
 
         // References to output resources not to be allocated by the render graph
         std::unordered_map<std::string, std::shared_ptr<Resource>> mExternalInputs;
+
+        // Fully resolved texture properties. Fields can only share a texture if their descs are equal
+        struct TextureDesc
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t depth = 0;
+            uint32_t sampleCount = 0;
+            ResourceFormat format = ResourceFormat::Unknown;
+            Resource::BindFlags bindFlags = Resource::BindFlags::None;
+
+            bool operator==(const TextureDesc& other) const;
+        };
+
+        // Physical textures, persistent between compilations
+        struct PoolBucket
+        {
+            TextureDesc desc;
+            std::vector<Texture::SharedPtr> textures;
+        };
+        std::vector<PoolBucket> mPool;
+
+        // Textures of internal fields, by field name. They are kept out of the pool so a recompile can't hand them to another field
+        struct PinnedTexture
+        {
+            TextureDesc desc;
+            Texture::SharedPtr pTexture;
+        };
+        std::unordered_map<std::string, PinnedTexture> mPinnedTextures;
+
+        bool mAliasingEnabled = true;
+        AllocationStats mStats;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "InstanceCuller.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/ParallelFor.h"
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    void InstanceCuller::clear()
+    {
+        mBatches.clear();
+        mBoxCount = 0;
+    }
+
+    uint32_t InstanceCuller::addBox(const BoundingBox& box, const glm::mat4& transform)
+    {
+        const uint32_t index = mBoxCount++;
+        const uint32_t lane = index % 4;
+        if (lane == 0)
+        {
+            mBatches.push_back({});
+        }
+
+        Batch& batch = mBatches.back();
+        batch.streams[CenterX][lane] = box.center.x;
+        batch.streams[CenterY][lane] = box.center.y;
+        batch.streams[CenterZ][lane] = box.center.z;
+        batch.streams[ExtentX][lane] = box.extent.x;
+        batch.streams[ExtentY][lane] = box.extent.y;
+        batch.streams[ExtentZ][lane] = box.extent.z;
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            for (uint32_t col = 0; col < 4; col++)
+            {
+                batch.streams[M00 + row * 4 + col][lane] = transform[col][row];
+            }
+        }
+        return index;
+    }
+
+    void InstanceCuller::cullJob(uint32_t job, const glm::vec4 planes[6], std::vector<uint32_t>& visible) const
+    {
+        const uint32_t first = job * kJobSize;
+        const uint32_t last = std::min(first + kJobSize, mBoxCount);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+        visible.clear();
+        for (uint32_t i = first; i < last; i += 4)
+        {
+            const Batch& batch = mBatches[i / 4];
+            auto load = [&batch](uint32_t stream) { return _mm_loadu_ps(batch.streams[stream]); };
+            const __m128 cx = load(CenterX), cy = load(CenterY), cz = load(CenterZ);
+            const __m128 ex = load(ExtentX), ey = load(ExtentY), ez = load(ExtentZ);
+
+            // World-space center and extent. The extent is transformed by the absolute value of the matrix, like BoundingBox::transform() does.
+            __m128 center[3];
+            __m128 extent[3];
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                const __m128 m0 = load(M00 + row * 4);
+                const __m128 m1 = load(M01 + row * 4);
+                const __m128 m2 = load(M02 + row * 4);
+                const __m128 m3 = load(M03 + row * 4);
+                center[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, cx), _mm_mul_ps(m1, cy)), _mm_add_ps(_mm_mul_ps(m2, cz), m3));
+                extent[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(m0, absMask), ex), _mm_mul_ps(_mm_and_ps(m1, absMask), ey)), _mm_mul_ps(_mm_and_ps(m2, absMask), ez));
+            }
+
+            // A box is outside a plane when its corner furthest along the plane normal is. That corner's distance is dot(center, n) + dot(extent, abs(n)).
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                const glm::vec4& plane = planes[p];
+                __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(center[0], _mm_set1_ps(plane.x)), _mm_mul_ps(center[1], _mm_set1_ps(plane.y))), _mm_mul_ps(center[2], _mm_set1_ps(plane.z)));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extent[0], _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(extent[1], _mm_set1_ps(std::abs(plane.y)))), _mm_mul_ps(extent[2], _mm_set1_ps(std::abs(plane.z))));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(dist, radius), _mm_set1_ps(-plane.w)));
+            }
+
+            uint32_t mask = (uint32_t)_mm_movemask_ps(inside);
+            if (last - i < 4)
+            {
+                // Padding lanes
+                mask &= (1u << (last - i)) - 1;
+            }
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1u << lane)) visible.push_back(i + lane);
+            }
+        }
+    }
+
+    void InstanceCuller::cull(const Camera* pCamera, std::vector<uint32_t>& visible, uint32_t maxThreads)
+    {
+        glm::vec4 planes[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            planes[p] = pCamera->getFrustumPlane(p);
+        }
+
+        const uint32_t jobCount = (mBoxCount + kJobSize - 1) / kJobSize;
+        if (mJobResults.size() < jobCount)
+        {
+            mJobResults.resize(jobCount);
+        }
+        parallelFor(jobCount, [&](uint32_t job) { cullJob(job, planes, mJobResults[job]); }, (mBoxCount < kMinParallelBoxes) ? 1 : maxThreads);
+
+        // The jobs cover consecutive ranges, so concatenating their results keeps the indices sorted
+        visible.clear();
+        for (uint32_t job = 0; job < jobCount; job++)
+        {
+            visible.insert(visible.end(), mJobResults[job].begin(), mJobResults[job].end());
+        }
+    }
+}
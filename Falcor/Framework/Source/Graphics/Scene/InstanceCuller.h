@@ -0,0 +1,98 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** Frustum culls a set of bounding boxes in bulk.
+        The boxes and their transforms are stored in batches of 4, as structure-of-arrays within a batch, so that cull() transforms and tests 4 boxes at a time with SSE.
+        Sets of at least kMinParallelBoxes boxes are split into jobs of kJobSize boxes, which run on worker threads.
+    */
+    class InstanceCuller
+    {
+    public:
+        /** Number of boxes culled by a single job
+        */
+        static const uint32_t kJobSize = 1024;
+
+        /** Smaller sets are culled on the calling thread. Culling a job takes a few microseconds, less than starting and joining a thread.
+        */
+        static const uint32_t kMinParallelBoxes = 16 * kJobSize;
+
+        /** Remove all boxes. Keeps the memory for the next frame.
+        */
+        void clear();
+
+        /** Add a box
+            \param[in] box Bounding box in the space of the transform
+            \param[in] transform Transform to world space. It must be affine.
+            \return The index of the box
+        */
+        uint32_t addBox(const BoundingBox& box, const glm::mat4& transform);
+
+        /** Get the number of boxes
+        */
+        uint32_t getBoxCount() const { return mBoxCount; }
+
+        /** Find the boxes which intersect the camera's frustum. The test matches Camera::isObjectCulled() on the box transformed with BoundingBox::transform(), up to rounding.
+            \param[in] pCamera The camera
+            \param[out] visible The indices of the visible boxes, in increasing order
+            \param[in] maxThreads Maximum number of threads to use, including the calling thread. 0 uses one thread per hardware thread.
+        */
+        void cull(const Camera* pCamera, std::vector<uint32_t>& visible, uint32_t maxThreads = 0);
+
+    private:
+        enum Stream
+        {
+            CenterX, CenterY, CenterZ,
+            ExtentX, ExtentY, ExtentZ,
+            // The first 3 rows of the transform, row-major
+            M00, M01, M02, M03,
+            M10, M11, M12, M13,
+            M20, M21, M22, M23,
+            StreamCount
+        };
+
+        void cullJob(uint32_t job, const glm::vec4 planes[6], std::vector<uint32_t>& visible) const;
+
+        /** 4 boxes. Unused lanes are zero.
+        */
+        struct Batch
+        {
+            float streams[StreamCount][4];
+        };
+
+        std::vector<Batch> mBatches;
+        uint32_t mBoxCount = 0;
+        std::vector<std::vector<uint32_t>> mJobResults;
+    };
+}
@@ -44,7 +44,7 @@ namespace Falcor
         Scene::SharedPtr pScene = create();
         if (SceneImporter::loadScene(*pScene, filename, modelLoadFlags, sceneLoadFlags) == false)
         {
-            pScene = nullptr;
+            return nullptr;
         }
         pScene->mFilename = filename;
         return pScene;
@@ -0,0 +1,368 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBvh.h"
+#include "Graphics/Camera/Camera.h"
+#include "Data/VertexAttrib.h"
+#include "Utils/ParallelFor.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        glm::vec3 readPosition(const uint8_t* pVertex, ResourceFormat format, const Mesh::VertexQuantization& quantization)
+        {
+            if (format == ResourceFormat::RGBA16Snorm)
+            {
+                const int16_t* pQ = (const int16_t*)pVertex;
+                const glm::vec3 q = glm::max(glm::vec3(pQ[0], pQ[1], pQ[2]) / 32767.0f, glm::vec3(-1.0f));
+                return q * quantization.positionScale + quantization.positionOffset;
+            }
+
+            const float* pP = (const float*)pVertex;
+            return glm::vec3(pP[0], pP[1], pP[2]);
+        }
+    }
+
+    SceneBvh::SharedPtr SceneBvh::create(const Scene::SharedPtr& pScene, uint32_t maxThreads)
+    {
+        SharedPtr pBvh = SharedPtr(new SceneBvh(pScene, maxThreads));
+        pBvh->rebuild();
+        return pBvh;
+    }
+
+    const std::vector<TriangleBvh::Triangle>& SceneBvh::getMeshTriangles(const Mesh* pMesh)
+    {
+        auto it = mMeshTriangles.find(pMesh);
+        if (it != mMeshTriangles.end()) return it->second;
+
+        std::vector<TriangleBvh::Triangle>& triangles = mMeshTriangles[pMesh];
+        std::vector<glm::uvec3>& triangleIndices = mMeshIndices[pMesh];
+        const Vao* pVao = pMesh->getVao().get();
+        if (pVao->getPrimitiveTopology() != Vao::Topology::TriangleList)
+        {
+            logWarning("SceneBvh: Only triangle lists are supported. A mesh with a different topology is ignored.");
+            return triangles;
+        }
+
+        const auto& elemDesc = pVao->getElementIndexByLocation(VERTEX_POSITION_LOC);
+        if (elemDesc.vbIndex == Vao::ElementDesc::kInvalidIndex) return triangles;
+        const auto& pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex);
+        const ResourceFormat format = pVbLayout->getElementFormat(elemDesc.elementIndex);
+        if (format != ResourceFormat::RGB32Float && format != ResourceFormat::RGBA32Float && format != ResourceFormat::RGBA16Snorm)
+        {
+            logWarning("SceneBvh: Unsupported position format " + to_string(format) + ". The mesh is ignored.");
+            return triangles;
+        }
+
+        // Read back the positions
+        Buffer* pVB = pVao->getVertexBuffer(elemDesc.vbIndex).get();
+        const uint32_t stride = pVbLayout->getStride();
+        const uint8_t* pVertices = (const uint8_t*)pVB->map(Buffer::MapType::Read) + pVbLayout->getElementOffset(elemDesc.elementIndex);
+        std::vector<glm::vec3> positions(pMesh->getVertexCount());
+        for (uint32_t i = 0; i < pMesh->getVertexCount(); i++)
+        {
+            positions[i] = readPosition(pVertices + i * stride, format, pMesh->getVertexQuantization());
+        }
+        pVB->unmap();
+
+        std::vector<uint32_t> indices(pMesh->getIndexCount());
+        Buffer* pIB = pVao->getIndexBuffer().get();
+        if (pIB)
+        {
+            const void* pData = pIB->map(Buffer::MapType::Read);
+            for (uint32_t i = 0; i < (uint32_t)indices.size(); i++)
+            {
+                indices[i] = (pVao->getIndexBufferFormat() == ResourceFormat::R16Uint) ? ((const uint16_t*)pData)[i] : ((const uint32_t*)pData)[i];
+            }
+            pIB->unmap();
+        }
+        else
+        {
+            indices.resize(pMesh->getVertexCount());
+            for (uint32_t i = 0; i < (uint32_t)indices.size(); i++) indices[i] = i;
+        }
+
+        triangles.reserve(indices.size() / 3);
+        triangleIndices.reserve(indices.size() / 3);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            if (std::max(indices[i], std::max(indices[i + 1], indices[i + 2])) >= positions.size()) continue;
+            triangles.push_back({ positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]] });
+            triangleIndices.push_back(glm::uvec3(indices[i], indices[i + 1], indices[i + 2]));
+        }
+        return triangles;
+    }
+
+    void SceneBvh::transformInstance(uint32_t instance, const glm::mat4& transform)
+    {
+        const std::vector<TriangleBvh::Triangle>& source = *mTrackedInstances[instance].pMeshTriangles;
+        TriangleBvh::Triangle* pDst = mTriangles.data() + mInstances[instance].firstTriangle;
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            pDst[i].v0 = glm::vec3(transform * glm::vec4(source[i].v0, 1.0f));
+            pDst[i].v1 = glm::vec3(transform * glm::vec4(source[i].v1, 1.0f));
+            pDst[i].v2 = glm::vec3(transform * glm::vec4(source[i].v2, 1.0f));
+        }
+    }
+
+    void SceneBvh::rebuild()
+    {
+        mInstances.clear();
+        mTrackedInstances.clear();
+        uint32_t triangleCount = 0;
+        for (uint32_t modelId = 0; modelId < mpScene->getModelCount(); modelId++)
+        {
+            const Model* pModel = mpScene->getModel(modelId).get();
+            for (uint32_t modelInstanceId = 0; modelInstanceId < mpScene->getModelInstanceCount(modelId); modelInstanceId++)
+            {
+                const Scene::ModelInstance* pModelInstance = mpScene->getModelInstance(modelId, modelInstanceId).get();
+                for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+                {
+                    for (uint32_t meshInstanceId = 0; meshInstanceId < pModel->getMeshInstanceCount(meshId); meshInstanceId++)
+                    {
+                        const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshId, meshInstanceId).get();
+                        const Mesh* pMesh = pMeshInstance->getObject().get();
+                        const std::vector<TriangleBvh::Triangle>& meshTriangles = getMeshTriangles(pMesh);
+                        mInstances.push_back({ modelId, modelInstanceId, meshId, meshInstanceId, triangleCount, (uint32_t)meshTriangles.size() });
+                        mTrackedInstances.push_back({ pModelInstance, pMeshInstance, pModelInstance->getTransformVersion(), pMeshInstance->getTransformVersion(), &meshTriangles, &mMeshIndices[pMesh] });
+                        triangleCount += (uint32_t)meshTriangles.size();
+                    }
+                }
+            }
+        }
+
+        // Resolve the transforms on this thread, since ObjectInstance updates its matrices lazily
+        std::vector<glm::mat4> transforms(mInstances.size());
+        for (size_t i = 0; i < mInstances.size(); i++)
+        {
+            transforms[i] = mTrackedInstances[i].pModelInstance->getTransformMatrix() * mTrackedInstances[i].pMeshInstance->getTransformMatrix();
+        }
+
+        mTriangles.resize(triangleCount);
+        parallelFor((uint32_t)mInstances.size(), [&](uint32_t i) { transformInstance(i, transforms[i]); }, mMaxThreads);
+        mBvh.build(mTriangles, mMaxThreads);
+    }
+
+    bool SceneBvh::isLayoutValid() const
+    {
+        uint32_t instance = 0;
+        for (uint32_t modelId = 0; modelId < mpScene->getModelCount(); modelId++)
+        {
+            const Model* pModel = mpScene->getModel(modelId).get();
+            for (uint32_t modelInstanceId = 0; modelInstanceId < mpScene->getModelInstanceCount(modelId); modelInstanceId++)
+            {
+                const Scene::ModelInstance* pModelInstance = mpScene->getModelInstance(modelId, modelInstanceId).get();
+                for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+                {
+                    for (uint32_t meshInstanceId = 0; meshInstanceId < pModel->getMeshInstanceCount(meshId); meshInstanceId++, instance++)
+                    {
+                        if (instance >= mTrackedInstances.size()) return false;
+                        const TrackedInstance& tracked = mTrackedInstances[instance];
+                        if (tracked.pModelInstance != pModelInstance || tracked.pMeshInstance != pModel->getMeshInstance(meshId, meshInstanceId).get()) return false;
+                    }
+                }
+            }
+        }
+        return instance == mTrackedInstances.size();
+    }
+
+    void SceneBvh::update()
+    {
+        if (isLayoutValid() == false)
+        {
+            rebuild();
+            return;
+        }
+
+        std::vector<uint32_t> moved;
+        std::vector<glm::mat4> transforms;
+        for (uint32_t i = 0; i < (uint32_t)mTrackedInstances.size(); i++)
+        {
+            TrackedInstance& tracked = mTrackedInstances[i];
+            const uint32_t modelVersion = tracked.pModelInstance->getTransformVersion();
+            const uint32_t meshVersion = tracked.pMeshInstance->getTransformVersion();
+            if (modelVersion != tracked.modelVersion || meshVersion != tracked.meshVersion)
+            {
+                tracked.modelVersion = modelVersion;
+                tracked.meshVersion = meshVersion;
+                moved.push_back(i);
+                transforms.push_back(tracked.pModelInstance->getTransformMatrix() * tracked.pMeshInstance->getTransformMatrix());
+            }
+        }
+        if (moved.empty()) return;
+
+        parallelFor((uint32_t)moved.size(), [&](uint32_t i) { transformInstance(moved[i], transforms[i]); }, mMaxThreads);
+        mBvh.refit(mTriangles);
+    }
+
+    uint32_t SceneBvh::findInstance(uint32_t triangle) const
+    {
+        // The last instance which starts at or before the triangle. Instances without triangles start at the same triangle as the next one.
+        auto it = std::upper_bound(mInstances.begin(), mInstances.end(), triangle, [](uint32_t t, const Instance& instance) { return t < instance.firstTriangle; });
+        assert(it != mInstances.begin());
+        return uint32_t(it - mInstances.begin()) - 1;
+    }
+
+    void SceneBvh::fillHit(uint32_t triangle, Hit& hit) const
+    {
+        hit.instance = findInstance(triangle);
+        hit.primitiveId = triangle - mInstances[hit.instance].firstTriangle;
+    }
+
+    void SceneBvh::fillRayHit(const TriangleBvh::RayHit& rayHit, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const
+    {
+        fillHit(rayHit.triangle, hit);
+        hit.distance = rayHit.t;
+        hit.position = origin + direction * rayHit.t;
+        hit.barycentrics = glm::vec2(rayHit.u, rayHit.v);
+    }
+
+    TriangleBvh::HitFilter SceneBvh::getBvhFilter(const HitFilter& filter, const glm::vec3& origin, const glm::vec3& direction) const
+    {
+        if (filter == nullptr) return nullptr;
+        return [this, &filter, origin, direction](const TriangleBvh::RayHit& rayHit)
+        {
+            Hit hit;
+            fillRayHit(rayHit, origin, direction, hit);
+            return filter(hit);
+        };
+    }
+
+    bool SceneBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit, const HitFilter& filter) const
+    {
+        const float length = glm::length(direction);
+        if (length == 0) return false;
+
+        const glm::vec3 unitDirection = direction / length;
+        TriangleBvh::RayHit rayHit;
+        if (mBvh.raycast(origin, unitDirection, maxDistance, rayHit, getBvhFilter(filter, origin, unitDirection)) == false) return false;
+        fillRayHit(rayHit, origin, unitDirection, hit);
+        return true;
+    }
+
+    uint32_t SceneBvh::raycastPacket(const glm::vec3* origins, const glm::vec3* directions, uint32_t count, float maxDistance, Hit* hits, const HitFilter& filter) const
+    {
+        assert(count <= TriangleBvh::kPacketSize);
+        glm::vec3 packetOrigins[TriangleBvh::kPacketSize];
+        glm::vec3 unitDirections[TriangleBvh::kPacketSize];
+        uint32_t rayMask = 0;
+        for (uint32_t r = 0; r < TriangleBvh::kPacketSize; r++)
+        {
+            const float length = (r < count) ? glm::length(directions[r]) : 0.0f;
+            packetOrigins[r] = (r < count) ? origins[r] : glm::vec3(0.0f);
+            unitDirections[r] = (length > 0) ? directions[r] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            if (length > 0) rayMask |= 1u << r;
+        }
+
+        // The filter needs to know which ray a hit belongs to, for its position
+        TriangleBvh::HitFilter bvhFilter;
+        if (filter)
+        {
+            bvhFilter = [&](const TriangleBvh::RayHit& rayHit)
+            {
+                const TriangleBvh::Triangle& tri = mTriangles[rayHit.triangle];
+                Hit hit;
+                fillHit(rayHit.triangle, hit);
+                hit.distance = rayHit.t;
+                hit.position = tri.v0 + (tri.v1 - tri.v0) * rayHit.u + (tri.v2 - tri.v0) * rayHit.v;
+                hit.barycentrics = glm::vec2(rayHit.u, rayHit.v);
+                return filter(hit);
+            };
+        }
+
+        TriangleBvh::RayHit rayHits[TriangleBvh::kPacketSize];
+        const uint32_t hitMask = mBvh.raycastPacket(packetOrigins, unitDirections, rayMask, maxDistance, rayHits, bvhFilter);
+        for (uint32_t r = 0; r < count; r++)
+        {
+            if (hitMask & (1u << r)) fillRayHit(rayHits[r], packetOrigins[r], unitDirections[r], hits[r]);
+        }
+        return hitMask;
+    }
+
+    bool SceneBvh::pick(const Camera* pCamera, const glm::vec2& mousePos, Hit& hit) const
+    {
+        // Unproject the mouse position at the near and far planes
+        const glm::vec2 ndc(mousePos.x * 2.0f - 1.0f, 1.0f - mousePos.y * 2.0f);
+        const glm::mat4& invViewProj = pCamera->getInvViewProjMatrix();
+        glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+        glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+        const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        const glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+        return raycast(origin, direction, glm::length(direction), hit);
+    }
+
+    bool SceneBvh::isOccluded(const glm::vec3& from, const glm::vec3& to, const HitFilter& filter) const
+    {
+        if (filter == nullptr) return mBvh.raycastAny(from, to - from, 1.0f);
+
+        const float length = glm::length(to - from);
+        if (length == 0) return false;
+        const glm::vec3 unitDirection = (to - from) / length;
+        return mBvh.raycastAny(from, unitDirection, length, getBvhFilter(filter, from, unitDirection));
+    }
+
+    bool SceneBvh::closestPoint(const glm::vec3& point, float maxDistance, Hit& hit) const
+    {
+        TriangleBvh::PointHit pointHit;
+        if (mBvh.closestPoint(point, maxDistance, pointHit) == false) return false;
+        fillHit(pointHit.triangle, hit);
+        hit.distance = pointHit.distance;
+        hit.position = pointHit.point;
+        return true;
+    }
+
+    void SceneBvh::overlapFrustum(const Camera* pCamera, std::vector<uint32_t>& instances) const
+    {
+        glm::vec4 planes[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            planes[p] = pCamera->getFrustumPlane(p);
+        }
+
+        std::vector<uint32_t> triangles;
+        mBvh.overlapFrustum(planes, triangles);
+        instances.clear();
+        for (uint32_t triangle : triangles) instances.push_back(findInstance(triangle));
+        std::sort(instances.begin(), instances.end());
+        instances.erase(std::unique(instances.begin(), instances.end()), instances.end());
+    }
+
+    const Scene::ModelInstance::SharedPtr& SceneBvh::getModelInstance(const Hit& hit) const
+    {
+        const Instance& instance = mInstances[hit.instance];
+        return mpScene->getModelInstance(instance.modelId, instance.modelInstanceId);
+    }
+
+    const Model::MeshInstance::SharedPtr& SceneBvh::getMeshInstance(const Hit& hit) const
+    {
+        const Instance& instance = mInstances[hit.instance];
+        return mpScene->getModel(instance.modelId)->getMeshInstance(instance.meshId, instance.meshInstanceId);
+    }
+}
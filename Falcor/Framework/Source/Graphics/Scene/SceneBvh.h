@@ -0,0 +1,185 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include "Graphics/Scene/Scene.h"
+#include "Utils/Math/TriangleBvh.h"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** A BVH over the world-space triangles of all the mesh instances of a scene, for queries on the CPU, such as picking and camera collisions.
+        The positions are read back from the meshes' vertex buffers once per mesh. Skinned meshes use their bind pose.
+        update() follows the instance transforms. It re-transforms the triangles of the instances which moved and refits the tree, and rebuilds the tree when
+        instances were added or removed.
+    */
+    class SceneBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBvh>;
+
+        /** A mesh instance of the scene
+        */
+        struct Instance
+        {
+            uint32_t modelId;
+            uint32_t modelInstanceId;
+            uint32_t meshId;
+            uint32_t meshInstanceId;
+            uint32_t firstTriangle;     ///< First triangle of the instance in the BVH
+            uint32_t triangleCount;
+        };
+
+        struct Hit
+        {
+            uint32_t instance;          ///< Index of the mesh instance, see getInstance()
+            uint32_t primitiveId;       ///< Index of the triangle in the mesh
+            glm::vec3 position;         ///< World-space position
+            float distance;             ///< World-space distance from the ray origin or the query point
+            glm::vec2 barycentrics;     ///< Barycentrics of the triangle's second and third vertices. Only set by ray queries.
+        };
+
+        /** Called for each triangle a ray hits, before the hit is accepted. Return false to ignore the hit, e.g. where an alpha test fails.
+        */
+        using HitFilter = std::function<bool(const Hit& hit)>;
+
+        /** Create a BVH over a scene
+            \param[in] pScene The scene
+            \param[in] maxThreads Maximum number of threads used to build the tree, including the calling thread. 0 uses one thread per hardware thread.
+        */
+        static SharedPtr create(const Scene::SharedPtr& pScene, uint32_t maxThreads = 0);
+
+        /** Follow the changes of the scene since the last update. Call after Scene::update().
+        */
+        void update();
+
+        /** Rebuild the tree. Refitting keeps the topology of the tree, which gets less efficient as instances move far from where they were at the last build.
+        */
+        void rebuild();
+
+        /** Find the closest triangle a ray hits
+            \param[in] origin Ray origin
+            \param[in] direction Ray direction. It doesn't need to be normalized.
+            \param[in] maxDistance Hits further than this are ignored
+            \param[out] hit The closest hit
+            \param[in] filter Optional. Called for each hit before it is accepted.
+            \return Whether a triangle was hit
+        */
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit, const HitFilter& filter = nullptr) const;
+
+        /** Find the closest triangles up to TriangleBvh::kPacketSize rays hit, sharing the traversal. Faster than raycast() for coherent rays, e.g. the primary rays of neighboring pixels.
+            \param[in] origins Ray origins
+            \param[in] directions Ray directions. They don't need to be normalized.
+            \param[in] count Number of rays
+            \param[in] maxDistance Hits further than this are ignored
+            \param[out] hits The closest hits. Only written for the rays which hit.
+            \param[in] filter Optional. Called for each hit before it is accepted.
+            \return The mask of the rays which hit. Bit i is set if ray i hit.
+        */
+        uint32_t raycastPacket(const glm::vec3* origins, const glm::vec3* directions, uint32_t count, float maxDistance, Hit* hits, const HitFilter& filter = nullptr) const;
+
+        /** Find the closest triangle under the mouse
+            \param[in] pCamera The camera
+            \param[in] mousePos Mouse position in the range [0,1] with (0,0) being the top left corner. Same coordinate space as in MouseEvent.
+            \param[out] hit The closest hit
+            \return Whether a triangle was hit
+        */
+        bool pick(const Camera* pCamera, const glm::vec2& mousePos, Hit& hit) const;
+
+        /** Check whether the segment between two points is blocked by a triangle
+            \param[in] filter Optional. Called for each hit before it is accepted.
+        */
+        bool isOccluded(const glm::vec3& from, const glm::vec3& to, const HitFilter& filter = nullptr) const;
+
+        /** Find the closest point on the scene's triangles, e.g. to keep a camera from going through walls
+            \param[in] point The query point
+            \param[in] maxDistance Points further than this are ignored
+            \param[out] hit The closest point
+            \return Whether a point was found within maxDistance
+        */
+        bool closestPoint(const glm::vec3& point, float maxDistance, Hit& hit) const;
+
+        /** Find the mesh instances which have triangles overlapping a camera's frustum
+            \param[in] pCamera The camera
+            \param[out] instances Indices of the mesh instances, in increasing order
+        */
+        void overlapFrustum(const Camera* pCamera, std::vector<uint32_t>& instances) const;
+
+        uint32_t getInstanceCount() const { return (uint32_t)mInstances.size(); }
+        const Instance& getInstance(uint32_t index) const { return mInstances[index]; }
+
+        /** Get the model instance and the mesh instance of a hit
+        */
+        const Scene::ModelInstance::SharedPtr& getModelInstance(const Hit& hit) const;
+        const Model::MeshInstance::SharedPtr& getMeshInstance(const Hit& hit) const;
+
+        /** Get the world-space triangle of a hit
+        */
+        const TriangleBvh::Triangle& getTriangle(const Hit& hit) const { return mTriangles[mInstances[hit.instance].firstTriangle + hit.primitiveId]; }
+
+        /** Get the indices of the vertices of a hit's triangle in its mesh, e.g. to interpolate vertex attributes with the barycentrics
+        */
+        const glm::uvec3& getTriangleIndices(const Hit& hit) const { return (*mTrackedInstances[hit.instance].pMeshIndices)[hit.primitiveId]; }
+
+        const TriangleBvh& getBvh() const { return mBvh; }
+
+    private:
+        SceneBvh(const Scene::SharedPtr& pScene, uint32_t maxThreads) : mpScene(pScene), mMaxThreads(maxThreads) {}
+
+        /** The objects an instance was created from, with the transform versions it had
+        */
+        struct TrackedInstance
+        {
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+            uint32_t modelVersion;
+            uint32_t meshVersion;
+            const std::vector<TriangleBvh::Triangle>* pMeshTriangles;
+            const std::vector<glm::uvec3>* pMeshIndices;
+        };
+
+        bool isLayoutValid() const;
+        const std::vector<TriangleBvh::Triangle>& getMeshTriangles(const Mesh* pMesh);
+        void transformInstance(uint32_t instance, const glm::mat4& transform);
+        uint32_t findInstance(uint32_t triangle) const;
+        void fillHit(uint32_t triangle, Hit& hit) const;
+        void fillRayHit(const TriangleBvh::RayHit& rayHit, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+        TriangleBvh::HitFilter getBvhFilter(const HitFilter& filter, const glm::vec3& origin, const glm::vec3& direction) const;
+
+        Scene::SharedPtr mpScene;
+        uint32_t mMaxThreads;
+        TriangleBvh mBvh;
+        std::vector<TriangleBvh::Triangle> mTriangles;      ///< World space, in instance order
+        std::vector<Instance> mInstances;
+        std::vector<TrackedInstance> mTrackedInstances;
+        std::unordered_map<const Mesh*, std::vector<TriangleBvh::Triangle>> mMeshTriangles;    ///< Mesh space, read back from the vertex buffers
+        std::unordered_map<const Mesh*, std::vector<glm::uvec3>> mMeshIndices;                 ///< The vertex indices of each triangle of mMeshTriangles
+    };
+}
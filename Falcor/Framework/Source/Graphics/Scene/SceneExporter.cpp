@@ -32,7 +32,9 @@
 #include "SceneExporter.h"
 #include <fstream>
 #include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
 #include "Graphics/Scene/Editor/SceneEditor.h"
+#include "SceneSnapshot.h"
 
 #define SCENE_EXPORTER
 #include "SceneExportImportCommon.h"
@@ -49,6 +51,19 @@ namespace Falcor
         return exporter.save(exportOptions);
     }
 
+    bool SceneExporter::saveSnapshot(const std::string& filename, const Scene::SharedPtr& pScene, bool compressTextures)
+    {
+        if (hasSuffix(filename, SceneSnapshot::kFileExtension, false) == false)
+        {
+            logWarning("Saving a scene snapshot, but the extension is not '" + std::string(SceneSnapshot::kFileExtension) + "'. The snapshot can't be loaded as a scene.");
+        }
+
+        SceneExporter exporter(filename, pScene);
+        exporter.mSnapshot = true;
+        std::string sceneDesc = exporter.createSceneDesc(ExportAll);
+        return SceneSnapshot::save(filename, pScene, sceneDesc, compressTextures);
+    }
+
     template<typename T>
     void addLiteral(rapidjson::Value& jval, rapidjson::Document::AllocatorType& jallocator, const std::string& key, const T& value)
     {
@@ -97,6 +112,23 @@ namespace Falcor
     }
 
     bool SceneExporter::save(uint32_t exportOptions)
+    {
+        std::string str = createSceneDesc(exportOptions);
+
+        // Output the file
+        std::ofstream outputStream(mFilename.c_str());
+        if (outputStream.fail())
+        {
+            logError("Can't open output scene file " + mFilename + ".\nExporting failed.");
+            return false;
+        }
+        outputStream << str;
+        outputStream.close();
+
+        return true;
+    }
+
+    std::string SceneExporter::createSceneDesc(uint32_t exportOptions)
     {
         mExportOptions = exportOptions;
 
@@ -122,19 +154,7 @@ namespace Falcor
         rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
         writer.SetIndent(' ', 4);
         mJDoc.Accept(writer);
-        std::string str(buffer.GetString(), buffer.GetSize());
-
-        // Output the file
-        std::ofstream outputStream(mFilename.c_str());
-        if (outputStream.fail())
-        {
-            logError("Can't open output scene file " + mFilename + ".\nExporting failed.");
-            return false;
-        }
-        outputStream << str;
-        outputStream.close();
-
-        return true;
+        return std::string(buffer.GetString(), buffer.GetSize());
     }
 
     void SceneExporter::writeGlobalSettings(bool writeActivePath)
@@ -207,21 +227,25 @@ namespace Falcor
 
     void SceneExporter::writeModels()
     {
-        if (mpScene->getModelCount() == 0)
-        {
-            return;
-        }
-
         rapidjson::Value jsonModelArray;
         jsonModelArray.SetArray();
 
         for (uint32_t i = 0; i < mpScene->getModelCount(); i++)
         {
+            if (mSnapshot && SceneSnapshot::canEmbedModel(mpScene->getModel(i).get()))
+            {
+                continue;
+            }
+
             rapidjson::Value jsonModel;
             createModelValue(mpScene, i, mJDoc.GetAllocator(), jsonModel);
             jsonModelArray.PushBack(jsonModel, mJDoc.GetAllocator());
         }
-        addJsonValue(mJDoc, mJDoc.GetAllocator(), SceneKeys::kModels, jsonModelArray);
+
+        if (jsonModelArray.Size() > 0)
+        {
+            addJsonValue(mJDoc, mJDoc.GetAllocator(), SceneKeys::kModels, jsonModelArray);
+        }
     }
 
     void createPointLightValue(const PointLight* pLight, rapidjson::Document::AllocatorType& allocator, rapidjson::Value& jsonLight)
@@ -341,6 +365,7 @@ namespace Falcor
             jsonPath.SetObject();
             addString(jsonPath, allocator, SceneKeys::kName, pPath->getName());
             addBool(jsonPath, allocator, SceneKeys::kPathLoop, pPath->isRepeatOn());
+            addBool(jsonPath, allocator, SceneKeys::kPathConstantSpeed, pPath->getPlaybackMode() == ObjectPath::Playback::ConstantSpeed);
 
             // Add the keyframes
             rapidjson::Value jsonFramesArray(rapidjson::kArrayType);
@@ -55,6 +55,13 @@ namespace Falcor
 
         static bool saveScene(const std::string& filename, const Scene::SharedPtr& pScene, uint32_t exportOptions = ExportAll);
 
+        /** Save a binary snapshot of the scene, see SceneSnapshot. Loading a snapshot skips the model importers and the texture decoding.
+            \param[in] filename Output filename. Should have the SceneSnapshot::kFileExtension extension, which is how Scene::loadFromFile() recognizes snapshots.
+            \param[in] pScene The scene
+            \param[in] compressTextures Whether to block-compress 8-bit color textures
+        */
+        static bool saveSnapshot(const std::string& filename, const Scene::SharedPtr& pScene, bool compressTextures = true);
+
         static const uint32_t kVersion = 2;
 
     private:
@@ -63,6 +70,7 @@ namespace Falcor
             : mpScene(pScene), mFilename(filename) {}
 
         bool save(uint32_t exportOptions);
+        std::string createSceneDesc(uint32_t exportOptions);
 
         void writeModels();
         void writeLights();
@@ -75,5 +83,6 @@ namespace Falcor
         Scene::SharedPtr mpScene = nullptr;
         std::string mFilename;
         uint32_t mExportOptions = 0;
+        bool mSnapshot = false;         ///< Models embedded in the snapshot are left out of the scene description
     };
 }
\ No newline at end of file
@@ -36,12 +36,106 @@
 #include "Graphics/TextureHelper.h"
 #include "API/Device.h"
 #include "Data/HostDeviceSharedMacros.h"
+#include "Graphics/Model/Loaders/ModelPreload.h"
+#include "SceneSnapshot.h"
+#include "Utils/StringUtils.h"
+#include "Utils/CpuTimer.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #define SCENE_IMPORTER
 #include "SceneExportImportCommon.h"
 
 namespace Falcor
 {
+    namespace
+    {
+        const uint32_t kMaxPreloadsAhead = 8;
+
+        /** Runs Model::preloadFromFile() on worker threads, in order, for a list of models.
+            Workers stay at most kMaxPreloadsAhead models ahead of the model the render thread is waiting for, which bounds the memory held by preloads.
+        */
+        class ModelPreloadQueue
+        {
+        public:
+            struct Task
+            {
+                std::string file;
+                Model::LoadFlags flags;
+                std::shared_ptr<ModelPreload> pPreload;
+                bool done = false;
+            };
+
+            ModelPreloadQueue(const std::vector<Task>& tasks) : mTasks(tasks)
+            {
+                uint32_t threadCount = std::min(std::max(1u, std::thread::hardware_concurrency()), kMaxPreloadsAhead);
+                threadCount = std::min(threadCount, (uint32_t)mTasks.size());
+                for (uint32_t t = 0; t < threadCount; t++) mThreads.emplace_back(&ModelPreloadQueue::worker, this);
+            }
+
+            ~ModelPreloadQueue()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mStop = true;
+                }
+                mCondition.notify_all();
+                for (auto& t : mThreads) t.join();
+            }
+
+            /** Wait for a task to be preloaded. Returns nullptr if the preload failed.
+            */
+            std::shared_ptr<ModelPreload> get(uint32_t task)
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                if (task > mCurrent)
+                {
+                    mCurrent = task;
+                    mCondition.notify_all();
+                }
+                mCondition.wait(lock, [&]() { return mTasks[task].done; });
+                return mTasks[task].pPreload;
+            }
+
+            /** Release the preloaded data of a task which is no longer needed
+            */
+            void release(uint32_t task)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mTasks[task].pPreload = nullptr;
+            }
+
+        private:
+            void worker()
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                while (true)
+                {
+                    mCondition.wait(lock, [this]() { return mStop || mNext >= mTasks.size() || mNext < mCurrent + kMaxPreloadsAhead; });
+                    if (mStop || mNext >= mTasks.size()) return;
+
+                    uint32_t task = mNext++;
+                    lock.unlock();
+                    std::shared_ptr<ModelPreload> pPreload = Model::preloadFromFile(mTasks[task].file.c_str(), mTasks[task].flags);
+                    lock.lock();
+
+                    mTasks[task].pPreload = pPreload;
+                    mTasks[task].done = true;
+                    mCondition.notify_all();
+                }
+            }
+
+            std::vector<Task> mTasks;
+            std::vector<std::thread> mThreads;
+            std::mutex mMutex;
+            std::condition_variable mCondition;
+            uint32_t mNext = 0;         // Next task to preload
+            uint32_t mCurrent = 0;      // Task the render thread is waiting for
+            bool mStop = false;
+        };
+    }
+
     bool SceneImporter::error(const std::string& msg)
     {
         std::string err = "Error when parsing scene file \"" + mFilename + "\".\n" + msg;
@@ -175,7 +269,7 @@ namespace Falcor
         return true;
     }
 
-    bool SceneImporter::createModel(const rapidjson::Value& jsonModel)
+    bool SceneImporter::getModelFileAndFlags(const rapidjson::Value& jsonModel, std::string& file, Model::LoadFlags& flags)
     {
         // Model must have at least a filename
         if (jsonModel.HasMember(SceneKeys::kFilename) == false)
@@ -190,14 +284,14 @@ namespace Falcor
             return error("Model filename must be a string");
         }
 
-        std::string file = mDirectory + '/' + modelFile.GetString();
+        file = mDirectory + '/' + modelFile.GetString();
         if (doesFileExist(file) == false)
         {
             file = modelFile.GetString();
         }
 
         // Parse additional properties that affect loading
-        Model::LoadFlags modelFlags = mModelLoadFlags;
+        flags = mModelLoadFlags;
         if (jsonModel.HasMember(SceneKeys::kMaterial))
         {
             const auto& materialSettings = jsonModel[SceneKeys::kMaterial];
@@ -212,14 +306,19 @@ namespace Falcor
                 {
                     if (m->value == SceneKeys::kShadingSpecGloss)
                     {
-                        modelFlags |= Model::LoadFlags::UseSpecGlossMaterials;
+                        flags |= Model::LoadFlags::UseSpecGlossMaterials;
                     }
                 }
             }
         }
 
+        return true;
+    }
+
+    bool SceneImporter::createModel(const rapidjson::Value& jsonModel, const std::string& file, Model::LoadFlags flags, const ModelPreload* pPreload)
+    {
         // Load the model
-        auto pModel = Model::createFromFile(file.c_str(), modelFlags);
+        auto pModel = Model::createFromFile(file.c_str(), flags, pPreload);
         if (pModel == nullptr)
         {
             return error("Could not load model: " + file);
@@ -296,14 +395,65 @@ namespace Falcor
             return error("models section should be an array of objects.");
         }
 
-        // Loop over the array
-        for (uint32_t i = 0; i < jsonVal.Size(); i++)
+        // Read all the filenames first, so that the models can be preloaded ahead of their creation
+        const uint32_t modelCount = jsonVal.Size();
+        std::vector<std::string> files(modelCount);
+        std::vector<Model::LoadFlags> flags(modelCount);
+        for (uint32_t i = 0; i < modelCount; i++)
         {
-            if (createModel(jsonVal[i]) == false)
+            if (getModelFileAndFlags(jsonVal[i], files[i], flags[i]) == false)
             {
                 return false;
             }
         }
+
+        // Models which use the same file with the same flags share a preload
+        std::vector<ModelPreloadQueue::Task> tasks;
+        std::vector<uint32_t> modelTask(modelCount);
+        std::vector<uint32_t> lastModelOfTask;
+        for (uint32_t i = 0; i < modelCount; i++)
+        {
+            uint32_t task = 0;
+            while (task < tasks.size() && (tasks[task].file != files[i] || tasks[task].flags != flags[i])) task++;
+            if (task == tasks.size())
+            {
+                ModelPreloadQueue::Task newTask;
+                newTask.file = files[i];
+                newTask.flags = flags[i];
+                tasks.push_back(newTask);
+                lastModelOfTask.push_back(i);
+            }
+            modelTask[i] = task;
+            lastModelOfTask[task] = i;
+        }
+
+        // Preloads run on worker threads. Models are created on this thread in scene order, each as soon as its preload is done, so the scene doesn't depend on the order the preloads finish in.
+        CpuTimer::TimePoint loadStart = CpuTimer::getCurrentTimePoint();
+        ModelPreloadQueue queue(tasks);
+        for (uint32_t i = 0; i < modelCount; i++)
+        {
+            uint32_t task = modelTask[i];
+            CpuTimer::TimePoint waitStart = CpuTimer::getCurrentTimePoint();
+            std::shared_ptr<ModelPreload> pPreload = queue.get(task);
+            CpuTimer::TimePoint createStart = CpuTimer::getCurrentTimePoint();
+
+            if (createModel(jsonVal[i], files[i], flags[i], pPreload.get()) == false)
+            {
+                return false;
+            }
+
+            char msg[256];
+            snprintf(msg, sizeof(msg), "preloaded in %.1f ms, waited %.1f ms, created in %.1f ms",
+                pPreload ? pPreload->preloadTime : 0.0f, CpuTimer::calcDuration(waitStart, createStart), CpuTimer::calcDuration(createStart, CpuTimer::getCurrentTimePoint()));
+            logInfo("Model '" + files[i] + "' " + msg);
+
+            if (lastModelOfTask[task] == i)
+            {
+                queue.release(task);
+            }
+        }
+
+        logInfo("Loaded " + std::to_string(modelCount) + " models in " + std::to_string(CpuTimer::calcDuration(loadStart, CpuTimer::getCurrentTimePoint())) + " ms");
         return true;
     }
 
@@ -766,6 +916,16 @@ namespace Falcor
                 bool b = value.GetBool();
                 pPath->setAnimationRepeat(b);
             }
+            else if (key == SceneKeys::kPathConstantSpeed)
+            {
+                if (value.IsBool() == false)
+                {
+                    error("Path constant speed should be a boolean value");
+                    return nullptr;
+                }
+
+                pPath->setPlaybackMode(value.GetBool() ? ObjectPath::Playback::ConstantSpeed : ObjectPath::Playback::KeyFrameTimes);
+            }
             else if (key == SceneKeys::kPathFrames)
             {
                 if (createPathFrames(pPath.get(), value) == false)
@@ -996,15 +1156,34 @@ namespace Falcor
 
         if (findFileInDataDirectories(filename, fullpath))
         {
-            // Load the file
-            std::string jsonData = readFile(fullpath);
-            rapidjson::StringStream JStream(jsonData.c_str());
-
             // Get the file directory
             auto last = fullpath.find_last_of("/\\");
             mDirectory = fullpath.substr(0, last);
 
+            std::string jsonData;
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            const bool isSnapshot = hasSuffix(fullpath, SceneSnapshot::kFileExtension, false);
+            if (isSnapshot)
+            {
+                // The snapshot holds the embedded models and the scene description of everything else
+                std::vector<Scene::ModelInstance::SharedPtr> instances;
+                if (SceneSnapshot::load(fullpath, mModelLoadFlags, mScene, instances, jsonData) == false)
+                {
+                    return false;
+                }
+
+                for (const auto& pInstance : instances)
+                {
+                    mInstanceMap[pInstance->getName()] = pInstance;
+                }
+            }
+            else
+            {
+                jsonData = readFile(fullpath);
+            }
+
             // create the DOM
+            rapidjson::StringStream JStream(jsonData.c_str());
             mJDoc.ParseStream(JStream);
 
             if (mJDoc.HasParseError())
@@ -1024,6 +1203,11 @@ namespace Falcor
                 mScene.createAreaLights();
             }
 
+            if (isSnapshot)
+            {
+                logInfo("SceneImporter: Scene snapshot '" + filename + "' ready to render after " + std::to_string(CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint())) + "ms.");
+            }
+
             return true;
         }
         else
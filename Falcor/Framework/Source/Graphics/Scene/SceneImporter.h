@@ -65,7 +65,8 @@ namespace Falcor
 
         bool loadIncludeFile(const std::string& Include);
 
-        bool createModel(const rapidjson::Value& jsonModel);
+        bool getModelFileAndFlags(const rapidjson::Value& jsonModel, std::string& file, Model::LoadFlags& flags);
+        bool createModel(const rapidjson::Value& jsonModel, const std::string& file, Model::LoadFlags flags, const ModelPreload* pPreload);
         bool createModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel);
         bool createPointLight(const rapidjson::Value& jsonLight);
         bool createDirLight(const rapidjson::Value& jsonLight);
@@ -36,6 +36,7 @@
 #include "VR/OpenVR/VRSystem.h"
 #include "API/Device.h"
 #include "glm/matrix.hpp"
+#include "Graphics/TextureStreamer.h"
 
 namespace Falcor
 {
@@ -48,6 +49,9 @@ namespace Falcor
     size_t SceneRenderer::sWorldInvTransposeMatOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sVertexQuantizationOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPositionScaleOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPositionOffsetOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightCountOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightArrayOffset = ConstantBuffer::kInvalidOffset;
 
@@ -91,6 +95,9 @@ namespace Falcor
                 sMeshIdOffset = pType->findMember("gMeshId")->getOffset();
                 sDrawIDOffset = pType->findMember("gDrawId[0]")->getOffset();
                 sPrevWorldMatOffset = pType->findMember("gPrevWorldMat[0]")->getOffset();
+                sVertexQuantizationOffset = pType->findMember("gVertexQuantization")->getOffset();
+                sPositionScaleOffset = pType->findMember("gPositionScale")->getOffset();
+                sPositionOffsetOffset = pType->findMember("gPositionOffset")->getOffset();
             }
         }
 
@@ -223,6 +230,12 @@ namespace Falcor
 
             // Set mesh id
             pCB->setVariable(sMeshIdOffset, pMesh->getId());
+
+            // Set the decoding of quantized vertex attributes
+            const Mesh::VertexQuantization& quantization = pMesh->getVertexQuantization();
+            pCB->setVariable(sVertexQuantizationOffset, quantization.flags);
+            pCB->setVariable(sPositionScaleOffset, quantization.positionScale);
+            pCB->setVariable(sPositionOffsetOffset, quantization.positionOffset);
         }
 
         return true;
@@ -234,15 +247,17 @@ namespace Falcor
         return true;
     }
 
-    void SceneRenderer::executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount)
+    void SceneRenderer::executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex)
     {
         // Draw
-        currentData.pContext->drawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
+        currentData.pContext->drawIndexedInstanced(indexCount, instanceCount, startIndex, 0, 0);
     }
 
-    void SceneRenderer::draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount)
+    void SceneRenderer::draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount, const std::vector<glm::uvec2>* pIndexRanges)
     {
         currentData.pMaterial = pMesh->getMaterial().get();
+        TextureStreamer::markUsed(currentData.pMaterial);
+
         // Bind material
         if(mpLastMaterial != pMesh->getMaterial().get())
         {
@@ -258,7 +273,17 @@ namespace Falcor
             }
         }
 
-        executeDraw(currentData, pMesh->getIndexCount(), instanceCount);
+        if (pIndexRanges)
+        {
+            for (const glm::uvec2& range : *pIndexRanges)
+            {
+                executeDraw(currentData, range.y, instanceCount, range.x);
+            }
+        }
+        else
+        {
+            executeDraw(currentData, pMesh->getIndexCount(), instanceCount, 0);
+        }
         postFlushDraw(currentData);
         currentData.pState->getProgram()->removeDefine("_MS_STATIC_MATERIAL_FLAGS");
     }
@@ -268,16 +293,51 @@ namespace Falcor
 
     }
 
-    bool SceneRenderer::cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance)
+    void SceneRenderer::renderMeshletInstances(CurrentWorkingData& currentData, const uint32_t* pItems, uint32_t itemCount)
     {
-        BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
-        return currentData.pCamera->isObjectCulled(box);
+        const Model* pModel = currentData.pModel;
+        const Mesh* pMesh = pModel->getMesh(mDrawItems[pItems[0]].meshID).get();
+        const MeshletData* pMeshlets = pMesh->getMeshlets();
+
+        // The normal cones assume counter-clockwise front faces and that back faces are culled by the rasterizer. A null rasterizer state means the default one, which does.
+        const RasterizerState* pRastState = currentData.pState->getRasterizerState().get();
+        bool cullBackfaces = (pRastState == nullptr) || ((pRastState->getCullMode() == RasterizerState::CullMode::Back) && pRastState->isFrontCounterCW());
+        cullBackfaces = cullBackfaces && (pMesh->getMaterial()->getDoubleSided() == false);
+
+        currentData.pState->setVao(pModel->getMeshVao(pMesh));
+
+        // Every instance draws its own set of index ranges, so instances can't be batched
+        for (uint32_t i = 0; i < itemCount; i++)
+        {
+            const DrawItem& item = mDrawItems[pItems[i]];
+            glm::mat4 worldMat = item.pModelInstance->getTransformMatrix() * item.pMeshInstance->getTransformMatrix();
+            if (cullMeshlets(*pMeshlets, worldMat, currentData.pCamera, cullBackfaces, mMeshletRanges, &mMeshletStats) == 0)
+            {
+                continue;
+            }
+
+            if (setPerMeshInstanceData(currentData, item.pModelInstance, item.pMeshInstance, 0))
+            {
+                currentData.drawID++;
+                draw(currentData, pMesh, 1, &mMeshletRanges);
+            }
+        }
     }
 
-    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
+    void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const uint32_t* pItems, uint32_t itemCount)
     {
         const Model* pModel = currentData.pModel;
-        const Mesh* pMesh = pModel->getMesh(meshID).get();
+        const Mesh* pMesh = pModel->getMesh(mDrawItems[pItems[0]].meshID).get();
+
+        // Skinned meshes are deformed after their meshlet bounds were computed, so they are always drawn whole
+        if (mMeshletCullEnabled && pMesh->getMeshlets() && (pMesh->hasBones() == false))
+        {
+            if (setPerMeshData(currentData, pMesh))
+            {
+                renderMeshletInstances(currentData, pItems, itemCount);
+            }
+            return;
+        }
 
         if (setPerMeshData(currentData, pMesh))
         {
@@ -293,28 +353,20 @@ namespace Falcor
 
             uint32_t activeInstances = 0;
 
-            const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
-            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+            for (uint32_t i = 0; i < itemCount; i++)
             {
-                const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, instanceID).get();
-
-                if (pMeshInstance->isVisible())
+                const DrawItem& item = mDrawItems[pItems[i]];
+                if (setPerMeshInstanceData(currentData, item.pModelInstance, item.pMeshInstance, activeInstances))
                 {
-                    if ((mCullEnabled == false) || (cullMeshInstance(currentData, pModelInstance, pMeshInstance) == false))
+                    currentData.drawID++;
+                    activeInstances++;
+
+                    if (activeInstances == mMaxInstanceCount)
                     {
-                        if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
-                        {
-                            currentData.drawID++;
-                            activeInstances++;
-
-                            if (activeInstances == mMaxInstanceCount)
-                            {
-                                // DISABLED_FOR_D3D12
-                                //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                draw(currentData, pMesh, activeInstances);
-                                activeInstances = 0;
-                            }
-                        }
+                        // DISABLED_FOR_D3D12
+                        //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
+                        draw(currentData, pMesh, activeInstances);
+                        activeInstances = 0;
                     }
                 }
             }
@@ -331,14 +383,98 @@ namespace Falcor
         }
     }
 
-    void SceneRenderer::renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance)
+    void SceneRenderer::buildDrawList(const CurrentWorkingData& currentData)
+    {
+        mDrawItems.clear();
+        mCuller.clear();
+
+        mMeshOrders.resize(mpScene->getModelCount());
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = mpScene->getModel(modelID).get();
+            const uint32_t instanceCount = mpScene->getModelInstanceCount(modelID);
+
+            // Visit the meshes sorted by material, so that the draw list switches materials as little as possible.
+            // The order is kept from the previous frame as long as it covers the model's meshes and is still sorted.
+            std::vector<uint32_t>& meshOrder = mMeshOrders[modelID];
+            auto byMaterial = [pModel](uint32_t a, uint32_t b) { return pModel->getMesh(a)->getMaterial() < pModel->getMesh(b)->getMaterial(); };
+            if (meshOrder.size() != pModel->getMeshCount() || std::is_sorted(meshOrder.begin(), meshOrder.end(), byMaterial) == false)
+            {
+                meshOrder.resize(pModel->getMeshCount());
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    meshOrder[meshID] = meshID;
+                }
+                std::stable_sort(meshOrder.begin(), meshOrder.end(), byMaterial);
+            }
+
+            for (uint32_t meshID : meshOrder)
+            {
+                for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+                {
+                    const Scene::ModelInstance* pInstance = mpScene->getModelInstance(modelID, instanceID).get();
+                    if (pInstance->isVisible() == false) continue;
+
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID).get();
+                        if (pMeshInstance->isVisible() == false) continue;
+
+                        mDrawItems.push_back({ modelID, instanceID, meshID, pInstance, pMeshInstance });
+                        if (mCullEnabled)
+                        {
+                            mCuller.addBox(pMeshInstance->getBoundingBox(), pInstance->getTransformMatrix());
+                        }
+                    }
+                }
+            }
+        }
+
+        if (mCullEnabled)
+        {
+            mCuller.cull(currentData.pCamera, mVisibleItems);
+        }
+        else
+        {
+            mVisibleItems.resize(mDrawItems.size());
+            for (uint32_t i = 0; i < (uint32_t)mDrawItems.size(); i++)
+            {
+                mVisibleItems[i] = i;
+            }
+        }
+    }
+
+    void SceneRenderer::renderDrawList(CurrentWorkingData& currentData)
     {
-        mpLastMaterial = nullptr;
+        uint32_t currentModelID = uint32_t(-1);
+        bool isModelValid = false;
 
-        // Loop over the meshes
-        for (uint32_t meshID = 0; meshID < pModelInstance->getObject()->getMeshCount(); meshID++)
+        size_t first = 0;
+        while (first < mVisibleItems.size())
         {
-            renderMeshInstances(currentData, pModelInstance, meshID);
+            // Find the run of items with the same mesh and model instance
+            const DrawItem& item = mDrawItems[mVisibleItems[first]];
+            size_t last = first + 1;
+            while (last < mVisibleItems.size())
+            {
+                const DrawItem& next = mDrawItems[mVisibleItems[last]];
+                if (next.modelID != item.modelID || next.meshID != item.meshID || next.modelInstanceID != item.modelInstanceID) break;
+                last++;
+            }
+
+            if (item.modelID != currentModelID)
+            {
+                currentModelID = item.modelID;
+                currentData.pModel = mpScene->getModel(item.modelID).get();
+                isModelValid = setPerModelData(currentData);
+                mpLastMaterial = nullptr;
+            }
+
+            if (isModelValid && setPerModelInstanceData(currentData, item.pModelInstance, item.modelInstanceID))
+            {
+                renderMeshInstances(currentData, &mVisibleItems[first], uint32_t(last - first));
+            }
+            first = last;
         }
     }
 
@@ -355,26 +491,8 @@ namespace Falcor
     void SceneRenderer::renderScene(CurrentWorkingData& currentData)
     {
         setPerFrameData(currentData);
-
-        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
-        {
-            currentData.pModel = mpScene->getModel(modelID).get();
-
-            if (setPerModelData(currentData))
-            {
-                for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
-                {
-                    const auto pInstance = mpScene->getModelInstance(modelID, instanceID).get();
-                    if (pInstance->isVisible())
-                    {
-                        if (setPerModelInstanceData(currentData, pInstance, instanceID))
-                        {
-                            renderModelInstance(currentData, pInstance);
-                        }
-                    }
-                }
-            }
-        }
+        buildDrawList(currentData);
+        renderDrawList(currentData);
     }
 
     void SceneRenderer::renderScene(RenderContext* pContext, const Camera* pCamera)
@@ -389,6 +507,7 @@ namespace Falcor
         currentData.pMaterial = nullptr;
         currentData.pModel = nullptr;
         currentData.drawID = 0;
+        mMeshletStats = MeshletCullingStats();
         renderScene(currentData);
     }
 
@@ -33,6 +33,7 @@
 #include "Utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
+#include "InstanceCuller.h"
 
 namespace Falcor
 {
@@ -73,7 +74,7 @@ namespace Falcor
         bool onKeyEvent(const KeyboardEvent& keyEvent);
         bool onMouseEvent(const MouseEvent& mouseEvent);
 
-        /** Enable/disable mesh culling. Culling does not always result in performance gain, especially when there are a lot of meshes to process with low rejection rate.
+        /** Enable/disable mesh culling. Mesh instances are frustum culled in bulk before drawing, see InstanceCuller.
         */
         void toggleMeshCulling(bool enable) { mCullEnabled = enable; }
 
@@ -81,6 +82,18 @@ namespace Falcor
         */
         bool isMeshCullingEnabled() const { return mCullEnabled; }
 
+        /** Enable/disable meshlet culling. When enabled, meshes with meshlets (see Model::LoadFlags::GenerateMeshlets) are culled per meshlet against the frustum and, when the rasterizer culls back faces, by the meshlets' normal cones. Only the visible meshlets are drawn.
+        */
+        void toggleMeshletCulling(bool enable) { mMeshletCullEnabled = enable; }
+
+        /** Check if meshlet culling is enabled
+        */
+        bool isMeshletCullingEnabled() const { return mMeshletCullEnabled; }
+
+        /** Get the meshlet culling statistics of the last renderScene() call
+        */
+        const MeshletCullingStats& getMeshletCullingStats() const { return mMeshletStats; }
+
         /** Set the maximal number of mesh instance to dispatch in a single draw call.
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
@@ -135,6 +148,9 @@ namespace Falcor
         static size_t sWorldInvTransposeMatOffset;
         static size_t sMeshIdOffset;
         static size_t sDrawIDOffset;
+        static size_t sVertexQuantizationOffset;
+        static size_t sPositionScaleOffset;
+        static size_t sPositionOffsetOffset;
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
@@ -144,13 +160,30 @@ namespace Falcor
         virtual bool setPerMeshData(const CurrentWorkingData& currentData, const Mesh* pMesh);
         virtual bool setPerMeshInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t drawInstanceID);
         virtual bool setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial);
-        virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount);
+        virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex);
         virtual void postFlushDraw(const CurrentWorkingData& currentData);
-        virtual bool cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance);
 
-        void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance);
-        void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
-        void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
+        /** A mesh instance to draw
+        */
+        struct DrawItem
+        {
+            uint32_t modelID;
+            uint32_t modelInstanceID;
+            uint32_t meshID;
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+        };
+
+        /** Collect the visible mesh instances and frustum cull them. The resulting draw list is ordered by model, then by the material of the mesh, then by model instance.
+        */
+        void buildDrawList(const CurrentWorkingData& currentData);
+        void renderDrawList(CurrentWorkingData& currentData);
+
+        /** Draw a run of items from the draw list which share the model, the mesh and the model instance
+        */
+        void renderMeshInstances(CurrentWorkingData& currentData, const uint32_t* pItems, uint32_t itemCount);
+        void renderMeshletInstances(CurrentWorkingData& currentData, const uint32_t* pItems, uint32_t itemCount);
+        void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount, const std::vector<glm::uvec2>* pIndexRanges = nullptr);
 
         void renderScene(CurrentWorkingData& currentData);
 
@@ -160,6 +193,14 @@ namespace Falcor
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
+        bool mMeshletCullEnabled = true;
+        MeshletCullingStats mMeshletStats;
+        std::vector<glm::uvec2> mMeshletRanges;
+
+        std::vector<DrawItem> mDrawItems;       ///< The mesh instances which are visible, before culling
+        std::vector<uint32_t> mVisibleItems;    ///< Indices into mDrawItems of the items which pass culling
+        std::vector<std::vector<uint32_t>> mMeshOrders;    ///< The mesh IDs of each model, sorted by material. Re-sorted when the meshes or their materials change.
+        InstanceCuller mCuller;
         bool mCompileMaterialWithProgram = true;
     };
 }
@@ -0,0 +1,850 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneSnapshot.h"
+#include "API/Device.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/Platform/OS.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace Falcor
+{
+    const char* SceneSnapshot::kFileExtension = ".fsnap";
+    const uint32_t SceneSnapshot::kVersion;
+    const uint32_t SceneSnapshot::kPageSize;
+    const size_t SceneSnapshot::kArrayAlignment;
+
+    namespace
+    {
+        const uint32_t kMagic = 0x50414E53;     // 'SNAP'
+        const int32_t kNone = -1;               // Index of a missing texture, buffer or vertex buffer layout
+
+        using MetadataWriter = SceneSnapshot::MetadataWriter;
+        using MetadataReader = SceneSnapshot::MetadataReader;
+
+        /** The file starts with the header, followed by the metadata. The data blobs start at the first page boundary after the metadata.
+        */
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t pageSize;
+            uint32_t reserved;
+            uint64_t metadataOffset;
+            uint64_t metadataSize;
+            uint64_t dataOffset;
+            uint64_t dataSize;
+        };
+
+        /** A data blob. The offset is relative to the start of the data, and is a multiple of the page size.
+        */
+        struct Blob
+        {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        struct MappedFile
+        {
+            MappedFile(const std::string& filename) { pData = (const uint8_t*)mapFileForReading(filename, size); }
+            ~MappedFile() { if(pData) unmapFile(pData, size); }
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const uint8_t* pData = nullptr;
+            size_t size = 0;
+        };
+
+        // Block compression. A straightforward range fit along the principal axis of each block's colors, which is good enough for
+        // snapshots. Offline tools get better quality with exhaustive endpoint searches, but are orders of magnitude slower.
+        uint16_t packRgb565(const float c[3])
+        {
+            uint32_t r = (uint32_t)std::min(std::max(c[0], 0.0f), 255.0f);
+            uint32_t g = (uint32_t)std::min(std::max(c[1], 0.0f), 255.0f);
+            uint32_t b = (uint32_t)std::min(std::max(c[2], 0.0f), 255.0f);
+            return (uint16_t)((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+        }
+
+        void unpackRgb565(uint16_t c, int32_t rgb[3])
+        {
+            int32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+            rgb[0] = (r << 3) | (r >> 2);
+            rgb[1] = (g << 2) | (g >> 4);
+            rgb[2] = (b << 3) | (b >> 2);
+        }
+
+        /** Encodes the color part of a BC1/BC3 block, always in 4-color mode. Pixels are RGBA8.
+        */
+        void encodeColorBlock(const uint8_t pixels[16][4], uint8_t* pBlock)
+        {
+            float mean[3] = {};
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                for(uint32_t c = 0; c < 3; c++) mean[c] += pixels[i][c] / 16.0f;
+            }
+
+            // Principal axis by power iteration on the covariance matrix
+            float cov[6] = {};
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                float d[3] = { pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2] };
+                cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+                cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+            }
+            float axis[3] = { 1, 1, 1 };
+            for(uint32_t iter = 0; iter < 8; iter++)
+            {
+                float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+                float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+                float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+                float len = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+                if(len == 0) break;
+                axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+            }
+            float axisLenSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+            float minT = 0, maxT = 0;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                float t = ((pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2]) / axisLenSq;
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+
+            // Inset the endpoints by 1/16 of the range, like most range-fit encoders, to reduce the error of the interpolated colors
+            float inset = (maxT - minT) / 16.0f;
+            float endpoint0[3], endpoint1[3];
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                endpoint0[c] = mean[c] + axis[c] * (maxT - inset);
+                endpoint1[c] = mean[c] + axis[c] * (minT + inset);
+            }
+
+            uint16_t c0 = packRgb565(endpoint0);
+            uint16_t c1 = packRgb565(endpoint1);
+            if(c0 < c1) std::swap(c0, c1);
+
+            uint32_t indices = 0;
+            if(c0 != c1)
+            {
+                int32_t palette[4][3];
+                unpackRgb565(c0, palette[0]);
+                unpackRgb565(c1, palette[1]);
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    uint32_t best = 0;
+                    int32_t bestDist = INT32_MAX;
+                    for(uint32_t p = 0; p < 4; p++)
+                    {
+                        int32_t dr = pixels[i][0] - palette[p][0], dg = pixels[i][1] - palette[p][1], db = pixels[i][2] - palette[p][2];
+                        int32_t dist = dr * dr + dg * dg + db * db;
+                        if(dist < bestDist) { bestDist = dist; best = p; }
+                    }
+                    indices |= best << (2 * i);
+                }
+            }
+
+            std::memcpy(pBlock, &c0, 2);
+            std::memcpy(pBlock + 2, &c1, 2);
+            std::memcpy(pBlock + 4, &indices, 4);
+        }
+
+        /** Encodes the alpha part of a BC3 block, in 8-alpha mode
+        */
+        void encodeAlphaBlock(const uint8_t pixels[16][4], uint8_t* pBlock)
+        {
+            uint8_t a0 = 0, a1 = 255;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                a0 = std::max(a0, pixels[i][3]);
+                a1 = std::min(a1, pixels[i][3]);
+            }
+
+            uint64_t indices = 0;
+            if(a0 != a1)
+            {
+                int32_t palette[8] = { a0, a1 };
+                for(int32_t p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    uint64_t best = 0;
+                    int32_t bestDist = INT32_MAX;
+                    for(uint32_t p = 0; p < 8; p++)
+                    {
+                        int32_t dist = std::abs(pixels[i][3] - palette[p]);
+                        if(dist < bestDist) { bestDist = dist; best = p; }
+                    }
+                    indices |= best << (3 * i);
+                }
+            }
+
+            pBlock[0] = a0;
+            pBlock[1] = a1;
+            std::memcpy(pBlock + 2, &indices, 6);
+        }
+
+        /** Block-compress a mip level of an 8-bit RGBA or BGRA texture. Blocks which extend past the edges of the mip repeat the edge texels.
+        */
+        void compressMip(const uint8_t* pSrc, uint32_t width, uint32_t height, bool bgra, bool bc3, std::vector<uint8_t>& dst)
+        {
+            const uint32_t blockSize = bc3 ? 16 : 8;
+            const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+            size_t offset = dst.size();
+            dst.resize(offset + blocksX * blocksY * blockSize);
+
+            for(uint32_t by = 0; by < blocksY; by++)
+            {
+                for(uint32_t bx = 0; bx < blocksX; bx++)
+                {
+                    uint8_t pixels[16][4];
+                    for(uint32_t i = 0; i < 16; i++)
+                    {
+                        uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+                        uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+                        const uint8_t* pTexel = pSrc + (y * width + x) * 4;
+                        pixels[i][0] = pTexel[bgra ? 2 : 0];
+                        pixels[i][1] = pTexel[1];
+                        pixels[i][2] = pTexel[bgra ? 0 : 2];
+                        pixels[i][3] = pTexel[3];
+                    }
+
+                    uint8_t* pBlock = dst.data() + offset + (by * blocksX + bx) * blockSize;
+                    if(bc3)
+                    {
+                        encodeAlphaBlock(pixels, pBlock);
+                        pBlock += 8;
+                    }
+                    encodeColorBlock(pixels, pBlock);
+                }
+            }
+        }
+
+        /** Get the block-compressed format for an 8-bit color format, or ResourceFormat::Unknown if the format can't be compressed
+        */
+        ResourceFormat getCompressedFormat(ResourceFormat format, bool hasAlpha)
+        {
+            switch(format)
+            {
+            case ResourceFormat::RGBA8Unorm:
+            case ResourceFormat::BGRA8Unorm:
+                return hasAlpha ? ResourceFormat::BC3Unorm : ResourceFormat::BC1Unorm;
+            case ResourceFormat::RGBA8UnormSrgb:
+            case ResourceFormat::BGRA8UnormSrgb:
+                return hasAlpha ? ResourceFormat::BC3UnormSrgb : ResourceFormat::BC1UnormSrgb;
+            case ResourceFormat::BGRX8Unorm:
+                return ResourceFormat::BC1Unorm;
+            case ResourceFormat::BGRX8UnormSrgb:
+                return ResourceFormat::BC1UnormSrgb;
+            default:
+                return ResourceFormat::Unknown;
+            }
+        }
+
+        /** Collects the resources of the scene and writes the file
+        */
+        class SnapshotWriter
+        {
+        public:
+            SnapshotWriter(bool compressTextures) : mCompressTextures(compressTextures) {}
+
+            bool write(const std::string& filename, const Scene::SharedPtr& pScene, const std::string& sceneDesc);
+
+        private:
+            Blob addBlob(std::vector<uint8_t> data)
+            {
+                Blob blob = { mDataSize, data.size() };
+                mDataSize = align_to((uint64_t)SceneSnapshot::kPageSize, mDataSize + data.size());
+                mBlobs.push_back(std::move(data));
+                return blob;
+            }
+
+            int32_t addBuffer(const Buffer* pBuffer);
+            int32_t addTexture(const Texture::SharedPtr& pTexture);
+            int32_t addMaterial(const Material* pMaterial);
+            void writeMesh(const Mesh* pMesh);
+            void writeModel(const Model* pModel);
+
+            bool mCompressTextures;
+            std::set<const Texture*> mUncompressedTextures;     // Textures which shouldn't be compressed, such as normal maps
+
+            std::map<const Buffer*, int32_t> mBufferIndices;
+            std::map<const Texture*, int32_t> mTextureIndices;
+            std::map<const Material*, int32_t> mMaterialIndices;
+
+            // Resource tables, written before the models
+            MetadataWriter mBuffers;
+            MetadataWriter mTextures;
+            MetadataWriter mMaterials;
+            MetadataWriter mModels;
+
+            std::vector<std::vector<uint8_t>> mBlobs;
+            uint64_t mDataSize = 0;
+
+            uint64_t mBufferBytes = 0;
+            uint64_t mTextureBytes = 0;
+            uint64_t mUncompressedTextureBytes = 0;
+            uint32_t mCompressedTextureCount = 0;
+        };
+
+        int32_t SnapshotWriter::addBuffer(const Buffer* pBuffer)
+        {
+            if(pBuffer == nullptr) return kNone;
+
+            auto it = mBufferIndices.find(pBuffer);
+            if(it != mBufferIndices.end()) return it->second;
+
+            Buffer* pMutableBuffer = const_cast<Buffer*>(pBuffer);
+            const uint8_t* pData = (const uint8_t*)pMutableBuffer->map(Buffer::MapType::Read);
+            std::vector<uint8_t> data(pData, pData + pBuffer->getSize());
+            pMutableBuffer->unmap();
+
+            mBuffers.write((uint64_t)pBuffer->getSize());
+            mBuffers.write((uint32_t)pBuffer->getBindFlags());
+            mBuffers.write(addBlob(std::move(data)));
+            mBufferBytes += pBuffer->getSize();
+
+            int32_t index = (int32_t)mBufferIndices.size();
+            mBufferIndices[pBuffer] = index;
+            return index;
+        }
+
+        int32_t SnapshotWriter::addTexture(const Texture::SharedPtr& pTexture)
+        {
+            if(pTexture == nullptr) return kNone;
+
+            auto it = mTextureIndices.find(pTexture.get());
+            if(it != mTextureIndices.end()) return it->second;
+
+            if(pTexture->getType() != Resource::Type::Texture2D || pTexture->getArraySize() != 1)
+            {
+                logWarning("SceneSnapshot: Texture '" + pTexture->getSourceFilename() + "' is not a 2D texture. It is not stored in the snapshot.");
+                return kNone;
+            }
+
+            // Read back the mips
+            RenderContext* pContext = gpDevice->getRenderContext().get();
+            const uint32_t width = pTexture->getWidth(), height = pTexture->getHeight(), mipLevels = pTexture->getMipCount();
+            std::vector<std::vector<uint8_t>> mips(mipLevels);
+            for(uint32_t mip = 0; mip < mipLevels; mip++)
+            {
+                mips[mip] = pContext->readTextureSubresource(pTexture.get(), pTexture->getSubresourceIndex(0, mip));
+            }
+
+            ResourceFormat format = pTexture->getFormat();
+            const uint64_t size = SceneSnapshot::getMipChainSize(format, width, height, mipLevels);
+
+            // Block-compressed formats need the size of the top mip to be a multiple of the block size
+            ResourceFormat compressedFormat = ResourceFormat::Unknown;
+            if(mCompressTextures && mUncompressedTextures.count(pTexture.get()) == 0 && (width % 4) == 0 && (height % 4) == 0)
+            {
+                bool hasAlpha = false;
+                if(getFormatBytesPerBlock(format) == 4 && mips[0].size() == (size_t)width * height * 4)
+                {
+                    for(size_t i = 3; i < mips[0].size() && hasAlpha == false; i += 4) hasAlpha = (mips[0][i] != 255);
+                    compressedFormat = getCompressedFormat(format, hasAlpha);
+                }
+            }
+
+            std::vector<uint8_t> data;
+            if(compressedFormat != ResourceFormat::Unknown)
+            {
+                const ResourceFormat linearFormat = srgbToLinearFormat(format);
+                const bool bgra = (linearFormat == ResourceFormat::BGRA8Unorm || linearFormat == ResourceFormat::BGRX8Unorm);
+                const bool bc3 = (compressedFormat == ResourceFormat::BC3Unorm || compressedFormat == ResourceFormat::BC3UnormSrgb);
+                for(uint32_t mip = 0; mip < mipLevels; mip++)
+                {
+                    compressMip(mips[mip].data(), std::max(width >> mip, 1u), std::max(height >> mip, 1u), bgra, bc3, data);
+                }
+                mUncompressedTextureBytes += size;
+                mCompressedTextureCount++;
+                format = compressedFormat;
+            }
+            else
+            {
+                for(const auto& mip : mips) data.insert(data.end(), mip.begin(), mip.end());
+                if(data.size() != size)
+                {
+                    logWarning("SceneSnapshot: Unexpected size of the data of texture '" + pTexture->getSourceFilename() + "'. It is not stored in the snapshot.");
+                    return kNone;
+                }
+                mUncompressedTextureBytes += size;
+            }
+
+            mTextures.write((uint32_t)format);
+            mTextures.write(width);
+            mTextures.write(height);
+            mTextures.write(mipLevels);
+            mTextures.writeString(pTexture->getSourceFilename());
+            mTextureBytes += data.size();
+            mTextures.write(addBlob(std::move(data)));
+
+            int32_t index = (int32_t)mTextureIndices.size();
+            mTextureIndices[pTexture.get()] = index;
+            return index;
+        }
+
+        int32_t SnapshotWriter::addMaterial(const Material* pMaterial)
+        {
+            auto it = mMaterialIndices.find(pMaterial);
+            if(it != mMaterialIndices.end()) return it->second;
+
+            mMaterials.writeString(pMaterial->getName());
+            mMaterials.write(pMaterial->getShadingModel());
+            mMaterials.write(pMaterial->getAlphaMode());
+            mMaterials.write((uint32_t)pMaterial->getDoubleSided());
+            mMaterials.write(pMaterial->getBaseColor());
+            mMaterials.write(pMaterial->getSpecularParams());
+            mMaterials.write(pMaterial->getEmissiveColor());
+            mMaterials.write(pMaterial->getAlphaThreshold());
+            mMaterials.write(pMaterial->getIndexOfRefraction());
+            mMaterials.write(pMaterial->getHeightScale());
+            mMaterials.write(pMaterial->getHeightOffset());
+            mMaterials.write(addTexture(pMaterial->getBaseColorTexture()));
+            mMaterials.write(addTexture(pMaterial->getSpecularTexture()));
+            mMaterials.write(addTexture(pMaterial->getEmissiveTexture()));
+            mMaterials.write(addTexture(pMaterial->getNormalMap()));
+            mMaterials.write(addTexture(pMaterial->getOcclusionMap()));
+            mMaterials.write(addTexture(pMaterial->getLightMap()));
+            mMaterials.write(addTexture(pMaterial->getHeightMap()));
+
+            int32_t index = (int32_t)mMaterialIndices.size();
+            mMaterialIndices[pMaterial] = index;
+            return index;
+        }
+
+        void SnapshotWriter::writeMesh(const Mesh* pMesh)
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            const VertexLayout* pLayout = pVao->getVertexLayout().get();
+
+            mModels.write(pMesh->getVertexCount());
+            mModels.write(pMesh->getIndexCount());
+            mModels.write((uint32_t)pVao->getPrimitiveTopology());
+            mModels.write(addMaterial(pMesh->getMaterial().get()));
+            mModels.write(pMesh->getBoundingBox());
+            mModels.write(pMesh->getVertexQuantization());
+
+            mModels.write((uint32_t)pLayout->getBufferCount());
+            for(uint32_t i = 0; i < (uint32_t)pLayout->getBufferCount(); i++)
+            {
+                const VertexBufferLayout* pBufferLayout = pLayout->getBufferLayout(i).get();
+                const Buffer* pBuffer = (pBufferLayout && i < pVao->getVertexBuffersCount()) ? pVao->getVertexBuffer(i).get() : nullptr;
+                mModels.write(addBuffer(pBuffer));
+                if(pBuffer == nullptr) continue;
+
+                mModels.write(pBufferLayout->getElementCount());
+                for(uint32_t e = 0; e < pBufferLayout->getElementCount(); e++)
+                {
+                    mModels.writeString(pBufferLayout->getElementName(e));
+                    mModels.write(pBufferLayout->getElementOffset(e));
+                    mModels.write((uint32_t)pBufferLayout->getElementFormat(e));
+                    mModels.write(pBufferLayout->getElementArraySize(e));
+                    mModels.write(pBufferLayout->getElementShaderLocation(e));
+                }
+                mModels.write((uint32_t)pBufferLayout->getInputClass());
+                mModels.write(pBufferLayout->getInstanceStepRate());
+            }
+            mModels.write(addBuffer(pVao->getIndexBuffer().get()));
+
+            const MeshletData* pMeshlets = pMesh->getMeshlets();
+            mModels.write((uint32_t)(pMeshlets != nullptr));
+            if(pMeshlets)
+            {
+                mModels.writeVector(pMeshlets->meshlets);
+                mModels.writeVector(pMeshlets->vertices);
+                mModels.writeVector(pMeshlets->primitiveIndices);
+            }
+        }
+
+        void SnapshotWriter::writeModel(const Model* pModel)
+        {
+            mModels.writeString(pModel->getName());
+            mModels.writeString(pModel->getFilename());
+
+            mModels.write(pModel->getMeshCount());
+            for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                writeMesh(pModel->getMesh(meshID).get());
+            }
+
+            uint32_t meshInstanceCount = 0;
+            for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++) meshInstanceCount += pModel->getMeshInstanceCount(meshID);
+            mModels.write(meshInstanceCount);
+            for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for(uint32_t i = 0; i < pModel->getMeshInstanceCount(meshID); i++)
+                {
+                    mModels.write(meshID);
+                    mModels.write(pModel->getMeshInstance(meshID, i)->getTransformMatrix());
+                }
+            }
+        }
+
+        bool SnapshotWriter::write(const std::string& filename, const Scene::SharedPtr& pScene, const std::string& sceneDesc)
+        {
+            // Normal and height maps lose too much precision when block-compressed with BC1
+            for(uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+            {
+                const Model* pModel = pScene->getModel(modelID).get();
+                for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    const Material* pMaterial = pModel->getMesh(meshID)->getMaterial().get();
+                    mUncompressedTextures.insert(pMaterial->getNormalMap().get());
+                    mUncompressedTextures.insert(pMaterial->getHeightMap().get());
+                }
+            }
+            mUncompressedTextures.insert(pScene->getEnvironmentMap().get());
+
+            uint32_t embeddedCount = 0;
+            for(uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+            {
+                const Model* pModel = pScene->getModel(modelID).get();
+                if(SceneSnapshot::canEmbedModel(pModel) == false) continue;
+
+                writeModel(pModel);
+                mModels.write(pScene->getModelInstanceCount(modelID));
+                for(uint32_t i = 0; i < pScene->getModelInstanceCount(modelID); i++)
+                {
+                    const auto& pInstance = pScene->getModelInstance(modelID, i);
+                    mModels.writeString(pInstance->getName());
+                    mModels.write(pInstance->getTranslation());
+                    mModels.write(pInstance->getRotation());
+                    mModels.write(pInstance->getScaling());
+                }
+                embeddedCount++;
+            }
+            int32_t envMapIndex = addTexture(pScene->getEnvironmentMap());
+
+            MetadataWriter metadata;
+            metadata.writeString(sceneDesc);
+            metadata.writeSection((uint32_t)mBufferIndices.size(), mBuffers);
+            metadata.writeSection((uint32_t)mTextureIndices.size(), mTextures);
+            metadata.writeSection((uint32_t)mMaterialIndices.size(), mMaterials);
+            metadata.writeSection(embeddedCount, mModels);
+            metadata.write(envMapIndex);
+
+            Header header = {};
+            header.magic = kMagic;
+            header.version = SceneSnapshot::kVersion;
+            header.pageSize = SceneSnapshot::kPageSize;
+            header.metadataOffset = sizeof(Header);
+            header.metadataSize = metadata.getData().size();
+            header.dataOffset = align_to((uint64_t)SceneSnapshot::kPageSize, header.metadataOffset + header.metadataSize);
+            header.dataSize = mDataSize;
+
+            BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+            stream.write(&header, sizeof(Header));
+            stream.write(metadata.getData().data(), metadata.getData().size());
+
+            static const uint8_t kZeros[SceneSnapshot::kPageSize] = {};
+            uint64_t offset = header.metadataOffset + header.metadataSize;
+            for(const auto& blob : mBlobs)
+            {
+                uint64_t blobOffset = align_to((uint64_t)SceneSnapshot::kPageSize, offset);
+                stream.write(kZeros, blobOffset - offset);
+                stream.write(blob.data(), blob.size());
+                offset = blobOffset + blob.size();
+            }
+            stream.write(kZeros, header.dataOffset + header.dataSize - offset);
+
+            if(stream.isFail())
+            {
+                logError("SceneSnapshot: Can't write '" + filename + "'.");
+                stream.remove();
+                return false;
+            }
+
+            const float kMB = 1.0f / (1024 * 1024);
+            std::string msg = "SceneSnapshot: Wrote '" + filename + "'. " + std::to_string(embeddedCount) + " models embedded, " + std::to_string(pScene->getModelCount() - embeddedCount) + " stored by filename. ";
+            msg += std::to_string(mBufferIndices.size()) + " buffers (" + std::to_string(mBufferBytes * kMB) + "MB), ";
+            msg += std::to_string(mTextureIndices.size()) + " textures (" + std::to_string(mTextureBytes * kMB) + "MB, " + std::to_string(mCompressedTextureCount) + " block-compressed from " + std::to_string(mUncompressedTextureBytes * kMB) + "MB).";
+            logInfo(msg);
+            return true;
+        }
+    }
+
+    uint64_t SceneSnapshot::getMipChainSize(ResourceFormat format, uint32_t width, uint32_t height, uint32_t mipLevels)
+    {
+        const uint32_t widthRatio = getFormatWidthCompressionRatio(format);
+        const uint32_t heightRatio = getFormatHeightCompressionRatio(format);
+        uint64_t size = 0;
+        for(uint32_t mip = 0; mip < mipLevels; mip++)
+        {
+            uint32_t w = std::max(width >> mip, 1u), h = std::max(height >> mip, 1u);
+            size += (uint64_t)((w + widthRatio - 1) / widthRatio) * ((h + heightRatio - 1) / heightRatio) * getFormatBytesPerBlock(format);
+        }
+        return size;
+    }
+
+    bool SceneSnapshot::canEmbedModel(const Model* pModel)
+    {
+        // Animations and skinning need the model's scene graph and bones, which only the importers create
+        return pModel->hasAnimations() == false && pModel->hasBones() == false;
+    }
+
+    bool SceneSnapshot::save(const std::string& filename, const Scene::SharedPtr& pScene, const std::string& sceneDesc, bool compressTextures)
+    {
+        SnapshotWriter writer(compressTextures);
+        return writer.write(filename, pScene, sceneDesc);
+    }
+
+    bool SceneSnapshot::load(const std::string& fullpath, Model::LoadFlags modelLoadFlags, Scene& scene, std::vector<Scene::ModelInstance::SharedPtr>& instances, std::string& sceneDesc)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        MappedFile file(fullpath);
+        if(file.pData == nullptr || file.size < sizeof(Header))
+        {
+            logError("Can't load scene snapshot '" + fullpath + "'. The file can't be read.");
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, file.pData, sizeof(Header));
+        if(header.magic != kMagic || header.version != kVersion)
+        {
+            logError("Can't load scene snapshot '" + fullpath + "'. The file is not a snapshot, or was written by a different version. Export the snapshot again.");
+            return false;
+        }
+        if(header.metadataOffset > file.size || header.metadataSize > file.size - header.metadataOffset || header.dataOffset > file.size || header.dataSize > file.size - header.dataOffset)
+        {
+            logError("Can't load scene snapshot '" + fullpath + "'. The file is truncated.");
+            return false;
+        }
+
+        MetadataReader reader(file.pData + header.metadataOffset, (size_t)header.metadataSize);
+        const uint8_t* pBlobData = file.pData + header.dataOffset;
+
+        // Returns a pointer to the next blob in the mapped file, or nullptr if it doesn't have the expected size
+        auto readBlob = [&](uint64_t expectedSize) -> const void*
+        {
+            Blob blob = reader.read<Blob>();
+            if(reader.isValid() == false || blob.size != expectedSize || blob.offset > header.dataSize || blob.size > header.dataSize - blob.offset)
+            {
+                reader.invalidate();
+                return nullptr;
+            }
+            return pBlobData + blob.offset;
+        };
+
+        // Resolves an index into one of the resource tables
+        auto lookup = [&reader](const auto& table, int32_t index)
+        {
+            using ElementType = typename std::decay<decltype(table)>::type::value_type;
+            if(index == kNone) return ElementType();
+            if(index < 0 || index >= (int32_t)table.size()) { reader.invalidate(); return ElementType(); }
+            return table[index];
+        };
+
+        sceneDesc = reader.readString();
+
+        // The resources are created straight from the mapped file
+        std::vector<Buffer::SharedPtr> buffers(reader.readSectionCount());
+        uint64_t bufferBytes = 0;
+        for(auto& pBuffer : buffers)
+        {
+            uint64_t size = reader.read<uint64_t>();
+            Resource::BindFlags bindFlags = (Resource::BindFlags)reader.read<uint32_t>();
+            if(is_set(modelLoadFlags, Model::LoadFlags::BuffersAsShaderResource))
+            {
+                bindFlags |= Resource::BindFlags::ShaderResource;
+            }
+            const void* pData = readBlob(size);
+            if(pData == nullptr) break;
+            pBuffer = Buffer::create((size_t)size, bindFlags, Buffer::CpuAccess::None, pData);
+            bufferBytes += size;
+        }
+
+        std::vector<Texture::SharedPtr> textures(reader.readSectionCount());
+        uint64_t textureBytes = 0;
+        for(auto& pTexture : textures)
+        {
+            uint32_t format = reader.read<uint32_t>();
+            uint32_t width = reader.read<uint32_t>();
+            uint32_t height = reader.read<uint32_t>();
+            uint32_t mipLevels = reader.read<uint32_t>();
+            std::string sourceFilename = reader.readString();
+            if(format == 0 || format >= (uint32_t)ResourceFormat::Count || width == 0 || height == 0 || mipLevels == 0 || mipLevels > 32)
+            {
+                reader.invalidate();
+                break;
+            }
+            uint64_t size = getMipChainSize((ResourceFormat)format, width, height, mipLevels);
+            const void* pData = readBlob(size);
+            if(pData == nullptr) break;
+            pTexture = Texture::create2D(width, height, (ResourceFormat)format, 1, mipLevels, pData);
+            if(pTexture) pTexture->setSourceFilename(sourceFilename);
+            textureBytes += size;
+        }
+
+        std::vector<Material::SharedPtr> materials(reader.readSectionCount());
+        for(auto& pMaterial : materials)
+        {
+            pMaterial = Material::create(reader.readString());
+            pMaterial->setShadingModel(reader.read<uint32_t>());
+            pMaterial->setAlphaMode(reader.read<uint32_t>());
+            pMaterial->setDoubleSided(reader.read<uint32_t>() != 0);
+            pMaterial->setBaseColor(reader.read<vec4>());
+            pMaterial->setSpecularParams(reader.read<vec4>());
+            pMaterial->setEmissiveColor(reader.read<vec3>());
+            pMaterial->setAlphaThreshold(reader.read<float>());
+            pMaterial->setIndexOfRefraction(reader.read<float>());
+            float heightScale = reader.read<float>();
+            float heightOffset = reader.read<float>();
+            pMaterial->setHeightScaleOffset(heightScale, heightOffset);
+
+            Texture::SharedPtr pBaseColor = lookup(textures, reader.read<int32_t>());
+            pMaterial->setBaseColorTexture(pBaseColor);
+            pMaterial->setSpecularTexture(lookup(textures, reader.read<int32_t>()));
+            pMaterial->setEmissiveTexture(lookup(textures, reader.read<int32_t>()));
+            pMaterial->setNormalMap(lookup(textures, reader.read<int32_t>()));
+            pMaterial->setOcclusionMap(lookup(textures, reader.read<int32_t>()));
+            pMaterial->setLightMap(lookup(textures, reader.read<int32_t>()));
+            pMaterial->setHeightMap(lookup(textures, reader.read<int32_t>()));
+            if(reader.isValid() == false) break;
+        }
+
+        const uint32_t modelCount = reader.readSectionCount();
+        for(uint32_t modelID = 0; modelID < modelCount && reader.isValid(); modelID++)
+        {
+            Model::SharedPtr pModel = Model::create();
+            pModel->setName(reader.readString());
+            pModel->setFilename(reader.readString());
+
+            std::vector<Mesh::SharedPtr> meshes(reader.readCount());
+            for(auto& pMesh : meshes)
+            {
+                uint32_t vertexCount = reader.read<uint32_t>();
+                uint32_t indexCount = reader.read<uint32_t>();
+                Vao::Topology topology = (Vao::Topology)reader.read<uint32_t>();
+                Material::SharedPtr pMaterial = lookup(materials, reader.read<int32_t>());
+                BoundingBox boundingBox = reader.read<BoundingBox>();
+                Mesh::VertexQuantization quantization = reader.read<Mesh::VertexQuantization>();
+
+                VertexLayout::SharedPtr pLayout = VertexLayout::create();
+                Vao::BufferVec vertexBuffers(reader.readCount());
+                for(uint32_t i = 0; i < (uint32_t)vertexBuffers.size() && reader.isValid(); i++)
+                {
+                    int32_t bufferIndex = reader.read<int32_t>();
+                    if(bufferIndex == kNone) continue;
+                    vertexBuffers[i] = lookup(buffers, bufferIndex);
+
+                    VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+                    const uint32_t elementCount = reader.readCount();
+                    for(uint32_t e = 0; e < elementCount; e++)
+                    {
+                        std::string name = reader.readString();
+                        uint32_t offset = reader.read<uint32_t>();
+                        ResourceFormat format = (ResourceFormat)reader.read<uint32_t>();
+                        uint32_t arraySize = reader.read<uint32_t>();
+                        uint32_t shaderLocation = reader.read<uint32_t>();
+                        pBufferLayout->addElement(name, offset, format, arraySize, shaderLocation);
+                    }
+                    VertexBufferLayout::InputClass inputClass = (VertexBufferLayout::InputClass)reader.read<uint32_t>();
+                    pBufferLayout->setInputClass(inputClass, reader.read<uint32_t>());
+                    pLayout->addBufferLayout(i, pBufferLayout);
+                }
+                Buffer::SharedPtr pIndexBuffer = lookup(buffers, reader.read<int32_t>());
+
+                std::shared_ptr<MeshletData> pMeshlets;
+                if(reader.read<uint32_t>())
+                {
+                    pMeshlets = std::make_shared<MeshletData>();
+                    reader.readVector(pMeshlets->meshlets);
+                    reader.readVector(pMeshlets->vertices);
+                    reader.readVector(pMeshlets->primitiveIndices);
+                }
+
+                if(reader.isValid() == false || pMaterial == nullptr || pIndexBuffer == nullptr) break;
+                pMesh = Mesh::create(vertexBuffers, vertexCount, pIndexBuffer, indexCount, pLayout, topology, pMaterial, boundingBox, false);
+                pMesh->mVertexQuantization = quantization;
+                pMesh->mpMeshlets = pMeshlets;
+            }
+
+            const uint32_t meshInstanceCount = reader.readCount();
+            for(uint32_t i = 0; i < meshInstanceCount && reader.isValid(); i++)
+            {
+                uint32_t meshID = reader.read<uint32_t>();
+                glm::mat4 transform = reader.read<glm::mat4>();
+                if(meshID >= meshes.size() || meshes[meshID] == nullptr)
+                {
+                    reader.invalidate();
+                    break;
+                }
+                pModel->addMeshInstance(meshes[meshID], transform);
+            }
+            if(reader.isValid() == false) break;
+            pModel->calculateModelProperties();
+
+            const uint32_t instanceCount = reader.readCount();
+            for(uint32_t i = 0; i < instanceCount && reader.isValid(); i++)
+            {
+                std::string name = reader.readString();
+                glm::vec3 translation = reader.read<glm::vec3>();
+                glm::vec3 rotation = reader.read<glm::vec3>();
+                glm::vec3 scaling = reader.read<glm::vec3>();
+                auto pInstance = Scene::ModelInstance::create(pModel, translation, rotation, scaling, name);
+                scene.addModelInstance(pInstance);
+                instances.push_back(pInstance);
+            }
+        }
+
+        Texture::SharedPtr pEnvMap = lookup(textures, reader.read<int32_t>());
+        if(pEnvMap) scene.setEnvironmentMap(pEnvMap);
+
+        if(reader.isValid() == false)
+        {
+            logError("Can't load scene snapshot '" + fullpath + "'. The file is corrupt.");
+            return false;
+        }
+
+        // Wait for the uploads, so that the logged time is the time until the scene can be rendered
+        float createTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        gpDevice->getRenderContext()->flush(true);
+        float totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        const float kMB = 1.0f / (1024 * 1024);
+        std::string msg = "SceneSnapshot: Loaded '" + fullpath + "' in " + std::to_string(totalTime) + "ms (" + std::to_string(createTime) + "ms to create the resources, ";
+        msg += std::to_string(totalTime - createTime) + "ms to finish the uploads). " + std::to_string(modelCount) + " models, ";
+        msg += std::to_string(buffers.size()) + " buffers (" + std::to_string(bufferBytes * kMB) + "MB), " + std::to_string(textures.size()) + " textures (" + std::to_string(textureBytes * kMB) + "MB).";
+        logInfo(msg);
+        return true;
+    }
+}
@@ -0,0 +1,206 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Scene.h"
+
+namespace Falcor
+{
+    /** Binary scene snapshots, for near-instant scene startup.
+        A snapshot holds the GPU-ready data of a scene: the vertex and index buffers of its meshes, the meshlets and quantization parameters,
+        the materials and their textures with the full mip chains (color textures optionally block-compressed), and the instances of the models.
+        Lights, cameras, paths and the global settings are embedded as a scene description in the same format SceneExporter writes.
+        Data blobs start on page boundaries, so the loader maps the file and passes the blobs straight to the upload of the GPU resources, without parsing or processing.
+
+        Animated and skinned models can't be stored this way. They are stored by filename and loaded through the model importers.
+        Snapshots are written by SceneExporter::saveSnapshot() and loaded by Scene::loadFromFile() when the file has the snapshot extension.
+    */
+    class SceneSnapshot
+    {
+    public:
+        static const char* kFileExtension;
+
+        /** Check whether a model's data can be stored in a snapshot. Models which can't are stored by filename.
+        */
+        static bool canEmbedModel(const Model* pModel);
+
+        /** Write a snapshot
+            \param[in] filename Output filename
+            \param[in] pScene The scene
+            \param[in] sceneDesc The scene description of everything but the embedded models, see SceneExporter::saveSnapshot()
+            \param[in] compressTextures Whether to block-compress 8-bit color textures (BC1, or BC3 when they have alpha)
+            \return Whether the file was written
+        */
+        static bool save(const std::string& filename, const Scene::SharedPtr& pScene, const std::string& sceneDesc, bool compressTextures);
+
+        /** Create the embedded models of a snapshot and add their instances to a scene.
+            \param[in] fullpath Full path of the snapshot
+            \param[in] modelLoadFlags Only Model::LoadFlags::BuffersAsShaderResource is used. The rest of the flags were applied when the snapshot's models were loaded.
+            \param[in] scene The scene to add the model instances and the environment map to
+            \param[out] instances The created model instances
+            \param[out] sceneDesc The embedded scene description
+            \return Whether the snapshot was read. Logs an error if it wasn't.
+        */
+        static bool load(const std::string& fullpath, Model::LoadFlags modelLoadFlags, Scene& scene, std::vector<Scene::ModelInstance::SharedPtr>& instances, std::string& sceneDesc);
+
+        static const uint32_t kVersion = 1;
+        static const uint32_t kPageSize = 4096;     ///< Alignment of the data blobs in the file
+        static const size_t kArrayAlignment = 8;    ///< Alignment of the arrays in the metadata
+
+        /** Size of a 2D texture's mip chain, with the mips tightly packed one after the other. Block-compressed mips are rounded up to whole blocks.
+        */
+        static uint64_t getMipChainSize(ResourceFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+        /** Writes the metadata of a snapshot: values, and arrays which start on kArrayAlignment boundaries
+        */
+        class MetadataWriter
+        {
+        public:
+            template<typename T>
+            void write(const T& val)
+            {
+                const uint8_t* pBytes = (const uint8_t*)&val;
+                mData.insert(mData.end(), pBytes, pBytes + sizeof(T));
+            }
+
+            template<typename T>
+            void writeArray(const T* pData, uint32_t count)
+            {
+                write(count);
+                if(count == 0) return;
+                mData.resize(align_to(kArrayAlignment, mData.size()));
+                const uint8_t* pBytes = (const uint8_t*)pData;
+                mData.insert(mData.end(), pBytes, pBytes + sizeof(T) * count);
+            }
+
+            template<typename T>
+            void writeVector(const std::vector<T>& vec) { writeArray(vec.data(), (uint32_t)vec.size()); }
+
+            void writeString(const std::string& str) { writeArray(str.data(), (uint32_t)str.size()); }
+
+            /** Appends a section written by another writer. The section starts on an array boundary, so that its arrays stay aligned.
+            */
+            void writeSection(uint32_t count, const MetadataWriter& section)
+            {
+                write(count);
+                mData.resize(align_to(kArrayAlignment, mData.size()));
+                mData.insert(mData.end(), section.mData.begin(), section.mData.end());
+            }
+
+            const std::vector<uint8_t>& getData() const { return mData; }
+
+        private:
+            std::vector<uint8_t> mData;
+        };
+
+        /** Reads the metadata from the mapped file. Any read past the end of the metadata marks the reader as invalid.
+        */
+        class MetadataReader
+        {
+        public:
+            MetadataReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            template<typename T>
+            T read()
+            {
+                T val = T();
+                if(sizeof(T) > mSize - mOffset) { mValid = false; return val; }
+                std::memcpy(&val, mpData + mOffset, sizeof(T));
+                mOffset += sizeof(T);
+                return val;
+            }
+
+            template<typename T>
+            void readVector(std::vector<T>& vec)
+            {
+                uint32_t count;
+                const uint8_t* pSrc = readArrayData(count, sizeof(T));
+                vec.resize(count);
+                if(count) std::memcpy(vec.data(), pSrc, sizeof(T) * count);
+            }
+
+            std::string readString()
+            {
+                uint32_t length;
+                const char* pSrc = (const char*)readArrayData(length, 1);
+                return length ? std::string(pSrc, length) : std::string();
+            }
+
+            /** Reads the element count of a section and moves to its start, see MetadataWriter::writeSection()
+            */
+            uint32_t readSectionCount()
+            {
+                uint32_t count = readCount();
+                size_t padding = align_to(kArrayAlignment, mOffset) - mOffset;
+                if(padding > mSize - mOffset) { mValid = false; return 0; }
+                mOffset += padding;
+                return count;
+            }
+
+            /** Reads an element count, making sure it isn't larger than what's left of the metadata
+            */
+            uint32_t readCount()
+            {
+                uint32_t count = read<uint32_t>();
+                if(count > mSize - mOffset) { mValid = false; return 0; }
+                return count;
+            }
+
+            void invalidate() { mValid = false; }
+            bool isValid() const { return mValid; }
+
+        private:
+            const uint8_t* readArrayData(uint32_t& count, size_t elementSize)
+            {
+                count = read<uint32_t>();
+                if(count == 0 || mValid == false)
+                {
+                    count = 0;
+                    return nullptr;
+                }
+                size_t padding = align_to(kArrayAlignment, mOffset) - mOffset;
+                if(padding > mSize - mOffset || (uint64_t)count * elementSize > mSize - mOffset - padding)
+                {
+                    mValid = false;
+                    count = 0;
+                    return nullptr;
+                }
+                const uint8_t* pSrc = mpData + mOffset + padding;
+                mOffset += padding + count * elementSize;
+                return pSrc;
+            }
+
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+            bool mValid = true;
+        };
+    };
+}
@@ -27,11 +27,13 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "TextureHelper.h"
+#include "TextureRegistry.h"
 #include "API/Texture.h"
 #include "Utils/Bitmap.h"
 #include "Utils/DDSHeader.h"
 #include "Utils/BinaryFileStream.h"
 #include "Utils/StringUtils.h"
+#include "glm/gtc/packing.hpp"
 #include <cstring>
 
 static const bool kTopDown = true;
@@ -66,7 +68,6 @@ namespace Falcor
         case FORMAT_R16G16B16A16_TYPELESS:
         case FORMAT_R32G32B32_TYPELESS:
         case FORMAT_R32G32B32A32_TYPELESS:
-        case FORMAT_R16G16B16A16_SNORM:
         case FORMAT_R32G32_TYPELESS:
         case FORMAT_R32_FLOAT_X8X24_TYPELESS:
         case FORMAT_X32_TYPELESS_G8X24_UINT:
@@ -126,6 +127,8 @@ namespace Falcor
             return ResourceFormat::RGBA16Float;
         case FORMAT_R16G16B16A16_UNORM:
             return ResourceFormat::RGBA16Unorm;
+        case FORMAT_R16G16B16A16_SNORM:
+            return ResourceFormat::RGBA16Snorm;
         case FORMAT_R16G16B16A16_UINT:
             return ResourceFormat::RGBA16Uint;
         case FORMAT_R16G16B16A16_SINT:
@@ -612,21 +615,21 @@ namespace Falcor
         switch(ddsData.dx10Header.resourceDimension)
         {
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE1D:
-            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+            return TextureRegistry::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE2D:
             if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
             {
                 flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 6 * arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, true);
-                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                return TextureRegistry::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
             }
             else
             {
                 flipData(ddsData, format, ddsData.header.width, ddsData.header.height, arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-                return Texture::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                return TextureRegistry::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
             }
         case DXResourceDimension::RESOURCE_DIMENSION_TEXTURE3D:
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            return TextureRegistry::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
         case DXResourceDimension::RESOURCE_DIMENSION_BUFFER:
         case DXResourceDimension::RESOURCE_DIMENSION_UNKNOWN:
             //these file formats are not supported 
@@ -645,18 +648,18 @@ namespace Falcor
         if(ddsData.header.flags & DdsHeader::kDepthMask)
         {
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            return TextureRegistry::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
         }
         //load the cubemap texture
         else if(ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
         {
-            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            return TextureRegistry::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
         }
         //This is a 2D Texture
         else
         {
             flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 1, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            return TextureRegistry::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), ddsData.data.size(), bindFlags);
         }
 
         should_not_get_here();
@@ -715,17 +718,12 @@ namespace Falcor
             Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
             if(pBitmap)
             {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if(loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
-
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+                return createTextureFromBitmap(*pBitmap, filename, generateMipLevels, loadAsSrgb, bindFlags);
             }
         }
 
-        if (pTex != nullptr)
+        // A texture shared through the registry keeps the name of the file it was first loaded from
+        if (pTex != nullptr && pTex->getSourceFilename().empty())
         {
             pTex->setSourceFilename(stripDataDirectories(filename));
         }
@@ -733,4 +731,84 @@ namespace Falcor
         return pTex;
     }
 #undef no_srgb
+
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap& bitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        ResourceFormat texFormat = bitmap.getFormat();
+        if(loadAsSrgb)
+        {
+            texFormat = linearToSrgbFormat(texFormat);
+        }
+
+        size_t dataSize = (size_t)bitmap.getWidth() * bitmap.getHeight() * getFormatBytesPerBlock(texFormat);
+        Texture::SharedPtr pTex = TextureRegistry::create2D(bitmap.getWidth(), bitmap.getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, bitmap.getData(), dataSize, bindFlags);
+
+        // A texture shared through the registry keeps the name of the file it was first loaded from
+        if (pTex != nullptr && pTex->getSourceFilename().empty())
+        {
+            pTex->setSourceFilename(stripDataDirectories(filename));
+        }
+
+        return pTex;
+    }
+
+    static float srgbToLinear(float v)
+    {
+        return (v <= 0.04045f) ? v / 12.92f : pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+
+    bool decodeTexels(ResourceFormat format, const std::vector<uint8_t>& data, uint32_t texelCount, std::vector<glm::vec4>& texels)
+    {
+        texels.resize(texelCount);
+        switch (format)
+        {
+        case ResourceFormat::RGBA32Float:
+        case ResourceFormat::RGB32Float:
+        {
+            const uint32_t channels = (format == ResourceFormat::RGBA32Float) ? 4 : 3;
+            if (data.size() < (size_t)texelCount * channels * sizeof(float)) return false;
+            const float* pData = (const float*)data.data();
+            for (uint32_t i = 0; i < texelCount; i++)
+            {
+                const float* pTexel = pData + (size_t)i * channels;
+                texels[i] = glm::vec4(pTexel[0], pTexel[1], pTexel[2], (channels == 4) ? pTexel[3] : 1.0f);
+            }
+            return true;
+        }
+        case ResourceFormat::RGBA16Float:
+        {
+            if (data.size() < (size_t)texelCount * 4 * sizeof(uint16_t)) return false;
+            const uint16_t* pData = (const uint16_t*)data.data();
+            for (uint32_t i = 0; i < texelCount; i++)
+            {
+                for (uint32_t c = 0; c < 4; c++) texels[i][c] = glm::unpackHalf1x16(pData[(size_t)i * 4 + c]);
+            }
+            return true;
+        }
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBA8UnormSrgb:
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRA8UnormSrgb:
+        case ResourceFormat::BGRX8Unorm:
+        case ResourceFormat::BGRX8UnormSrgb:
+        {
+            if (data.size() < (size_t)texelCount * 4) return false;
+            const bool bgr = (format != ResourceFormat::RGBA8Unorm && format != ResourceFormat::RGBA8UnormSrgb);
+            const bool srgb = isSrgbFormat(format);
+            const bool hasAlpha = (format != ResourceFormat::BGRX8Unorm && format != ResourceFormat::BGRX8UnormSrgb);
+            for (uint32_t i = 0; i < texelCount; i++)
+            {
+                const uint8_t* pTexel = data.data() + (size_t)i * 4;
+                glm::vec4 texel = glm::vec4(pTexel[0], pTexel[1], pTexel[2], pTexel[3]) / 255.0f;
+                if (bgr) std::swap(texel.x, texel.z);
+                if (srgb) texel = glm::vec4(srgbToLinear(texel.x), srgbToLinear(texel.y), srgbToLinear(texel.z), texel.w);
+                if (!hasAlpha) texel.w = 1.0f;
+                texels[i] = texel;
+            }
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
 }
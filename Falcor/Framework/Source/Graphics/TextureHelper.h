@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "API/Texture.h"
 namespace Falcor
 {
@@ -43,5 +44,24 @@ namespace Falcor
     */
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
 
+    /** Create a new texture object from an image which was already decoded, for example on a worker thread (see Bitmap::createFromFile()).
+        \param[in] bitmap The decoded image. It must have been loaded top-down.
+        \param[in] filename Filename the image was loaded from. Used as the texture's source filename.
+        \param[in] generateMipLevels Whether the mip-chain should be generated
+        \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+        \param[in] bindFlags The bind flags to create the texture with
+    */
+    Texture::SharedPtr createTextureFromBitmap(const Bitmap& bitmap, const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+    /** Decode texels read back with RenderContext::readTextureSubresource() to linear RGBA floats, so they can be filtered on the CPU.
+        Supports RGBA32Float, RGB32Float, RGBA16Float and the 8-bit RGBA/BGRA formats. sRGB formats are converted to linear.
+        \param[in] format Format of the subresource
+        \param[in] data Tightly packed texels
+        \param[in] texelCount Number of texels to decode
+        \param[out] texels The decoded texels
+        \return false if the format isn't supported, e.g. block-compressed formats, or if data is too small
+    */
+    bool decodeTexels(ResourceFormat format, const std::vector<uint8_t>& data, uint32_t texelCount, std::vector<glm::vec4>& texels);
+
     /*! @} */
 }
\ No newline at end of file
@@ -0,0 +1,209 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureRegistry.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/Hasher.h"
+#include "Utils/ParallelFor.h"
+
+namespace Falcor
+{
+    bool TextureRegistry::sEnabled = true;
+    std::mutex TextureRegistry::sMutex;
+    std::unordered_map<uint64_t, TextureRegistry::Entry> TextureRegistry::sEntries;
+    const size_t TextureRegistry::kMinPruneSize;
+    size_t TextureRegistry::sPruneSize = TextureRegistry::kMinPruneSize;
+    TextureRegistry::Stats TextureRegistry::sStats;
+
+    namespace
+    {
+        // Blocks are hashed in chunks of this size in parallel
+        const size_t kChunkSize = 4 * 1024 * 1024;
+    }
+
+    uint64_t TextureRegistry::hash(const void* pData, size_t size, uint64_t seed)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        if (size <= kChunkSize)
+        {
+            return Hasher::hash(pBytes, size, seed);
+        }
+
+        // Hash the chunks in parallel, then hash the chunk hashes
+        uint32_t chunkCount = (uint32_t)((size + kChunkSize - 1) / kChunkSize);
+        std::vector<uint64_t> chunkHashes(chunkCount);
+        parallelFor(chunkCount, [&](uint32_t chunk)
+        {
+            size_t offset = chunk * kChunkSize;
+            chunkHashes[chunk] = Hasher::hash(pBytes + offset, std::min(kChunkSize, size - offset), seed);
+        });
+        return Hasher::hash(chunkHashes.data(), chunkHashes.size() * sizeof(uint64_t), seed ^ (uint64_t)size);
+    }
+
+    TextureRegistry::Stats TextureRegistry::Stats::operator-(const Stats& other) const
+    {
+        Stats s;
+        s.lookupCount = lookupCount - other.lookupCount;
+        s.hitCount = hitCount - other.hitCount;
+        s.hashedBytes = hashedBytes - other.hashedBytes;
+        s.savedBytes = savedBytes - other.savedBytes;
+        s.hashTime = hashTime - other.hashTime;
+        return s;
+    }
+
+    bool TextureRegistry::Desc::operator==(const Desc& other) const
+    {
+        return type == other.type && width == other.width && height == other.height && depth == other.depth && arraySize == other.arraySize &&
+            mipLevels == other.mipLevels && format == other.format && bindFlags == other.bindFlags;
+    }
+
+    Texture::SharedPtr TextureRegistry::createTexture(const Desc& desc, const void* pInitData)
+    {
+        switch (desc.type)
+        {
+        case Resource::Type::Texture1D:
+            return Texture::create1D(desc.width, desc.format, desc.arraySize, desc.mipLevels, pInitData, desc.bindFlags);
+        case Resource::Type::Texture2D:
+            return Texture::create2D(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, pInitData, desc.bindFlags);
+        case Resource::Type::Texture3D:
+            return Texture::create3D(desc.width, desc.height, desc.depth, desc.format, desc.mipLevels, pInitData, desc.bindFlags);
+        case Resource::Type::TextureCube:
+            return Texture::createCube(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, pInitData, desc.bindFlags);
+        default:
+            should_not_get_here();
+            return nullptr;
+        }
+    }
+
+    Texture::SharedPtr TextureRegistry::findOrCreate(const Desc& desc, const void* pInitData, size_t dataSize)
+    {
+        if (sEnabled == false || pInitData == nullptr || desc.bindFlags != Texture::BindFlags::ShaderResource)
+        {
+            return createTexture(desc, pInitData);
+        }
+
+        // The description is part of the key, so identical pixels with a different format or mip count map to different textures
+        const uint32_t descWords[] = { (uint32_t)desc.type, desc.width, desc.height, desc.depth, desc.arraySize, desc.mipLevels, (uint32_t)desc.format };
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        uint64_t key = hash(pInitData, dataSize, Hasher::hash(descWords, sizeof(descWords), 0));
+        float hashTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            sStats.lookupCount++;
+            sStats.hashedBytes += dataSize;
+            sStats.hashTime += hashTime;
+
+            Texture::SharedPtr pTexture = findEntry(key, desc);
+            if (pTexture)
+            {
+                sStats.hitCount++;
+                sStats.savedBytes += dataSize;
+                return pTexture;
+            }
+        }
+
+        // Create and upload the texture without holding the lock, so other threads can create their textures at the same time
+        Texture::SharedPtr pTexture = createTexture(desc, pInitData);
+        if (pTexture == nullptr) return nullptr;
+
+        std::lock_guard<std::mutex> lock(sMutex);
+
+        // Another thread may have created the same texture in the meantime. Keep the one that is already registered, so there is a single copy in use.
+        Texture::SharedPtr pExisting = findEntry(key, desc);
+        if (pExisting)
+        {
+            sStats.hitCount++;
+            return pExisting;
+        }
+
+        sEntries[key] = { desc, pTexture };
+        if (sEntries.size() >= sPruneSize) pruneEntries();
+        return pTexture;
+    }
+
+    Texture::SharedPtr TextureRegistry::findEntry(uint64_t key, const Desc& desc)
+    {
+        auto it = sEntries.find(key);
+        if (it == sEntries.end() || (it->second.desc == desc) == false) return nullptr;
+        return it->second.pTexture.lock();
+    }
+
+    void TextureRegistry::pruneEntries()
+    {
+        for (auto it = sEntries.begin(); it != sEntries.end();)
+        {
+            if (it->second.pTexture.expired()) it = sEntries.erase(it);
+            else ++it;
+        }
+
+        // Prune again once the live entries have doubled, so the cost stays proportional to the number of insertions
+        sPruneSize = std::max(kMinPruneSize, 2 * sEntries.size());
+    }
+
+    Texture::SharedPtr TextureRegistry::create1D(uint32_t width, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags)
+    {
+        return findOrCreate({ Resource::Type::Texture1D, width, 1, 1, arraySize, mipLevels, format, bindFlags }, pInitData, dataSize);
+    }
+
+    Texture::SharedPtr TextureRegistry::create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags)
+    {
+        return findOrCreate({ Resource::Type::Texture2D, width, height, 1, arraySize, mipLevels, format, bindFlags }, pInitData, dataSize);
+    }
+
+    Texture::SharedPtr TextureRegistry::create3D(uint32_t width, uint32_t height, uint32_t depth, ResourceFormat format, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags)
+    {
+        return findOrCreate({ Resource::Type::Texture3D, width, height, depth, 1, mipLevels, format, bindFlags }, pInitData, dataSize);
+    }
+
+    Texture::SharedPtr TextureRegistry::createCube(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags)
+    {
+        return findOrCreate({ Resource::Type::TextureCube, width, height, 1, arraySize, mipLevels, format, bindFlags }, pInitData, dataSize);
+    }
+
+    TextureRegistry::Stats TextureRegistry::getStats()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sStats;
+    }
+
+    std::string TextureRegistry::getReport(const std::string& modelName, const Stats& stats)
+    {
+        char report[256];
+        snprintf(report, sizeof(report), "%u of %u textures shared with already loaded textures, %.1f MB of uploads saved, %.1f MB hashed in %.1f ms",
+            stats.hitCount, stats.lookupCount, double(stats.savedBytes) / (1024.0 * 1024.0), double(stats.hashedBytes) / (1024.0 * 1024.0), stats.hashTime);
+        return "Textures of '" + modelName + "': " + report;
+    }
+
+    void TextureRegistry::clear()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sEntries.clear();
+        sPruneSize = kMinPruneSize;
+    }
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "API/Texture.h"
+
+namespace Falcor
+{
+    /** Process-wide registry of textures created from CPU data, keyed by a hash of the texture's content.
+        The model importers and createTextureFromFile() create their textures through the registry, so a texture used by several models or
+        materials (or stored in several files) is decoded once and uploaded once. Textures are shared by reference and are released when the last
+        user drops them.
+        Only shader-resource textures are shared, since textures that can be written to must stay private to their creator.
+    */
+    class TextureRegistry
+    {
+    public:
+        /** Deduplication statistics
+        */
+        struct Stats
+        {
+            uint32_t lookupCount = 0;       ///< Number of textures requested through the registry
+            uint32_t hitCount = 0;          ///< Number of requests which returned an existing texture
+            uint64_t hashedBytes = 0;       ///< Number of bytes hashed
+            uint64_t savedBytes = 0;        ///< Number of bytes which didn't need to be uploaded, not counting generated mips
+            double hashTime = 0;            ///< Time spent hashing, in milliseconds
+
+            Stats operator-(const Stats& other) const;
+        };
+
+        /** Enable or disable the registry. Enabled by default. When disabled, every request creates a new texture.
+        */
+        static void setEnabled(bool enabled) { sEnabled = enabled; }
+        static bool isEnabled() { return sEnabled; }
+
+        /** Find or create a texture. The arguments match the ones of the Texture create functions, with the size of the initial data added.
+        */
+        static Texture::SharedPtr create1D(uint32_t width, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+        static Texture::SharedPtr create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+        static Texture::SharedPtr create3D(uint32_t width, uint32_t height, uint32_t depth, ResourceFormat format, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+        static Texture::SharedPtr createCube(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pInitData, size_t dataSize, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+        /** Hash a block of memory with a 64-bit xxHash. Blocks larger than a few MB are split into chunks which are hashed in parallel, so the result
+            depends on the chunk size and isn't equal to the reference XXH64 of the block.
+        */
+        static uint64_t hash(const void* pData, size_t size, uint64_t seed = 0);
+
+        /** Get the statistics accumulated since the start of the process
+        */
+        static Stats getStats();
+
+        /** Format the statistics of a model load, for logging
+        */
+        static std::string getReport(const std::string& modelName, const Stats& stats);
+
+        /** Drop all entries. Textures which are still in use are not released.
+        */
+        static void clear();
+
+    private:
+        struct Desc
+        {
+            Resource::Type type;
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t arraySize;
+            uint32_t mipLevels;
+            ResourceFormat format;
+            Texture::BindFlags bindFlags;
+
+            bool operator==(const Desc& other) const;
+        };
+
+        struct Entry
+        {
+            Desc desc;
+            std::weak_ptr<Texture> pTexture;
+        };
+
+        static Texture::SharedPtr findOrCreate(const Desc& desc, const void* pInitData, size_t dataSize);
+        static Texture::SharedPtr createTexture(const Desc& desc, const void* pInitData);
+
+        // These expect sMutex to be held
+        static Texture::SharedPtr findEntry(uint64_t key, const Desc& desc);
+        static void pruneEntries();
+
+        // Entries of released textures are removed when the registry reaches this size
+        static const size_t kMinPruneSize = 256;
+
+        static bool sEnabled;
+        static std::mutex sMutex;
+        static std::unordered_map<uint64_t, Entry> sEntries;
+        static size_t sPruneSize;
+        static Stats sStats;
+    };
+}
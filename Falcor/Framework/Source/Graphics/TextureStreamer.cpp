@@ -0,0 +1,800 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureStreamer.h"
+#include "API/RenderContext.h"
+#include "Graphics/Material/Material.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace Falcor
+{
+    bool TextureStreamer::sEnabled = true;
+    uint64_t TextureStreamer::sUploadBudget = 16 * 1024 * 1024;
+    uint64_t TextureStreamer::sMemoryLimit = 2048ull * 1024 * 1024;
+    TextureStreamer::Stats TextureStreamer::sStats;
+    uint64_t TextureStreamer::sFrame = 0;
+
+    std::unordered_map<std::string, std::shared_ptr<TextureStreamer::Entry>> TextureStreamer::sEntries;
+    std::unordered_map<const Texture*, std::shared_ptr<TextureStreamer::Entry>> TextureStreamer::sTextureMap;
+    std::vector<std::shared_ptr<TextureStreamer::Entry>> TextureStreamer::sUploads;
+    uint64_t TextureStreamer::sResidentBytes = 0;
+
+    bool TextureStreamer::sBatchActive = false;
+    CpuTimer::TimePoint TextureStreamer::sBatchStart;
+    uint32_t TextureStreamer::sBatchCount = 0;
+    uint64_t TextureStreamer::sBatchBytes = 0;
+
+    std::mutex TextureStreamer::sMutex;
+    std::condition_variable TextureStreamer::sCondition;
+    std::deque<std::unique_ptr<TextureStreamer::Job>> TextureStreamer::sJobs;
+    std::vector<std::unique_ptr<TextureStreamer::Job>> TextureStreamer::sCompletedJobs;
+    std::vector<std::thread> TextureStreamer::sWorkers;
+    bool TextureStreamer::sStopWorkers = false;
+
+    namespace
+    {
+        // Mips no larger than this are part of the tail, which is swapped in as soon as the image is decoded
+        const uint32_t kTailSize = 32;
+
+        // Decoded images waiting for room are released when their texture isn't used for this many frames
+        const uint64_t kMaxWaitingFrames = 120;
+
+        // The workers must be joined before the static members are destroyed, in case the application didn't call shutdown()
+        struct WorkerGuard
+        {
+            ~WorkerGuard() { TextureStreamer::shutdown(); }
+        } gWorkerGuard;
+
+        std::string getEntryKey(const std::string& filename, bool srgb)
+        {
+            return filename + (srgb ? "|srgb" : "|linear");
+        }
+
+        uint32_t getMipDim(uint32_t dim, uint32_t mip)
+        {
+            return std::max(dim >> mip, 1u);
+        }
+
+        float srgbToLinear(uint8_t v)
+        {
+            static const std::vector<float> kTable = []()
+            {
+                std::vector<float> table(256);
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    float c = i / 255.0f;
+                    table[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return table;
+            }();
+            return kTable[v];
+        }
+
+        uint8_t linearToSrgb(float v)
+        {
+            float c = (v <= 0.0031308f) ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+            return (uint8_t)std::min(255.0f, c * 255.0f + 0.5f);
+        }
+
+        /** Downsample a mip with a 2x2 box filter. Odd dimensions clamp the last texel.
+        */
+        template<typename T, typename AverageFunc>
+        void downsample(const std::vector<uint8_t>& src, uint32_t width, uint32_t height, uint32_t channels, std::vector<uint8_t>& dst, AverageFunc average)
+        {
+            uint32_t dstWidth = getMipDim(width, 1);
+            uint32_t dstHeight = getMipDim(height, 1);
+            dst.resize((size_t)dstWidth * dstHeight * channels * sizeof(T));
+            const T* pSrc = reinterpret_cast<const T*>(src.data());
+            T* pDst = reinterpret_cast<T*>(dst.data());
+
+            for (uint32_t y = 0; y < dstHeight; y++)
+            {
+                const T* pRow0 = pSrc + (size_t)std::min(y * 2, height - 1) * width * channels;
+                const T* pRow1 = pSrc + (size_t)std::min(y * 2 + 1, height - 1) * width * channels;
+                for (uint32_t x = 0; x < dstWidth; x++)
+                {
+                    uint32_t x0 = std::min(x * 2, width - 1) * channels;
+                    uint32_t x1 = std::min(x * 2 + 1, width - 1) * channels;
+                    for (uint32_t c = 0; c < channels; c++)
+                    {
+                        pDst[((size_t)y * dstWidth + x) * channels + c] = average(pRow0[x0 + c], pRow0[x1 + c], pRow1[x0 + c], pRow1[x1 + c], c);
+                    }
+                }
+            }
+        }
+
+        /** Generate the mip chain of an image on the CPU
+            \return false if the format is not supported
+        */
+        bool generateMips(ResourceFormat format, uint32_t width, uint32_t height, std::vector<std::vector<uint8_t>>& mips)
+        {
+            uint32_t channels = 0;
+            bool isFloat = false;
+            switch (srgbToLinearFormat(format))
+            {
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRX8Unorm:
+                channels = 4;
+                break;
+            case ResourceFormat::RG8Unorm:
+                channels = 2;
+                break;
+            case ResourceFormat::R8Unorm:
+                channels = 1;
+                break;
+            case ResourceFormat::RGBA32Float:
+                channels = 4;
+                isFloat = true;
+                break;
+            case ResourceFormat::RGB32Float:
+                channels = 3;
+                isFloat = true;
+                break;
+            default:
+                return false;
+            }
+
+            // Color channels of sRGB textures are averaged in linear space. Alpha is always linear.
+            uint32_t srgbChannels = isSrgbFormat(format) ? 3 : 0;
+            auto averageUnorm = [srgbChannels](uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint32_t channel) -> uint8_t
+            {
+                if (channel < srgbChannels)
+                {
+                    return linearToSrgb((srgbToLinear(a) + srgbToLinear(b) + srgbToLinear(c) + srgbToLinear(d)) * 0.25f);
+                }
+                return (uint8_t)((a + b + c + d + 2) / 4);
+            };
+            auto averageFloat = [](float a, float b, float c, float d, uint32_t) { return (a + b + c + d) * 0.25f; };
+
+            uint32_t mipCount = 1 + (uint32_t)std::floor(std::log2((float)std::max(width, height)));
+            mips.resize(mipCount);
+            for (uint32_t mip = 1; mip < mipCount; mip++)
+            {
+                uint32_t w = getMipDim(width, mip - 1);
+                uint32_t h = getMipDim(height, mip - 1);
+                if (isFloat)
+                {
+                    downsample<float>(mips[mip - 1], w, h, channels, mips[mip], averageFloat);
+                }
+                else
+                {
+                    downsample<uint8_t>(mips[mip - 1], w, h, channels, mips[mip], averageUnorm);
+                }
+            }
+            return true;
+        }
+
+        uint32_t getTailMip(uint32_t width, uint32_t height, uint32_t mipCount)
+        {
+            uint32_t mip = 0;
+            while (mip + 1 < mipCount && std::max(getMipDim(width, mip), getMipDim(height, mip)) > kTailSize)
+            {
+                mip++;
+            }
+            return mip;
+        }
+    }
+
+    bool TextureStreamer::Policy::selectEvictions(const std::vector<Candidate>& candidates, uint64_t residentBytes, uint64_t memoryLimit, uint64_t frame, std::vector<uint32_t>& victims)
+    {
+        victims.clear();
+        if (residentBytes <= memoryLimit)
+        {
+            return true;
+        }
+
+        // Textures used in the current or previous frame are never evicted
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < (uint32_t)candidates.size(); i++)
+        {
+            if (candidates[i].lastUsedFrame + 1 < frame) order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&candidates](uint32_t a, uint32_t b) { return candidates[a].lastUsedFrame < candidates[b].lastUsedFrame; });
+
+        for (uint32_t i : order)
+        {
+            victims.push_back(i);
+            residentBytes -= std::min(residentBytes, candidates[i].bytes);
+            if (residentBytes <= memoryLimit)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t TextureStreamer::Policy::getUploadRowCount(uint64_t budget, uint64_t uploaded, uint64_t rowBytes, uint32_t rowsLeft)
+    {
+        uint64_t rowsInBudget = (budget > uploaded) ? (budget - uploaded) / rowBytes : 0;
+        if (uploaded == 0)
+        {
+            rowsInBudget = std::max<uint64_t>(rowsInBudget, 1);
+        }
+        return (uint32_t)std::min<uint64_t>(rowsInBudget, rowsLeft);
+    }
+
+    Texture::SharedPtr TextureStreamer::createTexture(const std::string& filename, bool loadAsSrgb, const glm::vec4& placeholderColor)
+    {
+        if (sEnabled == false || hasSuffix(filename, ".dds", false))
+        {
+            return nullptr;
+        }
+
+        std::string key = getEntryKey(filename, loadAsSrgb);
+        auto it = sEntries.find(key);
+        if (it != sEntries.end())
+        {
+            return it->second->pCurrent;
+        }
+
+        // Each entry has its own placeholder, since the texture the users hold identifies the entry
+        uint8_t color[4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            color[c] = (uint8_t)(glm::clamp(placeholderColor[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        Texture::SharedPtr pPlaceholder = Texture::create2D(1, 1, loadAsSrgb ? ResourceFormat::RGBA8UnormSrgb : ResourceFormat::RGBA8Unorm, 1, 1, color);
+        if (pPlaceholder == nullptr)
+        {
+            return nullptr;
+        }
+        pPlaceholder->setSourceFilename(stripDataDirectories(filename));
+
+        auto pEntry = std::make_shared<Entry>();
+        pEntry->filename = filename;
+        pEntry->srgb = loadAsSrgb;
+        pEntry->pCurrent = pPlaceholder;
+        pEntry->lastUsedFrame = sFrame;
+        sEntries[key] = pEntry;
+        sTextureMap[pPlaceholder.get()] = pEntry;
+
+        queue(pEntry, false);
+        return pPlaceholder;
+    }
+
+    bool TextureStreamer::addUser(const Texture* pTexture, Setter setter)
+    {
+        auto it = sTextureMap.find(pTexture);
+        if (it == sTextureMap.end())
+        {
+            return false;
+        }
+        it->second->users.push_back(setter);
+        return true;
+    }
+
+    void TextureStreamer::markUsed(const Material* pMaterial)
+    {
+        if (sTextureMap.empty() || pMaterial == nullptr)
+        {
+            return;
+        }
+
+        const Texture::SharedPtr textures[] =
+        {
+            pMaterial->getBaseColorTexture(),
+            pMaterial->getSpecularTexture(),
+            pMaterial->getEmissiveTexture(),
+            pMaterial->getNormalMap(),
+            pMaterial->getOcclusionMap(),
+            pMaterial->getLightMap(),
+            pMaterial->getHeightMap(),
+        };
+
+        for (const auto& pTexture : textures)
+        {
+            if (pTexture == nullptr) continue;
+            auto it = sTextureMap.find(pTexture.get());
+            if (it == sTextureMap.end()) continue;
+
+            const auto& pEntry = it->second;
+            pEntry->lastUsedFrame = sFrame;
+            if (pEntry->state == State::Evicted && pEntry->fullBytes <= sMemoryLimit)
+            {
+                pEntry->state = State::Queued;
+                queue(pEntry, true);
+            }
+        }
+    }
+
+    void TextureStreamer::queue(const std::shared_ptr<Entry>& pEntry, bool front)
+    {
+        if (sBatchActive == false)
+        {
+            sBatchActive = true;
+            sBatchStart = CpuTimer::getCurrentTimePoint();
+            sBatchCount = 0;
+            sBatchBytes = 0;
+        }
+
+        auto pJob = std::make_unique<Job>();
+        pJob->filename = pEntry->filename;
+        pJob->srgb = pEntry->srgb;
+        pJob->pEntry = pEntry;
+
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            if (sWorkers.empty())
+            {
+                // Leave a core for the render thread
+                uint32_t workerCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency() - 1));
+                for (uint32_t i = 0; i < workerCount; i++)
+                {
+                    sWorkers.emplace_back(workerLoop);
+                }
+            }
+
+            if (front)
+            {
+                sJobs.push_front(std::move(pJob));
+            }
+            else
+            {
+                sJobs.push_back(std::move(pJob));
+            }
+        }
+        sCondition.notify_one();
+    }
+
+    void TextureStreamer::workerLoop()
+    {
+        while (true)
+        {
+            std::unique_ptr<Job> pJob;
+            {
+                std::unique_lock<std::mutex> lock(sMutex);
+                sCondition.wait(lock, []() { return sStopWorkers || sJobs.empty() == false; });
+                if (sStopWorkers)
+                {
+                    return;
+                }
+                pJob = std::move(sJobs.front());
+                sJobs.pop_front();
+            }
+
+            // Don't decode images nobody uses anymore
+            if (pJob->pEntry.expired() == false)
+            {
+                pJob->pResult = decode(pJob->filename, pJob->srgb);
+            }
+
+            std::lock_guard<std::mutex> lock(sMutex);
+            sCompletedJobs.push_back(std::move(pJob));
+        }
+    }
+
+    std::unique_ptr<TextureStreamer::DecodedImage> TextureStreamer::decode(const std::string& filename, bool srgb)
+    {
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, true);
+        if (pBitmap == nullptr)
+        {
+            return nullptr;
+        }
+
+        auto pImage = std::make_unique<DecodedImage>();
+        pImage->format = srgb ? linearToSrgbFormat(pBitmap->getFormat()) : pBitmap->getFormat();
+        pImage->width = pBitmap->getWidth();
+        pImage->height = pBitmap->getHeight();
+
+        size_t dataSize = (size_t)pImage->width * pImage->height * getFormatBytesPerBlock(pImage->format);
+        pImage->mips.resize(1);
+        pImage->mips[0].assign(pBitmap->getData(), pBitmap->getData() + dataSize);
+        if (generateMips(pImage->format, pImage->width, pImage->height, pImage->mips) == false)
+        {
+            // The mips will be generated on the GPU
+            pImage->mips.clear();
+            pImage->pBitmap = std::move(pBitmap);
+        }
+        return pImage;
+    }
+
+    void TextureStreamer::swapTexture(const std::shared_ptr<Entry>& pEntry, const Texture::SharedPtr& pTexture)
+    {
+        if (pTexture == nullptr || pTexture == pEntry->pCurrent)
+        {
+            return;
+        }
+
+        sTextureMap.erase(pEntry->pCurrent.get());
+        pEntry->pCurrent = pTexture;
+        sTextureMap[pTexture.get()] = pEntry;
+
+        auto& users = pEntry->users;
+        users.erase(std::remove_if(users.begin(), users.end(), [&pTexture](const Setter& setter) { return setter(pTexture) == false; }), users.end());
+    }
+
+    void TextureStreamer::startUpload(RenderContext* pContext, const std::shared_ptr<Entry>& pEntry, std::unique_ptr<DecodedImage> pDecoded)
+    {
+        Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource;
+
+        if (pDecoded->mips.empty())
+        {
+            // No CPU mips for this format. Upload the entire texture at once and generate the mips on the GPU.
+            const Bitmap* pBitmap = pDecoded->pBitmap.get();
+            Texture::SharedPtr pFull = Texture::create2D(pDecoded->width, pDecoded->height, pDecoded->format, 1, Texture::kMaxPossible, pBitmap->getData(), bindFlags);
+            if (pFull == nullptr)
+            {
+                pEntry->state = State::Failed;
+                return;
+            }
+            pFull->setSourceFilename(stripDataDirectories(pEntry->filename));
+            pEntry->fullBytes = (uint64_t)pDecoded->width * pDecoded->height * getFormatBytesPerBlock(pDecoded->format) * 4 / 3;
+            pEntry->pFull = pFull;
+            pEntry->pTail = pFull;
+            pEntry->state = State::Resident;
+            sResidentBytes += pEntry->fullBytes;
+            sBatchCount++;
+            sBatchBytes += pEntry->fullBytes;
+            swapTexture(pEntry, pFull);
+            return;
+        }
+
+        uint32_t mipCount = (uint32_t)pDecoded->mips.size();
+        uint32_t tailMip = getTailMip(pDecoded->width, pDecoded->height, mipCount);
+
+        pEntry->fullBytes = 0;
+        for (const auto& mip : pDecoded->mips)
+        {
+            pEntry->fullBytes += mip.size();
+        }
+
+        // Create the tail once. Evicted textures keep theirs.
+        if (pEntry->pTail == nullptr)
+        {
+            std::vector<uint8_t> tailData;
+            for (uint32_t mip = tailMip; mip < mipCount; mip++)
+            {
+                tailData.insert(tailData.end(), pDecoded->mips[mip].begin(), pDecoded->mips[mip].end());
+            }
+            pEntry->pTail = Texture::create2D(getMipDim(pDecoded->width, tailMip), getMipDim(pDecoded->height, tailMip), pDecoded->format, 1, mipCount - tailMip, tailData.data(), bindFlags);
+            if (pEntry->pTail == nullptr)
+            {
+                pEntry->state = State::Failed;
+                return;
+            }
+            pEntry->pTail->setSourceFilename(stripDataDirectories(pEntry->filename));
+            swapTexture(pEntry, pEntry->pTail);
+        }
+
+        if (tailMip == 0)
+        {
+            // The image is small enough to be all tail
+            pEntry->pFull = pEntry->pTail;
+            pEntry->state = State::Resident;
+            sResidentBytes += pEntry->fullBytes;
+            sBatchCount++;
+            sBatchBytes += pEntry->fullBytes;
+            return;
+        }
+
+        if (sResidentBytes + pEntry->fullBytes > sMemoryLimit && evictLeastRecentlyUsed(sMemoryLimit - std::min(sMemoryLimit, pEntry->fullBytes), false) == false)
+        {
+            // No room. Keep the decoded image, so that retryWaitingUploads() doesn't need to decode it again once other textures can be evicted.
+            pEntry->pDecoded = std::move(pDecoded);
+            pEntry->state = State::Waiting;
+            return;
+        }
+
+        pEntry->pFull = Texture::create2D(pDecoded->width, pDecoded->height, pDecoded->format, 1, mipCount, nullptr, bindFlags);
+        if (pEntry->pFull == nullptr)
+        {
+            pEntry->state = State::Evicted;
+            return;
+        }
+        pEntry->pFull->setSourceFilename(stripDataDirectories(pEntry->filename));
+
+        // The tail mips are small, upload them right away
+        pEntry->pendingBytes = pEntry->fullBytes;
+        for (uint32_t mip = tailMip; mip < mipCount; mip++)
+        {
+            pContext->updateSubresourceData(pEntry->pFull.get(), pEntry->pFull->getSubresourceIndex(0, mip), pDecoded->mips[mip].data());
+            pEntry->pendingBytes -= pDecoded->mips[mip].size();
+        }
+
+        pEntry->pDecoded = std::move(pDecoded);
+        pEntry->uploadMip = tailMip - 1;
+        pEntry->uploadRow = 0;
+        pEntry->state = State::Uploading;
+        sResidentBytes += pEntry->fullBytes;
+        sUploads.push_back(pEntry);
+    }
+
+    void TextureStreamer::uploadMips(RenderContext* pContext)
+    {
+        uint64_t budget = sUploadBudget;
+        uint64_t uploaded = 0;
+
+        auto it = sUploads.begin();
+        while (it != sUploads.end() && (uploaded < budget || uploaded == 0))
+        {
+            const auto& pEntry = *it;
+            if (pEntry->state != State::Uploading)
+            {
+                it = sUploads.erase(it);
+                continue;
+            }
+
+            const DecodedImage& image = *pEntry->pDecoded;
+            uint32_t mip = pEntry->uploadMip;
+            uint32_t width = getMipDim(image.width, mip);
+            uint32_t height = getMipDim(image.height, mip);
+            uint64_t rowBytes = (uint64_t)width * getFormatBytesPerBlock(image.format);
+
+            uint32_t rowCount = Policy::getUploadRowCount(budget, uploaded, rowBytes, height - pEntry->uploadRow);
+            if (rowCount == 0)
+            {
+                break;
+            }
+            const uint8_t* pData = image.mips[mip].data() + pEntry->uploadRow * rowBytes;
+            uint32_t subresource = pEntry->pFull->getSubresourceIndex(0, mip);
+            if (rowCount == height)
+            {
+                pContext->updateSubresourceData(pEntry->pFull.get(), subresource, pData);
+            }
+            else
+            {
+                pContext->updateSubresourceData(pEntry->pFull.get(), subresource, pData, uvec3(0, pEntry->uploadRow, 0), uvec3(width, rowCount, 1));
+            }
+
+            uploaded += rowCount * rowBytes;
+            pEntry->pendingBytes -= rowCount * rowBytes;
+            pEntry->uploadRow += rowCount;
+            if (pEntry->uploadRow < height)
+            {
+                continue;
+            }
+
+            pEntry->uploadRow = 0;
+            if (mip > 0)
+            {
+                pEntry->uploadMip--;
+                continue;
+            }
+
+            // The full mip chain is uploaded
+            pEntry->pDecoded = nullptr;
+            pEntry->state = State::Resident;
+            sBatchCount++;
+            sBatchBytes += pEntry->fullBytes;
+            swapTexture(pEntry, pEntry->pFull);
+            it = sUploads.erase(it);
+        }
+
+        sStats.uploadedBytes = uploaded;
+    }
+
+    void TextureStreamer::retryWaitingUploads(RenderContext* pContext)
+    {
+        // Textures used in the current or previous frame start their upload, until one doesn't fit
+        bool full = false;
+        for (const auto& e : sEntries)
+        {
+            const auto& pEntry = e.second;
+            if (pEntry->state != State::Waiting) continue;
+
+            if (pEntry->lastUsedFrame + kMaxWaitingFrames < sFrame)
+            {
+                // The texture is decoded again when it's used
+                pEntry->pDecoded = nullptr;
+                pEntry->state = State::Evicted;
+                continue;
+            }
+
+            if (full || pEntry->lastUsedFrame + 1 < sFrame) continue;
+            startUpload(pContext, pEntry, std::move(pEntry->pDecoded));
+            full = (pEntry->state == State::Waiting);
+        }
+    }
+
+    void TextureStreamer::evict(const std::shared_ptr<Entry>& pEntry)
+    {
+        swapTexture(pEntry, pEntry->pTail);
+        pEntry->pFull = nullptr;
+        pEntry->pDecoded = nullptr;
+        pEntry->state = State::Evicted;
+        sResidentBytes -= pEntry->fullBytes;
+        sStats.evictionCount++;
+    }
+
+    void TextureStreamer::getEvictionCandidates(std::vector<std::shared_ptr<Entry>>& entries, std::vector<Policy::Candidate>& candidates)
+    {
+        // Textures which are all tail have nothing to evict
+        for (const auto& e : sEntries)
+        {
+            const auto& pEntry = e.second;
+            if (pEntry->state != State::Resident || pEntry->pFull == pEntry->pTail) continue;
+            entries.push_back(pEntry);
+            candidates.push_back({ pEntry->fullBytes, pEntry->lastUsedFrame });
+        }
+    }
+
+    bool TextureStreamer::evictLeastRecentlyUsed(uint64_t memoryLimit, bool evictIfNoFit)
+    {
+        if (sResidentBytes <= memoryLimit)
+        {
+            return true;
+        }
+
+        std::vector<std::shared_ptr<Entry>> entries;
+        std::vector<Policy::Candidate> candidates;
+        getEvictionCandidates(entries, candidates);
+
+        std::vector<uint32_t> victims;
+        bool fits = Policy::selectEvictions(candidates, sResidentBytes, memoryLimit, sFrame, victims);
+        if (fits || evictIfNoFit)
+        {
+            for (uint32_t i : victims)
+            {
+                evict(entries[i]);
+            }
+        }
+        return fits;
+    }
+
+    void TextureStreamer::removeEntry(const std::string& key)
+    {
+        auto it = sEntries.find(key);
+        const auto& pEntry = it->second;
+        if (pEntry->state == State::Uploading || pEntry->state == State::Resident)
+        {
+            sResidentBytes -= pEntry->fullBytes;
+        }
+
+        // Pending jobs and uploads are discarded when they see the entry is gone
+        pEntry->state = State::Failed;
+        sTextureMap.erase(pEntry->pCurrent.get());
+        sEntries.erase(it);
+    }
+
+    void TextureStreamer::update(RenderContext* pContext)
+    {
+        sFrame++;
+
+        // Release the textures nobody uses. Users which were destroyed are only detected when the texture is swapped, so this is conservative.
+        std::vector<std::string> unused;
+        for (const auto& e : sEntries)
+        {
+            if (e.second->users.empty())
+            {
+                unused.push_back(e.first);
+            }
+        }
+        for (const auto& key : unused)
+        {
+            removeEntry(key);
+        }
+
+        std::vector<std::unique_ptr<Job>> completedJobs;
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            completedJobs.swap(sCompletedJobs);
+        }
+
+        for (auto& pJob : completedJobs)
+        {
+            auto pEntry = pJob->pEntry.lock();
+            if (pEntry == nullptr || pEntry->state != State::Queued)
+            {
+                continue;
+            }
+
+            if (pJob->pResult == nullptr)
+            {
+                logWarning("TextureStreamer: Can't decode '" + pJob->filename + "'. The placeholder will be used instead.");
+                pEntry->state = State::Failed;
+                continue;
+            }
+            startUpload(pContext, pEntry, std::move(pJob->pResult));
+        }
+
+        if (sResidentBytes > sMemoryLimit)
+        {
+            evictLeastRecentlyUsed(sMemoryLimit, true);
+        }
+
+        retryWaitingUploads(pContext);
+        uploadMips(pContext);
+
+        sStats.textureCount = (uint32_t)sEntries.size();
+        sStats.residentCount = 0;
+        sStats.pendingCount = 0;
+        sStats.waitingCount = 0;
+        sStats.pendingBytes = 0;
+        for (const auto& e : sEntries)
+        {
+            const auto& pEntry = e.second;
+            switch (pEntry->state)
+            {
+            case State::Resident:
+                sStats.residentCount++;
+                break;
+            case State::Queued:
+                sStats.pendingCount++;
+                break;
+            case State::Uploading:
+                sStats.pendingCount++;
+                sStats.pendingBytes += pEntry->pendingBytes;
+                break;
+            case State::Waiting:
+                sStats.waitingCount++;
+                break;
+            default:
+                break;
+            }
+        }
+        sStats.residentBytes = sResidentBytes;
+        sStats.uploadBudget = sUploadBudget;
+
+        if (sBatchActive && sStats.pendingCount == 0)
+        {
+            sBatchActive = false;
+            double ms = CpuTimer::calcDuration(sBatchStart, CpuTimer::getCurrentTimePoint());
+            logInfo("TextureStreamer: Streamed " + std::to_string(sBatchCount) + " textures (" + std::to_string(sBatchBytes / (1024 * 1024)) + "MB) in " + std::to_string(ms) + " ms");
+        }
+    }
+
+    std::string TextureStreamer::getStatsString()
+    {
+        const uint64_t kMB = 1024 * 1024;
+        std::stringstream s;
+        s << "Streamed textures: " << sStats.textureCount << " (" << sStats.residentCount << " resident, " << sStats.pendingCount << " pending, " << sStats.waitingCount << " waiting for room)\n";
+        s << "Pending uploads: " << sStats.pendingBytes / kMB << "MB\n";
+        s << "Uploaded: " << sStats.uploadedBytes / kMB << "MB of " << sStats.uploadBudget / kMB << "MB budget\n";
+        s << "Resident: " << sStats.residentBytes / kMB << "MB of " << sMemoryLimit / kMB << "MB limit, " << sStats.evictionCount << " evictions\n";
+        return s.str();
+    }
+
+    void TextureStreamer::shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sMutex);
+            sStopWorkers = true;
+        }
+        sCondition.notify_all();
+        for (auto& worker : sWorkers)
+        {
+            worker.join();
+        }
+        sWorkers.clear();
+        sJobs.clear();
+        sCompletedJobs.clear();
+        sStopWorkers = false;
+
+        sUploads.clear();
+        sTextureMap.clear();
+        sEntries.clear();
+        sResidentBytes = 0;
+        sBatchActive = false;
+        sStats = Stats();
+    }
+}
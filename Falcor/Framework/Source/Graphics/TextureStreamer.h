@@ -0,0 +1,245 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "API/Texture.h"
+#include "Utils/Bitmap.h"
+#include "Utils/CpuTimer.h"
+
+namespace Falcor
+{
+    class Material;
+    class RenderContext;
+
+    /** Streams textures in the background, so that loading a scene doesn't wait for its textures to be decoded and uploaded.
+        createTexture() returns a 1x1 placeholder immediately. Worker threads decode the image and generate its mips on the CPU. update(), which
+        Sample calls once per frame, then swaps in a small texture made of the mip tail, and uploads the full mip chain within a per-frame budget,
+        smallest mips first, in strips of rows. Once the full texture is uploaded it replaces the tail.
+        Users of a streamed texture register a callback with addUser(), which is how the texture they hold is replaced. The model importers do
+        this for the materials of models loaded with Model::LoadFlags::StreamTextures.
+        When the full-resolution textures exceed the memory limit, the least recently used ones are evicted back to their mip tail. SceneRenderer
+        and RtSceneRenderer report which textures are used with markUsed(). Evicted textures are streamed in again the next time they are used.
+        Decoded textures which don't fit under the limit keep their decoded image and wait until they do.
+    */
+    class TextureStreamer
+    {
+    public:
+        /** Called with the texture which replaces the one the user holds. Return false if the user doesn't exist anymore.
+        */
+        using Setter = std::function<bool(const Texture::SharedPtr& pTexture)>;
+
+        struct Stats
+        {
+            uint32_t textureCount = 0;      ///< Number of streamed textures
+            uint32_t residentCount = 0;     ///< Number of textures with their full mip chain resident
+            uint32_t pendingCount = 0;      ///< Number of textures waiting to be decoded or uploaded
+            uint32_t waitingCount = 0;      ///< Number of decoded textures waiting for room under the memory limit
+            uint64_t pendingBytes = 0;      ///< Bytes decoded but not uploaded yet
+            uint64_t residentBytes = 0;     ///< Memory of the full-resolution textures, including the ones being uploaded
+            uint64_t uploadedBytes = 0;     ///< Bytes uploaded by the last update()
+            uint64_t uploadBudget = 0;      ///< The per-frame upload budget
+            uint64_t evictionCount = 0;     ///< Number of evictions since the start of the process
+        };
+
+        /** The eviction and upload budget rules, without the textures, so that they can be tested on the CPU
+        */
+        struct Policy
+        {
+            /** A resident texture which can be evicted
+            */
+            struct Candidate
+            {
+                uint64_t bytes;             ///< Size of the full mip chain
+                uint64_t lastUsedFrame;
+            };
+
+            /** Pick the least recently used textures to evict until the resident memory fits a limit. Textures used in the current or previous frame are never evicted.
+                \param[in] candidates The resident textures which can be evicted
+                \param[in] residentBytes Memory of all the full-resolution textures
+                \param[in] memoryLimit The memory to fit in
+                \param[in] frame The current frame
+                \param[out] victims Indices of the candidates to evict, least recently used first. If the memory can't fit, all the candidates which can be evicted.
+                \return Whether the memory fits after evicting the victims
+            */
+            static bool selectEvictions(const std::vector<Candidate>& candidates, uint64_t residentBytes, uint64_t memoryLimit, uint64_t frame, std::vector<uint32_t>& victims);
+
+            /** Get the number of rows of a mip to upload next
+                \param[in] budget The per-frame upload budget
+                \param[in] uploaded Bytes already uploaded in this frame
+                \param[in] rowBytes Size of a row of the mip
+                \param[in] rowsLeft Rows of the mip which aren't uploaded yet
+                \return The rows which fit in the rest of the budget. At least one if nothing was uploaded in this frame yet, so that rows larger than the budget make progress.
+            */
+            static uint32_t getUploadRowCount(uint64_t budget, uint64_t uploaded, uint64_t rowBytes, uint32_t rowsLeft);
+        };
+
+        /** Enable or disable streaming. Enabled by default. When disabled, createTexture() returns nullptr, and the caller loads the texture itself.
+        */
+        static void setEnabled(bool enabled) { sEnabled = enabled; }
+        static bool isEnabled() { return sEnabled; }
+
+        /** Set the number of bytes update() uploads per frame. Defaults to 16MB. At least one row is uploaded per frame, even if it's larger.
+        */
+        static void setUploadBudget(uint64_t bytesPerFrame) { sUploadBudget = bytesPerFrame; }
+        static uint64_t getUploadBudget() { return sUploadBudget; }
+
+        /** Set the memory limit for the full-resolution textures. Defaults to 2GB.
+        */
+        static void setMemoryLimit(uint64_t bytes) { sMemoryLimit = bytes; }
+        static uint64_t getMemoryLimit() { return sMemoryLimit; }
+
+        /** Start streaming a texture from an image file. Files which are already streamed with the same color space return the texture their users currently hold.
+            \param[in] filename The image's full path. DDS files are not streamed, since they already contain compressed mips.
+            \param[in] loadAsSrgb Whether to interpret the image as sRGB data
+            \param[in] placeholderColor Color of the placeholder shown until the mip tail is decoded
+            \return The texture to use until the streamer replaces it, or nullptr if the file can't be streamed. Register the users with addUser() before the next update().
+        */
+        static Texture::SharedPtr createTexture(const std::string& filename, bool loadAsSrgb, const glm::vec4& placeholderColor);
+
+        /** Register a user of a streamed texture
+            \param[in] pTexture The texture the user holds, as returned by createTexture()
+            \param[in] setter Called whenever the texture is replaced
+            \return Whether the texture is streamed. If not, the setter is not stored.
+        */
+        static bool addUser(const Texture* pTexture, Setter setter);
+
+        /** Mark the streamed textures of a material as used in the current frame
+        */
+        static void markUsed(const Material* pMaterial);
+
+        /** Swap in decoded textures, upload mips within the budget and evict textures over the memory limit. Call once per frame.
+        */
+        static void update(RenderContext* pContext);
+
+        /** Get the statistics of the last update()
+        */
+        static const Stats& getStats() { return sStats; }
+
+        /** Format the statistics, for display
+        */
+        static std::string getStatsString();
+
+        /** Stop the worker threads and release all textures
+        */
+        static void shutdown();
+
+    private:
+        enum class State
+        {
+            Queued,         ///< Waiting for a worker, or being decoded
+            Uploading,      ///< The tail is resident, the full texture is being uploaded
+            Resident,       ///< The full texture is resident
+            Waiting,        ///< Decoded, but the full texture doesn't fit under the memory limit yet. Only the tail is resident.
+            Evicted,        ///< Only the tail is resident
+            Failed,         ///< The image can't be decoded. Users keep the placeholder.
+        };
+
+        /** The output of a worker
+        */
+        struct DecodedImage
+        {
+            ResourceFormat format = ResourceFormat::Unknown;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<std::vector<uint8_t>> mips;     ///< Empty if the format doesn't support mip generation on the CPU. The bitmap is kept instead.
+            Bitmap::UniqueConstPtr pBitmap;
+        };
+
+        struct Entry
+        {
+            std::string filename;
+            bool srgb = false;
+            State state = State::Queued;
+            std::vector<Setter> users;
+
+            Texture::SharedPtr pCurrent;                ///< The texture the users hold
+            Texture::SharedPtr pTail;
+            Texture::SharedPtr pFull;
+            std::unique_ptr<DecodedImage> pDecoded;     ///< Kept until the full texture is uploaded, or while it waits for room
+            uint32_t uploadMip = 0;                     ///< The mip being uploaded
+            uint32_t uploadRow = 0;                     ///< The first row of the mip which isn't uploaded yet
+            uint64_t fullBytes = 0;                     ///< Size of the full mip chain
+            uint64_t pendingBytes = 0;                  ///< Bytes of the full mip chain which aren't uploaded yet
+            uint64_t lastUsedFrame = 0;
+        };
+
+        struct Job
+        {
+            std::string filename;
+            bool srgb;
+            std::weak_ptr<Entry> pEntry;
+            std::unique_ptr<DecodedImage> pResult;
+        };
+
+        static void workerLoop();
+        static std::unique_ptr<DecodedImage> decode(const std::string& filename, bool srgb);
+        static void queue(const std::shared_ptr<Entry>& pEntry, bool front);
+        static void swapTexture(const std::shared_ptr<Entry>& pEntry, const Texture::SharedPtr& pTexture);
+        static void startUpload(RenderContext* pContext, const std::shared_ptr<Entry>& pEntry, std::unique_ptr<DecodedImage> pDecoded);
+        static void uploadMips(RenderContext* pContext);
+        static void retryWaitingUploads(RenderContext* pContext);
+        static void evict(const std::shared_ptr<Entry>& pEntry);
+        static bool evictLeastRecentlyUsed(uint64_t memoryLimit, bool evictIfNoFit);
+        static void getEvictionCandidates(std::vector<std::shared_ptr<Entry>>& entries, std::vector<Policy::Candidate>& candidates);
+        static void removeEntry(const std::string& key);
+
+        static bool sEnabled;
+        static uint64_t sUploadBudget;
+        static uint64_t sMemoryLimit;
+        static Stats sStats;
+        static uint64_t sFrame;
+
+        // Render thread state
+        static std::unordered_map<std::string, std::shared_ptr<Entry>> sEntries;       ///< Keyed by filename and color space
+        static std::unordered_map<const Texture*, std::shared_ptr<Entry>> sTextureMap;  ///< The texture the users of an entry hold, to the entry
+        static std::vector<std::shared_ptr<Entry>> sUploads;                            ///< Entries being uploaded, in order
+        static uint64_t sResidentBytes;
+
+        // Textures queued since the streamer was last idle, to log how long it took to stream them
+        static bool sBatchActive;
+        static CpuTimer::TimePoint sBatchStart;
+        static uint32_t sBatchCount;
+        static uint64_t sBatchBytes;
+
+        // Shared with the workers
+        static std::mutex sMutex;
+        static std::condition_variable sCondition;
+        static std::deque<std::unique_ptr<Job>> sJobs;
+        static std::vector<std::unique_ptr<Job>> sCompletedJobs;
+        static std::vector<std::thread> sWorkers;
+        static bool sStopWorkers;
+    };
+}
@@ -0,0 +1,185 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BlasGrouping.h"
+#include <unordered_map>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Rough BLAS sizes of current drivers, before compaction
+        const uint64_t kResultBytesPerPrimitive = 64;
+        const uint64_t kScratchBytesPerPrimitive = 32;
+        const uint64_t kBytesPerBlas = 4096;
+
+        /** The meshes with the same key can share a BLAS
+        */
+        struct GroupKey
+        {
+            glm::mat4 transform;
+            bool isSkinned;
+            bool doubleSided;
+
+            bool operator==(const GroupKey& other) const
+            {
+                return transform == other.transform && isSkinned == other.isSkinned && doubleSided == other.doubleSided;
+            }
+        };
+
+        struct GroupKeyHash
+        {
+            size_t operator()(const GroupKey& key) const
+            {
+                // FNV-1a over the matrix. Zeros are hashed as +0, since -0 compares equal to it.
+                uint64_t hash = 14695981039346656037ull;
+                auto add = [&hash](uint32_t value) { hash = (hash ^ value) * 1099511628211ull; };
+                const float* pValues = &key.transform[0][0];
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    uint32_t bits = 0;
+                    if (pValues[i] != 0.0f) memcpy(&bits, &pValues[i], sizeof(bits));
+                    add(bits);
+                }
+                add((key.isSkinned ? 2 : 0) | (key.doubleSided ? 1 : 0));
+                return (size_t)hash;
+            }
+        };
+
+        struct Bucket
+        {
+            bool isSkinned;
+            std::vector<uint32_t> meshes;
+        };
+    }
+
+    uint64_t BlasGrouping::estimateBuildBytes(uint64_t primitiveCount)
+    {
+        return kBytesPerBlas + primitiveCount * (kResultBytesPerPrimitive + kScratchBytesPerPrimitive);
+    }
+
+    BlasGrouping::Result BlasGrouping::group(const std::vector<MeshDesc>& meshes, uint32_t maxMergedPrimitives, uint32_t largeMeshPrimitives)
+    {
+        // Bucket the meshes which can share a BLAS, in order of first appearance
+        std::unordered_map<GroupKey, uint32_t, GroupKeyHash> bucketMap;
+        std::vector<Bucket> buckets;
+        std::vector<uint32_t> instanced;
+        for (uint32_t i = 0; i < (uint32_t)meshes.size(); i++)
+        {
+            const MeshDesc& mesh = meshes[i];
+            if (mesh.isSkinned == false && mesh.instanceCount > 1)
+            {
+                instanced.push_back(i);
+                continue;
+            }
+
+            GroupKey key = { mesh.isSkinned ? glm::mat4() : mesh.transform, mesh.isSkinned, mesh.doubleSided };
+            auto inserted = bucketMap.emplace(key, (uint32_t)buckets.size());
+            if (inserted.second) buckets.push_back({ mesh.isSkinned });
+            buckets[inserted.first->second].meshes.push_back(i);
+        }
+
+        Result result;
+        result.meshOrder.reserve(meshes.size());
+        Group current;
+        auto addMesh = [&](uint32_t meshIndex)
+        {
+            result.meshOrder.push_back(meshIndex);
+            current.meshCount++;
+            current.primitiveCount += meshes[meshIndex].primitiveCount;
+        };
+        auto endGroup = [&](bool isStatic)
+        {
+            if (current.meshCount)
+            {
+                current.isStatic = isStatic;
+                current.estimatedBuildBytes = estimateBuildBytes(current.primitiveCount);
+                result.groups.push_back(current);
+            }
+            current = Group();
+            current.meshBaseIndex = (uint32_t)result.meshOrder.size();
+        };
+
+        auto packBuckets = [&](bool isSkinned)
+        {
+            for (const Bucket& bucket : buckets)
+            {
+                if (bucket.isSkinned != isSkinned) continue;
+
+                // Large meshes first, since merging them saves little and makes the BLAS expensive to rebuild
+                for (uint32_t meshIndex : bucket.meshes)
+                {
+                    if (meshes[meshIndex].primitiveCount <= largeMeshPrimitives) continue;
+                    addMesh(meshIndex);
+                    endGroup(!isSkinned);
+                }
+
+                for (uint32_t meshIndex : bucket.meshes)
+                {
+                    const uint32_t primitiveCount = meshes[meshIndex].primitiveCount;
+                    if (primitiveCount > largeMeshPrimitives) continue;
+                    if (current.meshCount && current.primitiveCount + primitiveCount > maxMergedPrimitives) endGroup(!isSkinned);
+                    addMesh(meshIndex);
+                }
+                endGroup(!isSkinned);
+            }
+        };
+
+        packBuckets(false);
+        for (uint32_t meshIndex : instanced)
+        {
+            addMesh(meshIndex);
+            endGroup(true);
+        }
+        packBuckets(true);
+
+        assert(result.meshOrder.size() == meshes.size());
+        return result;
+    }
+
+    std::string BlasGrouping::getReport(const std::string& modelName, const Result& result)
+    {
+        uint64_t totalPrimitives = 0, totalBytes = 0, minPrimitives = UINT64_MAX, maxPrimitives = 0;
+        uint32_t skinnedCount = 0;
+        for (const Group& group : result.groups)
+        {
+            totalPrimitives += group.primitiveCount;
+            totalBytes += group.estimatedBuildBytes;
+            minPrimitives = std::min(minPrimitives, group.primitiveCount);
+            maxPrimitives = std::max(maxPrimitives, group.primitiveCount);
+            if (group.isStatic == false) skinnedCount++;
+        }
+
+        const uint32_t blasCount = (uint32_t)result.groups.size();
+        char report[256];
+        snprintf(report, sizeof(report), "%u BLASes (%u skinned) for %u meshes, %llu primitives, %llu/%.1f/%llu primitives per BLAS (min/avg/max), %.1f MB estimated build memory",
+            blasCount, skinnedCount, (uint32_t)result.meshOrder.size(), (unsigned long long)totalPrimitives, (unsigned long long)(blasCount ? minPrimitives : 0),
+            blasCount ? double(totalPrimitives) / double(blasCount) : 0.0, (unsigned long long)maxPrimitives, double(totalBytes) / (1024.0 * 1024.0));
+        return "BLASes of '" + modelName + "': " + report;
+    }
+}
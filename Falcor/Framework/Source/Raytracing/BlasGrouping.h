@@ -0,0 +1,90 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    /** Groups the meshes of a model into bottom-level acceleration structures. Used by RtModel.
+        Static meshes with a single instance are grouped by transform and by the material flags which the TLAS instance carries, using a hash map. Each group is
+        then packed into BLASes with a simple cost model: small meshes are merged, which saves TLAS instances and per-BLAS build overhead, until a BLAS reaches
+        maxMergedPrimitives, so that it stays cheap to rebuild. Meshes with more than largeMeshPrimitives get a BLAS of their own.
+        Instanced meshes get a BLAS each, since the TLAS instances carry their transforms. Skinned meshes are grouped by material flags only, since the skinning
+        code computes their vertices in model space.
+    */
+    class BlasGrouping
+    {
+    public:
+        static const uint32_t kDefaultMaxMergedPrimitives = 1 << 20;
+        static const uint32_t kDefaultLargeMeshPrimitives = 1 << 18;
+
+        /** What the grouping needs to know about a mesh
+        */
+        struct MeshDesc
+        {
+            glm::mat4 transform;            ///< Transform of the mesh's first instance
+            uint32_t instanceCount = 1;
+            uint32_t primitiveCount = 0;
+            uint32_t vertexCount = 0;
+            bool isSkinned = false;
+            bool doubleSided = false;
+        };
+
+        struct Group
+        {
+            uint32_t meshBaseIndex = 0;     ///< First mesh of the BLAS, in the new mesh order
+            uint32_t meshCount = 0;
+            bool isStatic = true;
+            uint64_t primitiveCount = 0;
+            uint64_t estimatedBuildBytes = 0;
+        };
+
+        struct Result
+        {
+            std::vector<uint32_t> meshOrder;    ///< The original index of each mesh, in the new order. The meshes of a BLAS are contiguous.
+            std::vector<Group> groups;          ///< Static BLASes first, then skinned ones
+        };
+
+        /** Group meshes into BLASes
+            \param[in] meshes The meshes
+            \param[in] maxMergedPrimitives Maximum number of primitives in a BLAS made of several meshes
+            \param[in] largeMeshPrimitives Meshes with more primitives than this aren't merged with others
+        */
+        static Result group(const std::vector<MeshDesc>& meshes, uint32_t maxMergedPrimitives = kDefaultMaxMergedPrimitives, uint32_t largeMeshPrimitives = kDefaultLargeMeshPrimitives);
+
+        /** Estimate the memory needed to build a BLAS, including the scratch buffer. The driver only reports the exact size when the BLAS is built.
+        */
+        static uint64_t estimateBuildBytes(uint64_t primitiveCount);
+
+        /** Format the BLAS count, primitives per BLAS and estimated build memory of a model, for logging
+        */
+        static std::string getReport(const std::string& modelName, const Result& result);
+    };
+}
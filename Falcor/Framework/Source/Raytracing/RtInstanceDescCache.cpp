@@ -0,0 +1,176 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "RtInstanceDescCache.h"
+#include "Utils/ParallelFor.h"
+
+namespace Falcor
+{
+    void RtInstanceDescCache::clear()
+    {
+        mTransforms.clear();
+        mInstances.clear();
+        mDescs.clear();
+        mUserOffsets.clear();
+        mUsers.clear();
+        mUsersDirty = false;
+        mDirtyTransforms.clear();
+        mTransformDirty.clear();
+        mDirtyBits.clear();
+        mDirtyCount = 0;
+    }
+
+    uint32_t RtInstanceDescCache::addTransform(const glm::mat4& matrix)
+    {
+        mTransforms.push_back(matrix);
+        mTransformDirty.push_back(false);
+        mUsersDirty = true;
+        return (uint32_t)mTransforms.size() - 1;
+    }
+
+    uint32_t RtInstanceDescCache::addInstance(const D3D12_RAYTRACING_INSTANCE_DESC& desc, uint32_t transform, uint32_t localTransform)
+    {
+        assert(transform < mTransforms.size() && (localTransform == kNoTransform || localTransform < mTransforms.size()));
+        const uint32_t index = (uint32_t)mDescs.size();
+        mDescs.push_back(desc);
+        mInstances.push_back({ transform, localTransform });
+        mUsersDirty = true;
+
+        if (mDirtyBits.size() * 32 < mDescs.size())
+        {
+            mDirtyBits.push_back(0);
+        }
+        markDirty(index);
+        return index;
+    }
+
+    void RtInstanceDescCache::setTransform(uint32_t index, const glm::mat4& matrix)
+    {
+        mTransforms[index] = matrix;
+        if (mTransformDirty[index] == false)
+        {
+            mTransformDirty[index] = true;
+            mDirtyTransforms.push_back(index);
+        }
+    }
+
+    void RtInstanceDescCache::markDirty(uint32_t instance)
+    {
+        uint32_t& word = mDirtyBits[instance / 32];
+        const uint32_t bit = 1u << (instance % 32);
+        if ((word & bit) == 0)
+        {
+            word |= bit;
+            mDirtyCount++;
+        }
+    }
+
+    void RtInstanceDescCache::buildUsers()
+    {
+        // Counting sort of the instances by transform
+        mUserOffsets.assign(mTransforms.size() + 1, 0);
+        for (const auto& instance : mInstances)
+        {
+            mUserOffsets[instance.transform + 1]++;
+            if (instance.localTransform != kNoTransform) mUserOffsets[instance.localTransform + 1]++;
+        }
+        for (size_t i = 1; i < mUserOffsets.size(); i++)
+        {
+            mUserOffsets[i] += mUserOffsets[i - 1];
+        }
+
+        mUsers.resize(mUserOffsets.back());
+        std::vector<uint32_t> next(mUserOffsets.begin(), mUserOffsets.end() - 1);
+        for (uint32_t i = 0; i < (uint32_t)mInstances.size(); i++)
+        {
+            mUsers[next[mInstances[i].transform]++] = i;
+            if (mInstances[i].localTransform != kNoTransform) mUsers[next[mInstances[i].localTransform]++] = i;
+        }
+        mUsersDirty = false;
+    }
+
+    void RtInstanceDescCache::updateJob(uint32_t job)
+    {
+        const uint32_t firstWord = job * (kJobSize / 32);
+        const uint32_t lastWord = std::min(firstWord + kJobSize / 32, (uint32_t)mDirtyBits.size());
+        for (uint32_t w = firstWord; w < lastWord; w++)
+        {
+            uint32_t word = mDirtyBits[w];
+            while (word)
+            {
+                const uint32_t bit = bitScanForward(word);
+                word &= word - 1;
+
+                const uint32_t instance = w * 32 + bit;
+                const InstanceTransforms& transforms = mInstances[instance];
+                glm::mat4 matrix = mTransforms[transforms.transform];
+                if (transforms.localTransform != kNoTransform)
+                {
+                    matrix = matrix * mTransforms[transforms.localTransform];
+                }
+
+                // The desc's transform is the top 3 rows of the matrix, row-major
+                auto& desc = mDescs[instance];
+                for (uint32_t row = 0; row < 3; row++)
+                {
+                    for (uint32_t col = 0; col < 4; col++)
+                    {
+                        desc.Transform[row][col] = matrix[col][row];
+                    }
+                }
+            }
+            mDirtyBits[w] = 0;
+        }
+    }
+
+    uint32_t RtInstanceDescCache::update(uint32_t maxThreads)
+    {
+        if (mDirtyTransforms.size())
+        {
+            if (mUsersDirty) buildUsers();
+            for (uint32_t transform : mDirtyTransforms)
+            {
+                for (uint32_t u = mUserOffsets[transform]; u < mUserOffsets[transform + 1]; u++)
+                {
+                    markDirty(mUsers[u]);
+                }
+                mTransformDirty[transform] = false;
+            }
+            mDirtyTransforms.clear();
+        }
+
+        const uint32_t dirtyCount = mDirtyCount;
+        if (dirtyCount == 0) return 0;
+
+        // Spawning threads costs more than a single job's worth of work
+        const uint32_t jobCount = (getInstanceCount() + kJobSize - 1) / kJobSize;
+        parallelFor(jobCount, [this](uint32_t job) { updateJob(job); }, (dirtyCount < kJobSize) ? 1 : maxThreads);
+        mDirtyCount = 0;
+        return dirtyCount;
+    }
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    /** A persistent array of TLAS instance descs, which only rewrites the descs whose transforms changed.
+        An instance's transform is the product of one or two entries of a transform table, e.g. the transforms of a model instance and of a mesh instance.
+        setTransform() marks the instances which use a transform as dirty, in a bitset. update() then computes the transforms of the dirty instances only,
+        in jobs of kJobSize instances which run on worker threads.
+    */
+    class RtInstanceDescCache
+    {
+    public:
+        static const uint32_t kNoTransform = uint32_t(-1);
+
+        /** Number of instances covered by a single job of update()
+        */
+        static const uint32_t kJobSize = 4096;
+
+        /** Remove all transforms and instances
+        */
+        void clear();
+
+        /** Add an entry to the transform table
+            \return The index of the transform
+        */
+        uint32_t addTransform(const glm::mat4& matrix);
+
+        /** Add an instance. Its transform is computed by the next update().
+            \param[in] desc The instance desc. Its transform is ignored.
+            \param[in] transform Index of the instance's transform
+            \param[in] localTransform Index of a transform applied before the first one, or kNoTransform
+            \return The index of the instance
+        */
+        uint32_t addInstance(const D3D12_RAYTRACING_INSTANCE_DESC& desc, uint32_t transform, uint32_t localTransform = kNoTransform);
+
+        /** Change an entry of the transform table, and mark the instances which use it as dirty
+        */
+        void setTransform(uint32_t index, const glm::mat4& matrix);
+
+        /** Get an instance desc, to change the fields which don't depend on the transform table
+        */
+        D3D12_RAYTRACING_INSTANCE_DESC& getDesc(uint32_t instance) { return mDescs[instance]; }
+
+        /** Rewrite the transforms of the dirty instances
+            \param[in] maxThreads Maximum number of threads to use, including the calling thread. 0 uses one thread per hardware thread.
+            \return The number of instances which were rewritten
+        */
+        uint32_t update(uint32_t maxThreads = 0);
+
+        /** Get the instance descs. Call update() first.
+        */
+        const std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& getDescs() const { return mDescs; }
+
+        uint32_t getInstanceCount() const { return (uint32_t)mDescs.size(); }
+        uint32_t getTransformCount() const { return (uint32_t)mTransforms.size(); }
+
+    private:
+        struct InstanceTransforms
+        {
+            uint32_t transform;
+            uint32_t localTransform;
+        };
+
+        void buildUsers();
+        void markDirty(uint32_t instance);
+        void updateJob(uint32_t job);
+
+        std::vector<glm::mat4> mTransforms;
+        std::vector<InstanceTransforms> mInstances;
+        std::vector<D3D12_RAYTRACING_INSTANCE_DESC> mDescs;
+
+        // The instances which use each transform, as ranges of mUsers. Rebuilt by update() when instances were added.
+        std::vector<uint32_t> mUserOffsets;
+        std::vector<uint32_t> mUsers;
+        bool mUsersDirty = false;
+
+        std::vector<uint32_t> mDirtyTransforms;     ///< Transforms changed since the last update()
+        std::vector<bool> mTransformDirty;
+        std::vector<uint32_t> mDirtyBits;           ///< One bit per instance
+        uint32_t mDirtyCount = 0;
+    };
+}
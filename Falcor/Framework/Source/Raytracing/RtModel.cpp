@@ -27,6 +27,7 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "RtModel.h"
+#include "BlasGrouping.h"
 #include "API/Device.h"
 #include "API/RenderContext.h"
 #include "API/LowLevel/LowLevelContextData.h"
@@ -38,105 +39,45 @@ namespace Falcor
     {
     }
 
-    // TODO: Static meshes with materials that differ with respect to the doubleSided flag should not be grouped.
     void RtModel::createBottomLevelData()
     {
-        // The logic works as follows:
-        //  - Static meshes come before dynamic meshes
-        //  - Meshes that have a single instance and have the same matrix are contiguous
-
-        // Store the meshes into lists, grouped based on their transformation matrix
-        std::list<MeshInstanceList> staticMeshes;
-        std::list<MeshInstanceList> dynamicMeshes;
-        for (const auto& instanceList : mMeshes)
+        std::vector<BlasGrouping::MeshDesc> meshes(mMeshes.size());
+        for (size_t i = 0; i < mMeshes.size(); i++)
         {
+            const auto& instanceList = mMeshes[i];
             assert(instanceList.size() > 0);
-            if (instanceList[0]->getObject()->hasBones())
-            {
-                dynamicMeshes.push_back(instanceList);
-                continue;
-            }
-
-            // If we have multiple instances, push it to the end of the list
-            if (instanceList.size() > 1)
-            {
-                staticMeshes.push_back(instanceList);
-            }
-            else
-            {
-                bool handled = false;
-                // Find the insert location. Should have a single instance and the matrix should match
-                for (auto& it = staticMeshes.begin(); it != staticMeshes.end(); it++)
-                {
-                    if (it->size() > 1) break;
-                    if ((*it)[0]->getTransformMatrix() == instanceList[0]->getTransformMatrix())
-                    {
-                        handled = true;
-                        staticMeshes.insert(it, instanceList);
-                        break;
-                    }
-                }
-                if (!handled) staticMeshes.push_front(instanceList);
-            }
+            const Mesh* pMesh = instanceList[0]->getObject().get();
+            BlasGrouping::MeshDesc& desc = meshes[i];
+            desc.transform = instanceList[0]->getTransformMatrix();
+            desc.instanceCount = (uint32_t)instanceList.size();
+            desc.primitiveCount = pMesh->getPrimitiveCount();
+            desc.vertexCount = pMesh->getVertexCount();
+            desc.isSkinned = pMesh->hasBones();
+            desc.doubleSided = pMesh->getMaterial()->getDoubleSided();
         }
+        BlasGrouping::Result grouping = BlasGrouping::group(meshes);
+        logInfo(BlasGrouping::getReport(getName(), grouping));
 
-        // Copy the lists into the vectors. Static meshes first
-        size_t count = mMeshes.size();
-        assert(staticMeshes.size() + dynamicMeshes.size() == count);
-        mMeshes.clear();
-        mMeshes.reserve(count);
-
-        auto insertFunc = [this](const auto& meshList, bool isStatic)
+        // Reorder the meshes so that the meshes of each BLAS are contiguous
+        std::vector<MeshInstanceList> sortedMeshes;
+        sortedMeshes.reserve(mMeshes.size());
+        for (uint32_t meshIndex : grouping.meshOrder)
         {
-            if (meshList.size())
-            {
-                BottomLevelData data;
-                data.isStatic = isStatic;
-                mat4 transformation = (*meshList.begin())[0]->getTransformMatrix();
-                data.meshCount = 0;
-                data.meshBaseIndex = (uint32_t)mMeshes.size();
-                bool instanced = false;
-                for (auto& it : meshList)
-                {
-                    // The logic works as follows:
-                    //  - Dynamic meshes all go in the same group, as they don't have individual mesh-instance transforms. The skinning code computes their vertices.
-                    //  - Static non-instanced meshes are grouped per instance transform
-                    //  - Static instanced meshes all go in invididual groups, and come after non-instanced meshes in the list.
-
-                    if (isStatic)
-                    {
-                        // Validate that instanced meshes are last
-                        if (it.size() > 1) instanced = true;
-                        else assert(!instanced);
-
-                        // If mesh is instanced or the transform has changed, start a new mesh group
-                        if (it.size() > 1 || it[0]->getTransformMatrix() != transformation)
-                        {
-                            if (data.meshCount > 0) // The first mesh could be instanced...
-                            {
-                                mBottomLevelData.push_back(data);
-                            }
-
-                            transformation = it[0]->getTransformMatrix();
-                            data.meshBaseIndex = (uint32_t)mMeshes.size();
-                            data.meshCount = 0;
-                        }
-                    }
-                    else
-                    {
-                        // We don't handle dynamic instanced meshes
-                        assert(it.size() == 1);
-                    }
-
-                    mMeshes.push_back(it);
-                    data.meshCount++;
-                }
-                mBottomLevelData.push_back(data);
-            }
-        };
+            sortedMeshes.push_back(std::move(mMeshes[meshIndex]));
+        }
+        mMeshes.swap(sortedMeshes);
 
-        insertFunc(staticMeshes, true);
-        insertFunc(dynamicMeshes, false);
+        mBottomLevelData.clear();
+        for (const BlasGrouping::Group& group : grouping.groups)
+        {
+            BottomLevelData data;
+            data.meshBaseIndex = group.meshBaseIndex;
+            data.meshCount = group.meshCount;
+            data.isStatic = group.isStatic;
+            data.primitiveCount = group.primitiveCount;
+            data.estimatedBuildBytes = group.estimatedBuildBytes;
+            mBottomLevelData.push_back(data);
+        }
 
         // Validate that mBottomLevelData represents a contiguous range that includes all meshes, and that grouped meshes are non-instanced
         uint32_t baseIdx = 0;
@@ -188,6 +129,8 @@ namespace Falcor
         for (auto& blasData : mBottomLevelData)
         {
             std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geomDesc(blasData.meshCount);
+            std::vector<float> transforms;
+            std::vector<size_t> transformedDescs;
             for (size_t meshIndex = blasData.meshBaseIndex; meshIndex < blasData.meshBaseIndex + blasData.meshCount; meshIndex++)
             {
                 assert(meshIndex < mMeshes.size());
@@ -210,6 +153,17 @@ namespace Falcor
                 desc.Triangles.VertexCount = pMesh->getVertexCount();
                 desc.Triangles.VertexFormat = getDxgiFormat(pVbLayout->getElementFormat(elemDesc.elementIndex));
 
+                // Quantized positions are decoded by the geometry transform
+                const Mesh::VertexQuantization& quantization = pMesh->getVertexQuantization();
+                if (quantization.flags & VERTEX_QUANTIZE_POSITION)
+                {
+                    const vec3& s = quantization.positionScale;
+                    const vec3& o = quantization.positionOffset;
+                    const float transform[12] = { s.x, 0, 0, o.x,   0, s.y, 0, o.y,   0, 0, s.z, o.z };
+                    transforms.insert(transforms.end(), transform, transform + 12);
+                    transformedDescs.push_back(meshIndex - blasData.meshBaseIndex);
+                }
+
                 // Get the IB
                 const Buffer* pIB = pVao->getIndexBuffer().get();
                 pContext->resourceBarrier(pIB, Resource::State::NonPixelShader);
@@ -224,6 +178,18 @@ namespace Falcor
                 }
             }
 
+            // The transforms are row-major 3x4 matrices
+            Buffer::SharedPtr pTransformBuffer;
+            if (transformedDescs.size())
+            {
+                pTransformBuffer = Buffer::create(transforms.size() * sizeof(float), Buffer::BindFlags::None, Buffer::CpuAccess::None, transforms.data());
+                pContext->resourceBarrier(pTransformBuffer.get(), Resource::State::NonPixelShader);
+                for (size_t i = 0; i < transformedDescs.size(); i++)
+                {
+                    geomDesc[transformedDescs[i]].Triangles.Transform3x4 = pTransformBuffer->getGpuAddress() + i * 12 * sizeof(float);
+                }
+            }
+
             // Create the acceleration and aux buffers
             D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
             inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
@@ -45,6 +45,8 @@ namespace Falcor
             uint32_t meshBaseIndex = 0;
             uint32_t meshCount = 0;
             bool isStatic = true;
+            uint64_t primitiveCount = 0;
+            uint64_t estimatedBuildBytes = 0;   ///< Estimated size of the BLAS and its scratch buffer
             Buffer::SharedPtr pBlas;
         };
 
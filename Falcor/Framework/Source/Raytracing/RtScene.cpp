@@ -122,34 +122,63 @@ namespace Falcor
         }
     }
 
-    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> RtScene::createInstanceDesc(const RtScene* pScene, uint32_t hitProgCount)
+    void RtScene::createInstanceDesc(uint32_t hitProgCount)
     {
         mGeometryCount = 0;
-        std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDesc;
-        mModelInstanceData.resize(pScene->getModelCount());
+        mInstanceDescs.clear();
+        mInstanceDescHitProgCount = hitProgCount;
+        mTrackedModels.clear();
+        mTrackedModelInstances.clear();
+        mTrackedMeshInstances.clear();
+        mTrackedBlas.clear();
+        mModelInstanceData.resize(getModelCount());
 
         uint32_t tlasIndex = 0;
         uint32_t instanceContributionToHitGroupIndex = 0;
         // Loop over all the models
-        for (uint32_t modelId = 0; modelId < pScene->getModelCount(); modelId++)
+        for (uint32_t modelId = 0; modelId < getModelCount(); modelId++)
         {
             auto& modelInstanceData = mModelInstanceData[modelId];
-            const RtModel* pModel = dynamic_cast<RtModel*>(pScene->getModel(modelId).get());
+            const RtModel* pModel = dynamic_cast<RtModel*>(getModel(modelId).get());
             assert(pModel); // Can't work on regular models
             modelInstanceData.modelBase = tlasIndex;
             modelInstanceData.meshInstancesPerModelInstance = 0;
             modelInstanceData.meshBase.resize(pModel->getMeshCount());
+            mTrackedModels.push_back(pModel);
 
-            for (uint32_t modelInstance = 0; modelInstance < pScene->getModelInstanceCount(modelId); modelInstance++)
+            // The mesh-instance transforms are shared by all the instances of the model. They only apply to non-skinned meshes.
+            const uint32_t blasBase = (uint32_t)mTrackedBlas.size();
+            std::vector<uint32_t> meshTransformBase(pModel->getBottomLevelDataCount(), RtInstanceDescCache::kNoTransform);
+            for (uint32_t blasId = 0; blasId < pModel->getBottomLevelDataCount(); blasId++)
             {
-                const auto& pModelInstance = pScene->getModelInstance(modelId, modelInstance);
+                const auto& blasData = pModel->getBottomLevelData(blasId);
+                mTrackedBlas.push_back({ pModel, blasId, blasData.pBlas->getGpuAddress() });
+                if (blasData.isStatic)
+                {
+                    meshTransformBase[blasId] = mInstanceDescs.getTransformCount();
+                    for (uint32_t meshInstance = 0; meshInstance < pModel->getMeshInstanceCount(blasData.meshBaseIndex); meshInstance++)
+                    {
+                        const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(blasData.meshBaseIndex, meshInstance).get();     // If there are multiple meshes in a BLAS, they all have the same transform
+                        const uint32_t version = pMeshInstance->getTransformVersion();
+                        mTrackedMeshInstances.push_back({ pMeshInstance, version, mInstanceDescs.addTransform(pMeshInstance->getTransformMatrix()) });
+                    }
+                }
+            }
+
+            for (uint32_t modelInstance = 0; modelInstance < getModelInstanceCount(modelId); modelInstance++)
+            {
+                const ModelInstance* pModelInstance = getModelInstance(modelId, modelInstance).get();
+                const uint32_t version = pModelInstance->getTransformVersion();
+                const uint32_t modelTransform = mInstanceDescs.addTransform(pModelInstance->getTransformMatrix());
+                mTrackedModelInstances.push_back({ pModelInstance, version, modelTransform });
+
                 // Loop over the meshes
                 for (uint32_t blasId = 0; blasId < pModel->getBottomLevelDataCount(); blasId++)
                 {
                     // Initialize the instance desc
                     const auto& blasData = pModel->getBottomLevelData(blasId);
                     D3D12_RAYTRACING_INSTANCE_DESC idesc = {};
-                    idesc.AccelerationStructure = blasData.pBlas->getGpuAddress();
+                    idesc.AccelerationStructure = mTrackedBlas[blasBase + blasId].address;
 
                     // Set the meshes tlas offset
                     if (modelInstance == 0)
@@ -164,28 +193,23 @@ namespace Falcor
                     uint32_t meshInstanceCount = pModel->getMeshInstanceCount(blasData.meshBaseIndex);
                     for (uint32_t meshInstance = 0; meshInstance < meshInstanceCount; meshInstance++)
                     {
-                        idesc.InstanceID = uint32_t(instanceDesc.size());
+                        idesc.InstanceID = mInstanceDescs.getInstanceCount();
                         idesc.InstanceContributionToHitGroupIndex = instanceContributionToHitGroupIndex;
                         instanceContributionToHitGroupIndex += hitProgCount * blasData.meshCount;
                         idesc.InstanceMask = 0xff;
                         const auto& pMaterial = pModel->getMeshInstance(blasData.meshBaseIndex, meshInstance)->getObject()->getMaterial();
                         idesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
 
-                        // TODO: This code is incorrect since a BLAS can have multiple meshes with different materials and hence different doubleSided flags.
+                        // RtModel only groups meshes with the same doubleSided flag into a BLAS
                         if (pMaterial->getDoubleSided())
                         {
                             idesc.Flags |= D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE;
                         }
 
-                        // Only apply mesh-instance transform on non-skinned meshes
-                        mat4 transform = pModelInstance->getTransformMatrix();
-                        if (blasData.isStatic)
-                        {
-                            transform = transform * pModel->getMeshInstance(blasData.meshBaseIndex, meshInstance)->getTransformMatrix();    // If there are multiple meshes in a BLAS, they all have the same transform
-                        }
-                        transform = transpose(transform);
-                        memcpy(idesc.Transform, &transform, sizeof(idesc.Transform));
-                        instanceDesc.push_back(idesc);
+                        // The transform is computed by mInstanceDescs.update()
+                        const uint32_t meshTransform = blasData.isStatic ? meshTransformBase[blasId] + meshInstance : RtInstanceDescCache::kNoTransform;
+                        const uint32_t desc = mInstanceDescs.addInstance(idesc, modelTransform, meshTransform);
+                        mTrackedBlas[blasBase + blasId].descs.push_back(desc);
                         mGeometryCount += blasData.meshCount;
                         if (modelInstance == 0) modelInstanceData.meshInstancesPerModelInstance += blasData.meshCount;
                         tlasIndex += blasData.meshCount;
@@ -212,8 +236,53 @@ namespace Falcor
             }
         }
         assert(instanceId == mGeometryCount);
+    }
+
+    bool RtScene::updateInstanceDesc(uint32_t hitProgCount)
+    {
+        if (hitProgCount != mInstanceDescHitProgCount || getModelCount() != mTrackedModels.size()) return false;
+
+        // The descs can only be updated if the scene still has the same instances, in the same order
+        uint32_t tracked = 0;
+        for (uint32_t modelId = 0; modelId < getModelCount(); modelId++)
+        {
+            if (getModel(modelId).get() != mTrackedModels[modelId]) return false;
+            for (uint32_t modelInstance = 0; modelInstance < getModelInstanceCount(modelId); modelInstance++, tracked++)
+            {
+                if (tracked >= mTrackedModelInstances.size() || getModelInstance(modelId, modelInstance).get() != mTrackedModelInstances[tracked].pInstance) return false;
+            }
+        }
+        if (tracked != mTrackedModelInstances.size()) return false;
 
-        return instanceDesc;
+        for (auto& instance : mTrackedModelInstances)
+        {
+            if (instance.pInstance->getTransformVersion() != instance.version)
+            {
+                instance.version = instance.pInstance->getTransformVersion();
+                mInstanceDescs.setTransform(instance.transform, instance.pInstance->getTransformMatrix());
+            }
+        }
+
+        for (auto& instance : mTrackedMeshInstances)
+        {
+            if (instance.pInstance->getTransformVersion() != instance.version)
+            {
+                instance.version = instance.pInstance->getTransformVersion();
+                mInstanceDescs.setTransform(instance.transform, instance.pInstance->getTransformMatrix());
+            }
+        }
+
+        // Skinned models rebuild their BLAS when they animate
+        for (auto& blas : mTrackedBlas)
+        {
+            uint64_t address = blas.pModel->getBottomLevelData(blas.blasId).pBlas->getGpuAddress();
+            if (address != blas.address)
+            {
+                blas.address = address;
+                for (uint32_t desc : blas.descs) mInstanceDescs.getDesc(desc).AccelerationStructure = address;
+            }
+        }
+        return true;
     }
 
     // TODO: Cache TLAS per hitProgCount, as some render pipelines need multiple TLAS:es with different #hit progs in same frame, currently that trigger rebuild every frame. See issue #365.
@@ -226,6 +295,8 @@ namespace Falcor
         if (hitProgCount == 0 || getModelCount() == 0)
         {
             mModelInstanceData.clear();
+            mInstanceDescs.clear();
+            mInstanceDescHitProgCount = -1;
             mpTopLevelAS = nullptr;
             mTlasSrv = nullptr;
             mGeometryCount = 0;
@@ -239,7 +310,12 @@ namespace Falcor
 
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS dxrFlags = getDxrBuildFlags(mRtFlags);
         RenderContext* pContext = gpDevice->getRenderContext().get();
-        std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDesc = createInstanceDesc(this, hitProgCount);
+        if (updateInstanceDesc(hitProgCount) == false)
+        {
+            createInstanceDesc(hitProgCount);
+        }
+        mInstanceDescs.update();
+        const std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& instanceDesc = mInstanceDescs.getDescs();
 
         // todo: improve this check - make sure things have not changed much and update was enabled last time
         bool isRefitPossible = mRefit && mpTopLevelAS && (mInstanceCount == (uint32_t)instanceDesc.size());
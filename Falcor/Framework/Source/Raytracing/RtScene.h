@@ -28,6 +28,7 @@
 #pragma once
 #include "Graphics/Scene/Scene.h"
 #include "RtModel.h"
+#include "RtInstanceDescCache.h"
 #include <map>
 
 namespace Falcor
@@ -68,7 +69,8 @@ namespace Falcor
         Buffer::SharedPtr mpTopLevelAS;             // The top-level acceleration structure for the model
         ShaderResourceView::SharedPtr mTlasSrv;
         void createTlas(uint32_t rayCount);
-        std::vector<D3D12_RAYTRACING_INSTANCE_DESC> createInstanceDesc(const RtScene* pScene, uint32_t hitProgCount);
+        void createInstanceDesc(uint32_t hitProgCount);
+        bool updateInstanceDesc(uint32_t hitProgCount);
 
         uint32_t mGeometryCount = 0;    // The total number of geometries in the scene
         uint32_t mInstanceCount = 0;    // The total number of TLAS instances in the scene
@@ -81,6 +83,39 @@ namespace Falcor
         };
 
         std::vector<ModelInstanceData> mModelInstanceData;
+
+        // The TLAS instance descs are kept between builds. updateInstanceDesc() only rewrites the descs of the instances which moved.
+        RtInstanceDescCache mInstanceDescs;
+        uint32_t mInstanceDescHitProgCount = -1;
+
+        // The objects the instance descs were created from, with the transform versions they had
+        struct TrackedModelInstance
+        {
+            const ModelInstance* pInstance;
+            uint32_t version;
+            uint32_t transform;     // Index in mInstanceDescs' transform table
+        };
+
+        struct TrackedMeshInstance
+        {
+            const Model::MeshInstance* pInstance;
+            uint32_t version;
+            uint32_t transform;
+        };
+
+        struct TrackedBlas
+        {
+            const RtModel* pModel;
+            uint32_t blasId;
+            uint64_t address;
+            std::vector<uint32_t> descs;    // The instance descs which reference the BLAS
+        };
+
+        std::vector<const Model*> mTrackedModels;
+        std::vector<TrackedModelInstance> mTrackedModelInstances;
+        std::vector<TrackedMeshInstance> mTrackedMeshInstances;
+        std::vector<TrackedBlas> mTrackedBlas;
+
         std::unordered_map<const Model*, RtModel::SharedPtr> mModelToRtModel;
         std::unordered_map<IMovableObject*, IMovableObject::SharedPtr> mModelInstanceToRtModelInstance;
 
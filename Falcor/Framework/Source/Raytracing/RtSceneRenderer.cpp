@@ -29,6 +29,7 @@
 #include "RtSceneRenderer.h"
 #include "RtProgramVars.h"
 #include "RtState.h"
+#include "Graphics/TextureStreamer.h"
 
 namespace Falcor
 {
@@ -55,6 +56,7 @@ namespace Falcor
             setPerMeshData(data.currentData, pMesh);
             setPerMeshInstanceData(data.currentData, pModelInstance, pMeshInstance, 0);
             setPerMaterialData(data.currentData, pMesh->getMaterial().get());
+            TextureStreamer::markUsed(pMesh->getMaterial().get());
         }
     }
 
@@ -40,10 +40,12 @@
 #include <sstream>
 #include <iomanip>
 #include "Graphics/RenderGraph/RenderPassLibrary.h"
+#include "Graphics/TextureStreamer.h"
 
 namespace Falcor
 {
     static std::string kMonospaceFont = "monospace";
+    static const uint32_t kTraceCaptureFrames = 30;
 
     void Sample::handleWindowSizeChange()
     {
@@ -93,6 +95,12 @@ namespace Falcor
                 {
                     initVideoCapture();
                 }
+#if _PROFILING_ENABLED
+                else if (keyEvent.mods.isShiftDown && keyEvent.key == KeyboardEvent::Key::P)
+                {
+                    Profiler::startTraceCapture(kTraceCaptureFrames);
+                }
+#endif
                 else if (!keyEvent.mods.isAltDown && !keyEvent.mods.isCtrlDown && !keyEvent.mods.isShiftDown)
                 {
                     switch (keyEvent.key)
@@ -180,6 +188,7 @@ namespace Falcor
 
         RenderPassLibrary::instance().shutdown();
         Scripting::shutdown();
+        TextureStreamer::shutdown();
         mpGui.reset();
         mpDefaultPipelineState.reset();
         mpBackBufferFBO.reset();    
@@ -329,7 +338,8 @@ namespace Falcor
                 "  'Z'       - Zoom in on a pixel\n"
                 "  'MouseWheel' - Change level of zoom\n"
 #if _PROFILING_ENABLED
-                "  'P'       - Enable profiling\n";
+                "  'P'       - Enable profiling\n"
+                "  'Shift+P'   - Capture profiler trace\n";
 #else
                 ;
 #endif
@@ -459,6 +469,7 @@ namespace Falcor
                 // Bind the default state
                 mpDefaultPipelineState->setFbo(mpTargetFBO);
                 mpRenderContext->setGraphicsState(mpDefaultPipelineState);
+                TextureStreamer::update(mpRenderContext.get());
             }
             calculateTime();
             mpRenderer->onFrameRender(this, mpRenderContext, mpTargetFBO);
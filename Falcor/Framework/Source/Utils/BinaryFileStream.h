@@ -93,6 +93,21 @@ namespace Falcor
             mStream.ignore(count);
         }
 
+        /** Get the current read position in the input stream.
+            \return Offset in bytes from the start of the file
+        */
+        size_t getReadPosition() { return (size_t)mStream.tellg(); }
+
+        /** Move the read position of the input stream.
+            \param[in] position Offset in bytes from the start of the file
+        */
+        void setReadPosition(size_t position) { mStream.seekg((std::streamoff)position); }
+
+        /** Move the write position of the output stream.
+            \param[in] position Offset in bytes from the start of the file
+        */
+        void setWritePosition(size_t position) { mStream.seekp((std::streamoff)position); }
+
         /** Deletes the managed file.
         */
         void remove()
@@ -0,0 +1,150 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace Falcor
+{
+    /** 64-bit xxHash (XXH64). Used to key the on-disk caches and to find textures with the same content, so it doesn't need to be cryptographically strong,
+        but every input bit affects every bit of the result.
+        The hash of a given sequence of add() calls is stable across runs, but depends on the platform's endianness.
+    */
+    class Hasher
+    {
+    public:
+        /** Hash a block of memory in one go.
+        */
+        static uint64_t hash(const void* pData, size_t size, uint64_t seed = 0)
+        {
+            const uint8_t* p = (const uint8_t*)pData;
+            const uint8_t* pEnd = p + size;
+            uint64_t h;
+
+            if (size >= 32)
+            {
+                const uint8_t* pLimit = pEnd - 32;
+                uint64_t v1 = seed + kPrime1 + kPrime2;
+                uint64_t v2 = seed + kPrime2;
+                uint64_t v3 = seed;
+                uint64_t v4 = seed - kPrime1;
+                do
+                {
+                    v1 = xxhRound(v1, read64(p));
+                    v2 = xxhRound(v2, read64(p + 8));
+                    v3 = xxhRound(v3, read64(p + 16));
+                    v4 = xxhRound(v4, read64(p + 24));
+                    p += 32;
+                } while (p <= pLimit);
+
+                h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+                h = xxhMergeRound(h, v1);
+                h = xxhMergeRound(h, v2);
+                h = xxhMergeRound(h, v3);
+                h = xxhMergeRound(h, v4);
+            }
+            else
+            {
+                h = seed + kPrime5;
+            }
+
+            h += (uint64_t)size;
+
+            for (; p + 8 <= pEnd; p += 8)
+            {
+                h ^= xxhRound(0, read64(p));
+                h = rotl(h, 27) * kPrime1 + kPrime4;
+            }
+            if (p + 4 <= pEnd)
+            {
+                h ^= (uint64_t)read32(p) * kPrime1;
+                h = rotl(h, 23) * kPrime2 + kPrime3;
+                p += 4;
+            }
+            for (; p < pEnd; p++)
+            {
+                h ^= (*p) * kPrime5;
+                h = rotl(h, 11) * kPrime1;
+            }
+
+            h ^= h >> 33;
+            h *= kPrime2;
+            h ^= h >> 29;
+            h *= kPrime3;
+            h ^= h >> 32;
+            return h;
+        }
+
+        /** Add a block of memory to the running hash. Each block is hashed seeded with the hash of the blocks before it.
+        */
+        void add(const void* pData, size_t size) { mHash = hash(pData, size, mHash); }
+
+        template<typename T>
+        void add(const T& val) { add(&val, sizeof(T)); }
+
+        uint64_t get() const { return mHash; }
+
+    private:
+        static const uint64_t kPrime1 = 11400714785074694791ull;
+        static const uint64_t kPrime2 = 14029467366897019727ull;
+        static const uint64_t kPrime3 = 1609587929392839161ull;
+        static const uint64_t kPrime4 = 9650029242287828579ull;
+        static const uint64_t kPrime5 = 2870177450012600261ull;
+
+        static uint64_t rotl(uint64_t x, uint32_t r) { return (x << r) | (x >> (64 - r)); }
+
+        static uint64_t read64(const uint8_t* p)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        static uint32_t read32(const uint8_t* p)
+        {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        static uint64_t xxhRound(uint64_t acc, uint64_t input)
+        {
+            acc += input * kPrime2;
+            acc = rotl(acc, 31);
+            return acc * kPrime1;
+        }
+
+        static uint64_t xxhMergeRound(uint64_t acc, uint64_t val)
+        {
+            acc ^= xxhRound(0, val);
+            return acc * kPrime1 + kPrime4;
+        }
+
+        uint64_t mHash = 0;
+    };
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "AliasTable.h"
+#include <cmath>
+
+namespace Falcor
+{
+    void AliasTable::build(const std::vector<float>& weights)
+    {
+        const uint32_t count = (uint32_t)weights.size();
+        mEntries.resize(count);
+        mWeightSum = 0;
+        for (float w : weights)
+        {
+            if (w > 0 && std::isfinite(w)) mWeightSum += w;
+        }
+
+        // Scale the probabilities so that the average is 1, then pair each entry below 1 with one above it
+        std::vector<double> scaled(count);
+        std::vector<uint32_t> small, large;
+        small.reserve(count);
+        large.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const float w = weights[i];
+            const double p = (mWeightSum > 0) ? ((w > 0 && std::isfinite(w)) ? double(w) / mWeightSum : 0.0) : 1.0 / count;
+            mEntries[i].pdf = float(p);
+            mEntries[i].alias = i;
+            mEntries[i].pad = 0;
+            scaled[i] = p * count;
+            if (scaled[i] < 1.0) small.push_back(i);
+            else large.push_back(i);
+        }
+
+        while (small.empty() == false && large.empty() == false)
+        {
+            const uint32_t s = small.back();
+            small.pop_back();
+            const uint32_t l = large.back();
+            mEntries[s].threshold = float(scaled[s]);
+            mEntries[s].alias = l;
+
+            // The large entry gives away what fills up the small one
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+
+        // What's left is 1 up to rounding errors
+        for (uint32_t i : large) mEntries[i].threshold = 1.0f;
+        for (uint32_t i : small) mEntries[i].threshold = 1.0f;
+    }
+}
@@ -0,0 +1,88 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <algorithm>
+#include <vector>
+
+namespace Falcor
+{
+    /** Samples indices in proportion to a set of weights in constant time, with Vose's alias method.
+        Each entry holds a threshold and an alias. A sample picks an entry uniformly, and returns the entry's own index if the fractional part of the
+        pick is below the threshold, or its alias otherwise. Both come from a single uniform number, so the GPU can sample the same table with one random number.
+    */
+    class AliasTable
+    {
+    public:
+        /** One entry per index. The layout is shared with the shaders, which read the table as 16-byte elements.
+        */
+        struct Entry
+        {
+            float threshold;    ///< Probability of keeping this index rather than the alias
+            uint32_t alias;
+            float pdf;          ///< Probability of sampling this index
+            uint32_t pad;
+        };
+
+        /** Build the table. Negative and non-finite weights count as 0. If all weights are 0, the indices are sampled uniformly.
+        */
+        void build(const std::vector<float>& weights);
+
+        /** Sample an index
+            \param[in] u Uniform number in [0, 1)
+            \param[out] pdf Probability of the sampled index
+        */
+        uint32_t sample(float u, float& pdf) const
+        {
+            const uint32_t index = sample(mEntries.data(), (uint32_t)mEntries.size(), u);
+            pdf = mEntries[index].pdf;
+            return index;
+        }
+
+        /** Sample an index from entries stored elsewhere, e.g. a row of a larger table
+            \param[in] pEntries The entries of a table built by build()
+            \param[in] count Number of entries. Must be at least 1.
+            \param[in] u Uniform number in [0, 1)
+        */
+        static uint32_t sample(const Entry* pEntries, uint32_t count, float u)
+        {
+            const float scaled = u * float(count);
+            uint32_t index = std::min(uint32_t(scaled), count - 1);
+            if (scaled - float(index) >= pEntries[index].threshold) index = pEntries[index].alias;
+            return index;
+        }
+
+        float getPdf(uint32_t index) const { return mEntries[index].pdf; }
+        uint32_t getSize() const { return (uint32_t)mEntries.size(); }
+        double getWeightSum() const { return mWeightSum; }
+        const std::vector<Entry>& getEntries() const { return mEntries; }
+
+    private:
+        std::vector<Entry> mEntries;
+        double mWeightSum = 0;
+    };
+}
@@ -0,0 +1,690 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TriangleBvh.h"
+#include "Utils/ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kTraversalCost = 1.0f;
+        const float kIntersectionCost = 1.0f;
+
+        // Below this depth, nodes are split at the centroid median instead of with SAH. This bounds the depth to kSahDepthLimit + 32.
+        const uint32_t kSahDepthLimit = 64;
+
+        // Traversal stacks hold this many entries before spilling to the heap
+        const uint32_t kStackSize = 128;
+
+        // Ranges smaller than this aren't worth a task of their own
+        const uint32_t kMinTaskSize = 4096;
+
+        const uint32_t kBinCount = TriangleBvh::kBinCount;
+
+        struct Aabb
+        {
+            glm::vec3 min = glm::vec3(FLT_MAX);
+            glm::vec3 max = glm::vec3(-FLT_MAX);
+
+            void grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+            void grow(const Aabb& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+
+            float area() const
+            {
+                if (min.x > max.x) return 0;
+                glm::vec3 d = max - min;
+                return d.x * d.y + d.y * d.z + d.z * d.x;
+            }
+        };
+
+        Aabb getBounds(const TriangleBvh::Triangle& tri)
+        {
+            Aabb bounds;
+            bounds.grow(tri.v0);
+            bounds.grow(tri.v1);
+            bounds.grow(tri.v2);
+            return bounds;
+        }
+
+        Aabb getBounds(const TriangleBvh::Node& node)
+        {
+            Aabb bounds;
+            bounds.min = node.boundsMin;
+            bounds.max = node.boundsMax;
+            return bounds;
+        }
+
+        /** Build state shared by the threads. Each subtree owns a range of ids.
+        */
+        struct BuildData
+        {
+            std::vector<Aabb> bounds;
+            std::vector<glm::vec3> centroids;
+            std::vector<uint32_t> ids;      ///< Triangle indices, partitioned in place as the nodes are split
+        };
+
+        struct SubtreeTask
+        {
+            uint32_t nodeIndex;
+            uint32_t first;
+            uint32_t count;
+            uint32_t depth;
+        };
+
+        /** Traversal stack. It lives on the stack for the depths the builder produces, and only spills to the heap if a tree is deeper than that.
+        */
+        template<typename T>
+        class TraversalStack
+        {
+        public:
+            bool empty() const { return mSize == 0; }
+
+            void push(const T& value)
+            {
+                if (mSize < kStackSize) mLocal[mSize] = value;
+                else mOverflow.push_back(value);
+                mSize++;
+            }
+
+            T pop()
+            {
+                mSize--;
+                if (mSize < kStackSize) return mLocal[mSize];
+                const T value = mOverflow.back();
+                mOverflow.pop_back();
+                return value;
+            }
+
+        private:
+            T mLocal[kStackSize];
+            std::vector<T> mOverflow;
+            uint32_t mSize = 0;
+        };
+
+        /** Partition a range of triangles in two
+            \return The number of triangles in the first child, or 0 to make a leaf
+        */
+        uint32_t splitRange(BuildData& data, uint32_t first, uint32_t count, const Aabb& bounds, uint32_t depth)
+        {
+            if (count <= 1) return 0;
+
+            Aabb centroidBounds;
+            for (uint32_t i = first; i < first + count; i++) centroidBounds.grow(data.centroids[data.ids[i]]);
+            const glm::vec3 centroidExtent = centroidBounds.max - centroidBounds.min;
+            auto idBegin = data.ids.begin() + first;
+            auto idEnd = idBegin + count;
+
+            if (depth < kSahDepthLimit)
+            {
+                // Bin the centroids along each axis, and evaluate the SAH at the bin boundaries
+                float bestCost = FLT_MAX;
+                int bestAxis = -1;
+                uint32_t bestBin = 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if (centroidExtent[axis] <= 0) continue;
+                    const float scale = kBinCount / centroidExtent[axis];
+                    Aabb binBounds[kBinCount];
+                    uint32_t binCounts[kBinCount] = {};
+                    for (uint32_t i = first; i < first + count; i++)
+                    {
+                        const uint32_t id = data.ids[i];
+                        const uint32_t bin = std::min(kBinCount - 1, uint32_t((data.centroids[id][axis] - centroidBounds.min[axis]) * scale));
+                        binCounts[bin]++;
+                        binBounds[bin].grow(data.bounds[id]);
+                    }
+
+                    float rightArea[kBinCount];
+                    uint32_t rightCount[kBinCount];
+                    Aabb accumulated;
+                    uint32_t accumulatedCount = 0;
+                    for (uint32_t bin = kBinCount - 1; bin > 0; bin--)
+                    {
+                        accumulated.grow(binBounds[bin]);
+                        accumulatedCount += binCounts[bin];
+                        rightArea[bin] = accumulated.area();
+                        rightCount[bin] = accumulatedCount;
+                    }
+
+                    accumulated = Aabb();
+                    accumulatedCount = 0;
+                    for (uint32_t bin = 1; bin < kBinCount; bin++)
+                    {
+                        accumulated.grow(binBounds[bin - 1]);
+                        accumulatedCount += binCounts[bin - 1];
+                        if (accumulatedCount == 0 || rightCount[bin] == 0) continue;
+                        const float cost = accumulated.area() * accumulatedCount + rightArea[bin] * rightCount[bin];
+                        if (cost < bestCost)
+                        {
+                            bestCost = cost;
+                            bestAxis = axis;
+                            bestBin = bin;
+                        }
+                    }
+                }
+
+                if (bestAxis >= 0)
+                {
+                    const float parentArea = bounds.area();
+                    const float splitCost = (parentArea > 0) ? kTraversalCost + kIntersectionCost * bestCost / parentArea : 0;
+                    if (count <= TriangleBvh::kMaxLeafSize && splitCost >= kIntersectionCost * count) return 0;
+
+                    const float scale = kBinCount / centroidExtent[bestAxis];
+                    const float binMin = centroidBounds.min[bestAxis];
+                    auto mid = std::partition(idBegin, idEnd, [&](uint32_t id)
+                    {
+                        return std::min(kBinCount - 1, uint32_t((data.centroids[id][bestAxis] - binMin) * scale)) < bestBin;
+                    });
+                    const uint32_t leftCount = uint32_t(mid - idBegin);
+                    if (leftCount > 0 && leftCount < count) return leftCount;
+                }
+                else if (count <= TriangleBvh::kMaxLeafSize)
+                {
+                    // All centroids coincide
+                    return 0;
+                }
+            }
+
+            // Split at the median centroid along the longest axis
+            int axis = 0;
+            if (centroidExtent.y > centroidExtent[axis]) axis = 1;
+            if (centroidExtent.z > centroidExtent[axis]) axis = 2;
+            const uint32_t leftCount = count / 2;
+            std::nth_element(idBegin, idBegin + leftCount, idEnd, [&](uint32_t a, uint32_t b) { return data.centroids[a][axis] < data.centroids[b][axis]; });
+            return leftCount;
+        }
+
+        /** Build the subtree of a node. When pTasks is set, ranges of at most taskSize triangles are added to it instead of being built.
+        */
+        void buildNode(BuildData& data, std::vector<TriangleBvh::Node>& nodes, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth, uint32_t taskSize, std::vector<SubtreeTask>* pTasks)
+        {
+            if (pTasks && count <= taskSize)
+            {
+                pTasks->push_back({ nodeIndex, first, count, depth });
+                return;
+            }
+
+            Aabb bounds;
+            for (uint32_t i = first; i < first + count; i++) bounds.grow(data.bounds[data.ids[i]]);
+            nodes[nodeIndex].boundsMin = bounds.min;
+            nodes[nodeIndex].boundsMax = bounds.max;
+
+            const uint32_t leftCount = splitRange(data, first, count, bounds, depth);
+            if (leftCount == 0)
+            {
+                nodes[nodeIndex].index = first;
+                nodes[nodeIndex].triangleCount = count;
+                return;
+            }
+
+            const uint32_t child = (uint32_t)nodes.size();
+            nodes.resize(child + 2);
+            nodes[nodeIndex].index = child;
+            nodes[nodeIndex].triangleCount = 0;
+            buildNode(data, nodes, child, first, leftCount, depth + 1, taskSize, pTasks);
+            buildNode(data, nodes, child + 1, first + leftCount, count - leftCount, depth + 1, taskSize, pTasks);
+        }
+
+        bool intersectTriangle(const TriangleBvh::Triangle& tri, const glm::vec3& origin, const glm::vec3& direction, float tMax, TriangleBvh::RayHit& hit)
+        {
+            // Moller-Trumbore
+            const glm::vec3 e1 = tri.v1 - tri.v0;
+            const glm::vec3 e2 = tri.v2 - tri.v0;
+            const glm::vec3 p = glm::cross(direction, e2);
+            const float det = glm::dot(e1, p);
+            if (det == 0) return false;
+
+            const float invDet = 1.0f / det;
+            const glm::vec3 s = origin - tri.v0;
+            const float u = glm::dot(s, p) * invDet;
+            if (u < 0 || u > 1) return false;
+            const glm::vec3 q = glm::cross(s, e1);
+            const float v = glm::dot(direction, q) * invDet;
+            if (v < 0 || u + v > 1) return false;
+            const float t = glm::dot(e2, q) * invDet;
+            if (t < 0 || t >= tMax) return false;
+
+            hit.t = t;
+            hit.u = u;
+            hit.v = v;
+            return true;
+        }
+
+        /** Slab test. Returns the entry distance, or FLT_MAX if the box is missed.
+        */
+        float intersectBox(const TriangleBvh::Node& node, const glm::vec3& origin, const glm::vec3& invDirection, float tMax)
+        {
+            const glm::vec3 t0 = (node.boundsMin - origin) * invDirection;
+            const glm::vec3 t1 = (node.boundsMax - origin) * invDirection;
+            const glm::vec3 tNear = glm::min(t0, t1);
+            const glm::vec3 tFar = glm::max(t0, t1);
+            const float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+            return (entry <= exit) ? entry : FLT_MAX;
+        }
+
+        glm::vec3 getInverseDirection(const glm::vec3& direction)
+        {
+            // Avoid infinities, which turn into NaNs when the origin is on a slab
+            glm::vec3 inv;
+            for (int i = 0; i < 3; i++) inv[i] = 1.0f / ((direction[i] != 0) ? direction[i] : 1e-20f);
+            return inv;
+        }
+
+        /** From Real-Time Collision Detection, 5.1.5
+        */
+        glm::vec3 closestPointOnTriangle(const glm::vec3& p, const TriangleBvh::Triangle& tri)
+        {
+            const glm::vec3& a = tri.v0;
+            const glm::vec3& b = tri.v1;
+            const glm::vec3& c = tri.v2;
+            const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+            const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+            if (d1 <= 0 && d2 <= 0) return a;
+
+            const glm::vec3 bp = p - b;
+            const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+            if (d3 >= 0 && d4 <= d3) return b;
+
+            const float vc = d1 * d4 - d3 * d2;
+            if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + ab * (d1 / (d1 - d3));
+
+            const glm::vec3 cp = p - c;
+            const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+            if (d6 >= 0 && d5 <= d6) return c;
+
+            const float vb = d5 * d2 - d1 * d6;
+            if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + ac * (d2 / (d2 - d6));
+
+            const float va = d3 * d6 - d5 * d4;
+            if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+            const float denom = 1.0f / (va + vb + vc);
+            return a + ab * (vb * denom) + ac * (vc * denom);
+        }
+
+        float distanceSquared(const glm::vec3& p, const TriangleBvh::Node& node)
+        {
+            const glm::vec3 d = glm::max(glm::max(node.boundsMin - p, p - node.boundsMax), glm::vec3(0.0f));
+            return glm::dot(d, d);
+        }
+
+        /** A box is outside a plane if its corner furthest along the plane's normal is
+        */
+        bool isBoxOutside(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec4 planes[6])
+        {
+            for (uint32_t i = 0; i < 6; i++)
+            {
+                const glm::vec4& plane = planes[i];
+                const glm::vec3 corner(plane.x > 0 ? boxMax.x : boxMin.x, plane.y > 0 ? boxMax.y : boxMin.y, plane.z > 0 ? boxMax.z : boxMin.z);
+                if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w <= 0) return true;
+            }
+            return false;
+        }
+    }
+
+    void TriangleBvh::build(const std::vector<Triangle>& triangles, uint32_t maxThreads)
+    {
+        mNodes.clear();
+        mTriangles.clear();
+        mTriangleIds.clear();
+        const uint32_t count = (uint32_t)triangles.size();
+        if (count == 0) return;
+
+        BuildData data;
+        data.bounds.resize(count);
+        data.centroids.resize(count);
+        data.ids.resize(count);
+        const uint32_t kChunkSize = 16384;
+        parallelFor((count + kChunkSize - 1) / kChunkSize, [&](uint32_t chunk)
+        {
+            for (uint32_t i = chunk * kChunkSize; i < std::min(count, (chunk + 1) * kChunkSize); i++)
+            {
+                data.bounds[i] = getBounds(triangles[i]);
+                data.centroids[i] = (data.bounds[i].min + data.bounds[i].max) * 0.5f;
+                data.ids[i] = i;
+            }
+        }, maxThreads);
+
+        // Split the top of the tree on this thread, until the ranges are small enough to balance over the threads
+        const uint32_t threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        const uint32_t taskSize = (threadCount > 1) ? std::max(kMinTaskSize, count / (threadCount * 4)) : count;
+        std::vector<SubtreeTask> tasks;
+        mNodes.resize(1);
+        buildNode(data, mNodes, 0, 0, count, 0, taskSize, &tasks);
+
+        std::vector<std::vector<Node>> subtrees(tasks.size());
+        parallelFor((uint32_t)tasks.size(), [&](uint32_t t)
+        {
+            subtrees[t].resize(1);
+            buildNode(data, subtrees[t], 0, tasks[t].first, tasks[t].count, tasks[t].depth, 0, nullptr);
+        }, maxThreads);
+
+        // Append the subtrees. Their roots replace the task nodes, which keeps the children after their parents.
+        for (uint32_t t = 0; t < (uint32_t)tasks.size(); t++)
+        {
+            const uint32_t offset = (uint32_t)mNodes.size() - 1;
+            auto relocate = [offset](Node node)
+            {
+                if (node.isLeaf() == false) node.index += offset;
+                return node;
+            };
+            mNodes[tasks[t].nodeIndex] = relocate(subtrees[t][0]);
+            for (size_t i = 1; i < subtrees[t].size(); i++) mNodes.push_back(relocate(subtrees[t][i]));
+        }
+
+        mTriangleIds = std::move(data.ids);
+        mTriangles.resize(count);
+        for (uint32_t i = 0; i < count; i++) mTriangles[i] = triangles[mTriangleIds[i]];
+    }
+
+    void TriangleBvh::refit(const std::vector<Triangle>& triangles)
+    {
+        assert(triangles.size() == mTriangles.size());
+        for (uint32_t i = 0; i < (uint32_t)mTriangles.size(); i++) mTriangles[i] = triangles[mTriangleIds[i]];
+
+        // Children come after their parents
+        for (size_t n = mNodes.size(); n-- > 0;)
+        {
+            Node& node = mNodes[n];
+            Aabb bounds;
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.index; i < node.index + node.triangleCount; i++) bounds.grow(getBounds(mTriangles[i]));
+            }
+            else
+            {
+                bounds = getBounds(mNodes[node.index]);
+                bounds.grow(getBounds(mNodes[node.index + 1]));
+            }
+            node.boundsMin = bounds.min;
+            node.boundsMax = bounds.max;
+        }
+    }
+
+    bool TriangleBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float tMax, RayHit& hit, const HitFilter& filter) const
+    {
+        if (mNodes.empty()) return false;
+        const glm::vec3 invDirection = getInverseDirection(direction);
+        bool found = false;
+        RayHit candidate;
+
+        // The entry distance is kept with each node, so that nodes behind a closer hit found meanwhile are skipped
+        struct Entry
+        {
+            uint32_t node;
+            float t;
+        };
+        TraversalStack<Entry> stack;
+        const float rootT = intersectBox(mNodes[0], origin, invDirection, tMax);
+        if (rootT == FLT_MAX) return false;
+        stack.push({ 0, rootT });
+        while (stack.empty() == false)
+        {
+            const Entry entry = stack.pop();
+            if (entry.t > tMax) continue;
+            const Node& node = mNodes[entry.node];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.index; i < node.index + node.triangleCount; i++)
+                {
+                    if (intersectTriangle(mTriangles[i], origin, direction, tMax, candidate))
+                    {
+                        candidate.triangle = mTriangleIds[i];
+                        if (filter && filter(candidate) == false) continue;
+                        tMax = candidate.t;
+                        hit = candidate;
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first
+            const float t0 = intersectBox(mNodes[node.index], origin, invDirection, tMax);
+            const float t1 = intersectBox(mNodes[node.index + 1], origin, invDirection, tMax);
+            const Entry nearChild = (t0 <= t1) ? Entry{ node.index, t0 } : Entry{ node.index + 1, t1 };
+            const Entry farChild = (t0 <= t1) ? Entry{ node.index + 1, t1 } : Entry{ node.index, t0 };
+            if (farChild.t != FLT_MAX) stack.push(farChild);
+            if (nearChild.t != FLT_MAX) stack.push(nearChild);
+        }
+        return found;
+    }
+
+    bool TriangleBvh::raycastAny(const glm::vec3& origin, const glm::vec3& direction, float tMax, const HitFilter& filter) const
+    {
+        if (mNodes.empty()) return false;
+        const glm::vec3 invDirection = getInverseDirection(direction);
+        RayHit candidate;
+
+        TraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.pop()];
+            if (intersectBox(node, origin, invDirection, tMax) == FLT_MAX) continue;
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.index; i < node.index + node.triangleCount; i++)
+                {
+                    if (intersectTriangle(mTriangles[i], origin, direction, tMax, candidate) == false) continue;
+                    candidate.triangle = mTriangleIds[i];
+                    if (filter == nullptr || filter(candidate)) return true;
+                }
+                continue;
+            }
+            stack.push(node.index + 1);
+            stack.push(node.index);
+        }
+        return false;
+    }
+
+    uint32_t TriangleBvh::raycastPacket(const glm::vec3 origins[kPacketSize], const glm::vec3 directions[kPacketSize], uint32_t rayMask, float tMax, RayHit hits[kPacketSize], const HitFilter& filter) const
+    {
+        static_assert(kPacketSize == 4, "The packet is traced with 4-wide SSE");
+        rayMask &= (1u << kPacketSize) - 1;
+        if (mNodes.empty() || rayMask == 0) return 0;
+
+        // The rays in SoA layout. Unused rays get a negative tMax, so that they miss every box.
+        glm::vec3 invDirections[kPacketSize];
+        float rayTMax[kPacketSize];
+        float soa[6][kPacketSize];
+        for (uint32_t r = 0; r < kPacketSize; r++)
+        {
+            invDirections[r] = getInverseDirection(directions[r]);
+            rayTMax[r] = (rayMask & (1u << r)) ? tMax : -1.0f;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                soa[axis][r] = origins[r][axis];
+                soa[3 + axis][r] = invDirections[r][axis];
+            }
+        }
+        const __m128 originX = _mm_loadu_ps(soa[0]), originY = _mm_loadu_ps(soa[1]), originZ = _mm_loadu_ps(soa[2]);
+        const __m128 invX = _mm_loadu_ps(soa[3]), invY = _mm_loadu_ps(soa[4]), invZ = _mm_loadu_ps(soa[5]);
+        __m128 packetTMax = _mm_loadu_ps(rayTMax);
+
+        // The slab test of intersectBox(), for the 4 rays at once. Returns the mask of the rays which enter the box before their closest hit.
+        auto intersectPacket = [&](const Node& node)
+        {
+            const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.x), originX), invX);
+            const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.y), originY), invY);
+            const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.z), originZ), invZ);
+            const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.x), originX), invX);
+            const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.y), originY), invY);
+            const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.z), originZ), invZ);
+            const __m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+            const __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), packetTMax));
+            return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(entry, exit));
+        };
+
+        // Children are ordered along the direction of the first ray, which stands for the packet
+        uint32_t firstRay = 0;
+        while ((rayMask & (1u << firstRay)) == 0) firstRay++;
+        const glm::vec3& packetDirection = directions[firstRay];
+
+        uint32_t hitMask = 0;
+        RayHit candidate;
+        TraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (stack.empty() == false)
+        {
+            // Boxes are tested when they are popped, so that hits found meanwhile prune them
+            const Node& node = mNodes[stack.pop()];
+            const uint32_t activeMask = intersectPacket(node);
+            if (activeMask == 0) continue;
+
+            if (node.isLeaf())
+            {
+                for (uint32_t r = 0; r < kPacketSize; r++)
+                {
+                    if ((activeMask & (1u << r)) == 0) continue;
+                    for (uint32_t i = node.index; i < node.index + node.triangleCount; i++)
+                    {
+                        if (intersectTriangle(mTriangles[i], origins[r], directions[r], rayTMax[r], candidate) == false) continue;
+                        candidate.triangle = mTriangleIds[i];
+                        if (filter && filter(candidate) == false) continue;
+                        rayTMax[r] = candidate.t;
+                        hits[r] = candidate;
+                        hitMask |= 1u << r;
+                    }
+                }
+                packetTMax = _mm_loadu_ps(rayTMax);
+                continue;
+            }
+
+            const Node& child0 = mNodes[node.index];
+            const Node& child1 = mNodes[node.index + 1];
+            const glm::vec3 centerDelta = (child1.boundsMin + child1.boundsMax) - (child0.boundsMin + child0.boundsMax);
+            const bool child0First = glm::dot(centerDelta, packetDirection) >= 0;
+            stack.push(child0First ? node.index + 1 : node.index);
+            stack.push(child0First ? node.index : node.index + 1);
+        }
+        return hitMask;
+    }
+
+    bool TriangleBvh::closestPoint(const glm::vec3& point, float maxDistance, PointHit& hit) const
+    {
+        if (mNodes.empty()) return false;
+        float bestDistanceSquared = maxDistance * maxDistance;
+        bool found = false;
+
+        TraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.pop()];
+            if (distanceSquared(point, node) > bestDistanceSquared) continue;
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.index; i < node.index + node.triangleCount; i++)
+                {
+                    const glm::vec3 candidate = closestPointOnTriangle(point, mTriangles[i]);
+                    const glm::vec3 d = candidate - point;
+                    const float dSquared = glm::dot(d, d);
+                    if (dSquared <= bestDistanceSquared)
+                    {
+                        bestDistanceSquared = dSquared;
+                        hit.point = candidate;
+                        hit.triangle = mTriangleIds[i];
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first, so that the other one is more likely to be pruned
+            const float d0 = distanceSquared(point, mNodes[node.index]);
+            const float d1 = distanceSquared(point, mNodes[node.index + 1]);
+            stack.push((d0 <= d1) ? node.index + 1 : node.index);
+            stack.push((d0 <= d1) ? node.index : node.index + 1);
+        }
+
+        if (found) hit.distance = std::sqrt(bestDistanceSquared);
+        return found;
+    }
+
+    void TriangleBvh::overlapFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& triangles) const
+    {
+        triangles.clear();
+        if (mNodes.empty()) return;
+
+        TraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.pop()];
+            if (isBoxOutside(node.boundsMin, node.boundsMax, planes)) continue;
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.index; i < node.index + node.triangleCount; i++)
+                {
+                    const Aabb bounds = getBounds(mTriangles[i]);
+                    if (isBoxOutside(bounds.min, bounds.max, planes) == false) triangles.push_back(mTriangleIds[i]);
+                }
+                continue;
+            }
+            stack.push(node.index + 1);
+            stack.push(node.index);
+        }
+    }
+
+    TriangleBvh::Stats TriangleBvh::getStats() const
+    {
+        Stats stats;
+        stats.nodeCount = (uint32_t)mNodes.size();
+        if (mNodes.empty()) return stats;
+
+        const float rootArea = std::max(getBounds(mNodes[0]).area(), FLT_MIN);
+        std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 1 } };
+        while (stack.size())
+        {
+            const uint32_t nodeIndex = stack.back().first;
+            const uint32_t depth = stack.back().second;
+            stack.pop_back();
+            const Node& node = mNodes[nodeIndex];
+            const float areaRatio = getBounds(node).area() / rootArea;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+            if (node.isLeaf())
+            {
+                stats.leafCount++;
+                stats.sahCost += areaRatio * kIntersectionCost * node.triangleCount;
+            }
+            else
+            {
+                stats.sahCost += areaRatio * kTraversalCost;
+                stack.push_back({ node.index, depth + 1 });
+                stack.push_back({ node.index + 1, depth + 1 });
+            }
+        }
+        return stats;
+    }
+}
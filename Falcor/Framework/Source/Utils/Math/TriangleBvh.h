@@ -0,0 +1,159 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+namespace Falcor
+{
+    /** A bounding volume hierarchy over triangles, for spatial queries on the CPU.
+        The tree is built with binned SAH. The top levels are split on the calling thread, the subtrees below them are built on worker threads.
+        Nodes are 32 bytes, and the two children of a node are adjacent, so that a node only stores the index of its first child.
+        Moved triangles are handled with refit(), which keeps the topology and recomputes the bounds. The tree degrades when triangles move far, in which case build() it again.
+    */
+    class TriangleBvh
+    {
+    public:
+        /** Number of bins per axis used to evaluate the SAH
+        */
+        static const uint32_t kBinCount = 16;
+
+        /** Leaves with more triangles than this are always split
+        */
+        static const uint32_t kMaxLeafSize = 8;
+
+        /** Number of rays traced together by raycastPacket()
+        */
+        static const uint32_t kPacketSize = 4;
+
+        struct Triangle
+        {
+            glm::vec3 v0, v1, v2;
+        };
+
+        struct Node
+        {
+            glm::vec3 boundsMin;
+            uint32_t index;             ///< For leaves, the first triangle in leaf order. For interior nodes, the first child. The second child is at index + 1.
+            glm::vec3 boundsMax;
+            uint32_t triangleCount;     ///< 0 for interior nodes
+
+            bool isLeaf() const { return triangleCount != 0; }
+        };
+
+        struct RayHit
+        {
+            float t;
+            float u, v;                 ///< Barycentrics of v1 and v2
+            uint32_t triangle;          ///< Index of the triangle in the array passed to build()
+        };
+
+        /** Called for each triangle a ray hits, before the hit is accepted. Return false to ignore the hit, e.g. where an alpha test fails.
+        */
+        using HitFilter = std::function<bool(const RayHit& hit)>;
+
+        struct PointHit
+        {
+            glm::vec3 point;
+            float distance;
+            uint32_t triangle;
+        };
+
+        struct Stats
+        {
+            uint32_t nodeCount = 0;
+            uint32_t leafCount = 0;
+            uint32_t maxDepth = 0;
+            float sahCost = 0;          ///< Expected cost of a random ray, counting one per node visit and one per triangle test
+        };
+
+        /** Build the tree
+            \param[in] triangles The triangles. Degenerate triangles are allowed.
+            \param[in] maxThreads Maximum number of threads to use, including the calling thread. 0 uses one thread per hardware thread.
+        */
+        void build(const std::vector<Triangle>& triangles, uint32_t maxThreads = 0);
+
+        /** Update the bounds to triangles which moved, keeping the topology
+            \param[in] triangles The triangles, in the same order and with the same count as passed to build()
+        */
+        void refit(const std::vector<Triangle>& triangles);
+
+        /** Find the closest triangle a ray hits
+            \param[in] origin The ray's origin
+            \param[in] direction The ray's direction. It doesn't need to be normalized. t is measured in units of its length.
+            \param[in] tMax Hits beyond this are ignored
+            \param[out] hit The closest hit
+            \param[in] filter Optional. Called for each hit before it is accepted.
+            \return Whether a triangle was hit
+        */
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float tMax, RayHit& hit, const HitFilter& filter = nullptr) const;
+
+        /** Check whether a ray hits any triangle before tMax, e.g. for visibility
+        */
+        bool raycastAny(const glm::vec3& origin, const glm::vec3& direction, float tMax, const HitFilter& filter = nullptr) const;
+
+        /** Find the closest triangles a packet of rays hits. The rays share the traversal, which is faster than raycast() for coherent rays, e.g. the primary rays of neighboring pixels.
+            \param[in] origins The rays' origins
+            \param[in] directions The rays' directions, as for raycast()
+            \param[in] rayMask The rays to trace. Bit i is set to trace ray i.
+            \param[in] tMax Hits beyond this are ignored
+            \param[out] hits The closest hits. Only written for the rays which hit.
+            \param[in] filter Optional. Called for each hit before it is accepted.
+            \return The mask of the rays which hit
+        */
+        uint32_t raycastPacket(const glm::vec3 origins[kPacketSize], const glm::vec3 directions[kPacketSize], uint32_t rayMask, float tMax, RayHit hits[kPacketSize], const HitFilter& filter = nullptr) const;
+
+        /** Find the closest point on the triangles
+            \param[in] point The query point
+            \param[in] maxDistance Points further than this are ignored
+            \param[out] hit The closest point
+            \return Whether a point was found within maxDistance
+        */
+        bool closestPoint(const glm::vec3& point, float maxDistance, PointHit& hit) const;
+
+        /** Find the triangles whose bounding boxes overlap a frustum
+            \param[in] planes The frustum planes, as returned by Camera::getFrustumPlane(). A point p is inside a plane if dot(plane.xyz, p) + plane.w > 0.
+            \param[out] triangles The indices of the overlapping triangles, in no particular order
+        */
+        void overlapFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& triangles) const;
+
+        uint32_t getTriangleCount() const { return (uint32_t)mTriangles.size(); }
+        const std::vector<Node>& getNodes() const { return mNodes; }
+
+        /** Compute the tree statistics
+        */
+        Stats getStats() const;
+
+    private:
+        std::vector<Node> mNodes;
+        std::vector<Triangle> mTriangles;       ///< In leaf order
+        std::vector<uint32_t> mTriangleIds;     ///< The original index of each triangle in leaf order
+    };
+}
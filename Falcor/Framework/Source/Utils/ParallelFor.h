@@ -0,0 +1,66 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    /** Call func(i) for every i in [0, count) on a set of worker threads, and return once all calls finished.
+        Indices are handed out one at a time, so uneven workloads balance out. The calling thread takes part in the work.
+        func must be safe to call concurrently for different indices. It must not call into the GPU API, since Falcor's contexts are not thread-safe.
+        \param[in] count Number of indices
+        \param[in] func Callable taking a uint32_t index
+        \param[in] maxThreads Maximum number of threads to use, including the calling thread. 0 uses one thread per hardware thread.
+    */
+    template<typename Func>
+    void parallelFor(uint32_t count, const Func& func, uint32_t maxThreads = 0)
+    {
+        uint32_t threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min(threadCount, count);
+        if (threadCount <= 1)
+        {
+            for (uint32_t i = 0; i < count; i++) func(i);
+            return;
+        }
+
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]()
+        {
+            for (uint32_t i = next++; i < count; i = next++) func(i);
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (uint32_t t = 1; t < threadCount; t++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+    }
+}
@@ -37,6 +37,7 @@
 #include <gtk/gtk.h>
 #include <fstream>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <libgen.h>
 #include <errno.h>
 #include <algorithm>
@@ -201,6 +202,33 @@ namespace Falcor
         should_not_get_here();
     }
 
+    const void* mapFileForReading(const std::string& filename, size_t& size)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        void* pData = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (pData == MAP_FAILED) return nullptr;
+
+        madvise(pData, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+        size = (size_t)fileStat.st_size;
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        if (pData) munmap(const_cast<void*>(pData), size);
+    }
+
     std::string getTempFilename()
     {
         std::string filePath = std::experimental::filesystem::temp_directory_path();
@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Utils/Platform/OS.h"
 #include "Utils/StringUtils.h"
+#include <algorithm>
 #include <fstream>
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
@@ -204,4 +205,39 @@ namespace Falcor
         str.assign(std::istreambuf_iterator<char>(filestream), std::istreambuf_iterator<char>());
         return str;
     }
-}
\ No newline at end of file
+
+    void evictLeastRecentlyUsedFiles(const std::string& directory, const std::string& extension, uint64_t sizeLimit, const std::string& keepFilename)
+    {
+        struct Entry
+        {
+            fs::path path;
+            uint64_t size;
+            fs::file_time_type lastUse;
+        };
+        std::vector<Entry> entries;
+        uint64_t totalSize = 0;
+
+        std::error_code ec;
+        for(fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+        {
+            const fs::path& path = it->path();
+            if(path.extension() != extension) continue;
+
+            std::error_code entryEc;
+            Entry entry = { path, fs::file_size(path, entryEc), fs::last_write_time(path, entryEc) };
+            if(entryEc) continue;
+            totalSize += entry.size;
+            entries.push_back(entry);
+        }
+        if(totalSize <= sizeLimit) return;
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+        fs::path keepPath(keepFilename);
+        for(const Entry& entry : entries)
+        {
+            if(totalSize <= sizeLimit) break;
+            if(fs::equivalent(entry.path, keepPath, ec)) continue;
+            if(fs::remove(entry.path, ec)) totalSize -= entry.size;
+        }
+    }
+}
@@ -135,6 +135,28 @@ namespace Falcor
     */
     void closeSharedFile(const std::string& filePath);
 
+    /** Map a file into memory for reading.
+        \param[in] filename Full path to the file
+        \param[out] size On success, will hold the size of the file in bytes
+        \return Pointer to the start of the mapped file, or nullptr if the file can't be mapped. Release the view with unmapFile().
+    */
+    const void* mapFileForReading(const std::string& filename, size_t& size);
+
+    /** Release a view created by mapFileForReading().
+        \param[in] pData Pointer returned by mapFileForReading()
+        \param[in] size Size returned by mapFileForReading()
+    */
+    void unmapFile(const void* pData, size_t size);
+
+    /** Remove the least recently written files with an extension from a directory, until the files with that extension fit in a size limit.
+        Used by the disk caches, which rewrite the timestamp of an entry whenever it is used.
+        \param[in] directory The directory holding the files
+        \param[in] extension Extension of the files to consider, including the dot
+        \param[in] sizeLimit Maximum total size of the files in bytes
+        \param[in] keepFilename A file which is never removed, e.g. the cache entry that was just written
+    */
+    void evictLeastRecentlyUsedFiles(const std::string& directory, const std::string& extension, uint64_t sizeLimit, const std::string& keepFilename);
+
     /** Creates a file in the temperary directory and returns the path.
         \return pathName Absolute path to unique temp file.  
     */
@@ -405,6 +405,35 @@ namespace Falcor
         }
     }
 
+    const void* mapFileForReading(const std::string& filename, size_t& size)
+    {
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) return nullptr;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(hFile);
+            return nullptr;
+        }
+
+        // The view keeps the mapping alive, so both handles can be closed right away
+        HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(hFile);
+        if (hMapping == nullptr) return nullptr;
+
+        const void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping);
+        if (pData) size = (size_t)fileSize.QuadPart;
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        (void)size;
+        if (pData) UnmapViewOfFile(pData);
+    }
+
     void enumerateFiles(std::string searchString, std::vector<std::string>& filenames)
     {
         WIN32_FIND_DATAA ffd;
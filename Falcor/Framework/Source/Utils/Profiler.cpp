@@ -28,12 +28,15 @@
 #include "Framework.h"
 #include "Profiler.h"
 #include "API/GpuTimer.h"
+#include "API/Device.h"
 #include "API/LowLevel/FencedPool.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <cstdio>
+#include <thread>
 
 namespace Falcor
 {
@@ -46,6 +49,224 @@ namespace Falcor
 
     std::hash<std::string> HashedString::hashFunc;
 
+    namespace
+    {
+        /** State of a timeline trace capture. Only touched by the profiler, so it has the profiler's threading rules.
+        */
+        struct TraceCapture
+        {
+            enum class State
+            {
+                Idle,       // No capture requested
+                Pending,    // Requested, recording starts at the next endFrame()
+                Recording,  // Recording CPU events and GPU timer indices
+                Draining    // All frames recorded, waiting one frame for the GPU timers of the last frame
+            };
+
+            struct CpuEvent
+            {
+                const Profiler::EventData* pEvent;
+                CpuTimer::TimePoint time;
+                uint32_t thread;
+                bool begin;
+            };
+
+            struct PendingGpuEvent
+            {
+                const Profiler::EventData* pEvent;
+                size_t timerIndex;
+                uint32_t frame;
+            };
+
+            struct GpuEvent
+            {
+                const Profiler::EventData* pEvent;
+                uint64_t startTick;
+                uint64_t endTick;
+                uint32_t frame;
+            };
+
+            State state = State::Idle;
+            uint32_t frameCount = 0;
+            std::string filename;
+            bool restoreProfileEnabled = false;
+
+            CpuTimer::TimePoint captureStart;
+            CpuTimer::TimePoint frameStart;
+            std::vector<std::pair<CpuTimer::TimePoint, CpuTimer::TimePoint>> frames;
+            std::vector<std::thread::id> threads;
+            std::vector<CpuEvent> cpuEvents;
+            std::vector<PendingGpuEvent> pendingGpuEvents[2];   // Indexed by the profiler's GPU timer buffer
+            std::vector<GpuEvent> gpuEvents;
+
+            bool hasClockCalibration = false;
+            uint64_t calibrationGpuTick = 0;
+            CpuTimer::TimePoint calibrationCpuTime;
+        };
+
+        TraceCapture sTrace;
+
+        uint32_t getTraceThread()
+        {
+            std::thread::id id = std::this_thread::get_id();
+            for (size_t i = 0; i < sTrace.threads.size(); i++)
+            {
+                if (sTrace.threads[i] == id) return (uint32_t)i;
+            }
+            sTrace.threads.push_back(id);
+            return (uint32_t)sTrace.threads.size() - 1;
+        }
+
+        void recordTraceCpuEvent(const Profiler::EventData* pData, CpuTimer::TimePoint time, bool begin)
+        {
+            sTrace.cpuEvents.push_back({ pData, time, getTraceThread(), begin });
+        }
+
+        void resolveTraceGpuEvents(uint32_t bufferIndex)
+        {
+            for (const auto& pending : sTrace.pendingGpuEvents[bufferIndex])
+            {
+                const auto& timers = pending.pEvent->frameData[bufferIndex].pTimers;
+                TraceCapture::GpuEvent gpuEvent = { pending.pEvent, 0, 0, pending.frame };
+                if (pending.timerIndex < timers.size() && timers[pending.timerIndex]->getTimestamps(gpuEvent.startTick, gpuEvent.endTick))
+                {
+                    sTrace.gpuEvents.push_back(gpuEvent);
+                }
+            }
+            sTrace.pendingGpuEvents[bufferIndex].clear();
+        }
+
+        std::string escapeJson(const std::string& str)
+        {
+            std::string result;
+            result.reserve(str.size());
+            for (char c : str)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    result += '\\';
+                    result += c;
+                }
+                else if ((unsigned char)c < 0x20)
+                {
+                    char code[8];
+                    snprintf(code, sizeof(code), "\\u%04x", (unsigned)c);
+                    result += code;
+                }
+                else
+                {
+                    result += c;
+                }
+            }
+            return result;
+        }
+
+        bool writeTrace(const std::string& filename)
+        {
+            std::ofstream out(filename);
+            if (!out.good())
+            {
+                logError("Profiler: can't open trace file '" + filename + "' for writing");
+                return false;
+            }
+            out << std::fixed << std::setprecision(3);
+
+            auto cpuTimeUs = [](CpuTimer::TimePoint t) { return std::chrono::duration<double, std::micro>(t - sTrace.captureStart).count(); };
+
+            // Map GPU ticks onto the CPU timeline. Without a clock calibration, the first GPU event is aligned with the start of the capture, so only the GPU track's relative timing is exact.
+            uint64_t baseTick = sTrace.calibrationGpuTick;
+            double baseUs = cpuTimeUs(sTrace.calibrationCpuTime);
+            if (!sTrace.hasClockCalibration)
+            {
+                baseTick = sTrace.gpuEvents.empty() ? 0 : sTrace.gpuEvents[0].startTick;
+                baseUs = 0;
+                for (const auto& e : sTrace.gpuEvents) baseTick = std::min(baseTick, e.startTick);
+            }
+            double usPerTick = gpDevice ? gpDevice->getGpuTimestampFrequency() * 1000.0 : 0.0;
+            auto gpuTimeUs = [&](uint64_t tick) { return baseUs + double(int64_t(tick - baseTick)) * usPerTick; };
+
+            // Process 0 holds the frame track and one track per CPU thread, process 1 the GPU queue
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+            out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}},\n";
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"Frames\"}},\n";
+            for (size_t i = 0; i < sTrace.threads.size(); i++)
+            {
+                std::string name = (i == 0) ? "Render thread" : "Thread " + std::to_string(i);
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i + 1 << ",\"args\":{\"name\":\"" << name << "\"}},\n";
+            }
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Direct queue\"}}";
+
+            for (size_t i = 0; i < sTrace.frames.size(); i++)
+            {
+                double start = cpuTimeUs(sTrace.frames[i].first);
+                double end = cpuTimeUs(sTrace.frames[i].second);
+                out << ",\n{\"name\":\"Frame " << i << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << start << ",\"dur\":" << end - start << "}";
+            }
+
+            for (const auto& e : sTrace.cpuEvents)
+            {
+                out << ",\n{\"name\":\"" << escapeJson(e.pEvent->name) << "\",\"ph\":\"" << (e.begin ? 'B' : 'E') << "\",\"pid\":0,\"tid\":" << e.thread + 1 << ",\"ts\":" << cpuTimeUs(e.time) << "}";
+            }
+
+            for (const auto& e : sTrace.gpuEvents)
+            {
+                double start = gpuTimeUs(e.startTick);
+                double end = gpuTimeUs(e.endTick);
+                out << ",\n{\"name\":\"" << escapeJson(e.pEvent->name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << start << ",\"dur\":" << std::max(end - start, 0.0) << ",\"args\":{\"frame\":" << e.frame << "}}";
+            }
+            out << "\n]}\n";
+            return out.good();
+        }
+
+        void finishTraceCapture()
+        {
+            std::string filename = sTrace.filename;
+            if (filename.empty() && !findAvailableFilename(getExecutableName() + "_trace", getExecutableDirectory(), "json", filename))
+            {
+                logError("Profiler: can't find an available filename for the trace");
+            }
+            else if (writeTrace(filename))
+            {
+                logInfo("Profiler: wrote trace of " + std::to_string(sTrace.frames.size()) + " frames to " + filename);
+            }
+
+            gProfileEnabled = sTrace.restoreProfileEnabled;
+            sTrace = TraceCapture();
+        }
+
+        void updateTraceCapture(uint32_t gpuTimerIndex)
+        {
+            CpuTimer::TimePoint now = CpuTimer::getCurrentTimePoint();
+
+            // The previous frame's GPU timers can be read now, the ones of the frame that just ended after the next endFrame()
+            resolveTraceGpuEvents(1 - gpuTimerIndex);
+
+            switch (sTrace.state)
+            {
+            case TraceCapture::State::Pending:
+                sTrace.state = TraceCapture::State::Recording;
+                sTrace.captureStart = now;
+                sTrace.frameStart = now;
+                sTrace.calibrationCpuTime = now;
+                sTrace.hasClockCalibration = gpDevice && gpDevice->getGpuClockCalibration(sTrace.calibrationGpuTick, sTrace.calibrationCpuTime);
+                sTrace.frames.reserve(sTrace.frameCount);
+                getTraceThread();   // Register the render thread first so it gets the first track
+                break;
+            case TraceCapture::State::Recording:
+                sTrace.frames.push_back({ sTrace.frameStart, now });
+                sTrace.frameStart = now;
+                if (sTrace.frames.size() >= sTrace.frameCount) sTrace.state = TraceCapture::State::Draining;
+                break;
+            case TraceCapture::State::Draining:
+                finishTraceCapture();
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
     void Profiler::initNewEvent(EventData *pEvent, const HashedString& name)
     {
         pEvent->name = name.str;
@@ -98,6 +319,11 @@ namespace Falcor
             frame.pTimers.push_back(GpuTimer::create());
         }
         frame.pTimers[frame.currentTimer]->begin();
+        if (sTrace.state == TraceCapture::State::Recording)
+        {
+            recordTraceCpuEvent(pData, pData->cpuStart, true);
+            sTrace.pendingGpuEvents[sGpuTimerIndex].push_back({ pData, frame.currentTimer, (uint32_t)sTrace.frames.size() });
+        }
         pData->callStack.push(frame.currentTimer);
         frame.currentTimer++;
         sCurrentLevel++;
@@ -108,6 +334,10 @@ namespace Falcor
         EventData* pData = getEvent(name);
         pData->cpuEnd = CpuTimer::getCurrentTimePoint();
         pData->cpuTotal += CpuTimer::calcDuration(pData->cpuStart, pData->cpuEnd);
+        if (sTrace.state == TraceCapture::State::Recording)
+        {
+            recordTraceCpuEvent(pData, pData->cpuEnd, false);
+        }
 
         pData->frameData[sGpuTimerIndex].pTimers[pData->callStack.top()]->end();
         pData->callStack.pop();
@@ -183,6 +413,11 @@ namespace Falcor
 
     void Profiler::endFrame()
     {
+        if (sTrace.state != TraceCapture::State::Idle)
+        {
+            updateTraceCapture(sGpuTimerIndex);
+        }
+
         for (EventData* pData : sProfilerVector)
         {
             pData->showInMsg = false;
@@ -211,8 +446,49 @@ namespace Falcor
     }
 #endif
 
+    void Profiler::startTraceCapture(uint32_t frameCount, const std::string& filename)
+    {
+        if (sTrace.state != TraceCapture::State::Idle)
+        {
+            logWarning("Profiler::startTraceCapture() called while a trace capture is in progress. Ignoring call.");
+            return;
+        }
+        if (frameCount == 0) return;
+
+        sTrace.state = TraceCapture::State::Pending;
+        sTrace.frameCount = frameCount;
+        sTrace.filename = filename;
+        sTrace.restoreProfileEnabled = gProfileEnabled;
+        gProfileEnabled = true;
+    }
+
+    void Profiler::endTraceCapture()
+    {
+        if (sTrace.state == TraceCapture::State::Idle) return;
+        if (sTrace.state == TraceCapture::State::Pending)
+        {
+            gProfileEnabled = sTrace.restoreProfileEnabled;
+            sTrace = TraceCapture();
+            return;
+        }
+        // Events of an unfinished frame have no resolved GPU timers yet, so only the last finished frame is resolved
+        resolveTraceGpuEvents(1 - sGpuTimerIndex);
+        finishTraceCapture();
+    }
+
+    bool Profiler::isTraceCaptureActive()
+    {
+        return sTrace.state != TraceCapture::State::Idle;
+    }
+
     void Profiler::clearEvents()
     {
+        if (sTrace.state != TraceCapture::State::Idle)
+        {
+            logWarning("Profiler::clearEvents() called during a trace capture. The capture is discarded.");
+            gProfileEnabled = sTrace.restoreProfileEnabled;
+            sTrace = TraceCapture();
+        }
         for (EventData* pData : sProfilerVector)
         {
             delete pData;
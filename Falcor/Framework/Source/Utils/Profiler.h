@@ -138,6 +138,19 @@ namespace Falcor
         */
         static double getEventGpuTime(const HashedString& name);
 
+        /** Get the CPU time of an event without a name lookup.
+        */
+        static double getEventCpuTime(const EventData* pData) { return getCpuTime(pData); }
+
+        /** Get the GPU time of an event without a name lookup. Due to double-buffering, this is the time of the previous frame until endFrame() is called.
+        */
+        static double getEventGpuTime(const EventData* pData) { return getGpuTime(pData); }
+
+        /** Returns the events started during the current frame, in the order they were started.
+            An event started several times in a frame is listed once per start. The list is cleared by endFrame().
+        */
+        static const std::vector<EventData*>& getFrameEvents() { return sProfilerVector; }
+
         /** Returns the event or \c nullptr if the event is not known.
             Can be used as a predicate.
         */
@@ -148,6 +161,24 @@ namespace Falcor
         */
         static void clearEvents();
 
+        /** Start capturing a timeline trace of the next frames.
+            CPU events are recorded with their begin/end timestamps and thread. GPU events are read from the event timestamp queries once they are resolved, one frame later, and placed on a queue track.
+            The trace is written in Chrome trace-event JSON format, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+            Profiling is enabled for the duration of the capture. The capture starts at the next call to endFrame().
+            \param[in] frameCount Number of frames to capture.
+            \param[in] filename Output file. If empty, a new file is created in the executable directory.
+        */
+        static void startTraceCapture(uint32_t frameCount, const std::string& filename = "");
+
+        /** Stop an active trace capture and write the frames captured so far.
+            GPU events of the last frame are only included if the GPU finished the frame, e.g. after a call to Device::flushAndSync() and endFrame().
+        */
+        static void endTraceCapture();
+
+        /** Check if a trace capture was requested and has not been written yet.
+        */
+        static bool isTraceCaptureActive();
+
     private:
         static double getGpuTime(const EventData* pData);
         static double getCpuTime(const EventData* pData);
@@ -82,7 +82,9 @@ namespace Falcor
         // Model load flags
         auto model = pybind11::enum_<Model::LoadFlags>(m, "ModelLoadFlags");
         model.val(Model::LoadFlags::None).val(Model::LoadFlags::DontGenerateTangentSpace).val(Model::LoadFlags::FindDegeneratePrimitives).val(Model::LoadFlags::AssumeLinearSpaceTextures);
-        model.val(Model::LoadFlags::DontMergeMeshes).val(Model::LoadFlags::BuffersAsShaderResource).val(Model::LoadFlags::RemoveInstancing).val(Model::LoadFlags::UseSpecGlossMaterials);
+        model.val(Model::LoadFlags::DontMergeMeshes).val(Model::LoadFlags::BuffersAsShaderResource).val(Model::LoadFlags::RemoveInstancing).val(Model::LoadFlags::UseSpecGlossMaterials).val(Model::LoadFlags::DontUseModelCache).val(Model::LoadFlags::OptimizeVertexCache);
+        model.val(Model::LoadFlags::QuantizePositions).val(Model::LoadFlags::QuantizeNormals).val(Model::LoadFlags::QuantizeTexCoords);
+        model.val(Model::LoadFlags::GenerateMeshlets);
 
         // Scene load flags
         auto scene = pybind11::enum_<Scene::LoadFlags>(m, "SceneLoadFlags");
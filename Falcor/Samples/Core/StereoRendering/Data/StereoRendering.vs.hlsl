@@ -31,6 +31,7 @@ __import DefaultVS;
 VertexOut main(VertexIn vIn)
 {
     VertexOut vOut;
+    decodeVertex(vIn);
 
     // Filled out in geometry shader
     vOut.posH = float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -557,7 +557,7 @@ void ForwardRenderer::applyCsSkinningMode()
 {
     if(mpSceneRenderer)
     {
-        SkinningCache::SharedPtr pCache = mUseCsSkinning ? SkinningCache::create() : nullptr;
+        SkinningCache::SharedPtr pCache = mUseCsSkinning ? SkinningCache::create(mUseCpuSkinning ? SkinningCache::Mode::Cpu : SkinningCache::Mode::Gpu) : nullptr;
         mpSceneRenderer->getScene()->attachSkinningCacheToModels(pCache);
     }    
 }
@@ -216,6 +216,7 @@ private:
     bool mPerMaterialShader = false;
     bool mEnableDepthPass = true;
     bool mUseCsSkinning = false;
+    bool mUseCpuSkinning = false;
     void applyCsSkinningMode();
     static const std::string skDefaultScene;
 
@@ -226,6 +226,14 @@ void ForwardRenderer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
             {
                 applyCsSkinningMode();
             }
+            if (mUseCsSkinning)
+            {
+                if (pGui->addCheckBox("Skin on CPU", mUseCpuSkinning))
+                {
+                    applyCsSkinningMode();
+                }
+                pGui->addTooltip("Skin the cached vertex buffers on the CPU cores instead of in a compute shader");
+            }
             pGui->endGroup();
         }
 
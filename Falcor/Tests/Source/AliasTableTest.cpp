@@ -0,0 +1,253 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AliasTableTest.h"
+#include "Utils/Math/AliasTable.h"
+#include "Graphics/LightSampler.h"
+#include <limits>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    std::vector<float> createWeights(uint32_t count, uint32_t seed)
+    {
+        // Mostly small lights, a few bright ones and some which are off, like a scene with many small lights and a few large ones
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        std::vector<float> weights(count);
+        for (float& w : weights)
+        {
+            const float r = unit(rng);
+            w = (r < 0.1f) ? 0.0f : (r < 0.15f) ? 1000.0f * unit(rng) : unit(rng);
+        }
+        return weights;
+    }
+
+    std::string checkPdf(const AliasTable& table, const std::vector<float>& weights)
+    {
+        double sum = 0;
+        for (float w : weights) sum += w;
+        double pdfSum = 0;
+        for (uint32_t i = 0; i < table.getSize(); i++)
+        {
+            const double expected = weights[i] / sum;
+            if (std::abs(table.getPdf(i) - expected) > 1e-6 * std::max(expected, 1e-3)) return "The pdf of an index doesn't match its weight";
+            pdfSum += table.getPdf(i);
+        }
+        if (std::abs(pdfSum - 1.0) > 1e-4) return "The pdfs don't sum to 1";
+        return "";
+    }
+}
+
+void AliasTableTest::addTests()
+{
+    addTestToList<TestPdf>();
+    addTestToList<TestStratifiedDistribution>();
+    addTestToList<TestRandomDistribution>();
+    addTestToList<TestDegenerateWeights>();
+    addTestToList<TestLightPower>();
+    addTestToList<BenchmarkBuild>();
+}
+
+testing_func(AliasTableTest, TestPdf)
+{
+    std::vector<float> weights = createWeights(1000, 1);
+    AliasTable table;
+    table.build(weights);
+    if (table.getSize() != weights.size()) return test_fail("Wrong table size");
+    std::string error = checkPdf(table, weights);
+    if (error.size()) return test_fail(error);
+
+    // The pdf returned with a sample is the one of the sampled index
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        float pdf;
+        uint32_t index = table.sample(unit(rng), pdf);
+        if (index >= weights.size()) return test_fail("Sampled an index out of range");
+        if (pdf != table.getPdf(index)) return test_fail("sample() returned the wrong pdf");
+        if (weights[index] == 0) return test_fail("Sampled an index with a weight of 0");
+    }
+    return test_pass();
+}
+
+testing_func(AliasTableTest, TestStratifiedDistribution)
+{
+    // With evenly spaced numbers, every index is sampled in proportion to its weight, up to one sample per entry it's split across
+    std::vector<float> weights = createWeights(500, 3);
+    AliasTable table;
+    table.build(weights);
+    const uint32_t sampleCount = table.getSize() * 10000;
+    std::vector<uint32_t> counts(table.getSize(), 0);
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        float pdf;
+        counts[table.sample((i + 0.5f) / sampleCount, pdf)]++;
+    }
+
+    for (uint32_t i = 0; i < table.getSize(); i++)
+    {
+        const double expected = table.getPdf(i) * sampleCount;
+        if (std::abs(counts[i] - expected) > 2.0 + expected * 1e-4) return test_fail("An index isn't sampled in proportion to its weight");
+    }
+    return test_pass();
+}
+
+testing_func(AliasTableTest, TestRandomDistribution)
+{
+    // Pearson's chi-squared test. With 100 degrees of freedom, the statistic exceeds 160 with a probability below 0.01%.
+    std::vector<float> weights(101);
+    for (uint32_t i = 0; i < weights.size(); i++) weights[i] = float(i % 7 + 1) * ((i % 10 == 0) ? 50.0f : 1.0f);
+    AliasTable table;
+    table.build(weights);
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const uint32_t sampleCount = 1000000;
+    std::vector<uint32_t> counts(table.getSize(), 0);
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        float pdf;
+        counts[table.sample(unit(rng), pdf)]++;
+    }
+
+    double chiSquared = 0;
+    for (uint32_t i = 0; i < table.getSize(); i++)
+    {
+        const double expected = table.getPdf(i) * sampleCount;
+        chiSquared += (counts[i] - expected) * (counts[i] - expected) / expected;
+    }
+    if (chiSquared > 160.0) return test_fail("The samples don't follow the weights, chi-squared = " + std::to_string(chiSquared));
+    return test_pass();
+}
+
+testing_func(AliasTableTest, TestDegenerateWeights)
+{
+    AliasTable table;
+    float pdf;
+
+    // All zero falls back to uniform
+    table.build({ 0.0f, 0.0f, 0.0f, 0.0f });
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (table.getPdf(i) != 0.25f) return test_fail("Zero weights aren't sampled uniformly");
+        if (table.sample((i + 0.5f) / 4, pdf) != i) return test_fail("Zero weights aren't sampled uniformly");
+    }
+
+    // Negative and non-finite weights count as 0
+    table.build({ -1.0f, std::numeric_limits<float>::quiet_NaN(), 3.0f, std::numeric_limits<float>::infinity() });
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        if (table.sample(i / 100.0f, pdf) != 2 || pdf != 1.0f) return test_fail("Invalid weights were sampled");
+    }
+
+    // A single weight, and u close to 1
+    table.build({ 2.0f });
+    if (table.sample(0.99999994f, pdf) != 0 || pdf != 1.0f) return test_fail("A single weight isn't always sampled");
+    table.build({ 1.0f, 1.0f, 1.0f });
+    if (table.sample(0.99999994f, pdf) != 2) return test_fail("u close to 1 isn't sampled from the last entry");
+
+    table.build({});
+    if (table.getSize() != 0) return test_fail("An empty table has entries");
+    return test_pass();
+}
+
+testing_func(AliasTableTest, TestLightPower)
+{
+    const float kPi = 3.14159265f;
+    LightData point;
+    point.type = LightPoint;
+    point.intensity = vec3(2.0f);
+    point.cosOpeningAngle = -1.0f;
+    if (std::abs(LightSampler::estimatePower(point, 10.0f) - 8.0f * kPi) > 1e-4f) return test_fail("A point light's power is wrong");
+
+    // A spot light emitting into a hemisphere has half the power
+    LightData spot = point;
+    spot.cosOpeningAngle = 0.0f;
+    if (std::abs(LightSampler::estimatePower(spot, 10.0f) - 4.0f * kPi) > 1e-4f) return test_fail("A spot light's power is wrong");
+
+    // Only the luminance counts
+    LightData green = point;
+    green.intensity = vec3(0.0f, 1.0f, 0.0f);
+    LightData blue = point;
+    blue.intensity = vec3(0.0f, 0.0f, 1.0f);
+    if (LightSampler::estimatePower(green, 10.0f) <= LightSampler::estimatePower(blue, 10.0f)) return test_fail("Light power doesn't follow luminance");
+
+    LightData directional;
+    directional.type = LightDirectional;
+    directional.intensity = vec3(1.0f);
+    if (std::abs(LightSampler::estimatePower(directional, 10.0f) - 100.0f * kPi) > 1e-3f) return test_fail("A directional light's power is wrong");
+
+    LightData area;
+    area.type = LightAreaRect;
+    area.intensity = vec3(1.0f);
+    area.surfaceArea = 2.0f;
+    if (std::abs(LightSampler::estimatePower(area, 10.0f) - 2.0f * kPi) > 1e-4f) return test_fail("An area light's power is wrong");
+    return test_pass();
+}
+
+testing_func(AliasTableTest, BenchmarkBuild)
+{
+    const uint32_t counts[] = { 100, 10000, 1000000 };
+    std::stringstream report;
+    report << "Alias table build and sampling:\n";
+    for (uint32_t count : counts)
+    {
+        std::vector<float> weights = createWeights(count, count);
+        AliasTable table;
+        const uint32_t kBuilds = std::max(1u, 1000000 / count);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kBuilds; i++) table.build(weights);
+        const double buildMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kBuilds;
+
+        const uint32_t kSamples = 10000000;
+        uint32_t randSeed = 1;
+        uint64_t indexSum = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kSamples; i++)
+        {
+            randSeed = 1664525u * randSeed + 1013904223u;
+            float pdf;
+            indexSum += table.sample(float(randSeed & 0x00FFFFFF) / float(0x01000000), pdf);
+        }
+        const double sampleMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        report << "  " << count << " lights: build " << buildMs << " ms, " << kSamples / (sampleMs * 1000.0) << " M samples/s (index sum " << indexSum << ")\n";
+    }
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    AliasTableTest att;
+    att.init(true);
+    att.run();
+    return 0;
+}
@@ -0,0 +1,305 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AnimationTest.h"
+#include "Graphics/Model/Animation.h"
+#include "Graphics/Model/AnimationController.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cstring>
+#include <functional>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    /** A clip with keys at irregular times. Some sets have no scaling, or a single key. Some keys share a time, and some rotations repeat, to cover the lerp fallback of slerp.
+    */
+    std::vector<Animation::AnimationSet> createClip(uint32_t setCount, uint32_t keyCount, float duration, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        auto randomVec = [&]() { return vec3(unit(rng), unit(rng), unit(rng)) * 2.0f - vec3(1.0f); };
+
+        std::vector<Animation::AnimationSet> sets(setCount);
+        for (uint32_t i = 0; i < setCount; i++)
+        {
+            Animation::AnimationSet& set = sets[i];
+            set.boneID = i;
+
+            // Ascending times from 0, with some duplicates
+            std::vector<float> times(keyCount);
+            for (uint32_t k = 1; k < keyCount; k++)
+            {
+                const bool duplicate = (i % 7 == 3) && (k % 5 == 0);
+                times[k] = duplicate ? times[k - 1] : times[k - 1] + (0.5f + unit(rng)) * duration / (1.5f * keyCount);
+            }
+
+            glm::quat rotation = glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+            for (uint32_t k = 0; k < keyCount; k++)
+            {
+                set.translation.addKey(times[k], 10.0f * randomVec());
+                if (i % 4 != 1) set.scaling.addKey(times[k], vec3(1.0f) + 0.5f * randomVec());
+
+                // Small steps, with an occasional sign flip, which slerp has to take the short way around
+                if (k % 9 != 8) rotation = glm::normalize(rotation * glm::angleAxis(0.3f * unit(rng), glm::normalize(randomVec() + vec3(0, 0, 2))));
+                set.rotation.addKey(times[k], (k % 11 == 10) ? -rotation : rotation);
+            }
+
+            if (i % 5 == 2)
+            {
+                set.scaling.times.resize(std::min(1u, keyCount));
+                set.scaling.values.resize(std::min(1u, keyCount));
+            }
+        }
+        return sets;
+    }
+
+    /** The evaluation Animation used before the keys were binary searched: a linear scan from the last key used, which restarts at the first key when the time goes backwards
+    */
+    class ReferenceAnimation
+    {
+    public:
+        ReferenceAnimation(const std::vector<Animation::AnimationSet>& sets, float duration, float ticksPerSecond) : mSets(sets), mDuration(duration), mTicksPerSecond(ticksPerSecond), mState(sets.size()) {}
+
+        void evaluate(double totalTime, std::vector<mat4>& transforms)
+        {
+            float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
+            transforms.resize(mSets.size());
+            for (size_t i = 0; i < mSets.size(); i++)
+            {
+                State& state = mState[i];
+                mat4 translation;
+                translation[3] = vec4(calcCurrentKey(mSets[i].translation, state.lastKeyUsed[0], ticks, state.lastUpdateTime), 1);
+                mat4 scaling;
+                if (mSets[i].scaling.times.size() > 0)
+                {
+                    scaling = glm::scale(mat4(), calcCurrentKey(mSets[i].scaling, state.lastKeyUsed[1], ticks, state.lastUpdateTime));
+                }
+                mat4 rotation = glm::mat4_cast(calcCurrentKey(mSets[i].rotation, state.lastKeyUsed[2], ticks, state.lastUpdateTime));
+                state.lastUpdateTime = ticks;
+                transforms[i] = translation * rotation * scaling;
+            }
+        }
+
+    private:
+        struct State
+        {
+            uint32_t lastKeyUsed[3] = {};
+            float lastUpdateTime = 0;
+        };
+
+        static vec3 interpolate(const vec3& start, const vec3& end, float ratio) { return start + ((end - start) * ratio); }
+        static glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio) { return glm::slerp(start, end, ratio); }
+
+        template<typename T>
+        T calcCurrentKey(const Animation::AnimationChannel<T>& channel, uint32_t& lastKeyUsed, float ticks, float lastUpdateTime)
+        {
+            T value;
+            const uint32_t count = (uint32_t)channel.times.size();
+            if (count == 0) return value;
+            if (ticks < lastUpdateTime) lastKeyUsed = 0;
+
+            uint32_t cur = lastKeyUsed;
+            while (cur < count - 1 && !(channel.times[cur + 1] > ticks)) cur++;
+            const uint32_t next = (cur + 1) % count;
+
+            float diff = channel.times[next] - channel.times[cur];
+            if (diff == 0)
+            {
+                value = channel.values[cur];
+            }
+            else
+            {
+                if (diff < 0) diff += mDuration;
+                value = interpolate(channel.values[cur], channel.values[next], (ticks - channel.times[cur]) / diff);
+            }
+            lastKeyUsed = cur;
+            return value;
+        }
+
+        const std::vector<Animation::AnimationSet>& mSets;
+        float mDuration;
+        float mTicksPerSecond;
+        std::vector<State> mState;
+    };
+
+    bool nearlyEqual(const std::vector<mat4>& a, const std::vector<mat4>& b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                for (int r = 0; r < 4; r++)
+                {
+                    if (std::abs(a[i][c][r] - b[i][c][r]) > 1e-5f * std::max(1.0f, std::abs(b[i][c][r]))) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool equal(const std::vector<mat4>& a, const std::vector<mat4>& b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(mat4)) == 0;
+    }
+
+    const float kTicksPerSecond = 30;
+}
+
+void AnimationTest::addTests()
+{
+    addTestToList<TestSequentialPlayback>();
+    addTestToList<TestRandomAccess>();
+    addTestToList<TestThreadCount>();
+    addTestToList<BenchmarkLongClip>();
+}
+
+testing_func(AnimationTest, TestSequentialPlayback)
+{
+    // Play three loops at 60 fps, with a jump back in the middle
+    const float duration = 300;
+    std::vector<Animation::AnimationSet> sets = createClip(67, 200, duration, 1);
+    Animation::UniquePtr pAnimation = Animation::create("clip", sets, duration, kTicksPerSecond);
+    ReferenceAnimation reference(sets, duration, kTicksPerSecond);
+
+    Animation::Cursor cursor;
+    std::vector<mat4> result, expected;
+    const uint32_t frameCount = (uint32_t)(3 * 60 * duration / kTicksPerSecond);
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        const double time = (frame < frameCount / 2 ? frame : frame - 100) / 60.0;
+        pAnimation->evaluate(time, result, &cursor);
+        reference.evaluate(time, expected);
+        if (!nearlyEqual(result, expected)) return test_fail("The transforms don't match the previous evaluation");
+    }
+
+    // A clip without keys gives the identity
+    std::vector<Animation::AnimationSet> empty = createClip(5, 0, duration, 2);
+    Animation::create("empty", empty, duration, kTicksPerSecond)->evaluate(1.0, result);
+    for (const mat4& m : result)
+    {
+        if (m != mat4()) return test_fail("A set without keys isn't the identity");
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestRandomAccess)
+{
+    const float duration = 1000;
+    std::vector<Animation::AnimationSet> sets = createClip(30, 500, duration, 3);
+    Animation::UniquePtr pAnimation = Animation::create("clip", sets, duration, kTicksPerSecond);
+    ReferenceAnimation reference(sets, duration, kTicksPerSecond);
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> time(0.0, 2.0 * duration / kTicksPerSecond);
+    Animation::Cursor cursor;
+    std::vector<mat4> stateless, withCursor, expected;
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+        // Include the key times themselves
+        const double t = (i % 10 == 0) ? sets[i % sets.size()].translation.times[i % 500] / kTicksPerSecond : time(rng);
+        pAnimation->evaluate(t, stateless);
+        pAnimation->evaluate(t, withCursor, &cursor);
+        reference.evaluate(t, expected);
+        if (!equal(stateless, withCursor)) return test_fail("The cursor changed the transforms");
+        if (!nearlyEqual(stateless, expected)) return test_fail("Out of order evaluation doesn't match the previous evaluation");
+    }
+
+    // A copy evaluates the same
+    Animation::UniquePtr pCopy = Animation::create(*pAnimation);
+    pCopy->evaluate(12.3, withCursor);
+    pAnimation->evaluate(12.3, stateless);
+    if (!equal(stateless, withCursor)) return test_fail("A copy evaluates differently");
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestThreadCount)
+{
+    const float duration = 1000;
+    // Large enough to be spread over the cores
+    std::vector<Animation::AnimationSet> sets = createClip(AnimationController::kMinParallelBones + 300, 20, duration, 5);
+    Animation::UniquePtr pAnimation = Animation::create("clip", sets, duration, kTicksPerSecond);
+    std::vector<mat4> single, all;
+    for (double t : { 0.0, 1.5, 17.25, 33.0 })
+    {
+        pAnimation->evaluate(t, single, nullptr, 1);
+        pAnimation->evaluate(t, all);
+        if (!equal(single, all)) return test_fail("The transforms depend on the thread count");
+    }
+    return test_pass();
+}
+
+testing_func(AnimationTest, BenchmarkLongClip)
+{
+    // A ten minute clip with a key per frame, for a rig of 100 bones
+    const uint32_t setCount = 100, keyCount = 18000;
+    const float duration = (float)keyCount;
+    std::vector<Animation::AnimationSet> sets = createClip(setCount, keyCount, duration, 6);
+    Animation::UniquePtr pAnimation = Animation::create("clip", sets, duration, kTicksPerSecond);
+    ReferenceAnimation reference(sets, duration, kTicksPerSecond);
+
+    const uint32_t kEvaluations = 200;
+    std::vector<double> inOrder(kEvaluations), randomOrder(kEvaluations);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> time(0.0, duration / kTicksPerSecond);
+    for (uint32_t i = 0; i < kEvaluations; i++)
+    {
+        inOrder[i] = i / 60.0;
+        randomOrder[i] = time(rng);
+    }
+
+    std::vector<mat4> transforms;
+    auto measure = [&](const std::vector<double>& times, const std::function<void(double)>& evaluate)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (double t : times) evaluate(t);
+        return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1000.0 / times.size();
+    };
+
+    std::stringstream report;
+    report << "Animation evaluation, " << setCount << " bones, " << keyCount << " keys per channel, microseconds per evaluation:\n";
+    report << "  linear scan:   in order " << measure(inOrder, [&](double t) { reference.evaluate(t, transforms); });
+    report << ", random order " << measure(randomOrder, [&](double t) { reference.evaluate(t, transforms); }) << "\n";
+
+    Animation::Cursor cursor;
+    report << "  with cursor:   in order " << measure(inOrder, [&](double t) { pAnimation->evaluate(t, transforms, &cursor, 1); });
+    report << ", random order " << measure(randomOrder, [&](double t) { pAnimation->evaluate(t, transforms, &cursor, 1); }) << "\n";
+    report << "  binary search: in order " << measure(inOrder, [&](double t) { pAnimation->evaluate(t, transforms, nullptr, 1); });
+    report << ", random order " << measure(randomOrder, [&](double t) { pAnimation->evaluate(t, transforms, nullptr, 1); });
+    report << ", random order on all threads " << measure(randomOrder, [&](double t) { pAnimation->evaluate(t, transforms); }) << "\n";
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    AnimationTest at;
+    at.init(true);
+    at.run();
+    return 0;
+}
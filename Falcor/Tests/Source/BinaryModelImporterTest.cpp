@@ -0,0 +1,327 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BinaryModelImporterTest.h"
+#include "Graphics/Model/Loaders/BinaryModelImporter.h"
+#include "Graphics/Model/Loaders/BinaryModelSpec.h"
+#include <cstring>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    struct AttribSpec
+    {
+        int32_t type;
+        int32_t format;
+        int32_t length;
+        uint32_t size;
+    };
+
+    // Position, normal, texcoord and color are used. The tangent is skipped by the importer, which exercises the skip path.
+    const AttribSpec kAttribs[] =
+    {
+        { AttribType_Position, AttribFormat_F32, 3, 12 },
+        { AttribType_Normal,   AttribFormat_F32, 3, 12 },
+        { AttribType_TexCoord, AttribFormat_F32, 2, 8 },
+        { AttribType_Color,    AttribFormat_U8,  4, 4 },
+        { AttribType_Tangent,  AttribFormat_F32, 3, 12 },
+    };
+
+    const int32_t kTextureSlotsV8 = TextureType_Glossiness + 1;
+
+    std::vector<uint8_t> readBuffer(const Buffer::SharedPtr& pBuffer)
+    {
+        std::vector<uint8_t> data;
+        if (pBuffer)
+        {
+            data.resize(pBuffer->getSize());
+            std::memcpy(data.data(), pBuffer->map(Buffer::MapType::Read), data.size());
+            pBuffer->unmap();
+        }
+        return data;
+    }
+
+    std::string getTestFilename(const std::string& name)
+    {
+        return getExecutableDirectory() + "/BinaryModelImporterTest_" + name + ".bin";
+    }
+}
+
+void BinaryModelImporterTest::addTests()
+{
+    addTestToList<TestDeinterleave>();
+    addTestToList<TestBulkImportMatchesStream>();
+    addTestToList<TestTruncatedFile>();
+    addTestToList<BenchmarkLoadTime>();
+}
+
+bool BinaryModelImporterTest::writeSyntheticScene(const std::string& filename, const SyntheticScene& desc)
+{
+    BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+    if (stream.isFail()) return false;
+
+    std::mt19937 rng(desc.seed);
+    std::uniform_real_distribution<float> coord(-100.f, 100.f);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+    std::uniform_int_distribution<uint32_t> vertexId(0, desc.verticesPerMesh - 1);
+
+    stream.write("BinScene", 8);
+    stream << int32_t(8) << int32_t(0) << int32_t(desc.meshCount) << int32_t(desc.meshCount);
+
+    std::vector<float> vertex;
+    for (uint32_t mesh = 0; mesh < desc.meshCount; mesh++)
+    {
+        stream << int32_t(arraysize(kAttribs)) << int32_t(desc.verticesPerMesh) << int32_t(desc.submeshesPerMesh);
+        for (const auto& attrib : kAttribs)
+        {
+            stream << attrib.type << attrib.format << attrib.length;
+        }
+
+        for (uint32_t v = 0; v < desc.verticesPerMesh; v++)
+        {
+            for (const auto& attrib : kAttribs)
+            {
+                if (attrib.format == AttribFormat_U8)
+                {
+                    for (int32_t c = 0; c < attrib.length; c++) stream << uint8_t(byte(rng));
+                }
+                else
+                {
+                    for (int32_t c = 0; c < attrib.length; c++) stream << coord(rng);
+                }
+            }
+        }
+
+        for (uint32_t submesh = 0; submesh < desc.submeshesPerMesh; submesh++)
+        {
+            // Ambient, diffuse, specular, glossiness, displacement coefficient and bias
+            for (uint32_t i = 0; i < 3 + 4 + 3 + 1 + 2; i++) stream << 0.5f;
+            for (int32_t i = 0; i < kTextureSlotsV8; i++) stream << int32_t(-1);
+            stream << int32_t(desc.trianglesPerSubmesh);
+            for (uint32_t i = 0; i < desc.trianglesPerSubmesh * 3; i++) stream << vertexId(rng);
+        }
+    }
+
+    for (uint32_t instance = 0; instance < desc.meshCount; instance++)
+    {
+        stream << int32_t(instance) << int32_t(1) << glm::mat4();
+        stream << int32_t(0) << int32_t(0);     // Empty name and meta-data
+    }
+
+    return !stream.isFail();
+}
+
+Model::SharedPtr BinaryModelImporterTest::importModel(const std::string& filename, bool bulkImport, double& loadTimeMs)
+{
+    BinaryModelImporter::setBulkImportEnabled(bulkImport);
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    Model::SharedPtr pModel = Model::createFromFile(filename.c_str());
+    loadTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    BinaryModelImporter::setBulkImportEnabled(true);
+    return pModel;
+}
+
+std::string BinaryModelImporterTest::compareModels(const Model* pStream, const Model* pBulk)
+{
+    if (pStream->getMeshCount() != pBulk->getMeshCount()) return "Mesh count differs";
+    for (uint32_t meshId = 0; meshId < pStream->getMeshCount(); meshId++)
+    {
+        const Mesh* pA = pStream->getMesh(meshId).get();
+        const Mesh* pB = pBulk->getMesh(meshId).get();
+        std::string meshStr = "Mesh " + std::to_string(meshId) + ": ";
+        if (pA->getVertexCount() != pB->getVertexCount() || pA->getIndexCount() != pB->getIndexCount()) return meshStr + "vertex or index count differs";
+        if (pA->getBoundingBox().center != pB->getBoundingBox().center || pA->getBoundingBox().extent != pB->getBoundingBox().extent) return meshStr + "bounding box differs";
+        if (pA->getMaterial()->getBaseColor() != pB->getMaterial()->getBaseColor()) return meshStr + "material differs";
+
+        const Vao* pVaoA = pA->getVao().get();
+        const Vao* pVaoB = pB->getVao().get();
+        if (pVaoA->getVertexBuffersCount() != pVaoB->getVertexBuffersCount()) return meshStr + "vertex buffer count differs";
+        for (uint32_t vb = 0; vb < pVaoA->getVertexBuffersCount(); vb++)
+        {
+            if (readBuffer(pVaoA->getVertexBuffer(vb)) != readBuffer(pVaoB->getVertexBuffer(vb))) return meshStr + "vertex buffer " + std::to_string(vb) + " differs";
+        }
+        if (readBuffer(pVaoA->getIndexBuffer()) != readBuffer(pVaoB->getIndexBuffer())) return meshStr + "index buffer differs";
+    }
+    return "";
+}
+
+testing_func(BinaryModelImporterTest, TestDeinterleave)
+{
+    // Compare against a plain per-vertex copy, for all the element sizes the importer can produce and for split ranges
+    const uint32_t sizes[] = { 1, 2, 4, 8, 12, 16, 3, 6 };
+    std::mt19937 rng(1234);
+    for (uint32_t layout = 0; layout < 32; layout++)
+    {
+        uint32_t attribCount = 1 + rng() % 6;
+        uint32_t vertexCount = 1 + rng() % 5000;
+
+        std::vector<BinaryModelImporter::VertexAttribCopy> attribs(attribCount);
+        std::vector<std::vector<uint8_t>> expected(attribCount), actual(attribCount);
+        uint32_t vertexSize = 0;
+        for (uint32_t a = 0; a < attribCount; a++)
+        {
+            attribs[a].size = sizes[rng() % arraysize(sizes)];
+            vertexSize += attribs[a].size;
+            expected[a].resize(attribs[a].size * vertexCount, 0xcd);
+            actual[a].resize(attribs[a].size * vertexCount, 0xcd);
+            attribs[a].pDst = (rng() % 4 == 0) ? nullptr : actual[a].data();
+        }
+
+        std::vector<uint8_t> src(vertexSize * vertexCount);
+        for (auto& b : src) b = uint8_t(rng());
+
+        const uint8_t* pVertex = src.data();
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            for (uint32_t a = 0; a < attribCount; a++)
+            {
+                if (attribs[a].pDst) std::memcpy(expected[a].data() + attribs[a].size * v, pVertex, attribs[a].size);
+                pVertex += attribs[a].size;
+            }
+        }
+
+        uint32_t split = rng() % (vertexCount + 1);
+        BinaryModelImporter::deinterleaveVertices(src.data(), split, vertexCount - split, attribs);
+        BinaryModelImporter::deinterleaveVertices(src.data(), 0, split, attribs);
+
+        if (expected != actual)
+        {
+            return test_fail("De-interleaved data doesn't match a per-vertex copy for layout " + std::to_string(layout));
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BinaryModelImporterTest, TestBulkImportMatchesStream)
+{
+    SyntheticScene desc;
+    desc.meshCount = 3;
+    desc.verticesPerMesh = 50000;
+    desc.trianglesPerSubmesh = 20000;
+    desc.seed = 42;
+    std::string filename = getTestFilename("Match");
+    if (!writeSyntheticScene(filename, desc)) return test_fail("Can't write " + filename);
+
+    double streamMs, bulkMs;
+    Model::SharedPtr pStream = importModel(filename, false, streamMs);
+    Model::SharedPtr pBulk = importModel(filename, true, bulkMs);
+    std::remove(filename.c_str());
+
+    if (!pStream || !pBulk) return test_fail("Failed to import the synthetic scene");
+    std::string error = compareModels(pStream.get(), pBulk.get());
+    if (error.size()) return test_fail(error);
+    return test_pass();
+}
+
+testing_func(BinaryModelImporterTest, TestTruncatedFile)
+{
+    // Cut the file in the middle of the vertex data. The bulk path validates the vertex block against the file size instead of reading past the end.
+    SyntheticScene desc;
+    desc.verticesPerMesh = 10000;
+    std::string filename = getTestFilename("Truncated");
+    if (!writeSyntheticScene(filename, desc)) return test_fail("Can't write " + filename);
+
+    std::vector<char> data;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size() / 2);
+    }
+
+    double loadMs;
+    Model::SharedPtr pModel = importModel(filename, true, loadMs);
+    std::remove(filename.c_str());
+    if (pModel) return test_fail("A truncated file was imported");
+    return test_pass();
+}
+
+testing_func(BinaryModelImporterTest, BenchmarkLoadTime)
+{
+    // The sample assets are converted to the binary format first. A synthetic scene with a few million vertices stands in for our large BinScene assets.
+    std::vector<std::pair<std::string, std::string>> files;
+    const char* sampleAssets[] = { "Arcade/Arcade.fbx", "teapot.obj", "Framework/Models/LightBulb.obj" };
+    for (const char* asset : sampleAssets)
+    {
+        std::string fullpath;
+        if (!findFileInDataDirectories(asset, fullpath)) continue;
+        Model::SharedPtr pModel = Model::createFromFile(fullpath.c_str());
+        if (!pModel) continue;
+        std::string binFile = getTestFilename(getFilenameFromPath(asset));
+        pModel->exportToBinaryFile(binFile);
+        files.push_back({ asset, binFile });
+    }
+
+    SyntheticScene desc;
+    desc.meshCount = 8;
+    desc.verticesPerMesh = 500000;
+    desc.trianglesPerSubmesh = 250000;
+    std::string syntheticFile = getTestFilename("Synthetic");
+    if (!writeSyntheticScene(syntheticFile, desc)) return test_fail("Can't write " + syntheticFile);
+    files.push_back({ "Synthetic (4M vertices)", syntheticFile });
+
+    const uint32_t kRepetitions = 3;
+    std::stringstream report;
+    report << "BinaryModelImporter load times (best of " << kRepetitions << "):\n";
+    std::string error;
+    for (const auto& file : files)
+    {
+        double bestStream = 1e30, bestBulk = 1e30;
+        Model::SharedPtr pStream, pBulk;
+        for (uint32_t i = 0; i < kRepetitions && error.empty(); i++)
+        {
+            double ms;
+            pStream = importModel(file.second, false, ms);
+            bestStream = std::min(bestStream, ms);
+            pBulk = importModel(file.second, true, ms);
+            bestBulk = std::min(bestBulk, ms);
+            if (!pStream || !pBulk) error = "Failed to import " + file.first;
+        }
+        if (error.empty())
+        {
+            error = compareModels(pStream.get(), pBulk.get());
+            if (error.size()) error = file.first + ": " + error;
+        }
+        report << "  " << file.first << ": stream " << bestStream << " ms, bulk " << bestBulk << " ms, speedup " << bestStream / bestBulk << "x\n";
+        std::remove(file.second.c_str());
+    }
+
+    logInfo(report.str());
+    if (error.size()) return test_fail(error);
+    return test_pass();
+}
+
+int main()
+{
+    BinaryModelImporterTest bmit;
+    bmit.init(true);
+    bmit.run();
+    return 0;
+}
@@ -0,0 +1,232 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BlasGroupingTest.h"
+#include "Raytracing/BlasGrouping.h"
+#include <random>
+
+namespace
+{
+    using MeshDesc = BlasGrouping::MeshDesc;
+
+    MeshDesc createMesh(const glm::mat4& transform, uint32_t primitiveCount, bool doubleSided = false)
+    {
+        MeshDesc mesh;
+        mesh.transform = transform;
+        mesh.primitiveCount = primitiveCount;
+        mesh.vertexCount = primitiveCount * 3;
+        mesh.doubleSided = doubleSided;
+        return mesh;
+    }
+
+    glm::mat4 translation(float x)
+    {
+        return glm::translate(glm::mat4(), glm::vec3(x, 0, 0));
+    }
+
+    /** Check the invariants RtModel and RtScene rely on. Returns an empty string on success.
+        - Every mesh appears once, and the BLASes cover contiguous ranges of the new order
+        - The meshes of a multi-mesh BLAS are static, non-instanced, and share their transform and doubleSided flag
+        - Skinned meshes come last
+    */
+    std::string validate(const std::vector<MeshDesc>& meshes, const BlasGrouping::Result& result)
+    {
+        if (result.meshOrder.size() != meshes.size()) return "Wrong mesh count";
+        std::vector<bool> seen(meshes.size(), false);
+        for (uint32_t m : result.meshOrder)
+        {
+            if (m >= meshes.size() || seen[m]) return "The mesh order isn't a permutation";
+            seen[m] = true;
+        }
+
+        uint32_t base = 0;
+        bool skinnedSeen = false;
+        for (const auto& group : result.groups)
+        {
+            if (group.meshBaseIndex != base || group.meshCount == 0) return "The BLASes aren't contiguous";
+            uint64_t primitiveCount = 0;
+            const MeshDesc& first = meshes[result.meshOrder[base]];
+            for (uint32_t i = base; i < base + group.meshCount; i++)
+            {
+                const MeshDesc& mesh = meshes[result.meshOrder[i]];
+                primitiveCount += mesh.primitiveCount;
+                if (mesh.isSkinned == group.isStatic) return "A BLAS mixes static and skinned meshes";
+                if (mesh.doubleSided != first.doubleSided) return "A BLAS mixes doubleSided flags";
+                if (group.meshCount > 1 && mesh.instanceCount > 1 && group.isStatic) return "An instanced mesh shares a BLAS";
+                if (group.isStatic && mesh.transform != first.transform) return "A BLAS mixes transforms";
+            }
+            if (primitiveCount != group.primitiveCount) return "Wrong primitive count";
+            if (group.estimatedBuildBytes != BlasGrouping::estimateBuildBytes(primitiveCount)) return "Wrong build memory estimate";
+            if (group.isStatic && skinnedSeen) return "A static BLAS comes after a skinned one";
+            skinnedSeen = skinnedSeen || !group.isStatic;
+            base += group.meshCount;
+        }
+        if (base != meshes.size()) return "The BLASes don't cover all meshes";
+        return "";
+    }
+}
+
+void BlasGroupingTest::addTests()
+{
+    addTestToList<TestTransformGrouping>();
+    addTestToList<TestMaterialFlags>();
+    addTestToList<TestCostModel>();
+    addTestToList<TestInstancedAndSkinned>();
+    addTestToList<TestLargeModel>();
+}
+
+testing_func(BlasGroupingTest, TestTransformGrouping)
+{
+    // 3 transforms, interleaved. -0 and +0 are the same transform.
+    std::vector<MeshDesc> meshes;
+    for (uint32_t i = 0; i < 30; i++)
+    {
+        meshes.push_back(createMesh(translation(float(i % 3)), 100));
+    }
+    meshes[0].transform[3][1] = -0.0f;
+
+    BlasGrouping::Result result = BlasGrouping::group(meshes);
+    std::string error = validate(meshes, result);
+    if (error.size()) return test_fail(error);
+    if (result.groups.size() != 3) return test_fail("Meshes with the same transform weren't merged");
+
+    // Groups keep the order in which their transforms first appear
+    for (uint32_t g = 0; g < 3; g++)
+    {
+        if (meshes[result.meshOrder[result.groups[g].meshBaseIndex]].transform != translation(float(g))) return test_fail("The groups are out of order");
+    }
+    return test_pass();
+}
+
+testing_func(BlasGroupingTest, TestMaterialFlags)
+{
+    std::vector<MeshDesc> meshes;
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        meshes.push_back(createMesh(glm::mat4(), 100, (i % 2) == 0));
+    }
+
+    BlasGrouping::Result result = BlasGrouping::group(meshes);
+    std::string error = validate(meshes, result);
+    if (error.size()) return test_fail(error);
+    if (result.groups.size() != 2) return test_fail("Meshes weren't separated by their doubleSided flag");
+    return test_pass();
+}
+
+testing_func(BlasGroupingTest, TestCostModel)
+{
+    // Small meshes fill BLASes up to the limit, large meshes get their own
+    const uint32_t kMaxMerged = 1000, kLarge = 400;
+    std::vector<MeshDesc> meshes;
+    for (uint32_t i = 0; i < 25; i++) meshes.push_back(createMesh(glm::mat4(), 100));
+    meshes.push_back(createMesh(glm::mat4(), 5000));
+    meshes.push_back(createMesh(glm::mat4(), 401));
+    meshes.push_back(createMesh(glm::mat4(), 400));
+
+    BlasGrouping::Result result = BlasGrouping::group(meshes, kMaxMerged, kLarge);
+    std::string error = validate(meshes, result);
+    if (error.size()) return test_fail(error);
+
+    uint32_t largeCount = 0;
+    uint64_t mergedPrimitives = 0;
+    for (const auto& group : result.groups)
+    {
+        const MeshDesc& first = meshes[result.meshOrder[group.meshBaseIndex]];
+        if (first.primitiveCount > kLarge)
+        {
+            if (group.meshCount != 1) return test_fail("A large mesh was merged");
+            largeCount++;
+        }
+        else
+        {
+            if (group.primitiveCount > kMaxMerged) return test_fail("A merged BLAS exceeds the primitive limit");
+            mergedPrimitives += group.primitiveCount;
+        }
+    }
+    if (largeCount != 2) return test_fail("Wrong number of large-mesh BLASes");
+
+    // 2900 primitives of small meshes need 3 BLASes of at most 1000
+    if (result.groups.size() != 5 || mergedPrimitives != 2900) return test_fail("Small meshes weren't packed into the fewest BLASes");
+
+    std::string report = BlasGrouping::getReport("test", result);
+    if (report.find("5 BLASes") == std::string::npos) return test_fail("The report doesn't have the BLAS count");
+    return test_pass();
+}
+
+testing_func(BlasGroupingTest, TestInstancedAndSkinned)
+{
+    std::vector<MeshDesc> meshes;
+    meshes.push_back(createMesh(glm::mat4(), 100));
+    meshes.push_back(createMesh(glm::mat4(), 100));
+    meshes[1].isSkinned = true;
+    meshes.push_back(createMesh(glm::mat4(), 100));
+    meshes[2].instanceCount = 3;
+    meshes.push_back(createMesh(translation(5), 100));
+    meshes[3].isSkinned = true;
+    meshes.push_back(createMesh(glm::mat4(), 100));
+    meshes[4].instanceCount = 2;
+    meshes.push_back(createMesh(glm::mat4(), 100));
+    meshes.push_back(createMesh(glm::mat4(), 100, true));
+    meshes[6].isSkinned = true;
+
+    BlasGrouping::Result result = BlasGrouping::group(meshes);
+    std::string error = validate(meshes, result);
+    if (error.size()) return test_fail(error);
+
+    // One static group, 2 instanced meshes, and the skinned meshes split by doubleSided only
+    if (result.groups.size() != 5) return test_fail("Wrong BLAS count");
+    if (result.groups[3].isStatic || result.groups[3].meshCount != 2) return test_fail("Skinned meshes with different transforms weren't merged");
+    return test_pass();
+}
+
+testing_func(BlasGroupingTest, TestLargeModel)
+{
+    // A city-like model with many meshes over many transforms. The old list-based grouping was quadratic in the mesh count.
+    std::mt19937 rng(1);
+    std::vector<MeshDesc> meshes;
+    for (uint32_t i = 0; i < 50000; i++)
+    {
+        meshes.push_back(createMesh(translation(float(rng() % 5000)), 10 + rng() % 1000, (rng() % 4) == 0));
+    }
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    BlasGrouping::Result result = BlasGrouping::group(meshes);
+    double ms = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    std::string error = validate(meshes, result);
+    if (error.size()) return test_fail(error);
+
+    logInfo(BlasGrouping::getReport("synthetic city", result) + ", grouped in " + std::to_string(ms) + " ms");
+    return test_pass();
+}
+
+int main()
+{
+    BlasGroupingTest bgt;
+    bgt.init(true);
+    bgt.run();
+    return 0;
+}
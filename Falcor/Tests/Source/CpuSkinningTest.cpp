@@ -0,0 +1,259 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CpuSkinningTest.h"
+#include "Graphics/Model/CpuSkinning.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cstring>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    struct Rig
+    {
+        std::vector<mat4> boneMats;
+        std::vector<mat4> boneInvTransposeMats;
+    };
+
+    /** A chain of bones along the y axis, each rotated, scaled and moved a little, like a posed limb
+    */
+    Rig createRig(uint32_t boneCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        Rig rig;
+        for (uint32_t i = 0; i < boneCount; i++)
+        {
+            mat4 m = glm::translate(mat4(), vec3(unit(rng), (float)i + unit(rng), unit(rng)));
+            m = glm::rotate(m, 0.5f * unit(rng), glm::normalize(vec3(unit(rng), unit(rng), unit(rng)) + vec3(0, 0, 2)));
+            m = glm::scale(m, vec3(1.0f) + 0.2f * vec3(unit(rng), unit(rng), unit(rng)));
+            rig.boneMats.push_back(m);
+            rig.boneInvTransposeMats.push_back(glm::transpose(glm::inverse(m)));
+        }
+        return rig;
+    }
+
+    /** A cylinder along the bone chain. Each vertex is weighted to up to four bones near it, the unused influences have zero weight.
+    */
+    CpuSkinning::SourceVertices createMesh(uint32_t vertexCount, uint32_t boneCount, bool hasNormals, bool hasBitangents, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        CpuSkinning::SourceVertices mesh;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            const float phi = 6.2831853f * unit(rng);
+            const float y = (float)boneCount * unit(rng);
+            const vec3 n(std::cos(phi), 0, std::sin(phi));
+            mesh.positions.push_back(n + vec3(0, y, 0));
+            if (hasNormals) mesh.normals.push_back(n);
+            if (hasBitangents) mesh.bitangents.push_back(vec3(0, 1, 0));
+
+            const uint32_t influences = 1 + (v % 4);
+            const uint32_t firstBone = std::min((uint32_t)y, boneCount - 1);
+            vec4 weights(0.0f);
+            uint32_t ids = 0;
+            float sum = 0;
+            for (uint32_t k = 0; k < influences; k++)
+            {
+                weights[k] = 0.1f + unit(rng);
+                sum += weights[k];
+                ids |= std::min(firstBone + k, boneCount - 1) << (8 * k);
+            }
+            mesh.boneWeights.push_back(weights / sum);
+            mesh.boneIds.push_back(ids);
+        }
+        return mesh;
+    }
+
+    /** A port of main() in ComputeSkinning.cs.slang. mul(v, M) in the shader is M * v here, since the matrices are uploaded column-major.
+    */
+    CpuSkinning::SkinnedVertices skinReference(const CpuSkinning::SourceVertices& source, const Rig& rig)
+    {
+        CpuSkinning::SkinnedVertices result;
+        for (size_t v = 0; v < source.positions.size(); v++)
+        {
+            mat4 boneMat(0.0f);
+            mat3 invTransposeBoneMat(0.0f);
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                const uint32_t id = (source.boneIds[v] >> (8 * k)) & 0xff;
+                boneMat += rig.boneMats[id] * source.boneWeights[v][k];
+                invTransposeBoneMat += mat3(rig.boneInvTransposeMats[id]) * source.boneWeights[v][k];
+            }
+
+            result.positions.push_back(vec3(boneMat * vec4(source.positions[v], 1.0f)));
+            if (!source.normals.empty()) result.normals.push_back(invTransposeBoneMat * source.normals[v]);
+            if (!source.bitangents.empty()) result.bitangents.push_back(mat3(boneMat) * source.bitangents[v]);
+        }
+        return result;
+    }
+
+    bool nearlyEqual(const std::vector<vec3>& a, const std::vector<vec3>& b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            const float scale = std::max(1.0f, glm::length(b[i]));
+            if (glm::length(a[i] - b[i]) > 1e-5f * scale) return false;
+        }
+        return true;
+    }
+
+    std::string compare(const CpuSkinning::SkinnedVertices& result, const CpuSkinning::SkinnedVertices& reference)
+    {
+        if (!nearlyEqual(result.positions, reference.positions)) return "The positions don't match the shader";
+        if (!nearlyEqual(result.normals, reference.normals)) return "The normals don't match the shader";
+        if (!nearlyEqual(result.bitangents, reference.bitangents)) return "The bitangents don't match the shader";
+        return "";
+    }
+}
+
+void CpuSkinningTest::addTests()
+{
+    addTestToList<TestMatchesShader>();
+    addTestToList<TestMissingStreams>();
+    addTestToList<TestInvalidBoneIds>();
+    addTestToList<TestThreadCount>();
+    addTestToList<BenchmarkSkinning>();
+}
+
+testing_func(CpuSkinningTest, TestMatchesShader)
+{
+    // Not a multiple of the batch size, so the last batch is partial
+    const uint32_t boneCount = 64;
+    Rig rig = createRig(boneCount, 1);
+    CpuSkinning::SourceVertices mesh = createMesh(10 * CpuSkinning::kVerticesPerBatch + 17, boneCount, true, true, 2);
+
+    CpuSkinning::SkinnedVertices result;
+    CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, result);
+    std::string error = compare(result, skinReference(mesh, rig));
+    if (!error.empty()) return test_fail(error);
+
+    // Reusing the result's storage gives the same vertices
+    CpuSkinning::SkinnedVertices reference = result;
+    CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, result);
+    if (result.positions != reference.positions) return test_fail("Skinning into a previous result changed the vertices");
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, TestMissingStreams)
+{
+    const uint32_t boneCount = 16;
+    Rig rig = createRig(boneCount, 3);
+    for (uint32_t streams = 0; streams < 4; streams++)
+    {
+        CpuSkinning::SourceVertices mesh = createMesh(3000, boneCount, (streams & 1) != 0, (streams & 2) != 0, 4);
+        CpuSkinning::SkinnedVertices result;
+        CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, result);
+        if (result.normals.size() != mesh.normals.size() || result.bitangents.size() != mesh.bitangents.size()) return test_fail("A stream the mesh doesn't have was skinned");
+        std::string error = compare(result, skinReference(mesh, rig));
+        if (!error.empty()) return test_fail(error);
+    }
+
+    // An empty mesh
+    CpuSkinning::SkinnedVertices result;
+    CpuSkinning::skin(CpuSkinning::SourceVertices(), rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, result);
+    if (!result.positions.empty()) return test_fail("An empty mesh produced vertices");
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, TestInvalidBoneIds)
+{
+    // Influences of bones past the end are dropped, which matches the shader with their weight set to zero
+    const uint32_t boneCount = 8;
+    Rig rig = createRig(boneCount, 5);
+    CpuSkinning::SourceVertices mesh = createMesh(2000, boneCount, true, true, 6);
+    CpuSkinning::SourceVertices cleared = mesh;
+    for (size_t v = 0; v < mesh.boneIds.size(); v += 3)
+    {
+        const uint32_t k = (uint32_t)v % 4;
+        mesh.boneIds[v] = (mesh.boneIds[v] & ~(0xffu << (8 * k))) | ((boneCount + (uint32_t)v % 200) << (8 * k));
+        cleared.boneIds[v] &= ~(0xffu << (8 * k));
+        cleared.boneWeights[v][k] = 0.0f;
+    }
+
+    CpuSkinning::SkinnedVertices result;
+    CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, result);
+    std::string error = compare(result, skinReference(cleared, rig));
+    if (!error.empty()) return test_fail(error);
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, TestThreadCount)
+{
+    const uint32_t boneCount = 64;
+    Rig rig = createRig(boneCount, 7);
+    CpuSkinning::SourceVertices mesh = createMesh(100000, boneCount, true, true, 8);
+    CpuSkinning::SkinnedVertices single, all;
+    CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, single, 1);
+    CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, all);
+    if (single.positions != all.positions || single.normals != all.normals || single.bitangents != all.bitangents)
+    {
+        return test_fail("The vertices depend on the thread count");
+    }
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, BenchmarkSkinning)
+{
+    // The skinned sample models are a few tens of thousands of vertices. The larger mesh shows how far the cores scale.
+    const uint32_t boneCount = 64;
+    Rig rig = createRig(boneCount, 9);
+    std::stringstream report;
+    report << "CPU skinning, " << boneCount << " bones, positions, normals and bitangents:\n";
+    for (uint32_t vertexCount : { 50000u, 1000000u })
+    {
+        CpuSkinning::SourceVertices mesh = createMesh(vertexCount, boneCount, true, true, 10);
+        report << "  " << vertexCount << " vertices:";
+
+        const uint32_t kRuns = 10;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        CpuSkinning::SkinnedVertices reference;
+        for (uint32_t i = 0; i < kRuns; i++) reference = skinReference(mesh, rig);
+        report << " scalar " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kRuns << " ms,";
+
+        for (uint32_t threads : { 1u, 0u })
+        {
+            CpuSkinning::SkinnedVertices result;
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < kRuns; i++) CpuSkinning::skin(mesh, rig.boneMats.data(), rig.boneInvTransposeMats.data(), boneCount, result, threads);
+            report << " SSE " << (threads ? "1 thread " : "all threads ") << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kRuns << " ms" << (threads ? "," : "\n");
+        }
+    }
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    CpuSkinningTest cst;
+    cst.init(true);
+    cst.run();
+    return 0;
+}
@@ -0,0 +1,348 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "EnvMapSamplerTest.h"
+#include "Graphics/EnvMapSampler.h"
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    const float kPi = 3.14159265f;
+
+    /** A sky: a gradient from the horizon to the zenith, a dark ground, and a small sun much brighter than the rest
+    */
+    std::vector<vec4> createSky(uint32_t width, uint32_t height)
+    {
+        std::vector<vec4> texels((size_t)width * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const float v = (y + 0.5f) / height;
+                vec3 color = (v < 0.5f) ? glm::mix(vec3(0.2f, 0.4f, 1.0f), vec3(0.8f, 0.9f, 1.0f), v * 2.0f) : vec3(0.1f, 0.08f, 0.05f);
+                const float dx = float(x) - 0.3f * width;
+                const float dy = float(y) - 0.3f * height;
+                if (dx * dx + dy * dy < 0.0004f * width * height) color = vec3(1000.0f, 900.0f, 800.0f);
+                texels[(size_t)y * width + x] = vec4(color, 1.0f);
+            }
+        }
+        return texels;
+    }
+
+    float luminance(const vec4& c)
+    {
+        return c.r * 0.2126f + c.g * 0.7152f + c.b * 0.0722f;
+    }
+
+    /** The probability of each table texel, computed directly from the map
+    */
+    std::vector<double> getTexelProbabilities(const std::vector<vec4>& texels, uint32_t width, uint32_t height, uvec2 tableSize)
+    {
+        std::vector<double> probs((size_t)tableSize.x * tableSize.y);
+        double sum = 0;
+        for (uint32_t row = 0; row < tableSize.y; row++)
+        {
+            const uint32_t y0 = row * height / tableSize.y, y1 = std::max(y0 + 1, (row + 1) * height / tableSize.y);
+            const double sinTheta = std::sin((row + 0.5) / tableSize.y * 3.14159265358979);
+            for (uint32_t col = 0; col < tableSize.x; col++)
+            {
+                const uint32_t x0 = col * width / tableSize.x, x1 = std::max(x0 + 1, (col + 1) * width / tableSize.x);
+                double lum = 0;
+                for (uint32_t y = y0; y < y1; y++)
+                {
+                    for (uint32_t x = x0; x < x1; x++) lum += luminance(texels[(size_t)y * width + x]);
+                }
+                const double p = lum / ((x1 - x0) * (y1 - y0)) * sinTheta;
+                probs[(size_t)row * tableSize.x + col] = p;
+                sum += p;
+            }
+        }
+        for (double& p : probs) p /= sum;
+        return probs;
+    }
+
+    /** The probability of a table texel, as stored in the sampler's tables
+    */
+    double getTablePdf(const EnvMapSampler& sampler, uint32_t row, uint32_t col)
+    {
+        const uvec2 size = sampler.getTableSize();
+        const auto& entries = sampler.getEntries();
+        return (double)entries[(size_t)size.x * size.y + row].pdf * entries[(size_t)row * size.x + col].pdf;
+    }
+
+    uvec2 getTexel(const vec3& dir, uvec2 tableSize)
+    {
+        const float u = (1.0f + std::atan2(dir.x, -dir.z) / kPi) * 0.5f;
+        const float v = std::acos(glm::clamp(dir.y, -1.0f, 1.0f)) / kPi;
+        return glm::min(uvec2(vec2(u, v) * vec2(tableSize)), tableSize - 1u);
+    }
+}
+
+void EnvMapSamplerTest::addTests()
+{
+    addTestToList<TestTablePdf>();
+    addTestToList<TestPdfIntegral>();
+    addTestToList<TestSamplePdf>();
+    addTestToList<TestDistribution>();
+    addTestToList<TestDownsample>();
+    addTestToList<TestDegenerateTexels>();
+    addTestToList<TestThreadCount>();
+    addTestToList<BenchmarkBuild>();
+}
+
+testing_func(EnvMapSamplerTest, TestTablePdf)
+{
+    const uint32_t width = 256, height = 128;
+    std::vector<vec4> texels = createSky(width, height);
+    EnvMapSampler::SharedPtr pSampler = EnvMapSampler::create(texels, width, height);
+    if (pSampler == nullptr) return test_fail("Can't create the sampler");
+    if (pSampler->getTableSize() != uvec2(width, height)) return test_fail("A map smaller than the maximum table size was downsampled");
+
+    std::vector<double> expected = getTexelProbabilities(texels, width, height, pSampler->getTableSize());
+    for (uint32_t row = 0; row < height; row++)
+    {
+        for (uint32_t col = 0; col < width; col++)
+        {
+            const double p = expected[(size_t)row * width + col];
+            if (std::abs(getTablePdf(*pSampler, row, col) - p) > 1e-4 * p + 1e-9) return test_fail("A texel's probability doesn't follow its luminance and solid angle");
+        }
+    }
+
+    if (EnvMapSampler::create(texels, width + 1, height) != nullptr) return test_fail("Created a sampler from the wrong number of texels");
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, TestPdfIntegral)
+{
+    // Integrate the pdf over the sphere with uniformly distributed directions
+    const uint32_t width = 512, height = 256;
+    EnvMapSampler::SharedPtr pSampler = EnvMapSampler::create(createSky(width, height), width, height);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const uint32_t sampleCount = 4000000;
+    double sum = 0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        const float z = 1.0f - 2.0f * unit(rng);
+        const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        const float phi = 2.0f * kPi * unit(rng);
+        sum += pSampler->evalPdf(vec3(r * std::cos(phi), r * std::sin(phi), z));
+    }
+    const double integral = sum / sampleCount * 4.0 * 3.14159265358979;
+    if (std::abs(integral - 1.0) > 0.02) return test_fail("The pdf doesn't integrate to 1 over the sphere: " + std::to_string(integral));
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, TestSamplePdf)
+{
+    const uint32_t width = 300, height = 150;
+    EnvMapSampler::SharedPtr pSampler = EnvMapSampler::create(createSky(width, height), width, height);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        float pdf;
+        const vec3 dir = pSampler->sample(vec4(unit(rng), unit(rng), unit(rng), unit(rng)), pdf);
+        if (std::abs(glm::length(dir) - 1.0f) > 1e-4f) return test_fail("A sampled direction isn't normalized");
+        if (pdf <= 0.0f) continue;
+        const float evalPdf = pSampler->evalPdf(dir);
+        if (std::abs(evalPdf - pdf) > 1e-3f * pdf)
+        {
+            // Directions on the edge of a texel can round into the neighbor
+            uvec2 texel = getTexel(dir, pSampler->getTableSize());
+            const bool onEdge = (std::abs(getTablePdf(*pSampler, texel.y, texel.x) - pdf) > 1e-3f * pdf);
+            if (onEdge == false) return test_fail("sample() and evalPdf() disagree");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, TestDistribution)
+{
+    // Pearson's chi-squared test over the table texels. With 511 degrees of freedom, the statistic exceeds 700 with a probability below 0.01%.
+    const uint32_t width = 32, height = 16;
+    std::vector<vec4> texels = createSky(width, height);
+    for (uint32_t i = 0; i < texels.size(); i++) texels[i] += vec4(float(i % 5) * 0.1f);
+    EnvMapSampler::SharedPtr pSampler = EnvMapSampler::create(texels, width, height);
+    std::vector<double> expected = getTexelProbabilities(texels, width, height, pSampler->getTableSize());
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const uint32_t sampleCount = 2000000;
+    std::vector<uint32_t> counts(expected.size(), 0);
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        float pdf;
+        // Keep away from the texel edges, where the direction can round into the neighbor
+        const vec3 dir = pSampler->sample(vec4(unit(rng), unit(rng), 0.01f + 0.98f * unit(rng), 0.01f + 0.98f * unit(rng)), pdf);
+        uvec2 texel = getTexel(dir, pSampler->getTableSize());
+        counts[texel.y * width + texel.x]++;
+    }
+
+    double chiSquared = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        const double e = expected[i] * sampleCount;
+        chiSquared += (counts[i] - e) * (counts[i] - e) / e;
+    }
+    if (chiSquared > 700.0) return test_fail("The samples don't follow the map, chi-squared = " + std::to_string(chiSquared));
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, TestDownsample)
+{
+    // A 2:1 map twice as wide as the maximum table is reduced to 2x2 blocks
+    const uint32_t width = EnvMapSampler::kMaxTableWidth * 2, height = EnvMapSampler::kMaxTableWidth;
+    std::vector<vec4> texels = createSky(width, height);
+    EnvMapSampler::SharedPtr pSampler = EnvMapSampler::create(texels, width, height);
+    const uvec2 tableSize = pSampler->getTableSize();
+    if (tableSize != uvec2(EnvMapSampler::kMaxTableWidth, EnvMapSampler::kMaxTableWidth / 2)) return test_fail("The table doesn't keep the map's aspect ratio");
+
+    std::vector<double> expected = getTexelProbabilities(texels, width, height, tableSize);
+    for (uint32_t row = 0; row < tableSize.y; row += 7)
+    {
+        for (uint32_t col = 0; col < tableSize.x; col += 3)
+        {
+            const double p = expected[(size_t)row * tableSize.x + col];
+            if (std::abs(getTablePdf(*pSampler, row, col) - p) > 1e-4 * p + 1e-9) return test_fail("A table texel isn't the average of its block");
+        }
+    }
+
+    // The sun is the brightest part of the map, so its texels are the most likely
+    uvec2 best = uvec2(0);
+    for (uint32_t row = 0; row < tableSize.y; row++)
+    {
+        for (uint32_t col = 0; col < tableSize.x; col++)
+        {
+            if (getTablePdf(*pSampler, row, col) > getTablePdf(*pSampler, best.y, best.x)) best = uvec2(col, row);
+        }
+    }
+    if (std::abs(float(best.x) / tableSize.x - 0.3f) > 0.03f || std::abs(float(best.y) / tableSize.y - 0.3f) > 0.03f) return test_fail("The most likely texel isn't in the sun");
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, TestDegenerateTexels)
+{
+    // A black map falls back to uniform sampling over the table
+    const uint32_t width = 64, height = 32;
+    EnvMapSampler::SharedPtr pSampler = EnvMapSampler::create(std::vector<vec4>((size_t)width * height, vec4(0.0f)), width, height);
+    const float uniform = 1.0f / (width * height);
+    for (uint32_t row = 0; row < height; row++)
+    {
+        if (std::abs(getTablePdf(*pSampler, row, 7) - uniform) > 1e-3f * uniform) return test_fail("A black map isn't sampled uniformly");
+    }
+
+    // Negative and NaN texels count as black, infinite texels are the most likely
+    std::vector<vec4> texels((size_t)width * height, vec4(1.0f));
+    texels[10] = vec4(-5.0f);
+    texels[11] = vec4(std::numeric_limits<float>::quiet_NaN());
+    texels[20 * width + 30] = vec4(std::numeric_limits<float>::infinity());
+    pSampler = EnvMapSampler::create(texels, width, height);
+    if (getTablePdf(*pSampler, 0, 10) != 0.0 || getTablePdf(*pSampler, 0, 11) != 0.0) return test_fail("Negative or NaN texels can be sampled");
+    if (getTablePdf(*pSampler, 20, 30) < 0.99) return test_fail("An infinite texel isn't the most likely");
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        float pdf;
+        const vec3 dir = pSampler->sample(vec4(unit(rng), unit(rng), unit(rng), unit(rng)), pdf);
+        if (std::isfinite(pdf) == false || std::isfinite(dir.x + dir.y + dir.z) == false) return test_fail("A sample isn't finite");
+    }
+
+    // A single texel
+    pSampler = EnvMapSampler::create({ vec4(1.0f) }, 1, 1);
+    float pdf;
+    pSampler->sample(vec4(0.5f), pdf);
+    if (std::abs(pdf - 1.0f / (2.0f * kPi * kPi)) > 1e-5f) return test_fail("A single texel map has the wrong pdf");
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, TestThreadCount)
+{
+    const uint32_t width = 1000, height = 500;
+    std::vector<vec4> texels = createSky(width, height);
+    EnvMapSampler::SharedPtr pSingle = EnvMapSampler::create(texels, width, height, 1);
+    EnvMapSampler::SharedPtr pAll = EnvMapSampler::create(texels, width, height);
+    const auto& single = pSingle->getEntries();
+    const auto& all = pAll->getEntries();
+    if (single.size() != all.size() || std::memcmp(single.data(), all.data(), single.size() * sizeof(AliasTable::Entry)) != 0)
+    {
+        return test_fail("The table depends on the thread count");
+    }
+    return test_pass();
+}
+
+testing_func(EnvMapSamplerTest, BenchmarkBuild)
+{
+    // The size of the MonValley map the pipelines offer
+    const uint32_t width = 3072, height = 1536;
+    std::vector<vec4> texels = createSky(width, height);
+    std::stringstream report;
+    report << "Environment map table build, " << width << "x" << height << ":\n";
+    for (uint32_t threads : { 1u, 0u })
+    {
+        const uint32_t kBuilds = 5;
+        EnvMapSampler::SharedPtr pSampler;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kBuilds; i++) pSampler = EnvMapSampler::create(texels, width, height, threads);
+        const double buildMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / kBuilds;
+
+        const uint32_t kSamples = 10000000;
+        uint32_t randSeed = 1;
+        float pdfSum = 0;
+        auto nextRand = [&randSeed]() { randSeed = 1664525u * randSeed + 1013904223u; return float(randSeed & 0x00FFFFFF) / float(0x01000000); };
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kSamples; i++)
+        {
+            vec4 u;
+            u.x = nextRand();
+            u.y = nextRand();
+            u.z = nextRand();
+            u.w = nextRand();
+            float pdf;
+            pSampler->sample(u, pdf);
+            pdfSum += pdf;
+        }
+        const double sampleMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        report << "  " << (threads ? "1 thread" : "all threads") << ": build " << buildMs << " ms, " << kSamples / (sampleMs * 1000.0) << " M samples/s (pdf sum " << pdfSum << ")\n";
+    }
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    EnvMapSamplerTest emst;
+    emst.init(true);
+    emst.run();
+    return 0;
+}
@@ -0,0 +1,259 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "FrameStatisticsTest.h"
+#include "../../../SharedUtils/FrameStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    const uint64_t kMaxValue = (uint64_t(1) << LatencyHistogram::kMaxValueBits) - 1;
+    const double kPercentiles[] = { 0.0, 50.0, 95.0, 99.0, 100.0 };
+
+    /** Exact percentile of a sorted vector, nearest-rank definition (the smallest value with at least p% of the values at or below it)
+    */
+    template<typename T>
+    T getExactPercentile(const std::vector<T>& sorted, double p)
+    {
+        size_t rank = size_t(std::ceil(p / 100.0 * double(sorted.size())));
+        return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+    }
+
+    struct Distribution
+    {
+        std::string name;
+        std::vector<uint64_t> values;
+    };
+
+    std::vector<Distribution> createDistributions()
+    {
+        std::mt19937_64 rng(1234);
+        std::vector<Distribution> distributions(5);
+
+        // Crosses from the one-value buckets to the sub-bucketed ones
+        distributions[0].name = "small";
+        std::uniform_int_distribution<uint64_t> small(0, 300);
+        for (uint32_t i = 0; i < 5000; i++) distributions[0].values.push_back(small(rng));
+
+        distributions[1].name = "uniform";
+        std::uniform_int_distribution<uint64_t> uniform(100000, 50000000);
+        for (uint32_t i = 0; i < 10000; i++) distributions[1].values.push_back(uniform(rng));
+
+        distributions[2].name = "exponential";
+        std::exponential_distribution<double> exponential(1.0 / 2.0e6);
+        for (uint32_t i = 0; i < 10000; i++) distributions[2].values.push_back(uint64_t(exponential(rng)));
+
+        distributions[3].name = "constant";
+        distributions[3].values.assign(1000, 16666667);
+
+        // The edges of the range, including values the histogram clamps, in a few copies so that they reach the percentiles
+        distributions[4].name = "edges";
+        const uint64_t edges[] = { 0, 1, 255, 256, 257, 511, 512, kMaxValue - 1, kMaxValue, kMaxValue + 1, uint64_t(-1) };
+        for (uint32_t i = 0; i < 20; i++) distributions[4].values.insert(distributions[4].values.end(), std::begin(edges), std::end(edges));
+        std::shuffle(distributions[4].values.begin(), distributions[4].values.end(), rng);
+        return distributions;
+    }
+}
+
+void FrameStatisticsTest::addTests()
+{
+    addTestToList<TestBucketBounds>();
+    addTestToList<TestHistogramPercentiles>();
+    addTestToList<TestRollingWindow>();
+    addTestToList<TestSummary>();
+}
+
+testing_func(FrameStatisticsTest, TestBucketBounds)
+{
+    const uint32_t kLinearCount = 1u << LatencyHistogram::kSubBucketBits;
+    for (uint32_t i = 0; i < LatencyHistogram::kBucketCount; i++)
+    {
+        uint64_t lower = LatencyHistogram::getBucketLowerBound(i);
+        uint64_t upper = LatencyHistogram::getBucketUpperBound(i);
+        std::string bucketStr = "Bucket " + std::to_string(i) + ": ";
+        if (lower > upper) return test_fail(bucketStr + "the lower bound is above the upper bound");
+        if (LatencyHistogram::getBucketIndex(lower) != i || LatencyHistogram::getBucketIndex(upper) != i) return test_fail(bucketStr + "its bounds map to another bucket");
+        if (i > 0 && lower != LatencyHistogram::getBucketUpperBound(i - 1) + 1) return test_fail(bucketStr + "there is a gap or overlap with the previous bucket");
+
+        // One value per bucket up to kLinearCount, then at most 1/2^(kSubBucketBits-1) relative width
+        uint64_t width = upper - lower + 1;
+        if (i < kLinearCount ? width != 1 : width * (kLinearCount / 2) > lower) return test_fail(bucketStr + "the bucket is too wide");
+    }
+
+    if (LatencyHistogram::getBucketLowerBound(0) != 0) return test_fail("The first bucket doesn't start at 0");
+    if (LatencyHistogram::getBucketUpperBound(LatencyHistogram::kBucketCount - 1) != kMaxValue) return test_fail("The last bucket doesn't end at the maximum value");
+    if (LatencyHistogram::getBucketIndex(kMaxValue + 1) != LatencyHistogram::kBucketCount - 1 || LatencyHistogram::getBucketIndex(uint64_t(-1)) != LatencyHistogram::kBucketCount - 1)
+    {
+        return test_fail("Values above the maximum are not clamped to the last bucket");
+    }
+    return test_pass();
+}
+
+testing_func(FrameStatisticsTest, TestHistogramPercentiles)
+{
+    LatencyHistogram histogram;
+    if (histogram.getPercentile(50.0) != 0 || histogram.getMax() != 0) return test_fail("An empty histogram has values");
+
+    for (const auto& distribution : createDistributions())
+    {
+        histogram.reset();
+        for (uint64_t value : distribution.values) histogram.record(value);
+
+        std::vector<uint64_t> sorted = distribution.values;
+        std::sort(sorted.begin(), sorted.end());
+        std::string distStr = "Distribution '" + distribution.name + "': ";
+        if (histogram.getCount() != sorted.size()) return test_fail(distStr + "wrong count");
+        if (histogram.getMax() != sorted.back()) return test_fail(distStr + "wrong max");
+
+        // The histogram returns the upper bound of the bucket holding the exact percentile, capped by the max
+        for (double p : kPercentiles)
+        {
+            uint64_t exact = std::min(getExactPercentile(sorted, p), kMaxValue);
+            uint64_t value = histogram.getPercentile(p);
+            std::string percentileStr = distStr + "p" + std::to_string(int(p)) + " is " + std::to_string(value) + " instead of " + std::to_string(exact) + ". ";
+            if (LatencyHistogram::getBucketIndex(value) != LatencyHistogram::getBucketIndex(exact)) return test_fail(percentileStr + "It is in another bucket");
+            if (value < exact || value > sorted.back()) return test_fail(percentileStr + "It is outside [exact, max]");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(FrameStatisticsTest, TestRollingWindow)
+{
+    const size_t kSize = 8;
+    RollingWindow<kSize> window;
+    std::vector<float> recorded;
+    float out[kSize];
+
+    // Wrap around the ring buffer a few times, checking every fill level on the way
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        for (uint32_t i = 0; i < 3 * kSize + 3; i++)
+        {
+            float value = float(pass * 100 + i);
+            window.record(value);
+            recorded.push_back(value);
+
+            size_t expected = std::min(recorded.size(), kSize);
+            if (window.size() != expected || window.copyTo(out) != expected) return test_fail("Wrong size after " + std::to_string(recorded.size()) + " values");
+            if (!std::equal(out, out + expected, recorded.end() - expected)) return test_fail("Wrong values after " + std::to_string(recorded.size()) + " values");
+        }
+
+        window.reset();
+        recorded.clear();
+        if (window.size() != 0 || window.copyTo(out) != 0) return test_fail("The window is not empty after a reset");
+    }
+    return test_pass();
+}
+
+testing_func(FrameStatisticsTest, TestSummary)
+{
+    const uint64_t kFrameCount = 3 * FrameStatistics::kWindowSize + 100;
+    const double kNsPerMs = 1.0e6;
+
+    std::mt19937 rng(5678);
+    std::uniform_real_distribution<double> frameTime(0.5, 20.0);
+    std::exponential_distribution<double> passTime(1.0 / 3.0);
+
+    // "Frame" only has CPU times, "Pass" has both.  The second record of a track in a frame must be ignored.
+    FrameStatistics stats;
+    std::vector<double> frameMs, passCpuMs, passGpuMs;
+    for (uint64_t frame = 0; frame < kFrameCount; frame++)
+    {
+        frameMs.push_back(frameTime(rng));
+        passCpuMs.push_back(passTime(rng));
+        passGpuMs.push_back(passTime(rng));
+        stats.record("Frame", 0, frame, frameMs.back(), -1.0);
+        stats.record("Pass", 1, frame, passCpuMs.back(), passGpuMs.back());
+        stats.record("Pass", 1, frame, 1000.0, 1000.0);
+    }
+
+    if (stats.getTrackCount() != 2 || stats.getTrackName(0) != "Frame" || stats.getTrackName(1) != "Pass" || stats.getTrackLevel(1) != 1) return test_fail("Wrong tracks");
+    if (stats.hasGpuData(0) || !stats.hasGpuData(1)) return test_fail("Wrong tracks with GPU data");
+
+    struct Expected
+    {
+        std::string name;
+        FrameStatistics::Summary summary;
+        const std::vector<double>* pMs;
+    };
+    const Expected expected[] = { { "Frame CPU", stats.getCpuSummary(0), &frameMs }, { "Pass CPU", stats.getCpuSummary(1), &passCpuMs }, { "Pass GPU", stats.getGpuSummary(1), &passGpuMs } };
+
+    for (const auto& e : expected)
+    {
+        const FrameStatistics::Summary& s = e.summary;
+        std::string summaryStr = e.name + ": ";
+        if (s.count != FrameStatistics::kWindowSize || s.totalCount != kFrameCount) return test_fail(summaryStr + "wrong counts");
+
+        // The window holds the exact last kWindowSize values
+        std::vector<float> window(e.pMs->end() - FrameStatistics::kWindowSize, e.pMs->end());
+        double sum = 0.0;
+        for (float value : window) sum += value;
+        std::sort(window.begin(), window.end());
+        if (std::abs(s.mean - float(sum / double(window.size()))) > 1.0e-4f * s.mean) return test_fail(summaryStr + "wrong mean");
+        if (s.p50 != getExactPercentile(window, 50.0) || s.p95 != getExactPercentile(window, 95.0) || s.p99 != getExactPercentile(window, 99.0) || s.max != window.back())
+        {
+            return test_fail(summaryStr + "the window percentiles are not exact");
+        }
+
+        // The histogram covers all values, with the bucket error.  Allow a little more for the conversion to float ms.
+        std::vector<uint64_t> all;
+        for (double ms : *e.pMs) all.push_back(uint64_t(ms * kNsPerMs));
+        std::sort(all.begin(), all.end());
+        if (s.histMax != float(double(all.back()) / kNsPerMs)) return test_fail(summaryStr + "wrong histogram max");
+        const std::pair<float, double> histPercentiles[] = { { s.histP50, 50.0 }, { s.histP99, 99.0 } };
+        for (const auto& hp : histPercentiles)
+        {
+            double exact = double(getExactPercentile(all, hp.second));
+            double rounding = exact * 1.0e-6 + 1.0;
+            double bucketError = exact / double(1u << (LatencyHistogram::kSubBucketBits - 1));
+            if (hp.first * kNsPerMs < exact - rounding || hp.first * kNsPerMs > exact + bucketError + rounding) return test_fail(summaryStr + "histogram p" + std::to_string(int(hp.second)) + " is off by more than a bucket");
+        }
+    }
+
+    if (stats.getGpuSummary(0).count != 0 || stats.getGpuSummary(0).totalCount != 0) return test_fail("Frame GPU: negative times were recorded");
+
+    // After a reset the tracks stay, and a window shorter than kWindowSize summarizes only what it holds
+    stats.reset();
+    if (stats.getTrackCount() != 2 || stats.getCpuSummary(0).count != 0 || stats.getCpuSummary(0).totalCount != 0) return test_fail("Samples were kept by a reset");
+    stats.record("Frame", 0, 0, 3.0, -1.0);
+    stats.record("Frame", 0, 1, 1.0, -1.0);
+    stats.record("Frame", 0, 2, 2.0, -1.0);
+    FrameStatistics::Summary s = stats.getCpuSummary(0);
+    if (s.count != 3 || s.p50 != 2.0f || s.p95 != 3.0f || s.p99 != 3.0f || s.max != 3.0f || s.mean != 2.0f) return test_fail("Wrong summary of a partly filled window");
+    return test_pass();
+}
+
+int main()
+{
+    FrameStatisticsTest fst;
+    fst.init(true);
+    fst.run();
+    return 0;
+}
@@ -0,0 +1,218 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "InstanceCullingTest.h"
+#include "Graphics/Scene/InstanceCuller.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    struct TestInstance
+    {
+        BoundingBox box;
+        glm::mat4 transform;
+    };
+
+    /** A city of size x size blocks, each with a few rotated and scaled buildings
+    */
+    std::vector<TestInstance> createCity(uint32_t size, uint32_t buildingsPerBlock, uint32_t seed)
+    {
+        std::vector<TestInstance> instances;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        const float kBlockSize = 20.f;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                for (uint32_t b = 0; b < buildingsPerBlock; b++)
+                {
+                    TestInstance instance;
+                    instance.box.center = glm::vec3(unit(rng) - 0.5f, 1.f, unit(rng) - 0.5f);
+                    instance.box.extent = glm::vec3(0.5f + unit(rng), 1.f, 0.5f + unit(rng));
+                    glm::vec3 position = glm::vec3((x + unit(rng)) * kBlockSize, 0, (y + unit(rng)) * kBlockSize) - glm::vec3(size * kBlockSize * 0.5f, 0, size * kBlockSize * 0.5f);
+                    instance.transform = glm::translate(glm::mat4(), position) * glm::rotate(glm::mat4(), unit(rng) * 6.28f, glm::vec3(0, 1, 0)) * glm::scale(glm::mat4(), glm::vec3(1.f + unit(rng) * 3.f, 1.f + unit(rng) * 20.f, 1.f + unit(rng) * 3.f));
+                    instances.push_back(instance);
+                }
+            }
+        }
+        return instances;
+    }
+
+    /** A flight over the city, turning around at the ends of the streets
+    */
+    ObjectPath::SharedPtr createFlightPath(float citySize)
+    {
+        ObjectPath::SharedPtr pPath = ObjectPath::create();
+        pPath->setName("Flight");
+        const float h = citySize * 0.5f;
+        const glm::vec3 waypoints[] = { { -h, 30, -h }, { h, 20, -h }, { h, 60, h }, { -h, 10, h }, { 0, 200, 0 }, { -h, 30, -h } };
+        for (uint32_t i = 0; i + 1 < arraysize(waypoints); i++)
+        {
+            pPath->addKeyFrame(float(i), waypoints[i], waypoints[i + 1] + glm::vec3(0, -waypoints[i + 1].y, 0), glm::vec3(0, 1, 0));
+        }
+        return pPath;
+    }
+
+    Camera::SharedPtr createCamera()
+    {
+        Camera::SharedPtr pCamera = Camera::create();
+        pCamera->setAspectRatio(16.0f / 9.0f);
+        pCamera->setDepthRange(0.1f, 1000.f);
+        return pCamera;
+    }
+
+    /** What SceneRenderer did before the culler, one instance at a time
+    */
+    void cullReference(const std::vector<TestInstance>& instances, const Camera* pCamera, std::vector<uint32_t>& visible)
+    {
+        visible.clear();
+        for (uint32_t i = 0; i < (uint32_t)instances.size(); i++)
+        {
+            if (pCamera->isObjectCulled(instances[i].box.transform(instances[i].transform)) == false) visible.push_back(i);
+        }
+    }
+}
+
+void InstanceCullingTest::addTests()
+{
+    addTestToList<TestCulling>();
+    addTestToList<BenchmarkCulling>();
+}
+
+testing_func(InstanceCullingTest, TestCulling)
+{
+    // Enough boxes to be culled on worker threads, and a count which isn't a multiple of 4
+    std::vector<TestInstance> instances = createCity(80, 3, 1);
+    instances.resize(instances.size() - 3);
+    InstanceCuller culler;
+    for (const TestInstance& instance : instances) culler.addBox(instance.box, instance.transform);
+    if (culler.getBoxCount() != instances.size()) return test_fail("Wrong box count");
+
+    Camera::SharedPtr pCamera = createCamera();
+    ObjectPath::SharedPtr pPath = createFlightPath(1000.f);
+    pPath->attachObject(pCamera);
+
+    std::vector<uint32_t> visible, visibleSerial, reference;
+    uint32_t visibleTotal = 0;
+    for (uint32_t frame = 0; frame < 64; frame++)
+    {
+        pPath->animate(frame * 4.f / 64.f);
+        culler.cull(pCamera.get(), visible);
+        culler.cull(pCamera.get(), visibleSerial, 1);
+        cullReference(instances, pCamera.get(), reference);
+        if (visible != visibleSerial) return test_fail("Culling on worker threads differs from the calling thread");
+        if (std::is_sorted(visible.begin(), visible.end()) == false) return test_fail("Visible indices aren't sorted");
+
+        // The results can only differ for boxes touching a plane, where rounding decides
+        std::vector<uint32_t> difference;
+        std::set_symmetric_difference(visible.begin(), visible.end(), reference.begin(), reference.end(), std::back_inserter(difference));
+        for (uint32_t i : difference)
+        {
+            BoundingBox box = instances[i].box.transform(instances[i].transform);
+            BoundingBox grown = box, shrunk = box;
+            grown.extent *= 1.001f;
+            shrunk.extent *= 0.999f;
+            if (pCamera->isObjectCulled(grown) == pCamera->isObjectCulled(shrunk)) return test_fail("Box " + std::to_string(i) + " was culled differently than by Camera::isObjectCulled()");
+        }
+        visibleTotal += (uint32_t)visible.size();
+    }
+    if (visibleTotal == 0 || visibleTotal == 64 * instances.size()) return test_fail("The camera path doesn't test partial visibility");
+
+    // Padding lanes are never visible, even when the camera sees the origin, where padding boxes would be
+    culler.clear();
+    if (culler.getBoxCount() != 0) return test_fail("clear() didn't remove the boxes");
+    culler.addBox(BoundingBox::fromMinMax(glm::vec3(-1), glm::vec3(1)), glm::translate(glm::mat4(), glm::vec3(0, 0, 1e5f)));
+    pCamera->setPosition(glm::vec3(0, 0, 10));
+    pCamera->setTarget(glm::vec3(0));
+    culler.cull(pCamera.get(), visible);
+    if (visible.size()) return test_fail("A box outside the frustum or a padding lane is visible");
+    return test_pass();
+}
+
+testing_func(InstanceCullingTest, BenchmarkCulling)
+{
+    const uint32_t kFrames = 512;
+    const uint32_t citySizes[] = { 32, 64, 128 };
+    std::stringstream report;
+    report << "Instance culling over " << kFrames << " frames of a camera path:\n";
+
+    for (uint32_t size : citySizes)
+    {
+        std::vector<TestInstance> instances = createCity(size, 4, size);
+        Camera::SharedPtr pCamera = createCamera();
+        ObjectPath::SharedPtr pPath = createFlightPath(size * 20.f);
+        pPath->attachObject(pCamera);
+
+        InstanceCuller culler;
+        std::vector<uint32_t> visible;
+        double referenceMs = 0, gatherMs = 0, serialMs = 0, parallelMs = 0;
+        uint64_t visibleCount = 0;
+        for (uint32_t frame = 0; frame < kFrames; frame++)
+        {
+            pPath->animate(frame * 4.f / kFrames);
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            cullReference(instances, pCamera.get(), visible);
+            referenceMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            visibleCount += visible.size();
+
+            // SceneRenderer refills the culler every frame, since instances can move
+            start = CpuTimer::getCurrentTimePoint();
+            culler.clear();
+            for (const TestInstance& instance : instances) culler.addBox(instance.box, instance.transform);
+            gatherMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            start = CpuTimer::getCurrentTimePoint();
+            culler.cull(pCamera.get(), visible, 1);
+            serialMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            start = CpuTimer::getCurrentTimePoint();
+            culler.cull(pCamera.get(), visible);
+            parallelMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+
+        const double frames = kFrames;
+        report << "  " << instances.size() << " instances, " << uint64_t(visibleCount / frames) << " visible per frame. CPU time per frame: "
+            << referenceMs / frames << " ms (one at a time), " << gatherMs / frames << " ms (filling the culler), "
+            << serialMs / frames << " ms (SSE, 1 thread), " << parallelMs / frames << " ms (SSE, all threads)\n";
+    }
+
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    InstanceCullingTest ict;
+    ict.init(true);
+    ict.run();
+    return 0;
+}
@@ -0,0 +1,449 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshletTest.h"
+#include "Graphics/Model/Loaders/MeshletBuilder.h"
+#include <array>
+#include <random>
+#include <set>
+#include <sstream>
+
+namespace
+{
+    struct TestMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    /** A size x size grid of quads in the XY plane, facing +Z. Waviness displaces the vertices along Z, so that meshlets get different normal cones.
+    */
+    TestMesh createGrid(uint32_t size, float waviness)
+    {
+        TestMesh mesh;
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            for (uint32_t x = 0; x <= size; x++)
+            {
+                mesh.positions.push_back(glm::vec3(float(x), float(y), waviness * std::sin(x * 0.3f) * std::cos(y * 0.2f)));
+            }
+        }
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                uint32_t i = y * (size + 1) + x;
+                mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + size + 2, i, i + size + 2, i + size + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    /** Random triangles over random vertices, without any locality
+    */
+    TestMesh createSoup(uint32_t vertexCount, uint32_t triangleCount, uint32_t seed)
+    {
+        TestMesh mesh;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        std::uniform_int_distribution<uint32_t> vertex(0, vertexCount - 1);
+        for (uint32_t i = 0; i < vertexCount; i++) mesh.positions.push_back(glm::vec3(unit(rng), unit(rng), unit(rng)) * 10.f);
+        for (uint32_t i = 0; i < triangleCount * 3; i++) mesh.indices.push_back(vertex(rng));
+        return mesh;
+    }
+
+    MeshletData buildMeshlets(const TestMesh& mesh, std::vector<uint32_t>& sortedIndices, uint32_t maxVertices = MeshletBuilder::kDefaultMaxVertices, uint32_t maxTriangles = MeshletBuilder::kDefaultMaxTriangles)
+    {
+        sortedIndices = mesh.indices;
+        return MeshletBuilder::build(sortedIndices.data(), (uint32_t)sortedIndices.size(), mesh.positions.data(), sizeof(glm::vec3), (uint32_t)mesh.positions.size(), maxVertices, maxTriangles);
+    }
+
+    /** Check that the meshlets respect the limits, cover the sorted index buffer in order and that the sorted index buffer holds the original triangles
+    */
+    std::string validateMeshlets(const TestMesh& mesh, const std::vector<uint32_t>& sortedIndices, const MeshletData& data, uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        uint32_t nextTriangle = 0;
+        uint32_t nextVertex = 0;
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            if (meshlet.triangleOffset != nextTriangle || meshlet.vertexOffset != nextVertex) return "Meshlets aren't contiguous";
+            if (meshlet.triangleCount == 0 || meshlet.triangleCount > maxTriangles || meshlet.vertexCount > maxVertices) return "Meshlet exceeds the size limits";
+
+            std::set<uint32_t> vertices(data.vertices.begin() + meshlet.vertexOffset, data.vertices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+            if (vertices.size() != meshlet.vertexCount) return "Meshlet has duplicate vertices";
+
+            for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+            {
+                uint32_t index = meshlet.triangleOffset * 3 + i;
+                uint32_t local = data.primitiveIndices[index];
+                if (local >= meshlet.vertexCount) return "Local index out of range";
+                if (data.vertices[meshlet.vertexOffset + local] != sortedIndices[index]) return "Local indices don't match the index buffer";
+            }
+            nextTriangle += meshlet.triangleCount;
+            nextVertex += meshlet.vertexCount;
+        }
+        if (nextTriangle * 3 != sortedIndices.size() || nextVertex != data.vertices.size()) return "Meshlets don't cover the mesh";
+
+        // The triangles are reordered, but their winding is kept
+        auto getTriangles = [](const std::vector<uint32_t>& indices)
+        {
+            std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+            for (size_t t = 0; t < triangles.size(); t++) triangles[t] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+            std::sort(triangles.begin(), triangles.end());
+            return triangles;
+        };
+        if (getTriangles(mesh.indices) != getTriangles(sortedIndices)) return "The sorted index buffer doesn't hold the original triangles";
+        return "";
+    }
+
+    glm::vec3 getTriangleNormal(const TestMesh& mesh, const std::vector<uint32_t>& indices, uint32_t t, glm::vec3& p0)
+    {
+        p0 = mesh.positions[indices[t * 3]];
+        return glm::cross(mesh.positions[indices[t * 3 + 1]] - p0, mesh.positions[indices[t * 3 + 2]] - p0);
+    }
+
+    bool isConeCulled(const Meshlet& meshlet, const glm::vec3& eye)
+    {
+        return meshlet.coneCutoff <= 1 && glm::dot(glm::normalize(meshlet.coneApex - eye), meshlet.coneAxis) >= meshlet.coneCutoff;
+    }
+
+    /** A set of mesh instances to cull, gathered from a scene
+    */
+    struct CullItem
+    {
+        const MeshletData* pMeshlets;
+        uint32_t triangleCount;
+        glm::mat4 worldMat;
+        BoundingBox box;
+    };
+
+    std::vector<CullItem> getCullItems(const Scene* pScene)
+    {
+        std::vector<CullItem> items;
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            for (uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const Scene::ModelInstance* pInstance = pScene->getModelInstance(modelID, instanceID).get();
+                const Model* pModel = pInstance->getObject().get();
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID).get();
+                        const Mesh* pMesh = pMeshInstance->getObject().get();
+                        CullItem item;
+                        item.pMeshlets = pMesh->getMeshlets();
+                        item.triangleCount = pMesh->getIndexCount() / 3;
+                        item.worldMat = pInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
+                        item.box = pMeshInstance->getBoundingBox().transform(pInstance->getTransformMatrix());
+                        items.push_back(item);
+                    }
+                }
+            }
+        }
+        return items;
+    }
+
+    /** Orbit around a box, for scenes without camera paths
+    */
+    ObjectPath::SharedPtr createOrbitPath(const BoundingBox& box)
+    {
+        ObjectPath::SharedPtr pPath = ObjectPath::create();
+        pPath->setName("Orbit");
+        const float radius = glm::length(box.extent) * 1.5f;
+        const uint32_t kKeyFrames = 8;
+        for (uint32_t i = 0; i <= kKeyFrames; i++)
+        {
+            float angle = float(i) / kKeyFrames * 2.0f * (float)M_PI;
+            glm::vec3 position = box.center + glm::vec3(std::cos(angle) * radius, box.extent.y * 0.5f, std::sin(angle) * radius);
+            pPath->addKeyFrame(float(i), position, box.center, glm::vec3(0, 1, 0));
+        }
+        return pPath;
+    }
+}
+
+void MeshletTest::addTests()
+{
+    addTestToList<TestBuilderLimits>();
+    addTestToList<TestBounds>();
+    addTestToList<TestCulling>();
+    addTestToList<BenchmarkCulling>();
+}
+
+testing_func(MeshletTest, TestBuilderLimits)
+{
+    const TestMesh meshes[] = { createGrid(64, 0), createGrid(40, 5), createSoup(500, 3000, 1), createSoup(100000, 20000, 2) };
+    const uint32_t limits[][2] = { { MeshletBuilder::kDefaultMaxVertices, MeshletBuilder::kDefaultMaxTriangles }, { 128, 128 }, { 256, 512 }, { 64, 64 }, { 3, 1 } };
+
+    for (const TestMesh& mesh : meshes)
+    {
+        for (const auto& limit : limits)
+        {
+            std::vector<uint32_t> sortedIndices;
+            MeshletData data = buildMeshlets(mesh, sortedIndices, limit[0], limit[1]);
+            std::string error = validateMeshlets(mesh, sortedIndices, data, limit[0], limit[1]);
+            if (error.size()) return test_fail(error + " (" + std::to_string(limit[0]) + " vertices, " + std::to_string(limit[1]) + " triangles)");
+        }
+    }
+
+    // A 64-vertex patch of a regular grid holds at most 98 triangles, so the grid's meshlets should be close to full and share few vertices
+    std::vector<uint32_t> sortedIndices;
+    MeshletData data = buildMeshlets(meshes[0], sortedIndices);
+    MeshletBuilder::Stats stats = MeshletBuilder::getStats(data);
+    if (stats.getVerticesPerTriangle() > 0.9f) return test_fail("Grid meshlets transform " + std::to_string(stats.getVerticesPerTriangle()) + " vertices per triangle");
+    if (stats.triangleCount / stats.meshletCount < 64) return test_fail("Grid meshlets hold " + std::to_string(stats.triangleCount / stats.meshletCount) + " triangles on average");
+
+    // An empty mesh has no meshlets
+    if (MeshletBuilder::build(nullptr, 0, nullptr, sizeof(glm::vec3), 0).meshlets.size()) return test_fail("Empty mesh got meshlets");
+    return test_pass();
+}
+
+testing_func(MeshletTest, TestBounds)
+{
+    const TestMesh meshes[] = { createGrid(64, 0), createGrid(64, 3), createSoup(500, 3000, 3) };
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+    for (const TestMesh& mesh : meshes)
+    {
+        std::vector<uint32_t> sortedIndices;
+        MeshletData data = buildMeshlets(mesh, sortedIndices);
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            {
+                const glm::vec3& p = mesh.positions[data.vertices[meshlet.vertexOffset + i]];
+                if (glm::length(p - meshlet.center) > meshlet.radius * (1 + 1e-5f) + 1e-5f) return test_fail("Vertex outside the bounding sphere");
+            }
+
+            // Whenever the cone test culls a meshlet, every triangle must face away from the eye
+            for (uint32_t i = 0; i < 200; i++)
+            {
+                glm::vec3 eye = meshlet.center + glm::vec3(unit(rng), unit(rng), unit(rng)) * 100.f;
+                if (isConeCulled(meshlet, eye) == false) continue;
+                for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+                {
+                    glm::vec3 p0;
+                    glm::vec3 normal = getTriangleNormal(mesh, sortedIndices, t, p0);
+                    if (glm::dot(normal, eye - p0) > 1e-4f * glm::length(normal) * glm::length(eye - p0)) return test_fail("Cone test culled a front-facing triangle");
+                }
+            }
+        }
+    }
+
+    // Flat meshlets are culled from behind only
+    std::vector<uint32_t> sortedIndices;
+    MeshletData flat = buildMeshlets(meshes[0], sortedIndices);
+    for (const Meshlet& meshlet : flat.meshlets)
+    {
+        if (meshlet.coneCutoff > 1e-3f) return test_fail("Flat meshlet has a wide normal cone");
+        if (isConeCulled(meshlet, meshlet.center + glm::vec3(3, -2, 10))) return test_fail("Front-facing flat meshlet was culled");
+        if (isConeCulled(meshlet, meshlet.center + glm::vec3(3, -2, -10)) == false) return test_fail("Back-facing flat meshlet wasn't culled");
+    }
+
+    // Randomly oriented triangles can't be back-face culled. Meshlets with only a few triangles left over at the end can be.
+    MeshletData soup = buildMeshlets(meshes[2], sortedIndices);
+    for (const Meshlet& meshlet : soup.meshlets)
+    {
+        if (meshlet.triangleCount >= 8 && meshlet.coneCutoff <= 1) return test_fail("Random triangles got a normal cone");
+    }
+    return test_pass();
+}
+
+testing_func(MeshletTest, TestCulling)
+{
+    TestMesh mesh = createGrid(64, 0);
+    std::vector<uint32_t> sortedIndices;
+    MeshletData data = buildMeshlets(mesh, sortedIndices);
+    const uint32_t triangleCount = (uint32_t)sortedIndices.size() / 3;
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(0));
+    pCamera->setTarget(glm::vec3(0, 0, -1));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setAspectRatio(1);
+    pCamera->setDepthRange(0.1f, 1000.f);
+
+    std::vector<glm::uvec2> ranges;
+    MeshletCullingStats stats;
+
+    // In front of the camera, facing it
+    glm::mat4 front = glm::translate(glm::mat4(), glm::vec3(-32, -32, -100));
+    if (cullMeshlets(data, front, pCamera.get(), true, ranges, &stats) != triangleCount) return test_fail("Visible meshlets were culled");
+    if (ranges.size() != 1 || ranges[0] != glm::uvec2(0, triangleCount * 3)) return test_fail("Visible meshlets weren't merged into a single range");
+
+    // Behind the camera
+    glm::mat4 behind = glm::translate(glm::mat4(), glm::vec3(-32, -32, 100));
+    if (cullMeshlets(data, behind, pCamera.get(), true, ranges, &stats) != 0 || ranges.size()) return test_fail("Meshlets behind the camera weren't culled");
+
+    // Facing away from the camera. Mirroring flips the facing, so those meshlets can't be back-face culled.
+    glm::mat4 away = glm::translate(glm::mat4(), glm::vec3(32, -32, -100)) * glm::rotate(glm::mat4(), (float)M_PI, glm::vec3(0, 1, 0));
+    if (cullMeshlets(data, away, pCamera.get(), true, ranges, &stats) != 0) return test_fail("Back-facing meshlets weren't culled");
+    if (cullMeshlets(data, away, pCamera.get(), false, ranges, &stats) != triangleCount) return test_fail("Meshlets were back-face culled when back-face culling is off");
+    glm::mat4 mirrored = away * glm::scale(glm::mat4(), glm::vec3(-1, 1, 1));
+    if (cullMeshlets(data, glm::translate(glm::mat4(), glm::vec3(-64, 0, 0)) * mirrored, pCamera.get(), true, ranges, &stats) != triangleCount) return test_fail("Mirrored meshlets were back-face culled");
+
+    // Partially visible. No vertex of a culled meshlet can be inside the frustum.
+    glm::mat4 partial = glm::translate(glm::mat4(), glm::vec3(20, -32, -60));
+    uint32_t visible = cullMeshlets(data, partial, pCamera.get(), true, ranges, &stats);
+    if (visible == 0 || visible == triangleCount) return test_fail("Partially visible mesh wasn't partially culled");
+
+    const glm::mat4 viewProj = pCamera->getViewProjMatrix() * partial;
+    for (const Meshlet& meshlet : data.meshlets)
+    {
+        uint32_t firstIndex = meshlet.triangleOffset * 3;
+        bool isDrawn = false;
+        for (const glm::uvec2& range : ranges) isDrawn |= (firstIndex >= range.x && firstIndex < range.x + range.y);
+        if (isDrawn) continue;
+
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+        {
+            glm::vec4 clip = viewProj * glm::vec4(mesh.positions[data.vertices[meshlet.vertexOffset + i]], 1);
+            bool isInside = clip.w > 0 && std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && clip.z >= 0 && clip.z <= clip.w;
+            if (isInside) return test_fail("A meshlet with a vertex in the frustum was culled");
+        }
+    }
+
+    if (stats.meshletCount != 6 * data.meshlets.size() || stats.triangleCount != 6 * triangleCount) return test_fail("Culling statistics don't add up");
+    return test_pass();
+}
+
+testing_func(MeshletTest, BenchmarkCulling)
+{
+    struct BenchmarkScene
+    {
+        std::string name;
+        Scene::SharedPtr pScene;
+    };
+    std::vector<BenchmarkScene> scenes;
+
+    // The sample scenes with their own camera paths, and sample models orbited by the camera
+    const Model::LoadFlags loadFlags = Model::LoadFlags::GenerateMeshlets;
+    const char* sampleScenes[] = { "pink_room/pink_room.fscene" };
+    for (const char* file : sampleScenes)
+    {
+        std::string fullpath;
+        if (!findFileInDataDirectories(file, fullpath)) continue;
+        Scene::SharedPtr pScene = Scene::loadFromFile(fullpath, loadFlags);
+        if (pScene && pScene->getPathCount()) scenes.push_back({ file, pScene });
+    }
+
+    const char* sampleModels[] = { "Arcade/Arcade.fbx" };
+    for (const char* file : sampleModels)
+    {
+        std::string fullpath;
+        if (!findFileInDataDirectories(file, fullpath)) continue;
+        Model::SharedPtr pModel = Model::createFromFile(fullpath.c_str(), loadFlags);
+        if (!pModel) continue;
+        Scene::SharedPtr pScene = Scene::create();
+        pScene->addModelInstance(pModel, "Model");
+        pScene->addPath(createOrbitPath(pModel->getBoundingBox()));
+        scenes.push_back({ file, pScene });
+    }
+    if (scenes.empty()) return test_fail("Can't find any of the sample scenes");
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.1f, 10000.f);
+
+    const uint32_t kFramesPerPath = 256;
+    std::stringstream report;
+    report << "Meshlet culling over " << kFramesPerPath << " frames per camera path:\n";
+    std::vector<glm::uvec2> ranges;
+
+    for (const BenchmarkScene& scene : scenes)
+    {
+        std::vector<CullItem> items = getCullItems(scene.pScene.get());
+        MeshletBuilder::Stats buildStats;
+        for (const CullItem& item : items)
+        {
+            if (item.pMeshlets) buildStats += MeshletBuilder::getStats(*item.pMeshlets);
+        }
+        report << "  " << scene.name << ": " << items.size() << " mesh instances, " << buildStats.meshletCount << " meshlets in " << buildStats.meshCount << " meshes\n";
+
+        for (uint32_t pathID = 0; pathID < scene.pScene->getPathCount(); pathID++)
+        {
+            const ObjectPath::SharedPtr& pPath = scene.pScene->getPath(pathID);
+            if (pPath->getKeyFrameCount() < 2) continue;
+            const float startTime = pPath->getKeyFrame(0).time;
+            const float endTime = pPath->getKeyFrame(pPath->getKeyFrameCount() - 1).time;
+            pPath->attachObject(pCamera);
+
+            uint64_t instanceTriangles = 0, meshletTriangles = 0, coneTriangles = 0;
+            double instanceMs = 0, meshletMs = 0;
+            MeshletCullingStats stats;
+            for (uint32_t frame = 0; frame < kFramesPerPath; frame++)
+            {
+                pPath->animate(startTime + (endTime - startTime) * float(frame) / float(kFramesPerPath - 1));
+
+                // Mesh instance culling, what SceneRenderer does without meshlets
+                CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+                std::vector<uint8_t> visible(items.size());
+                for (size_t i = 0; i < items.size(); i++)
+                {
+                    visible[i] = pCamera->isObjectCulled(items[i].box) ? 0 : 1;
+                    instanceTriangles += visible[i] ? items[i].triangleCount : 0;
+                }
+                instanceMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+                // Meshlet culling of the visible instances, with and without the normal cones
+                start = CpuTimer::getCurrentTimePoint();
+                for (size_t i = 0; i < items.size(); i++)
+                {
+                    if (!visible[i]) continue;
+                    coneTriangles += items[i].pMeshlets ? cullMeshlets(*items[i].pMeshlets, items[i].worldMat, pCamera.get(), true, ranges, &stats) : items[i].triangleCount;
+                }
+                meshletMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+                for (size_t i = 0; i < items.size(); i++)
+                {
+                    if (!visible[i]) continue;
+                    meshletTriangles += items[i].pMeshlets ? cullMeshlets(*items[i].pMeshlets, items[i].worldMat, pCamera.get(), false, ranges) : items[i].triangleCount;
+                }
+            }
+            pPath->detachObject(pCamera);
+
+            const double frames = kFramesPerPath;
+            report << "    " << pPath->getName() << ": triangles per frame " << uint64_t(instanceTriangles / frames) << " (instance culling), "
+                << uint64_t(meshletTriangles / frames) << " (meshlet frustum culling), " << uint64_t(coneTriangles / frames) << " (meshlet frustum and cone culling). "
+                << "CPU time per frame " << instanceMs / frames << " ms (instances), " << meshletMs / frames << " ms (meshlets), "
+                << double(stats.rangeCount) / frames << " draws per frame\n";
+        }
+    }
+
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    MeshletTest mt;
+    mt.init(true);
+    mt.run();
+    return 0;
+}
@@ -0,0 +1,607 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ModelCacheTest.h"
+#include "Graphics/Model/Loaders/ModelCache.h"
+#include "assimp/scene.h"
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+
+namespace
+{
+    // Offsets of the fields of the entry header, see EntryHeader in ModelCache.cpp
+    const size_t kMagicOffset = 0;
+    const size_t kVersionOffset = 4;
+    const size_t kPayloadSizeOffset = 8;
+    const size_t kHeaderSize = 16;
+
+    template<typename T>
+    T* copyArray(const std::vector<T>& values)
+    {
+        T* pArray = new T[values.size()];
+        std::copy(values.begin(), values.end(), pArray);
+        return pArray;
+    }
+
+    aiMesh* createMesh(const std::string& name, uint32_t vertexCount, uint32_t materialIndex, const std::vector<std::vector<unsigned int>>& faces, bool allStreams)
+    {
+        aiMesh* pMesh = new aiMesh();
+        pMesh->mName = name;
+        pMesh->mMaterialIndex = materialIndex;
+        pMesh->mNumVertices = vertexCount;
+        pMesh->mVertices = new aiVector3D[vertexCount];
+        for (uint32_t v = 0; v < vertexCount; v++) pMesh->mVertices[v] = aiVector3D(float(v), float(v % 3), -float(v) * 0.5f);
+
+        if (allStreams)
+        {
+            pMesh->mNormals = new aiVector3D[vertexCount];
+            pMesh->mTangents = new aiVector3D[vertexCount];
+            pMesh->mBitangents = new aiVector3D[vertexCount];
+            pMesh->mColors[0] = new aiColor4D[vertexCount];
+            pMesh->mTextureCoords[0] = new aiVector3D[vertexCount];
+            pMesh->mTextureCoords[2] = new aiVector3D[vertexCount];
+            pMesh->mNumUVComponents[0] = 2;
+            pMesh->mNumUVComponents[2] = 3;
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                pMesh->mNormals[v] = aiVector3D(0, 0, 1);
+                pMesh->mTangents[v] = aiVector3D(1, 0, 0);
+                pMesh->mBitangents[v] = aiVector3D(0, 1, 0);
+                pMesh->mColors[0][v] = aiColor4D(0.25f, 0.5f, float(v) / vertexCount, 1);
+                pMesh->mTextureCoords[0][v] = aiVector3D(float(v) / vertexCount, 1 - float(v) / vertexCount, 0);
+                pMesh->mTextureCoords[2][v] = aiVector3D(0.5f, float(v), 2);
+            }
+
+            // Two bones sharing the vertices
+            pMesh->mNumBones = 2;
+            pMesh->mBones = new aiBone*[2];
+            for (uint32_t b = 0; b < 2; b++)
+            {
+                aiBone* pBone = new aiBone();
+                pBone->mName = "Bone" + std::to_string(b);
+                pBone->mOffsetMatrix = aiMatrix4x4(aiVector3D(1, 2, 1), aiQuaternion(0.5f * b, 0.25f, 0), aiVector3D(float(b), 0, 3));
+                pBone->mNumWeights = vertexCount;
+                pBone->mWeights = new aiVertexWeight[vertexCount];
+                for (uint32_t v = 0; v < vertexCount; v++) pBone->mWeights[v] = aiVertexWeight(v, b ? 0.25f : 0.75f);
+                pMesh->mBones[b] = pBone;
+            }
+        }
+
+        pMesh->mNumFaces = (unsigned int)faces.size();
+        pMesh->mFaces = new aiFace[faces.size()];
+        for (size_t f = 0; f < faces.size(); f++)
+        {
+            pMesh->mFaces[f].mNumIndices = (unsigned int)faces[f].size();
+            pMesh->mFaces[f].mIndices = copyArray(faces[f]);
+            pMesh->mPrimitiveTypes |= (faces[f].size() == 3) ? aiPrimitiveType_TRIANGLE : aiPrimitiveType_POLYGON;
+        }
+        return pMesh;
+    }
+
+    aiMaterial* createMaterial(const std::string& name, const aiColor3D& diffuse, const std::string& texture)
+    {
+        aiMaterial* pMaterial = new aiMaterial();
+        aiString str(name);
+        pMaterial->AddProperty(&str, AI_MATKEY_NAME);
+        pMaterial->AddProperty(&diffuse, 1, AI_MATKEY_COLOR_DIFFUSE);
+        float shininess = 16.0f;
+        pMaterial->AddProperty(&shininess, 1, AI_MATKEY_SHININESS);
+        if (texture.size())
+        {
+            str = texture;
+            pMaterial->AddProperty(&str, AI_MATKEY_TEXTURE_DIFFUSE(0));
+        }
+        return pMaterial;
+    }
+
+    aiNode* createNode(const std::string& name, aiNode* pParent, const std::vector<unsigned int>& meshes, const aiMatrix4x4& transform)
+    {
+        aiNode* pNode = new aiNode(name);
+        pNode->mParent = pParent;
+        pNode->mTransformation = transform;
+        pNode->mNumMeshes = (unsigned int)meshes.size();
+        pNode->mMeshes = meshes.size() ? copyArray(meshes) : nullptr;
+        return pNode;
+    }
+
+    void setChildren(aiNode* pNode, const std::vector<aiNode*>& children)
+    {
+        pNode->mNumChildren = (unsigned int)children.size();
+        pNode->mChildren = copyArray(children);
+    }
+
+    /** A scene with every kind of data the cache stores: a skinned triangle mesh with all vertex streams, a mesh with mixed face sizes,
+        two materials, an animation and a node tree three levels deep
+    */
+    std::unique_ptr<aiScene> createScene()
+    {
+        std::unique_ptr<aiScene> pScene(new aiScene());
+        pScene->mFlags = AI_SCENE_FLAGS_NON_VERBOSE_FORMAT;
+
+        pScene->mNumMeshes = 2;
+        pScene->mMeshes = new aiMesh*[2];
+        pScene->mMeshes[0] = createMesh("Skinned", 6, 0, { { 0, 1, 2 }, { 2, 1, 3 }, { 3, 4, 5 } }, true);
+        pScene->mMeshes[1] = createMesh("Mixed", 5, 1, { { 0, 1, 2 }, { 1, 2, 3, 4 } }, false);
+
+        pScene->mNumMaterials = 2;
+        pScene->mMaterials = new aiMaterial*[2];
+        pScene->mMaterials[0] = createMaterial("Textured", aiColor3D(1, 0.5f, 0.25f), "textures/diffuse.png");
+        pScene->mMaterials[1] = createMaterial("Plain", aiColor3D(0, 1, 0), "");
+
+        aiAnimation* pAnim = new aiAnimation();
+        pAnim->mName = "Wave";
+        pAnim->mDuration = 48;
+        pAnim->mTicksPerSecond = 24;
+        pAnim->mNumChannels = 2;
+        pAnim->mChannels = new aiNodeAnim*[2];
+        for (uint32_t c = 0; c < 2; c++)
+        {
+            aiNodeAnim* pChannel = new aiNodeAnim();
+            pChannel->mNodeName = "Bone" + std::to_string(c);
+            pChannel->mPreState = aiAnimBehaviour_CONSTANT;
+            pChannel->mPostState = aiAnimBehaviour_REPEAT;
+            pChannel->mNumPositionKeys = 3;
+            pChannel->mPositionKeys = new aiVectorKey[3];
+            for (uint32_t k = 0; k < 3; k++) pChannel->mPositionKeys[k] = aiVectorKey(k * 24.0, aiVector3D(float(k), float(c), 0));
+            pChannel->mNumRotationKeys = 2;
+            pChannel->mRotationKeys = new aiQuatKey[2];
+            pChannel->mRotationKeys[0] = aiQuatKey(0.0, aiQuaternion(1, 0, 0, 0));
+            pChannel->mRotationKeys[1] = aiQuatKey(48.0, aiQuaternion(0, 1, 0, 0));
+            pChannel->mNumScalingKeys = 1;
+            pChannel->mScalingKeys = new aiVectorKey[1];
+            pChannel->mScalingKeys[0] = aiVectorKey(0.0, aiVector3D(1, 2, 3));
+            pAnim->mChannels[c] = pChannel;
+        }
+        pScene->mNumAnimations = 1;
+        pScene->mAnimations = new aiAnimation*[1];
+        pScene->mAnimations[0] = pAnim;
+
+        aiNode* pRoot = createNode("Root", nullptr, {}, aiMatrix4x4());
+        aiNode* pBody = createNode("Body", pRoot, { 0 }, aiMatrix4x4(aiVector3D(2), aiQuaternion(0.1f, 0.2f, 0.3f), aiVector3D(1, 0, 0)));
+        aiNode* pProp = createNode("Prop", pRoot, { 1, 1 }, aiMatrix4x4());
+        aiNode* pBone0 = createNode("Bone0", pBody, {}, aiMatrix4x4());
+        aiNode* pBone1 = createNode("Bone1", pBone0, {}, aiMatrix4x4(aiVector3D(1), aiQuaternion(0, 0, 0.5f), aiVector3D(0, 1, 0)));
+        setChildren(pRoot, { pBody, pProp });
+        setChildren(pBody, { pBone0 });
+        setChildren(pBone0, { pBone1 });
+        pScene->mRootNode = pRoot;
+        return pScene;
+    }
+
+    std::vector<MeshletData> createMeshlets()
+    {
+        // One meshlet per mesh, covering all of its triangles
+        std::vector<MeshletData> meshlets(2);
+        for (uint32_t m = 0; m < 2; m++)
+        {
+            Meshlet meshlet;
+            meshlet.vertexCount = 4 + m;
+            meshlet.triangleCount = 2 + m;
+            meshlet.center = glm::vec3(1, 2, float(m));
+            meshlet.radius = 3;
+            meshlet.coneAxis = glm::vec3(0, 0, 1);
+            meshlet.coneCutoff = 0.5f;
+            meshlets[m].meshlets.push_back(meshlet);
+            for (uint32_t v = 0; v < meshlet.vertexCount; v++) meshlets[m].vertices.push_back(v);
+            for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++) meshlets[m].primitiveIndices.push_back(uint8_t(i % meshlet.vertexCount));
+        }
+        return meshlets;
+    }
+
+    template<typename T>
+    bool equalArrays(const T* pA, const T* pB, uint32_t count)
+    {
+        if (!pA || !pB) return pA == pB;
+        return std::memcmp(pA, pB, sizeof(T) * count) == 0;
+    }
+
+    template<typename T>
+    bool equalVectors(const std::vector<T>& a, const std::vector<T>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0);
+    }
+
+    bool equalStrings(const aiString& a, const aiString& b) { return a.length == b.length && std::strcmp(a.C_Str(), b.C_Str()) == 0; }
+
+    std::string compareMeshes(const aiMesh* pA, const aiMesh* pB)
+    {
+        if (!equalStrings(pA->mName, pB->mName)) return "name differs";
+        if (pA->mPrimitiveTypes != pB->mPrimitiveTypes || pA->mMaterialIndex != pB->mMaterialIndex || pA->mNumVertices != pB->mNumVertices) return "header differs";
+        const uint32_t vertexCount = pA->mNumVertices;
+        if (!equalArrays(pA->mVertices, pB->mVertices, vertexCount) || !equalArrays(pA->mNormals, pB->mNormals, vertexCount) ||
+            !equalArrays(pA->mTangents, pB->mTangents, vertexCount) || !equalArrays(pA->mBitangents, pB->mBitangents, vertexCount))
+        {
+            return "vertex streams differ";
+        }
+        for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+        {
+            if (!equalArrays(pA->mColors[i], pB->mColors[i], vertexCount)) return "color set " + std::to_string(i) + " differs";
+        }
+        for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+        {
+            if (!equalArrays(pA->mTextureCoords[i], pB->mTextureCoords[i], vertexCount) || (pA->mTextureCoords[i] && pA->mNumUVComponents[i] != pB->mNumUVComponents[i])) return "texture coordinate set " + std::to_string(i) + " differs";
+        }
+
+        if (pA->mNumFaces != pB->mNumFaces) return "face count differs";
+        for (uint32_t f = 0; f < pA->mNumFaces; f++)
+        {
+            const aiFace& a = pA->mFaces[f];
+            const aiFace& b = pB->mFaces[f];
+            if (a.mNumIndices != b.mNumIndices || !equalArrays(a.mIndices, b.mIndices, a.mNumIndices)) return "face " + std::to_string(f) + " differs";
+        }
+
+        if (pA->mNumBones != pB->mNumBones) return "bone count differs";
+        for (uint32_t i = 0; i < pA->mNumBones; i++)
+        {
+            const aiBone* pBoneA = pA->mBones[i];
+            const aiBone* pBoneB = pB->mBones[i];
+            if (!equalStrings(pBoneA->mName, pBoneB->mName) || !(pBoneA->mOffsetMatrix == pBoneB->mOffsetMatrix) || pBoneA->mNumWeights != pBoneB->mNumWeights ||
+                !equalArrays(pBoneA->mWeights, pBoneB->mWeights, pBoneA->mNumWeights))
+            {
+                return "bone " + std::to_string(i) + " differs";
+            }
+        }
+        return "";
+    }
+
+    std::string compareMaterials(const aiMaterial* pA, const aiMaterial* pB)
+    {
+        if (pA->mNumProperties != pB->mNumProperties) return "property count differs";
+        for (uint32_t i = 0; i < pA->mNumProperties; i++)
+        {
+            const aiMaterialProperty* pPropA = pA->mProperties[i];
+            const aiMaterialProperty* pPropB = pB->mProperties[i];
+            if (!equalStrings(pPropA->mKey, pPropB->mKey) || pPropA->mSemantic != pPropB->mSemantic || pPropA->mIndex != pPropB->mIndex || pPropA->mType != pPropB->mType ||
+                pPropA->mDataLength != pPropB->mDataLength || !equalArrays(pPropA->mData, pPropB->mData, pPropA->mDataLength))
+            {
+                return std::string("property ") + pPropA->mKey.C_Str() + " differs";
+            }
+        }
+        return "";
+    }
+
+    std::string compareAnimations(const aiAnimation* pA, const aiAnimation* pB)
+    {
+        if (!equalStrings(pA->mName, pB->mName) || pA->mDuration != pB->mDuration || pA->mTicksPerSecond != pB->mTicksPerSecond) return "header differs";
+        if (pA->mNumChannels != pB->mNumChannels) return "channel count differs";
+        for (uint32_t i = 0; i < pA->mNumChannels; i++)
+        {
+            const aiNodeAnim* pChannelA = pA->mChannels[i];
+            const aiNodeAnim* pChannelB = pB->mChannels[i];
+            if (!equalStrings(pChannelA->mNodeName, pChannelB->mNodeName) || pChannelA->mPreState != pChannelB->mPreState || pChannelA->mPostState != pChannelB->mPostState ||
+                pChannelA->mNumPositionKeys != pChannelB->mNumPositionKeys || !equalArrays(pChannelA->mPositionKeys, pChannelB->mPositionKeys, pChannelA->mNumPositionKeys) ||
+                pChannelA->mNumRotationKeys != pChannelB->mNumRotationKeys || !equalArrays(pChannelA->mRotationKeys, pChannelB->mRotationKeys, pChannelA->mNumRotationKeys) ||
+                pChannelA->mNumScalingKeys != pChannelB->mNumScalingKeys || !equalArrays(pChannelA->mScalingKeys, pChannelB->mScalingKeys, pChannelA->mNumScalingKeys))
+            {
+                return "channel " + std::to_string(i) + " differs";
+            }
+        }
+        return "";
+    }
+
+    std::string compareNodes(const aiNode* pA, const aiNode* pB, const aiNode* pParentB)
+    {
+        std::string nodeStr = std::string("Node ") + pA->mName.C_Str() + ": ";
+        if (!equalStrings(pA->mName, pB->mName)) return nodeStr + "name differs";
+        if (pB->mParent != pParentB) return nodeStr + "parent differs";
+        if (!(pA->mTransformation == pB->mTransformation)) return nodeStr + "transform differs";
+        if (pA->mNumMeshes != pB->mNumMeshes || !equalArrays(pA->mMeshes, pB->mMeshes, pA->mNumMeshes)) return nodeStr + "meshes differ";
+        if (pA->mNumChildren != pB->mNumChildren) return nodeStr + "child count differs";
+        for (uint32_t i = 0; i < pA->mNumChildren; i++)
+        {
+            std::string error = compareNodes(pA->mChildren[i], pB->mChildren[i], pB);
+            if (error.size()) return error;
+        }
+        return "";
+    }
+
+    std::string compareScenes(const aiScene* pA, const aiScene* pB)
+    {
+        if (pA->mFlags != pB->mFlags) return "Scene flags differ";
+        if (pA->mNumMeshes != pB->mNumMeshes) return "Mesh count differs";
+        for (uint32_t i = 0; i < pA->mNumMeshes; i++)
+        {
+            std::string error = compareMeshes(pA->mMeshes[i], pB->mMeshes[i]);
+            if (error.size()) return "Mesh " + std::to_string(i) + ": " + error;
+        }
+        if (pA->mNumMaterials != pB->mNumMaterials) return "Material count differs";
+        for (uint32_t i = 0; i < pA->mNumMaterials; i++)
+        {
+            std::string error = compareMaterials(pA->mMaterials[i], pB->mMaterials[i]);
+            if (error.size()) return "Material " + std::to_string(i) + ": " + error;
+        }
+        if (pA->mNumAnimations != pB->mNumAnimations) return "Animation count differs";
+        for (uint32_t i = 0; i < pA->mNumAnimations; i++)
+        {
+            std::string error = compareAnimations(pA->mAnimations[i], pB->mAnimations[i]);
+            if (error.size()) return "Animation " + std::to_string(i) + ": " + error;
+        }
+        if (!pB->mRootNode) return "The root node is missing";
+        return compareNodes(pA->mRootNode, pB->mRootNode, nullptr);
+    }
+
+    /** Visit every array of a loaded scene up to the counts it claims, so that an inconsistent scene is caught here and not by the importer
+    */
+    uint64_t touchScene(const aiScene* pScene)
+    {
+        uint64_t sum = 0;
+        auto touch = [&sum](const void* pData, size_t size)
+        {
+            if (size) sum += ((const uint8_t*)pData)[0] + ((const uint8_t*)pData)[size - 1];
+        };
+        std::function<void(const aiNode*)> touchNode = [&](const aiNode* pNode)
+        {
+            touch(pNode->mMeshes, pNode->mNumMeshes * sizeof(unsigned int));
+            for (uint32_t i = 0; i < pNode->mNumChildren; i++) touchNode(pNode->mChildren[i]);
+        };
+
+        for (uint32_t m = 0; m < pScene->mNumMeshes; m++)
+        {
+            const aiMesh* pMesh = pScene->mMeshes[m];
+            const size_t streamSize = pMesh->mNumVertices * sizeof(aiVector3D);
+            if (pMesh->mVertices) touch(pMesh->mVertices, streamSize);
+            if (pMesh->mNormals) touch(pMesh->mNormals, streamSize);
+            if (pMesh->mTangents) touch(pMesh->mTangents, streamSize);
+            if (pMesh->mBitangents) touch(pMesh->mBitangents, streamSize);
+            for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+            {
+                if (pMesh->mColors[i]) touch(pMesh->mColors[i], pMesh->mNumVertices * sizeof(aiColor4D));
+            }
+            for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+            {
+                if (pMesh->mTextureCoords[i]) touch(pMesh->mTextureCoords[i], streamSize);
+            }
+            for (uint32_t f = 0; f < pMesh->mNumFaces; f++) touch(pMesh->mFaces[f].mIndices, pMesh->mFaces[f].mNumIndices * sizeof(unsigned int));
+            for (uint32_t b = 0; b < pMesh->mNumBones; b++) touch(pMesh->mBones[b]->mWeights, pMesh->mBones[b]->mNumWeights * sizeof(aiVertexWeight));
+        }
+        for (uint32_t m = 0; m < pScene->mNumMaterials; m++)
+        {
+            for (uint32_t p = 0; p < pScene->mMaterials[m]->mNumProperties; p++) touch(pScene->mMaterials[m]->mProperties[p]->mData, pScene->mMaterials[m]->mProperties[p]->mDataLength);
+        }
+        for (uint32_t a = 0; a < pScene->mNumAnimations; a++)
+        {
+            for (uint32_t c = 0; c < pScene->mAnimations[a]->mNumChannels; c++)
+            {
+                const aiNodeAnim* pChannel = pScene->mAnimations[a]->mChannels[c];
+                touch(pChannel->mPositionKeys, pChannel->mNumPositionKeys * sizeof(aiVectorKey));
+                touch(pChannel->mRotationKeys, pChannel->mNumRotationKeys * sizeof(aiQuatKey));
+                touch(pChannel->mScalingKeys, pChannel->mNumScalingKeys * sizeof(aiVectorKey));
+            }
+        }
+        touchNode(pScene->mRootNode);
+        return sum;
+    }
+
+    std::vector<uint8_t> readFileData(const std::string& filename)
+    {
+        std::ifstream in(filename, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFileData(const std::string& filename, const std::vector<uint8_t>& data, size_t size)
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write((const char*)data.data(), size);
+    }
+
+    template<typename T>
+    std::vector<uint8_t> asBytes(T val)
+    {
+        std::vector<uint8_t> bytes(sizeof(T));
+        std::memcpy(bytes.data(), &val, sizeof(T));
+        return bytes;
+    }
+
+    std::string getTestFilename(const std::string& name)
+    {
+        // A directory of its own, since storing an entry evicts other entries in the same directory
+        return getExecutableDirectory() + "/ModelCacheTest/" + name + ".aicache";
+    }
+
+    /** Store the test scene and return the entry's content
+    */
+    std::vector<uint8_t> storeScene(const std::string& filename)
+    {
+        std::unique_ptr<aiScene> pScene = createScene();
+        std::vector<MeshletData> meshlets = createMeshlets();
+        if (!ModelCache::store(pScene.get(), filename, &meshlets)) return {};
+        std::vector<uint8_t> data = readFileData(filename);
+        std::remove(filename.c_str());
+        return data;
+    }
+
+    /** Write an entry and load it back. Loading must never crash. Returns whether the entry loaded.
+    */
+    bool loadEntry(const std::string& filename, const std::vector<uint8_t>& data, size_t size)
+    {
+        writeFileData(filename, data, size);
+        std::vector<MeshletData> meshlets;
+        std::unique_ptr<aiScene> pScene(ModelCache::load(filename, &meshlets));
+        if (pScene)
+        {
+            volatile uint64_t checksum = touchScene(pScene.get());
+            (void)checksum;
+            std::remove(filename.c_str());
+        }
+        return pScene != nullptr;
+    }
+}
+
+void ModelCacheTest::addTests()
+{
+    addTestToList<TestRoundTrip>();
+    addTestToList<TestCorruptHeader>();
+    addTestToList<TestTruncatedEntry>();
+    addTestToList<TestCorruptedBytes>();
+}
+
+testing_func(ModelCacheTest, TestRoundTrip)
+{
+    std::unique_ptr<aiScene> pScene = createScene();
+    std::vector<MeshletData> meshlets = createMeshlets();
+    std::string filename = getTestFilename("RoundTrip");
+    if (!ModelCache::store(pScene.get(), filename, &meshlets)) return test_fail("Can't write " + filename);
+
+    std::vector<MeshletData> loadedMeshlets;
+    std::unique_ptr<aiScene> pLoaded(ModelCache::load(filename, &loadedMeshlets));
+    if (!pLoaded) return test_fail("Can't load the entry");
+    std::string error = compareScenes(pScene.get(), pLoaded.get());
+    if (error.size()) return test_fail(error);
+
+    if (loadedMeshlets.size() != meshlets.size()) return test_fail("Meshlet count differs");
+    for (size_t m = 0; m < meshlets.size(); m++)
+    {
+        if (!equalVectors(meshlets[m].meshlets, loadedMeshlets[m].meshlets) || !equalVectors(meshlets[m].vertices, loadedMeshlets[m].vertices) ||
+            !equalVectors(meshlets[m].primitiveIndices, loadedMeshlets[m].primitiveIndices))
+        {
+            return test_fail("Meshlets of mesh " + std::to_string(m) + " differ");
+        }
+    }
+
+    // Without meshlets, and loading without asking for them
+    if (!ModelCache::store(pScene.get(), filename)) return test_fail("Can't write " + filename);
+    pLoaded.reset(ModelCache::load(filename, &loadedMeshlets));
+    if (!pLoaded || loadedMeshlets.size()) return test_fail("An entry without meshlets doesn't load");
+    pLoaded.reset(ModelCache::load(filename));
+    std::remove(filename.c_str());
+    if (!pLoaded) return test_fail("Can't load the entry without reading its meshlets");
+    error = compareScenes(pScene.get(), pLoaded.get());
+    if (error.size()) return test_fail(error);
+    return test_pass();
+}
+
+testing_func(ModelCacheTest, TestCorruptHeader)
+{
+    std::string filename = getTestFilename("CorruptHeader");
+    const std::vector<uint8_t> source = storeScene(filename);
+    if (source.size() <= kHeaderSize) return test_fail("Can't write " + filename);
+    if (!loadEntry(filename, source, source.size())) return test_fail("The unmodified entry doesn't load");
+    uint32_t version;
+    std::memcpy(&version, source.data() + kVersionOffset, sizeof(uint32_t));
+
+    struct Case
+    {
+        std::string name;
+        size_t offset;      ///< Offset of the bytes to overwrite
+        std::vector<uint8_t> bytes;
+        size_t size;        ///< Size of the file
+    };
+    const Case cases[] =
+    {
+        { "empty file", 0, {}, 0 },
+        { "truncated header", 0, {}, kHeaderSize / 2 },
+        { "truncated payload", 0, {}, source.size() - 1 },
+        { "wrong magic", kMagicOffset, { 'X' }, source.size() },
+        { "newer version", kVersionOffset, asBytes(version + 1), source.size() },
+        { "older version", kVersionOffset, asBytes(version - 1), source.size() },
+        { "payload past the end", kPayloadSizeOffset, asBytes(uint64_t(source.size())), source.size() },
+        { "short payload", kPayloadSizeOffset, asBytes(uint64_t(source.size() - kHeaderSize - 8)), source.size() },
+    };
+
+    for (const Case& c : cases)
+    {
+        std::vector<uint8_t> data = source;
+        std::copy(c.bytes.begin(), c.bytes.end(), data.begin() + c.offset);
+        if (loadEntry(filename, data, c.size)) return test_fail("An entry with a " + c.name + " was loaded");
+        if (doesFileExist(filename)) return test_fail("The entry with a " + c.name + " wasn't removed");
+    }
+
+    // A missing entry is a plain miss
+    std::unique_ptr<aiScene> pScene(ModelCache::load(filename));
+    if (pScene) return test_fail("A missing entry was loaded");
+    return test_pass();
+}
+
+testing_func(ModelCacheTest, TestTruncatedEntry)
+{
+    // Cut the payload at every length, with a header which matches, so that the reader itself has to notice the missing data
+    std::string filename = getTestFilename("Truncated");
+    const std::vector<uint8_t> source = storeScene(filename);
+    if (source.size() <= kHeaderSize) return test_fail("Can't write " + filename);
+
+    for (size_t size = kHeaderSize; size < source.size(); size++)
+    {
+        std::vector<uint8_t> data = source;
+        uint64_t payloadSize = size - kHeaderSize;
+        std::memcpy(data.data() + kPayloadSizeOffset, &payloadSize, sizeof(uint64_t));
+        if (loadEntry(filename, data, size)) return test_fail("An entry truncated to " + std::to_string(size) + " bytes was loaded");
+    }
+
+    // Trailing data is rejected as well
+    std::vector<uint8_t> data = source;
+    data.resize(source.size() + 8, 0);
+    uint64_t payloadSize = data.size() - kHeaderSize;
+    std::memcpy(data.data() + kPayloadSizeOffset, &payloadSize, sizeof(uint64_t));
+    if (loadEntry(filename, data, data.size())) return test_fail("An entry with trailing data was loaded");
+
+    // The meshlets must match the meshes
+    std::unique_ptr<aiScene> pScene = createScene();
+    std::vector<MeshletData> meshlets = createMeshlets();
+    meshlets.pop_back();
+    if (!ModelCache::store(pScene.get(), filename, &meshlets)) return test_fail("Can't write " + filename);
+    std::unique_ptr<aiScene> pLoaded(ModelCache::load(filename));
+    std::remove(filename.c_str());
+    if (pLoaded) return test_fail("An entry with fewer meshlet lists than meshes was loaded");
+    return test_pass();
+}
+
+testing_func(ModelCacheTest, TestCorruptedBytes)
+{
+    // Overwrite the payload a byte at a time. Counts and sizes may now be anything, so the entry may or may not load, but it must not crash,
+    // and a loaded scene must be consistent with its counts.
+    std::string filename = getTestFilename("Corrupted");
+    const std::vector<uint8_t> source = storeScene(filename);
+    if (source.size() <= kHeaderSize) return test_fail("Can't write " + filename);
+
+    uint32_t loadedCount = 0, corruptCount = 0;
+    for (size_t offset = kHeaderSize; offset < source.size(); offset++)
+    {
+        for (uint8_t value : { uint8_t(source[offset] ^ 0x80), uint8_t(0xff) })
+        {
+            if (value == source[offset]) continue;
+            std::vector<uint8_t> data = source;
+            data[offset] = value;
+            loadedCount += loadEntry(filename, data, data.size()) ? 1 : 0;
+            corruptCount++;
+        }
+    }
+    std::remove(filename.c_str());
+
+    // Most bytes are vertex data, which can't be told apart from valid data, but the counts and sizes are checked
+    if (loadedCount == corruptCount) return test_fail("No corrupted entry was rejected");
+    return test_pass();
+}
+
+int main()
+{
+    ModelCacheTest mct;
+    mct.init(true);
+    mct.run();
+    return 0;
+}
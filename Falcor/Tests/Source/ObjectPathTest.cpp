@@ -0,0 +1,266 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ObjectPathTest.h"
+#include "Graphics/Paths/ObjectPath.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    /** Remembers where the path moved it
+    */
+    class MovableRecorder : public IMovableObject
+    {
+    public:
+        void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override
+        {
+            mPosition = position;
+            mTarget = target;
+            mUp = up;
+        }
+
+        glm::vec3 mPosition;
+        glm::vec3 mTarget;
+        glm::vec3 mUp;
+    };
+
+    /** A winding path whose key frames are unevenly spaced in both distance and time, like a hand-made camera flight
+    */
+    ObjectPath::SharedPtr createPath(uint32_t keyFrameCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        ObjectPath::SharedPtr pPath = ObjectPath::create();
+        float time = 0;
+        float angle = 0;
+        for (uint32_t i = 0; i < keyFrameCount; i++)
+        {
+            const float radius = 5.0f + 20.0f * unit(rng);
+            const vec3 position(radius * std::cos(angle), 2.0f * unit(rng), radius * std::sin(angle));
+            pPath->addKeyFrame(time, position, position + vec3(1, 0, 0), vec3(0, 1, 0));
+            time += 0.2f + 2.0f * unit(rng);
+            angle += 0.1f + 1.0f * unit(rng);
+        }
+        return pPath;
+    }
+
+    float getDuration(const ObjectPath::SharedPtr& pPath)
+    {
+        return pPath->getKeyFrame(pPath->getKeyFrameCount() - 1).time - pPath->getKeyFrame(0).time;
+    }
+
+    bool equal(const ObjectPath::Frame& a, const ObjectPath::Frame& b)
+    {
+        return a.position == b.position && a.target == b.target && a.up == b.up;
+    }
+}
+
+void ObjectPathTest::addTests()
+{
+    addTestToList<TestMatchesAnimate>();
+    addTestToList<TestKeyFrameTimes>();
+    addTestToList<TestConstantSpeed>();
+    addTestToList<TestThreadCount>();
+    addTestToList<BenchmarkBatch>();
+}
+
+testing_func(ObjectPathTest, TestMatchesAnimate)
+{
+    // The batch evaluation moves objects to the same frames as animate(), in every mode and outside the path's time range
+    for (uint32_t keyFrameCount : { 1u, 2u, 7u })
+    {
+        ObjectPath::SharedPtr pPath = createPath(keyFrameCount, keyFrameCount);
+        auto pRecorder = std::make_shared<MovableRecorder>();
+        pPath->attachObject(pRecorder);
+
+        std::vector<double> times;
+        for (int i = -10; i < 200; i++) times.push_back(i * 0.07);
+        for (uint32_t mode = 0; mode < 8; mode++)
+        {
+            pPath->setInterpolationMode((mode & 1) ? ObjectPath::Interpolation::Linear : ObjectPath::Interpolation::CubicSpline);
+            pPath->setPlaybackMode((mode & 2) ? ObjectPath::Playback::ConstantSpeed : ObjectPath::Playback::KeyFrameTimes);
+            pPath->setAnimationRepeat((mode & 4) != 0);
+
+            std::vector<ObjectPath::Frame> frames;
+            pPath->evaluate(times, frames);
+            if (frames.size() != times.size()) return test_fail("The batch didn't return a frame per time");
+            for (size_t i = 0; i < times.size(); i++)
+            {
+                pPath->animate(times[i]);
+                ObjectPath::Frame moved;
+                moved.position = pRecorder->mPosition;
+                moved.target = pRecorder->mTarget;
+                moved.up = pRecorder->mUp;
+                if (!equal(frames[i], moved)) return test_fail("The batch doesn't match animate()");
+            }
+        }
+    }
+
+    // A path without key frames doesn't fail
+    std::vector<ObjectPath::Frame> frames;
+    ObjectPath::create()->evaluate({ 0.0, 1.0 }, frames);
+    if (frames.size() != 2) return test_fail("A path without key frames didn't return a frame per time");
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, TestKeyFrameTimes)
+{
+    // Key frames are reached at their times, and the factor between two key frames follows the time
+    ObjectPath::SharedPtr pPath = createPath(12, 1);
+    std::vector<double> times;
+    for (uint32_t i = 0; i + 1 < pPath->getKeyFrameCount(); i++)
+    {
+        const ObjectPath::Frame& key = pPath->getKeyFrame(i);
+        const float nextTime = pPath->getKeyFrame(i + 1).time;
+        times.push_back(key.time);
+        times.push_back(key.time + 0.3 * (nextTime - key.time));
+    }
+
+    std::vector<ObjectPath::Frame> frames;
+    pPath->evaluate(times, frames);
+    for (uint32_t i = 0; i + 1 < pPath->getKeyFrameCount(); i++)
+    {
+        ObjectPath::Frame expected;
+        pPath->getFrameAt(i, 0.0f, expected);
+        if (glm::length(frames[2 * i].position - pPath->getKeyFrame(i).position) > 1e-4f) return test_fail("A key frame isn't reached at its time");
+        pPath->getFrameAt(i, float((times[2 * i + 1] - times[2 * i]) / (pPath->getKeyFrame(i + 1).time - times[2 * i])), expected);
+        if (glm::length(frames[2 * i + 1].position - expected.position) > 1e-4f) return test_fail("The position between key frames doesn't follow the time");
+    }
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, TestConstantSpeed)
+{
+    for (auto mode : { ObjectPath::Interpolation::CubicSpline, ObjectPath::Interpolation::Linear })
+    {
+        const uint32_t keyFrameCount = 20;
+        ObjectPath::SharedPtr pPath = createPath(keyFrameCount, 2);
+        pPath->setInterpolationMode(mode);
+        pPath->setPlaybackMode(ObjectPath::Playback::ConstantSpeed);
+
+        // Steps of equal time cover equal distances. A step across a sharp turn, e.g. a corner of the linear path, cuts the corner and comes up short.
+        const uint32_t stepCount = 1000;
+        const float duration = getDuration(pPath);
+        std::vector<double> times(stepCount + 1);
+        for (uint32_t i = 0; i <= stepCount; i++) times[i] = pPath->getKeyFrame(0).time + duration * i / stepCount;
+        std::vector<ObjectPath::Frame> frames;
+        pPath->evaluate(times, frames);
+
+        const float expectedStep = pPath->getPathLength() / stepCount;
+        float travelled = 0;
+        uint32_t unevenSteps = 0;
+        for (uint32_t i = 0; i < stepCount; i++)
+        {
+            const float step = glm::length(frames[i + 1].position - frames[i].position);
+            if (std::abs(step - expectedStep) > 0.01f * expectedStep) unevenSteps++;
+            travelled += step;
+            if (std::abs(travelled - (i + 1) * expectedStep) > 0.005f * pPath->getPathLength()) return test_fail("The position along the path doesn't follow the time");
+        }
+        if (unevenSteps > keyFrameCount) return test_fail("The speed along the path isn't constant");
+        if (std::abs(travelled - pPath->getPathLength()) > 5e-3f * travelled) return test_fail("The path length doesn't match the distance travelled");
+        if (frames.front().position != pPath->getKeyFrame(0).position || frames.back().position != pPath->getKeyFrame(pPath->getKeyFrameCount() - 1).position)
+        {
+            return test_fail("Constant speed playback doesn't start and end at the first and last key frames");
+        }
+
+        // Moving a key frame updates the table
+        const float length = pPath->getPathLength();
+        pPath->setFramePosition(3, pPath->getKeyFrame(3).position + vec3(0, 50, 0));
+        if (pPath->getPathLength() <= length) return test_fail("The path length wasn't updated when a key frame moved");
+    }
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, TestThreadCount)
+{
+    ObjectPath::SharedPtr pPath = createPath(30, 3);
+    pPath->setPlaybackMode(ObjectPath::Playback::ConstantSpeed);
+    std::vector<double> times(10000);
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> time(-1.0, 1.2 * getDuration(pPath));
+    for (double& t : times) t = time(rng);
+
+    std::vector<ObjectPath::Frame> single, all;
+    pPath->evaluate(times, single, 1);
+    pPath->evaluate(times, all);
+    for (size_t i = 0; i < times.size(); i++)
+    {
+        if (!equal(single[i], all[i])) return test_fail("The frames depend on the thread count");
+    }
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, BenchmarkBatch)
+{
+    // An hour of frames at 60 fps along a long looping flight
+    ObjectPath::SharedPtr pPath = createPath(200, 5);
+    pPath->setAnimationRepeat(true);
+    auto pRecorder = std::make_shared<MovableRecorder>();
+    pPath->attachObject(pRecorder);
+    std::vector<double> times(60 * 60 * 60);
+    for (size_t i = 0; i < times.size(); i++) times[i] = i / 60.0;
+
+    std::stringstream report;
+    report << "Camera path evaluation, " << pPath->getKeyFrameCount() << " key frames, " << times.size() << " frames, ms:\n";
+    for (auto playback : { ObjectPath::Playback::KeyFrameTimes, ObjectPath::Playback::ConstantSpeed })
+    {
+        pPath->setPlaybackMode(playback);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (double t : times) pPath->animate(t);
+        report << "  " << (playback == ObjectPath::Playback::ConstantSpeed ? "constant speed:  " : "key frame times: ");
+        report << "animate() " << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        std::vector<ObjectPath::Frame> frames;
+        for (uint32_t threads : { 1u, 0u })
+        {
+            start = CpuTimer::getCurrentTimePoint();
+            pPath->evaluate(times, frames, threads);
+            report << ", batch on " << (threads ? "1 thread " : "all threads ") << CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+
+        // How much the distance covered per frame varies over the first loop, ignoring the sharpest turns
+        std::vector<float> steps;
+        for (size_t i = 0; i + 1 < times.size() && times[i + 1] < getDuration(pPath); i++)
+        {
+            steps.push_back(glm::length(frames[i + 1].position - frames[i].position));
+        }
+        std::sort(steps.begin(), steps.end());
+        report << ", distance per frame " << steps[steps.size() / 100] << " to " << steps[steps.size() - 1 - steps.size() / 100] << " (1st to 99th percentile)\n";
+    }
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    ObjectPathTest opt;
+    opt.init(true);
+    opt.run();
+    return 0;
+}
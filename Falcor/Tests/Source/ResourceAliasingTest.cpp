@@ -0,0 +1,331 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ResourceAliasingTest.h"
+
+void ResourceAliasingTest::addTests()
+{
+    addTestToList<TestSequentialChain>();
+    addTestToList<TestFullOverlap>();
+    addTestToList<TestBuckets>();
+    addTestToList<TestExclusive>();
+    addTestToList<TestRandomGraphs>();
+    addTestToList<TestGraphInputLifetime>();
+    addTestToList<TestGraphInternalRecompile>();
+}
+
+namespace
+{
+    /** Render pass with fixed-size fields which records the texture bound to each field when it executes
+    */
+    class RecordingPass : public RenderPass
+    {
+    public:
+        using SharedPtr = std::shared_ptr<RecordingPass>;
+
+        static SharedPtr create(const std::vector<std::string>& inputs, const std::vector<std::string>& outputs, const std::vector<std::string>& internals = {})
+        {
+            return SharedPtr(new RecordingPass(inputs, outputs, internals));
+        }
+
+        RenderPassReflection reflect() const override
+        {
+            RenderPassReflection r;
+            for (const auto& name : mInputs) setProperties(r.addInput(name));
+            for (const auto& name : mOutputs) setProperties(r.addOutput(name));
+            for (const auto& name : mInternals) setProperties(r.addInternal(name));
+            return r;
+        }
+
+        void execute(RenderContext* pRenderContext, const RenderData* pData) override
+        {
+            for (const auto& names : { mInputs, mOutputs, mInternals })
+            {
+                for (const auto& name : names) mTextures[name] = pData->getTexture(name);
+            }
+        }
+
+        Texture::SharedPtr getTexture(const std::string& name) const
+        {
+            auto it = mTextures.find(name);
+            return (it == mTextures.end()) ? nullptr : it->second;
+        }
+
+    private:
+        RecordingPass(const std::vector<std::string>& inputs, const std::vector<std::string>& outputs, const std::vector<std::string>& internals) :
+            RenderPass("RecordingPass"), mInputs(inputs), mOutputs(outputs), mInternals(internals) {}
+
+        static void setProperties(RenderPassReflection::Field& field)
+        {
+            field.setDimensions(64, 64, 1).setFormat(ResourceFormat::RGBA8Unorm).setBindFlags(Resource::BindFlags::RenderTarget);
+        }
+
+        std::vector<std::string> mInputs;
+        std::vector<std::string> mOutputs;
+        std::vector<std::string> mInternals;
+        std::unordered_map<std::string, Texture::SharedPtr> mTextures;
+    };
+}
+
+ResourceAliasing::Interval ResourceAliasingTest::makeInterval(uint32_t bucket, uint32_t first, uint32_t last, bool exclusive)
+{
+    ResourceAliasing::Interval i;
+    i.bucket = bucket;
+    i.firstUsed = first;
+    i.lastUsed = last;
+    i.exclusive = exclusive;
+    return i;
+}
+
+testing_func(ResourceAliasingTest, TestSequentialChain)
+{
+    // A linear chain of passes where each output is consumed by the next pass only. Two textures are enough, ping-ponging between them
+    const uint32_t passCount = 16;
+    std::vector<ResourceAliasing::Interval> intervals;
+    for (uint32_t i = 0; i < passCount; i++)
+    {
+        intervals.push_back(makeInterval(0, i, i + 1));
+    }
+
+    auto placement = ResourceAliasing::place(intervals, 1);
+    if (!ResourceAliasing::validate(intervals, placement))
+    {
+        return test_fail("Overlapping intervals share a slot");
+    }
+    if (placement.slotCount[0] != 2)
+    {
+        return test_fail("Expected 2 slots, got " + std::to_string(placement.slotCount[0]));
+    }
+
+    return test_pass();
+}
+
+testing_func(ResourceAliasingTest, TestFullOverlap)
+{
+    // All resources are alive at the same time, nothing can be shared
+    const uint32_t count = 8;
+    std::vector<ResourceAliasing::Interval> intervals;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        intervals.push_back(makeInterval(0, i, count));
+    }
+
+    auto placement = ResourceAliasing::place(intervals, 1);
+    if (!ResourceAliasing::validate(intervals, placement))
+    {
+        return test_fail("Overlapping intervals share a slot");
+    }
+    if (placement.slotCount[0] != count)
+    {
+        return test_fail("Expected " + std::to_string(count) + " slots, got " + std::to_string(placement.slotCount[0]));
+    }
+
+    return test_pass();
+}
+
+testing_func(ResourceAliasingTest, TestBuckets)
+{
+    // Disjoint lifetimes, but different buckets. Each bucket needs its own slot
+    std::vector<ResourceAliasing::Interval> intervals;
+    intervals.push_back(makeInterval(0, 0, 0));
+    intervals.push_back(makeInterval(1, 1, 1));
+    intervals.push_back(makeInterval(0, 2, 2));
+    intervals.push_back(makeInterval(1, 3, 3));
+
+    auto placement = ResourceAliasing::place(intervals, 2);
+    if (!ResourceAliasing::validate(intervals, placement))
+    {
+        return test_fail("Overlapping intervals share a slot");
+    }
+    if (placement.slotCount[0] != 1 || placement.slotCount[1] != 1)
+    {
+        return test_fail("Expected a single slot per bucket");
+    }
+    if (placement.slot[0] != placement.slot[2] || placement.slot[1] != placement.slot[3])
+    {
+        return test_fail("Disjoint intervals in the same bucket were not aliased");
+    }
+
+    return test_pass();
+}
+
+testing_func(ResourceAliasingTest, TestExclusive)
+{
+    std::vector<ResourceAliasing::Interval> intervals;
+    intervals.push_back(makeInterval(0, 0, 0, true));
+    intervals.push_back(makeInterval(0, 1, 1));
+    intervals.push_back(makeInterval(0, 2, 2));
+    intervals.push_back(makeInterval(0, 3, uint32_t(-1)));
+
+    auto placement = ResourceAliasing::place(intervals, 1);
+    if (!ResourceAliasing::validate(intervals, placement))
+    {
+        return test_fail("Exclusive interval shares a slot");
+    }
+    if (placement.slotCount[0] != 2)
+    {
+        return test_fail("Expected 2 slots, got " + std::to_string(placement.slotCount[0]));
+    }
+
+    return test_pass();
+}
+
+testing_func(ResourceAliasingTest, TestRandomGraphs)
+{
+    // Synthetic graphs with random lifetimes. The placement must be valid and optimal, i.e. use exactly as many slots as the maximum overlap
+    const uint32_t graphCount = 200;
+    const uint32_t bucketCount = 4;
+    srand(1234);
+
+    for (uint32_t g = 0; g < graphCount; g++)
+    {
+        uint32_t passCount = 1 + rand() % 64;
+        uint32_t fieldCount = 1 + rand() % 128;
+        std::vector<ResourceAliasing::Interval> intervals;
+        for (uint32_t f = 0; f < fieldCount; f++)
+        {
+            uint32_t first = rand() % passCount;
+            uint32_t last = first + rand() % (passCount - first);
+            // Some fields are graph outputs, alive until the end of execution
+            if (rand() % 16 == 0) last = uint32_t(-1);
+            intervals.push_back(makeInterval(rand() % bucketCount, first, last, rand() % 32 == 0));
+        }
+
+        auto placement = ResourceAliasing::place(intervals, bucketCount);
+        if (!ResourceAliasing::validate(intervals, placement))
+        {
+            return test_fail("Invalid placement for graph " + std::to_string(g));
+        }
+
+        for (uint32_t b = 0; b < bucketCount; b++)
+        {
+            uint32_t expected = ResourceAliasing::getMaxOverlap(intervals, b);
+            if (placement.slotCount[b] != expected)
+            {
+                return test_fail("Non-optimal placement for graph " + std::to_string(g) + ". Expected " + std::to_string(expected) + " slots, got " + std::to_string(placement.slotCount[b]));
+            }
+        }
+    }
+
+    return test_pass();
+}
+
+testing_func(ResourceAliasingTest, TestGraphInputLifetime)
+{
+    // A -> C and B -> C. A's output is produced before B runs, but must stay alive until C reads it
+    {
+        RenderGraph::SharedPtr pGraph = RenderGraph::create();
+        auto pA = RecordingPass::create({}, { "dst" });
+        auto pB = RecordingPass::create({}, { "dst" });
+        auto pC = RecordingPass::create({ "a", "b" }, { "dst" });
+        pGraph->addPass(pA, "A");
+        pGraph->addPass(pB, "B");
+        pGraph->addPass(pC, "C");
+        pGraph->addEdge("A.dst", "C.a");
+        pGraph->addEdge("B.dst", "C.b");
+        pGraph->markOutput("C.dst");
+        pGraph->execute(gpDevice->getRenderContext().get());
+
+        if (!pC->getTexture("a") || !pC->getTexture("b")) return test_fail("The graph didn't execute");
+        if (pC->getTexture("a") != pA->getTexture("dst") || pC->getTexture("b") != pB->getTexture("dst")) return test_fail("An input isn't bound to the output connected to it");
+        if (pC->getTexture("a") == pC->getTexture("b")) return test_fail("Two inputs of the same pass share a texture");
+        if (pC->getTexture("dst") == pC->getTexture("a") || pC->getTexture("dst") == pC->getTexture("b")) return test_fail("An output shares a texture with an input of the same pass");
+    }
+
+    // A chain P0 -> P1 -> P2 -> P3, where P3 also reads P0. P0's output must not be reused by P1 or P2
+    {
+        RenderGraph::SharedPtr pGraph = RenderGraph::create();
+        std::vector<RecordingPass::SharedPtr> passes;
+        passes.push_back(RecordingPass::create({}, { "dst" }));
+        passes.push_back(RecordingPass::create({ "src" }, { "dst" }));
+        passes.push_back(RecordingPass::create({ "src" }, { "dst" }));
+        passes.push_back(RecordingPass::create({ "src", "first" }, { "dst" }));
+        for (size_t i = 0; i < passes.size(); i++) pGraph->addPass(passes[i], "P" + std::to_string(i));
+        for (size_t i = 1; i < passes.size(); i++) pGraph->addEdge("P" + std::to_string(i - 1) + ".dst", "P" + std::to_string(i) + ".src");
+        pGraph->addEdge("P0.dst", "P3.first");
+        pGraph->markOutput("P3.dst");
+        pGraph->execute(gpDevice->getRenderContext().get());
+
+        Texture::SharedPtr pFirst = passes[0]->getTexture("dst");
+        if (!pFirst || passes[3]->getTexture("first") != pFirst) return test_fail("P3 doesn't read P0's output");
+        for (size_t i = 1; i < passes.size(); i++)
+        {
+            if (passes[i]->getTexture("dst") == pFirst) return test_fail("P" + std::to_string(i) + " writes to P0's output before P3 reads it");
+        }
+    }
+
+    // Without the long-lived input, P0's and P2's outputs have disjoint lifetimes and share a texture
+    {
+        RenderGraph::SharedPtr pGraph = RenderGraph::create();
+        std::vector<RecordingPass::SharedPtr> passes;
+        passes.push_back(RecordingPass::create({}, { "dst" }));
+        for (size_t i = 1; i < 4; i++) passes.push_back(RecordingPass::create({ "src" }, { "dst" }));
+        for (size_t i = 0; i < passes.size(); i++) pGraph->addPass(passes[i], "P" + std::to_string(i));
+        for (size_t i = 1; i < passes.size(); i++) pGraph->addEdge("P" + std::to_string(i - 1) + ".dst", "P" + std::to_string(i) + ".src");
+        pGraph->markOutput("P3.dst");
+        pGraph->execute(gpDevice->getRenderContext().get());
+
+        if (!passes[0]->getTexture("dst") || passes[0]->getTexture("dst") != passes[2]->getTexture("dst")) return test_fail("Fields with disjoint lifetimes weren't aliased");
+        if (passes[1]->getTexture("dst") == passes[3]->getTexture("dst")) return test_fail("A graph output shares a texture with another field");
+    }
+
+    return test_pass();
+}
+
+testing_func(ResourceAliasingTest, TestGraphInternalRecompile)
+{
+    // An internal field holds history, so it keeps its texture when the graph is recompiled, even though other fields share its properties
+    RenderGraph::SharedPtr pGraph = RenderGraph::create();
+    auto pHistory = RecordingPass::create({}, { "dst" }, { "history" });
+    pGraph->addPass(pHistory, "History");
+    pGraph->markOutput("History.dst");
+    pGraph->execute(gpDevice->getRenderContext().get());
+
+    Texture::SharedPtr pTexture = pHistory->getTexture("history");
+    if (!pTexture) return test_fail("The internal field wasn't allocated");
+    if (pTexture == pHistory->getTexture("dst")) return test_fail("The internal field shares a texture with an output");
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        // Adding a pass and an output forces a recompile, which reuses the pooled textures
+        std::string name = "Extra" + std::to_string(i);
+        pGraph->addPass(RecordingPass::create({}, { "dst" }, { "history" }), name);
+        pGraph->markOutput(name + ".dst");
+        pGraph->execute(gpDevice->getRenderContext().get());
+        if (pHistory->getTexture("history") != pTexture) return test_fail("The internal field moved to another texture on recompile");
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    ResourceAliasingTest rat;
+    rat.init(true);
+    rat.run();
+    return 0;
+}
@@ -0,0 +1,439 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneSnapshotTest.h"
+#include "Graphics/Scene/SceneExporter.h"
+#include "Graphics/Scene/SceneSnapshot.h"
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    // Offsets of the fields of the file header, see Header in SceneSnapshot.cpp
+    const size_t kMagicOffset = 0;
+    const size_t kVersionOffset = 4;
+    const size_t kMetadataSizeOffset = 24;
+    const size_t kHeaderSize = 48;
+
+    // Rotations are recomputed from the instances' orientation, so transforms are compared with a tolerance
+    const float kEpsilon = 1e-5f;
+
+    bool isClose(const vec3& a, const vec3& b) { return glm::length(a - b) <= kEpsilon; }
+
+    bool isClose(const glm::mat4& a, const glm::mat4& b)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (glm::length(a[i] - b[i]) > kEpsilon) return false;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> readBuffer(const Buffer::SharedPtr& pBuffer)
+    {
+        std::vector<uint8_t> data;
+        if (pBuffer)
+        {
+            data.resize(pBuffer->getSize());
+            std::memcpy(data.data(), pBuffer->map(Buffer::MapType::Read), data.size());
+            pBuffer->unmap();
+        }
+        return data;
+    }
+
+    std::string compareTextures(const Texture::SharedPtr& pA, const Texture::SharedPtr& pB)
+    {
+        if (!pA || !pB) return (pA == pB) ? "" : "texture is missing";
+        if (pA->getFormat() != pB->getFormat()) return "texture format differs";
+        if (pA->getWidth() != pB->getWidth() || pA->getHeight() != pB->getHeight() || pA->getMipCount() != pB->getMipCount()) return "texture size differs";
+
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+        for (uint32_t mip = 0; mip < pA->getMipCount(); mip++)
+        {
+            if (pContext->readTextureSubresource(pA.get(), pA->getSubresourceIndex(0, mip)) != pContext->readTextureSubresource(pB.get(), pB->getSubresourceIndex(0, mip)))
+            {
+                return "texture mip " + std::to_string(mip) + " differs";
+            }
+        }
+        return "";
+    }
+
+    std::string compareMaterials(const Material* pA, const Material* pB)
+    {
+        if (pA->getName() != pB->getName()) return "material name differs";
+        if (pA->getShadingModel() != pB->getShadingModel() || pA->getAlphaMode() != pB->getAlphaMode() || pA->getDoubleSided() != pB->getDoubleSided()) return "material flags differ";
+        if (pA->getBaseColor() != pB->getBaseColor() || pA->getSpecularParams() != pB->getSpecularParams() || pA->getAlphaThreshold() != pB->getAlphaThreshold()) return "material parameters differ";
+        std::string error = compareTextures(pA->getBaseColorTexture(), pB->getBaseColorTexture());
+        return error.empty() ? "" : "base color " + error;
+    }
+
+    std::vector<uint8_t> readFileData(const std::string& filename)
+    {
+        std::ifstream in(filename, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFileData(const std::string& filename, const std::vector<uint8_t>& data, size_t size)
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write((const char*)data.data(), size);
+    }
+
+    std::string getTestFilename(const std::string& name)
+    {
+        return getExecutableDirectory() + "/SceneSnapshotTest_" + name + SceneSnapshot::kFileExtension;
+    }
+}
+
+void SceneSnapshotTest::addTests()
+{
+    addTestToList<TestRoundTrip>();
+    addTestToList<TestCompressedRoundTrip>();
+    addTestToList<TestMipChainSize>();
+    addTestToList<TestMetadataReader>();
+    addTestToList<TestCorruptFile>();
+}
+
+Scene::SharedPtr SceneSnapshotTest::createScene()
+{
+    // A quad with positions and texture coordinates, drawn with two materials
+    const float vertices[] =
+    {
+        0, 0, 0,    0, 0,
+        1, 0, 0,    1, 0,
+        1, 1, 0,    1, 1,
+        0, 1, 0,    0, 1,
+    };
+    const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    Buffer::SharedPtr pVB = Buffer::create(sizeof(vertices), Resource::BindFlags::Vertex, Buffer::CpuAccess::None, vertices);
+    Buffer::SharedPtr pIB = Buffer::create(sizeof(indices), Resource::BindFlags::Index, Buffer::CpuAccess::None, indices);
+
+    VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+    pBufferLayout->addElement(VERTEX_POSITION_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
+    pBufferLayout->addElement(VERTEX_TEXCOORD_NAME, 12, ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+    VertexLayout::SharedPtr pLayout = VertexLayout::create();
+    pLayout->addBufferLayout(0, pBufferLayout);
+
+    // An opaque 8x8 texture with a full mip chain, so that it can be block-compressed
+    std::vector<uint8_t> texels(8 * 8 * 4);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = (i % 4 == 3) ? 255 : uint8_t(i * 37);
+    Texture::SharedPtr pBaseColor = Texture::create2D(8, 8, ResourceFormat::RGBA8Unorm, 1, Texture::kMaxPossible, texels.data());
+
+    Material::SharedPtr pTextured = Material::create("Textured");
+    pTextured->setShadingModel(ShadingModelMetalRough);
+    pTextured->setBaseColorTexture(pBaseColor);
+    pTextured->setSpecularParams(vec4(0, 0.5f, 0.25f, 0));
+    pTextured->setAlphaMode(AlphaModeMask);
+    pTextured->setAlphaThreshold(0.3f);
+
+    Material::SharedPtr pPlain = Material::create("Plain");
+    pPlain->setBaseColor(vec4(1, 0.25f, 0.5f, 1));
+    pPlain->setDoubleSided(true);
+
+    const BoundingBox boundingBox = BoundingBox::fromMinMax(vec3(0, 0, 0), vec3(1, 1, 0));
+    Mesh::SharedPtr pMeshA = Mesh::create({ pVB }, 4, pIB, 6, pLayout, Vao::Topology::TriangleList, pTextured, boundingBox, false);
+    Mesh::SharedPtr pMeshB = Mesh::create({ pVB }, 4, pIB, 6, pLayout, Vao::Topology::TriangleList, pPlain, boundingBox, false);
+
+    Model::SharedPtr pModel = Model::create();
+    pModel->setName("Quads");
+    pModel->addMeshInstance(pMeshA, glm::mat4());
+    pModel->addMeshInstance(pMeshA, glm::translate(glm::mat4(), vec3(0, 0, 2)));
+    pModel->addMeshInstance(pMeshB, glm::translate(glm::mat4(), vec3(2, 0, 0)));
+
+    Scene::SharedPtr pScene = Scene::create();
+    pScene->addModelInstance(pModel, "First", vec3(1, 2, 3), vec3(0.1f, 0.2f, 0.3f), vec3(2));
+    pScene->addModelInstance(pModel, "Second", vec3(-4, 0, 0));
+
+    // Cameras are stored in the embedded scene description
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setName("Camera");
+    pScene->addCamera(pCamera);
+
+    // Floating-point environment maps are never compressed
+    std::vector<vec4> envTexels(16 * 8);
+    for (size_t i = 0; i < envTexels.size(); i++) envTexels[i] = vec4(float(i), 0.5f, 1e4f, 1);
+    pScene->setEnvironmentMap(Texture::create2D(16, 8, ResourceFormat::RGBA32Float, 1, 1, envTexels.data()));
+    return pScene;
+}
+
+std::string SceneSnapshotTest::compareScenes(const Scene* pSaved, const Scene* pLoaded)
+{
+    if (pSaved->getModelCount() != pLoaded->getModelCount()) return "Model count differs";
+    for (uint32_t modelId = 0; modelId < pSaved->getModelCount(); modelId++)
+    {
+        const Model* pA = pSaved->getModel(modelId).get();
+        const Model* pB = pLoaded->getModel(modelId).get();
+        std::string modelStr = "Model " + std::to_string(modelId) + ": ";
+        if (pA->getName() != pB->getName()) return modelStr + "name differs";
+        if (pA->getMeshCount() != pB->getMeshCount()) return modelStr + "mesh count differs";
+
+        for (uint32_t meshId = 0; meshId < pA->getMeshCount(); meshId++)
+        {
+            const Mesh* pMeshA = pA->getMesh(meshId).get();
+            const Mesh* pMeshB = pB->getMesh(meshId).get();
+            std::string meshStr = modelStr + "mesh " + std::to_string(meshId) + ": ";
+            if (pMeshA->getVertexCount() != pMeshB->getVertexCount() || pMeshA->getIndexCount() != pMeshB->getIndexCount()) return meshStr + "vertex or index count differs";
+            if (pMeshA->getBoundingBox().center != pMeshB->getBoundingBox().center || pMeshA->getBoundingBox().extent != pMeshB->getBoundingBox().extent) return meshStr + "bounding box differs";
+
+            const Vao* pVaoA = pMeshA->getVao().get();
+            const Vao* pVaoB = pMeshB->getVao().get();
+            if (pVaoA->getPrimitiveTopology() != pVaoB->getPrimitiveTopology()) return meshStr + "topology differs";
+            if (pVaoA->getVertexBuffersCount() != pVaoB->getVertexBuffersCount()) return meshStr + "vertex buffer count differs";
+            for (uint32_t vb = 0; vb < pVaoA->getVertexBuffersCount(); vb++)
+            {
+                if (readBuffer(pVaoA->getVertexBuffer(vb)) != readBuffer(pVaoB->getVertexBuffer(vb))) return meshStr + "vertex buffer " + std::to_string(vb) + " differs";
+                const VertexBufferLayout* pLayoutA = pVaoA->getVertexLayout()->getBufferLayout(vb).get();
+                const VertexBufferLayout* pLayoutB = pVaoB->getVertexLayout()->getBufferLayout(vb).get();
+                if (pLayoutA->getElementCount() != pLayoutB->getElementCount() || pLayoutA->getStride() != pLayoutB->getStride()) return meshStr + "vertex layout differs";
+                for (uint32_t e = 0; e < pLayoutA->getElementCount(); e++)
+                {
+                    if (pLayoutA->getElementFormat(e) != pLayoutB->getElementFormat(e) || pLayoutA->getElementOffset(e) != pLayoutB->getElementOffset(e) ||
+                        pLayoutA->getElementShaderLocation(e) != pLayoutB->getElementShaderLocation(e))
+                    {
+                        return meshStr + "vertex element " + std::to_string(e) + " differs";
+                    }
+                }
+            }
+            if (readBuffer(pVaoA->getIndexBuffer()) != readBuffer(pVaoB->getIndexBuffer())) return meshStr + "index buffer differs";
+
+            std::string error = compareMaterials(pMeshA->getMaterial().get(), pMeshB->getMaterial().get());
+            if (error.size()) return meshStr + error;
+
+            if (pA->getMeshInstanceCount(meshId) != pB->getMeshInstanceCount(meshId)) return meshStr + "instance count differs";
+            for (uint32_t i = 0; i < pA->getMeshInstanceCount(meshId); i++)
+            {
+                if (!isClose(pA->getMeshInstance(meshId, i)->getTransformMatrix(), pB->getMeshInstance(meshId, i)->getTransformMatrix())) return meshStr + "instance transform differs";
+            }
+        }
+
+        if (pSaved->getModelInstanceCount(modelId) != pLoaded->getModelInstanceCount(modelId)) return modelStr + "instance count differs";
+        for (uint32_t i = 0; i < pSaved->getModelInstanceCount(modelId); i++)
+        {
+            const auto& pInstanceA = pSaved->getModelInstance(modelId, i);
+            const auto& pInstanceB = pLoaded->getModelInstance(modelId, i);
+            if (pInstanceA->getName() != pInstanceB->getName()) return modelStr + "instance name differs";
+            if (!isClose(pInstanceA->getTranslation(), pInstanceB->getTranslation()) || !isClose(pInstanceA->getRotation(), pInstanceB->getRotation()) || !isClose(pInstanceA->getScaling(), pInstanceB->getScaling()))
+            {
+                return modelStr + "instance " + pInstanceA->getName() + " transform differs";
+            }
+        }
+    }
+
+    if (pLoaded->getCameraCount() != pSaved->getCameraCount() || pLoaded->getActiveCamera()->getName() != pSaved->getActiveCamera()->getName()) return "Camera differs";
+
+    std::string error = compareTextures(pSaved->getEnvironmentMap(), pLoaded->getEnvironmentMap());
+    return error.empty() ? "" : "Environment map: " + error;
+}
+
+testing_func(SceneSnapshotTest, TestRoundTrip)
+{
+    Scene::SharedPtr pScene = createScene();
+    std::string filename = getTestFilename("RoundTrip");
+    if (!SceneExporter::saveSnapshot(filename, pScene, false)) return test_fail("Can't write " + filename);
+
+    Scene::SharedPtr pLoaded = Scene::loadFromFile(filename);
+    std::remove(filename.c_str());
+    if (!pLoaded) return test_fail("Can't load the snapshot");
+    std::string error = compareScenes(pScene.get(), pLoaded.get());
+    if (error.size()) return test_fail(error);
+    return test_pass();
+}
+
+testing_func(SceneSnapshotTest, TestCompressedRoundTrip)
+{
+    // The opaque color texture becomes BC1 with the same mip chain. Everything else is stored as is.
+    Scene::SharedPtr pScene = createScene();
+    std::string filename = getTestFilename("Compressed");
+    if (!SceneExporter::saveSnapshot(filename, pScene, true)) return test_fail("Can't write " + filename);
+
+    Scene::SharedPtr pLoaded = Scene::loadFromFile(filename);
+    std::remove(filename.c_str());
+    if (!pLoaded || pLoaded->getModelCount() != 1) return test_fail("Can't load the snapshot");
+
+    const Texture::SharedPtr& pSource = pScene->getModel(0)->getMesh(0)->getMaterial()->getBaseColorTexture();
+    const Texture::SharedPtr& pCompressed = pLoaded->getModel(0)->getMesh(0)->getMaterial()->getBaseColorTexture();
+    if (!pCompressed || pCompressed->getFormat() != ResourceFormat::BC1Unorm) return test_fail("The color texture wasn't compressed to BC1");
+    if (pCompressed->getWidth() != pSource->getWidth() || pCompressed->getHeight() != pSource->getHeight() || pCompressed->getMipCount() != pSource->getMipCount())
+    {
+        return test_fail("The compressed texture's size or mip count differs");
+    }
+
+    std::string error = compareTextures(pScene->getEnvironmentMap(), pLoaded->getEnvironmentMap());
+    if (error.size()) return test_fail("Environment map: " + error);
+    return test_pass();
+}
+
+testing_func(SceneSnapshotTest, TestMipChainSize)
+{
+    struct Case
+    {
+        ResourceFormat format;
+        uint32_t width, height, mipLevels;
+        uint64_t expected;
+    };
+    const Case cases[] =
+    {
+        { ResourceFormat::RGBA8Unorm, 8, 8, 4, 256 + 64 + 16 + 4 },
+        { ResourceFormat::RGBA8Unorm, 5, 3, 3, 60 + 8 + 4 },            // Odd sizes round down
+        { ResourceFormat::RGBA32Float, 16, 8, 1, 16 * 8 * 16 },
+        { ResourceFormat::BC1Unorm, 8, 8, 4, 32 + 8 + 8 + 8 },          // Mips smaller than a block still take a whole block
+        { ResourceFormat::BC3Unorm, 10, 6, 4, 96 + 32 + 16 + 16 },      // 3x2, 2x1, 1x1 and 1x1 blocks
+        { ResourceFormat::BC1UnormSrgb, 1, 1, 1, 8 },
+    };
+    for (const Case& c : cases)
+    {
+        uint64_t size = SceneSnapshot::getMipChainSize(c.format, c.width, c.height, c.mipLevels);
+        if (size != c.expected)
+        {
+            return test_fail(to_string(c.format) + " " + std::to_string(c.width) + "x" + std::to_string(c.height) + ": expected " + std::to_string(c.expected) + " bytes, got " + std::to_string(size));
+        }
+    }
+    return test_pass();
+}
+
+testing_func(SceneSnapshotTest, TestMetadataReader)
+{
+    SceneSnapshot::MetadataWriter section;
+    section.write(1.5f);
+    section.writeVector(std::vector<uint64_t>{ 1, 2, 3 });
+
+    SceneSnapshot::MetadataWriter writer;
+    writer.write(7u);
+    writer.writeString("snapshot");
+    writer.writeVector(std::vector<uint16_t>{ 4, 5, 6 });
+    writer.writeSection(2, section);
+    writer.write(int32_t(-1));
+    const std::vector<uint8_t>& data = writer.getData();
+
+    // Read everything back from the first size bytes. The reader must stay in bounds and flag every read past the end.
+    auto readAll = [&](size_t size, bool& matches)
+    {
+        SceneSnapshot::MetadataReader reader(data.data(), size);
+        std::vector<uint16_t> shorts;
+        std::vector<uint64_t> longs;
+        uint32_t value = reader.read<uint32_t>();
+        std::string str = reader.readString();
+        reader.readVector(shorts);
+        uint32_t sectionCount = reader.readSectionCount();
+        float f = reader.read<float>();
+        reader.readVector(longs);
+        int32_t last = reader.read<int32_t>();
+        matches = (value == 7 && str == "snapshot" && shorts == std::vector<uint16_t>{ 4, 5, 6 } && sectionCount == 2 && f == 1.5f && longs == std::vector<uint64_t>{ 1, 2, 3 } && last == -1);
+        return reader.isValid();
+    };
+
+    bool matches;
+    if (!readAll(data.size(), matches) || !matches) return test_fail("The metadata doesn't read back");
+    for (size_t size = 0; size < data.size(); size++)
+    {
+        if (readAll(size, matches)) return test_fail("Metadata truncated to " + std::to_string(size) + " bytes was accepted");
+    }
+
+    // Counts larger than what's left of the metadata
+    SceneSnapshot::MetadataWriter corrupt;
+    corrupt.write(1000u);
+    corrupt.write(0u);
+    {
+        SceneSnapshot::MetadataReader reader(corrupt.getData().data(), corrupt.getData().size());
+        std::vector<uint32_t> values;
+        reader.readVector(values);
+        if (reader.isValid() || values.size()) return test_fail("An array larger than the metadata was accepted");
+    }
+    {
+        SceneSnapshot::MetadataReader reader(corrupt.getData().data(), corrupt.getData().size());
+        if (reader.readCount() != 0 || reader.isValid()) return test_fail("A count larger than the metadata was accepted");
+    }
+    {
+        SceneSnapshot::MetadataReader reader(corrupt.getData().data(), corrupt.getData().size());
+        if (reader.readString().size() || reader.isValid()) return test_fail("A string longer than the metadata was accepted");
+    }
+    return test_pass();
+}
+
+testing_func(SceneSnapshotTest, TestCorruptFile)
+{
+    std::string filename = getTestFilename("Corrupt");
+    if (!SceneExporter::saveSnapshot(filename, createScene(), false)) return test_fail("Can't write " + filename);
+    const std::vector<uint8_t> source = readFileData(filename);
+    uint64_t metadataSize;
+    std::memcpy(&metadataSize, source.data() + kMetadataSizeOffset, sizeof(uint64_t));
+
+    struct Case
+    {
+        std::string name;
+        size_t offset;      ///< Offset of the bytes to overwrite
+        std::vector<uint8_t> bytes;
+        size_t size;        ///< Size of the file
+    };
+    auto asBytes = [](uint64_t val) { std::vector<uint8_t> bytes(sizeof(uint64_t)); std::memcpy(bytes.data(), &val, sizeof(uint64_t)); return bytes; };
+    const Case cases[] =
+    {
+        { "truncated header", 0, {}, kHeaderSize / 2 },
+        { "truncated metadata", 0, {}, kHeaderSize + (size_t)metadataSize / 2 },
+        { "truncated data", 0, {}, source.size() - SceneSnapshot::kPageSize },
+        { "wrong magic", kMagicOffset, { 'X' }, source.size() },
+        { "wrong version", kVersionOffset, { 0xff }, source.size() },
+        { "metadata past the end", kMetadataSizeOffset, asBytes(source.size()), source.size() },
+        { "short metadata", kMetadataSizeOffset, asBytes(metadataSize / 2), source.size() },
+    };
+
+    // The loader logs an error for each case
+    const bool showBox = Logger::isBoxShownOnError();
+    Logger::showBoxOnError(false);
+    std::string error;
+    for (const Case& c : cases)
+    {
+        std::vector<uint8_t> data = source;
+        std::copy(c.bytes.begin(), c.bytes.end(), data.begin() + c.offset);
+        writeFileData(filename, data, c.size);
+        if (Scene::loadFromFile(filename))
+        {
+            error = "A snapshot with a " + c.name + " was loaded";
+            break;
+        }
+    }
+    Logger::showBoxOnError(showBox);
+    std::remove(filename.c_str());
+
+    // The unmodified file still loads
+    if (error.empty())
+    {
+        writeFileData(filename, source, source.size());
+        if (!Scene::loadFromFile(filename)) error = "The unmodified snapshot doesn't load";
+        std::remove(filename.c_str());
+    }
+    if (error.size()) return test_fail(error);
+    return test_pass();
+}
+
+int main()
+{
+    SceneSnapshotTest sst;
+    sst.init(true);
+    sst.run();
+    return 0;
+}
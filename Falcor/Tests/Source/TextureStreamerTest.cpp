@@ -0,0 +1,170 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureStreamerTest.h"
+#include "Graphics/TextureStreamer.h"
+
+namespace
+{
+    using Policy = TextureStreamer::Policy;
+    const uint64_t kMB = 1024 * 1024;
+
+    uint64_t getTotalBytes(const std::vector<Policy::Candidate>& candidates)
+    {
+        uint64_t bytes = 0;
+        for (const auto& c : candidates) bytes += c.bytes;
+        return bytes;
+    }
+}
+
+void TextureStreamerTest::addTests()
+{
+    addTestToList<TestEvictionOrder>();
+    addTestToList<TestRecentlyUsedKept>();
+    addTestToList<TestNoRoom>();
+    addTestToList<TestUploadBudget>();
+}
+
+testing_func(TextureStreamerTest, TestEvictionOrder)
+{
+    const std::vector<Policy::Candidate> candidates = { { 4 * kMB, 7 }, { 16 * kMB, 2 }, { 8 * kMB, 5 }, { 4 * kMB, 1 }, { 8 * kMB, 5 } };
+    const uint64_t resident = getTotalBytes(candidates);
+    std::vector<uint32_t> victims;
+
+    if (Policy::selectEvictions(candidates, resident, resident, 10, victims) == false || victims.size()) return test_fail("Textures were evicted while under the limit");
+
+    // Evicting the oldest texture is enough
+    if (Policy::selectEvictions(candidates, resident, resident - 4 * kMB, 10, victims) == false) return test_fail("The memory doesn't fit");
+    if (victims != std::vector<uint32_t>{ 3 }) return test_fail("The least recently used texture wasn't evicted first");
+
+    // Textures are evicted in LRU order until the memory fits, ties in candidate order
+    if (Policy::selectEvictions(candidates, resident, resident - 21 * kMB, 10, victims) == false) return test_fail("The memory doesn't fit");
+    if (victims != std::vector<uint32_t>({ 3, 1, 2 })) return test_fail("The victims aren't in LRU order");
+    if (Policy::selectEvictions(candidates, resident, resident - 29 * kMB, 10, victims) == false) return test_fail("The memory doesn't fit");
+    if (victims != std::vector<uint32_t>({ 3, 1, 2, 4 })) return test_fail("Textures used in the same frame aren't evicted in order");
+
+    // Memory which isn't one of the candidates, e.g. textures being uploaded, can't be evicted
+    if (Policy::selectEvictions(candidates, resident + 64 * kMB, 64 * kMB, 10, victims) == false) return test_fail("Evicting all candidates doesn't fit the limit");
+    if (victims.size() != candidates.size()) return test_fail("Not all candidates were evicted");
+    return test_pass();
+}
+
+testing_func(TextureStreamerTest, TestRecentlyUsedKept)
+{
+    // Textures used in the current or previous frame are never evicted
+    const std::vector<Policy::Candidate> candidates = { { 8 * kMB, 10 }, { 8 * kMB, 9 }, { 8 * kMB, 8 }, { 8 * kMB, 0 } };
+    const uint64_t resident = getTotalBytes(candidates);
+    std::vector<uint32_t> victims;
+
+    if (Policy::selectEvictions(candidates, resident, 16 * kMB, 10, victims) == false) return test_fail("The memory doesn't fit");
+    if (victims != std::vector<uint32_t>({ 3, 2 })) return test_fail("The wrong textures were evicted");
+
+    if (Policy::selectEvictions(candidates, resident, 8 * kMB, 10, victims)) return test_fail("A texture used in the previous frame was evicted");
+    if (victims != std::vector<uint32_t>({ 3, 2 })) return test_fail("Not all textures which can be evicted are reported");
+
+    // On the next frame, the texture used in frame 9 can go
+    if (Policy::selectEvictions(candidates, resident, 8 * kMB, 11, victims) == false) return test_fail("The memory doesn't fit on the next frame");
+    if (victims != std::vector<uint32_t>({ 3, 2, 1 })) return test_fail("The wrong textures were evicted on the next frame");
+    return test_pass();
+}
+
+testing_func(TextureStreamerTest, TestNoRoom)
+{
+    std::vector<uint32_t> victims;
+
+    // Nothing to evict
+    if (Policy::selectEvictions({}, 32 * kMB, 16 * kMB, 10, victims)) return test_fail("Memory over the limit fits without evictions");
+    if (victims.size()) return test_fail("Victims were reported without candidates");
+
+    // A new texture which needs more room than all unused textures have
+    const std::vector<Policy::Candidate> candidates = { { 8 * kMB, 3 }, { 8 * kMB, 10 } };
+    const uint64_t limit = 32 * kMB;
+    const uint64_t newTexture = 28 * kMB;
+    if (Policy::selectEvictions(candidates, getTotalBytes(candidates), limit - newTexture, 10, victims)) return test_fail("The new texture fits");
+    if (victims != std::vector<uint32_t>{ 0 }) return test_fail("The unused texture isn't reported");
+
+    // Once the other texture isn't used anymore, it fits
+    if (Policy::selectEvictions(candidates, getTotalBytes(candidates), limit - newTexture, 12, victims) == false) return test_fail("The new texture doesn't fit when the others are unused");
+    if (victims != std::vector<uint32_t>({ 0, 1 })) return test_fail("The wrong textures were evicted for the new texture");
+    return test_pass();
+}
+
+testing_func(TextureStreamerTest, TestUploadBudget)
+{
+    const uint64_t budget = 16 * kMB;
+    const uint64_t rowBytes = 4096 * 4;
+
+    if (Policy::getUploadRowCount(budget, 0, rowBytes, 4096) != 1024) return test_fail("The rows don't fill the budget");
+    if (Policy::getUploadRowCount(budget, 0, rowBytes, 100) != 100) return test_fail("More rows than the mip has were uploaded");
+    if (Policy::getUploadRowCount(budget, budget - rowBytes * 10 - 1, rowBytes, 4096) != 10) return test_fail("The rows exceed the rest of the budget");
+
+    // Rows which don't fit in the rest of the budget wait for the next frame
+    if (Policy::getUploadRowCount(budget, budget - 1, rowBytes, 4096) != 0) return test_fail("A row was uploaded over the budget");
+
+    // A row is uploaded even if it's larger than the budget, so that uploads make progress
+    if (Policy::getUploadRowCount(1024, 0, rowBytes, 4096) != 1) return test_fail("No row was uploaded with a budget smaller than a row");
+
+    // Stream a 4096x4096 RGBA8 mip chain frame by frame, smallest mips first like uploadMips()
+    const uint32_t kMipCount = 13;
+    uint64_t totalBytes = 0;
+    for (uint32_t mip = 0; mip < kMipCount; mip++) totalBytes += uint64_t(4096 >> mip) * (4096 >> mip) * 4;
+
+    uint32_t mip = kMipCount - 1;
+    uint32_t row = 0;
+    uint64_t uploadedTotal = 0;
+    uint32_t frameCount = 0;
+    while (uploadedTotal < totalBytes)
+    {
+        frameCount++;
+        uint64_t uploaded = 0;
+        while (uploadedTotal < totalBytes && (uploaded < budget || uploaded == 0))
+        {
+            const uint32_t mipSize = 4096 >> mip;
+            const uint32_t rows = Policy::getUploadRowCount(budget, uploaded, mipSize * 4, mipSize - row);
+            if (rows == 0) break;
+            uploaded += uint64_t(rows) * mipSize * 4;
+            row += rows;
+            if (row == mipSize && mip > 0)
+            {
+                mip--;
+                row = 0;
+            }
+        }
+        if (uploaded > budget) return test_fail("A frame uploaded more than the budget");
+        uploadedTotal += uploaded;
+    }
+    if (frameCount != (totalBytes + budget - 1) / budget) return test_fail("The upload took more frames than the budget allows");
+    return test_pass();
+}
+
+int main()
+{
+    TextureStreamerTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
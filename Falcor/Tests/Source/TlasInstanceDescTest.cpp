@@ -0,0 +1,242 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TlasInstanceDescTest.h"
+#include "Raytracing/RtInstanceDescCache.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    const uint32_t kMeshTransformCount = 4;
+
+    /** A set of model instances, each with kMeshTransformCount mesh instances, like RtScene feeds to the cache
+    */
+    struct TestScene
+    {
+        std::vector<glm::mat4> modelTransforms;
+        std::vector<glm::mat4> meshTransforms;
+    };
+
+    glm::mat4 randomTransform(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        glm::vec3 position = glm::vec3(unit(rng), unit(rng), unit(rng)) * 1000.f;
+        glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.01f));
+        return glm::translate(glm::mat4(), position) * glm::rotate(glm::mat4(), unit(rng) * 6.28f, axis) * glm::scale(glm::mat4(), glm::vec3(0.5f + unit(rng)));
+    }
+
+    TestScene createScene(uint32_t modelInstanceCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        TestScene scene;
+        for (uint32_t i = 0; i < modelInstanceCount; i++) scene.modelTransforms.push_back(randomTransform(rng));
+        for (uint32_t i = 0; i < kMeshTransformCount; i++) scene.meshTransforms.push_back(randomTransform(rng));
+        return scene;
+    }
+
+    D3D12_RAYTRACING_INSTANCE_DESC createDesc(uint32_t index)
+    {
+        D3D12_RAYTRACING_INSTANCE_DESC desc = {};
+        desc.InstanceID = index;
+        desc.InstanceMask = 0xff;
+        desc.AccelerationStructure = 0x10000 + (index % kMeshTransformCount) * 0x100;
+        return desc;
+    }
+
+    /** Fill the cache the way RtScene does. The last mesh instance has no mesh transform, like skinned meshes.
+    */
+    void fillCache(const TestScene& scene, RtInstanceDescCache& cache)
+    {
+        cache.clear();
+        const uint32_t meshBase = cache.getTransformCount();
+        for (const glm::mat4& transform : scene.meshTransforms) cache.addTransform(transform);
+        for (const glm::mat4& transform : scene.modelTransforms)
+        {
+            const uint32_t modelTransform = cache.addTransform(transform);
+            for (uint32_t mesh = 0; mesh < kMeshTransformCount; mesh++)
+            {
+                const uint32_t meshTransform = (mesh + 1 < kMeshTransformCount) ? meshBase + mesh : RtInstanceDescCache::kNoTransform;
+                cache.addInstance(createDesc(cache.getInstanceCount()), modelTransform, meshTransform);
+            }
+        }
+    }
+
+    /** What RtScene did before the cache, rebuilding every desc
+    */
+    void createReference(const TestScene& scene, std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& descs)
+    {
+        descs.clear();
+        for (const glm::mat4& modelTransform : scene.modelTransforms)
+        {
+            for (uint32_t mesh = 0; mesh < kMeshTransformCount; mesh++)
+            {
+                D3D12_RAYTRACING_INSTANCE_DESC desc = createDesc((uint32_t)descs.size());
+                glm::mat4 transform = modelTransform;
+                if (mesh + 1 < kMeshTransformCount)
+                {
+                    transform = transform * scene.meshTransforms[mesh];
+                }
+                transform = transpose(transform);
+                memcpy(desc.Transform, &transform, sizeof(desc.Transform));
+                descs.push_back(desc);
+            }
+        }
+    }
+
+    bool equal(const std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& a, const std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& b)
+    {
+        return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+    }
+}
+
+void TlasInstanceDescTest::addTests()
+{
+    addTestToList<TestIncrementalUpdate>();
+    addTestToList<BenchmarkIncrementalUpdate>();
+}
+
+testing_func(TlasInstanceDescTest, TestIncrementalUpdate)
+{
+    // Enough instances for several jobs, and a count which isn't a multiple of the bitset's words
+    TestScene scene = createScene(5001, 1);
+    RtInstanceDescCache cache, serialCache;
+    fillCache(scene, cache);
+    fillCache(scene, serialCache);
+
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> reference;
+    createReference(scene, reference);
+    if (cache.update() != reference.size()) return test_fail("The first update() didn't write every desc");
+    if (equal(cache.getDescs(), reference) == false) return test_fail("The descs differ from a full rebuild");
+    if (cache.update() != 0) return test_fail("update() rewrote descs without changes");
+    serialCache.update(1);
+
+    std::mt19937 rng(2);
+    const uint32_t changeCounts[] = { 1, 50, 700, 5001 };
+    for (uint32_t changeCount : changeCounts)
+    {
+        // The same model instance can be picked twice
+        std::vector<bool> changed(scene.modelTransforms.size(), false);
+        for (uint32_t i = 0; i < changeCount; i++)
+        {
+            uint32_t instance = rng() % (uint32_t)scene.modelTransforms.size();
+            scene.modelTransforms[instance] = randomTransform(rng);
+            cache.setTransform(kMeshTransformCount + instance, scene.modelTransforms[instance]);
+            serialCache.setTransform(kMeshTransformCount + instance, scene.modelTransforms[instance]);
+            changed[instance] = true;
+        }
+
+        uint32_t expected = (uint32_t)std::count(changed.begin(), changed.end(), true) * kMeshTransformCount;
+        if (cache.update() != expected) return test_fail("update() rewrote " + std::to_string(changeCount) + " changes wrong");
+        if (serialCache.update(1) != expected) return test_fail("update() on the calling thread rewrote the wrong descs");
+        createReference(scene, reference);
+        if (equal(cache.getDescs(), reference) == false) return test_fail("The descs differ from a full rebuild after " + std::to_string(changeCount) + " changes");
+        if (equal(serialCache.getDescs(), reference) == false) return test_fail("The descs differ from a full rebuild on the calling thread");
+    }
+
+    // A mesh transform is shared by every model instance
+    scene.meshTransforms[1] = randomTransform(rng);
+    cache.setTransform(1, scene.meshTransforms[1]);
+    if (cache.update() != scene.modelTransforms.size()) return test_fail("A mesh transform change didn't rewrite all of its instances");
+    createReference(scene, reference);
+    if (equal(cache.getDescs(), reference) == false) return test_fail("The descs differ from a full rebuild after a mesh transform change");
+
+    // Fields other than the transform are left alone
+    cache.getDesc(7).AccelerationStructure = 0x1234;
+    cache.setTransform(kMeshTransformCount + 1, scene.modelTransforms[1]);
+    cache.update();
+    if (cache.getDescs()[7].AccelerationStructure != 0x1234) return test_fail("update() overwrote a desc's BLAS address");
+    return test_pass();
+}
+
+testing_func(TlasInstanceDescTest, BenchmarkIncrementalUpdate)
+{
+    const uint32_t kInstanceCount = 100000;
+    const uint32_t kFrames = 64;
+    const uint32_t animatedPercents[] = { 1, 10, 100 };
+    std::stringstream report;
+    report << "TLAS instance descs of " << kInstanceCount << " instances over " << kFrames << " frames:\n";
+
+    TestScene scene = createScene(kInstanceCount / kMeshTransformCount, 3);
+    std::mt19937 rng(4);
+    std::vector<glm::mat4> poses(256);
+    for (glm::mat4& pose : poses) pose = randomTransform(rng);
+
+    for (uint32_t percent : animatedPercents)
+    {
+        RtInstanceDescCache serialCache, parallelCache;
+        fillCache(scene, serialCache);
+        fillCache(scene, parallelCache);
+        serialCache.update(1);
+        parallelCache.update();
+
+        std::vector<D3D12_RAYTRACING_INSTANCE_DESC> reference;
+        const uint32_t animatedCount = (uint32_t)scene.modelTransforms.size() * percent / 100;
+        double referenceMs = 0, serialMs = 0, parallelMs = 0;
+        uint64_t rewritten = 0;
+        for (uint32_t frame = 0; frame < kFrames; frame++)
+        {
+            // Animate a strided subset of the model instances, so that the dirty descs are spread over the array
+            const uint32_t stride = (uint32_t)scene.modelTransforms.size() / animatedCount;
+            for (uint32_t i = 0; i < animatedCount; i++)
+            {
+                scene.modelTransforms[i * stride] = poses[(i + frame) % poses.size()];
+            }
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            createReference(scene, reference);
+            referenceMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < animatedCount; i++) serialCache.setTransform(kMeshTransformCount + i * stride, scene.modelTransforms[i * stride]);
+            rewritten += serialCache.update(1);
+            serialMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < animatedCount; i++) parallelCache.setTransform(kMeshTransformCount + i * stride, scene.modelTransforms[i * stride]);
+            parallelCache.update();
+            parallelMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        }
+        if (equal(serialCache.getDescs(), reference) == false || equal(parallelCache.getDescs(), reference) == false) return test_fail("The descs differ from a full rebuild");
+
+        const double frames = kFrames;
+        report << "  " << percent << "% animated, " << uint64_t(rewritten / frames) << " descs rewritten per frame. CPU time per frame: "
+            << referenceMs / frames << " ms (full rebuild), " << serialMs / frames << " ms (incremental, 1 thread), " << parallelMs / frames << " ms (incremental, all threads)\n";
+    }
+
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    TlasInstanceDescTest tidt;
+    tidt.init(true);
+    tidt.run();
+    return 0;
+}
@@ -0,0 +1,515 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TriangleBvhTest.h"
+#include "Utils/Math/TriangleBvh.h"
+#include <cfloat>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    using Triangle = TriangleBvh::Triangle;
+
+    /** Randomly sized and rotated boxes over a ground plane, with a few degenerate triangles
+    */
+    std::vector<Triangle> createBoxes(uint32_t boxCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        const float size = std::sqrt(float(boxCount)) * 10.f;
+        std::vector<Triangle> triangles;
+        triangles.push_back({ glm::vec3(-size, 0, -size), glm::vec3(size, 0, -size), glm::vec3(size, 0, size) });
+        triangles.push_back({ glm::vec3(-size, 0, -size), glm::vec3(size, 0, size), glm::vec3(-size, 0, size) });
+        triangles.push_back({ glm::vec3(1, 1, 1), glm::vec3(1, 1, 1), glm::vec3(1, 1, 1) });
+
+        const glm::vec3 corners[8] = { { -1, 0, -1 }, { 1, 0, -1 }, { 1, 0, 1 }, { -1, 0, 1 }, { -1, 2, -1 }, { 1, 2, -1 }, { 1, 2, 1 }, { -1, 2, 1 } };
+        const uint32_t faces[12][3] = { { 0, 1, 2 }, { 0, 2, 3 }, { 4, 6, 5 }, { 4, 7, 6 }, { 0, 4, 5 }, { 0, 5, 1 }, { 1, 5, 6 }, { 1, 6, 2 }, { 2, 6, 7 }, { 2, 7, 3 }, { 3, 7, 4 }, { 3, 4, 0 } };
+        for (uint32_t b = 0; b < boxCount; b++)
+        {
+            glm::vec3 position = glm::vec3(unit(rng) - 0.5f, 0, unit(rng) - 0.5f) * (2.f * size);
+            glm::mat4 transform = glm::translate(glm::mat4(), position) * glm::rotate(glm::mat4(), unit(rng) * 6.28f, glm::vec3(0, 1, 0)) * glm::scale(glm::mat4(), glm::vec3(1.f + unit(rng) * 3.f, 1.f + unit(rng) * 10.f, 1.f + unit(rng) * 3.f));
+            for (const auto& face : faces)
+            {
+                Triangle tri;
+                tri.v0 = glm::vec3(transform * glm::vec4(corners[face[0]], 1));
+                tri.v1 = glm::vec3(transform * glm::vec4(corners[face[1]], 1));
+                tri.v2 = glm::vec3(transform * glm::vec4(corners[face[2]], 1));
+                triangles.push_back(tri);
+            }
+        }
+        return triangles;
+    }
+
+    /** Chains of triangles halving in size towards the origin from random directions. SAH peels them off one at a time, which makes a deep tree.
+    */
+    std::vector<Triangle> createChains(uint32_t chainCount, uint32_t chainLength, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal;
+        std::vector<Triangle> triangles;
+        for (uint32_t c = 0; c < chainCount; c++)
+        {
+            const glm::vec3 direction = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng)));
+            for (uint32_t i = 0; i < chainLength; i++)
+            {
+                const float size = std::pow(0.5f, float(i));
+                const glm::vec3 p = direction * size;
+                triangles.push_back({ p, p + glm::vec3(size * 0.1f, 0, 0), p + glm::vec3(0, size * 0.1f, 0) });
+            }
+        }
+        return triangles;
+    }
+
+    struct Ray
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+    };
+
+    std::vector<Ray> createRays(const std::vector<Triangle>& triangles, uint32_t count, uint32_t seed)
+    {
+        const float size = std::abs(triangles[0].v0.x);
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        std::vector<Ray> rays(count);
+        for (Ray& ray : rays)
+        {
+            ray.origin = glm::vec3(unit(rng) * size, 5.f + unit(rng) * 5.f, unit(rng) * size);
+            ray.direction = glm::normalize(glm::vec3(unit(rng), unit(rng) * 0.5f, unit(rng)) + glm::vec3(0.001f));
+        }
+        return rays;
+    }
+
+    /** Brute-force references. The triangle tests mirror the BVH's, so that the results match exactly.
+    */
+    bool raycastReference(const std::vector<Triangle>& triangles, const Ray& ray, float tMax, float& t)
+    {
+        bool found = false;
+        for (const Triangle& tri : triangles)
+        {
+            const glm::vec3 e1 = tri.v1 - tri.v0, e2 = tri.v2 - tri.v0;
+            const glm::vec3 p = glm::cross(ray.direction, e2);
+            const float det = glm::dot(e1, p);
+            if (det == 0) continue;
+            const float invDet = 1.0f / det;
+            const glm::vec3 s = ray.origin - tri.v0;
+            const float u = glm::dot(s, p) * invDet;
+            if (u < 0 || u > 1) continue;
+            const glm::vec3 q = glm::cross(s, e1);
+            const float v = glm::dot(ray.direction, q) * invDet;
+            if (v < 0 || u + v > 1) continue;
+            const float hitT = glm::dot(e2, q) * invDet;
+            if (hitT < 0 || hitT >= tMax) continue;
+            tMax = hitT;
+            found = true;
+        }
+        t = tMax;
+        return found;
+    }
+
+    float distanceToTriangle(const glm::vec3& p, const Triangle& tri)
+    {
+        // Sample the triangle densely enough to bound the error of the reference
+        float best = FLT_MAX;
+        const uint32_t kSteps = 64;
+        for (uint32_t i = 0; i <= kSteps; i++)
+        {
+            for (uint32_t j = 0; i + j <= kSteps; j++)
+            {
+                const float u = float(i) / kSteps, v = float(j) / kSteps;
+                best = std::min(best, glm::length(tri.v0 + (tri.v1 - tri.v0) * u + (tri.v2 - tri.v0) * v - p));
+            }
+        }
+        return best;
+    }
+
+    bool isBoxOutside(const Triangle& tri, const glm::vec4 planes[6])
+    {
+        const glm::vec3 boxMin = glm::min(tri.v0, glm::min(tri.v1, tri.v2));
+        const glm::vec3 boxMax = glm::max(tri.v0, glm::max(tri.v1, tri.v2));
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            const glm::vec4& plane = planes[i];
+            const glm::vec3 corner(plane.x > 0 ? boxMax.x : boxMin.x, plane.y > 0 ? boxMax.y : boxMin.y, plane.z > 0 ? boxMax.z : boxMin.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w <= 0) return true;
+        }
+        return false;
+    }
+
+    std::string checkRaycasts(const TriangleBvh& bvh, const std::vector<Triangle>& triangles, const std::vector<Ray>& rays)
+    {
+        uint32_t hitCount = 0;
+        for (const Ray& ray : rays)
+        {
+            const float tMax = 1000.f;
+            float referenceT;
+            const bool referenceHit = raycastReference(triangles, ray, tMax, referenceT);
+            TriangleBvh::RayHit hit;
+            if (bvh.raycast(ray.origin, ray.direction, tMax, hit) != referenceHit) return "raycast() disagrees with brute force on whether a ray hits";
+            if (bvh.raycastAny(ray.origin, ray.direction, tMax) != referenceHit) return "raycastAny() disagrees with brute force";
+            if (referenceHit == false) continue;
+
+            // Ties between triangles sharing an edge can pick either one, at the same distance
+            float hitT;
+            Ray single = ray;
+            if (hit.t != referenceT) return "raycast() found a different closest hit";
+            if (raycastReference({ triangles[hit.triangle] }, single, FLT_MAX, hitT) == false || hitT != hit.t) return "The hit triangle index is wrong";
+            hitCount++;
+        }
+        if (hitCount == 0 || hitCount == rays.size()) return "The rays don't test both hits and misses";
+        return "";
+    }
+}
+
+void TriangleBvhTest::addTests()
+{
+    addTestToList<TestRaycast>();
+    addTestToList<TestRaycastPacket>();
+    addTestToList<TestHitFilter>();
+    addTestToList<TestClosestPoint>();
+    addTestToList<TestFrustumOverlap>();
+    addTestToList<TestRefit>();
+    addTestToList<TestDeepTree>();
+    addTestToList<BenchmarkBvh>();
+}
+
+testing_func(TriangleBvhTest, TestRaycast)
+{
+    // Enough triangles for several subtree tasks
+    std::vector<Triangle> triangles = createBoxes(2000, 1);
+    std::vector<Ray> rays = createRays(triangles, 2000, 2);
+
+    TriangleBvh bvh, serialBvh;
+    bvh.build(triangles);
+    serialBvh.build(triangles, 1);
+    std::string error = checkRaycasts(bvh, triangles, rays);
+    if (error.size()) return test_fail(error);
+    error = checkRaycasts(serialBvh, triangles, rays);
+    if (error.size()) return test_fail("Single-threaded build: " + error);
+
+    TriangleBvh::Stats stats = bvh.getStats();
+    if (stats.nodeCount != stats.leafCount * 2 - 1) return test_fail("The tree isn't binary");
+    if (stats.maxDepth > 96) return test_fail("The tree is too deep");
+
+    TriangleBvh emptyBvh;
+    emptyBvh.build({});
+    TriangleBvh::RayHit hit;
+    if (emptyBvh.raycast(rays[0].origin, rays[0].direction, FLT_MAX, hit)) return test_fail("An empty tree was hit");
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestRaycastPacket)
+{
+    std::vector<Triangle> triangles = createBoxes(2000, 8);
+    std::vector<Ray> rays = createRays(triangles, 2000, 9);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+
+    uint32_t hitCount = 0;
+    for (uint32_t p = 0; p + TriangleBvh::kPacketSize <= rays.size(); p += TriangleBvh::kPacketSize)
+    {
+        // Alternate coherent packets, which share an origin and diverge slightly, and incoherent ones. Some packets leave rays out.
+        const bool coherent = (p / TriangleBvh::kPacketSize) % 2 == 0;
+        glm::vec3 origins[TriangleBvh::kPacketSize];
+        glm::vec3 directions[TriangleBvh::kPacketSize];
+        for (uint32_t r = 0; r < TriangleBvh::kPacketSize; r++)
+        {
+            origins[r] = coherent ? rays[p].origin : rays[p + r].origin;
+            directions[r] = coherent ? rays[p].direction + rays[p + r].direction * 0.02f : rays[p + r].direction;
+        }
+        const uint32_t rayMask = (p % 3 == 0) ? 0x5 : 0xf;
+
+        TriangleBvh::RayHit hits[TriangleBvh::kPacketSize];
+        const uint32_t hitMask = bvh.raycastPacket(origins, directions, rayMask, 1000.f, hits);
+        for (uint32_t r = 0; r < TriangleBvh::kPacketSize; r++)
+        {
+            TriangleBvh::RayHit hit;
+            const bool expected = (rayMask & (1u << r)) && bvh.raycast(origins[r], directions[r], 1000.f, hit);
+            if (((hitMask & (1u << r)) != 0) != expected) return test_fail("raycastPacket() disagrees with raycast() on whether a ray hits");
+            if (expected == false) continue;
+
+            // Ties between triangles sharing an edge can pick either one, at the same distance
+            if (hits[r].t != hit.t) return test_fail("raycastPacket() found a different closest hit");
+            float hitT;
+            Ray single = { origins[r], directions[r] };
+            if (raycastReference({ triangles[hits[r].triangle] }, single, FLT_MAX, hitT) == false || hitT != hits[r].t) return test_fail("The hit triangle index of a packet is wrong");
+            hitCount++;
+        }
+    }
+    if (hitCount == 0) return test_fail("No packet ray hit");
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestHitFilter)
+{
+    // Ignore the odd triangles, like an alpha test would, and compare with a brute force search of the even ones
+    std::vector<Triangle> triangles = createBoxes(500, 10);
+    std::vector<Ray> rays = createRays(triangles, 500, 11);
+    std::vector<Triangle> evenTriangles;
+    for (size_t i = 0; i < triangles.size(); i += 2) evenTriangles.push_back(triangles[i]);
+    TriangleBvh::HitFilter filter = [](const TriangleBvh::RayHit& hit) { return hit.triangle % 2 == 0; };
+
+    TriangleBvh bvh;
+    bvh.build(triangles);
+    for (const Ray& ray : rays)
+    {
+        float referenceT;
+        const bool referenceHit = raycastReference(evenTriangles, ray, 1000.f, referenceT);
+        TriangleBvh::RayHit hit;
+        if (bvh.raycast(ray.origin, ray.direction, 1000.f, hit, filter) != referenceHit) return test_fail("A filtered raycast() disagrees with brute force on whether a ray hits");
+        if (referenceHit && (hit.t != referenceT || hit.triangle % 2)) return test_fail("A filtered raycast() found a different closest hit");
+        if (bvh.raycastAny(ray.origin, ray.direction, 1000.f, filter) != referenceHit) return test_fail("A filtered raycastAny() disagrees with brute force");
+
+        TriangleBvh::RayHit hits[TriangleBvh::kPacketSize];
+        glm::vec3 origins[TriangleBvh::kPacketSize] = { ray.origin, ray.origin, ray.origin, ray.origin };
+        glm::vec3 directions[TriangleBvh::kPacketSize] = { ray.direction, ray.direction, ray.direction, ray.direction };
+        if ((bvh.raycastPacket(origins, directions, 0x1, 1000.f, hits, filter) != 0) != referenceHit) return test_fail("A filtered raycastPacket() disagrees with brute force on whether a ray hits");
+        if (referenceHit && hits[0].t != referenceT) return test_fail("A filtered raycastPacket() found a different closest hit");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestDeepTree)
+{
+    // Enough triangles for subtree tasks, which must continue the depth of their parents
+    std::vector<Triangle> triangles = createChains(2000, 150, 6);
+    TriangleBvh bvh, serialBvh;
+    bvh.build(triangles, 8);
+    serialBvh.build(triangles, 1);
+    if (bvh.getStats().maxDepth > 96) return test_fail("The tree is too deep");
+    if (serialBvh.getStats().maxDepth > 96) return test_fail("The single-threaded tree is too deep");
+
+    // Rays through the dense center of the chains
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    uint32_t hitCount = 0;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        Ray ray;
+        ray.origin = glm::vec3(unit(rng), unit(rng), 2.f);
+        ray.direction = glm::vec3(unit(rng) * 0.01f, unit(rng) * 0.01f, 0) - ray.origin;
+        float referenceT;
+        const bool referenceHit = raycastReference(triangles, ray, FLT_MAX, referenceT);
+        TriangleBvh::RayHit hit;
+        if (bvh.raycast(ray.origin, ray.direction, FLT_MAX, hit) != referenceHit) return test_fail("raycast() disagrees with brute force on whether a ray hits");
+        if (bvh.raycastAny(ray.origin, ray.direction, FLT_MAX) != referenceHit) return test_fail("raycastAny() disagrees with brute force");
+        if (referenceHit && hit.t != referenceT) return test_fail("raycast() found a different closest hit");
+        if (referenceHit) hitCount++;
+    }
+    if (hitCount == 0) return test_fail("No ray hit the chains");
+
+    TriangleBvh::PointHit pointHit;
+    if (bvh.closestPoint(glm::vec3(0.f), FLT_MAX, pointHit) == false || pointHit.distance > 1e-6f) return test_fail("The closest point to the center of the chains is wrong");
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestClosestPoint)
+{
+    std::vector<Triangle> triangles = createBoxes(50, 3);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    const float size = std::abs(triangles[0].v0.x);
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        glm::vec3 point(unit(rng) * size, 3.f + unit(rng) * 3.f, unit(rng) * size);
+        TriangleBvh::PointHit hit;
+        if (bvh.closestPoint(point, FLT_MAX, hit) == false) return test_fail("No closest point found");
+
+        float reference = FLT_MAX;
+        for (const Triangle& tri : triangles) reference = std::min(reference, distanceToTriangle(point, tri));
+        if (hit.distance > reference + 1e-3f) return test_fail("The closest point is further than a sampled point");
+        if (std::abs(glm::length(hit.point - point) - hit.distance) > 1e-3f) return test_fail("The closest point doesn't match its distance");
+        if (distanceToTriangle(hit.point, triangles[hit.triangle]) > size * 0.1f) return test_fail("The closest point isn't on its triangle");
+
+        if (bvh.closestPoint(point, hit.distance * 0.5f, hit)) return test_fail("A point beyond the maximum distance was found");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestFrustumOverlap)
+{
+    std::vector<Triangle> triangles = createBoxes(2000, 5);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.1f, 200.f);
+    std::vector<uint32_t> overlapping, reference;
+    for (uint32_t view = 0; view < 16; view++)
+    {
+        const float angle = view * 6.28f / 16;
+        pCamera->setPosition(glm::vec3(0, 20, 0));
+        pCamera->setTarget(glm::vec3(std::cos(angle) * 100, 0, std::sin(angle) * 100));
+        glm::vec4 planes[6];
+        for (uint32_t p = 0; p < 6; p++) planes[p] = pCamera->getFrustumPlane(p);
+
+        bvh.overlapFrustum(planes, overlapping);
+        reference.clear();
+        for (uint32_t i = 0; i < (uint32_t)triangles.size(); i++)
+        {
+            if (isBoxOutside(triangles[i], planes) == false) reference.push_back(i);
+        }
+        std::sort(overlapping.begin(), overlapping.end());
+        if (overlapping != reference) return test_fail("overlapFrustum() differs from testing every triangle's bounds");
+        if (reference.empty() || reference.size() == triangles.size()) return test_fail("The views don't test partial overlap");
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, TestRefit)
+{
+    std::vector<Triangle> triangles = createBoxes(1000, 6);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+
+    // Move a tenth of the boxes
+    std::mt19937 rng(7);
+    for (uint32_t frame = 0; frame < 4; frame++)
+    {
+        for (size_t t = 3; t < triangles.size(); t += 12 * 10)
+        {
+            const glm::vec3 offset = glm::vec3(float(rng() % 100) - 50.f, float(rng() % 10), float(rng() % 100) - 50.f);
+            for (size_t i = t; i < std::min(t + 12, triangles.size()); i++)
+            {
+                triangles[i].v0 += offset;
+                triangles[i].v1 += offset;
+                triangles[i].v2 += offset;
+            }
+        }
+        bvh.refit(triangles);
+        std::string error = checkRaycasts(bvh, triangles, createRays(triangles, 500, 8 + frame));
+        if (error.size()) return test_fail("After refitting: " + error);
+    }
+    return test_pass();
+}
+
+testing_func(TriangleBvhTest, BenchmarkBvh)
+{
+    const uint32_t boxCounts[] = { 10000, 100000 };
+    const uint32_t kRayCount = 100000;
+    std::stringstream report;
+    report << "Triangle BVH, binned SAH with " << TriangleBvh::kBinCount << " bins:\n";
+
+    for (uint32_t boxCount : boxCounts)
+    {
+        std::vector<Triangle> triangles = createBoxes(boxCount, boxCount);
+        std::vector<Ray> rays = createRays(triangles, kRayCount, 9);
+        TriangleBvh bvh;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        bvh.build(triangles, 1);
+        const double serialBuildMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        bvh.build(triangles);
+        const double parallelBuildMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        bvh.refit(triangles);
+        const double refitMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        uint32_t hitCount = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (const Ray& ray : rays)
+        {
+            TriangleBvh::RayHit hit;
+            if (bvh.raycast(ray.origin, ray.direction, FLT_MAX, hit)) hitCount++;
+        }
+        const double raycastMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Coherent rays, like the primary rays of a camera looking down on the boxes, traced one by one and in packets of 2x2 pixels
+        const uint32_t kGridSize = 256;
+        const glm::vec3 cameraPos(0, std::abs(triangles[0].v0.x) * 0.5f, 0);
+        auto getGridDirection = [&](uint32_t x, uint32_t y) { return glm::vec3((x + 0.5f) / kGridSize - 0.5f, -1.0f, (y + 0.5f) / kGridSize - 0.5f); };
+        uint32_t coherentHitCount = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t y = 0; y < kGridSize; y++)
+        {
+            for (uint32_t x = 0; x < kGridSize; x++)
+            {
+                TriangleBvh::RayHit hit;
+                if (bvh.raycast(cameraPos, getGridDirection(x, y), FLT_MAX, hit)) coherentHitCount++;
+            }
+        }
+        const double coherentMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t y = 0; y < kGridSize; y += 2)
+        {
+            for (uint32_t x = 0; x < kGridSize; x += 2)
+            {
+                const glm::vec3 origins[TriangleBvh::kPacketSize] = { cameraPos, cameraPos, cameraPos, cameraPos };
+                const glm::vec3 directions[TriangleBvh::kPacketSize] = { getGridDirection(x, y), getGridDirection(x + 1, y), getGridDirection(x, y + 1), getGridDirection(x + 1, y + 1) };
+                TriangleBvh::RayHit hits[TriangleBvh::kPacketSize];
+                bvh.raycastPacket(origins, directions, 0xf, FLT_MAX, hits);
+            }
+        }
+        const double packetMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        start = CpuTimer::getCurrentTimePoint();
+        for (const Ray& ray : rays)
+        {
+            TriangleBvh::PointHit hit;
+            bvh.closestPoint(ray.origin, FLT_MAX, hit);
+        }
+        const double closestPointMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Brute force on a few rays, for scale
+        const uint32_t kReferenceRays = 100;
+        uint32_t referenceHitCount = 0;
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kReferenceRays; i++)
+        {
+            float t;
+            if (raycastReference(triangles, rays[i], FLT_MAX, t)) referenceHitCount++;
+        }
+        const double referenceMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * kRayCount / kReferenceRays;
+
+        TriangleBvh::Stats stats = bvh.getStats();
+        report << "  " << triangles.size() << " triangles: " << stats.nodeCount << " nodes, depth " << stats.maxDepth << ", SAH cost " << stats.sahCost << "\n"
+            << "    build " << serialBuildMs << " ms (1 thread), " << parallelBuildMs << " ms (all threads), refit " << refitMs << " ms\n"
+            << "    " << kRayCount << " rays (" << hitCount << " hits): " << raycastMs << " ms, " << kRayCount / (raycastMs * 1000.0) << " Mrays/s. Brute force: ~" << referenceMs << " ms (" << referenceHitCount << " of the first " << kReferenceRays << " hit)\n"
+            << "    " << kGridSize * kGridSize << " coherent rays (" << coherentHitCount << " hits): " << coherentMs << " ms one by one, " << packetMs << " ms in packets of " << TriangleBvh::kPacketSize << "\n"
+            << "    " << kRayCount << " closest-point queries: " << closestPointMs << " ms\n";
+    }
+
+    logInfo(report.str());
+    return test_pass();
+}
+
+int main()
+{
+    TriangleBvhTest tbt;
+    tbt.init(true);
+    tbt.run();
+    return 0;
+}
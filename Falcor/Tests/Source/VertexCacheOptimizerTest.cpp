@@ -0,0 +1,238 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VertexCacheOptimizerTest.h"
+#include "Graphics/Model/Loaders/VertexCacheOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+    struct TestMesh
+    {
+        uint32_t vertexCount = 0;
+        std::vector<uint32_t> indices;
+    };
+
+    /** A size x size grid of quads, with the triangles in random order, the vertices numbered randomly and every triangle starting at a random corner.
+        Shuffled this way, a grid is about as bad for the vertex cache as a mesh gets, while the optimal order is well known.
+    */
+    TestMesh createShuffledGrid(uint32_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        TestMesh mesh;
+        mesh.vertexCount = (size + 1) * (size + 1);
+        std::vector<uint32_t> vertexIds(mesh.vertexCount);
+        for (uint32_t i = 0; i < mesh.vertexCount; i++) vertexIds[i] = i;
+        std::shuffle(vertexIds.begin(), vertexIds.end(), rng);
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                uint32_t i = y * (size + 1) + x;
+                triangles.push_back({ vertexIds[i], vertexIds[i + 1], vertexIds[i + size + 2] });
+                triangles.push_back({ vertexIds[i], vertexIds[i + size + 2], vertexIds[i + size + 1] });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), rng);
+        for (auto& triangle : triangles)
+        {
+            std::rotate(triangle.begin(), triangle.begin() + rng() % 3, triangle.end());
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        }
+        return mesh;
+    }
+
+    /** Random triangles over random vertices, with some of the vertices unreferenced
+    */
+    TestMesh createSoup(uint32_t vertexCount, uint32_t triangleCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<uint32_t> vertex(0, vertexCount - 1);
+        TestMesh mesh;
+        mesh.vertexCount = vertexCount;
+        for (uint32_t i = 0; i < triangleCount * 3; i++) mesh.indices.push_back(vertex(rng));
+        return mesh;
+    }
+
+    /** The triangles of an index buffer, each rotated to start at its smallest index, in sorted order.
+        Two index buffers with the same triangles and windings have the same canonical triangles, whatever the triangle order and first corners.
+    */
+    std::vector<std::array<uint32_t, 3>> getCanonicalTriangles(const std::vector<uint32_t>& indices)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    /** A vertex which remembers where it came from
+    */
+    struct TestVertex
+    {
+        uint32_t id;
+        float weight;
+        uint16_t tag;
+    };
+}
+
+void VertexCacheOptimizerTest::addTests()
+{
+    addTestToList<TestAnalyze>();
+    addTestToList<TestTriangleOrder>();
+    addTestToList<TestVertexFetch>();
+    addTestToList<TestEmptyMesh>();
+}
+
+testing_func(VertexCacheOptimizerTest, TestAnalyze)
+{
+    // Two triangles sharing an edge transform 4 vertices
+    const uint32_t quad[] = { 0, 1, 2, 0, 2, 3 };
+    VertexCacheOptimizer::Stats stats = VertexCacheOptimizer::analyze(quad, 6, 4);
+    if (stats.triangleCount != 2 || stats.vertexCount != 4 || stats.cacheMisses != 4) return test_fail("Wrong statistics for a quad");
+    if (stats.getAcmr() != 2.0f || stats.getAtvr() != 1.0f) return test_fail("Wrong ACMR or ATVR for a quad");
+
+    // A strip longer than the cache evicts its first vertices, so going back to the first triangle misses again
+    std::vector<uint32_t> strip;
+    const uint32_t kCacheSize = VertexCacheOptimizer::kAnalysisCacheSize;
+    for (uint32_t i = 0; i <= kCacheSize; i++) strip.insert(strip.end(), { i, i + 1, i + 2 });
+    strip.insert(strip.end(), { 0, 1, 2 });
+    stats = VertexCacheOptimizer::analyze(strip.data(), (uint32_t)strip.size(), kCacheSize + 3);
+    if (stats.vertexCount != kCacheSize + 3 || stats.cacheMisses != kCacheSize + 3 + 3) return test_fail("The FIFO cache doesn't evict its oldest vertices");
+    return test_pass();
+}
+
+testing_func(VertexCacheOptimizerTest, TestTriangleOrder)
+{
+    const TestMesh meshes[] = { createShuffledGrid(64, 1), createShuffledGrid(5, 2), createSoup(3000, 5000, 3) };
+    for (size_t m = 0; m < arraysize(meshes); m++)
+    {
+        const TestMesh& mesh = meshes[m];
+        std::string meshStr = "Mesh " + std::to_string(m) + ": ";
+        std::vector<uint32_t> indices = mesh.indices;
+        VertexCacheOptimizer::optimizeTriangleOrder(indices.data(), (uint32_t)indices.size(), mesh.vertexCount);
+        if (getCanonicalTriangles(indices) != getCanonicalTriangles(mesh.indices)) return test_fail(meshStr + "the triangles or their windings changed");
+
+        VertexCacheOptimizer::Stats before = VertexCacheOptimizer::analyze(mesh.indices.data(), (uint32_t)mesh.indices.size(), mesh.vertexCount);
+        VertexCacheOptimizer::Stats after = VertexCacheOptimizer::analyze(indices.data(), (uint32_t)indices.size(), mesh.vertexCount);
+        if (after.cacheMisses > before.cacheMisses) return test_fail(meshStr + "ACMR got worse, " + std::to_string(before.getAcmr()) + " -> " + std::to_string(after.getAcmr()));
+    }
+
+    // A grid is close to the optimum of 0.5 transformed vertices per triangle once optimized, against 2 or more when shuffled
+    std::vector<uint32_t> grid = meshes[0].indices;
+    VertexCacheOptimizer::optimizeTriangleOrder(grid.data(), (uint32_t)grid.size(), meshes[0].vertexCount);
+    VertexCacheOptimizer::Stats stats = VertexCacheOptimizer::analyze(grid.data(), (uint32_t)grid.size(), meshes[0].vertexCount);
+    if (stats.getAcmr() > 0.8f || stats.getAtvr() > 1.6f) return test_fail("The optimized grid has an ACMR of " + std::to_string(stats.getAcmr()) + " and an ATVR of " + std::to_string(stats.getAtvr()));
+    return test_pass();
+}
+
+testing_func(VertexCacheOptimizerTest, TestVertexFetch)
+{
+    const TestMesh meshes[] = { createShuffledGrid(64, 4), createSoup(3000, 500, 5) };
+    for (size_t m = 0; m < arraysize(meshes); m++)
+    {
+        const TestMesh& mesh = meshes[m];
+        std::string meshStr = "Mesh " + std::to_string(m) + ": ";
+        std::vector<uint32_t> indices = mesh.indices;
+        VertexCacheOptimizer::optimizeTriangleOrder(indices.data(), (uint32_t)indices.size(), mesh.vertexCount);
+        const std::vector<uint32_t> ordered = indices;
+        std::vector<uint32_t> remap = VertexCacheOptimizer::optimizeVertexFetch(indices.data(), (uint32_t)indices.size(), mesh.vertexCount);
+
+        // The remap table is a permutation
+        if (remap.size() != mesh.vertexCount) return test_fail(meshStr + "the remap table doesn't cover the vertices");
+        std::vector<bool> used(mesh.vertexCount, false);
+        for (uint32_t target : remap)
+        {
+            if (target >= mesh.vertexCount || used[target]) return test_fail(meshStr + "the remap table isn't a permutation");
+            used[target] = true;
+        }
+
+        // The indices are remapped, without changing the triangle order, and vertices are numbered by first use
+        uint32_t nextVertex = 0;
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            if (indices[i] != remap[ordered[i]]) return test_fail(meshStr + "index " + std::to_string(i) + " wasn't remapped");
+            if (indices[i] > nextVertex) return test_fail(meshStr + "the vertices aren't in the order of first use");
+            if (indices[i] == nextVertex) nextVertex++;
+        }
+
+        // Unreferenced vertices go to the end
+        std::vector<bool> referenced(mesh.vertexCount, false);
+        for (uint32_t index : ordered) referenced[index] = true;
+        for (uint32_t v = 0; v < mesh.vertexCount; v++)
+        {
+            if (referenced[v] != (remap[v] < nextVertex)) return test_fail(meshStr + "an unreferenced vertex is among the referenced ones");
+        }
+
+        // Moving the vertices with the remap table gives the same triangles as before
+        std::vector<TestVertex> vertices(mesh.vertexCount);
+        for (uint32_t v = 0; v < mesh.vertexCount; v++) vertices[v] = { v, float(v) * 0.5f, uint16_t(v * 7) };
+        VertexCacheOptimizer::remapVertexBuffer(vertices.data(), sizeof(TestVertex), remap);
+        for (uint32_t v = 0; v < mesh.vertexCount; v++)
+        {
+            const TestVertex& vertex = vertices[remap[v]];
+            if (vertex.id != v || vertex.weight != float(v) * 0.5f || vertex.tag != uint16_t(v * 7)) return test_fail(meshStr + "vertex " + std::to_string(v) + " wasn't moved to its new position");
+        }
+        std::vector<uint32_t> original(indices.size());
+        for (size_t i = 0; i < indices.size(); i++) original[i] = vertices[indices[i]].id;
+        if (getCanonicalTriangles(original) != getCanonicalTriangles(mesh.indices)) return test_fail(meshStr + "the triangles or their windings changed");
+
+        // Reordering vertices doesn't change which ones are in the cache
+        VertexCacheOptimizer::Stats before = VertexCacheOptimizer::analyze(ordered.data(), (uint32_t)ordered.size(), mesh.vertexCount);
+        VertexCacheOptimizer::Stats after = VertexCacheOptimizer::analyze(indices.data(), (uint32_t)indices.size(), mesh.vertexCount);
+        if (after.cacheMisses != before.cacheMisses || after.vertexCount != before.vertexCount) return test_fail(meshStr + "the vertex order changed the cache statistics");
+    }
+    return test_pass();
+}
+
+testing_func(VertexCacheOptimizerTest, TestEmptyMesh)
+{
+    VertexCacheOptimizer::Stats stats = VertexCacheOptimizer::analyze(nullptr, 0, 0);
+    if (stats.triangleCount || stats.vertexCount || stats.cacheMisses || stats.getAcmr() != 0.0f || stats.getAtvr() != 0.0f) return test_fail("An empty mesh has statistics");
+    VertexCacheOptimizer::optimizeTriangleOrder(nullptr, 0, 0);
+
+    // Vertices without any triangles keep their order
+    std::vector<uint32_t> remap = VertexCacheOptimizer::optimizeVertexFetch(nullptr, 0, 4);
+    if (remap != std::vector<uint32_t>{ 0, 1, 2, 3 }) return test_fail("Unreferenced vertices were reordered");
+    return test_pass();
+}
+
+int main()
+{
+    VertexCacheOptimizerTest vcot;
+    vcot.init(true);
+    vcot.run();
+    return 0;
+}
@@ -0,0 +1,220 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VertexQuantizationTest.h"
+#include "Graphics/Model/Loaders/VertexQuantizer.h"
+#include <random>
+
+namespace
+{
+    // 2x16-bit octahedral encodings measure below 0.01 degrees. The bound leaves room for float rounding in the decode.
+    const float kMaxOctErrorDegrees = 0.02f;
+
+    float getAngle(const glm::vec3& a, const glm::vec3& b)
+    {
+        return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+    }
+
+    std::vector<glm::vec3> getTestDirections(uint32_t randomCount)
+    {
+        // The axes, the octahedron edges and the folds are where the encoding is the most likely to break
+        std::vector<glm::vec3> dirs =
+        {
+            { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+            { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+            { 1, 1, 1 }, { -1, 1, -1 }, { 1, -1, -1 }, { -1, -1, 1 },
+            { 1e-7f, 0, -1 }, { 0, -1e-7f, -1 },
+        };
+
+        std::mt19937 rng(1);
+        std::normal_distribution<float> dist;
+        while (dirs.size() < randomCount)
+        {
+            glm::vec3 v(dist(rng), dist(rng), dist(rng));
+            if (glm::length(v) > 1e-3f) dirs.push_back(v);
+        }
+
+        for (auto& d : dirs) d = glm::normalize(d);
+        return dirs;
+    }
+}
+
+void VertexQuantizationTest::addTests()
+{
+    addTestToList<TestOctRoundTrip>();
+    addTestToList<TestPositionRoundTrip>();
+    addTestToList<TestTexCoordRoundTrip>();
+    addTestToList<TestReport>();
+}
+
+testing_func(VertexQuantizationTest, TestOctRoundTrip)
+{
+    std::vector<glm::vec3> dirs = getTestDirections(100000);
+
+    float maxError = 0;
+    for (const auto& d : dirs)
+    {
+        uint16_t encoded[2];
+        VertexQuantizer::encodeOct(d, encoded);
+        glm::vec3 decoded = VertexQuantizer::decodeOct(encoded);
+        if (std::abs(glm::length(decoded) - 1) > 1e-5f) return test_fail("Decoded vector isn't normalized");
+        maxError = std::max(maxError, getAngle(d, decoded));
+    }
+    if (maxError > kMaxOctErrorDegrees) return test_fail("Octahedral round-trip error of " + std::to_string(maxError) + " degrees");
+
+    // The stream encoder must produce the same encoding and report the same error
+    std::vector<uint16_t> stream(dirs.size() * 2);
+    float streamError = VertexQuantizer::quantizeUnitVectors(dirs.data(), sizeof(glm::vec3), (uint32_t)dirs.size(), stream.data());
+    for (size_t i = 0; i < dirs.size(); i++)
+    {
+        uint16_t encoded[2];
+        VertexQuantizer::encodeOct(dirs[i], encoded);
+        if (encoded[0] != stream[2 * i] || encoded[1] != stream[2 * i + 1]) return test_fail("Stream encoding doesn't match the single-vector encoding");
+    }
+    if (streamError != maxError) return test_fail("Stream error doesn't match the measured error");
+
+    // Only the direction is encoded, bitangents don't have to be normalized
+    std::vector<glm::vec3> scaled(dirs.size());
+    for (size_t i = 0; i < dirs.size(); i++) scaled[i] = dirs[i] * float(i % 7 + 1);
+    if (VertexQuantizer::quantizeUnitVectors(scaled.data(), sizeof(glm::vec3), (uint32_t)scaled.size(), stream.data()) > kMaxOctErrorDegrees) return test_fail("Non-normalized vectors lose too much precision");
+
+    // Degenerate vectors encode to +Z and don't count as an error
+    const glm::vec3 degenerate[] = { glm::vec3(0), glm::vec3(NAN, 0, 0) };
+    uint16_t degenerateEncoded[4];
+    if (VertexQuantizer::quantizeUnitVectors(degenerate, sizeof(glm::vec3), 2, degenerateEncoded) != 0) return test_fail("Degenerate vectors reported an error");
+    if (VertexQuantizer::decodeOct(degenerateEncoded) != glm::vec3(0, 0, 1)) return test_fail("Zero vector doesn't decode to +Z");
+
+    return test_pass();
+}
+
+testing_func(VertexQuantizationTest, TestPositionRoundTrip)
+{
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    const glm::vec3 boxes[][2] =
+    {
+        { glm::vec3(-1), glm::vec3(1) },
+        { glm::vec3(1000, -20, 3), glm::vec3(1010, 500, 3.5f) },
+        { glm::vec3(-1e4f, 0, -1e4f), glm::vec3(1e4f, 0, 1e4f) },     // Flat in Y
+    };
+
+    for (const auto& box : boxes)
+    {
+        glm::vec3 scale, offset;
+        VertexQuantizer::getPositionDecode(box[0], box[1], scale, offset);
+        if (scale.y <= 0) return test_fail("Flat dimension got a non-positive scale");
+
+        // Per component, the error is at most half a quantization step, plus the float rounding of the decode
+        const glm::vec3 bound = scale * (0.5f / 32767.f) + (glm::abs(offset) + scale) * 1e-6f;
+
+        std::vector<glm::vec3> points = { box[0], box[1], offset };
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            points.push_back(box[0] + (box[1] - box[0]) * glm::vec3(unit(rng), unit(rng), unit(rng)));
+        }
+
+        std::vector<uint16_t> stream(points.size() * 4);
+        float streamError = VertexQuantizer::quantizePositions(points.data(), sizeof(glm::vec3), (uint32_t)points.size(), scale, offset, stream.data());
+
+        float maxError = 0;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            glm::vec3 decoded = VertexQuantizer::decodePosition(&stream[4 * i], scale, offset);
+            glm::vec3 error = glm::abs(decoded - points[i]);
+            if (error.x > bound.x || error.y > bound.y || error.z > bound.z) return test_fail("Position error exceeds half a quantization step");
+            if (stream[4 * i + 3] != 32767) return test_fail("Position W isn't 1");
+            maxError = std::max(maxError, glm::length(decoded - points[i]));
+        }
+        if (std::abs(streamError - maxError) > 1e-6f * glm::length(offset + scale)) return test_fail("Stream error doesn't match the measured error");
+    }
+
+    return test_pass();
+}
+
+testing_func(VertexQuantizationTest, TestTexCoordRoundTrip)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-2.f, 2.f);
+
+    // Half floats are precise enough in [-2, 2]
+    std::vector<glm::vec2> texC = { glm::vec2(0), glm::vec2(1), glm::vec2(-2, 2), glm::vec2(1.9999f, -1.9999f) };
+    for (uint32_t i = 0; i < 10000; i++) texC.push_back(glm::vec2(dist(rng), dist(rng)));
+
+    std::vector<uint16_t> stream(texC.size() * 2);
+    float error = VertexQuantizer::quantizeTexCoords(texC.data(), sizeof(glm::vec2), (uint32_t)texC.size(), stream.data());
+    if (error > VertexQuantizer::kMaxTexCoordError) return test_fail("Texture coordinates in [-2, 2] lose too much precision: " + std::to_string(error));
+    for (size_t i = 0; i < texC.size(); i++)
+    {
+        glm::vec2 decoded = VertexQuantizer::decodeTexCoord(&stream[2 * i]);
+        if (std::abs(decoded.x - texC[i].x) > error || std::abs(decoded.y - texC[i].y) > error) return test_fail("Stream error is smaller than the measured error");
+    }
+
+    // The importers keep tiled and out-of-range coordinates at full precision, based on the reported error
+    const glm::vec2 tiled[] = { glm::vec2(0.5f), glm::vec2(100.3f, 0.5f) };
+    if (VertexQuantizer::quantizeTexCoords(tiled, sizeof(glm::vec2), 2, stream.data()) <= VertexQuantizer::kMaxTexCoordError) return test_fail("Tiled texture coordinates are reported as precise enough");
+
+    const glm::vec2 outOfRange[] = { glm::vec2(1e6f, 0.5f) };
+    if (std::isinf(VertexQuantizer::quantizeTexCoords(outOfRange, sizeof(glm::vec2), 1, stream.data())) == false) return test_fail("Overflow isn't reported as an infinite error");
+
+    // A source stride larger than the texture coordinate, as in 3-component UVs
+    const glm::vec3 wide[] = { glm::vec3(0.25f, 0.75f, 9.f), glm::vec3(0.5f, 0.125f, -9.f) };
+    if (VertexQuantizer::quantizeTexCoords(wide, sizeof(glm::vec3), 2, stream.data()) != 0) return test_fail("Exactly representable texture coordinates reported an error");
+    if (VertexQuantizer::decodeTexCoord(&stream[2]) != glm::vec2(0.5f, 0.125f)) return test_fail("Strided texture coordinates decoded incorrectly");
+
+    return test_pass();
+}
+
+testing_func(VertexQuantizationTest, TestReport)
+{
+    VertexQuantizer::Report a, b;
+    a.meshCount = 2;
+    a.quantizedMeshCount = 1;
+    a.bytesBefore = 4 * 1024 * 1024;
+    a.bytesAfter = 1 * 1024 * 1024;
+    a.maxNormalError = 0.004f;
+    b.meshCount = 1;
+    b.quantizedMeshCount = 1;
+    b.bytesBefore = 2 * 1024 * 1024;
+    b.bytesAfter = 1 * 1024 * 1024;
+    b.maxPositionError = 0.5f;
+    a += b;
+
+    if (a.meshCount != 3 || a.quantizedMeshCount != 2 || a.bytesBefore != 6 * 1024 * 1024 || a.bytesAfter != 2 * 1024 * 1024) return test_fail("Report counts weren't added");
+    if (a.maxPositionError != 0.5f || a.maxNormalError != 0.004f) return test_fail("Report errors aren't the maximum of both reports");
+    if (a.getString("model").find("(4.00 MB saved)") == std::string::npos) return test_fail("Report string doesn't contain the memory saved");
+
+    return test_pass();
+}
+
+int main()
+{
+    VertexQuantizationTest vqt;
+    vqt.init(true);
+    vqt.run();
+    return 0;
+}
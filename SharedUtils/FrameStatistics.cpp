@@ -0,0 +1,268 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "FrameStatistics.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace {
+	const double kNsPerMs = 1.0e6;
+
+	uint32_t mostSignificantBit(uint64_t value)
+	{
+		uint32_t high = uint32_t(value >> 32);
+		return high ? 32 + bitScanReverse(high) : bitScanReverse(uint32_t(value));
+	}
+
+	// Exact percentile of a sorted range, nearest-rank definition
+	float percentileOfSorted(const float* pValues, size_t count, double p)
+	{
+		size_t rank = size_t(std::ceil(p / 100.0 * double(count)));
+		return pValues[std::min(std::max(rank, size_t(1)), count) - 1];
+	}
+
+	void writeSummary(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, const FrameStatistics::Summary& summary)
+	{
+		writer.StartObject();
+		writer.Key("windowCount"); writer.Uint64(summary.count);
+		writer.Key("mean");        writer.Double(summary.mean);
+		writer.Key("p50");         writer.Double(summary.p50);
+		writer.Key("p95");         writer.Double(summary.p95);
+		writer.Key("p99");         writer.Double(summary.p99);
+		writer.Key("max");         writer.Double(summary.max);
+		writer.Key("totalCount");  writer.Uint64(summary.totalCount);
+		writer.Key("histP50");     writer.Double(summary.histP50);
+		writer.Key("histP99");     writer.Double(summary.histP99);
+		writer.Key("histMax");     writer.Double(summary.histMax);
+		writer.EndObject();
+	}
+
+	// Non-empty buckets as [lowerBoundNs, upperBoundNs, count] triples
+	void writeHistogram(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, const LatencyHistogram& histogram)
+	{
+		writer.StartArray();
+		for (uint32_t i = 0; i < LatencyHistogram::kBucketCount; i++)
+		{
+			uint32_t count = histogram.getBucketCountAt(i);
+			if (count == 0) continue;
+			writer.StartArray();
+			writer.Uint64(LatencyHistogram::getBucketLowerBound(i));
+			writer.Uint64(LatencyHistogram::getBucketUpperBound(i));
+			writer.Uint(count);
+			writer.EndArray();
+		}
+		writer.EndArray();
+	}
+};
+
+const uint32_t LatencyHistogram::kSubBucketBits;
+const uint32_t LatencyHistogram::kMaxValueBits;
+const uint32_t LatencyHistogram::kBucketCount;
+const size_t FrameStatistics::kMaxTracks;
+const size_t FrameStatistics::kWindowSize;
+
+uint32_t LatencyHistogram::getBucketIndex(uint64_t valueNs)
+{
+	const uint64_t kLinearCount = uint64_t(1) << kSubBucketBits;
+	if (valueNs < kLinearCount) return uint32_t(valueNs);
+
+	valueNs = std::min(valueNs, (uint64_t(1) << kMaxValueBits) - 1);
+	uint32_t shift = mostSignificantBit(valueNs) - (kSubBucketBits - 1);
+	uint32_t subBucket = uint32_t(valueNs >> shift) - (1u << (kSubBucketBits - 1));
+	return uint32_t(kLinearCount) + (shift - 1) * (1u << (kSubBucketBits - 1)) + subBucket;
+}
+
+uint64_t LatencyHistogram::getBucketLowerBound(uint32_t index)
+{
+	const uint32_t kLinearCount = 1u << kSubBucketBits;
+	const uint32_t kHalfCount = 1u << (kSubBucketBits - 1);
+	if (index < kLinearCount) return index;
+
+	uint32_t shift = (index - kLinearCount) / kHalfCount + 1;
+	uint64_t subBucket = (index - kLinearCount) % kHalfCount + kHalfCount;
+	return subBucket << shift;
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(uint32_t index)
+{
+	return (index + 1 < kBucketCount) ? getBucketLowerBound(index + 1) - 1 : (uint64_t(1) << kMaxValueBits) - 1;
+}
+
+void LatencyHistogram::record(uint64_t valueNs)
+{
+	mBuckets[getBucketIndex(valueNs)]++;
+	mCount++;
+	mMax = std::max(mMax, valueNs);
+}
+
+void LatencyHistogram::reset()
+{
+	mBuckets.fill(0);
+	mCount = 0;
+	mMax = 0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double p) const
+{
+	if (mCount == 0) return 0;
+
+	uint64_t rank = std::max(uint64_t(std::ceil(p / 100.0 * double(mCount))), uint64_t(1));
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < kBucketCount; i++)
+	{
+		seen += mBuckets[i];
+		if (seen >= rank) return std::min(getBucketUpperBound(i), mMax);
+	}
+	return mMax;
+}
+
+FrameStatistics::FrameStatistics()
+{
+	mTracks.resize(kMaxTracks);
+	mScratch.resize(kWindowSize);
+}
+
+void FrameStatistics::record(const std::string& name, uint32_t level, uint64_t frameId, double cpuMs, double gpuMs)
+{
+	// Find the track.  Linear search on purpose: there are few tracks and this neither hashes nor allocates.
+	size_t track = 0;
+	while (track < mTrackCount && mTracks[track].name != name) track++;
+	if (track == mTrackCount)
+	{
+		if (mTrackCount == kMaxTracks) return;
+		mTracks[track].name = name;
+		mTrackCount++;
+	}
+
+	// The profiler lists an event once per start, but accumulates its time per frame.  Only record once.
+	Track& t = mTracks[track];
+	if (t.lastFrameId == frameId) return;
+	t.lastFrameId = frameId;
+	t.level = level;
+
+	if (cpuMs >= 0.0)
+	{
+		t.cpu.histogram.record(uint64_t(cpuMs * kNsPerMs));
+		t.cpu.window.record(float(cpuMs));
+	}
+	if (gpuMs >= 0.0)
+	{
+		t.gpu.histogram.record(uint64_t(gpuMs * kNsPerMs));
+		t.gpu.window.record(float(gpuMs));
+	}
+}
+
+void FrameStatistics::reset()
+{
+	for (size_t i = 0; i < mTrackCount; i++)
+	{
+		mTracks[i].cpu.histogram.reset();
+		mTracks[i].cpu.window.reset();
+		mTracks[i].gpu.histogram.reset();
+		mTracks[i].gpu.window.reset();
+		mTracks[i].lastFrameId = uint64_t(-1);
+	}
+}
+
+FrameStatistics::Summary FrameStatistics::summarize(const Metric& metric) const
+{
+	Summary summary;
+	summary.totalCount = metric.histogram.getCount();
+	summary.histP50 = float(double(metric.histogram.getPercentile(50.0)) / kNsPerMs);
+	summary.histP99 = float(double(metric.histogram.getPercentile(99.0)) / kNsPerMs);
+	summary.histMax = float(double(metric.histogram.getMax()) / kNsPerMs);
+
+	size_t count = metric.window.copyTo(mScratch.data());
+	summary.count = count;
+	if (count == 0) return summary;
+
+	double sum = 0.0;
+	for (size_t i = 0; i < count; i++) sum += mScratch[i];
+	summary.mean = float(sum / double(count));
+
+	std::sort(mScratch.begin(), mScratch.begin() + count);
+	summary.p50 = percentileOfSorted(mScratch.data(), count, 50.0);
+	summary.p95 = percentileOfSorted(mScratch.data(), count, 95.0);
+	summary.p99 = percentileOfSorted(mScratch.data(), count, 99.0);
+	summary.max = mScratch[count - 1];
+	return summary;
+}
+
+void FrameStatistics::renderGui(Gui* pGui) const
+{
+	char buf[256];
+	sprintf_s(buf, "Last %d frames (ms):   p50 / p95 / p99 / max", int(kWindowSize));
+	pGui->addText(buf);
+
+	for (size_t i = 0; i < mTrackCount; i++)
+	{
+		// Indent nested stages under their pass
+		std::string label = std::string(2 * mTracks[i].level, ' ') + mTracks[i].name;
+
+		Summary cpu = getCpuSummary(i);
+		sprintf_s(buf, "%s  CPU %.2f / %.2f / %.2f / %.2f", label.c_str(), cpu.p50, cpu.p95, cpu.p99, cpu.max);
+		pGui->addText(buf);
+
+		if (hasGpuData(i))
+		{
+			Summary gpu = getGpuSummary(i);
+			sprintf_s(buf, "%s  GPU %.2f / %.2f / %.2f / %.2f", std::string(label.size(), ' ').c_str(), gpu.p50, gpu.p95, gpu.p99, gpu.max);
+			pGui->addText(buf);
+		}
+	}
+}
+
+bool FrameStatistics::writeJson(const std::string& filename) const
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+	writer.Key("units");      writer.String("Summaries in ms, histogram buckets in ns");
+	writer.Key("windowSize"); writer.Uint64(kWindowSize);
+	writer.Key("tracks");
+	writer.StartArray();
+	for (size_t i = 0; i < mTrackCount; i++)
+	{
+		writer.StartObject();
+		writer.Key("name");  writer.String(mTracks[i].name.c_str());
+		writer.Key("level"); writer.Uint(mTracks[i].level);
+		writer.Key("cpu");   writeSummary(writer, getCpuSummary(i));
+		writer.Key("cpuHistogram"); writeHistogram(writer, mTracks[i].cpu.histogram);
+		if (hasGpuData(i))
+		{
+			writer.Key("gpu");   writeSummary(writer, getGpuSummary(i));
+			writer.Key("gpuHistogram"); writeHistogram(writer, mTracks[i].gpu.histogram);
+		}
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	std::ofstream file(filename);
+	if (!file.good())
+	{
+		logWarning("Can't write frame statistics to '" + filename + "'");
+		return false;
+	}
+	file << buffer.GetString();
+	return true;
+}
@@ -0,0 +1,158 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Streaming latency statistics for the RenderingPipeline.  Each named track (a pass, a profiled stage inside
+//     a pass, or the whole frame) keeps, separately for CPU and GPU time:
+//        -> a LatencyHistogram over all recorded samples, with ~0.4% relative bucket error, and
+//        -> a RollingWindow holding the exact last kWindowSize samples.
+//
+//     All storage is allocated when the FrameStatistics object is created.  record() only writes into
+//     preallocated arrays (the one exception is a track's name, stored the first time a track shows up),
+//     and everything runs on the render thread, so there are no locks.  Percentile queries and JSON export
+//     are meant for the GUI / shutdown path and may be slower.
+
+#pragma once
+#include "Falcor.h"
+#include <array>
+
+// HDR-histogram style latency histogram.  Values are nanoseconds.  Values below 2^kSubBucketBits get one
+//     bucket each; above that, every power of two is split into 2^(kSubBucketBits-1) linear sub-buckets.
+class LatencyHistogram
+{
+public:
+	static const uint32_t kSubBucketBits = 8;
+	static const uint32_t kMaxValueBits = 36;       ///< Values are clamped to 2^36 ns (~68 seconds)
+	static const uint32_t kBucketCount = (1u << kSubBucketBits) + (kMaxValueBits - kSubBucketBits) * (1u << (kSubBucketBits - 1));
+
+	void record(uint64_t valueNs);
+	void reset();
+
+	uint64_t getCount() const { return mCount; }
+	uint64_t getMax() const { return mMax; }
+
+	/** Returns the (bucket-resolution) value at percentile p in [0, 100].  0 if empty.
+	*/
+	uint64_t getPercentile(double p) const;
+
+	uint32_t getBucketCountAt(uint32_t index) const { return mBuckets[index]; }
+
+	static uint32_t getBucketIndex(uint64_t valueNs);
+	static uint64_t getBucketLowerBound(uint32_t index);
+	static uint64_t getBucketUpperBound(uint32_t index);
+
+private:
+	std::array<uint32_t, kBucketCount> mBuckets = {};
+	uint64_t mCount = 0;
+	uint64_t mMax = 0;
+};
+
+// Exact statistics over the last N samples (a ring buffer)
+template<size_t N>
+class RollingWindow
+{
+public:
+	void record(float value)
+	{
+		mValues[mNext] = value;
+		mNext = (mNext + 1) % N;
+		mSize = std::min(mSize + 1, N);
+	}
+	void reset() { mNext = 0; mSize = 0; }
+
+	size_t size() const { return mSize; }
+	static size_t capacity() { return N; }
+
+	/** Copies the samples (oldest first) into pOut, which must hold capacity() floats.  Returns the count.
+	*/
+	size_t copyTo(float* pOut) const
+	{
+		size_t first = (mNext + N - mSize) % N;
+		for (size_t i = 0; i < mSize; i++) pOut[i] = mValues[(first + i) % N];
+		return mSize;
+	}
+
+private:
+	std::array<float, N> mValues = {};
+	size_t mNext = 0;
+	size_t mSize = 0;
+};
+
+class FrameStatistics
+{
+public:
+	static const size_t kMaxTracks = 32;
+	static const size_t kWindowSize = 1024;
+
+	// Summary of one metric (CPU or GPU time of one track), in milliseconds
+	struct Summary
+	{
+		uint64_t count = 0;                            ///< Samples in the window
+		float mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;  ///< Exact, over the rolling window
+		uint64_t totalCount = 0;                       ///< Samples since the last reset
+		float histP50 = 0, histP99 = 0, histMax = 0;   ///< From the histogram, over all samples since the last reset
+	};
+
+	FrameStatistics();
+
+	/** Records one sample for a track, creating the track on first use.  Silently drops samples once
+	    kMaxTracks tracks exist.  Negative times mean "not available" and are skipped.
+	    \param[in] frameId Used to record a track at most once per frame
+	*/
+	void record(const std::string& name, uint32_t level, uint64_t frameId, double cpuMs, double gpuMs);
+
+	/** Clears all samples.  Tracks are kept.
+	*/
+	void reset();
+
+	size_t getTrackCount() const { return mTrackCount; }
+	const std::string& getTrackName(size_t track) const { return mTracks[track].name; }
+	uint32_t getTrackLevel(size_t track) const { return mTracks[track].level; }
+	bool hasGpuData(size_t track) const { return mTracks[track].gpu.histogram.getCount() > 0; }
+	Summary getCpuSummary(size_t track) const { return summarize(mTracks[track].cpu); }
+	Summary getGpuSummary(size_t track) const { return summarize(mTracks[track].gpu); }
+
+	/** Draws a table of p50/p95/p99/max per track.
+	*/
+	void renderGui(Gui* pGui) const;
+
+	/** Writes all tracks, their summaries and the non-empty histogram buckets to a JSON file.
+	*/
+	bool writeJson(const std::string& filename) const;
+
+private:
+	struct Metric
+	{
+		LatencyHistogram histogram;
+		RollingWindow<kWindowSize> window;
+	};
+
+	struct Track
+	{
+		std::string name;
+		uint32_t level = 0;
+		uint64_t lastFrameId = uint64_t(-1);
+		Metric cpu;
+		Metric gpu;
+	};
+
+	Summary summarize(const Metric& metric) const;
+
+	std::vector<Track> mTracks;                          ///< Sized to kMaxTracks up front
+	size_t mTrackCount = 0;
+	mutable std::vector<float> mScratch;                 ///< Sized to kWindowSize up front, used for percentile queries
+};
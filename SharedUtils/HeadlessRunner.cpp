@@ -0,0 +1,376 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "HeadlessRunner.h"
+#include "RenderingPipeline.h"
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace {
+	const size_t kMaxPendingImages = 8;   ///< Bound on images waiting to be written, so a slow disk cannot eat all memory.
+
+	// Writes images on a worker thread so the render loop only pays for the readback.
+	class AsyncImageWriter
+	{
+	public:
+		struct Job
+		{
+			std::string filename;
+			uint32_t width, height;
+			Bitmap::FileFormat fileFormat;
+			ResourceFormat resourceFormat;
+			std::vector<uint8> data;
+		};
+
+		AsyncImageWriter() { mWorker = std::thread(&AsyncImageWriter::workerLoop, this); }
+		~AsyncImageWriter() { finish(); }
+
+		// Queues an image.  Blocks while kMaxPendingImages images are still waiting.
+		void push(Job&& job)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mSpaceAvailable.wait(lock, [this] { return mJobs.size() < kMaxPendingImages; });
+			mJobs.push_back(std::move(job));
+			mJobAvailable.notify_one();
+		}
+
+		// Writes all queued images and stops the worker.
+		void finish()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mDone = true;
+			}
+			mJobAvailable.notify_one();
+			if (mWorker.joinable()) mWorker.join();
+		}
+
+	private:
+		void workerLoop()
+		{
+			while (true)
+			{
+				Job job;
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					mJobAvailable.wait(lock, [this] { return mDone || !mJobs.empty(); });
+					if (mJobs.empty()) return;
+					job = std::move(mJobs.front());
+					mJobs.pop_front();
+				}
+				mSpaceAvailable.notify_one();
+				Bitmap::saveImage(job.filename, job.width, job.height, job.fileFormat, Bitmap::ExportFlags::None, job.resourceFormat, true, job.data.data());
+			}
+		}
+
+		std::thread mWorker;
+		std::mutex mMutex;
+		std::condition_variable mJobAvailable;
+		std::condition_variable mSpaceAvailable;
+		std::deque<Job> mJobs;
+		bool mDone = false;
+	};
+
+	bool isFloatRGBFormat(ResourceFormat format)
+	{
+		uint32_t bytes = getFormatBytesPerBlock(format);
+		return getFormatType(format) == FormatType::Float && (bytes == 12 || bytes == 16);
+	}
+
+	// Picks the file format for a channel.  PFM/EXR can only hold 32-bit float RGB(A) data and
+	//     FreeImage's 8-bit path cannot hold it, so an incompatible request falls back to the natural format.
+	Bitmap::FileFormat selectFileFormat(const std::string& requested, ResourceFormat format, std::string& extension)
+	{
+		static const std::vector<std::pair<std::string, Bitmap::FileFormat>> kFormats =
+		{
+			{ "png", Bitmap::FileFormat::PngFile }, { "jpg", Bitmap::FileFormat::JpegFile }, { "tga", Bitmap::FileFormat::TgaFile },
+			{ "bmp", Bitmap::FileFormat::BmpFile }, { "pfm", Bitmap::FileFormat::PfmFile }, { "exr", Bitmap::FileFormat::ExrFile },
+		};
+
+		bool isFloat = isFloatRGBFormat(format);
+		for (const auto& f : kFormats)
+		{
+			if (f.first != requested) continue;
+			bool isFloatFile = (f.second == Bitmap::FileFormat::PfmFile || f.second == Bitmap::FileFormat::ExrFile);
+			if (isFloatFile == isFloat)
+			{
+				extension = f.first;
+				return f.second;
+			}
+		}
+		extension = isFloat ? "exr" : "png";
+		return isFloat ? Bitmap::FileFormat::ExrFile : Bitmap::FileFormat::PngFile;
+	}
+};
+
+HeadlessRunner::Options HeadlessRunner::parseArgs(const ArgList& args)
+{
+	Options options;
+	auto firstValue = [&args](const char* key) { std::vector<ArgList::Arg> values = args.getValues(key); return values.empty() ? ArgList::Arg("") : values[0]; };
+
+	if (args.argExists("width"))     options.width = firstValue("width").asUint();
+	if (args.argExists("height"))    options.height = firstValue("height").asUint();
+	if (args.argExists("frames"))    options.frameCount = firstValue("frames").asUint();
+	if (args.argExists("timedelta")) options.timeDelta = firstValue("timedelta").asFloat();
+	if (args.argExists("trace"))     options.traceFrames = firstValue("trace").asUint();
+	options.useCameraPath = args.argExists("campath");
+	options.constantSpeedPath = args.argExists("constantspeed");
+	options.sceneFile = firstValue("scene").asString();
+	options.dumpFormat = firstValue("dumpformat").asString();
+	options.outputDir = args.argExists("outdir") ? firstValue("outdir").asString() : getExecutableDirectory();
+	for (const auto& channel : args.getValues("dump"))
+	{
+		options.dumpChannels.push_back(channel.asString());
+	}
+
+	// asUint() returns -1 on parse failure, so sanitize everything that sizes resources or loops
+	if (options.width == 0 || options.width == uint32_t(-1))   options.width = Options().width;
+	if (options.height == 0 || options.height == uint32_t(-1)) options.height = Options().height;
+	if (options.frameCount == uint32_t(-1))                    options.frameCount = Options().frameCount;
+	if (options.timeDelta <= 0.0f)                             options.timeDelta = Options().timeDelta;
+	if (options.traceFrames == uint32_t(-1))                   options.traceFrames = 0;
+	return options;
+}
+
+void HeadlessRunner::run(std::unique_ptr<RenderingPipeline> pPipe, const SampleConfig& config, const ArgList& args)
+{
+	Logger::showBoxOnError(false);
+	HeadlessRunner runner(std::move(pPipe), args);
+	if (runner.init(config))
+	{
+		runner.renderFrames();
+		runner.writeTimings();
+	}
+	Logger::shutdown();
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+	if (mpPipe && mpRenderContext) mpPipe->onShutdown(this);
+	if (gpDevice) gpDevice->flushAndSync();
+	mpPipe = nullptr;
+	mpTargetFbo = nullptr;
+	mpRenderContext = nullptr;
+	if (gpDevice) gpDevice->cleanup();
+	gpDevice.reset();
+}
+
+bool HeadlessRunner::init(const SampleConfig& config)
+{
+	Window::Desc windowDesc = config.windowDesc;
+	windowDesc.width = mOptions.width;
+	windowDesc.height = mOptions.height;
+	windowDesc.fullScreen = false;
+	windowDesc.visible = false;
+	mpWindow = Window::create(windowDesc, this);
+	if (mpWindow == nullptr)
+	{
+		logError("HeadlessRunner: failed to create window");
+		return false;
+	}
+
+	Device::Desc deviceDesc = config.deviceDesc;
+	deviceDesc.enableVsync = false;
+	gpDevice = Device::create(mpWindow, deviceDesc);
+	if (gpDevice == nullptr)
+	{
+		logError("HeadlessRunner: failed to create device");
+		return false;
+	}
+
+	// Render into an offscreen FBO with the same layout a windowed Sample would use
+	Fbo::SharedPtr pSwapChainFbo = gpDevice->getSwapChainFbo();
+	mpTargetFbo = FboHelper::create2D(mOptions.width, mOptions.height, pSwapChainFbo->getDesc());
+	mpRenderContext = gpDevice->getRenderContext();
+	GraphicsState::SharedPtr pState = GraphicsState::create();
+	pState->setFbo(mpTargetFbo);
+	mpRenderContext->setGraphicsState(pState);
+
+	if (!isDirectoryExists(mOptions.outputDir) && !createDirectory(mOptions.outputDir))
+	{
+		logError("HeadlessRunner: can't create output directory '" + mOptions.outputDir + "'");
+		return false;
+	}
+
+	if (!mOptions.sceneFile.empty()) mpPipe->setDefaultScene(mOptions.sceneFile);
+	mpPipe->setCameraPathEnabled(mOptions.useCameraPath);
+	mpPipe->onLoad(this, mpRenderContext);
+	mpPipe->onResizeSwapChain(this, mOptions.width, mOptions.height);
+
+	// Per-pass events are only recorded while profiling is enabled
+	gProfileEnabled = true;
+	return true;
+}
+
+void HeadlessRunner::resizeSwapChain(uint32_t width, uint32_t height)
+{
+	mOptions.width = width;
+	mOptions.height = height;
+	mpTargetFbo = FboHelper::create2D(width, height, mpTargetFbo->getDesc());
+	mpRenderContext->getGraphicsState()->setFbo(mpTargetFbo);
+	mpPipe->onResizeSwapChain(this, width, height);
+}
+
+float HeadlessRunner::getFrameRate()
+{
+	return mTotalFrameTime > 0.0 ? float(double(mFrameId) / mTotalFrameTime) : 0.0f;
+}
+
+void HeadlessRunner::renderFrames()
+{
+	AsyncImageWriter writer;
+	std::vector<bool> warnedMissingChannel(mOptions.dumpChannels.size(), false);
+	mFramesToRender = mOptions.useCameraPath ? 1 : mOptions.frameCount;
+	if (mOptions.traceFrames > 0) Profiler::startTraceCapture(mOptions.traceFrames, mOptions.outputDir + "/trace.json");
+
+	while (mFrameId < mFramesToRender && !mShouldStop)
+	{
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		mCurrentTime = float(mFrameId) * mOptions.timeDelta;
+		mpPipe->onFrameRender(this, mpRenderContext, mpTargetFbo);
+
+		// The scene is loaded during the first frame, so the camera path length is only known now
+		if (mFrameId == 0 && mOptions.useCameraPath)
+		{
+			Scene::SharedPtr pScene = mpPipe->getScene();
+			if (pScene && pScene->getPathCount() > 0 && pScene->getPath(0)->getKeyFrameCount() > 0)
+			{
+				const ObjectPath::SharedPtr& pPath = pScene->getPath(0);
+				if (mOptions.constantSpeedPath) pPath->setPlaybackMode(ObjectPath::Playback::ConstantSpeed);
+				float duration = pPath->getKeyFrame(pPath->getKeyFrameCount() - 1).time;
+				mFramesToRender = uint32_t(std::ceil(duration / mOptions.timeDelta)) + 1;
+			}
+			else
+			{
+				logWarning("HeadlessRunner: -campath requested, but the scene has no camera path.  Rendering " + std::to_string(mOptions.frameCount) + " frames instead.");
+				mFramesToRender = mOptions.frameCount;
+			}
+		}
+
+		// CPU times are reset by Profiler::endFrame(), GPU times become readable after it (double buffering)
+		std::vector<::RenderPass::SharedPtr> activePasses;
+		mpPipe->getActivePasses(activePasses);
+		if (mTimings.size() != activePasses.size()) mTimings.resize(activePasses.size());
+		std::vector<double> cpuTimes(activePasses.size());
+		for (size_t i = 0; i < activePasses.size(); i++)
+		{
+			mTimings[i].name = activePasses[i]->getName();
+			cpuTimes[i] = Profiler::getEventCpuTime(mTimings[i].name);
+		}
+		gpDevice->flushAndSync();
+		Profiler::endFrame();
+		for (size_t i = 0; i < activePasses.size(); i++)
+		{
+			mTimings[i].cpu.push_back(cpuTimes[i]);
+			mTimings[i].gpu.push_back(Profiler::getEventGpuTime(mTimings[i].name));
+		}
+
+		// Read back the requested channels and hand them to the writer thread
+		ResourceManager::SharedPtr pResManager = mpPipe->getResourceManager();
+		for (size_t i = 0; i < mOptions.dumpChannels.size(); i++)
+		{
+			Texture::SharedPtr pTex = pResManager->getTexture(mOptions.dumpChannels[i]);
+			if (!pTex)
+			{
+				if (!warnedMissingChannel[i]) logWarning("HeadlessRunner: no ResourceManager channel named '" + mOptions.dumpChannels[i] + "'");
+				warnedMissingChannel[i] = true;
+				continue;
+			}
+
+			AsyncImageWriter::Job job;
+			std::string extension;
+			job.fileFormat = selectFileFormat(mOptions.dumpFormat, pTex->getFormat(), extension);
+			char frameStr[16];
+			sprintf_s(frameStr, "%05d", int(mFrameId));
+			job.filename = mOptions.outputDir + "/" + mOptions.dumpChannels[i] + "_" + frameStr + "." + extension;
+			job.width = pTex->getWidth();
+			job.height = pTex->getHeight();
+			job.resourceFormat = pTex->getFormat();
+			job.data = mpRenderContext->readTextureSubresource(pTex.get(), 0);
+			writer.push(std::move(job));
+		}
+
+		mLastFrameTime = float(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - frameStart).count());
+		mTotalFrameTime += mLastFrameTime;
+		mFrameId++;
+	}
+
+	// Writes the trace if the run ended before all requested frames were captured.  The GPU is idle, so the last frame is complete.
+	Profiler::endTraceCapture();
+	writer.finish();
+}
+
+void HeadlessRunner::writeTimings()
+{
+	if (mFrameId == 0) return;
+
+	std::string summary = "Headless run: " + std::to_string(mFrameId) + " frames at " + std::to_string(mOptions.width) + "x" + std::to_string(mOptions.height) +
+		", " + std::to_string(getFrameRate()) + " fps\n";
+	summary += "Pass                           CPU avg/min/max (ms)        GPU avg/min/max (ms)\n";
+	for (const auto& timing : mTimings)
+	{
+		if (timing.cpu.empty()) continue;
+
+		// The first frame includes scene loading and shader compilation, so leave it out of the summary when possible
+		size_t first = (timing.cpu.size() > 1) ? 1 : 0;
+		double cpuSum = 0, cpuMin = DBL_MAX, cpuMax = 0, gpuSum = 0, gpuMin = DBL_MAX, gpuMax = 0;
+		for (size_t i = first; i < timing.cpu.size(); i++)
+		{
+			cpuSum += timing.cpu[i]; cpuMin = std::min(cpuMin, timing.cpu[i]); cpuMax = std::max(cpuMax, timing.cpu[i]);
+			gpuSum += timing.gpu[i]; gpuMin = std::min(gpuMin, timing.gpu[i]); gpuMax = std::max(gpuMax, timing.gpu[i]);
+		}
+		double count = double(timing.cpu.size() - first);
+
+		char line[512];
+		sprintf_s(line, "%-30s %7.3f %7.3f %7.3f     %7.3f %7.3f %7.3f\n", timing.name.c_str(),
+			cpuSum / count, cpuMin, cpuMax, gpuSum / count, gpuMin, gpuMax);
+		summary += line;
+	}
+	logInfo(summary);
+	printf("%s", summary.c_str());
+
+	// Percentiles and histograms gathered by the pipeline itself
+	mpPipe->getFrameStatistics().writeJson(mOptions.outputDir + "/frameStats.json");
+
+	// Per-frame values, one column pair per pass
+	std::ofstream csv(mOptions.outputDir + "/timings.csv");
+	if (!csv.good())
+	{
+		logWarning("HeadlessRunner: can't write " + mOptions.outputDir + "/timings.csv");
+		return;
+	}
+	csv << "frame";
+	for (const auto& timing : mTimings) csv << "," << timing.name << " cpu," << timing.name << " gpu";
+	csv << "\n";
+	for (size_t frame = 0; frame < mFrameId; frame++)
+	{
+		csv << frame;
+		for (const auto& timing : mTimings)
+		{
+			if (frame < timing.cpu.size()) csv << "," << timing.cpu[frame] << "," << timing.gpu[frame];
+			else csv << ",,";
+		}
+		csv << "\n";
+	}
+}
@@ -0,0 +1,139 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// The HeadlessRunner drives a RenderingPipeline without a visible window or GUI.  It is used for batch
+//     rendering, benchmarking and automated runs, e.g.:
+//
+//         BMFR_Denoiser.exe -headless -width 1280 -height 720 -frames 60 -dump MainOutput -outdir frames
+//
+//     Recognized command line flags:
+//         -headless                 Enables headless mode (checked by RenderingPipeline::run())
+//         -width <w> -height <h>    Resolution of the offscreen render targets
+//         -frames <n>               Number of frames to render (ignored when -campath is set)
+//         -campath                  Render the scene's first camera path once, start to end
+//         -constantspeed            Move along the camera path at constant speed, so captures of the same path are comparable
+//         -timedelta <sec>          Simulated time between two frames (default: 1/30)
+//         -scene <file>             Scene to load instead of the pipeline's default scene
+//         -dump <ch0> <ch1> ...     ResourceManager channels to write to disk every frame
+//         -dumpformat <ext>         One of png, jpg, bmp, tga, pfm, exr.  Defaults to exr for float channels, png otherwise
+//         -outdir <dir>             Directory for dumped images, timings.csv and frameStats.json (default: executable directory)
+//         -trace <n>                Capture a profiler timeline trace of n frames to trace.json in the output directory
+//
+//     D3D12 devices in Falcor are always created against a window, so the runner creates a hidden one.  The
+//     swap chain that comes with it is never presented; all rendering goes to an offscreen FBO.
+
+#pragma once
+#include "Falcor.h"
+
+class RenderingPipeline;
+
+class HeadlessRunner : public SampleCallbacks, public Window::ICallbacks
+{
+public:
+	struct Options
+	{
+		uint32_t width = 1920;
+		uint32_t height = 1080;
+		uint32_t frameCount = 100;
+		bool useCameraPath = false;
+		bool constantSpeedPath = false;
+		float timeDelta = 1.0f / 30.0f;
+		std::string sceneFile;
+		std::vector<std::string> dumpChannels;
+		std::string dumpFormat;                 ///< File extension.  Empty selects a format per channel.
+		std::string outputDir;
+		uint32_t traceFrames = 0;               ///< Frames to capture in a profiler trace, starting after the first frame.  0 disables it.
+	};
+
+	/** Returns true if the command line asks for a headless run.
+	*/
+	static bool isRequested(const ArgList& args) { return args.argExists("headless"); }
+
+	/** Fills an Options struct from the command line flags listed at the top of this file.
+	*/
+	static Options parseArgs(const ArgList& args);
+
+	/** Runs the pipeline headless with options parsed from args.  Takes ownership of the pipeline, like Sample::run() does.
+	*/
+	static void run(std::unique_ptr<RenderingPipeline> pPipe, const SampleConfig& config, const ArgList& args);
+
+	// SampleCallbacks.  Most of these are meaningless without a window and are ignored.
+	virtual RenderContext::SharedPtr getRenderContext() override { return mpRenderContext; }
+	virtual Fbo::SharedPtr getCurrentFbo() override { return mpTargetFbo; }
+	virtual Window* getWindow() override { return mpWindow.get(); }
+	virtual Gui* getGui() override { return nullptr; }
+	virtual float getCurrentTime() override { return mCurrentTime; }
+	virtual void setCurrentTime(float time) override { mCurrentTime = time; }
+	virtual void resizeSwapChain(uint32_t width, uint32_t height) override;
+	virtual float getFrameRate() override;
+	virtual float getLastFrameTime() override { return mLastFrameTime; }
+	virtual uint64_t getFrameID() override { return mFrameId; }
+	virtual void renderText(const std::string& str, const glm::vec2& position, glm::vec2 shadowOffset = glm::vec2(1)) override {}
+	virtual std::string getFpsMsg() override { return ""; }
+	virtual bool isKeyPressed(const KeyboardEvent::Key& key) override { return false; }
+	virtual void toggleText(bool showText) override {}
+	virtual void toggleUI(bool showUI) override {}
+	virtual void toggleGlobalUI(bool showGlobalUI) override {}
+	virtual void setDefaultGuiSize(uint32_t width, uint32_t height) override {}
+	virtual void setDefaultGuiPosition(uint32_t x, uint32_t y) override {}
+	virtual ArgList getArgList() override { return mArgList; }
+	virtual void setFixedTimeDelta(float newDelta) override { mOptions.timeDelta = newDelta; }
+	virtual float getFixedTimeDelta() override { return mOptions.timeDelta; }
+	virtual std::string captureScreen(const std::string explicitFilename = "", const std::string explicitOutputDirectory = "") override { return ""; }
+	virtual void shutdown() override { mShouldStop = true; }
+	virtual void onTestShutdown() override {}
+	virtual void freezeTime(bool timeFrozen) override {}
+	virtual bool isTimeFrozen() override { return false; }
+
+	// Window::ICallbacks.  The window is never shown, so there are no events to handle.
+	virtual void handleWindowSizeChange() override {}
+	virtual void renderFrame() override {}
+	virtual void handleKeyboardEvent(const KeyboardEvent& keyEvent) override {}
+	virtual void handleMouseEvent(const MouseEvent& mouseEvent) override {}
+	virtual void handleDroppedFile(const std::string& filename) override {}
+
+private:
+	HeadlessRunner(std::unique_ptr<RenderingPipeline> pPipe, const ArgList& args) : mpPipe(std::move(pPipe)), mArgList(args), mOptions(parseArgs(args)) {}
+	~HeadlessRunner();
+
+	bool init(const SampleConfig& config);
+	void renderFrames();
+	void writeTimings();
+
+	// Per-frame timings of one pass (in ms)
+	struct PassTiming
+	{
+		std::string name;
+		std::vector<double> cpu;
+		std::vector<double> gpu;
+	};
+
+	std::unique_ptr<RenderingPipeline> mpPipe;
+	ArgList mArgList;
+	Options mOptions;
+	Window::SharedPtr mpWindow;
+	RenderContext::SharedPtr mpRenderContext;
+	Fbo::SharedPtr mpTargetFbo;
+	std::vector<PassTiming> mTimings;
+	float mCurrentTime = 0.0f;
+	float mLastFrameTime = 0.0f;
+	double mTotalFrameTime = 0.0;
+	uint64_t mFrameId = 0;
+	uint32_t mFramesToRender = 0;
+	bool mShouldStop = false;
+};
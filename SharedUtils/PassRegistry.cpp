@@ -0,0 +1,61 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "PassRegistry.h"
+
+PassRegistry& PassRegistry::instance()
+{
+	static PassRegistry sRegistry;
+	return sRegistry;
+}
+
+void PassRegistry::registerPass(const std::string& type, CreateFunc func)
+{
+	if (isRegistered(type))
+	{
+		logWarning("PassRegistry: pass type '" + type + "' is already registered.  Replacing the existing factory.");
+	}
+	mFactories[type] = func;
+}
+
+::RenderPass::SharedPtr PassRegistry::createPass(const std::string& type, const Args& args) const
+{
+	auto it = mFactories.find(type);
+	if (it == mFactories.end())
+	{
+		logError("PassRegistry: unknown pass type '" + type + "'");
+		return nullptr;
+	}
+	return it->second(args);
+}
+
+std::vector<std::string> PassRegistry::getRegisteredTypes() const
+{
+	std::vector<std::string> types;
+	for (const auto& factory : mFactories)
+	{
+		types.push_back(factory.first);
+	}
+	return types;
+}
+
+std::string PassRegistry::getArg(const Args& args, const std::string& name, const std::string& defaultValue)
+{
+	auto it = args.find(name);
+	return (it != args.end()) ? it->second : defaultValue;
+}
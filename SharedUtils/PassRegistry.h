@@ -0,0 +1,61 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// The PassRegistry maps pass type names to factory functions, so render passes can be instantiated by name
+//     (e.g., from a pipeline description file) instead of being compiled into the application's main().
+//     Applications register the passes they link against before calling RenderingPipeline::run().
+
+#pragma once
+#include "Falcor.h"
+#include "RenderPass.h"
+#include <functional>
+#include <map>
+
+class PassRegistry
+{
+public:
+	// Named constructor arguments.  Values are kept as strings; factories parse what they need.
+	using Args = std::map<std::string, std::string>;
+	using CreateFunc = std::function<::RenderPass::SharedPtr(const Args&)>;
+
+	static PassRegistry& instance();
+
+	/** Register a factory for a pass type.  Registering an existing type replaces its factory.
+	*/
+	void registerPass(const std::string& type, CreateFunc func);
+
+	/** Returns true if a factory was registered under this name.
+	*/
+	bool isRegistered(const std::string& type) const { return mFactories.find(type) != mFactories.end(); }
+
+	/** Instantiate a pass by type name.  Returns nullptr (and logs an error) if the type is unknown.
+	*/
+	::RenderPass::SharedPtr createPass(const std::string& type, const Args& args = Args()) const;
+
+	/** Returns the names of all registered pass types.
+	*/
+	std::vector<std::string> getRegisteredTypes() const;
+
+	/** Helper for factories: returns args[name], or defaultValue if the argument wasn't given.
+	*/
+	static std::string getArg(const Args& args, const std::string& name, const std::string& defaultValue = "");
+
+private:
+	PassRegistry() = default;
+	std::map<std::string, CreateFunc> mFactories;
+};
@@ -0,0 +1,149 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "PipelineDescription.h"
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+	const char* kPasses          = "passes";
+	const char* kSettings        = "settings";
+	const char* kType            = "type";
+	const char* kArgs            = "args";
+	const char* kOptions         = "options";
+	const char* kShowGui         = "showGui";
+	const char* kCanAddPassAfter = "canAddPassAfter";
+	const char* kCanRemovePass   = "canRemovePass";
+
+	// Converts a scalar JSON value to the string form used by PassRegistry::Args
+	bool valueToString(const rapidjson::Value& value, std::string& str)
+	{
+		if (value.IsString())     str = value.GetString();
+		else if (value.IsBool())  str = value.GetBool() ? "true" : "false";
+		else if (value.IsInt64()) str = std::to_string(value.GetInt64());
+		else if (value.IsNumber())
+		{
+			std::ostringstream oss;
+			oss.precision(9);
+			oss << value.GetDouble();
+			str = oss.str();
+		}
+		else return false;
+		return true;
+	}
+
+	bool parseArgs(const rapidjson::Value& object, const std::string& what, PassRegistry::Args& args, std::string& log)
+	{
+		if (!object.IsObject())
+		{
+			log = "'" + what + "' must be a JSON object";
+			return false;
+		}
+		for (auto it = object.MemberBegin(); it != object.MemberEnd(); ++it)
+		{
+			std::string key = it->name.GetString();
+			if (!valueToString(it->value, args[key]))
+			{
+				log = "'" + what + "." + key + "' must be a string, number or bool";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool parseBool(const rapidjson::Value& object, const char* key, bool& value, std::string& log)
+	{
+		if (!object.HasMember(key)) return true;
+		if (!object[key].IsBool())
+		{
+			log = std::string("'") + key + "' must be a bool";
+			return false;
+		}
+		value = object[key].GetBool();
+		return true;
+	}
+};
+
+bool PipelineDescription::load(const std::string& filename, PipelineDescription& desc, std::string& log)
+{
+	std::ifstream file(filename);
+	if (!file.good())
+	{
+		log = "Can't open pipeline description '" + filename + "'";
+		return false;
+	}
+	std::stringstream json;
+	json << file.rdbuf();
+
+	if (!parse(json.str(), desc, log))
+	{
+		log = filename + ": " + log;
+		return false;
+	}
+	return true;
+}
+
+bool PipelineDescription::parse(const std::string& json, PipelineDescription& desc, std::string& log)
+{
+	rapidjson::Document doc;
+	if (doc.Parse(json.c_str()).HasParseError())
+	{
+		log = std::string("JSON parse error at offset ") + std::to_string(doc.GetErrorOffset()) + ": " + rapidjson::GetParseError_En(doc.GetParseError());
+		return false;
+	}
+	if (!doc.IsObject() || !doc.HasMember(kPasses) || !doc[kPasses].IsArray())
+	{
+		log = "a pipeline description needs a 'passes' array";
+		return false;
+	}
+
+	PipelineDescription parsed;
+	if (doc.HasMember(kSettings) && !parseArgs(doc[kSettings], kSettings, parsed.settings, log)) return false;
+
+	const rapidjson::Value& passes = doc[kPasses];
+	for (rapidjson::SizeType i = 0; i < passes.Size(); i++)
+	{
+		const rapidjson::Value& jpass = passes[i];
+		std::string passStr = "passes[" + std::to_string(i) + "]";
+		if (!jpass.IsObject() || !jpass.HasMember(kType) || !jpass[kType].IsString())
+		{
+			log = "'" + passStr + "' needs a 'type' string";
+			return false;
+		}
+
+		Pass pass;
+		pass.type = jpass[kType].GetString();
+		if (jpass.HasMember(kArgs) && !parseArgs(jpass[kArgs], passStr + "." + kArgs, pass.args, log)) return false;
+		if (jpass.HasMember(kOptions) && !parseArgs(jpass[kOptions], passStr + "." + kOptions, pass.options, log)) return false;
+		if (!parseBool(jpass, kShowGui, pass.showGui, log)) return false;
+		if (!parseBool(jpass, kCanAddPassAfter, pass.canAddPassAfter, log)) return false;
+		if (!parseBool(jpass, kCanRemovePass, pass.canRemovePass, log)) return false;
+		parsed.passes.push_back(pass);
+	}
+
+	if (parsed.passes.empty())
+	{
+		log = "the 'passes' array is empty";
+		return false;
+	}
+
+	desc = parsed;
+	return true;
+}
@@ -0,0 +1,65 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// A PipelineDescription is the parsed form of a JSON file describing a RenderingPipeline, so pass lists can
+//     be changed (and swept from batch scripts) without recompiling.  Example:
+//
+//     {
+//         "settings": { "scene": "Data/pink_room/pink_room.fscene", "cameraPath": false, "freezeTime": true },
+//         "passes": [
+//             { "type": "LightProbeGBufferPass" },
+//             { "type": "SimpleDiffuseGIPass", "options": { "indirectGI": true } },
+//             { "type": "BlockwiseMultiOrderFeatureRegression", "args": { "channel": "PipelineOutput" }, "showGui": true }
+//         ]
+//     }
+//
+//     "type" names a pass in the PassRegistry, "args" are handed to its factory, and "options" set the
+//     pass' initial GUI state via RenderPass::onSetOption().  "showGui", "canAddPassAfter" and "canRemovePass"
+//     control the pipeline UI for that slot.  Scalar JSON values are converted to strings.
+
+#pragma once
+#include "Falcor.h"
+#include "PassRegistry.h"
+
+struct PipelineDescription
+{
+	struct Pass
+	{
+		std::string type;
+		PassRegistry::Args args;          ///< Constructor arguments, passed to the registered factory
+		PassRegistry::Args options;       ///< Initial GUI options, applied through RenderPass::onSetOption()
+		bool showGui = false;
+		bool canAddPassAfter = false;
+		bool canRemovePass = false;
+	};
+
+	std::vector<Pass> passes;
+	PassRegistry::Args settings;          ///< Pipeline-wide settings ("scene", "cameraPath", "freezeTime")
+
+	/** Parse a description file.
+	    \param[in] filename Full path of the JSON file.
+	    \param[out] desc The parsed description.  Unchanged if parsing fails.
+	    \param[out] log Description of the problem if parsing fails.
+	    \return true on success.
+	*/
+	static bool load(const std::string& filename, PipelineDescription& desc, std::string& log);
+
+	/** Parse a description from a JSON string.  See load().
+	*/
+	static bool parse(const std::string& json, PipelineDescription& desc, std::string& log);
+};
@@ -57,6 +57,43 @@ void ::RenderPass::onExecute(RenderContext* pRenderContext)
     execute(pRenderContext);
 }
 
+bool ::RenderPass::onSetOption(const std::string& name, const std::string& value)
+{
+	if (!setOption(name, value))
+	{
+		logWarning("Render pass '" + mName + "' ignored option '" + name + "' = '" + value + "'");
+		return false;
+	}
+	setRefreshFlag();
+	return true;
+}
+
+bool ::RenderPass::parseOption(const std::string& value, bool& result)
+{
+	if (value == "true" || value == "1")       result = true;
+	else if (value == "false" || value == "0") result = false;
+	else return false;
+	return true;
+}
+
+bool ::RenderPass::parseOption(const std::string& value, float& result)
+{
+	char* pEnd = nullptr;
+	float parsed = std::strtof(value.c_str(), &pEnd);
+	if (value.empty() || *pEnd != '\0') return false;
+	result = parsed;
+	return true;
+}
+
+bool ::RenderPass::parseOption(const std::string& value, uint32_t& result)
+{
+	char* pEnd = nullptr;
+	unsigned long parsed = std::strtoul(value.c_str(), &pEnd, 10);
+	if (value.empty() || value[0] == '-' || *pEnd != '\0') return false;
+	result = uint32_t(parsed);
+	return true;
+}
+
 void ::RenderPass::onShutdown()
 {
     // Enforce that onShutdown() is only called once, on successfully initialized passes.
@@ -49,6 +49,7 @@ protected:
 	virtual void stateRefreshed() {}
 	virtual void activatePass() {}
 	virtual void deactivatePass() {}
+	virtual bool setOption(const std::string& name, const std::string& value) { return false; }
 
 public:
 
@@ -133,6 +134,13 @@ public:
 	*/
 	void onPassDeactivation() { deactivatePass(); }
 
+	/** Sets an initial value for one of the pass' GUI options, e.g., from a pipeline description file.
+	    \param[in] name Option name, as documented by the pass.
+	    \param[in] value Option value in string form ("true", "0.5", ...).
+	    \return false if the pass doesn't know the option or the value can't be parsed
+	*/
+	bool onSetOption(const std::string& name, const std::string& value);
+
     //
     // Public utility functions. These configure the render pass name and UI window.
     //
@@ -208,6 +216,12 @@ protected:
     */
     void setRebindFlag() { mRebindFlag = true; }
 
+    /** Helpers for setOption() implementations.  Return false if the string can't be parsed.
+    */
+    static bool parseOption(const std::string& value, bool& result);
+    static bool parseOption(const std::string& value, float& result);
+    static bool parseOption(const std::string& value, uint32_t& result);
+
 private:
     // Internal state
     std::string mName;                          ///< Name of the render pass.
@@ -20,11 +20,24 @@
 #include "RenderingPipeline.h"
 #include "Externals/dear_imgui/imgui.h"
 #include "SceneLoaderWrapper.h"
+#include "HeadlessRunner.h"
+#include "Graphics/Model/Loaders/ModelCache.h"
 #include <algorithm>
 
 namespace {
 	const char     *kNullPassDescriptor = "< None >";   ///< Name used in dropdown lists when no pass is selected.
 	const uint32_t  kNullPassId = 0xFFFFFFFFu;          ///< Id used to represent the null pass (using -1).
+	const std::string kFrameStatsTrack = "Frame";       ///< Name of the whole-frame track in our FrameStatistics.
+
+	// Reads a bool from the "settings" block of a pipeline description.  Returns false if not present (or not a bool).
+	bool getBoolSetting(const PassRegistry::Args &settings, const std::string &name, bool &value)
+	{
+		std::string str = PassRegistry::getArg(settings, name);
+		if (str == "true")  { value = true;  return true; }
+		if (str == "false") { value = false; return true; }
+		if (!str.empty()) logWarning("Pipeline setting '" + name + "' should be true or false, not '" + str + "'");
+		return false;
+	}
 };
 
 
@@ -63,6 +76,12 @@ void RenderingPipeline::onLoad(SampleCallbacks* pSample, const RenderContext::Sh
 		}
 	}
 
+	// A scene requested by the application overrides whatever the passes asked for
+	if (!mDefaultSceneOverride.empty())
+	{
+		mpResourceManager->setDefaultSceneName(mDefaultSceneOverride);
+	}
+
     // If nobody has started inserting passes into our pipeline, set up our GUI so we can start adding passes manually.
 	if (mActivePasses.size() == 0)
 	{
@@ -77,8 +96,6 @@ void RenderingPipeline::onLoad(SampleCallbacks* pSample, const RenderContext::Sh
     }
 
 	// Create identifiers for profiling.
-    mProfileGPUTimes.resize(mActivePasses.size() * 2);
-    mProfileLastGPUTimes.resize(mActivePasses.size() * 2);
 	for (uint32_t i = 0; i < mActivePasses.size()*2; i++)
 	{
 		char buf[256];
@@ -306,6 +323,13 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 		pGui->addText(""); 
 	}
 
+	// If our passes came from a description file, allow reloading it by hand (e.g., after an error)
+	if (!mPipeDescFilename.empty())
+	{
+		pGui->addText(("Pipeline: " + getFilenameFromPath(mPipeDescFilename)).c_str());
+		if (pGui->addButton("Reload", true)) mPipeDescChanged = true;
+	}
+
 	pGui->addText("");
 	pGui->addText("Ordered list of passes in rendering pipeline:");
 	pGui->addText("       (Click the boxes at left to toggle GUIs)");
@@ -360,16 +384,10 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 	// Enable an option to enable/disable binding of the camera to a path
 	if (mpScene && mpScene->getPathCount() && mPipeHasAnimation)
 	{
-		if (pGui->addCheckBox("Animated camera path?", mUseSceneCameraPath))
+		bool useCameraPath = mUseSceneCameraPath;
+		if (pGui->addCheckBox("Animated camera path?", useCameraPath))
 		{
-			if (mUseSceneCameraPath)
-			{
-				mpScene->getPath(0)->attachObject(mpScene->getActiveCamera());
-			}
-			else
-			{
-				mpScene->getPath(0)->detachObject(mpScene->getActiveCamera());
-			}
+			setCameraPathEnabled(useCameraPath);
 		}
 	}
 
@@ -383,8 +401,39 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 	}
 
     pGui->addText("");
+    if (pGui->beginGroup("Frame time statistics"))
+    {
+        if (!Falcor::gProfileEnabled) pGui->addText("(Recorded while profiling is enabled)");
+        mFrameStats.renderGui(pGui);
+        if (pGui->addButton("Reset")) mFrameStats.reset();
+        if (pGui->addButton("Save to JSON", true))
+        {
+            std::string filename;
+            if (findAvailableFilename("FrameStats", getExecutableDirectory(), "json", filename) && mFrameStats.writeJson(filename))
+            {
+                logInfo("Frame statistics written to " + filename);
+            }
+        }
+        pGui->endGroup();
+    }
+
+    if (pGui->beginGroup("Timeline trace"))
+    {
+        pGui->addIntVar("Frames to capture", mTraceFrames, 1, 1000);
+        if (Profiler::isTraceCaptureActive())
+        {
+            pGui->addText("Capturing...");
+        }
+        else if (pGui->addButton("Capture trace"))
+        {
+            Profiler::startTraceCapture(uint32_t(mTraceFrames));
+        }
+        pGui->endGroup();
+    }
+
     pGui->addSeparator();
     pGui->addText(Falcor::gProfileEnabled ? "Press (P):  Hide profiling window" : "Press (P):  Show profiling window");
+    pGui->addText("Press (Shift+P):  Capture a timeline trace");
     pGui->addSeparator();
 }
 
@@ -616,6 +665,12 @@ void RenderingPipeline::onFrameRender(SampleCallbacks* pSample, const RenderCont
 	// Is this the first time we've run onFrameRender()?  If som take care of things that happen on first execution.
 	if (mFirstFrame) onFirstRun(pSample);
 
+	// Did our pipeline description change on disk?  (The flag gets set by the file monitoring thread.)
+	if (mPipeDescChanged.exchange(false))
+	{
+		reloadPipelineDescription(pSample);
+	}
+
 	// Bind our default state to the graphics pipe
 	pRenderContext->pushGraphicsState(mpDefaultGfxState);
 
@@ -693,6 +748,16 @@ void RenderingPipeline::onFrameRender(SampleCallbacks* pSample, const RenderCont
 	// Once we're done rendering, clear the pipeline dirty state.
 	mPipelineChanged = false;
 
+	// Record latency statistics (only while profiling, since that's when per-pass events exist)
+	if (Falcor::gProfileEnabled)
+	{
+		extractProfilingData();
+	}
+	else
+	{
+		mRecordedLastFrame = false;
+	}
+
 	// Get rid of our default state
 	pRenderContext->popGraphicsState();
 }
@@ -703,6 +768,12 @@ void RenderingPipeline::onInitNewScene(RenderContext* pRenderContext, Scene::Sha
 	if (pScene) 
 		mpScene = pScene;
 
+	// Loading a scene detaches its camera path, so re-attach if requested
+	if (pScene && mUseSceneCameraPath && pScene->getPathCount())
+	{
+		pScene->getPath(0)->attachObject(pScene->getActiveCamera());
+	}
+
 	// When a new scene is loaded, we'll tell all our passes about it (not just active passes)
 	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
 	{
@@ -713,6 +784,21 @@ void RenderingPipeline::onInitNewScene(RenderContext* pRenderContext, Scene::Sha
 	}
 }
 
+void RenderingPipeline::setCameraPathEnabled(bool enable)
+{
+	mUseSceneCameraPath = enable;
+	if (!mpScene || !mpScene->getPathCount()) return;
+
+	if (mUseSceneCameraPath)
+	{
+		mpScene->getPath(0)->attachObject(mpScene->getActiveCamera());
+	}
+	else
+	{
+		mpScene->getPath(0)->detachObject(mpScene->getActiveCamera());
+	}
+}
+
 void RenderingPipeline::onResizeSwapChain(SampleCallbacks* pSample, uint32_t width, uint32_t height)
 {
 	// Stash the current size, so if we need it later, we'll have access.
@@ -740,6 +826,13 @@ void RenderingPipeline::onResizeSwapChain(SampleCallbacks* pSample, uint32_t wid
 
 void RenderingPipeline::onShutdown(SampleCallbacks* pSample)
 {
+	// Stop watching our pipeline description
+	if (!mWatchedPipeDescFilename.empty())
+	{
+		closeSharedFile(mWatchedPipeDescFilename);
+		mWatchedPipeDescFilename.clear();
+	}
+
 	// On program shutdown, call the shutdown callback on all the render passes.
     // We do not have to worry about double-deletion etc. It is currently enforced that a pass is only bound to one pipeline.
 	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
@@ -848,46 +941,229 @@ void RenderingPipeline::addPipeInstructions(const std::string &str)
 
 void RenderingPipeline::extractProfilingData(void)
 {
-	// This is a pretty ugly method.  It basically undoes Falcor's standard
-	//    profiler output, which is a strigified concatenation of all the data
-	//    we care about.  The 'right' way to deal with this is to update 
-	//    Falcor to provide a more granular way of accessing profile data that
-	//    isn't stringified.  For now, I'll just extract the data from 
-	//    the string.  So, yeah, this is ugly.  And if Falcor changes the profiler,
-	//    this will need updating.
-
-	// Get our Falcor profiler string
-	std::string profileMsg = Profiler::getEventsString();
-    mTmpStr = profileMsg;
-
-	// Grab all of the lines with profiling data
-	int findPass = 0;
-	int count = 1;
-
-	size_t endOfLine = profileMsg.find('\n');
-	while (endOfLine != std::string::npos && findPass < mActivePasses.size())
-	{
-		// Each RenderPass is profiled with the name "Pass_%d" where %d various from 0 to (#passes-1)
-		char buf[128], passName[128];
-		float cpuTime, gpuTime;
-		sprintf_s(buf, "Pass_%d", findPass);
-
-		// See if this line contains the time for the next pass (each line contains: <profileEventName> <cpuTime> <gpuTime>)
-		sscanf( profileMsg.substr(0, endOfLine).c_str(), "%s %f %f ", passName, &cpuTime, &gpuTime );
-		if (!strcmp(buf, passName))
+	// Whole-frame time is measured between two calls, so it includes GUI, present and vsync
+	CpuTimer::TimePoint frameStart = CpuTimer::getCurrentTimePoint();
+	if (mRecordedLastFrame)
+	{
+		mFrameStats.record(kFrameStatsTrack, 0, mStatsFrameId, CpuTimer::calcDuration(mLastFrameStart, frameStart), -1.0);
+	}
+	mLastFrameStart = frameStart;
+	mRecordedLastFrame = true;
+
+	// Every pass and any stage a pass profiles internally.  Events still open (e.g., the one around our own
+	//    onFrameRender()) have no time yet.  GPU times are double buffered by the profiler and lag a frame behind.
+	for (const Profiler::EventData* pEvent : Profiler::getFrameEvents())
+	{
+		if (!pEvent->callStack.empty()) continue;
+		mFrameStats.record(pEvent->name, pEvent->level, mStatsFrameId, Profiler::getEventCpuTime(pEvent), Profiler::getEventGpuTime(pEvent));
+	}
+	mStatsFrameId++;
+}
+
+
+bool RenderingPipeline::loadPipelineDescription(const std::string &filename, bool watchForChanges)
+{
+	std::string fullPath = filename;
+	if (!doesFileExist(fullPath) && !findFileInDataDirectories(filename, fullPath))
+	{
+		logError("Can't find pipeline description '" + filename + "'");
+		return false;
+	}
+
+	// Parse now even if we apply later, so the caller hears about broken files
+	PipelineDescription desc;
+	std::string log;
+	if (!PipelineDescription::load(fullPath, desc, log))
+	{
+		logError(log);
+		return false;
+	}
+
+	// Once initialized, passes need a render context, so the change is picked up at the start of the next frame
+	mPipeDescFilename = fullPath;
+	if (mIsInitialized)
+	{
+		mPipeDescChanged = true;
+	}
+	else if (!applyPipelineDescription(desc, nullptr))
+	{
+		return false;
+	}
+
+	// Only one watcher thread per file may exist, and they can't be joined, so switch watches carefully
+	if (watchForChanges && mWatchedPipeDescFilename != fullPath)
+	{
+		if (!mWatchedPipeDescFilename.empty()) closeSharedFile(mWatchedPipeDescFilename);
+		mWatchedPipeDescFilename = fullPath;
+		monitorFileUpdates(fullPath, [this]() { mPipeDescChanged = true; });
+	}
+	return true;
+}
+
+void RenderingPipeline::reloadPipelineDescription(SampleCallbacks* pSample)
+{
+	// Editors often write files in several steps, so a broken file is not an error; just keep what we have
+	PipelineDescription desc;
+	std::string log;
+	if (!PipelineDescription::load(mPipeDescFilename, desc, log))
+	{
+		logWarning(log + ".  Keeping the current pipeline.");
+		return;
+	}
+
+	if (applyPipelineDescription(desc, pSample))
+	{
+		logInfo("Reloaded pipeline description '" + mPipeDescFilename + "'");
+	}
+}
+
+bool RenderingPipeline::applyPipelineDescription(const PipelineDescription &desc, SampleCallbacks* pSample)
+{
+	// Instantiate everything first, so a typo in the file leaves the current pipeline running
+	std::vector<::RenderPass::SharedPtr> newPasses;
+	for (const auto& passDesc : desc.passes)
+	{
+		::RenderPass::SharedPtr pPass = PassRegistry::instance().createPass(passDesc.type, passDesc.args);
+		if (!pPass) return false;
+		newPasses.push_back(pPass);
+	}
+	RenderContext* pRenderContext = pSample ? pSample->getRenderContext().get() : nullptr;
+
+	// Tear down the old pass list.  Passes in it are removed from the available passes, too, so they don't
+	//     linger in dropdowns.  Passes only registered via addPass() or setPassOptions() stay selectable.
+	for (auto& pOldPass : mActivePasses)
+	{
+		if (!pOldPass) continue;
+		if (mIsInitialized)
 		{
-			mProfileGPUTimes[findPass++] = gpuTime;	
+			pOldPass->onPassDeactivation();
+			if (pOldPass->isInitialized()) pOldPass->onShutdown();
+		}
+		auto passLoc = std::find(mAvailPasses.begin(), mAvailPasses.end(), pOldPass);
+		if (passLoc != mAvailPasses.end()) mAvailPasses.erase(passLoc);
+	}
+	mActivePasses.clear();
+	mPassSelectors.clear();
+	mPassId.clear();
+	mEnablePassGui.clear();
+	mEnableAddRemove.clear();
+
+	// Build the new pass list.  Before initialization, onLoad() initializes the passes for us.
+	for (uint32_t i = 0; i < uint32_t(newPasses.size()); i++)
+	{
+		const PipelineDescription::Pass& passDesc = desc.passes[i];
+		::RenderPass::SharedPtr pPass = newPasses[i];
+		if (mIsInitialized)
+		{
+			if (pPass->onInitialize(pRenderContext, mpResourceManager, mLastKnownSize.x, mLastKnownSize.y))
+			{
+				if (mpScene) pPass->onInitScene(pRenderContext, mpScene);
+			}
+			else
+			{
+				logWarning("Pass '" + passDesc.type + "' failed to initialize; leaving its slot empty");
+				pPass = nullptr;
+			}
 		}
 
-		// Move onto the next line of the string.
-		profileMsg = profileMsg.substr(endOfLine+1);
-		endOfLine = profileMsg.find('\n');
+		if (pPass)
+		{
+			for (const auto& option : passDesc.options)
+			{
+				pPass->onSetOption(option.first, option.second);
+			}
+		}
+
+		setPass(i, pPass, passDesc.canAddPassAfter, passDesc.canRemovePass);
+		mEnablePassGui[i] = passDesc.showGui;
 	}
-}
 
+	// Pipeline-wide settings
+	std::string sceneName = PassRegistry::getArg(desc.settings, "scene");
+	if (!sceneName.empty() && sceneName != mDefaultSceneOverride)
+	{
+		setDefaultScene(sceneName);
+		if (mIsInitialized)
+		{
+			RtScene::SharedPtr loadedScene = loadScene(mLastKnownSize, sceneName.c_str());
+			if (loadedScene) onInitNewScene(pRenderContext, loadedScene);
+		}
+	}
+
+	bool enable;
+	if (getBoolSetting(desc.settings, "cameraPath", enable)) setCameraPathEnabled(enable);
+	if (getBoolSetting(desc.settings, "freezeTime", enable))
+	{
+		mFreezeTime = enable;
+		if (pSample) pSample->freezeTime(mFreezeTime);
+	}
+
+	if (mIsInitialized)
+	{
+		// Allocate channels requested by the new passes and make room for their profiling data
+		mpResourceManager->initializeResources();
+		for (uint32_t i = uint32_t(mProfileNames.size()); i < mActivePasses.size() * 2; i++)
+		{
+			char buf[256];
+			sprintf_s(buf, "Pass_%d", i);
+			mProfileNames.push_back(HashedString(std::string(buf)));
+		}
+		mGlobalPipeRefresh = true;
+	}
+
+	updatePipelineRequirementFlags();
+	mPipelineChanged = true;
+	return true;
+}
 
 void RenderingPipeline::run(RenderingPipeline *pipe, SampleConfig &config)
 {
+	// Parse the command line the same way Sample does, to see if we should run without a window
+	ArgList args;
+#ifdef _WIN32
+	if (config.argc == 0 || config.argv == nullptr)
+	{
+		args.parseCommandLine(GetCommandLineA());
+	}
+	else
+#endif
+	{
+		args.parseCommandLine(concatCommandLine(config.argc, config.argv));
+	}
+
+	// "-modelcache <dir>" moves the processed-model cache, "-warmcache <models...>" fills it and exits without creating a device (for build machines)
+	std::vector<ArgList::Arg> cacheDir = args.getValues("modelcache");
+	if (!cacheDir.empty())
+	{
+		ModelCache::setDirectory(cacheDir[0].asString());
+	}
+	if (args.argExists("warmcache"))
+	{
+		// The cache is keyed on the load flags.  By default the models are warmed for loadScene(); "-warmflags <mask>" overrides the Model::LoadFlags.
+		std::vector<ArgList::Arg> warmFlags = args.getValues("warmflags");
+		Model::LoadFlags flags = warmFlags.empty() ? kSceneModelLoadFlags : (Model::LoadFlags)warmFlags[0].asUint();
+		uint32_t failed = 0;
+		for (const auto& model : args.getValues("warmcache"))
+		{
+			if (!ModelCache::warm(model.asString(), flags)) failed++;
+		}
+		logInfo("Model cache: warmed " + std::to_string(args.getValues("warmcache").size() - failed) + " model(s), " + std::to_string(failed) + " failed");
+		delete pipe;
+		return;
+	}
+
+	// A pipeline description on the command line replaces the pass list set up by the application
+	std::vector<ArgList::Arg> pipeDesc = args.getValues("pipeline");
+	if (!pipeDesc.empty())
+	{
+		pipe->loadPipelineDescription(pipeDesc[0].asString(), !HeadlessRunner::isRequested(args));
+	}
 	pipe->updatePipelineRequirementFlags();
+
+	if (HeadlessRunner::isRequested(args))
+	{
+		HeadlessRunner::run(std::unique_ptr<RenderingPipeline>(pipe), config, args);
+		return;
+	}
 	Sample::run(config, std::unique_ptr<Renderer>(pipe));
 }
\ No newline at end of file
@@ -20,6 +20,9 @@
 #include "Falcor.h"
 #include "RenderPass.h"
 #include "ResourceManager.h"
+#include "PipelineDescription.h"
+#include "FrameStatistics.h"
+#include <atomic>
 
 class RenderingPipeline : public Renderer, inherit_shared_from_this<Renderer, RenderingPipeline>
 {
@@ -49,10 +52,40 @@ public:
 	*/
 	uint32_t addPass(::RenderPass::SharedPtr pNewPass);
 
-	/** To start running the application with this rendering pipeline, call this method
+	/** To start running the application with this rendering pipeline, call this method.  If the command line
+	    contains -headless, the pipeline is run offscreen by HeadlessRunner instead of opening a window.
+	    "-warmcache <models...>" only fills the processed-model cache (in "-modelcache <dir>", if given) and returns.
 	*/
 	static void run(RenderingPipeline *pipe, SampleConfig &config);
 
+	/** Replaces the pass list with the one in a JSON pipeline description (see PipelineDescription.h).  Passes are
+	    instantiated through the PassRegistry.  If the renderer is already initialized, the change is applied at the
+	    start of the next frame.
+	\param[in] filename  Path to the description, either absolute or relative to the data directories.
+	\param[in] watchForChanges  Reload the pipeline whenever the file is saved.
+	\return false if the file can't be found or parsed, in which case the current pipeline is left untouched.
+	*/
+	bool loadPipelineDescription(const std::string &filename, bool watchForChanges = true);
+
+	/** Overrides the scene loaded on startup (and forces one to be loaded).  Call before the renderer has been initialized.
+	*/
+	void setDefaultScene(const std::string &sceneFilename) { mDefaultSceneOverride = sceneFilename; }
+
+	/** Attaches (or detaches) the active camera to the scene's first camera path.  Persists across scene loads.
+	*/
+	void setCameraPathEnabled(bool enable);
+
+	/** Returns an ordered list of currently active passes without gaps.
+	*/
+	void getActivePasses(std::vector<::RenderPass::SharedPtr>& activePasses) const;
+
+	/** Returns the per-pass / per-stage latency statistics.  Recorded while profiling is enabled.
+	*/
+	const FrameStatistics& getFrameStatistics() const { return mFrameStats; }
+
+	ResourceManager::SharedPtr getResourceManager() const { return mpResourceManager; }
+	Scene::SharedPtr getScene() const { return mpScene; }
+
 	// Overloaded methods from MyRenderer
 	virtual void onLoad(SampleCallbacks* pSample, const RenderContext::SharedPtr &pRenderContext) override;
 	virtual void onFrameRender(SampleCallbacks* pSample, const RenderContext::SharedPtr &pRenderContext, const Fbo::SharedPtr &pTargetFbo) override;
@@ -69,10 +102,6 @@ protected:
 	*/
 	void onInitNewScene(RenderContext* pRenderContext, Scene::SharedPtr pScene);
 
-    /** Returns an ordered list of currently active passes without gaps.
-    */
-    void getActivePasses(std::vector<::RenderPass::SharedPtr>& activePasses) const;
-
     /** Returns the last known swap chain size.
     */
     glm::uvec2 getSwapChainSize() const { return mLastKnownSize; }
@@ -111,9 +140,15 @@ private:
 	// Update the mPipeRequires* member variables
 	void updatePipelineRequirementFlags(void);
 
-	// Extract profiling data
+	// Feed this frame's profiler events into mFrameStats
 	void extractProfilingData(void);
 
+	// Replace the pass list and settings with the ones from a pipeline description.  pSample is null before initialization.
+	bool applyPipelineDescription(const PipelineDescription &desc, SampleCallbacks* pSample);
+
+	// Re-read mPipeDescFilename and apply it.  Keeps the current pipeline if the file is broken.
+	void reloadPipelineDescription(SampleCallbacks* pSample);
+
 	enum UIOptions { CanRemove = 0x1u, CanAddAfter = 0x2u };
 
 	// Internal state
@@ -135,12 +170,19 @@ private:
 	ResourceManager::SharedPtr mpResourceManager;
 	int32_t mOutputBufferIndex = 0;
 	Scene::SharedPtr mpScene = nullptr;                     ///< Stash a copy of our scene
+	std::string mDefaultSceneOverride;                      ///< Scene set through setDefaultScene(), if any
+	std::string mPipeDescFilename;                          ///< Pipeline description we were loaded from, if any
+	std::string mWatchedPipeDescFilename;                   ///< File currently watched by monitorFileUpdates()
+	std::atomic<bool> mPipeDescChanged{ false };            ///< Set by the file watcher thread, consumed in onFrameRender()
 	CameraController::SharedPtr mpCameraControl;
 	GraphicsState::SharedPtr mpDefaultGfxState;
 	std::vector< std::string > mPipeDescription;            ///< Can store a description of the pipeline for display in the UI
 	std::vector< HashedString > mProfileNames;
-	std::vector< double > mProfileGPUTimes;
-    std::vector< double > mProfileLastGPUTimes;
+	FrameStatistics mFrameStats;                            ///< Latency statistics of the frame, each pass and their profiled stages
+	CpuTimer::TimePoint mLastFrameStart;                    ///< Start of the last frame we recorded statistics for
+	bool mRecordedLastFrame = false;                        ///< Did we record statistics last frame?  (Otherwise there's no frame time.)
+	uint64_t mStatsFrameId = 0;
+	int32_t mTraceFrames = 30;                              ///< Number of frames captured by the "Capture trace" button
 
 	// Are we storing an environment map?
 	Gui::DropdownList mEnvMapSelector;
@@ -168,5 +210,4 @@ private:
 	float             mMinTArray[8] = { 0.1f, 0.01f, 0.001f, 1e-4f, 1e-5f, 1e-6f, 1e-7f, 0.0f };
 	uint32_t          mMinTSelection = 3;
 
-    std::string mTmpStr = "";
 };
@@ -22,6 +22,9 @@
 const std::string ResourceManager::kOutputChannel  = "PipelineOutput";
 const std::string ResourceManager::kEnvironmentMap = "EnvironmentMap";
 
+// The solid color environment maps get sampling tables of this size, so that their directions are sampled uniformly over the sphere
+static const uvec2 kSolidEnvMapTableSize = uvec2(64, 32);
+
 ResourceManager::SharedPtr ResourceManager::create(uint32_t width, uint32_t height, SampleCallbacks *callbacks)
 {
 	return SharedPtr(new ResourceManager(width, height, callbacks));
@@ -82,6 +85,7 @@ bool ResourceManager::updateEnvironmentMap(const std::string &filename)
 		Texture::SharedPtr tmpEnv = Texture::create2D(128, 128, ResourceFormat::RGBA32Float, 1u, 1u, nullptr, ResourceManager::kDefaultFlags);
 		mpAppCallbacks->getRenderContext()->clearUAV(tmpEnv->getUAV().get(), vec4(0.5f, 0.5f, 0.8f, 1.0f));
 		manageTextureResource(ResourceManager::kEnvironmentMap, tmpEnv);
+		mpEnvMapSampler = EnvMapSampler::create(std::vector<vec4>(kSolidEnvMapTableSize.x * kSolidEnvMapTableSize.y, vec4(0.5f, 0.5f, 0.8f, 1.0f)), kSolidEnvMapTableSize.x, kSolidEnvMapTableSize.y);
 		mUpdatedFlag = true;
 		return true;
 	}
@@ -90,6 +94,7 @@ bool ResourceManager::updateEnvironmentMap(const std::string &filename)
 		Texture::SharedPtr tmpEnv = Texture::create2D(128, 128, ResourceFormat::RGBA32Float, 1u, 1u, nullptr, ResourceManager::kDefaultFlags);
 		mpAppCallbacks->getRenderContext()->clearUAV(tmpEnv->getUAV().get(), vec4(0.0f, 0.0f, 0.0f, 1.0f));
 		manageTextureResource(ResourceManager::kEnvironmentMap, tmpEnv);
+		mpEnvMapSampler = EnvMapSampler::create(std::vector<vec4>(kSolidEnvMapTableSize.x * kSolidEnvMapTableSize.y, vec4(0.0f, 0.0f, 0.0f, 1.0f)), kSolidEnvMapTableSize.x, kSolidEnvMapTableSize.y);
 		mUpdatedFlag = true;
 		return true;
 	}
@@ -98,6 +103,7 @@ bool ResourceManager::updateEnvironmentMap(const std::string &filename)
 		Texture::SharedPtr tmpEnv = Texture::create2D(128, 128, ResourceFormat::RGBA32Float, 1u, 1u, nullptr, ResourceManager::kDefaultFlags);
 		mpAppCallbacks->getRenderContext()->clearUAV(tmpEnv->getUAV().get(), vec4(0.078f, 0.361f, 0.753f, 1.0f));
 		manageTextureResource(ResourceManager::kEnvironmentMap, tmpEnv);
+		mpEnvMapSampler = EnvMapSampler::create(std::vector<vec4>(kSolidEnvMapTableSize.x * kSolidEnvMapTableSize.y, vec4(0.078f, 0.361f, 0.753f, 1.0f)), kSolidEnvMapTableSize.x, kSolidEnvMapTableSize.y);
 		mUpdatedFlag = true;
 		return true;
 	}
@@ -111,6 +117,9 @@ bool ResourceManager::updateEnvironmentMap(const std::string &filename)
 			size_t found = filename.find_last_of("/\\");
 			mEnvMapFilename = filename.substr(found + 1).c_str();
 			manageTextureResource(ResourceManager::kEnvironmentMap, envMap);
+
+			// Build the luminance-based sampling tables, or reuse the ones cached for this file
+			mpEnvMapSampler = EnvMapSampler::create(mpAppCallbacks->getRenderContext(), envMap, filename);
 			mUpdatedFlag = true;
 			return true;
 		}
@@ -18,6 +18,7 @@
 
 #pragma once
 #include "Falcor.h"
+#include "Graphics/EnvMapSampler.h"
 #include <vector>
 #include <map>
 
@@ -89,6 +90,10 @@ public:
 	Texture::SharedPtr getEnvironmentMap() { return getTexture( kEnvironmentMap );  }
 	uvec2 getEnvironmentMapSize() const;
 
+	// Importance sampling tables for the environment map, built (or loaded from the cache) whenever the map changes.
+	//     Can be null if the map's format can't be read back on the CPU.
+	EnvMapSampler::SharedPtr getEnvironmentMapSampler() { return mpEnvMapSampler; }
+
 	// Creates a framebuffer from a set of resources managed by the ResourceManager.  
 	//    -> Note:  This FBO remains valid until haveResourcesChanged() is true, at which point the user needs to recreate it
 	//    -> Color buffers are attached based on their location in the vector.  Invalid indicies (i.e., -1) can be inserted 
@@ -151,6 +156,7 @@ protected:
 
 	// If using the resource manager to manage an environment map, its filename is here.
 	std::string mEnvMapFilename = "";
+	EnvMapSampler::SharedPtr mpEnvMapSampler;
 
 	// Can specify the default scene to load
 	std::string mDefaultSceneName = "Media/Arcade/Arcade.fscene";